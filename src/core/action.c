@@ -47,6 +47,7 @@
 #include "sr_module.h"
 #include "select_buf.h"
 #include "mem/mem.h"
+#include "mem/shm_mem.h"
 #include "globals.h"
 #include "dset.h"
 #include "onsend.h"
@@ -66,6 +67,7 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <stdlib.h>
+#include <time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <string.h>
@@ -83,6 +85,70 @@ static cfg_action_t *_cfg_crt_action = 0;
 /*!< maximum number of recursive calls for blocks of actions */
 static unsigned int max_recursive_level = 256;
 
+/* route profiler - cycles and call counts per config file:line,
+ * aggregated in a shared table read by the core.route_profile rpc.
+ * Enabled with the route_profile config setting; the table is
+ * allocated before forking so all processes share it. */
+int ksr_rprof_enabled = 0;
+ksr_rprof_rec_t *_ksr_rprof = NULL;
+
+int ksr_rprof_init(void)
+{
+	if(!ksr_rprof_enabled)
+		return 0;
+	_ksr_rprof = (ksr_rprof_rec_t *)shm_malloc(
+			KSR_RPROF_SLOTS * sizeof(ksr_rprof_rec_t));
+	if(_ksr_rprof == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_ksr_rprof, 0, KSR_RPROF_SLOTS * sizeof(ksr_rprof_rec_t));
+	return 0;
+}
+
+/* cycle counter for profiling action execution */
+static inline unsigned long long ksr_rprof_cycles(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	unsigned int lo, hi;
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((unsigned long long)hi << 32) | lo;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL
+		   + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+/* add one execution to the file:line slot - lock-free, the counters are
+ * advisory and races only lose single samples. The cfile pointers are
+ * set while parsing, before forking, so they compare equal in all
+ * processes */
+static inline void ksr_rprof_record(
+		const char *cfile, int cline, unsigned long long cycles)
+{
+	ksr_rprof_rec_t *rec;
+	unsigned int idx;
+	int i;
+
+	idx = ((unsigned int)(unsigned long)cfile >> 4) * 31
+		  + (unsigned int)cline;
+	for(i = 0; i < 8; i++) {
+		rec = &_ksr_rprof[(idx + i) & (KSR_RPROF_SLOTS - 1)];
+		if(rec->cfile == NULL) {
+			rec->cfile = cfile;
+			rec->cline = cline;
+		} else if(rec->cfile != cfile || rec->cline != cline) {
+			continue;
+		}
+		rec->count++;
+		rec->cycles += cycles;
+		return;
+	}
+	/* neighbourhood full - drop the sample */
+}
+
 void set_max_recursive_level(unsigned int lev)
 {
 	max_recursive_level = lev;
@@ -1617,7 +1683,16 @@ int run_actions(struct run_act_ctx *h, struct action *a, struct sip_msg *msg)
 		if(unlikely(log_prefix_mode == 1)) {
 			log_prefix_set(msg);
 		}
-		ret = do_action(h, t, msg);
+		if(unlikely(ksr_rprof_enabled && _ksr_rprof != NULL)) {
+			unsigned long long c0;
+			c0 = ksr_rprof_cycles();
+			ret = do_action(h, t, msg);
+			if(likely(t->cfile != NULL))
+				ksr_rprof_record(
+						t->cfile, t->cline, ksr_rprof_cycles() - c0);
+		} else {
+			ret = do_action(h, t, msg);
+		}
 		_cfg_crt_action = 0;
 		if(unlikely(log_prefix_mode == 1)) {
 			log_prefix_set(msg);
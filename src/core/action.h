@@ -81,4 +81,22 @@ void log_prefix_set(sip_msg_t *msg);
 
 int run_child_one_init_route(void);
 
+/* route profiler - when enabled with the route_profile config setting,
+ * run_actions() counts calls and cpu cycles per config file:line into a
+ * shared table, dumped by the core.route_profile rpc */
+#define KSR_RPROF_SLOTS 1024 /* must be a power of two */
+
+typedef struct ksr_rprof_rec
+{
+	const char *cfile;		  /* config file of the action */
+	int cline;				  /* config line of the action */
+	unsigned long count;	  /* executions */
+	unsigned long long cycles; /* accumulated cpu cycles */
+} ksr_rprof_rec_t;
+
+extern int ksr_rprof_enabled;
+extern ksr_rprof_rec_t *_ksr_rprof;
+
+int ksr_rprof_init(void);
+
 #endif
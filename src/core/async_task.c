@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <netinet/in.h>
@@ -81,6 +82,26 @@ async_wgroup_t *async_task_workers_get_crt(void)
 	return _async_wgroup_crt;
 }
 
+/**
+ *
+ */
+async_wgroup_t *async_task_group_list(void)
+{
+	return _async_wgroup_list;
+}
+
+/**
+ *
+ */
+static unsigned long long async_task_time_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long long)tv.tv_sec * 1000000ULL
+		   + (unsigned long long)tv.tv_usec;
+}
+
 /**
  *
  */
@@ -95,6 +116,19 @@ int async_task_init_sockets(void)
 			return -1;
 		}
 
+		awg->ring = (async_ring_t *)shm_malloc(sizeof(async_ring_t));
+		if(awg->ring == NULL) {
+			SHM_MEM_ERROR;
+			return -1;
+		}
+		memset(awg->ring, 0, sizeof(async_ring_t));
+		if(lock_init(&awg->ring->lock) == NULL) {
+			LM_ERR("failed to initialize the task ring lock\n");
+			shm_free(awg->ring);
+			awg->ring = NULL;
+			return -1;
+		}
+
 		if(awg->nonblock) {
 			val = fcntl(awg->sockets[1], F_GETFL, 0);
 			if(val < 0) {
@@ -397,24 +431,117 @@ int async_task_set_workers_group(char *data)
 }
 
 /**
- *
+ * enqueue the task for the given worker group - high priority tasks are
+ * queued separately and drained first by the workers; a short doorbell
+ * datagram wakes up one worker; if the ring is full (or missing), the task
+ * pointer itself is passed over the socket, keeping the old behaviour
  */
-int async_task_push(async_task_t *task)
+static int async_task_send(async_wgroup_t *awg, async_task_t *task)
 {
+	async_rqueue_t *aq;
+	unsigned int depth;
+	int prio;
 	int len;
+	char dbell = 1;
+
+	if(likely(awg->ring != NULL)) {
+		prio = (task->prio == ASYNC_TASK_PRIO_HIGH) ? ASYNC_TASK_PRIO_HIGH
+													: ASYNC_TASK_PRIO_NORMAL;
+		lock_get(&awg->ring->lock);
+		aq = &awg->ring->queue[prio];
+		if(aq->head - aq->tail < ASYNC_RING_SIZE) {
+			aq->items[aq->head % ASYNC_RING_SIZE].task = task;
+			aq->items[aq->head % ASYNC_RING_SIZE].ptime = async_task_time_us();
+			aq->head++;
+			awg->ring->pushed++;
+			depth = (awg->ring->queue[ASYNC_TASK_PRIO_NORMAL].head
+							- awg->ring->queue[ASYNC_TASK_PRIO_NORMAL].tail)
+					+ (awg->ring->queue[ASYNC_TASK_PRIO_HIGH].head
+							- awg->ring->queue[ASYNC_TASK_PRIO_HIGH].tail);
+			if(depth > awg->ring->max_depth) {
+				awg->ring->max_depth = depth;
+			}
+			lock_release(&awg->ring->lock);
+			/* a lost doorbell datagram is recovered by the workers'
+			 * receive timeout */
+			len = write(awg->sockets[1], &dbell, 1);
+			if(len <= 0) {
+				LM_DBG("failed to notify the workers of group [%.*s]\n",
+						awg->name.len, awg->name.s);
+			}
+			LM_DBG("task [%p] queued to group [%.*s]\n", task, awg->name.len,
+					awg->name.s);
+			return 0;
+		}
+		awg->ring->fallbacks++;
+		lock_release(&awg->ring->lock);
+	}
+	len = write(awg->sockets[1], &task, sizeof(async_task_t *));
+	if(len <= 0) {
+		LM_ERR("failed to pass the task [%p] to group [%.*s]\n", task,
+				awg->name.len, awg->name.s);
+		return -1;
+	}
+	LM_DBG("task [%p] sent to group [%.*s]\n", task, awg->name.len,
+			awg->name.s);
+	return 0;
+}
+
+/**
+ * take the next task from the group ring, high priority queue first
+ */
+static async_task_t *async_task_pop(async_wgroup_t *awg)
+{
+	async_task_t *ptask = NULL;
+	async_rqueue_t *aq;
+	async_ritem_t *ri;
+	int prio;
+
+	if(awg->ring == NULL) {
+		return NULL;
+	}
+	lock_get(&awg->ring->lock);
+	for(prio = ASYNC_TASK_PRIO_SIZE - 1; prio >= 0; prio--) {
+		aq = &awg->ring->queue[prio];
+		if(aq->head != aq->tail) {
+			ri = &aq->items[aq->tail % ASYNC_RING_SIZE];
+			ptask = ri->task;
+			aq->tail++;
+			awg->ring->executed++;
+			awg->ring->wait_us += async_task_time_us() - ri->ptime;
+			break;
+		}
+	}
+	lock_release(&awg->ring->lock);
+	return ptask;
+}
 
+/**
+ *
+ */
+static void async_task_exec(async_task_t *ptask)
+{
+	if(ptask->exec != NULL) {
+		LM_DBG("task executed [%p] (%p/%p)\n", (void *)ptask,
+				(void *)ptask->exec, (void *)ptask->param);
+		ptask->exec(ptask->param);
+	} else {
+		LM_DBG("task with no callback function - ignoring\n");
+	}
+	shm_free(ptask);
+}
+
+/**
+ *
+ */
+int async_task_push(async_task_t *task)
+{
 	if(_async_wgroup_list == NULL || _async_wgroup_list->workers <= 0) {
 		LM_WARN("async task pushed, but no async workers - ignoring\n");
 		return 0;
 	}
 
-	len = write(_async_wgroup_list->sockets[1], &task, sizeof(async_task_t *));
-	if(len <= 0) {
-		LM_ERR("failed to pass the task to async workers\n");
-		return -1;
-	}
-	LM_DBG("task sent [%p]\n", task);
-	return 0;
+	return async_task_send(_async_wgroup_list, task);
 }
 
 /**
@@ -437,12 +564,32 @@ async_wgroup_t *async_task_group_find(str *gname)
 	return NULL;
 }
 
+/**
+ * number of tasks currently queued in the ring of the worker group
+ * - returns -1 when the group has no ring
+ */
+int async_task_group_depth(async_wgroup_t *awg)
+{
+	int depth;
+
+	if(awg == NULL || awg->ring == NULL) {
+		return -1;
+	}
+	lock_get(&awg->ring->lock);
+	depth = (int)((awg->ring->queue[ASYNC_TASK_PRIO_NORMAL].head
+						  - awg->ring->queue[ASYNC_TASK_PRIO_NORMAL].tail)
+				  + (awg->ring->queue[ASYNC_TASK_PRIO_HIGH].head
+						  - awg->ring->queue[ASYNC_TASK_PRIO_HIGH].tail));
+	lock_release(&awg->ring->lock);
+
+	return depth;
+}
+
 /**
  *
  */
 int async_task_group_push(str *gname, async_task_t *task)
 {
-	int len;
 	async_wgroup_t *awg = NULL;
 
 	if(_async_wgroup_list == NULL) {
@@ -459,14 +606,7 @@ int async_task_group_push(str *gname, async_task_t *task)
 		LM_WARN("group [%.*s] not found - ignoring\n", gname->len, gname->s);
 		return 0;
 	}
-	len = write(awg->sockets[1], &task, sizeof(async_task_t *));
-	if(len <= 0) {
-		LM_ERR("failed to pass the task [%p] to group [%.*s]\n", task,
-				gname->len, gname->s);
-		return -1;
-	}
-	LM_DBG("task [%p] sent to group [%.*s]\n", task, gname->len, gname->s);
-	return 0;
+	return async_task_send(awg, task);
 }
 
 /**
@@ -474,20 +614,11 @@ int async_task_group_push(str *gname, async_task_t *task)
  */
 int async_task_group_send(async_wgroup_t *awg, async_task_t *task)
 {
-	int len;
 	if(awg == NULL) {
 		LM_WARN("group not provided\n");
 		return -1;
 	}
-	len = write(awg->sockets[1], &task, sizeof(async_task_t *));
-	if(len <= 0) {
-		LM_ERR("failed to pass the task [%p] to group [%.*s]\n", task,
-				awg->name.len, awg->name.s);
-		return -1;
-	}
-	LM_DBG("task [%p] sent to group [%.*s]\n", task, awg->name.len,
-			awg->name.s);
-	return 0;
+	return async_task_send(awg, task);
 }
 
 /**
@@ -497,34 +628,49 @@ int async_task_run(async_wgroup_t *awg, int idx)
 {
 	async_task_t *ptask;
 	int received;
+	struct timeval rtimeout;
 
 	LM_DBG("async task worker [%.*s] idx [%d] ready\n", awg->name.len,
 			awg->name.s, idx);
 
 	_async_wgroup_crt = awg;
 
+	/* wake up periodically to drain the ring even if a doorbell
+	 * datagram got lost */
+	rtimeout.tv_sec = 0;
+	rtimeout.tv_usec = 100000;
+	if(setsockopt(awg->sockets[0], SOL_SOCKET, SO_RCVTIMEO, &rtimeout,
+			   sizeof(rtimeout))
+			< 0) {
+		LM_WARN("failed to set the receive timeout (%d: %s)\n", errno,
+				strerror(errno));
+	}
+
 	for(;;) {
 		if(unlikely(awg->usleep))
 			sleep_us(awg->usleep);
+		while((ptask = async_task_pop(awg)) != NULL) {
+			async_task_exec(ptask);
+		}
 		if((received = recvfrom(awg->sockets[0], &ptask, sizeof(async_task_t *),
 					0, NULL, 0))
 				< 0) {
+			if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+				continue;
+			}
 			LM_ERR("failed to received task (%d: %s)\n", errno,
 					strerror(errno));
 			continue;
 		}
+		if(received == 1) {
+			/* doorbell - the ring is drained at the top of the loop */
+			continue;
+		}
 		if(received != sizeof(async_task_t *)) {
 			LM_ERR("invalid task size %d\n", received);
 			continue;
 		}
-		if(ptask->exec != NULL) {
-			LM_DBG("task executed [%p] (%p/%p)\n", (void *)ptask,
-					(void *)ptask->exec, (void *)ptask->param);
-			ptask->exec(ptask->param);
-		} else {
-			LM_DBG("task with no callback function - ignoring\n");
-		}
-		shm_free(ptask);
+		async_task_exec(ptask);
 	}
 
 	return 0;
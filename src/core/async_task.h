@@ -24,14 +24,50 @@
 #ifndef _ASYNC_TASK_H_
 #define _ASYNC_TASK_H_
 
+#include "locking.h"
+
 typedef void (*async_cbe_t)(void *p);
 
+/* task priorities - tasks are zero-initialized, so normal is the default */
+#define ASYNC_TASK_PRIO_NORMAL 0
+#define ASYNC_TASK_PRIO_HIGH 1
+#define ASYNC_TASK_PRIO_SIZE 2
+
 typedef struct _async_task
 {
 	async_cbe_t exec;
 	void *param;
+	int prio; /* ASYNC_TASK_PRIO_* - high priority tasks are executed first */
 } async_task_t;
 
+/* number of tasks per priority queue - must be a power of two */
+#define ASYNC_RING_SIZE 1024
+
+typedef struct _async_ritem
+{
+	async_task_t *task;
+	unsigned long long ptime; /* push timestamp (microseconds) */
+} async_ritem_t;
+
+typedef struct _async_rqueue
+{
+	unsigned int head; /* next slot to fill - advanced by producers */
+	unsigned int tail; /* next slot to drain - advanced by workers */
+	async_ritem_t items[ASYNC_RING_SIZE];
+} async_rqueue_t;
+
+typedef struct _async_ring
+{
+	gen_lock_t lock;
+	async_rqueue_t queue[ASYNC_TASK_PRIO_SIZE];
+	/* statistics - updated under the ring lock */
+	unsigned long long pushed;	  /* tasks queued via the ring */
+	unsigned long long executed;  /* tasks drained from the ring */
+	unsigned long long fallbacks; /* tasks sent over the socket (full ring) */
+	unsigned long long wait_us;	  /* total time tasks waited in the ring */
+	unsigned int max_depth;		  /* highest queued depth seen */
+} async_ring_t;
+
 typedef struct _async_wgroup
 {
 	str name;
@@ -39,6 +75,7 @@ typedef struct _async_wgroup
 	int sockets[2];
 	int usleep;
 	int nonblock;
+	async_ring_t *ring; /* shared task ring - allocated before forking */
 	struct _async_wgroup *next;
 } async_wgroup_t;
 
@@ -54,6 +91,8 @@ int async_task_workers_get(void);
 int async_task_workers_active(void);
 async_wgroup_t *async_task_workers_get_crt(void);
 async_wgroup_t *async_task_group_find(str *gname);
+async_wgroup_t *async_task_group_list(void);
+int async_task_group_depth(async_wgroup_t *awg);
 
 int async_task_group_push(str *gname, async_task_t *task);
 int async_task_group_send(async_wgroup_t *awg, async_task_t *task);
@@ -147,6 +147,10 @@ unsigned char _bx_ub64[0x54 + 1] = {0x3e, 0xff, 0xff, 0xff, 0x3f, 0x34, 0x35,
 #define b64_enc_char(c) base64_enc_char(c)
 #define b64_dec_char(c) base64_dec_char(c)
 
+#ifdef KSR_BASE64_AVX2_SUPPORT
+int ksr_base64_avx2 = 0;
+#endif
+
 int init_basex()
 {
 #ifdef BASE64_LOOKUP_TABLE
@@ -188,6 +192,12 @@ int init_basex()
 	for(r = 0; r < 256; r++)
 		_bx_ub64[r] = b64_dec_char((unsigned char)r);
 #endif
+#endif
+#ifdef KSR_BASE64_AVX2_SUPPORT
+	if(__builtin_cpu_supports("avx2")) {
+		ksr_base64_avx2 = 1;
+		LM_DBG("using avx2 accelerated base64\n");
+	}
 #endif
 	return 0;
 }
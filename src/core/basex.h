@@ -552,6 +552,130 @@ inline static unsigned base64_dec_char(unsigned char v)
 }
 
 
+/* vectorized base64: process whole 24 byte / 32 char blocks with avx2 and
+ * let the scalar code below finish the tail (and handle the padding).
+ * Selected at runtime: init_basex() sets ksr_base64_avx2 when the cpu
+ * supports it, on other cpus/architectures the lookup table code remains
+ * the only path. */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define KSR_BASE64_AVX2_SUPPORT
+#endif
+
+#ifdef KSR_BASE64_AVX2_SUPPORT
+
+#include <immintrin.h>
+
+extern int ksr_base64_avx2;
+
+/*! \brief encode whole 24 byte blocks of src into 32 base64 chars each
+ * (W. Mula's shuffle based algorithm).
+ * Each block loads 28 input bytes (2 overlapping 16 byte lane loads), so
+ * the last 24 byte group is always left to the caller.
+ * \return number of input bytes consumed (multiple of 24) */
+__attribute__((target("avx2"))) inline static int ksr_base64_enc_avx2(
+		unsigned char *src, int slen, unsigned char *dst)
+{
+	int consumed;
+	__m256i in, indices, res, cmp;
+	const __m256i shuf = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3,
+			4, 1, 2, 0, 1, 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m256i shift_lut = _mm256_setr_epi8(71, -4, -4, -4, -4, -4, -4, -4,
+			-4, -4, -4, -19, -16, 65, 0, 0, 71, -4, -4, -4, -4, -4, -4, -4,
+			-4, -4, -4, -19, -16, 65, 0, 0);
+
+	consumed = 0;
+	while(slen - consumed >= 28) {
+		in = _mm256_set_m128i(_mm_loadu_si128((const __m128i *)(src + 12)),
+				_mm_loadu_si128((const __m128i *)src));
+		/* spread the 3 byte groups over 4 bytes each, then split out the
+		 * 4 6-bit indices inside every 4 byte group */
+		in = _mm256_shuffle_epi8(in, shuf);
+		indices = _mm256_or_si256(
+				_mm256_mulhi_epu16(
+						_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+						_mm256_set1_epi32(0x04000040)),
+				_mm256_mullo_epi16(
+						_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+						_mm256_set1_epi32(0x01000010)));
+		/* translate the 0-63 indices to the base64 alphabet: reduce them
+		 * to 14 ranges sharing the same ascii offset, then add the per
+		 * range offset looked up with a shuffle */
+		res = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		cmp = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+		res = _mm256_or_si256(res, _mm256_and_si256(cmp, _mm256_set1_epi8(13)));
+		res = _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, res), indices);
+		_mm256_storeu_si256((__m256i *)dst, res);
+		src += 24;
+		dst += 32;
+		consumed += 24;
+	}
+	return consumed;
+}
+
+
+/*! \brief decode whole 32 char blocks of src into 24 bytes each.
+ * Stops before the first block containing a non-base64 char, so that the
+ * scalar code re-processes the input from that point and the output stays
+ * byte identical with the pure scalar version.
+ * \note WARNING: each block is written with 2 16 byte stores at dst and
+ * dst+12 (28 bytes for 24 produced) => the caller must guarantee that at
+ * least 4 more output bytes follow every block (base64_dec() does: it
+ * keeps the last 32 input chars for the scalar code).
+ * \return number of input chars consumed (multiple of 32) */
+__attribute__((target("avx2"))) inline static int ksr_base64_dec_avx2(
+		unsigned char *src, int slen, unsigned char *dst)
+{
+	int consumed;
+	__m256i in, hi_nib, lo, hi;
+	const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13,
+			0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04,
+			0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71,
+			-71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0,
+			0, 0, 0, 0, 0, 0, 0);
+	const __m256i pack_shuf = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+			13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+			-1, -1, -1, -1);
+
+	consumed = 0;
+	while(slen - consumed >= 32) {
+		in = _mm256_loadu_si256((const __m256i *)src);
+		hi_nib = _mm256_and_si256(
+				_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+		lo = _mm256_shuffle_epi8(
+				lut_lo, _mm256_and_si256(in, _mm256_set1_epi8(0x0f)));
+		hi = _mm256_shuffle_epi8(lut_hi, hi_nib);
+		if(unlikely(!_mm256_testz_si256(lo, hi)))
+			break; /* non-base64 char ('=' included) somewhere in the block */
+		/* ascii to 6-bit values: add a per character range offset looked
+		 * up by high nibble ('/' gets its own entry) */
+		in = _mm256_add_epi8(in,
+				_mm256_shuffle_epi8(lut_roll,
+						_mm256_add_epi8(_mm256_cmpeq_epi8(
+												in, _mm256_set1_epi8(0x2f)),
+								hi_nib)));
+		/* pack the 32 6-bit values into 24 bytes */
+		in = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+		in = _mm256_madd_epi16(in, _mm256_set1_epi32(0x00011000));
+		in = _mm256_shuffle_epi8(in, pack_shuf);
+		_mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(in));
+		_mm_storeu_si128(
+				(__m128i *)(dst + 12), _mm256_extracti128_si256(in, 1));
+		src += 32;
+		dst += 24;
+		consumed += 32;
+	}
+	return consumed;
+}
+
+#endif /* KSR_BASE64_AVX2_SUPPORT */
+
+
 #ifdef BASE64_LOOKUP_8K
 /*!
  * \return : size used from the output buffer (dst) on success ((slen+2)/3*4)
@@ -564,10 +688,21 @@ inline static int base64_enc(
 {
 	unsigned char *end;
 	int osize;
+#ifdef KSR_BASE64_AVX2_SUPPORT
+	int vn;
+#endif
 
 	osize = (slen + 2) / 3 * 4;
 	if(unlikely(dlen < osize))
 		return -osize;
+#ifdef KSR_BASE64_AVX2_SUPPORT
+	if(likely(ksr_base64_avx2) && unlikely(slen >= 28)) {
+		vn = ksr_base64_enc_avx2(src, slen, dst);
+		src += vn;
+		dst += vn / 3 * 4;
+		slen -= vn;
+	}
+#endif
 	end = src + slen / 3 * 3;
 	if(unlikely((long)dst % 2)) {
 		for(; src < end; src += 3, dst += 4) {
@@ -625,10 +760,21 @@ inline static int base64_enc(
 {
 	unsigned char *end;
 	int osize;
+#ifdef KSR_BASE64_AVX2_SUPPORT
+	int vn;
+#endif
 
 	osize = (slen + 2) / 3 * 4;
 	if(unlikely(dlen < osize))
 		return -osize;
+#ifdef KSR_BASE64_AVX2_SUPPORT
+	if(likely(ksr_base64_avx2) && unlikely(slen >= 28)) {
+		vn = ksr_base64_enc_avx2(src, slen, dst);
+		src += vn;
+		dst += vn / 3 * 4;
+		slen -= vn;
+	}
+#endif
 	end = src + slen / 3 * 3;
 	for(; src < end; src += 3, dst += 4) {
 		dst[0] = BASE64_1(src[0]);
@@ -668,6 +814,9 @@ inline static int base64_dec(
 	int osize;
 	register unsigned a, b, c, d; /* more registers used, but allows for
 									 parallel execution */
+#ifdef KSR_BASE64_AVX2_SUPPORT
+	int vn;
+#endif
 
 	if(unlikely((slen < 4) || (slen % 4)
 				|| (src[slen - 2] == '=' && src[slen - 1] != '=')))
@@ -675,6 +824,17 @@ inline static int base64_dec(
 	osize = (slen / 4 * 3) - (src[slen - 2] == '=') - (src[slen - 1] == '=');
 	if(unlikely(dlen < osize))
 		return -osize;
+#ifdef KSR_BASE64_AVX2_SUPPORT
+	if(likely(ksr_base64_avx2) && unlikely(slen > 32)) {
+		/* always keep the last 32 chars for the scalar code: it handles
+		 * the padding and covers the 4 bytes the vector stores write past
+		 * each decoded block */
+		vn = ksr_base64_dec_avx2(src, slen - 32, dst);
+		src += vn;
+		dst += vn / 4 * 3;
+		slen -= vn;
+	}
+#endif
 	end = src + slen - 4;
 	for(; src < end; src += 4, dst += 3) {
 #if 0
@@ -66,6 +66,9 @@
 #include "sr_compat.h"
 #include "msg_translator.h"
 #include "async_task.h"
+#include "pt.h"
+#include "action.h"
+#include "latency_hist.h"
 
 #include "kemi.h"
 #include "ppcfg.h"
@@ -261,10 +264,15 @@ extern char *default_routename;
 %token FORCE_RPORT
 %token ADD_LOCAL_RPORT
 %token LOCAL_RPORT
+%token FWD_FAST_REBUILD
 %token FORCE_TCP_ALIAS
 %token UDP_MTU
 %token UDP_MTU_TRY_PROTO
 %token UDP_RECEIVER_MODE
+%token UDP_MMSG_BATCH
+%token UDP_REUSEPORT
+%token UDP_GSO
+%token UDP_BUSY_POLL
 %token UDP4_RAW
 %token UDP4_RAW_MTU
 %token UDP4_RAW_TTL
@@ -321,7 +329,12 @@ extern char *default_routename;
 %token DEBUG_V
 %token FORK
 %token FORK_DELAY
+%token CPU_PIN_WORKERS
+%token ROUTE_PROFILE
+%token LATENCY_HIST
+%token LOG_ASYNC
 %token MODINIT_DELAY
+%token MODINIT_TWARN
 %token LOGSTDERROR
 %token LOGFACILITY
 %token LOGNAME
@@ -369,6 +382,7 @@ extern char *default_routename;
 %token DNS_CACHE_GC_INT
 %token DNS_CACHE_DEL_NONEXP
 %token DNS_CACHE_REC_PREF
+%token DNS_CACHE_REFRESH
 
 /* ipv6 auto bind */
 %token AUTO_BIND_IPV6
@@ -505,6 +519,7 @@ extern char *default_routename;
 %token OPEN_FD_LIMIT
 %token SHM_MEM_SZ
 %token SHM_FORCE_ALLOC
+%token SHM_HUGE_PAGES
 %token MLOCK_PAGES
 %token REAL_TIME
 %token RT_PRIO
@@ -526,6 +541,7 @@ extern char *default_routename;
 %token PVCACHEACTION
 %token HTTP_REPLY_PARSE
 %token VERSION_TABLE_CFG
+%token DB_POOL_SIZE
 %token VERBOSE_STARTUP
 %token ROUTE_LOCKS_SIZE
 %token WAIT_WORKER1_MODE
@@ -909,8 +925,18 @@ assign_stm:
 	| FORK  EQUAL error  { yyerror("boolean value expected"); }
 	| FORK_DELAY  EQUAL NUMBER { set_fork_delay($3); }
 	| FORK_DELAY  EQUAL error  { yyerror("number expected"); }
+	| CPU_PIN_WORKERS  EQUAL NUMBER { set_cpu_pin_workers($3); }
+	| CPU_PIN_WORKERS  EQUAL error  { yyerror("number expected"); }
+	| ROUTE_PROFILE  EQUAL NUMBER { ksr_rprof_enabled=$3; }
+	| ROUTE_PROFILE  EQUAL error  { yyerror("number expected"); }
+	| LATENCY_HIST  EQUAL NUMBER { ksr_lathist_enabled=$3; }
+	| LATENCY_HIST  EQUAL error  { yyerror("number expected"); }
+	| LOG_ASYNC  EQUAL NUMBER { ksr_log_async=$3; }
+	| LOG_ASYNC  EQUAL error  { yyerror("number expected"); }
 	| MODINIT_DELAY  EQUAL NUMBER { set_modinit_delay($3); }
 	| MODINIT_DELAY  EQUAL error  { yyerror("number expected"); }
+	| MODINIT_TWARN  EQUAL NUMBER { ksr_modinit_twarn=$3; }
+	| MODINIT_TWARN  EQUAL error  { yyerror("number expected"); }
 	| LOGSTDERROR EQUAL NUMBER { if (!config_check)  /* if set from cmd line, don't overwrite from yyparse()*/
 					if(log_stderr == 0) log_stderr=$3;
 				   }
@@ -1001,6 +1027,8 @@ assign_stm:
 	| DNS_CACHE_DEL_NONEXP error { yyerror("boolean value expected"); }
 	| DNS_CACHE_REC_PREF EQUAL NUMBER   { IF_DNS_CACHE(default_core_cfg.dns_cache_rec_pref=$3); }
 	| DNS_CACHE_REC_PREF error { yyerror("boolean value expected"); }
+	| DNS_CACHE_REFRESH EQUAL NUMBER   { IF_DNS_CACHE(default_core_cfg.dns_cache_refresh=$3); }
+	| DNS_CACHE_REFRESH error { yyerror("number expected"); }
 	| AUTO_BIND_IPV6 EQUAL NUMBER {IF_AUTO_BIND_IPV6(auto_bind_ipv6 = $3);}
 	| AUTO_BIND_IPV6 error { yyerror("boolean value expected"); }
 	| IPV6_HEX_STYLE EQUAL STRING {
@@ -1131,6 +1159,8 @@ assign_stm:
 			version_table.len=strlen(version_table.s);
 	}
 	| VERSION_TABLE_CFG EQUAL error { yyerror("string value expected"); }
+	| DB_POOL_SIZE EQUAL NUMBER { db_pool_size=$3; }
+	| DB_POOL_SIZE EQUAL error { yyerror("number expected"); }
 	| USER EQUAL STRING     {
 		if (shm_initialized())
 			yyerror("user must be before any modparam or the"
@@ -1941,6 +1971,14 @@ assign_stm:
 			shm_force_alloc=$3;
 	}
 	| SHM_FORCE_ALLOC EQUAL error { yyerror("boolean value expected"); }
+	| SHM_HUGE_PAGES EQUAL NUMBER {
+		if (shm_initialized())
+			yyerror("shm_huge_pages must be before any modparam or the"
+					" route blocks");
+		else
+			shm_huge_pages=$3;
+	}
+	| SHM_HUGE_PAGES EQUAL error { yyerror("boolean value expected"); }
 	| MLOCK_PAGES EQUAL NUMBER { mlock_pages=$3; }
 	| MLOCK_PAGES EQUAL error { yyerror("boolean value expected"); }
 	| REAL_TIME EQUAL NUMBER { real_time=$3; }
@@ -2129,11 +2167,21 @@ assign_stm:
 	| UDP_MTU EQUAL error { yyerror("number expected"); }
 	| UDP_RECEIVER_MODE EQUAL NUMBER { ksr_udp_receiver_mode=$3; }
 	| UDP_RECEIVER_MODE EQUAL error { yyerror("number expected"); }
+	| UDP_MMSG_BATCH EQUAL NUMBER { ksr_udp_mmsg_batch=$3; }
+	| UDP_MMSG_BATCH EQUAL error { yyerror("number expected"); }
+	| UDP_REUSEPORT EQUAL NUMBER { ksr_udp_reuseport=$3; }
+	| UDP_REUSEPORT EQUAL error { yyerror("number expected"); }
+	| UDP_GSO EQUAL NUMBER { ksr_udp_gso=$3; }
+	| UDP_GSO EQUAL error { yyerror("number expected"); }
+	| UDP_BUSY_POLL EQUAL NUMBER { ksr_udp_busy_poll=$3; }
+	| UDP_BUSY_POLL EQUAL error { yyerror("number expected"); }
 	| FORCE_RPORT EQUAL NUMBER
 		{ default_core_cfg.force_rport=$3; fix_global_req_flags(0, 0); }
 	| FORCE_RPORT EQUAL error { yyerror("boolean value expected"); }
 	| LOCAL_RPORT EQUAL NUMBER { ksr_local_rport=$3; }
 	| LOCAL_RPORT EQUAL error { yyerror("boolean value expected"); }
+	| FWD_FAST_REBUILD EQUAL NUMBER { ksr_fwd_fast_rebuild=$3; }
+	| FWD_FAST_REBUILD EQUAL error { yyerror("boolean value expected"); }
 	| UDP_MTU_TRY_PROTO EQUAL proto
 		{ default_core_cfg.udp_mtu_try_proto=$3; fix_global_req_flags(0, 0); }
 	| UDP_MTU_TRY_PROTO EQUAL error
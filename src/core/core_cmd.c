@@ -42,8 +42,12 @@
 #include "name_alias.h"
 #include "pt.h"
 #include "ut.h"
+#include "action.h"
+#include "async_task.h"
+#include "latency_hist.h"
 #include "tcp_info.h"
 #include "tcp_conn.h"
+#include "tcp_init.h"
 #include "tcp_options.h"
 #include "cfg_core.h"
 #include "ppcfg.h"
@@ -583,12 +587,210 @@ static void core_shmmem(rpc_t *rpc, void *c)
 	}
 	shm_info(&mi);
 	rpc->add(c, "{", &handle);
-	rpc->struct_add(handle, "jjjjjj", "total", (mi.total_size >> rs), "free",
+	rpc->struct_add(handle, "jjjjjjj", "total", (mi.total_size >> rs), "free",
 			(mi.free_size >> rs), "used", (mi.used_size >> rs), "real_used",
 			(mi.real_used >> rs), "max_used", (mi.max_used >> rs), "fragments",
-			mi.total_frags);
+			mi.total_frags, "max_free_frag", (mi.max_free_frag >> rs));
 }
 
+static void core_shm_defrag(rpc_t *rpc, void *c)
+{
+	int steps = 10000;
+	int joins;
+
+	rpc->scan(c, "*d", &steps);
+	if(steps <= 0)
+		steps = 10000;
+	joins = shm_defrag(steps);
+	if(joins < 0) {
+		rpc->fault(c, 500, "defrag not supported by this shm manager");
+		return;
+	}
+	rpc->add(c, "d", joins);
+}
+
+static const char *core_shm_defrag_doc[] = {
+		"Runs a bounded coalescing sweep over the shm free lists, joining"
+		" adjacent free fragments; optional parameter limits the number of"
+		" fragments visited (default 10000). Returns the number of joins.",
+		0 /* Method signature(s) */
+};
+
+static void core_mem_profile(rpc_t *rpc, void *c)
+{
+	int i;
+	void *handle;
+	char addr[32];
+
+	if(_ksr_shm_profile == NULL) {
+		rpc->fault(c, 500, "shm allocation profile not initialized");
+		return;
+	}
+	for(i = 0; i < KSR_SHM_PROFILE_SLOTS; i++) {
+		if(_ksr_shm_profile[i].pc != NULL) {
+			snprintf(addr, sizeof(addr), "%p", _ksr_shm_profile[i].pc);
+			rpc->add(c, "{", &handle);
+			rpc->struct_add(handle, "sjj", "pc", addr, "count",
+					_ksr_shm_profile[i].count, "bytes",
+					_ksr_shm_profile[i].bytes);
+		}
+	}
+}
+
+static const char *core_mem_profile_doc[] = {
+		"Returns the sampled shm allocation profile: per call site (pc, to"
+		" be resolved with addr2line) the number of sampled allocations and"
+		" sampled bytes since startup.",
+		0 /* Method signature(s) */
+};
+
+static void core_route_profile(rpc_t *rpc, void *c)
+{
+	int i;
+	void *handle;
+
+	if(_ksr_rprof == NULL) {
+		rpc->fault(c, 500, "route profiler not enabled (set route_profile)");
+		return;
+	}
+	for(i = 0; i < KSR_RPROF_SLOTS; i++) {
+		if(_ksr_rprof[i].cfile != NULL) {
+			rpc->add(c, "{", &handle);
+			rpc->struct_add(handle, "sdjj", "file", _ksr_rprof[i].cfile,
+					"line", _ksr_rprof[i].cline, "count", _ksr_rprof[i].count,
+					"cycles", (unsigned long)_ksr_rprof[i].cycles);
+		}
+	}
+}
+
+static const char *core_route_profile_doc[] = {
+		"Returns the route profile collected since startup when the"
+		" route_profile config setting is enabled: per config file:line the"
+		" number of executions and the accumulated cpu cycles.",
+		0 /* Method signature(s) */
+};
+
+static void core_async_stats(rpc_t *rpc, void *c)
+{
+	async_wgroup_t *awg;
+	async_ring_t *ring;
+	unsigned int depth;
+	unsigned long avg_wait;
+	void *handle;
+
+	awg = async_task_group_list();
+	if(awg == NULL) {
+		rpc->fault(c, 500, "no async worker groups");
+		return;
+	}
+	for(; awg != NULL; awg = awg->next) {
+		ring = awg->ring;
+		if(ring == NULL) {
+			continue;
+		}
+		lock_get(&ring->lock);
+		depth = (ring->queue[ASYNC_TASK_PRIO_NORMAL].head
+						- ring->queue[ASYNC_TASK_PRIO_NORMAL].tail)
+				+ (ring->queue[ASYNC_TASK_PRIO_HIGH].head
+						- ring->queue[ASYNC_TASK_PRIO_HIGH].tail);
+		avg_wait = (ring->executed > 0)
+						   ? (unsigned long)(ring->wait_us / ring->executed)
+						   : 0;
+		rpc->add(c, "{", &handle);
+		rpc->struct_add(handle, "Sddddjjj", "name", &awg->name, "workers",
+				awg->workers, "depth", (int)depth, "max_depth",
+				(int)ring->max_depth, "avg_wait_us", (int)avg_wait, "pushed",
+				(unsigned long)ring->pushed, "executed",
+				(unsigned long)ring->executed, "fallbacks",
+				(unsigned long)ring->fallbacks);
+		lock_release(&ring->lock);
+	}
+}
+
+static const char *core_async_stats_doc[] = {
+		"Returns the task queue statistics for each async worker group:"
+		" current and maximum queue depth, average queuing time and the"
+		" number of pushed, executed and fallback (full ring) tasks.",
+		0 /* Method signature(s) */
+};
+
+static void core_latency_hist(rpc_t *rpc, void *c)
+{
+	static char *stnames[KSR_LATHIST_STAGES] = {"parse", "route", "total"};
+	ksr_lathist_rec_t *rec;
+	ksr_lathist_rec_t snap;
+	void *handle;
+	char field[32];
+	int proto;
+	int midx;
+	int st;
+
+	if(!ksr_lathist_enabled) {
+		rpc->fault(c, 500, "latency histograms not enabled (set latency_hist)");
+		return;
+	}
+	for(proto = 0; proto < KSR_LATHIST_PROTOS; proto++) {
+		for(midx = 0; midx < KSR_LATHIST_METHODS; midx++) {
+			rec = ksr_lathist_get(proto, midx);
+			if(rec == NULL || rec->count == 0)
+				continue;
+			lock_get(&rec->lock);
+			memcpy(&snap, rec, sizeof(snap));
+			lock_release(&rec->lock);
+			rpc->add(c, "{", &handle);
+			rpc->struct_add(handle, "ss", "proto", get_proto_name(proto),
+					"method", ksr_lathist_method_name(midx));
+			rpc->struct_printf(handle, "count", "%llu", snap.count);
+			for(st = 0; st < KSR_LATHIST_STAGES; st++) {
+				snprintf(field, sizeof(field), "%s_avg_us", stnames[st]);
+				rpc->struct_printf(
+						handle, field, "%llu", snap.sum[st] / snap.count);
+				snprintf(field, sizeof(field), "%s_p50_us", stnames[st]);
+				rpc->struct_printf(handle, field, "%llu",
+						ksr_lathist_percentile(snap.bucket[st], snap.count,
+								500));
+				snprintf(field, sizeof(field), "%s_p95_us", stnames[st]);
+				rpc->struct_printf(handle, field, "%llu",
+						ksr_lathist_percentile(snap.bucket[st], snap.count,
+								950));
+				snprintf(field, sizeof(field), "%s_p99_us", stnames[st]);
+				rpc->struct_printf(handle, field, "%llu",
+						ksr_lathist_percentile(snap.bucket[st], snap.count,
+								990));
+			}
+		}
+	}
+}
+
+static void core_modinit_stats(rpc_t *rpc, void *c)
+{
+	sr_module_t *m;
+	void *handle;
+
+	for(m = modules; m != NULL; m = m->next) {
+		rpc->add(c, "{", &handle);
+		rpc->struct_add(handle, "sdd", "name", m->exports.name, "init_ms",
+				(int)m->init_dur_ms, "child_init_ms", (int)m->cinit_dur_ms);
+	}
+}
+
+static const char *core_modinit_stats_doc[] = {
+		"Returns per-module initialization times: the duration of mod_init()"
+		" (measured before forking) and the child init duration accumulated"
+		" in the answering process. Slow loaders can also be reported at"
+		" startup with the modinit_time_warn config setting.",
+		0 /* Method signature(s) */
+};
+
+static const char *core_latency_hist_doc[] = {
+		"Returns the message handling latency histograms collected when the"
+		" latency_hist config setting is enabled: per transport and method"
+		" the number of messages, the average and the p50/p95/p99 upper"
+		" bound estimates (microseconds) of the parse, route and total"
+		" stages of receive_msg().",
+		0 /* Method signature(s) */
+};
+
 static const char *core_shmmem_doc[] = {
 		"Returns shared memory info. It has an optional parameter that "
 		"specifies"
@@ -731,6 +933,37 @@ static void core_tcpinfo(rpc_t *rpc, void *c)
 }
 
 
+static const char *core_tcp_drain_doc[] = {
+		"Switches tcp to draining mode: on the next accept event tcp_main"
+		" closes all its tcp/tls listen sockets and keeps serving only the"
+		" established connections, so an overlapping instance started with"
+		" reuse_port=1 takes over the new connections. Without a parameter"
+		" the current state is returned (0 - off, 1 - requested, 2 - listen"
+		" sockets closed).",
+		0 /* Method signature(s) */
+};
+
+static void core_tcp_drain(rpc_t *rpc, void *c)
+{
+#ifdef USE_TCP
+	int start = 0;
+
+	if(tcp_disable) {
+		rpc->fault(c, 500, "tcp support disabled");
+		return;
+	}
+	rpc->scan(c, "*d", &start);
+	if(start != 0 && tcp_drain_start() < 0) {
+		rpc->fault(c, 500, "tcp not initialized");
+		return;
+	}
+	rpc->add(c, "d", tcp_drain_status());
+#else
+	rpc->fault(c, 500, "tcp support not compiled");
+#endif
+}
+
+
 static const char *core_tcp_options_doc[] = {
 		"Returns active tcp options.", /* Documentation string */
 		0							   /* Method signature(s) */
@@ -773,7 +1006,6 @@ static const char *core_tcp_list_doc[] = {
 		0									/* Method signature(s) */
 };
 
-extern gen_lock_t *tcpconn_lock;
 extern struct tcp_connection **tcpconn_id_hash;
 
 static void core_tcp_list(rpc_t *rpc, void *c)
@@ -1073,10 +1305,22 @@ static rpc_export_t core_rpc_methods[] = {
 		{"core.arg", core_arg, core_arg_doc, RPC_RET_ARRAY},
 		{"core.kill", core_kill, core_kill_doc, 0},
 		{"core.shmmem", core_shmmem, core_shmmem_doc, 0},
+		{"core.mem_profile", core_mem_profile, core_mem_profile_doc,
+				RET_ARRAY},
+		{"core.route_profile", core_route_profile, core_route_profile_doc,
+				RET_ARRAY},
+		{"core.async_stats", core_async_stats, core_async_stats_doc,
+				RET_ARRAY},
+		{"core.latency_hist", core_latency_hist, core_latency_hist_doc,
+				RET_ARRAY},
+		{"core.modinit_stats", core_modinit_stats, core_modinit_stats_doc,
+				RET_ARRAY},
+		{"core.shm_defrag", core_shm_defrag, core_shm_defrag_doc, 0},
 #if defined(SF_MALLOC) || defined(LL_MALLOC)
 		{"core.sfmalloc", core_sfmalloc, core_sfmalloc_doc, 0},
 #endif
 		{"core.tcp_info", core_tcpinfo, core_tcpinfo_doc, 0},
+		{"core.tcp_drain", core_tcp_drain, core_tcp_drain_doc, 0},
 		{"core.tcp_options", core_tcp_options, core_tcp_options_doc, 0},
 		{"core.tcp_list", core_tcp_list, core_tcp_list_doc, RPC_RET_ARRAY},
 		{"core.udp4_raw_info", core_udp4rawinfo, core_udp4rawinfo_doc, 0},
@@ -83,6 +83,7 @@ static int grp_no = 0; /* number of groups */
 /** counters array. a[proc_no][counter_id] =>
   _cnst_vals[proc_no*cnts_no+counter_id] */
 counter_array_t *_cnts_vals = 0;
+static void *_cnts_vals_mem = 0;   /* unaligned shm block behind _cnts_vals */
 int _cnts_row_len = 0;			   /* number of elements per row */
 static unsigned short cnts_no = 0; /* number of registered counters */
 static int cnts_max_rows = 0;	   /* set to 0 if not yet fully init */
@@ -142,12 +143,13 @@ void destroy_counters()
 	struct str_hash_entry *bak;
 	if(_cnts_vals) {
 		if(cnts_max_rows)
-			/* fully init => it is in shm */
-			shm_free(_cnts_vals);
+			/* fully init => it is in shm (free the unaligned block) */
+			shm_free(_cnts_vals_mem);
 		else
 			/* partially init (before prefork) => pkg */
 			pkg_free(_cnts_vals);
 		_cnts_vals = 0;
+		_cnts_vals_mem = 0;
 	}
 	if(cnts_hash_table.table) {
 		for(r = 0; r < cnts_hash_table.size; r++) {
@@ -208,12 +210,20 @@ int counters_prefork_init(int max_process_no)
 	/* replace the temporary pre-fork pkg array (with only 1 row) with
 	   the final shm version (with max_process_no rows) */
 	old = _cnts_vals;
-	_cnts_vals = shm_malloc(size);
-	if(_cnts_vals == 0) {
+	/* over-allocate so that the first row can be aligned to CACHELINE_PAD:
+	   each row is a CACHELINE_PAD multiple, but shm_malloc() guarantees only
+	   a smaller alignment and a misaligned base would make neighbouring
+	   per-process stripes share a cacheline (false sharing between their
+	   owning processes) */
+	_cnts_vals_mem = shm_malloc(size + CACHELINE_PAD - 1);
+	if(_cnts_vals_mem == 0) {
 		SHM_MEM_ERROR;
 		return -1;
 	}
-	memset(_cnts_vals, 0, size);
+	memset(_cnts_vals_mem, 0, size + CACHELINE_PAD - 1);
+	_cnts_vals = (counter_array_t *)(((unsigned long)_cnts_vals_mem
+											 + CACHELINE_PAD - 1)
+									 & ~((unsigned long)(CACHELINE_PAD - 1)));
 	cnts_max_rows = max_process_no;
 	/* copy prefork values into the newly shm array */
 	if(old) {
@@ -636,6 +646,51 @@ counter_val_t counter_get_val(counter_handle_t handle)
 }
 
 
+/** take a snapshot of all the counter values.
+ * Sums each per-process stripe in a single sequential pass instead of one
+ * cross-stripe sweep per counter, so rpc/statistics readers listing many
+ * counters pull each (hot, written) stripe into their cache only once.
+ * Counters with read callbacks are resolved through the callback, like in
+ * counter_get_val().
+ * @param cnt_no - result parameter, filled with the number of entries.
+ * @return pkg allocated array indexed by counter id (pkg_free() when done)
+ *         or 0 on error.
+ */
+counter_val_t *counter_snapshot(int *cnt_no)
+{
+	counter_val_t *vals;
+	struct counter_record *cnt_rec;
+	counter_handle_t h;
+	int r;
+	int i;
+
+	*cnt_no = 0;
+	if(unlikely(_cnts_vals == 0 || cnt_id2record == 0 || cnts_max_rows == 0)) {
+		/* not init yet */
+		LM_BUG("counters not fully initialized yet\n");
+		return 0;
+	}
+	vals = pkg_malloc(sizeof(counter_val_t) * cnts_no);
+	if(vals == 0) {
+		PKG_MEM_ERROR;
+		return 0;
+	}
+	memset(vals, 0, sizeof(counter_val_t) * cnts_no);
+	for(r = 0; r < cnts_max_rows; r++)
+		for(i = 0; i < cnts_no; i++)
+			vals[i] += _cnts_vals[r * _cnts_row_len + i].v;
+	for(i = 0; i < cnts_no; i++) {
+		cnt_rec = cnt_id2record[i];
+		if(unlikely(cnt_rec && cnt_rec->cbk)) {
+			h.id = i;
+			vals[i] = cnt_rec->cbk(h, cnt_rec->cbk_param);
+		}
+	}
+	*cnt_no = cnts_no;
+	return vals;
+}
+
+
 /** reset the  counter.
  * Reset a counter, unless it has the CNT_F_NO_RESET flag set.
  * @param handle - counter handle obtained using counter_lookup() or
@@ -100,6 +100,9 @@ int counter_lookup_str(counter_handle_t *handle, str *group, str *name);
 void counter_reset(counter_handle_t handle);
 counter_val_t counter_get_val(counter_handle_t handle);
 counter_val_t counter_get_raw_val(counter_handle_t handle);
+/* pkg allocated array with the values of all counters, indexed by
+ * counter id - one pass over each per-process stripe (see counters.c) */
+counter_val_t *counter_snapshot(int *cnt_no);
 char *counter_get_name(counter_handle_t handle);
 char *counter_get_group(counter_handle_t handle);
 char *counter_get_doc(counter_handle_t handle);
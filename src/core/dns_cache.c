@@ -34,6 +34,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sched.h>
 
 #include "globals.h"
 #include "cfg_core.h"
@@ -51,6 +52,7 @@
 #include "error.h"
 #include "rpc.h"
 #include "rand/fastrand.h"
+#include "async_task.h"
 #ifdef USE_DNS_CACHE_STATS
 #include "pt.h"
 #endif
@@ -84,8 +86,43 @@ int dns_flags = 0; /* default flags used for the  dns_*resolvehost
 struct t_dns_cache_stats *dns_cache_stats = 0;
 #endif
 
-#define LOCK_DNS_HASH() lock_get(dns_hash_lock)
-#define UNLOCK_DNS_HASH() lock_release(dns_hash_lock)
+/* lock-free read side: a reader marks itself in a (hashed) per-process
+ * slot before walking the hash and clears it afterwards; writers raise
+ * dns_hash_writer under dns_hash_lock and wait for all the slots to drain
+ * => cache hits never take the lock, writers are serialized as before
+ * (readers arriving while a writer is active/waiting fall back to the
+ * locked lookup) */
+#define DNS_READERS_SLOTS 256 /* power of 2, >= no. of processes (more
+							   * processes only means slot sharing) */
+
+struct dns_reader_slot
+{
+	atomic_t cnt;
+	char pad[128 - sizeof(atomic_t)]; /* avoid false sharing */
+};
+
+static struct dns_reader_slot *dns_hash_readers = 0;
+static atomic_t *dns_hash_writer = 0;
+
+inline static void dns_hash_wrlock(void)
+{
+	int r;
+
+	lock_get(dns_hash_lock);
+	mb_atomic_set(dns_hash_writer, 1); /* must be visible before the scan */
+	for(r = 0; r < DNS_READERS_SLOTS; r++)
+		while(unlikely(atomic_get(&dns_hash_readers[r].cnt) != 0))
+			sched_yield(); /* read sections are very short */
+}
+
+inline static void dns_hash_wrunlock(void)
+{
+	atomic_set(dns_hash_writer, 0);
+	lock_release(dns_hash_lock);
+}
+
+#define LOCK_DNS_HASH() dns_hash_wrlock()
+#define UNLOCK_DNS_HASH() dns_hash_wrunlock()
 
 static int _dns_local_ttl = 0;
 
@@ -231,6 +268,14 @@ void destroy_dns_cache()
 		lock_dealloc(dns_hash_lock);
 		dns_hash_lock = 0;
 	}
+	if(dns_hash_readers) {
+		shm_free((void *)dns_hash_readers);
+		dns_hash_readers = 0;
+	}
+	if(dns_hash_writer) {
+		shm_free(dns_hash_writer);
+		dns_hash_writer = 0;
+	}
 	if(dns_hash) {
 		shm_free(dns_hash);
 		dns_hash = 0;
@@ -379,6 +424,23 @@ int init_dns_cache()
 		goto error;
 	}
 
+	dns_hash_readers =
+			shm_malloc(sizeof(struct dns_reader_slot) * DNS_READERS_SLOTS);
+	if(dns_hash_readers == 0) {
+		SHM_MEM_ERROR;
+		ret = E_OUT_OF_MEM;
+		goto error;
+	}
+	memset((void *)dns_hash_readers, 0,
+			sizeof(struct dns_reader_slot) * DNS_READERS_SLOTS);
+	dns_hash_writer = shm_malloc(sizeof(atomic_t));
+	if(dns_hash_writer == 0) {
+		SHM_MEM_ERROR;
+		ret = E_OUT_OF_MEM;
+		goto error;
+	}
+	atomic_set(dns_hash_writer, 0);
+
 #ifdef DNS_WATCHDOG_SUPPORT
 	dns_servers_up = shm_malloc(sizeof(atomic_t));
 	if(dns_servers_up == 0) {
@@ -545,6 +607,7 @@ again:
 		} else if((e->type == type) && (e->name_len == name->len)
 				  && (strncasecmp(e->name, name->s, e->name_len) == 0)) {
 			e->last_used = now;
+			e->lu_ref = 1;
 			/* add it at the end */
 			debug_lu_lst("_dns_hash_find: pre rm:", &e->last_used_lst);
 			clist_rm(&e->last_used_lst, next, prev);
@@ -558,6 +621,7 @@ again:
 			/*if CNAME matches and CNAME is entry is not a neg. cache entry
 			  (could be produced by a specific CNAME lookup)*/
 			e->last_used = now;
+			e->lu_ref = 1;
 			/* add it at the end */
 			debug_lu_lst("_dns_hash_find: cname: pre rm:", &e->last_used_lst);
 			clist_rm(&e->last_used_lst, next, prev);
@@ -587,6 +651,89 @@ again:
 }
 
 
+/* read-only version of _dns_hash_find(), usable from the lock-free read
+ * side (see dns_hash_get()): it does not remove expired entries (they are
+ * skipped and left to the timer/locked paths) and does not re-order the
+ * last used list - it only updates the last_used timestamp and the lu_ref
+ * eviction hint (racy, but benign plain stores)
+ * same return conventions as _dns_hash_find() */
+inline static struct dns_hash_entry *_dns_hash_find_ro(
+		str *name, int type, int *h, int *err)
+{
+	struct dns_hash_entry *e;
+	struct dns_hash_entry *ret;
+	ticks_t now;
+	int cname_chain;
+	str cname;
+#ifdef DNS_WATCHDOG_SUPPORT
+	int servers_up;
+
+	servers_up = atomic_get(dns_servers_up);
+#endif
+
+	cname_chain = 0;
+	ret = 0;
+	now = get_ticks_raw();
+	*err = 0;
+
+	/* just in case that e.g. the VIA parser get confused */
+	if(unlikely(!name->s || name->len <= 0)) {
+		LM_ERR("invalid name, no cache lookup possible\n");
+		*err = -1;
+		return 0;
+	}
+again:
+	*h = dns_hash_no(name->s, name->len, type);
+	LM_DBG("(%.*s(%d), %d), h=%d\n", name->len, name->s, name->len, type, *h);
+	clist_foreach(&dns_hash[*h], e, next)
+	{
+		if(
+#ifdef DNS_WATCHDOG_SUPPORT
+				/* when the dns servers are down expired entries are
+				 * still used (no chance to refresh them) */
+				servers_up &&
+#endif
+				((e->ent_flags & DNS_FLAG_PERMANENT) == 0)
+				&& ((s_ticks_t)(now - e->expire) >= 0)) {
+			/* expired - pretend a miss, the timer or a locked operation
+			 * will remove it */
+			continue;
+		} else if((e->type == type) && (e->name_len == name->len)
+				  && (strncasecmp(e->name, name->s, e->name_len) == 0)) {
+			e->last_used = now;
+			e->lu_ref = 1;
+			return e;
+		} else if((e->type == T_CNAME)
+				  && !((e->rr_lst == 0) || (e->ent_flags & DNS_FLAG_BAD_NAME))
+				  && (e->name_len == name->len)
+				  && (strncasecmp(e->name, name->s, e->name_len) == 0)) {
+			/*if CNAME matches and CNAME is entry is not a neg. cache entry
+			  (could be produced by a specific CNAME lookup)*/
+			e->last_used = now;
+			e->lu_ref = 1;
+			ret = e; /* if this is an unfinished cname chain, we try to
+					  return the last cname */
+			/* this is a cname => retry using its value */
+			if(cname_chain > MAX_CNAME_CHAIN) {
+				LM_ERR("cname chain too long or recursive (\"%.*s\")\n",
+						name->len, name->s);
+				ret = 0; /* error*/
+				*err = -1;
+				break;
+			}
+			cname_chain++;
+			cname.s = ((struct cname_rdata *)e->rr_lst->rdata)->name;
+			cname.len = ((struct cname_rdata *)e->rr_lst->rdata)->name_len;
+			if(cname.s != NULL && cname.len > 0) {
+				name = &cname;
+				goto again;
+			}
+		}
+	}
+	return ret;
+}
+
+
 /* frees cache entries, if expired_only=0 only expired entries will be
  * removed, else all of them
  * it will process maximum no entries (to process all of them use -1)
@@ -634,10 +781,12 @@ inline static int dns_cache_free_mem(unsigned int target, int expired_only)
 	struct dns_hash_entry *e;
 	ticks_t now;
 	unsigned int deleted;
+	unsigned int chances;
 	struct dns_lu_lst *l;
 	struct dns_lu_lst *tmp;
 
 	deleted = 0;
+	chances = 4096; /* bound the number of 2nd chances per scan */
 	now = get_ticks_raw();
 	LOCK_DNS_HASH();
 	clist_foreach_safe(dns_last_used_lst, l, tmp, next)
@@ -649,6 +798,17 @@ inline static int dns_cache_free_mem(unsigned int target, int expired_only)
 												->last_used_lst);
 		if(((e->ent_flags & DNS_FLAG_PERMANENT) == 0)
 				&& (!expired_only || ((s_ticks_t)(now - e->expire) >= 0))) {
+			if(e->lu_ref && ((s_ticks_t)(now - e->expire) < 0)
+					&& chances != 0) {
+				/* used since the last scan - lock-free lookups don't
+				 * re-order the lru list => give it a 2nd chance and
+				 * re-append it at the end */
+				e->lu_ref = 0;
+				chances--;
+				clist_rm(l, next, prev);
+				clist_append(dns_last_used_lst, l, next, prev);
+				continue;
+			}
 			_dns_hash_remove(e);
 			deleted++;
 		}
@@ -669,13 +829,30 @@ inline static struct dns_hash_entry *dns_hash_get(
 		str *name, int type, int *h, int *err)
 {
 	struct dns_hash_entry *e;
-
-	LOCK_DNS_HASH();
-	e = _dns_hash_find(name, type, h, err);
+	atomic_t *rd;
+
+	rd = &dns_hash_readers[process_no & (DNS_READERS_SLOTS - 1)].cnt;
+	mb_atomic_inc(rd); /* the slot must be visible to writers before the
+						* writer flag check (and the hash walk) */
+	if(unlikely(atomic_get(dns_hash_writer) != 0)) {
+		/* a writer is active or waiting - back off and use the locked
+		 * lookup (rare: writers run only on misses & maintenance) */
+		atomic_dec(rd);
+		LOCK_DNS_HASH();
+		e = _dns_hash_find(name, type, h, err);
+		if(e) {
+			atomic_inc(&e->refcnt);
+		}
+		UNLOCK_DNS_HASH();
+		return e;
+	}
+	e = _dns_hash_find_ro(name, type, h, err);
 	if(e) {
+		/* linked entries always hold a hash reference => the refcnt
+		 * cannot drop to 0 while the entry is still reachable */
 		atomic_inc(&e->refcnt);
 	}
-	UNLOCK_DNS_HASH();
+	mb_atomic_dec(rd);
 	return e;
 }
 
@@ -2056,12 +2233,69 @@ end:
  *  a dns request
  *  return: 0 on error, pointer to a dns_hash_entry on success
  *  WARNING: when not needed anymore dns_hash_put() must be called! */
+/* parameter block of a refresh-ahead task (the name is appended) */
+typedef struct dns_cache_refresh_param
+{
+	str name;
+	int type;
+} dns_cache_refresh_param_t;
+
+
+/* async task callback: re-resolve a name before its cached entry expires;
+ * dns_cache_do_request() adds the new records to the hash, so they take
+ * over seamlessly when the old entry expires and is removed */
+static void dns_cache_refresh_task(void *param)
+{
+	dns_cache_refresh_param_t *p;
+	struct dns_hash_entry *e;
+
+	p = (dns_cache_refresh_param_t *)param;
+	LM_DBG("refreshing %.*s (%d)\n", p->name.len, p->name.s, p->type);
+	e = dns_cache_do_request(&p->name, p->type);
+	if(e)
+		dns_hash_put(e);
+	/* param is freed along with the async task structure in core */
+}
+
+
+/* schedule a background re-resolve for an entry close to its expiry - at
+ * most once per entry (so a burst of lookups pushes a single task) */
+static void dns_cache_schedule_refresh(struct dns_hash_entry *e)
+{
+	async_task_t *at;
+	dns_cache_refresh_param_t *p;
+	int dsize;
+
+	if(atomic_get_and_set(&e->refreshing, 1) != 0)
+		return; /* somebody else was faster */
+	dsize = sizeof(async_task_t) + sizeof(dns_cache_refresh_param_t)
+			+ e->name_len + 1;
+	at = (async_task_t *)shm_malloc(dsize);
+	if(at == NULL) {
+		SHM_MEM_ERROR;
+		return;
+	}
+	memset(at, 0, dsize);
+	at->exec = dns_cache_refresh_task;
+	at->param = (char *)at + sizeof(async_task_t);
+	p = (dns_cache_refresh_param_t *)at->param;
+	p->type = e->type;
+	p->name.s = (char *)p + sizeof(dns_cache_refresh_param_t);
+	p->name.len = e->name_len;
+	memcpy(p->name.s, e->name, e->name_len); /* memset 0-terminated it */
+	if(async_task_push(at) < 0)
+		shm_free(at);
+	/* on failure the flag stays set - no retry storm on a dead queue */
+}
+
+
 inline static struct dns_hash_entry *dns_get_entry(str *name, int type)
 {
 	int h;
 	struct dns_hash_entry *e;
 	str cname_val;
 	int err;
+	unsigned int refresh_s;
 	static int rec_cnt = 0; /* recursion protection */
 
 	e = 0;
@@ -2104,6 +2338,17 @@ inline static struct dns_hash_entry *dns_get_entry(str *name, int type)
 		/* negative cache => not resolvable */
 		dns_hash_put(e);
 		e = 0;
+	} else {
+		/* refresh-ahead: re-resolve popular entries in the background
+		 * before they expire, so the hot path never blocks on dns */
+		refresh_s = cfg_get(core, core_cfg, dns_cache_refresh);
+		if(unlikely(refresh_s != 0)
+				&& ((e->ent_flags & DNS_FLAG_PERMANENT) == 0)
+				&& ((s_ticks_t)(e->expire - get_ticks_raw())
+						< (s_ticks_t)S_TO_TICKS((ticks_t)refresh_s))
+				&& (atomic_get(&e->refreshing) == 0)
+				&& async_task_initialized())
+			dns_cache_schedule_refresh(e);
 	}
 error:
 	rec_cnt--;
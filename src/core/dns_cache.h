@@ -148,11 +148,16 @@ struct dns_hash_entry
 	struct dns_lu_lst last_used_lst;
 	struct dns_rr *rr_lst;
 	atomic_t refcnt;
+	atomic_t refreshing; /* a background refresh-ahead re-resolve was
+						  * already scheduled for this entry */
 	ticks_t last_used;
 	ticks_t expire; /* when the whole entry will expire */
 	int total_size;
 	unsigned short type;
 	unsigned char ent_flags; /* entry flags: unresolvable/permanent */
+	volatile unsigned char lu_ref; /* used since the last eviction scan -
+									* set lockless by readers, gives the
+									* entry a 2nd chance on eviction */
 	unsigned char name_len;	 /* can be maximum 255 bytes */
 	char name[1];			 /* variable length, name, null terminated
 	                 (actual length = name_len +1)*/
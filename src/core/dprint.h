@@ -176,6 +176,15 @@ extern km_log_f _km_log_func;
 
 void km_log_func_set(km_log_f f);
 
+/** @brief non-zero if the log messages are written asynchronously via
+ * per-process ring buffers drained by a dedicated log writer process
+ * (syslog mode only - see dprint_async.c) */
+extern int ksr_log_async;
+
+int ksr_log_async_init(void);
+int ksr_log_async_prefork_init(int max_processes);
+int ksr_log_async_start(void);
+
 /** @brief maps log levels to their string name and corresponding syslog level */
 
 struct log_level_info
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2025 Daniel-Constantin Mierla (asipto.com)
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * @file
+ * @brief Kamailio core :: Asynchronous logging backend
+ * @ingroup core
+ * Module: @ref core
+ *
+ * When the log_async core setting is enabled (and logging goes to syslog),
+ * each process formats its log messages into its own shared memory ring
+ * buffer instead of calling syslog() in the message processing path. A
+ * dedicated log writer process drains all the rings and does the actual
+ * syslog() calls. Each ring has a single producer (the owning process) and
+ * a single consumer (the log writer), so no locking is needed - only write
+ * memory barriers when publishing. If a ring is full the message is dropped
+ * and counted; the drops are reported by the log writer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <syslog.h>
+
+#include "dprint.h"
+#include "globals.h"
+#include "pt.h"
+#include "sr_module.h"
+#include "ut.h"
+#include "atomic_ops.h"
+#include "mem/shm_mem.h"
+#include "cfg/cfg_struct.h"
+
+/* maximum size of one formatted log message (longer ones are truncated) */
+#define KSR_LOG_ASYNC_MSG_SIZE 256
+/* number of message slots per process ring - must be a power of two */
+#define KSR_LOG_ASYNC_SLOTS 256
+
+/* how long the log writer sleeps when all the rings are empty (microsecs) */
+#define KSR_LOG_ASYNC_IDLE_US 10000
+
+int ksr_log_async = 0;
+
+typedef struct ksr_log_async_slot
+{
+	int prio;		  /* syslog priority */
+	unsigned int len; /* message length */
+	char buf[KSR_LOG_ASYNC_MSG_SIZE];
+} ksr_log_async_slot_t;
+
+typedef struct ksr_log_async_ring
+{
+	volatile unsigned int head; /* next slot to fill - owner process only */
+	volatile unsigned int tail; /* next slot to drain - log writer only */
+	unsigned long dropped;		/* messages dropped on full ring - owner */
+	unsigned long reported;		/* drops already reported - log writer */
+	ksr_log_async_slot_t slot[KSR_LOG_ASYNC_SLOTS];
+} ksr_log_async_ring_t;
+
+static ksr_log_async_ring_t *_ksr_log_async_rings = NULL;
+static int _ksr_log_async_procs = 0;
+
+/**
+ * drop-in replacement for syslog() - formats into the process own ring
+ */
+static void ksr_log_async_write(int prio, const char *fmt, ...)
+{
+	ksr_log_async_ring_t *ring;
+	ksr_log_async_slot_t *slot;
+	va_list ap;
+	int n;
+
+	if(unlikely(_ksr_log_async_rings == NULL || process_no < 0
+				|| process_no >= _ksr_log_async_procs)) {
+		/* not initialized (yet) for this process - log directly */
+		va_start(ap, fmt);
+		vsyslog(prio, fmt, ap);
+		va_end(ap);
+		return;
+	}
+	ring = &_ksr_log_async_rings[process_no];
+	if(ring->head - ring->tail >= KSR_LOG_ASYNC_SLOTS) {
+		/* full ring - drop the message rather than block the worker */
+		ring->dropped++;
+		return;
+	}
+	slot = &ring->slot[ring->head % KSR_LOG_ASYNC_SLOTS];
+	va_start(ap, fmt);
+	n = vsnprintf(slot->buf, KSR_LOG_ASYNC_MSG_SIZE, fmt, ap);
+	va_end(ap);
+	if(n < 0)
+		return;
+	if(n >= KSR_LOG_ASYNC_MSG_SIZE)
+		n = KSR_LOG_ASYNC_MSG_SIZE - 1;
+	slot->len = n;
+	slot->prio = prio;
+	membar_write(); /* the slot must be visible before publishing it */
+	ring->head++;
+}
+
+/**
+ * register the log writer process - to be called before the processes
+ * are counted (same stage as async_task_init())
+ */
+int ksr_log_async_init(void)
+{
+	if(!ksr_log_async)
+		return 0;
+	if(log_stderr) {
+		LM_WARN("async logging works only with syslog - disabling\n");
+		ksr_log_async = 0;
+		return 0;
+	}
+	/* advertise the log writer process to core and cfg framework */
+	register_procs(1);
+	cfg_register_child(1);
+	return 0;
+}
+
+/**
+ * allocate the per-process rings and switch the log callback - to be
+ * called before forking, when the number of processes is known
+ */
+int ksr_log_async_prefork_init(int max_processes)
+{
+	if(!ksr_log_async)
+		return 0;
+	_ksr_log_async_rings = shm_malloc(
+			sizeof(ksr_log_async_ring_t) * max_processes);
+	if(_ksr_log_async_rings == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_ksr_log_async_rings, 0,
+			sizeof(ksr_log_async_ring_t) * max_processes);
+	_ksr_log_async_procs = max_processes;
+	km_log_func_set(ksr_log_async_write);
+	LM_DBG("async logging rings initialized (%d processes)\n", max_processes);
+	return 0;
+}
+
+/**
+ * main loop of the log writer process - drains all the rings
+ */
+static void ksr_log_async_main(void)
+{
+	ksr_log_async_ring_t *ring;
+	ksr_log_async_slot_t *slot;
+	unsigned long dropped;
+	int busy;
+	int i;
+
+	for(;;) {
+		/* update the local cfg if needed */
+		cfg_update();
+
+		busy = 0;
+		for(i = 0; i < _ksr_log_async_procs; i++) {
+			ring = &_ksr_log_async_rings[i];
+			while(ring->tail != ring->head) {
+				membar_read(); /* pairs with the producer membar_write() */
+				slot = &ring->slot[ring->tail % KSR_LOG_ASYNC_SLOTS];
+				syslog(slot->prio, "%.*s", (int)slot->len, slot->buf);
+				ring->tail++;
+				busy = 1;
+			}
+			dropped = ring->dropped;
+			if(unlikely(dropped != ring->reported)) {
+				syslog(LOG_WARNING,
+						"WARNING: async log: %lu message(s) from process %d"
+						" dropped on full ring\n",
+						dropped - ring->reported, i);
+				ring->reported = dropped;
+			}
+		}
+		if(!busy)
+			sleep_us(KSR_LOG_ASYNC_IDLE_US);
+	}
+}
+
+/**
+ * fork the log writer process - to be called from the main process after
+ * the timer processes are forked
+ */
+int ksr_log_async_start(void)
+{
+	int pid;
+
+	if(!ksr_log_async || _ksr_log_async_rings == NULL)
+		return 0;
+
+	pid = fork_process(PROC_RPC, "log writer", 1);
+	if(pid < 0) {
+		LM_CRIT("cannot fork log writer process\n");
+		return -1;
+	}
+	if(pid == 0) {
+		/* child */
+		/* initialize the config framework */
+		if(cfg_child_init())
+			return -1;
+		ksr_log_async_main(); /* never returns */
+	}
+	return 0;
+}
@@ -62,8 +62,50 @@
 /*
  * Where we store URIs of additional transaction branches
  * (sr_dst_max_branches - 1 : because of the default branch for r-uri, #0 in tm)
+ * - allocated per process in chunks, on demand: a branch_t is a few KB of
+ *   uri/path/... buffers and most messages use only a couple of branches,
+ *   so the full pool is populated only when serial/parallel forking really
+ *   needs it; chunk addresses are stable (no realloc), so branch pointers
+ *   handed out earlier stay valid when the pool grows
  */
-static branch_t *_ksr_branches = NULL;
+#define KSR_BRANCHES_CHUNK 8 /* branches per pool chunk */
+
+static branch_t **_ksr_branches_pool = NULL; /* chunk pointers */
+static branch_t *_ksr_branches_c0 = NULL;	 /* first chunk - fast path */
+static unsigned int _ksr_branches_avail = 0; /* allocated branch slots */
+
+/* grow the pool so that at least n branch slots are allocated */
+static int ksr_branches_reserve(unsigned int n)
+{
+	unsigned int c;
+
+	if(unlikely(n > sr_dst_max_branches - 1))
+		return -1;
+	while(_ksr_branches_avail < n) {
+		c = _ksr_branches_avail / KSR_BRANCHES_CHUNK;
+		_ksr_branches_pool[c] =
+				(branch_t *)pkg_malloc(KSR_BRANCHES_CHUNK * sizeof(branch_t));
+		if(_ksr_branches_pool[c] == NULL) {
+			PKG_MEM_ERROR;
+			return -1;
+		}
+		memset(_ksr_branches_pool[c], 0,
+				KSR_BRANCHES_CHUNK * sizeof(branch_t));
+		_ksr_branches_avail += KSR_BRANCHES_CHUNK;
+	}
+	return 0;
+}
+
+/* pointer to the branch slot idx (the slot must have been reserved) */
+static inline branch_t *ksr_branch_ptr(unsigned int idx)
+{
+	if(likely(idx < KSR_BRANCHES_CHUNK))
+		return &_ksr_branches_c0[idx];
+	return &_ksr_branches_pool[idx / KSR_BRANCHES_CHUNK]
+							  [idx % KSR_BRANCHES_CHUNK];
+}
+
+#define ksr_branch(idx) (*ksr_branch_ptr(idx))
 
 /* how many of them we have */
 unsigned int nr_branches = 0;
@@ -90,6 +132,8 @@ str _ksr_contact_salias = str_init(";alias=");
  */
 int init_dst_set(void)
 {
+	unsigned int nchunks;
+
 	if(sr_dst_max_branches <= 0 || sr_dst_max_branches >= MAX_BRANCHES_LIMIT) {
 		LM_ERR("invalid value for max branches parameter: %u, maximum value: "
 			   "%u\n",
@@ -97,13 +141,21 @@ int init_dst_set(void)
 		return -1;
 	}
 	/* sr_dst_max_branches - 1 : because of the default branch for r-uri, #0 in tm */
-	_ksr_branches = (branch_t *)pkg_malloc(
-			(sr_dst_max_branches - 1) * sizeof(branch_t));
-	if(_ksr_branches == NULL) {
+	nchunks = (sr_dst_max_branches - 1 + KSR_BRANCHES_CHUNK - 1)
+			  / KSR_BRANCHES_CHUNK;
+	_ksr_branches_pool = (branch_t **)pkg_malloc(nchunks * sizeof(branch_t *));
+	if(_ksr_branches_pool == NULL) {
 		PKG_MEM_ERROR;
 		return -1;
 	}
-	memset(_ksr_branches, 0, (sr_dst_max_branches - 1) * sizeof(branch_t));
+	memset(_ksr_branches_pool, 0, nchunks * sizeof(branch_t *));
+	/* keep only the first chunk around by default */
+	if(ksr_branches_reserve((sr_dst_max_branches - 1 < KSR_BRANCHES_CHUNK)
+									? sr_dst_max_branches - 1
+									: KSR_BRANCHES_CHUNK)
+			< 0)
+		return -1;
+	_ksr_branches_c0 = _ksr_branches_pool[0];
 	return 0;
 }
 
@@ -127,11 +179,11 @@ branch_t *get_sip_branch(int idx)
 		return NULL;
 	if(idx < 0) {
 		if((int)nr_branches + idx >= 0)
-			return &_ksr_branches[nr_branches + idx];
+			return &ksr_branch(nr_branches + idx);
 		return NULL;
 	}
 	if(idx < nr_branches)
-		return &_ksr_branches[idx];
+		return &ksr_branch(idx);
 	return 0;
 }
 
@@ -140,6 +192,8 @@ branch_t *get_sip_branch(int idx)
  */
 int get_all_sip_branches(branch_t **vbranches, unsigned int *nbranches)
 {
+	unsigned int i;
+
 	if(nr_branches == 0) {
 		*vbranches = NULL;
 		*nbranches = 0;
@@ -151,7 +205,8 @@ int get_all_sip_branches(branch_t **vbranches, unsigned int *nbranches)
 		PKG_MEM_ERROR;
 		return -1;
 	}
-	memcpy(*vbranches, _ksr_branches, nr_branches * sizeof(branch_t));
+	for(i = 0; i < nr_branches; i++)
+		memcpy(&(*vbranches)[i], &ksr_branch(i), sizeof(branch_t));
 	*nbranches = nr_branches;
 
 	return 0;
@@ -162,12 +217,17 @@ int get_all_sip_branches(branch_t **vbranches, unsigned int *nbranches)
  */
 int set_all_sip_branches(branch_t *vbranches, unsigned int nbranches)
 {
+	unsigned int i;
+
 	if(nbranches == 0) {
 		nr_branches = 0;
 		return 0;
 	}
 
-	memcpy(_ksr_branches, vbranches, nbranches * sizeof(branch_t));
+	if(ksr_branches_reserve(nbranches) < 0)
+		return -1;
+	for(i = 0; i < nbranches; i++)
+		memcpy(&ksr_branch(i), &vbranches[i], sizeof(branch_t));
 	nr_branches = nbranches;
 
 	return 0;
@@ -194,7 +254,7 @@ int drop_sip_branch(int idx)
 	}
 	/* shift back one position */
 	for(; idx < nr_branches - 1; idx++)
-		memcpy(&_ksr_branches[idx], &_ksr_branches[idx + 1], sizeof(branch_t));
+		memcpy(&ksr_branch(idx), &ksr_branch(idx + 1), sizeof(branch_t));
 	nr_branches--;
 	return 0;
 }
@@ -204,7 +264,7 @@ static inline flag_t *get_bflags_ptr(unsigned int branch)
 	if(branch == 0)
 		return &ruri_bflags;
 	if(branch - 1 < nr_branches)
-		return &_ksr_branches[branch - 1].flags;
+		return &ksr_branch(branch - 1).flags;
 	return NULL;
 }
 
@@ -300,34 +360,34 @@ char *get_branch(unsigned int i, int *len, qvalue_t *q, str *dst_uri, str *path,
 		str *instance, str *location_ua)
 {
 	if(i < nr_branches) {
-		*len = _ksr_branches[i].len;
-		*q = _ksr_branches[i].q;
+		*len = ksr_branch(i).len;
+		*q = ksr_branch(i).q;
 		if(dst_uri) {
-			dst_uri->len = _ksr_branches[i].dst_uri_len;
-			dst_uri->s = (dst_uri->len) ? _ksr_branches[i].dst_uri : 0;
+			dst_uri->len = ksr_branch(i).dst_uri_len;
+			dst_uri->s = (dst_uri->len) ? ksr_branch(i).dst_uri : 0;
 		}
 		if(path) {
-			path->len = _ksr_branches[i].path_len;
-			path->s = (path->len) ? _ksr_branches[i].path : 0;
+			path->len = ksr_branch(i).path_len;
+			path->s = (path->len) ? ksr_branch(i).path : 0;
 		}
 		if(force_socket)
-			*force_socket = _ksr_branches[i].force_send_socket;
+			*force_socket = ksr_branch(i).force_send_socket;
 		if(flags)
-			*flags = _ksr_branches[i].flags;
+			*flags = ksr_branch(i).flags;
 		if(ruid) {
-			ruid->len = _ksr_branches[i].ruid_len;
-			ruid->s = (ruid->len) ? _ksr_branches[i].ruid : 0;
+			ruid->len = ksr_branch(i).ruid_len;
+			ruid->s = (ruid->len) ? ksr_branch(i).ruid : 0;
 		}
 		if(instance) {
-			instance->len = _ksr_branches[i].instance_len;
-			instance->s = (instance->len) ? _ksr_branches[i].instance : 0;
+			instance->len = ksr_branch(i).instance_len;
+			instance->s = (instance->len) ? ksr_branch(i).instance : 0;
 		}
 		if(location_ua) {
-			location_ua->len = _ksr_branches[i].location_ua_len;
+			location_ua->len = ksr_branch(i).location_ua_len;
 			location_ua->s =
-					(location_ua->len) ? _ksr_branches[i].location_ua : 0;
+					(location_ua->len) ? ksr_branch(i).location_ua : 0;
 		}
-		return _ksr_branches[i].uri;
+		return ksr_branch(i).uri;
 	} else {
 		*len = 0;
 		*q = Q_UNSPECIFIED;
@@ -388,32 +448,32 @@ int get_branch_data(unsigned int i, branch_data_t *vbranch)
 	memset(vbranch, 0, sizeof(branch_data_t));
 
 	if(i < nr_branches) {
-		vbranch->uri.s = _ksr_branches[i].uri;
-		vbranch->uri.len = _ksr_branches[i].len;
-		vbranch->q = _ksr_branches[i].q;
-		if(_ksr_branches[i].dst_uri_len > 0) {
-			vbranch->dst_uri.len = _ksr_branches[i].dst_uri_len;
-			vbranch->dst_uri.s = _ksr_branches[i].dst_uri;
+		vbranch->uri.s = ksr_branch(i).uri;
+		vbranch->uri.len = ksr_branch(i).len;
+		vbranch->q = ksr_branch(i).q;
+		if(ksr_branch(i).dst_uri_len > 0) {
+			vbranch->dst_uri.len = ksr_branch(i).dst_uri_len;
+			vbranch->dst_uri.s = ksr_branch(i).dst_uri;
 		}
-		if(_ksr_branches[i].path_len > 0) {
-			vbranch->path.len = _ksr_branches[i].path_len;
-			vbranch->path.s = _ksr_branches[i].path;
+		if(ksr_branch(i).path_len > 0) {
+			vbranch->path.len = ksr_branch(i).path_len;
+			vbranch->path.s = ksr_branch(i).path;
 		}
-		vbranch->force_socket = _ksr_branches[i].force_send_socket;
-		vbranch->flags = _ksr_branches[i].flags;
-		if(_ksr_branches[i].ruid_len > 0) {
-			vbranch->ruid.len = _ksr_branches[i].ruid_len;
-			vbranch->ruid.s = _ksr_branches[i].ruid;
+		vbranch->force_socket = ksr_branch(i).force_send_socket;
+		vbranch->flags = ksr_branch(i).flags;
+		if(ksr_branch(i).ruid_len > 0) {
+			vbranch->ruid.len = ksr_branch(i).ruid_len;
+			vbranch->ruid.s = ksr_branch(i).ruid;
 		}
-		if(_ksr_branches[i].instance_len > 0) {
-			vbranch->instance.len = _ksr_branches[i].instance_len;
-			vbranch->instance.s = _ksr_branches[i].instance;
+		if(ksr_branch(i).instance_len > 0) {
+			vbranch->instance.len = ksr_branch(i).instance_len;
+			vbranch->instance.s = ksr_branch(i).instance;
 		}
-		if(_ksr_branches[i].location_ua_len > 0) {
-			vbranch->location_ua.len = _ksr_branches[i].location_ua_len;
-			vbranch->location_ua.s = _ksr_branches[i].location_ua;
+		if(ksr_branch(i).location_ua_len > 0) {
+			vbranch->location_ua.len = ksr_branch(i).location_ua_len;
+			vbranch->location_ua.s = ksr_branch(i).location_ua;
 		}
-		vbranch->otcpid = _ksr_branches[i].otcpid;
+		vbranch->otcpid = ksr_branch(i).otcpid;
 		return 1;
 	} else {
 		vbranch->q = Q_UNSPECIFIED;
@@ -479,6 +539,13 @@ int append_branch(struct sip_msg *msg, str *uri, str *dst_uri, str *path,
 		return -1;
 	}
 
+	/* grow the branch pool if this is the first time we get this deep */
+	if(unlikely(nr_branches >= _ksr_branches_avail)
+			&& ksr_branches_reserve(nr_branches + 1) < 0) {
+		ser_error = E_OUT_OF_MEM;
+		return -1;
+	}
+
 	/* if not parameterized, take current uri */
 	if(uri == 0 || uri->len == 0 || uri->s == 0) {
 		if(msg == NULL) {
@@ -505,12 +572,12 @@ int append_branch(struct sip_msg *msg, str *uri, str *dst_uri, str *path,
 			LM_ERR("too long dst_uri: %.*s\n", dst_uri->len, dst_uri->s);
 			return -1;
 		}
-		memcpy(_ksr_branches[nr_branches].dst_uri, dst_uri->s, dst_uri->len);
-		_ksr_branches[nr_branches].dst_uri[dst_uri->len] = 0;
-		_ksr_branches[nr_branches].dst_uri_len = dst_uri->len;
+		memcpy(ksr_branch(nr_branches).dst_uri, dst_uri->s, dst_uri->len);
+		ksr_branch(nr_branches).dst_uri[dst_uri->len] = 0;
+		ksr_branch(nr_branches).dst_uri_len = dst_uri->len;
 	} else {
-		_ksr_branches[nr_branches].dst_uri[0] = '\0';
-		_ksr_branches[nr_branches].dst_uri_len = 0;
+		ksr_branch(nr_branches).dst_uri[0] = '\0';
+		ksr_branch(nr_branches).dst_uri_len = 0;
 	}
 
 	/* copy the path string */
@@ -519,22 +586,22 @@ int append_branch(struct sip_msg *msg, str *uri, str *dst_uri, str *path,
 			LM_ERR("too long path: %.*s\n", path->len, path->s);
 			return -1;
 		}
-		memcpy(_ksr_branches[nr_branches].path, path->s, path->len);
-		_ksr_branches[nr_branches].path[path->len] = 0;
-		_ksr_branches[nr_branches].path_len = path->len;
+		memcpy(ksr_branch(nr_branches).path, path->s, path->len);
+		ksr_branch(nr_branches).path[path->len] = 0;
+		ksr_branch(nr_branches).path_len = path->len;
 	} else {
-		_ksr_branches[nr_branches].path[0] = '\0';
-		_ksr_branches[nr_branches].path_len = 0;
+		ksr_branch(nr_branches).path[0] = '\0';
+		ksr_branch(nr_branches).path_len = 0;
 	}
 
 	/* copy the ruri */
-	memcpy(_ksr_branches[nr_branches].uri, luri.s, luri.len);
-	_ksr_branches[nr_branches].uri[luri.len] = 0;
-	_ksr_branches[nr_branches].len = luri.len;
-	_ksr_branches[nr_branches].q = q;
+	memcpy(ksr_branch(nr_branches).uri, luri.s, luri.len);
+	ksr_branch(nr_branches).uri[luri.len] = 0;
+	ksr_branch(nr_branches).len = luri.len;
+	ksr_branch(nr_branches).q = q;
 
-	_ksr_branches[nr_branches].force_send_socket = force_socket;
-	_ksr_branches[nr_branches].flags = flags;
+	ksr_branch(nr_branches).force_send_socket = force_socket;
+	ksr_branch(nr_branches).flags = flags;
 
 	/* copy instance string */
 	if(unlikely(instance && instance->len && instance->s)) {
@@ -542,16 +609,16 @@ int append_branch(struct sip_msg *msg, str *uri, str *dst_uri, str *path,
 			LM_ERR("too long instance: %.*s\n", instance->len, instance->s);
 			return -1;
 		}
-		memcpy(_ksr_branches[nr_branches].instance, instance->s, instance->len);
-		_ksr_branches[nr_branches].instance[instance->len] = 0;
-		_ksr_branches[nr_branches].instance_len = instance->len;
+		memcpy(ksr_branch(nr_branches).instance, instance->s, instance->len);
+		ksr_branch(nr_branches).instance[instance->len] = 0;
+		ksr_branch(nr_branches).instance_len = instance->len;
 	} else {
-		_ksr_branches[nr_branches].instance[0] = '\0';
-		_ksr_branches[nr_branches].instance_len = 0;
+		ksr_branch(nr_branches).instance[0] = '\0';
+		ksr_branch(nr_branches).instance_len = 0;
 	}
 
 	/* copy reg_id */
-	_ksr_branches[nr_branches].reg_id = reg_id;
+	ksr_branch(nr_branches).reg_id = reg_id;
 
 	/* copy ruid string */
 	if(unlikely(ruid && ruid->len && ruid->s)) {
@@ -559,12 +626,12 @@ int append_branch(struct sip_msg *msg, str *uri, str *dst_uri, str *path,
 			LM_ERR("too long ruid: %.*s\n", ruid->len, ruid->s);
 			return -1;
 		}
-		memcpy(_ksr_branches[nr_branches].ruid, ruid->s, ruid->len);
-		_ksr_branches[nr_branches].ruid[ruid->len] = 0;
-		_ksr_branches[nr_branches].ruid_len = ruid->len;
+		memcpy(ksr_branch(nr_branches).ruid, ruid->s, ruid->len);
+		ksr_branch(nr_branches).ruid[ruid->len] = 0;
+		ksr_branch(nr_branches).ruid_len = ruid->len;
 	} else {
-		_ksr_branches[nr_branches].ruid[0] = '\0';
-		_ksr_branches[nr_branches].ruid_len = 0;
+		ksr_branch(nr_branches).ruid[0] = '\0';
+		ksr_branch(nr_branches).ruid_len = 0;
 	}
 
 	if(unlikely(location_ua && location_ua->len && location_ua->s)) {
@@ -573,13 +640,13 @@ int append_branch(struct sip_msg *msg, str *uri, str *dst_uri, str *path,
 					location_ua->s);
 			return -1;
 		}
-		memcpy(_ksr_branches[nr_branches].location_ua, location_ua->s,
+		memcpy(ksr_branch(nr_branches).location_ua, location_ua->s,
 				location_ua->len);
-		_ksr_branches[nr_branches].location_ua[location_ua->len] = 0;
-		_ksr_branches[nr_branches].location_ua_len = location_ua->len;
+		ksr_branch(nr_branches).location_ua[location_ua->len] = 0;
+		ksr_branch(nr_branches).location_ua_len = location_ua->len;
 	} else {
-		_ksr_branches[nr_branches].location_ua[0] = '\0';
-		_ksr_branches[nr_branches].location_ua_len = 0;
+		ksr_branch(nr_branches).location_ua[0] = '\0';
+		ksr_branch(nr_branches).location_ua_len = 0;
 	}
 
 	nr_branches++;
@@ -612,7 +679,7 @@ branch_t *ksr_push_branch(struct sip_msg *msg, str *uri, str *dst_uri,
 			< 0) {
 		return NULL;
 	}
-	return &_ksr_branches[nr_branches - 1];
+	return &ksr_branch(nr_branches - 1);
 }
 
 /*! \brief
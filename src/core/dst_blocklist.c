@@ -38,6 +38,7 @@
 #include "mem/shm_mem.h"
 #include "hashes.h"
 #include "locking.h"
+#include "atomic_ops.h"
 #include "timer.h"
 #include "timer_ticks.h"
 #include "ip_addr.h"
@@ -313,8 +314,77 @@ int blst_init_ign_masks(void)
 }
 
 
+/* counting filter in front of the hash: it answers with certainty when a
+ * destination is NOT blocklisted, so the common miss case (>99% of the
+ * lookups in normal operation) never takes a bucket lock. Writers keep
+ * the per-cell counters up to date from under their bucket locks (atomic
+ * ops - a cell can be shared by entries of different buckets); readers
+ * check the two cells of a destination lock-free. Expired entries are
+ * counted until they are physically removed => only false positives,
+ * never false negatives. */
+#define DST_BLST_FILTER_SIZE 32768 /* cells - must be a power of 2 */
+
+static atomic_t *dst_blst_filter = 0;
+
+/* the two filter cells of an address+port (the proto is ignored, the
+ * blocklist supports proto wildcards) */
+inline static void dst_blst_filter_pos(unsigned char *addr, int len,
+		unsigned short port, unsigned int *p1, unsigned int *p2)
+{
+	str s1;
+	str s2;
+
+	s1.s = (char *)addr;
+	s1.len = len;
+	s2.s = (char *)&port;
+	s2.len = sizeof(port);
+	*p1 = get_hash2_raw(&s1, &s2) & (DST_BLST_FILTER_SIZE - 1);
+	*p2 = (get_hash1_raw(s1.s, s1.len) ^ ((unsigned int)port * 2654435761U))
+		  & (DST_BLST_FILTER_SIZE - 1);
+}
+
+
+/* account a new entry - must be called before linking it, so that the
+ * filter can never miss a linked entry */
+inline static void dst_blst_filter_inc(
+		unsigned char *addr, int len, unsigned short port)
+{
+	unsigned int p1, p2;
+
+	if(unlikely(dst_blst_filter == 0))
+		return;
+	dst_blst_filter_pos(addr, len, port, &p1, &p2);
+	mb_atomic_inc(&dst_blst_filter[p1]);
+	mb_atomic_inc(&dst_blst_filter[p2]);
+}
+
+
+/* returns 0 if the destination is definitely not in the blocklist,
+ * 1 if it might be (=> the caller has to do the locked lookup) */
+inline static int dst_blst_filter_match(struct ip_addr *ip,
+		unsigned short port)
+{
+	unsigned int p1, p2;
+
+	if(unlikely(dst_blst_filter == 0))
+		return 1;
+	dst_blst_filter_pos(ip->u.addr, ip->len, port, &p1, &p2);
+	return (atomic_get(&dst_blst_filter[p1]) != 0)
+		   && (atomic_get(&dst_blst_filter[p2]) != 0);
+}
+
+
 inline static void blst_destroy_entry(struct dst_blst_entry *e)
 {
+	/* the callers always unlink the entry first */
+	if(likely(dst_blst_filter != 0)) {
+		unsigned int p1, p2;
+
+		dst_blst_filter_pos(e->ip, ((e->flags & BLST_IS_IPV6) ? 16 : 4),
+				e->port, &p1, &p2);
+		mb_atomic_dec(&dst_blst_filter[p1]);
+		mb_atomic_dec(&dst_blst_filter[p2]);
+	}
 	shm_free(e);
 }
 
@@ -391,6 +461,10 @@ void destroy_dst_blocklist()
 		shm_free(dst_blst_hash);
 		dst_blst_hash = 0;
 	}
+	if(dst_blst_filter) {
+		shm_free(dst_blst_filter);
+		dst_blst_filter = 0;
+	}
 	if(blst_mem_used) {
 		shm_free((void *)blst_mem_used);
 		blst_mem_used = 0;
@@ -442,6 +516,13 @@ int init_dst_blocklist()
 	}
 	memset(dst_blst_hash, 0,
 			sizeof(struct dst_blst_lst_head) * DST_BLST_HASH_SIZE);
+	dst_blst_filter = shm_malloc(sizeof(atomic_t) * DST_BLST_FILTER_SIZE);
+	if(dst_blst_filter == 0) {
+		SHM_MEM_ERROR;
+		ret = E_OUT_OF_MEM;
+		goto error;
+	}
+	memset(dst_blst_filter, 0, sizeof(atomic_t) * DST_BLST_FILTER_SIZE);
 #ifdef BLST_LOCK_PER_BUCKET
 	for(r = 0; r < DST_BLST_HASH_SIZE; r++) {
 		if(lock_init(&dst_blst_hash[r].lock) == 0) {
@@ -747,6 +828,7 @@ inline static int dst_blocklist_add_ip(unsigned char err_flags,
 		memcpy(e->ip, ip->u.addr, ip->len);
 		e->expire = now + timeout; /* update the timeout */
 		e->next = 0;
+		dst_blst_filter_inc(e->ip, ip->len, port);
 		dst_blocklist_lst_add(&dst_blst_hash[hash].first, e);
 		BLST_HASH_STATS_INC(hash);
 	}
@@ -769,6 +851,9 @@ inline static int dst_is_blocklisted_ip(
 	now = get_ticks_raw();
 	hash = dst_blst_hash_no(proto, ip, port);
 	if(unlikely(dst_blst_hash[hash].first)) {
+		if(likely(!dst_blst_filter_match(ip, port)))
+			/* certain miss - no need to take the bucket lock */
+			return 0;
 		LOCK_BLST(hash);
 		e = _dst_blocklist_lst_find(hash, ip, proto, port, now);
 		if(e) {
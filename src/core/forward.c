@@ -517,6 +517,10 @@ int forward_request_mode(struct sip_msg *msg, str *dst, unsigned short port,
 	orig_send_sock = send_info->send_sock;
 	proto = send_info->proto;
 	ret = 0;
+	/* the stateless path sends the buffer and drops it before returning,
+	 * so it can reuse the translator's per-process output buffer */
+	if(likely(!(mbmode & BUILD_IN_SHM)))
+		mbmode |= BUILD_IN_LOCAL_BUF;
 
 	if(dst) {
 #ifdef USE_DNS_FAILOVER
@@ -583,7 +587,7 @@ int forward_request_mode(struct sip_msg *msg, str *dst, unsigned short port,
 			/* rebuild the message only if the send_sock changed */
 			prev_send_sock = send_info->send_sock;
 #endif
-			if(buf)
+			if(buf && !(mbmode & BUILD_IN_LOCAL_BUF))
 				pkg_free(buf);
 			send_info->proto = proto;
 			buf = build_req_buf_from_sip_req(msg, &len, send_info, mbmode);
@@ -677,7 +681,7 @@ end:
 		dns_srv_handle_put(&dns_srv_h);
 	}
 #endif
-	if(buf)
+	if(buf && !(mbmode & BUILD_IN_LOCAL_BUF))
 		pkg_free(buf);
 		/* received_buf & line_buf will be freed in receive_msg by free_lump_list*/
 #if defined STATS_REQ_FWD_OK || defined STATS_REQ_FWD_DROP
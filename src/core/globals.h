@@ -145,6 +145,7 @@ extern char *runtime_dir;
 extern int sr_auto_aliases;
 extern int sr_msg_time;
 extern str version_table;
+extern int db_pool_size;
 
 #ifdef USE_MCAST
 extern int mcast_loopback;
@@ -204,6 +205,7 @@ extern int open_files_limit;
 
 /* memory lock/pre-fault */
 extern int shm_force_alloc;
+extern int shm_huge_pages;
 extern int mlock_pages;
 
 /* execute onsend_route for replies */
@@ -245,10 +247,15 @@ extern unsigned char *_ksr_hname_extra_chars;
 extern char *ksr_stats_namesep;
 extern str ksr_ipv6_hex_style;
 extern int ksr_local_rport;
+extern int ksr_fwd_fast_rebuild;
 
 extern int ksr_rpc_exec_delta;
 
 extern int ksr_udp_receiver_mode;
+extern int ksr_udp_mmsg_batch;
+extern int ksr_udp_reuseport;
+extern int ksr_udp_gso;
+extern int ksr_udp_busy_poll;
 extern int ksr_msg_recv_max_size;
 extern int ksr_tcp_msg_read_timeout;
 extern int ksr_tcp_msg_data_timeout;
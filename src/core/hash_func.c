@@ -46,6 +46,43 @@ extern unsigned short int crc_16_tab[];
 #include "ut.h"
 
 
+#ifdef KSR_HASH_CRC32C_SUPPORT
+int ksr_hash_crc32c = 0;
+#endif
+
+unsigned int ksr_tm_table_entries = TABLE_ENTRIES;
+
+/* set the runtime transaction table size (power of 2) - to be called
+ * once at startup, before the table is allocated and before anything
+ * computes or stores a hash_index */
+int ksr_tm_table_entries_set(unsigned int entries)
+{
+	if(entries < 256 || entries > (1U << 24)
+			|| (entries & (entries - 1)) != 0) {
+		LM_ERR("invalid table size %u - must be a power of 2 in"
+			   " [256, %u]\n",
+				entries, 1U << 24);
+		return -1;
+	}
+	ksr_tm_table_entries = entries;
+	return 0;
+}
+
+/* runtime selection of the hash implementation - must be called at
+ * startup, before anything is hashed (the config parser already fills
+ * hash tables) and before forking, so that all the processes use the
+ * same implementation for the whole run */
+void ksr_hash_init(void)
+{
+#ifdef KSR_HASH_CRC32C_SUPPORT
+	if(__builtin_cpu_supports("sse4.2")) {
+		ksr_hash_crc32c = 1;
+		LM_DBG("using sse4.2 crc32c accelerated hashing\n");
+	}
+#endif
+}
+
+
 unsigned int new_hash(str call_id, str cseq_nr)
 {
 	unsigned int hash_code = 0;
@@ -79,7 +116,7 @@ unsigned int new_hash(str call_id, str cseq_nr)
 		hash_code += ccitt_tab[(unsigned char)*(cs + i) + 123];
 
 	/* hash_code conditioning */
-	hash_code = hash_code % (TABLE_ENTRIES - 1) + 1;
+	hash_code = hash_code % (ksr_tm_table_entries - 1) + 1;
 	return hash_code;
 }
 
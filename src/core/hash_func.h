@@ -37,10 +37,18 @@
 #define T_TABLE_POWER 16
 #define TABLE_ENTRIES (1 << (T_TABLE_POWER))
 
+/* runtime size of the transaction hash table - power of 2, defaults to
+ * TABLE_ENTRIES; can be raised once at startup (tm "hash_size"), before
+ * the table is built and before any hash_index is stored */
+extern unsigned int ksr_tm_table_entries;
+
+void ksr_hash_init(void);
+int ksr_tm_table_entries_set(unsigned int entries);
+
 unsigned int new_hash(str call_id, str cseq_nr);
 
 #define new_hash2(call_id, cseq_nr) \
-	(get_hash2_raw(&(call_id), &(cseq_nr)) & (TABLE_ENTRIES - 1))
+	(get_hash2_raw(&(call_id), &(cseq_nr)) & (ksr_tm_table_entries - 1))
 
 
 #define hash(cid, cseq) new_hash2(cid, cseq)
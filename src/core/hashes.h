@@ -25,10 +25,68 @@
 #ifndef _hashes_h
 #define _hashes_h
 
+#include <string.h>
+
 #include "str.h"
+#include "compiler_opt.h"
 
 #define core_hash_idx(hid, hsize) ((hid) & (hsize - 1))
 
+
+/* hardware accelerated (SSE4.2 CRC32C) hashing, selected at runtime:
+ * ksr_hash_init() (called at startup, before anything is hashed and
+ * before forking) sets ksr_hash_crc32c when the cpu supports it, so all
+ * the processes compute the same hash values for the whole run */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define KSR_HASH_CRC32C_SUPPORT
+#endif
+
+#ifdef KSR_HASH_CRC32C_SUPPORT
+
+#include <x86intrin.h>
+
+extern int ksr_hash_crc32c;
+
+/** internal use: crc32c over a string, h is the running value
+ * (start from 0xffffffff for an empty hash) */
+__attribute__((target("sse4.2"))) inline static unsigned int
+ksr_crc32c_update(unsigned int h, const char *s, int len)
+{
+	const char *end;
+	unsigned long long v8;
+
+	end = s + len;
+	for(; s <= (end - 8); s += 8) {
+		memcpy(&v8, s, 8);
+		h = (unsigned int)_mm_crc32_u64(h, v8);
+	}
+	for(; s < end; s++)
+		h = _mm_crc32_u8(h, (unsigned char)*s);
+	return h;
+}
+
+/** internal use: like ksr_crc32c_update(), but case insensitive - the
+ * same unconditional |0x20 folding as hash_update_case_str() (equal
+ * strings under ascii case insensitive compare hash the same, unrelated
+ * characters may be folded together - only extra collisions) */
+__attribute__((target("sse4.2"))) inline static unsigned int
+ksr_crc32c_case_update(unsigned int h, const char *s, int len)
+{
+	const char *end;
+	unsigned long long v8;
+
+	end = s + len;
+	for(; s <= (end - 8); s += 8) {
+		memcpy(&v8, s, 8);
+		h = (unsigned int)_mm_crc32_u64(h, v8 | 0x2020202020202020ULL);
+	}
+	for(; s < end; s++)
+		h = _mm_crc32_u8(h, (unsigned char)(*s | 0x20));
+	return h;
+}
+
+#endif /* KSR_HASH_CRC32C_SUPPORT */
+
 /** internal use: hash update
  * params: char* s   - string start,
  *         char* end - end
@@ -93,6 +151,12 @@ inline static unsigned int get_hash2_raw(const str *key1, const str *key2)
 	register unsigned v;
 	register unsigned h;
 
+#ifdef KSR_HASH_CRC32C_SUPPORT
+	if(likely(ksr_hash_crc32c))
+		return ksr_crc32c_update(
+				ksr_crc32c_update(0xffffffffU, key1->s, key1->len), key2->s,
+				key2->len);
+#endif
 	h = 0;
 
 	hash_update_str(key1->s, key1->s + key1->len, p, v, h);
@@ -110,6 +174,10 @@ inline static unsigned int get_hash1_raw(const char *s, int len)
 	register unsigned v;
 	register unsigned h;
 
+#ifdef KSR_HASH_CRC32C_SUPPORT
+	if(likely(ksr_hash_crc32c))
+		return ksr_crc32c_update(0xffffffffU, s, len);
+#endif
 	h = 0;
 
 	hash_update_str(s, s + len, p, v, h);
@@ -196,6 +264,12 @@ inline static unsigned int get_hash2_case_raw(const str *key1, const str *key2)
 	register unsigned v;
 	register unsigned h;
 
+#ifdef KSR_HASH_CRC32C_SUPPORT
+	if(likely(ksr_hash_crc32c))
+		return ksr_crc32c_case_update(
+				ksr_crc32c_case_update(0xffffffffU, key1->s, key1->len),
+				key2->s, key2->len);
+#endif
 	h = 0;
 
 	hash_update_case_str(key1->s, key1->s + key1->len, p, v, h);
@@ -213,6 +287,10 @@ inline static unsigned int get_hash1_case_raw(const char *s, int len)
 	register unsigned v;
 	register unsigned h;
 
+#ifdef KSR_HASH_CRC32C_SUPPORT
+	if(likely(ksr_hash_crc32c))
+		return ksr_crc32c_case_update(0xffffffffU, s, len);
+#endif
 	h = 0;
 
 	hash_update_case_str(s, s + len, p, v, h);
@@ -275,6 +353,14 @@ static inline unsigned int core_hash(
 	register unsigned v;
 	register unsigned h;
 
+#ifdef KSR_HASH_CRC32C_SUPPORT
+	if(likely(ksr_hash_crc32c)) {
+		h = ksr_crc32c_update(0xffffffffU, s1->s, s1->len);
+		if(s2)
+			h = ksr_crc32c_update(h, s2->s, s2->len);
+		return size ? ((h) & (size - 1)) : h;
+	}
+#endif
 	h = 0;
 
 	end = s1->s + s1->len;
@@ -321,6 +407,14 @@ static inline unsigned int core_case_hash(str *s1, str *s2, unsigned int size)
 	register unsigned v;
 	register unsigned h;
 
+#ifdef KSR_HASH_CRC32C_SUPPORT
+	if(likely(ksr_hash_crc32c)) {
+		h = ksr_crc32c_case_update(0xffffffffU, s1->s, s1->len);
+		if(s2)
+			h = ksr_crc32c_case_update(h, s2->s, s2->len);
+		return size ? ((h) & (size - 1)) : h;
+	}
+#endif
 	h = 0;
 
 	end = s1->s + s1->len;
@@ -58,12 +58,15 @@ char *poll_support = "poll"
 #endif
 #ifdef HAVE_DEVPOLL
 					 ", /dev/poll"
+#endif
+#ifdef HAVE_IO_URING
+					 ", io_uring"
 #endif
 		;
 
 
 char *poll_method_str[POLL_END] = {"none", "poll", "epoll_lt", "epoll_et",
-		"sigio_rt", "select", "kqueue", "/dev/poll"};
+		"sigio_rt", "select", "kqueue", "/dev/poll", "io_uring"};
 
 int _os_ver = 0; /* os version number */
 
@@ -254,6 +257,117 @@ static void destroy_devpoll(io_wait_h *h)
 #endif
 
 
+#ifdef HAVE_IO_URING
+/* io_uring specific init: create the ring and map the submission and
+ * completion queues into the process
+ * returns -1 on error, 0 on success */
+static int init_io_uring(io_wait_h *h)
+{
+	struct io_uring_params prm;
+	unsigned entries;
+
+	/* ring size: smallest power of 2 covering max_fd_no, capped - the
+	 * sq is only used for poll arm/remove requests, so it does not have
+	 * to cover all the watched fds at once */
+	entries = 64;
+	while(entries < (unsigned)h->max_fd_no && entries < 4096)
+		entries <<= 1;
+	memset(&prm, 0, sizeof(prm));
+again:
+	h->uring_fd = syscall(__NR_io_uring_setup, entries, &prm);
+	if(h->uring_fd == -1) {
+		if(errno == EINTR)
+			goto again;
+		LM_ERR("io_uring_setup: %s [%d]\n", strerror(errno), errno);
+		return -1;
+	}
+	h->uring_sq_entries = prm.sq_entries;
+	h->uring_sq_ring_sz = prm.sq_off.array + prm.sq_entries * sizeof(unsigned);
+	h->uring_cq_ring_sz =
+			prm.cq_off.cqes + prm.cq_entries * sizeof(struct io_uring_cqe);
+	if(prm.features & IORING_FEAT_SINGLE_MMAP) {
+		if(h->uring_cq_ring_sz > h->uring_sq_ring_sz)
+			h->uring_sq_ring_sz = h->uring_cq_ring_sz;
+		h->uring_cq_ring_sz = h->uring_sq_ring_sz;
+	}
+	h->uring_sq_ring = mmap(0, h->uring_sq_ring_sz, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, h->uring_fd, IORING_OFF_SQ_RING);
+	if(h->uring_sq_ring == MAP_FAILED) {
+		LM_ERR("sq ring mmap: %s [%d]\n", strerror(errno), errno);
+		goto error;
+	}
+	if(prm.features & IORING_FEAT_SINGLE_MMAP) {
+		h->uring_cq_ring = h->uring_sq_ring;
+	} else {
+		h->uring_cq_ring = mmap(0, h->uring_cq_ring_sz, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, h->uring_fd, IORING_OFF_CQ_RING);
+		if(h->uring_cq_ring == MAP_FAILED) {
+			LM_ERR("cq ring mmap: %s [%d]\n", strerror(errno), errno);
+			goto error;
+		}
+	}
+	h->uring_sqes_sz = prm.sq_entries * sizeof(struct io_uring_sqe);
+	h->uring_sqes = mmap(0, h->uring_sqes_sz, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, h->uring_fd, IORING_OFF_SQES);
+	if(h->uring_sqes == MAP_FAILED) {
+		LM_ERR("sqes mmap: %s [%d]\n", strerror(errno), errno);
+		goto error;
+	}
+	h->uring_sq_head =
+			(unsigned *)((char *)h->uring_sq_ring + prm.sq_off.head);
+	h->uring_sq_tail =
+			(unsigned *)((char *)h->uring_sq_ring + prm.sq_off.tail);
+	h->uring_sq_mask =
+			(unsigned *)((char *)h->uring_sq_ring + prm.sq_off.ring_mask);
+	h->uring_sq_array =
+			(unsigned *)((char *)h->uring_sq_ring + prm.sq_off.array);
+	h->uring_cq_head =
+			(unsigned *)((char *)h->uring_cq_ring + prm.cq_off.head);
+	h->uring_cq_tail =
+			(unsigned *)((char *)h->uring_cq_ring + prm.cq_off.tail);
+	h->uring_cq_mask =
+			(unsigned *)((char *)h->uring_cq_ring + prm.cq_off.ring_mask);
+	h->uring_cqes = (struct io_uring_cqe *)((char *)h->uring_cq_ring
+											+ prm.cq_off.cqes);
+	h->uring_to_submit = 0;
+	return 0;
+error:
+	if(h->uring_sq_ring && h->uring_sq_ring != MAP_FAILED)
+		munmap(h->uring_sq_ring, h->uring_sq_ring_sz);
+	if(h->uring_cq_ring && h->uring_cq_ring != MAP_FAILED
+			&& h->uring_cq_ring != h->uring_sq_ring)
+		munmap(h->uring_cq_ring, h->uring_cq_ring_sz);
+	h->uring_sq_ring = 0;
+	h->uring_cq_ring = 0;
+	close(h->uring_fd);
+	h->uring_fd = -1;
+	return -1;
+}
+
+
+static void destroy_io_uring(io_wait_h *h)
+{
+	if(h->uring_sqes && h->uring_sqes != MAP_FAILED) {
+		munmap(h->uring_sqes, h->uring_sqes_sz);
+		h->uring_sqes = 0;
+	}
+	if(h->uring_cq_ring && h->uring_cq_ring != MAP_FAILED
+			&& h->uring_cq_ring != h->uring_sq_ring) {
+		munmap(h->uring_cq_ring, h->uring_cq_ring_sz);
+	}
+	h->uring_cq_ring = 0;
+	if(h->uring_sq_ring && h->uring_sq_ring != MAP_FAILED) {
+		munmap(h->uring_sq_ring, h->uring_sq_ring_sz);
+		h->uring_sq_ring = 0;
+	}
+	if(h->uring_fd != -1) {
+		close(h->uring_fd);
+		h->uring_fd = -1;
+	}
+}
+#endif
+
+
 #ifdef HAVE_SELECT
 static int init_select(io_wait_h *h)
 {
@@ -336,6 +450,16 @@ char *check_poll_method(enum poll_types poll_method)
 			if(_os_ver < 0x0507) /* ver < 5.7 */
 				ret = "/dev/poll not supported on Solaris < 7.0 (SunOS 5.7)";
 #endif
+#endif
+			break;
+		case POLL_IO_URING:
+#ifndef HAVE_IO_URING
+			ret = "io_uring not supported, try re-compiling with"
+				  " -DHAVE_IO_URING";
+#else
+			/* multishot poll requests need 5.13+ */
+			if(_os_ver < 0x050d00) /* if ver < 5.13 */
+				ret = "io_uring not supported on kernels < 5.13";
 #endif
 			break;
 
@@ -438,6 +562,9 @@ int init_io_wait(io_wait_h *h, int max_fd, enum poll_types poll_method)
 #endif
 #ifdef HAVE_DEVPOLL
 	h->dpoll_fd = -1;
+#endif
+#ifdef HAVE_IO_URING
+	h->uring_fd = -1;
 #endif
 	poll_err = check_poll_method(poll_method);
 
@@ -517,6 +644,14 @@ int init_io_wait(io_wait_h *h, int max_fd, enum poll_types poll_method)
 			}
 			break;
 #endif
+#ifdef HAVE_IO_URING
+		case POLL_IO_URING:
+			if(init_io_uring(h) < 0) {
+				LM_CRIT("io_uring init failed\n");
+				goto error;
+			}
+			break;
+#endif
 #ifdef HAVE_KQUEUE
 		case POLL_KQUEUE:
 			h->kq_changes_size = KQ_CHANGES_ARRAY_SIZE;
@@ -593,6 +728,11 @@ void destroy_io_wait(io_wait_h *h)
 			destroy_sigio(h);
 			break;
 #endif
+#ifdef HAVE_IO_URING
+		case POLL_IO_URING:
+			destroy_io_uring(h);
+			break;
+#endif
 #ifdef HAVE_DEVPOLL
 		case POLL_DEVPOLL:
 			destroy_devpoll(h);
@@ -64,6 +64,13 @@
 #ifdef HAVE_DEVPOLL
 #include <sys/devpoll.h>
 #endif
+#ifdef HAVE_IO_URING
+#include <unistd.h>		 /* syscall() */
+#include <sys/syscall.h> /* __NR_io_uring_* */
+#include <sys/mman.h>	 /* mmap */
+#include <linux/io_uring.h>
+#include "atomic_ops.h" /* membar_read/membar_write */
+#endif
 #ifdef HAVE_SELECT
 /* needed on openbsd for select*/
 #include <sys/time.h>
@@ -176,6 +183,27 @@ typedef struct io_wait_handler
 	fd_set main_wset;  /* write set */
 	int max_fd_select; /* maximum select used fd */
 #endif
+#ifdef HAVE_IO_URING
+	int uring_fd;			 /* io_uring instance fd */
+	unsigned *uring_sq_head; /* mapped submission queue ring pointers */
+	unsigned *uring_sq_tail;
+	unsigned *uring_sq_mask;
+	unsigned *uring_sq_array;
+	unsigned *uring_cq_head; /* mapped completion queue ring pointers */
+	unsigned *uring_cq_tail;
+	unsigned *uring_cq_mask;
+	struct io_uring_sqe *uring_sqes;
+	struct io_uring_cqe *uring_cqes;
+	void *uring_sq_ring; /* sq ring mapping (address & size) */
+	void *uring_cq_ring; /* cq ring mapping (address & size) */
+	size_t uring_sq_ring_sz;
+	size_t uring_cq_ring_sz;
+	size_t uring_sqes_sz;
+	unsigned uring_sq_entries;
+	unsigned uring_to_submit;		   /* sqes queued, but not yet submitted */
+	struct __kernel_timespec uring_ts; /* wait timeout storage (must stay
+										valid until the timeout completes) */
+#endif
 } io_wait_h;
 
 
@@ -288,6 +316,112 @@ static inline int kq_ev_change(
 #endif
 
 
+#ifdef HAVE_IO_URING
+/*
+ * submit the queued sqes, waiting for min_complete completions if
+ * IORING_ENTER_GETEVENTS is set in flags
+ * returns: -1 on error, number of submitted sqes on success
+ */
+static inline int ksr_iouring_enter(
+		io_wait_h *h, unsigned min_complete, unsigned flags)
+{
+	int n;
+
+again:
+	n = syscall(__NR_io_uring_enter, h->uring_fd, h->uring_to_submit,
+			min_complete, flags, 0, 0);
+	if(unlikely(n == -1)) {
+		if(errno == EINTR)
+			goto again;
+		LM_ERR("io_uring_enter(%d, %u, %u, 0x%x): %s [%d]\n", h->uring_fd,
+				h->uring_to_submit, min_complete, flags, strerror(errno),
+				errno);
+		return -1;
+	}
+	h->uring_to_submit = 0;
+	return n;
+}
+
+
+/*
+ * get the next free submission queue entry, flushing the queued ones
+ * first if the ring is full
+ * returns 0 on error (ring full and flush failed)
+ */
+static inline struct io_uring_sqe *ksr_iouring_get_sqe(io_wait_h *h)
+{
+	unsigned tail;
+	unsigned idx;
+	struct io_uring_sqe *sqe;
+
+	tail = *h->uring_sq_tail;
+	membar_read();
+	if(unlikely(tail - *h->uring_sq_head >= h->uring_sq_entries)) {
+		/* submission ring full - push out what is queued so far */
+		if(unlikely(ksr_iouring_enter(h, 0, 0) == -1))
+			return 0;
+		membar_read();
+		if(unlikely(tail - *h->uring_sq_head >= h->uring_sq_entries))
+			return 0;
+	}
+	idx = tail & *h->uring_sq_mask;
+	sqe = &h->uring_sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	h->uring_sq_array[idx] = idx;
+	membar_write();
+	*h->uring_sq_tail = tail + 1;
+	h->uring_to_submit++;
+	return sqe;
+}
+
+
+/*
+ * queue a multishot poll request for the fd behind e; it stays armed
+ * across events until cancelled or terminated by the kernel
+ * (completions carry e in user_data)
+ * returns: -1 on error, 0 on success
+ */
+static inline int ksr_iouring_poll_arm(
+		io_wait_h *h, struct fd_map *e, short events)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = ksr_iouring_get_sqe(h);
+	if(unlikely(sqe == 0))
+		return -1;
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = e->fd;
+	sqe->poll32_events = (unsigned)events
+#ifdef POLLRDHUP
+						 /* listen to POLLRDHUP by default (if POLLIN) */
+						 | (((int)!(events & POLLIN) - 1) & POLLRDHUP)
+#endif /* POLLRDHUP */
+						 | POLLERR | POLLHUP;
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = (__u64)(unsigned long)e;
+	return 0;
+}
+
+
+/*
+ * queue the removal of the multishot poll request armed for e
+ * returns: -1 on error, 0 on success
+ */
+static inline int ksr_iouring_poll_del(io_wait_h *h, struct fd_map *e)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = ksr_iouring_get_sqe(h);
+	if(unlikely(sqe == 0))
+		return -1;
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd = -1;
+	sqe->addr = (__u64)(unsigned long)e;
+	return 0;
+}
+#endif /* HAVE_IO_URING */
+
+
 /* generic io_watch_add function
  * Params:
  *     h      - pointer to initialized io_wait handle
@@ -510,6 +644,14 @@ inline static int io_watch_add(
 			}
 			break;
 #endif
+#ifdef HAVE_IO_URING
+		case POLL_IO_URING:
+			set_fd_flags(O_NONBLOCK);
+			/* the request is submitted on the next loop iteration */
+			if(unlikely(ksr_iouring_poll_arm(h, e, events) == -1))
+				goto error;
+			break;
+#endif
 
 		default:
 			LM_CRIT("no support for poll method  %s (%d)\n",
@@ -721,6 +863,15 @@ inline static int io_watch_del(io_wait_h *h, int fd, int idx, int flags)
 				goto error;
 			}
 			break;
+#endif
+#ifdef HAVE_IO_URING
+		case POLL_IO_URING:
+			/* cancel the armed multishot poll; the cancellation is
+			 * submitted with the next batch - stale completions are
+			 * filtered out via the unhashed fd_map (type==0) */
+			if(unlikely(ksr_iouring_poll_del(h, e) == -1))
+				goto error;
+			break;
 #endif
 		default:
 			LM_CRIT("no support for poll method  %s (%d)\n",
@@ -917,6 +1068,20 @@ inline static int io_watch_chg(io_wait_h *h, int fd, short events, int idx)
 				goto error;
 			}
 			break;
+#endif
+#ifdef HAVE_IO_URING
+		case POLL_IO_URING:
+			/* no poll update op => cancel the old request and re-arm
+			 * with the new event set */
+			if(unlikely(ksr_iouring_poll_del(h, e) == -1))
+				goto error;
+			if(unlikely(ksr_iouring_poll_arm(h, e, events) == -1)) {
+				/* old request cancelled, new one not armed => the fd is
+				 * not watched anymore - mark it as removed */
+				unhash_fd_map(e);
+				goto error;
+			}
+			break;
 #endif
 		default:
 			LM_CRIT("no support for poll method %s (%d)\n",
@@ -1398,6 +1563,90 @@ error:
 #endif
 
 
+#ifdef HAVE_IO_URING
+/* wait for io using io_uring: the watched fds have multishot poll
+ * requests armed (see ksr_iouring_poll_arm()), so one ring wait
+ * replaces the epoll_wait + per-fd re-arm syscall pairs; queued
+ * add/remove requests are submitted in the same io_uring_enter() call */
+inline static int io_wait_loop_uring(io_wait_h *h, int t, int repeat)
+{
+	int n;
+	int res;
+	unsigned head;
+	unsigned tail;
+	unsigned cflags;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	struct fd_map *fm;
+	int revents;
+
+	/* queue a timeout request so that the wait below returns after t
+	 * seconds even if there is no io event (user_data 0 marks it) */
+	h->uring_ts.tv_sec = t;
+	h->uring_ts.tv_nsec = 0;
+	sqe = ksr_iouring_get_sqe(h);
+	if(unlikely(sqe == 0))
+		goto error;
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->fd = -1;
+	sqe->addr = (__u64)(unsigned long)&h->uring_ts;
+	sqe->len = 1;
+	sqe->user_data = 0;
+
+	if(unlikely(ksr_iouring_enter(h, 1, IORING_ENTER_GETEVENTS) == -1))
+		goto error;
+
+	n = 0;
+	head = *h->uring_cq_head;
+	membar_read();
+	tail = *h->uring_cq_tail;
+	for(; head != tail; head++) {
+		cqe = &h->uring_cqes[head & *h->uring_cq_mask];
+		res = cqe->res;
+		cflags = cqe->flags;
+		fm = (struct fd_map *)(unsigned long)cqe->user_data;
+		/* release the cqe before handle_io() - it can queue new sqes and
+		 * needs free completion ring space for their results */
+		membar();
+		*h->uring_cq_head = head + 1;
+		if(fm == 0) /* timeout completion */
+			continue;
+		if(unlikely(res < 0)) {
+			/* -ECANCELED & "friends": completion of a request cancelled
+			 * from io_watch_del()/io_watch_chg() => ignore */
+			if(res != -ECANCELED && res != -ENOENT && res != -EALREADY)
+				LM_ERR("io_uring completion error %d on fd %d (data %p)\n",
+						res, fm->fd, fm->data);
+			continue;
+		}
+		revents = res
+				  & (POLLIN | POLLOUT | POLLERR | POLLHUP
+#ifdef POLLRDHUP
+						  | POLLRDHUP
+#endif /* POLLRDHUP */
+				  );
+		/* stale events for already unwatched fds (type==0) are skipped */
+		if(likely(fm->type
+				   && ((fm->events | POLLERR | POLLHUP) & revents))) {
+			n++;
+			while(fm->type && ((fm->events | POLLERR | POLLHUP) & revents)
+					&& (handle_io(fm, revents, -1) > 0) && repeat)
+				;
+		}
+		if(unlikely(fm->type && !(cflags & IORING_CQE_F_MORE))) {
+			/* the multishot poll was terminated by the kernel, but the
+			 * fd is still watched => re-arm it */
+			if(unlikely(ksr_iouring_poll_arm(h, fm, fm->events) == -1))
+				LM_ERR("failed to re-arm poll for fd %d\n", fm->fd);
+		}
+	}
+	return n;
+error:
+	return -1;
+}
+#endif
+
+
 /* init */
 
 
@@ -27,6 +27,7 @@
 
 #include "dprint.h"
 #include "forward.h"
+#include "hashes.h"
 #include "locking.h"
 #include "dset.h"
 #include "action.h"
@@ -3445,6 +3446,33 @@ sr_kemi_t *sr_kemi_exports_get_pv(void)
 static int _sr_kemi_modules_size = 0;
 static sr_kemi_module_t _sr_kemi_modules[SR_KEMI_MODULES_MAX_SIZE];
 
+/**
+ * compute the case-insensitive hash id for a function name - never 0, so
+ * an unset field can be told apart from a computed one
+ */
+static unsigned int sr_kemi_fname_hashid(str *fname)
+{
+	unsigned int fhashid;
+
+	fhashid = get_hash1_case_raw(fname->s, fname->len);
+	if(fhashid == 0) {
+		fhashid = 1;
+	}
+	return fhashid;
+}
+
+/**
+ * fill the fname hash ids for a list of exports, to speed up runtime lookups
+ */
+static void sr_kemi_fhashid_fill(sr_kemi_t *klist)
+{
+	int i;
+
+	for(i = 0; klist[i].fname.s != NULL; i++) {
+		klist[i].fhashid = sr_kemi_fname_hashid(&klist[i].fname);
+	}
+}
+
 /**
  *
  */
@@ -3456,18 +3484,22 @@ int sr_kemi_modules_add(sr_kemi_t *klist)
 	}
 	if(_sr_kemi_modules_size == 0) {
 		LM_DBG("adding core module\n");
+		sr_kemi_fhashid_fill(_sr_kemi_core);
 		_sr_kemi_modules[_sr_kemi_modules_size].mname = _sr_kemi_core[0].mname;
 		_sr_kemi_modules[_sr_kemi_modules_size].kexp = _sr_kemi_core;
 		_sr_kemi_modules_size++;
 		LM_DBG("adding pv module\n");
+		sr_kemi_fhashid_fill(_sr_kemi_pv);
 		_sr_kemi_modules[_sr_kemi_modules_size].mname = _sr_kemi_pv[0].mname;
 		_sr_kemi_modules[_sr_kemi_modules_size].kexp = _sr_kemi_pv;
 		_sr_kemi_modules_size++;
 		LM_DBG("adding hdr module\n");
+		sr_kemi_fhashid_fill(_sr_kemi_hdr);
 		_sr_kemi_modules[_sr_kemi_modules_size].mname = _sr_kemi_hdr[0].mname;
 		_sr_kemi_modules[_sr_kemi_modules_size].kexp = _sr_kemi_hdr;
 		_sr_kemi_modules_size++;
 	}
+	sr_kemi_fhashid_fill(klist);
 	if((_sr_kemi_modules_size > 1)
 			&& (_sr_kemi_modules[_sr_kemi_modules_size - 1].mname.len
 					== klist[0].mname.len)
@@ -3514,11 +3546,19 @@ sr_kemi_module_t *sr_kemi_modules_get(void)
 sr_kemi_t *sr_kemi_lookup(str *mname, int midx, str *fname)
 {
 	int i;
+	unsigned int fhashid;
 	sr_kemi_t *ket;
 
+	/* compare by precomputed hash id first, falling back to the string
+	 * comparison only on a hash match - cuts the cost of scanning large
+	 * export tables on the per-call dynamic dispatch paths */
+	fhashid = sr_kemi_fname_hashid(fname);
 	if(mname == NULL || mname->len <= 0) {
 		for(i = 0; _sr_kemi_core[i].fname.s != NULL; i++) {
 			ket = &_sr_kemi_core[i];
+			if(ket->fhashid != 0 && ket->fhashid != fhashid) {
+				continue;
+			}
 			if(ket->fname.len == fname->len
 					&& strncasecmp(ket->fname.s, fname->s, fname->len) == 0) {
 				return ket;
@@ -3528,6 +3568,9 @@ sr_kemi_t *sr_kemi_lookup(str *mname, int midx, str *fname)
 		if(midx > 0 && midx < SR_KEMI_MODULES_MAX_SIZE) {
 			for(i = 0; _sr_kemi_modules[midx].kexp[i].fname.s != NULL; i++) {
 				ket = &_sr_kemi_modules[midx].kexp[i];
+				if(ket->fhashid != 0 && ket->fhashid != fhashid) {
+					continue;
+				}
 				if(ket->fname.len == fname->len
 						&& strncasecmp(ket->fname.s, fname->s, fname->len)
 								   == 0) {
@@ -55,6 +55,8 @@ typedef struct sr_kemi
 	int rtype;	/* return type (supported SR_KEMIP_INT/BOOL) */
 	void *func; /* pointer to the C function to be executed */
 	int ptypes[SR_KEMI_PARAMS_MAX]; /* array with the type of parameters */
+	unsigned int fhashid; /* case-insensitive hash over fname - filled at
+							 registration, 0 if not computed yet */
 } sr_kemi_t;
 
 typedef struct sr_kemi_item
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2001-2003 FhG Fokus
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*!
+ * \file
+ * \brief Kamailio core :: message handling latency histograms
+ * \ingroup core
+ * Module: \ref core
+ */
+
+#include <string.h>
+
+#include "dprint.h"
+#include "mem/shm_mem.h"
+#include "latency_hist.h"
+
+int ksr_lathist_enabled = 0;
+
+static ksr_lathist_rec_t *_ksr_lathist = NULL;
+
+/* method slot names - slots 1..20 follow the bit order of
+ * request_method_t (parser/msg_parser.h) */
+static char *_ksr_lathist_methods[KSR_LATHIST_METHODS] = {"reply", "INVITE",
+		"CANCEL", "ACK", "BYE", "INFO", "REGISTER", "SUBSCRIBE", "NOTIFY",
+		"MESSAGE", "OPTIONS", "PRACK", "UPDATE", "REFER", "PUBLISH", "KDMQ",
+		"GET", "POST", "PUT", "DELETE", "OTHER", "undefined"};
+
+int ksr_lathist_init(void)
+{
+	int i;
+	int n;
+
+	if(!ksr_lathist_enabled)
+		return 0;
+
+	n = KSR_LATHIST_PROTOS * KSR_LATHIST_METHODS;
+	_ksr_lathist = (ksr_lathist_rec_t *)shm_malloc(
+			n * sizeof(ksr_lathist_rec_t));
+	if(_ksr_lathist == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_ksr_lathist, 0, n * sizeof(ksr_lathist_rec_t));
+	for(i = 0; i < n; i++) {
+		if(lock_init(&_ksr_lathist[i].lock) == 0) {
+			LM_CRIT("could not initialize a lock\n");
+			shm_free(_ksr_lathist);
+			_ksr_lathist = NULL;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * map a request method bitmask to its slot (see _ksr_lathist_methods)
+ */
+static int ksr_lathist_method_idx(unsigned int method)
+{
+	int b;
+
+	if(method == 0)
+		return KSR_LATHIST_METHODS - 1;
+	for(b = 0; b < 20; b++) {
+		if(method & (1U << b))
+			return b + 1;
+	}
+	return KSR_LATHIST_METHODS - 1;
+}
+
+static int ksr_lathist_bucket(unsigned long long v)
+{
+	int b = 0;
+
+	while(v > 1 && b < KSR_LATHIST_BUCKETS - 1) {
+		v >>= 1;
+		b++;
+	}
+	return b;
+}
+
+void ksr_lathist_record(int proto, int is_request, unsigned int method,
+		unsigned long long parse_us, unsigned long long route_us)
+{
+	ksr_lathist_rec_t *rec;
+	unsigned long long total_us;
+	int midx;
+
+	if(_ksr_lathist == NULL)
+		return;
+	if(proto < 0 || proto >= KSR_LATHIST_PROTOS)
+		proto = PROTO_OTHER;
+	midx = (is_request) ? ksr_lathist_method_idx(method) : 0;
+
+	total_us = parse_us + route_us;
+	rec = &_ksr_lathist[proto * KSR_LATHIST_METHODS + midx];
+	lock_get(&rec->lock);
+	rec->count++;
+	rec->sum[KSR_LATHIST_ST_PARSE] += parse_us;
+	rec->sum[KSR_LATHIST_ST_ROUTE] += route_us;
+	rec->sum[KSR_LATHIST_ST_TOTAL] += total_us;
+	rec->bucket[KSR_LATHIST_ST_PARSE][ksr_lathist_bucket(parse_us)]++;
+	rec->bucket[KSR_LATHIST_ST_ROUTE][ksr_lathist_bucket(route_us)]++;
+	rec->bucket[KSR_LATHIST_ST_TOTAL][ksr_lathist_bucket(total_us)]++;
+	lock_release(&rec->lock);
+}
+
+ksr_lathist_rec_t *ksr_lathist_get(int proto, int midx)
+{
+	if(_ksr_lathist == NULL || proto < 0 || proto >= KSR_LATHIST_PROTOS
+			|| midx < 0 || midx >= KSR_LATHIST_METHODS)
+		return NULL;
+	return &_ksr_lathist[proto * KSR_LATHIST_METHODS + midx];
+}
+
+char *ksr_lathist_method_name(int midx)
+{
+	if(midx < 0 || midx >= KSR_LATHIST_METHODS)
+		return "unknown";
+	return _ksr_lathist_methods[midx];
+}
+
+/**
+ * upper bound estimate of a percentile (given in permille) from the
+ * log2 buckets of one stage
+ */
+unsigned long long ksr_lathist_percentile(
+		unsigned long long *bucket, unsigned long long total, int permille)
+{
+	unsigned long long rank, acc = 0;
+	int b;
+
+	if(total == 0)
+		return 0;
+
+	rank = (total * permille + 999) / 1000;
+	for(b = 0; b < KSR_LATHIST_BUCKETS; b++) {
+		acc += bucket[b];
+		if(acc >= rank)
+			return (2ULL << b) - 1;
+	}
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2001-2003 FhG Fokus
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*!
+ * \file
+ * \brief Kamailio core :: message handling latency histograms
+ * \ingroup core
+ * Module: \ref core
+ */
+
+#ifndef _LATENCY_HIST_H_
+#define _LATENCY_HIST_H_
+
+#include "locking.h"
+#include "ip_addr.h"
+
+/* per-transport and per-method log2 histograms of the time a message
+ * spends in receive_msg(): the parse stage, the routing stage (routes,
+ * callbacks and forwarding) and the total. Enabled with the
+ * latency_hist config setting; the shared table is allocated before
+ * forking and dumped by the core.latency_hist rpc. */
+
+#define KSR_LATHIST_BUCKETS 20 /* log2 usec buckets, last takes the rest */
+
+#define KSR_LATHIST_ST_PARSE 0
+#define KSR_LATHIST_ST_ROUTE 1
+#define KSR_LATHIST_ST_TOTAL 2
+#define KSR_LATHIST_STAGES 3
+
+#define KSR_LATHIST_PROTOS (PROTO_OTHER + 1)
+/* method slots: 0 - replies, 1..20 - request methods by bit position,
+ * 21 - requests with undefined method */
+#define KSR_LATHIST_METHODS 22
+
+typedef struct ksr_lathist_rec
+{
+	gen_lock_t lock;
+	unsigned long long count;
+	unsigned long long sum[KSR_LATHIST_STAGES];
+	unsigned long long bucket[KSR_LATHIST_STAGES][KSR_LATHIST_BUCKETS];
+} ksr_lathist_rec_t;
+
+extern int ksr_lathist_enabled;
+
+int ksr_lathist_init(void);
+void ksr_lathist_record(int proto, int is_request, unsigned int method,
+		unsigned long long parse_us, unsigned long long route_us);
+ksr_lathist_rec_t *ksr_lathist_get(int proto, int midx);
+char *ksr_lathist_method_name(int midx);
+unsigned long long ksr_lathist_percentile(
+		unsigned long long *bucket, unsigned long long total, int permille);
+
+#endif
@@ -34,6 +34,7 @@
 #include "../globals.h"
 #include "../compiler_opt.h"
 #include "memdbg.h"
+#include "shm.h"
 #include "../bit_scan.h"
 #include "../cfg/cfg.h" /* memlog */
 #ifdef MALLOC_STATS
@@ -438,6 +439,66 @@ struct fm_frag *fm_search_defrag(struct fm_block *qm, size_t size)
 	return 0;
 }
 
+/**
+ * \brief Bounded free-fragment coalescing sweep
+ *
+ * Visits up to max_frags free fragments, joining each one with any
+ * physically adjacent free fragments, and resumes from the next hash
+ * bucket on the following call; meant to be driven off the hot path
+ * (rpc, timer) when mem_join is disabled
+ * \param qmp memory block
+ * \param max_frags maximum number of free fragments to visit
+ * \return number of joins performed
+ */
+int fm_defrag(void *qmp, int max_frags)
+{
+	struct fm_block *qm;
+	struct fm_frag *frag;
+	struct fm_frag *nxt;
+	int h;
+	int visited;
+	int joins;
+	int buckets;
+
+	qm = (struct fm_block *)qmp;
+	visited = 0;
+	joins = 0;
+	h = (qm->defrag_pos < F_HASH_SIZE) ? (int)qm->defrag_pos : 0;
+	for(buckets = 0; buckets < F_HASH_SIZE && visited < max_frags;
+			buckets++, h = (h + 1) % F_HASH_SIZE) {
+		frag = qm->free_hash[h].first;
+		while(frag && visited < max_frags) {
+			visited++;
+			nxt = FRAG_NEXT(frag);
+			if(((char *)nxt < (char *)qm->last_frag) && fm_is_free(nxt)) {
+				/* join frag with all next consecutive free frags */
+				fm_extract_free(qm, frag);
+				do {
+					fm_extract_free(qm, nxt);
+					frag->size += nxt->size + FRAG_OVERHEAD;
+
+					/* after join - one frag less, add its overhead to used
+					 * (real_used already has it - frag and nxt were
+					 * extracted) */
+					qm->used += FRAG_OVERHEAD;
+
+					nxt = FRAG_NEXT(frag);
+				} while(((char *)nxt < (char *)qm->last_frag)
+						&& fm_is_free(nxt));
+				fm_insert_free(qm, frag);
+				joins++;
+				/* the bucket list changed - restart it; the joined frag's
+				 * neighbour is used now, so no frag is joined twice */
+				frag = qm->free_hash[h].first;
+			} else {
+				frag = frag->next_free;
+			}
+		}
+	}
+	qm->defrag_pos = h;
+	return joins;
+}
+
 /**
  * \brief Main memory manager allocation function
  *
@@ -975,6 +1036,8 @@ void fm_status(void *qmp)
 void fm_info(void *qmp, struct mem_info *info)
 {
 	struct fm_block *qm;
+	struct fm_frag *f;
+	int h;
 
 	qm = (struct fm_block *)qmp;
 	memset(info, 0, sizeof(*info));
@@ -985,6 +1048,16 @@ void fm_info(void *qmp, struct mem_info *info)
 	info->real_used = qm->real_used;
 	info->max_used = qm->max_real_used;
 	info->total_frags = qm->ffrags;
+	/* largest free fragment - the highest non-empty hash bucket holds it */
+	for(h = F_HASH_SIZE - 1; h >= 0; h--) {
+		if(qm->free_hash[h].first == NULL)
+			continue;
+		for(f = qm->free_hash[h].first; f; f = f->next_free) {
+			if(f->size > info->max_free_frag)
+				info->max_free_frag = f->size;
+		}
+		break;
+	}
 }
 
 
@@ -1267,6 +1340,65 @@ int fm_shm_lock_init(void)
 	return 0;
 }
 
+#ifndef DBG_F_MALLOC
+/* Per-process magazine cache layered over the shm wrappers. Small requests
+ * are rounded up to a power-of-two size class and, on free, parked in a
+ * process-local list instead of being returned to the pool, so steady-state
+ * shm malloc/free pairs of the same class skip the global lock entirely.
+ * Freed chunks are classified from the fragment header (frag->size), thus
+ * only fragments whose size matches a class exactly are cached - everything
+ * else takes the locked path. Chunks cached by one process can have been
+ * allocated by another; ownership moves wholesale with the pointer. The
+ * cache is active only in child processes (process_no > 0): all forking is
+ * done from the main process, so every child starts with an empty cache and
+ * no chunk can be visible in two caches at once. */
+#define FM_MAG_CLASSES 7
+#define FM_MAG_MIN_SHIFT 5 /* smallest class: 32 bytes */
+#define FM_MAG_MAX_SIZE (1UL << (FM_MAG_MIN_SHIFT + FM_MAG_CLASSES - 1))
+#define FM_MAG_CAP 32 /* max cached chunks per class */
+
+typedef struct fm_mag_item
+{
+	struct fm_mag_item *next;
+} fm_mag_item_t;
+
+static fm_mag_item_t *_fm_mag[FM_MAG_CLASSES];
+static int _fm_mag_no[FM_MAG_CLASSES];
+
+/* class index for an allocation request, storing the class size in *csize,
+ * or -1 when the request is not cacheable */
+static inline int fm_mag_class(unsigned long size, unsigned long *csize)
+{
+	int idx;
+	unsigned long cs;
+
+	if(process_no <= 0 || size > FM_MAG_MAX_SIZE)
+		return -1;
+	cs = 1UL << FM_MAG_MIN_SHIFT;
+	for(idx = 0; cs < size; idx++)
+		cs <<= 1;
+	*csize = cs;
+	return idx;
+}
+
+/* class index for a fragment coming back via free, or -1 when its size
+ * does not match a class exactly */
+static inline int fm_mag_class_exact(unsigned long fsize)
+{
+	int idx;
+	unsigned long cs;
+
+	if(process_no <= 0 || fsize > FM_MAG_MAX_SIZE
+			|| fsize < (1UL << FM_MAG_MIN_SHIFT)
+			|| (fsize & (fsize - 1)) != 0)
+		return -1;
+	cs = 1UL << FM_MAG_MIN_SHIFT;
+	for(idx = 0; cs < fsize; idx++)
+		cs <<= 1;
+	return idx;
+}
+#endif /* !DBG_F_MALLOC */
+
 /*SHM wrappers to sync the access to memory block*/
 #ifdef DBG_F_MALLOC
 void *fm_shm_malloc(void *qmp, size_t size, const char *file, const char *func,
@@ -1327,6 +1459,27 @@ void fm_shm_free(void *qmp, void *p, const char *file, const char *func,
 void *fm_shm_malloc(void *qmp, size_t size)
 {
 	void *r;
+	unsigned long csize;
+	int cidx;
+	static unsigned int prof_skip = 0;
+
+	if(unlikely(++prof_skip >= KSR_SHM_PROFILE_STEP)) {
+		prof_skip = 0;
+		ksr_shm_profile_record(
+				__builtin_return_address(0), (unsigned long)size);
+	}
+	cidx = fm_mag_class(size, &csize);
+	if(cidx >= 0) {
+		if(_fm_mag[cidx] != NULL) {
+			r = _fm_mag[cidx];
+			_fm_mag[cidx] = ((fm_mag_item_t *)r)->next;
+			_fm_mag_no[cidx]--;
+			return r;
+		}
+		/* miss - allocate the full class size so the chunk stays
+		 * reusable by its class after free */
+		size = csize;
+	}
 	fm_shm_lock();
 	r = fm_malloc(qmp, size);
 	fm_shm_unlock();
@@ -1335,9 +1488,11 @@ void *fm_shm_malloc(void *qmp, size_t size)
 void *fm_shm_mallocxz(void *qmp, size_t size)
 {
 	void *r;
-	fm_shm_lock();
-	r = fm_mallocxz(qmp, size);
-	fm_shm_unlock();
+
+	/* zero outside the global lock */
+	r = fm_shm_malloc(qmp, size);
+	if(likely(r != NULL))
+		memset(r, 0, size);
 	return r;
 }
 void *fm_shm_realloc(void *qmp, void *p, size_t size)
@@ -1368,11 +1523,32 @@ void *fm_shm_resize(void *qmp, void *p, size_t size)
 }
 void fm_shm_free(void *qmp, void *p)
 {
+	struct fm_frag *f;
+	int cidx;
+
+	if(likely(p != NULL)) {
+		f = (struct fm_frag *)((char *)p - sizeof(struct fm_frag));
+		cidx = fm_mag_class_exact(f->size);
+		if(cidx >= 0 && _fm_mag_no[cidx] < FM_MAG_CAP) {
+			((fm_mag_item_t *)p)->next = _fm_mag[cidx];
+			_fm_mag[cidx] = (fm_mag_item_t *)p;
+			_fm_mag_no[cidx]++;
+			return;
+		}
+	}
 	fm_shm_lock();
 	fm_free(qmp, p);
 	fm_shm_unlock();
 }
 #endif
+int fm_shm_defrag(void *qmp, int max_frags)
+{
+	int r;
+	fm_shm_lock();
+	r = fm_defrag(qmp, max_frags);
+	fm_shm_unlock();
+	return r;
+}
 void fm_shm_status(void *qmp)
 {
 	fm_shm_lock();
@@ -1460,6 +1636,7 @@ int fm_malloc_init_shm_manager(void)
 	ma.xfmodstats = fm_shm_mod_free_stats;
 	ma.xglock = fm_shm_glock;
 	ma.xgunlock = fm_shm_gunlock;
+	ma.xdefrag = fm_shm_defrag;
 
 	if(shm_init_api(&ma) < 0) {
 		LM_ERR("cannot initialize the core shm api\n");
@@ -115,7 +115,7 @@ struct fm_block
 	unsigned long real_used; /** used + malloc overhead */
 	unsigned long max_real_used;
 	unsigned long ffrags;
-	unsigned long reserved1;
+	unsigned long defrag_pos; /** resume bucket for fm_defrag() sweeps */
 
 	struct fm_frag *first_frag;
 	struct fm_frag *last_frag;
@@ -239,6 +239,15 @@ void fm_info(void *qmp, struct mem_info *info);
 unsigned long fm_available(void *qmp);
 
 
+/**
+ * \brief Bounded free-fragment coalescing sweep, resumable across calls
+ * \param qmp memory block
+ * \param max_frags maximum number of free fragments to visit
+ * \return number of joins performed
+ */
+int fm_defrag(void *qmp, int max_frags);
+
+
 /**
  * \brief Debugging helper, summary and logs all allocated memory blocks
  * \param qm memory block
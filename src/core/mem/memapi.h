@@ -64,6 +64,8 @@ typedef void (*sr_mem_mod_free_stats_f)(void *mbp);
 
 typedef void (*sr_setfunc_f)(void *mbp, void *p, char *func);
 
+typedef int (*sr_shm_defrag_f)(void *mbp, int max_frags);
+
 /*private memory api*/
 typedef struct sr_pkg_api
 {
@@ -152,6 +154,8 @@ typedef struct sr_shm_api
 	sr_shm_gunlock_f xgunlock;
 	/*memory chunk set func pointer*/
 	sr_setfunc_f xsetfunc;
+	/*optional bounded free-fragment coalescing sweep*/
+	sr_shm_defrag_f xdefrag;
 } sr_shm_api_t;
 
 #endif
@@ -41,6 +41,8 @@ struct mem_info
 	unsigned long max_used;	   /** maximum used size since server start? */
 	unsigned long min_frag;	   /** minimum number of fragmentations? */
 	unsigned long total_frags; /** number of total memory fragments */
+	unsigned long max_free_frag; /** size of the largest free fragment
+								  * (fragmentation index; 0 = unknown) */
 };
 
 typedef struct _mem_counter
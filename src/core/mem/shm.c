@@ -103,24 +103,71 @@ int shm_core_pools_init(void)
 
 	for(i = 0; i < _shm_core_pools_num; i++) {
 #ifdef SHM_MMAP
+		_shm_core_pools_mem[i] = (void *)-1;
+#ifdef MAP_HUGETLB
+		if(shm_huge_pages) {
+			/* explicit huge page backing - needs reserved huge pages
+			 * (vm.nr_hugepages), otherwise fall back to normal pages */
+			_shm_core_pools_mem[i] = mmap(0, shm_mem_size,
+					PROT_READ | PROT_WRITE,
+					MAP_ANONYMOUS | MAP_SHARED | MAP_HUGETLB, -1, 0);
+			if(_shm_core_pools_mem[i] == (void *)-1) {
+				LOG(L_WARN,
+						"huge page backing for shm pool[%d] failed: %s"
+						" - falling back to normal pages\n",
+						i, strerror(errno));
+			} else {
+				LOG(L_INFO, "shm pool[%d] (%lu bytes) backed by huge "
+							"pages\n",
+						i, (unsigned long)shm_mem_size);
+			}
+		}
+#endif /* MAP_HUGETLB */
+		if(_shm_core_pools_mem[i] == (void *)-1) {
 #ifdef USE_ANON_MMAP
-		_shm_core_pools_mem[i] = mmap(0, shm_mem_size, PROT_READ | PROT_WRITE,
-				MAP_ANON | MAP_SHARED, -1, 0);
+			_shm_core_pools_mem[i] =
+					mmap(0, shm_mem_size, PROT_READ | PROT_WRITE,
+							MAP_ANON | MAP_SHARED, -1, 0);
 #else
-		fd = open("/dev/zero", O_RDWR);
-		if(fd == -1) {
-			LOG(L_CRIT, "could not open /dev/zero [%d]: %s\n", i,
-					strerror(errno));
-			return -1;
-		}
-		_shm_core_pools_mem[i] = mmap(
-				0, shm_mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-		/* close /dev/zero */
-		close(fd);
+			fd = open("/dev/zero", O_RDWR);
+			if(fd == -1) {
+				LOG(L_CRIT, "could not open /dev/zero [%d]: %s\n", i,
+						strerror(errno));
+				return -1;
+			}
+			_shm_core_pools_mem[i] = mmap(0, shm_mem_size,
+					PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			/* close /dev/zero */
+			close(fd);
 #endif /* USE_ANON_MMAP */
+#ifdef MADV_HUGEPAGE
+			if(shm_huge_pages && _shm_core_pools_mem[i] != (void *)-1
+					&& madvise(_shm_core_pools_mem[i], shm_mem_size,
+							   MADV_HUGEPAGE)
+							   == 0) {
+				LOG(L_INFO, "shm pool[%d] advised for transparent huge "
+							"pages\n",
+						i);
+			}
+#endif /* MADV_HUGEPAGE */
+		}
 #else
 
-		_shm_core_shmid[i] = shmget(IPC_PRIVATE, shm_mem_size, 0700);
+#ifdef SHM_HUGETLB
+		_shm_core_shmid[i] = -1;
+		if(shm_huge_pages) {
+			_shm_core_shmid[i] =
+					shmget(IPC_PRIVATE, shm_mem_size, 0700 | SHM_HUGETLB);
+			if(_shm_core_shmid[i] == -1) {
+				LOG(L_WARN,
+						"huge page backing for shm segment[%d] failed: %s"
+						" - falling back to normal pages\n",
+						i, strerror(errno));
+			}
+		}
+		if(_shm_core_shmid[i] == -1)
+#endif /* SHM_HUGETLB */
+			_shm_core_shmid[i] = shmget(IPC_PRIVATE, shm_mem_size, 0700);
 		if(_shm_core_shmid[i] == -1) {
 			LOG(L_CRIT, "could not allocate shared memory segment[%d]: %s\n", i,
 					strerror(errno));
@@ -224,6 +271,55 @@ void shm_core_destroy(void)
 	}
 }
 
+/* shared table for the sampling allocation profiler - allocated once
+ * before forking so all processes update the same records */
+ksr_shm_profile_rec_t *_ksr_shm_profile = NULL;
+
+/**
+ * allocate and zero the profile table; to be called after the shm manager
+ * is initialized and before forking
+ */
+int ksr_shm_profile_init(void)
+{
+	if(_ksr_shm_profile != NULL)
+		return 0;
+	_ksr_shm_profile = (ksr_shm_profile_rec_t *)shm_malloc(
+			KSR_SHM_PROFILE_SLOTS * sizeof(ksr_shm_profile_rec_t));
+	if(_ksr_shm_profile == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_ksr_shm_profile, 0,
+			KSR_SHM_PROFILE_SLOTS * sizeof(ksr_shm_profile_rec_t));
+	return 0;
+}
+
+/**
+ * account one sampled allocation of the given size from call site pc;
+ * updates are done without a lock - the records are advisory and sampled,
+ * so a lost increment or a duplicated slot is harmless
+ */
+void ksr_shm_profile_record(void *pc, unsigned long size)
+{
+	unsigned int idx;
+	unsigned int i;
+	ksr_shm_profile_rec_t *rec;
+
+	if(_ksr_shm_profile == NULL)
+		return;
+	idx = (unsigned int)(((unsigned long)pc) >> 4);
+	for(i = 0; i < 8; i++) {
+		rec = &_ksr_shm_profile[(idx + i) & (KSR_SHM_PROFILE_SLOTS - 1)];
+		if(rec->pc == pc || rec->pc == NULL) {
+			rec->pc = pc;
+			rec->count++;
+			rec->bytes += size;
+			return;
+		}
+	}
+	/* neighbourhood full - drop the sample */
+}
+
 /**
  *
  */
@@ -253,6 +349,7 @@ int shm_init_api(sr_shm_api_t *ap)
 	_shm_root.xglock = ap->xglock;
 	_shm_root.xgunlock = ap->xgunlock;
 	_shm_root.xsetfunc = ap->xsetfunc;
+	_shm_root.xdefrag = ap->xdefrag;
 	return 0;
 }
 
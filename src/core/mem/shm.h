@@ -102,6 +102,11 @@ extern sr_shm_api_t _shm_root;
 #define shm_mod_get_stats(x) _shm_root.xmodstats(_shm_root.mem_block, x)
 #define shm_mod_free_stats(x) _shm_root.xfmodstats(x)
 
+/* bounded free-fragment coalescing sweep; returns the number of joins
+ * performed, -1 when the manager does not support it */
+#define shm_defrag(n) \
+	(_shm_root.xdefrag ? _shm_root.xdefrag(_shm_root.mem_block, (n)) : -1)
+
 #define shm_global_lock() _shm_root.xglock(_shm_root.mem_block)
 #define shm_global_unlock() _shm_root.xgunlock(_shm_root.mem_block)
 
@@ -127,6 +132,24 @@ int shm_address_in(void *p);
 	do {                     \
 	} while(0)
 
+/* sampling shm allocation profiler - 1 in KSR_SHM_PROFILE_STEP allocations
+ * records the call site and size in a shared table, cheap enough to stay
+ * always on; dumped by the core.mem_profile rpc */
+#define KSR_SHM_PROFILE_SLOTS 256 /* must be a power of two */
+#define KSR_SHM_PROFILE_STEP 1024
+
+typedef struct ksr_shm_profile_rec
+{
+	void *pc;			 /* sampled allocation call site */
+	unsigned long count; /* sampled allocations from this site */
+	unsigned long bytes; /* sampled bytes allocated from this site */
+} ksr_shm_profile_rec_t;
+
+extern ksr_shm_profile_rec_t *_ksr_shm_profile;
+
+int ksr_shm_profile_init(void);
+void ksr_shm_profile_record(void *pc, unsigned long size);
+
 /* generic logging helper for allocation errors in shared memory pool */
 #define SHM_MEM_ERROR LM_ERR("could not allocate shared memory from shm pool\n")
 #define SHM_MEM_CRITICAL \
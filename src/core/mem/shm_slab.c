@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2025 Daniel-Constantin Mierla (asipto.com)
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * \brief Slab pages for small shared memory objects
+ * \ingroup mem
+ */
+
+#include <string.h>
+
+#include "../globals.h"
+#include "../dprint.h"
+#include "../compiler_opt.h"
+#include "shm.h"
+#include "shm_slab.h"
+
+/* keep carved objects aligned the same way malloc results are */
+#define KSR_SHM_SLAB_ROUND(s) (((s) + 15U) & (~15U))
+#define KSR_SHM_SLAB_HDR KSR_SHM_SLAB_ROUND(sizeof(ksr_shm_slab_page_t))
+
+/**
+ * allocate size bytes for an object, carving from the slab page being
+ * filled when possible - on success *page is set to the owning page (to
+ * be released with ksr_shm_slab_page_unref()), or to NULL when the
+ * object is a plain shm chunk (too large, or allocated before forking)
+ * and has to be released with shm_free(). The page kept open for
+ * filling (at most one per slab and process) is returned to shm once
+ * full and emptied.
+ */
+void *ksr_shm_slab_alloc(
+		ksr_shm_slab_t *slab, unsigned int size, ksr_shm_slab_page_t **page)
+{
+	ksr_shm_slab_page_t *pg;
+	void *p;
+
+	size = KSR_SHM_SLAB_ROUND(size);
+	/* pages are filled without locking - carve only once the process has
+	 * its own slab state (all forking is done from the main process) */
+	if(unlikely(process_no <= 0 || size > KSR_SHM_SLAB_CARVE_MAX)) {
+		*page = NULL;
+		return shm_malloc(size);
+	}
+	pg = slab->crt;
+	if(pg != NULL
+			&& KSR_SHM_SLAB_HDR + pg->used + size > KSR_SHM_SLAB_PAGE_SIZE) {
+		/* page full - drop the fill reference and start a new one */
+		slab->crt = NULL;
+		ksr_shm_slab_page_unref(pg);
+		pg = NULL;
+	}
+	if(pg == NULL) {
+		pg = (ksr_shm_slab_page_t *)shm_malloc(KSR_SHM_SLAB_PAGE_SIZE);
+		if(pg == NULL) {
+			*page = NULL;
+			return NULL;
+		}
+		atomic_set(&pg->refcnt, 1); /* the fill reference */
+		pg->used = 0;
+		slab->crt = pg;
+	}
+	p = (char *)pg + KSR_SHM_SLAB_HDR + pg->used;
+	pg->used += size;
+	atomic_inc(&pg->refcnt);
+	*page = pg;
+	return p;
+}
+
+/**
+ * release one object of the page, freeing the page when the last
+ * reference is gone - safe from any process
+ */
+void ksr_shm_slab_page_unref(ksr_shm_slab_page_t *page)
+{
+	if(atomic_dec_and_test(&page->refcnt))
+		shm_free(page);
+}
+
+/**
+ * same as ksr_shm_slab_page_unref(), for use while holding the shm lock
+ */
+void ksr_shm_slab_page_unref_unsafe(ksr_shm_slab_page_t *page)
+{
+	if(atomic_dec_and_test(&page->refcnt))
+		shm_free_unsafe(page);
+}
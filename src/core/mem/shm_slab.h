@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2025 Daniel-Constantin Mierla (asipto.com)
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * \brief Slab pages for small shared memory objects
+ * \ingroup mem
+ */
+
+#ifndef _sr_shm_slab_h_
+#define _sr_shm_slab_h_
+
+#include "../atomic_ops.h"
+
+/* bump allocator carving small, related objects (e.g., the (x)avp nodes
+ * created for one call) out of shared slab pages, so a burst of
+ * allocations costs one shm operation per page instead of one per
+ * object. Each page counts its live objects and goes back to shm when
+ * the last one is released, therefore objects can still be freed
+ * individually and from any process. Pages are filled without locking
+ * by the process owning the slab; releases are atomic. */
+
+#define KSR_SHM_SLAB_PAGE_SIZE 8192 /* full size of one slab page */
+#define KSR_SHM_SLAB_CARVE_MAX 2048 /* larger objects get own shm chunk */
+
+typedef struct ksr_shm_slab_page
+{
+	atomic_t refcnt;   /* live objects, +1 while the page is being filled */
+	unsigned int used; /* bump offset - updated only by the owner process */
+} ksr_shm_slab_page_t;
+
+typedef struct ksr_shm_slab
+{
+	ksr_shm_slab_page_t *crt; /* page being filled - per process state */
+} ksr_shm_slab_t;
+
+void *ksr_shm_slab_alloc(
+		ksr_shm_slab_t *slab, unsigned int size, ksr_shm_slab_page_t **page);
+void ksr_shm_slab_page_unref(ksr_shm_slab_page_t *page);
+void ksr_shm_slab_page_unref_unsafe(ksr_shm_slab_page_t *page);
+
+#endif /* _sr_shm_slab_h_ */
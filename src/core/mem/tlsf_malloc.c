@@ -11,6 +11,7 @@
 #include "tlsf_malloc_bits.h"
 #include "src_loc.h"
 #include "memdbg.h"
+#include "shm.h"
 #include "memapi.h"
 #include "../dprint.h"
 #include "../cfg/cfg.h"
@@ -1514,6 +1515,64 @@ int tlsf_shm_lock_init(void)
 	return 0;
 }
 
+#ifndef DBG_TLSF_MALLOC
+/* Per-process magazine cache layered over the shm wrappers, mirroring the
+ * one in f_malloc.c. True per-first-level-index locks are not possible
+ * here: freeing merges a block with its physical neighbours, which moves
+ * blocks between size classes and mutates the shared fl/sl bitmaps, so
+ * every free can touch several classes. Caching whole chunks per process
+ * sidesteps that - the common malloc/free pair of a class skips the
+ * global lock, and the locked TLSF paths are untouched. Freed chunks are
+ * classified from the block header via tlsf_block_size(); only exact
+ * class-sized blocks are cached. Active only in child processes
+ * (process_no > 0) so forked children always start with an empty cache. */
+#define TLSF_MAG_CLASSES 7
+#define TLSF_MAG_MIN_SHIFT 5 /* smallest class: 32 bytes */
+#define TLSF_MAG_MAX_SIZE (1UL << (TLSF_MAG_MIN_SHIFT + TLSF_MAG_CLASSES - 1))
+#define TLSF_MAG_CAP 32 /* max cached chunks per class */
+
+typedef struct tlsf_mag_item
+{
+	struct tlsf_mag_item *next;
+} tlsf_mag_item_t;
+
+static tlsf_mag_item_t *_tlsf_mag[TLSF_MAG_CLASSES];
+static int _tlsf_mag_no[TLSF_MAG_CLASSES];
+
+/* class index for an allocation request, storing the class size in *csize,
+ * or -1 when the request is not cacheable */
+static inline int tlsf_mag_class(unsigned long size, unsigned long *csize)
+{
+	int idx;
+	unsigned long cs;
+
+	if(process_no <= 0 || size > TLSF_MAG_MAX_SIZE)
+		return -1;
+	cs = 1UL << TLSF_MAG_MIN_SHIFT;
+	for(idx = 0; cs < size; idx++)
+		cs <<= 1;
+	*csize = cs;
+	return idx;
+}
+
+/* class index for a block coming back via free, or -1 when its size does
+ * not match a class exactly */
+static inline int tlsf_mag_class_exact(unsigned long bsize)
+{
+	int idx;
+	unsigned long cs;
+
+	if(process_no <= 0 || bsize > TLSF_MAG_MAX_SIZE
+			|| bsize < (1UL << TLSF_MAG_MIN_SHIFT)
+			|| (bsize & (bsize - 1)) != 0)
+		return -1;
+	cs = 1UL << TLSF_MAG_MIN_SHIFT;
+	for(idx = 0; cs < bsize; idx++)
+		cs <<= 1;
+	return idx;
+}
+#endif /* !DBG_TLSF_MALLOC */
+
 /*SHM wrappers to sync the access to memory block*/
 #ifdef DBG_TLSF_MALLOC
 void *tlsf_shm_malloc(void *tlsfmp, size_t size, const char *file,
@@ -1574,6 +1633,27 @@ void tlsf_shm_free(void *tlsfmp, void *p, const char *file, const char *func,
 void *tlsf_shm_malloc(void *tlsfmp, size_t size)
 {
 	void *r;
+	unsigned long csize;
+	int cidx;
+	static unsigned int prof_skip = 0;
+
+	if(unlikely(++prof_skip >= KSR_SHM_PROFILE_STEP)) {
+		prof_skip = 0;
+		ksr_shm_profile_record(
+				__builtin_return_address(0), (unsigned long)size);
+	}
+	cidx = tlsf_mag_class(size, &csize);
+	if(cidx >= 0) {
+		if(_tlsf_mag[cidx] != NULL) {
+			r = _tlsf_mag[cidx];
+			_tlsf_mag[cidx] = ((tlsf_mag_item_t *)r)->next;
+			_tlsf_mag_no[cidx]--;
+			return r;
+		}
+		/* miss - allocate the full class size so the chunk stays
+		 * reusable by its class after free */
+		size = csize;
+	}
 	tlsf_shm_lock();
 	r = tlsf_malloc(tlsfmp, size);
 	tlsf_shm_unlock();
@@ -1582,9 +1662,11 @@ void *tlsf_shm_malloc(void *tlsfmp, size_t size)
 void *tlsf_shm_mallocxz(void *tlsfmp, size_t size)
 {
 	void *r;
-	tlsf_shm_lock();
-	r = tlsf_mallocxz(tlsfmp, size);
-	tlsf_shm_unlock();
+
+	/* zero outside the global lock */
+	r = tlsf_shm_malloc(tlsfmp, size);
+	if(likely(r != NULL))
+		memset(r, 0, size);
 	return r;
 }
 void *tlsf_shm_realloc(void *tlsfmp, void *p, size_t size)
@@ -1615,6 +1697,17 @@ void *tlsf_shm_resize(void *tlsfmp, void *p, size_t size)
 }
 void tlsf_shm_free(void *tlsfmp, void *p)
 {
+	int cidx;
+
+	if(likely(p != NULL)) {
+		cidx = tlsf_mag_class_exact((unsigned long)tlsf_block_size(p));
+		if(cidx >= 0 && _tlsf_mag_no[cidx] < TLSF_MAG_CAP) {
+			((tlsf_mag_item_t *)p)->next = _tlsf_mag[cidx];
+			_tlsf_mag[cidx] = (tlsf_mag_item_t *)p;
+			_tlsf_mag_no[cidx]++;
+			return;
+		}
+	}
 	tlsf_shm_lock();
 	tlsf_free(tlsfmp, p);
 	tlsf_shm_unlock();
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 kamailio.org
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * \brief Zero-initialization audit (compile with -DDBG_ZERO_AUDIT)
+ * \ingroup mem
+ */
+
+#include "zeroaudit.h"
+
+#ifdef DBG_ZERO_AUDIT
+
+#include <string.h>
+
+#include "../dprint.h"
+
+#define ZERO_AUDIT_TAGS 8	   /* distinct audited structures */
+#define ZERO_AUDIT_SAMPLE 64   /* scan 1 of this many frees */
+#define ZERO_AUDIT_REPORT 64   /* log every this many scans */
+
+typedef struct zero_audit_rec
+{
+	const char *tag;
+	unsigned long frees;	 /* audited frees (scanned or not) */
+	unsigned long scans;	 /* sampled scans */
+	unsigned long long tbytes; /* bytes scanned */
+	unsigned long long zbytes; /* bytes found still zero */
+	unsigned int run_off; /* longest still-zero run over all scans */
+	unsigned int run_len;
+} zero_audit_rec_t;
+
+/* per process (counters are process local, each process reports its own
+ * traffic; tags are expected to be string literals, compared by address
+ * first) */
+static zero_audit_rec_t _zero_audit[ZERO_AUDIT_TAGS];
+
+
+static zero_audit_rec_t *zero_audit_rec(const char *tag)
+{
+	int i;
+
+	for(i = 0; i < ZERO_AUDIT_TAGS; i++) {
+		if(_zero_audit[i].tag == tag
+				|| (_zero_audit[i].tag && strcmp(_zero_audit[i].tag, tag) == 0))
+			return &_zero_audit[i];
+		if(_zero_audit[i].tag == 0) {
+			_zero_audit[i].tag = tag;
+			return &_zero_audit[i];
+		}
+	}
+	return 0; /* out of tag slots - not audited */
+}
+
+
+/** scan a zero-filled block right before it is freed (sampled).
+ * @param block - start of the block that was zeroed on allocation
+ * @param size - number of bytes that were zeroed
+ * @param tag - string literal naming the structure (e.g. "sip_msg")
+ */
+void ksr_zero_audit_check(void *block, unsigned int size, const char *tag)
+{
+	zero_audit_rec_t *zr;
+	unsigned char *p;
+	unsigned int i, zc, run, best_off, best_len;
+
+	zr = zero_audit_rec(tag);
+	if(unlikely(zr == 0))
+		return;
+	zr->frees++;
+	if(zr->frees % ZERO_AUDIT_SAMPLE != 0)
+		return;
+
+	p = (unsigned char *)block;
+	zc = 0;
+	run = 0;
+	best_off = 0;
+	best_len = 0;
+	for(i = 0; i < size; i++) {
+		if(p[i] == 0) {
+			zc++;
+			run++;
+			if(run > best_len) {
+				best_len = run;
+				best_off = i + 1 - run;
+			}
+		} else {
+			run = 0;
+		}
+	}
+
+	zr->scans++;
+	zr->tbytes += size;
+	zr->zbytes += zc;
+	if(best_len > zr->run_len) {
+		zr->run_len = best_len;
+		zr->run_off = best_off;
+	}
+
+	if(zr->scans % ZERO_AUDIT_REPORT == 0) {
+		LM_NOTICE("zero audit [%s]: %lu frees, %lu scanned, %llu/%llu bytes"
+				  " still zero at free (%d%%), longest still-zero run %u"
+				  " bytes at offset %u\n",
+				tag, zr->frees, zr->scans, zr->zbytes, zr->tbytes,
+				(int)((100 * zr->zbytes) / (zr->tbytes ? zr->tbytes : 1)),
+				zr->run_len, zr->run_off);
+	}
+}
+
+#endif /* DBG_ZERO_AUDIT */
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 kamailio.org
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ * \file
+ * \brief Zero-initialization audit (compile with -DDBG_ZERO_AUDIT)
+ * \ingroup mem
+ *
+ * Telemetry for finding wasted zero-initialization of large, short lived
+ * structures (sip_msg, tm cells, ...). A structure that is fully memset
+ * on allocation and freed with most of it still zero did not need most
+ * of that memset - either the zeros were read (cheap NULL sentinels) or
+ * never touched at all (dead zeroing, a removal candidate to be confirmed
+ * by inspection).
+ *
+ * Call ksr_zero_audit_check(block, size, tag) right before a zero-filled
+ * block is freed; a sampled fraction of the calls scans the block and the
+ * aggregated per tag results (still-zero ratio, longest still-zero run)
+ * are logged periodically. The scan runs only on sampled frees, so the
+ * mode is safe to leave enabled on production traffic.
+ *
+ * Without -DDBG_ZERO_AUDIT everything compiles to nothing.
+ */
+
+#ifndef _zeroaudit_h
+#define _zeroaudit_h
+
+#ifdef DBG_ZERO_AUDIT
+
+void ksr_zero_audit_check(void *block, unsigned int size, const char *tag);
+
+#else /* DBG_ZERO_AUDIT */
+
+#define ksr_zero_audit_check(block, size, tag) ((void)0)
+
+#endif /* DBG_ZERO_AUDIT */
+
+#endif
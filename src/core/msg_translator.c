@@ -81,6 +81,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <string.h>
 #include <stdio.h>
@@ -118,6 +119,7 @@ str _ksr_xavp_via_params = STR_NULL;
 str _ksr_xavp_via_fields = STR_NULL;
 str _ksr_xavp_via_reply_params = STR_NULL;
 int ksr_local_rport = 0;
+int ksr_fwd_fast_rebuild = 0;
 
 /** per process fixup function for global_req_flags.
   * It should be called from the configuration framework.
@@ -345,6 +347,37 @@ error_overflow:
 }
 
 
+/* per-process grow-only output buffer for BUILD_IN_LOCAL_BUF - reused by
+ * each stateless build/send cycle, so steady-state forwarding does not
+ * allocate the output buffer anymore */
+static char *ksr_build_lbuf = NULL;
+static unsigned int ksr_build_lbuf_size = 0;
+
+/** Returns the per-process build buffer, grown to at least size bytes
+ * (rounded up to 4KB), or NULL on memory error. The content is owned by
+ * the builder - callers must consume it before the next build and must
+ * not free it.
+ */
+static char *ksr_build_lbuf_get(unsigned int size)
+{
+	char *nbuf;
+
+	if(likely(size <= ksr_build_lbuf_size))
+		return ksr_build_lbuf;
+	size = (size + 4095) & (~4095U);
+	nbuf = pkg_malloc(size);
+	if(nbuf == NULL) {
+		PKG_MEM_ERROR;
+		return NULL;
+	}
+	if(ksr_build_lbuf != NULL)
+		pkg_free(ksr_build_lbuf);
+	ksr_build_lbuf = nbuf;
+	ksr_build_lbuf_size = size;
+	return ksr_build_lbuf;
+}
+
+
 char *received_builder(struct sip_msg *msg, unsigned int *received_len)
 {
 	char *buf;
@@ -1602,6 +1635,122 @@ void process_lumps(struct sip_msg *msg, struct lump *lumps, char *new_buf,
 }
 
 
+/* gather variant of process_lumps() for one lump list: instead of copying
+ * into a flat buffer, append iovec entries pointing into the original msg
+ * buffer and the lump values; handles only LUMP_ADD/LUMP_DEL/LUMP_NOP
+ * (LUMP_ADD_SUBST and LUMP_ADD_OPT need per-destination evaluation and a
+ * buffer to print into => the caller must fall back to the flat build)
+ * returns the new number of iovec entries or -1 on unsupported lumps/no
+ * more room in iov (s_offset is updated on success only)
+ */
+static int lumps_to_iovec(struct lump *lumps, char *orig,
+		unsigned int *s_offset, struct iovec *iov, int niov, int iov_max)
+{
+	struct lump *t;
+	struct lump *r;
+	unsigned int offs;
+	int size;
+
+#define IOV_PUT(p, l)                        \
+	do {                                     \
+		if((int)(l) > 0) {                   \
+			if(unlikely(niov >= iov_max))    \
+				return -1;                   \
+			iov[niov].iov_base = (void *)(p); \
+			iov[niov].iov_len = (l);         \
+			niov++;                          \
+		}                                    \
+	} while(0)
+
+	offs = *s_offset;
+	for(t = lumps; t; t = t->next) {
+		switch(t->op) {
+			case LUMP_ADD:
+				for(r = t->before; r; r = r->before) {
+					if(r->op != LUMP_ADD)
+						return -1;
+					IOV_PUT(r->u.value, r->len);
+				}
+				IOV_PUT(t->u.value, t->len);
+				for(r = t->after; r; r = r->after) {
+					if(r->op != LUMP_ADD)
+						return -1;
+					IOV_PUT(r->u.value, r->len);
+				}
+				break;
+			case LUMP_NOP:
+			case LUMP_DEL:
+				if(offs > (unsigned int)t->u.offset) {
+					/* overlapped offsets - ignore, like process_lumps() */
+					break;
+				}
+				/* reference the original msg till the lump offset */
+				size = t->u.offset - offs;
+				IOV_PUT(orig + offs, size);
+				offs += size;
+				for(r = t->before; r; r = r->before) {
+					if(r->op != LUMP_ADD)
+						return -1;
+					IOV_PUT(r->u.value, r->len);
+				}
+				if(t->op == LUMP_DEL) {
+					/* skip the deleted zone */
+					offs += t->len;
+				}
+				for(r = t->after; r; r = r->after) {
+					if(r->op != LUMP_ADD)
+						return -1;
+					IOV_PUT(r->u.value, r->len);
+				}
+				break;
+			default:
+				/* LUMP_ADD_SUBST, LUMP_ADD_OPT a.s.o. */
+				return -1;
+		}
+	}
+	*s_offset = offs;
+	return niov;
+#undef IOV_PUT
+}
+
+
+/* apply the lumps of a sip msg as an iovec array referencing the original
+ * msg->buf slices and the lump values directly, without assembling a flat
+ * copy - for stream destinations the result can be handed to a writev()
+ * based send (see tsend_stream_iov()), saving a full message copy when
+ * there are only few, simple modifications
+ * returns the number of iovec entries filled in, or -1 if the msg has
+ * lumps that need a flat build (substitutions, conditional lumps) or more
+ * than iov_max segments - the caller must then use the regular build_*
+ * functions
+ * note: the iovec points into msg->buf and the lump values => it is valid
+ * only as long as the msg and its lumps are not changed/freed
+ */
+int sip_msg_lumps_to_iovec(struct sip_msg *msg, struct iovec *iov, int iov_max)
+{
+	unsigned int s_offset;
+	int niov;
+
+	s_offset = 0;
+	niov = lumps_to_iovec(msg->add_rm, msg->buf, &s_offset, iov, 0, iov_max);
+	if(niov < 0)
+		return -1;
+	niov = lumps_to_iovec(
+			msg->body_lumps, msg->buf, &s_offset, iov, niov, iov_max);
+	if(niov < 0)
+		return -1;
+	/* the rest of the original message */
+	if(s_offset < msg->len) {
+		if(unlikely(niov >= iov_max))
+			return -1;
+		iov[niov].iov_base = msg->buf + s_offset;
+		iov[niov].iov_len = msg->len - s_offset;
+		niov++;
+	}
+	return niov;
+}
+
+
 /*
  * Adjust/insert Content-Length if necessary
  */
@@ -2059,6 +2208,33 @@ clean:
   * depending on the presence of the BUILD_IN_SHM flag, needs freeing when
   *   done) and sets returned_len or 0 on error.
   */
+/* checks whether the outgoing request can be rebuilt on the fast path:
+ * nothing to apply besides the new local Via, so the lump engine and its
+ * per-forward anchor/lump allocations can be skipped entirely
+ * (enabled with the fwd_fast_rebuild global parameter) */
+static inline int build_req_fast_path_ok(
+		struct sip_msg *msg, struct dest_info *send_info, unsigned int mode,
+		msg_flags_t flags)
+{
+	if(mode != 0)
+		return 0;
+	if(msg->add_rm != 0 || msg->body_lumps != 0)
+		return 0;
+	if(msg->new_uri.s != 0)
+		return 0;
+	if(msg->path_vec.s != 0 && msg->path_vec.len != 0)
+		return 0;
+	if(msg->via1 == 0)
+		return 0;
+	if(received_test(msg) || rport_test(msg))
+		return 0;
+	/* the udp mtu fallback may replace the via and the protocol */
+	if(send_info->proto == PROTO_UDP && (flags & FL_MTU_FB_MASK)
+			&& cfg_get(core, core_cfg, udp_mtu) != 0)
+		return 0;
+	return 1;
+}
+
 char *build_req_buf_from_sip_req(struct sip_msg *msg,
 		unsigned int *returned_len, struct dest_info *send_info,
 		unsigned int mode)
@@ -2111,6 +2287,38 @@ char *build_req_buf_from_sip_req(struct sip_msg *msg,
 		goto error00;
 	}
 
+	if(unlikely(ksr_fwd_fast_rebuild)
+			&& build_req_fast_path_ok(msg, send_info, mode, flags)
+			&& msg->add_rm == 0 /* adjust_clen() might have added a lump */) {
+		/* Via-only rebuild: emit [start][new via][rest of the original
+		 * buffer] directly, without going through the lump engine */
+		branch.s = msg->add_to_branch_s;
+		branch.len = msg->add_to_branch_len;
+		line_buf = create_via_hf(&via_len, msg, send_info, &branch);
+		if(unlikely(!line_buf)) {
+			LM_ERR("could not create Via header\n");
+			goto error00;
+		}
+		offset = msg->via1->hdr.s - buf;
+		new_len = len + via_len;
+		if(unlikely(mode & BUILD_IN_LOCAL_BUF))
+			new_buf = ksr_build_lbuf_get(new_len + 1);
+		else
+			new_buf = (char *)pkg_malloc(new_len + 1);
+		if(new_buf == 0) {
+			ser_error = E_OUT_OF_MEM;
+			PKG_MEM_ERROR;
+			goto error00;
+		}
+		memcpy(new_buf, buf, offset);
+		memcpy(new_buf + offset, line_buf, via_len);
+		memcpy(new_buf + offset + via_len, buf + offset, len - offset);
+		new_buf[new_len] = 0;
+		pkg_free(line_buf);
+		*returned_len = new_len;
+		return new_buf;
+	}
+
 	if(unlikely(mode & BUILD_NO_LOCAL_VIA))
 		goto after_local_via;
 
@@ -2324,6 +2532,8 @@ after_update_via1:
 	}
 	if(unlikely(mode & BUILD_IN_SHM))
 		new_buf = (char *)shm_malloc(new_len + 1);
+	else if(unlikely(mode & BUILD_IN_LOCAL_BUF))
+		new_buf = ksr_build_lbuf_get(new_len + 1);
 	else
 		new_buf = (char *)pkg_malloc(new_len + 1);
 	if(new_buf == 0) {
@@ -53,6 +53,12 @@
 #define BUILD_NO_PATH (1 << 2)
 #define BUILD_NEW_LOCAL_VIA (1 << 3)
 #define BUILD_IN_SHM (1 << 7)
+/* build the output in a per-process reusable buffer owned by the
+ * translator - the result must be consumed before the next build and
+ * must not be freed by the caller */
+#define BUILD_IN_LOCAL_BUF (1 << 8)
+
+#include <sys/uio.h>
 
 #include "parser/msg_parser.h"
 #include "ip_addr.h"
@@ -170,6 +176,12 @@ void process_lumps(struct sip_msg *msg, struct lump *lumps, char *new_buf,
 		unsigned int *new_buf_offs, unsigned int *orig_offs,
 		struct dest_info *send_info, int flag);
 
+/* apply the lumps as an iovec array referencing msg->buf and the lump
+ * values directly (no flat copy) - works only for simple add/del lumps,
+ * returns the number of entries or -1 (=> use the flat build functions)
+ */
+int sip_msg_lumps_to_iovec(struct sip_msg *msg, struct iovec *iov, int iov_max);
+
 /**
  * set the internal buffer for sip msg with obuf and reparse
  */
@@ -50,6 +50,51 @@
 #include "../ut.h"
 #include "parse_ppi_pai.h"
 
+/* per-process recycle list of hdr_field nodes - one node is allocated for
+ * every header scanned into the index, so the cache keeps steady-state
+ * header parsing free of pkg allocator round-trips */
+#define HDR_FIELD_POOL_MAX 512
+static hdr_field_t *_hdr_field_pool = NULL;
+static int _hdr_field_pool_no = 0;
+
+/** Returns a new zeroed hdr_field structure (from the recycle list when
+ * possible) or NULL on memory error.
+ */
+hdr_field_t *hdr_field_new(void)
+{
+	hdr_field_t *hf;
+
+	if(_hdr_field_pool != NULL) {
+		hf = _hdr_field_pool;
+		_hdr_field_pool = hf->next;
+		_hdr_field_pool_no--;
+	} else {
+		hf = (hdr_field_t *)pkg_malloc(sizeof(hdr_field_t));
+		if(hf == NULL) {
+			PKG_MEM_ERROR;
+			return NULL;
+		}
+	}
+	memset(hf, 0, sizeof(hdr_field_t));
+	return hf;
+}
+
+/** Releases a hdr_field structure to the recycle list (or to pkg when the
+ * list is full). The parsed field must have been cleaned already.
+ */
+void hdr_field_free(hdr_field_t *hf)
+{
+	if(hf == NULL)
+		return;
+	if(_hdr_field_pool_no < HDR_FIELD_POOL_MAX) {
+		hf->next = _hdr_field_pool;
+		_hdr_field_pool = hf;
+		_hdr_field_pool_no++;
+	} else {
+		pkg_free(hf);
+	}
+}
+
 /** Frees a hdr_field structure.
  * WARNING: it frees only parsed (and not name.s, body.s)
  */
@@ -217,7 +262,7 @@ void free_hdr_field_lst(struct hdr_field *hf)
 		foo = hf;
 		hf = hf->next;
 		clean_hdr_field(foo);
-		pkg_free(foo);
+		hdr_field_free(foo);
 		foo = 0;
 	}
 }
@@ -252,6 +252,12 @@ static inline int hdr_allocs_parse(struct hdr_field *hdr)
 /** frees a hdr_field structure.
  * WARNING: it frees only parsed (and not name.s, body.s)
  */
+/** allocate a new zeroed hdr_field (per-process recycle list backed) */
+hdr_field_t *hdr_field_new(void);
+
+/** release a hdr_field to the recycle list (parsed must be cleaned) */
+void hdr_field_free(hdr_field_t *hf);
+
 void clean_hdr_field(struct hdr_field *const hf);
 
 
@@ -117,12 +117,10 @@ char *get_hdr_field(
 			/* keep number of vias parsed -- we want to report it in
 			   replies for diagnostic purposes */
 			via_cnt++;
-			vb = pkg_malloc(sizeof(struct via_body));
+			vb = via_body_new();
 			if(vb == 0) {
-				PKG_MEM_ERROR;
 				goto error;
 			}
-			memset(vb, 0, sizeof(struct via_body));
 			hdr->body.s = tmp;
 			tmp = parse_via(tmp, end, vb);
 			if(vb->error == PARSE_ERROR) {
@@ -312,6 +310,15 @@ int parse_headers(
 	char *end;
 	hdr_flags_t orig_flag;
 
+	/* if the end of headers was reached on a previous call, the header
+	 * index (msg->headers and the well-known hf pointers) is complete -
+	 * repeated lookups for header fields not present in the message
+	 * return directly instead of allocating a hdr_field and re-probing
+	 * the end-of-headers position each time */
+	if(likely(next == 0 && (msg->parsed_flag & HDR_EOH_F))) {
+		return 0;
+	}
+
 	end = msg->buf + msg->len;
 	tmp = msg->unparsed;
 
@@ -327,13 +334,11 @@ int parse_headers(
 #endif
 	while(tmp < end && (flags & msg->parsed_flag) != flags) {
 		prefetch_loc_r(tmp + 64, 1);
-		hf = pkg_malloc(sizeof(struct hdr_field));
+		hf = hdr_field_new();
 		if(unlikely(hf == 0)) {
-			PKG_MEM_ERROR;
 			ser_error = E_OUT_OF_MEM;
 			goto error;
 		}
-		memset(hf, 0, sizeof(struct hdr_field));
 		hf->type = HDR_ERROR_T;
 		rest = get_hdr_field(tmp, end, hf);
 		switch(hf->type) {
@@ -345,7 +350,7 @@ int parse_headers(
 			case HDR_EOH_T:
 				msg->eoh = tmp; /* or rest?*/
 				msg->parsed_flag |= HDR_EOH_F;
-				pkg_free(hf);
+				hdr_field_free(hf);
 				goto skip;
 			case HDR_ACCEPTCONTACT_T:
 			case HDR_ALLOWEVENTS_T:
@@ -682,7 +687,7 @@ skip:
 error:
 	if(hf) {
 		clean_hdr_field(hf);
-		pkg_free(hf);
+		hdr_field_free(hf);
 	}
 
 error1:
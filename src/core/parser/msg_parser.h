@@ -140,6 +140,8 @@ typedef enum request_method
 #define FL_FINAL_REPLY (1ULL << 32)	   /* local final reply sent */
 #define FL_DELAYED_REPLY (1ULL << 33)  /* local reply sending delayed */
 #define FL_VIA_NORECEIVED (1ULL << 34) /* no received test for incoming Via */
+#define FL_HDR_PRUNED \
+	(1ULL << 35) /* shm clone built from a header-pruned buffer */
 
 #define FL_MTU_FB_MASK (FL_MTU_TCP_FB | FL_MTU_TLS_FB | FL_MTU_SCTP_FB)
 
@@ -330,20 +332,35 @@ typedef struct msg_ldata
 	void *vdata;
 } msg_ldata_t;
 
-/*! \brief The SIP message */
+/*! \brief The SIP message
+ * - the leading fields are the ones touched on every message (parsing
+ *   state, buffer, flags) so they share the first cache lines; the
+ *   rarely-used fields follow - keep this grouping when adding fields */
 typedef struct sip_msg
 {
 	unsigned int id;			   /*!< message id, unique/process*/
 	int pid;					   /*!< process id */
-	struct timeval tval;		   /*!< time value associated to message */
-	snd_flags_t fwd_send_flags;	   /*!< send flags for forwarding */
-	snd_flags_t rpl_send_flags;	   /*!< send flags for replies */
-	struct msg_start first_line;   /*!< Message first line */
-	struct via_body *via1;		   /*!< The first via */
-	struct via_body *via2;		   /*!< The second via */
+	char *buf;					   /*!< scratch pad, holds a modified message,
+									*  via, etc. point into it */
+	unsigned int len;			   /*!< message len (orig) */
+	int parsed_uri_ok;			   /*!< 1 if parsed_uri is valid, 0 if not,
+									* set it to 0 if you modify the uri
+									* (e.g change new_uri)*/
 	struct hdr_field *headers;	   /*!< All the parsed headers*/
 	struct hdr_field *last_header; /*!< Pointer to the last parsed header*/
 	hdr_flags_t parsed_flag;	   /*!< Already parsed header field types */
+	char *eoh;		/*!< pointer to the end of header (if found) or null */
+	char *unparsed; /*!< here we stopped parsing*/
+	msg_flags_t msg_flags; /*!< internal flags used by core */
+	flag_t flags;		   /*!< config flags */
+	unsigned int hash_index;	 /*!< index to TM hash table; stored in core
+								to avoid unnecessary calculations */
+	struct timeval tval;		 /*!< time value associated to message */
+	snd_flags_t fwd_send_flags;	 /*!< send flags for forwarding */
+	snd_flags_t rpl_send_flags;	 /*!< send flags for replies */
+	struct msg_start first_line; /*!< Message first line */
+	struct via_body *via1;		 /*!< The first via */
+	struct via_body *via2;		 /*!< The second via */
 
 	/* Via, To, CSeq, Call-Id, From, end of header*/
 	/* pointers to the first occurrences of these headers;
@@ -397,15 +414,8 @@ typedef struct sip_msg
 
 	struct msg_body *body;
 
-	char *eoh;		/*!< pointer to the end of header (if found) or null */
-	char *unparsed; /*!< here we stopped parsing*/
-
 	struct receive_info rcv; /*!< source & dest ip, ports, proto a.s.o*/
 
-	char *buf;		  /*!< scratch pad, holds a modified message,
-						*  via, etc. point into it */
-	unsigned int len; /*!< message len (orig) */
-
 	/* modifications */
 
 	str new_uri; /*!< changed first line uri, when you change this
@@ -414,9 +424,8 @@ typedef struct sip_msg
 	str dst_uri; /*!< Destination URI, must be forwarded to this URI if len != 0 */
 
 	/* current uri */
-	int parsed_uri_ok; /*!< 1 if parsed_uri is valid, 0 if not, set if to 0
-						if you modify the uri (e.g change new_uri)*/
-	struct sip_uri parsed_uri; /*!< speed-up > keep here the parsed uri*/
+	struct sip_uri parsed_uri; /*!< speed-up > keep here the parsed uri;
+								* valid only if parsed_uri_ok == 1 */
 	int parsed_orig_ruri_ok; /*!< 1 if parsed_orig_uri is valid, 0 if not, set if to 0
 								if you modify the uri (e.g change new_uri)*/
 	struct sip_uri
@@ -431,10 +440,6 @@ typedef struct sip_msg
 	char add_to_branch_s[MAX_BRANCH_PARAM_LEN];
 	int add_to_branch_len;
 
-	unsigned int hash_index;		/*!< index to TM hash table; stored in core
-								to avoid unnecessary calculations */
-	msg_flags_t msg_flags;			/*!< internal flags used by core */
-	flag_t flags;					/*!< config flags */
 	flag_t xflags[KSR_XFLAGS_SIZE]; /*!< config extended flags */
 	str set_global_address;
 	str set_global_port;
@@ -179,6 +179,31 @@ unsigned char *_ksr_hname_extra_chars = (unsigned char *)"";
  */
 static unsigned char _ksr_hname_chars_idx[KSR_HDR_MAP_IDX_SIZE];
 
+/**
+ * lowered 8-byte prefix keys of the names in _ksr_hdr_map[] - wide-integer
+ * filter to skip the strncasecmp() for non-matching candidates
+ */
+static unsigned long long
+		_ksr_hdr_map_pfx[sizeof(_ksr_hdr_map) / sizeof(ksr_hdr_map_t)];
+
+/**
+ * case-insensitive key built from the first (at most) 8 chars of the name
+ */
+static inline unsigned long long ksr_hname_pfx_key(const char *s, int len)
+{
+	unsigned long long k;
+	int i;
+
+	if(len > 8) {
+		len = 8;
+	}
+	k = 0;
+	for(i = 0; i < len; i++) {
+		k |= ((unsigned long long)(unsigned char)(s[i] | 0x20)) << (8 * i);
+	}
+	return k;
+}
+
 
 /**
  * init header name parsing structures and indexes at very beginning of start up
@@ -204,6 +229,8 @@ int ksr_hname_init_index(void)
 			_ksr_hdr_map_idx[tolower(c)].idxe = i;
 			_ksr_hdr_map_idx[toupper(c)].idxe = i;
 		}
+		_ksr_hdr_map_pfx[i] = ksr_hname_pfx_key(
+				_ksr_hdr_map[i].hname.s, _ksr_hdr_map[i].hname.len);
 	}
 
 	for(i = 0; _ksr_hname_chars_list[i] != 0; i++) {
@@ -240,6 +267,7 @@ char *parse_sip_header_name(char *const begin, const char *const end,
 		hdr_field_t *const hdr, int emode, int logmode)
 {
 	char *p;
+	unsigned long long hkey;
 	int i;
 
 	if(begin == NULL || end == NULL || end <= begin) {
@@ -302,10 +330,12 @@ char *parse_sip_header_name(char *const begin, const char *const end,
 done:
 	/* lookup header type */
 	if(_ksr_hdr_map_idx[(unsigned char)(hdr->name.s[0])].idxs >= 0) {
+		hkey = ksr_hname_pfx_key(hdr->name.s, hdr->name.len);
 		for(i = _ksr_hdr_map_idx[(unsigned char)(hdr->name.s[0])].idxs;
 				i <= _ksr_hdr_map_idx[(unsigned char)(hdr->name.s[0])].idxe;
 				i++) {
 			if(hdr->name.len == _ksr_hdr_map[i].hname.len
+					&& hkey == _ksr_hdr_map_pfx[i]
 					&& strncasecmp(hdr->name.s, _ksr_hdr_map[i].hname.s,
 							   hdr->name.len)
 							   == 0) {
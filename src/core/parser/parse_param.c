@@ -550,6 +550,31 @@ int parse_param(str *_s, pclass_t _c, param_hooks_t *_h, param_t *t)
 	return parse_param2(_s, _c, _h, t, ';');
 }
 
+/* per-process recycle list of param_t nodes - parameter lists are built
+ * and freed for nearly every message (contact, via, to/from params), the
+ * cache skips the pkg allocator for each node; the nodes are plain pkg
+ * allocations, so a stray pkg_free() on one of them stays safe */
+#define PARAM_POOL_MAX 1024
+static param_t *_param_pool = NULL;
+static int _param_pool_no = 0;
+
+static inline param_t *param_new(void)
+{
+	param_t *t;
+
+	if(_param_pool != NULL) {
+		t = _param_pool;
+		_param_pool = t->next;
+		_param_pool_no--;
+		return t;
+	}
+	t = (param_t *)pkg_malloc(sizeof(param_t));
+	if(t == NULL) {
+		PKG_MEM_ERROR;
+	}
+	return t;
+}
+
 /*! \brief
  * Parse parameters
  * \param _s is string containing parameters, it will be updated to point behind the parameters
@@ -592,9 +617,8 @@ int parse_params2(
 	}
 
 	while(1) {
-		t = (param_t *)pkg_malloc(sizeof(param_t));
+		t = param_new();
 		if(t == 0) {
-			PKG_MEM_ERROR;
 			goto error;
 		}
 
@@ -635,10 +659,16 @@ static inline void do_free_params(param_t *_p, int _shm)
 	while(_p) {
 		ptr = _p;
 		_p = _p->next;
-		if(_shm)
+		if(_shm) {
 			shm_free(ptr);
-		else
+		} else if(_param_pool_no < PARAM_POOL_MAX) {
+			/* recycle the node instead of freeing it */
+			ptr->next = _param_pool;
+			_param_pool = ptr;
+			_param_pool_no++;
+		} else {
 			pkg_free(ptr);
+		}
 	}
 }
 
@@ -61,6 +61,34 @@ int uri_host_char_allowed(char c)
 	return 0;
 }
 
+/* chars that can change the automaton state in the user part (URI_BRK_USER),
+ * respectively in the generic param/value/headers parts (URI_BRK_PARAM) -
+ * runs of any other chars leave those states untouched and can be skipped
+ * without going through the switch */
+#define URI_BRK_USER 1
+#define URI_BRK_PARAM 2
+/* clang-format off */
+static const unsigned char _ksr_uri_break_tbl[256] = {
+	['@'] = URI_BRK_USER | URI_BRK_PARAM,
+	[':'] = URI_BRK_USER | URI_BRK_PARAM,
+	[';'] = URI_BRK_USER | URI_BRK_PARAM,
+	['?'] = URI_BRK_USER | URI_BRK_PARAM,
+	['.'] = URI_BRK_USER,
+	['-'] = URI_BRK_USER,
+	['('] = URI_BRK_USER,
+	[')'] = URI_BRK_USER,
+	['['] = URI_BRK_USER,
+	[']'] = URI_BRK_USER,
+};
+/* clang-format on */
+
+/* fast-forward p over a run of chars without any of the class bits set
+ * (the current char was already handled by the state switch) */
+#define uri_skip_run(p, end, class)              \
+	while((p) + 1 < (end)                        \
+			&& (_ksr_uri_break_tbl[(unsigned char)(p)[1]] & (class)) == 0) \
+	(p)++
+
 /* buf= pointer to beginning of uri (sip:x@foo.bar:5060;a=b?h=i)
  * len= len of uri
  * returns: fills uri & returns <0 on error or 0 if ok
@@ -548,6 +576,9 @@ int parse_uri(char *buf, int len, struct sip_uri *uri)
 					case '[':
 					case ']': /* the user part cannot contain "[]" */
 						goto error_bad_char;
+					default:
+						/* ordinary user char - skip ahead the whole run */
+						uri_skip_run(p, end, URI_BRK_USER);
 				}
 				break;
 			case URI_PASSWORD: /* this can also be the port (missing user)*/
@@ -752,6 +783,8 @@ int parse_uri(char *buf, int len, struct sip_uri *uri)
 				 *  maddr, transport, ttl, lr, user, method, r2  */
 				switch(*p) {
 					param_common_cases;
+					default:
+						uri_skip_run(p, end, URI_BRK_PARAM);
 				};
 				break;
 				/* ugly but fast param names parsing */
@@ -800,6 +833,8 @@ int parse_uri(char *buf, int len, struct sip_uri *uri)
 			case URI_VAL_P:
 				switch(*p) {
 					value_common_cases;
+					default:
+						uri_skip_run(p, end, URI_BRK_PARAM);
 				}
 				break;
 				/* udp */
@@ -1068,6 +1103,8 @@ int parse_uri(char *buf, int len, struct sip_uri *uri)
 							pass = 0;
 						}
 						break;
+					default:
+						uri_skip_run(p, end, URI_BRK_PARAM);
 				}
 				break;
 			default:
@@ -33,6 +33,7 @@
 #include <string.h>
 #include "../dprint.h"
 #include "../ut.h"
+#include "../hashes.h"
 #include "../mem/mem.h"
 #include "../ip_addr.h"
 #include "parse_via.h"
@@ -173,6 +174,59 @@ enum
 };
 
 
+/* per-process recycle lists for via_body and via_param nodes - every
+ * message allocates and releases at least one of each, so the caches keep
+ * steady-state via parsing free of pkg allocator round-trips; all frees
+ * funnel through free_via_list()/free_via_param_list() below */
+#define VIA_BODY_POOL_MAX 128
+#define VIA_PARAM_POOL_MAX 512
+static struct via_body *_via_body_pool = NULL;
+static int _via_body_pool_no = 0;
+static struct via_param *_via_param_pool = NULL;
+static int _via_param_pool_no = 0;
+
+/** Returns a new zeroed via_body structure (from the recycle list when
+ * possible) or NULL on memory error.
+ */
+struct via_body *via_body_new(void)
+{
+	struct via_body *vb;
+
+	if(_via_body_pool != NULL) {
+		vb = _via_body_pool;
+		_via_body_pool = vb->next;
+		_via_body_pool_no--;
+	} else {
+		vb = pkg_malloc(sizeof(struct via_body));
+		if(vb == 0) {
+			PKG_MEM_ERROR;
+			return NULL;
+		}
+	}
+	memset(vb, 0, sizeof(struct via_body));
+	return vb;
+}
+
+static inline struct via_param *via_param_new(void)
+{
+	struct via_param *vp;
+
+	if(_via_param_pool != NULL) {
+		vp = _via_param_pool;
+		_via_param_pool = vp->next;
+		_via_param_pool_no--;
+	} else {
+		vp = pkg_malloc(sizeof(struct via_param));
+		if(vp == 0) {
+			PKG_MEM_ERROR;
+			return NULL;
+		}
+	}
+	memset(vp, 0, sizeof(struct via_param));
+	return vp;
+}
+
+
 /* entry state must be F_PARAM, or saved_state=F_PARAM and
  * state=F_{LF,CR,CRLF}!
  * output state = L_PARAM or F_PARAM or END_OF_HEADER
@@ -1340,6 +1394,23 @@ error:
 }
 
 
+/*
+ * precompute the transaction matching hash over branch value and host
+ * - stored in vb->mhash and used by tm as prefilter before the full
+ *   field-by-field via comparison (0 = not available)
+ */
+static void via_compute_mhash(struct via_body *vb)
+{
+	if(vb->branch != 0 && vb->branch->value.s != 0 && vb->branch->value.len > 0
+			&& vb->host.s != 0 && vb->host.len > 0) {
+		vb->mhash = get_hash2_raw(&vb->branch->value, &vb->host);
+		if(vb->mhash == 0) {
+			vb->mhash = 1;
+		}
+	}
+}
+
+
 /*
  * call it with a vb initialized to 0
  * returns: pointer after the parsed parts and sets vb->error
@@ -2534,12 +2605,10 @@ main_via:
 							/*state=P_PARAM*/;
 						if(vb->params.s == 0)
 							vb->params.s = param_start;
-						param = pkg_malloc(sizeof(struct via_param));
+						param = via_param_new();
 						if(param == 0) {
-							PKG_MEM_ERROR;
 							goto error;
 						}
-						memset(param, 0, sizeof(struct via_param));
 						param->start = param_start;
 						tmp = parse_via_param(
 								tmp, end, &state, &saved_state, param, vb);
@@ -2714,6 +2783,7 @@ endofpacket:
 			}
 		}
 	}
+	via_compute_mhash(vb);
 	return tmp;
 nextvia:
 	DBG("parsing via: next via\n");
@@ -2739,14 +2809,13 @@ nextvia:
 			}
 		}
 	}
+	via_compute_mhash(vb);
 
-	vb->next = pkg_malloc(sizeof(struct via_body));
+	vb->next = via_body_new();
 	if(vb->next == 0) {
-		PKG_MEM_ERROR;
 		goto error;
 	}
 	vb = vb->next;
-	memset(vb, 0, sizeof(struct via_body));
 	buffer = tmp;
 	goto parse_again;
 
@@ -2774,7 +2843,13 @@ static inline void free_via_param_list(struct via_param *vp)
 	while(vp) {
 		foo = vp;
 		vp = vp->next;
-		pkg_free(foo);
+		if(_via_param_pool_no < VIA_PARAM_POOL_MAX) {
+			foo->next = _via_param_pool;
+			_via_param_pool = foo;
+			_via_param_pool_no++;
+		} else {
+			pkg_free(foo);
+		}
 	}
 }
 
@@ -2787,7 +2862,13 @@ void free_via_list(struct via_body *vb)
 		vb = vb->next;
 		if(foo->param_lst)
 			free_via_param_list(foo->param_lst);
-		pkg_free(foo);
+		if(_via_body_pool_no < VIA_BODY_POOL_MAX) {
+			foo->next = _via_body_pool;
+			_via_body_pool = foo;
+			_via_body_pool_no++;
+		} else {
+			pkg_free(foo);
+		}
 	}
 }
 
@@ -107,7 +107,10 @@ typedef struct via_body
 
 	/* shortcuts to "important" params*/
 	struct via_param *branch;
-	str tid; /* transaction id, part of branch */
+	str tid;			/* transaction id, part of branch */
+	unsigned int mhash; /* precomputed hash over branch value and host, used
+							as prefilter for transaction matching (0 = not
+							available - e.g. no branch param) */
 	struct via_param *received;
 	struct via_param *rport;
 	struct via_param *i;
@@ -132,6 +135,10 @@ char *parse_via(
  */
 void free_via_list(struct via_body *vb);
 
+/* returns a new zeroed via_body (from the per-process recycle list when
+ * possible) or NULL on memory error */
+struct via_body *via_body_new(void);
+
 
 /*
  * Get one Via header
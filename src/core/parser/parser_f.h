@@ -35,6 +35,7 @@
 
 #include "../comp_defs.h"
 #include "../str.h"
+#include "../ut.h"
 
 char *eat_line(char *buffer, unsigned int len);
 
@@ -66,6 +67,16 @@ inline static char *eat_lws_end(const char *p, const char *pend)
 
 inline static char *eat_token_end(const char *p, const char *pend)
 {
+	unsigned long long w;
+
+	/* skip word-at-a-time over runs without a delimiter */
+	while(p + sizeof(w) <= pend) {
+		memcpy(&w, p, sizeof(w));
+		if(KSR_SWAR_HASBYTE(w, ' ') | KSR_SWAR_HASBYTE(w, '\t')
+				| KSR_SWAR_HASBYTE(w, '\n') | KSR_SWAR_HASBYTE(w, '\r'))
+			break;
+		p += sizeof(w);
+	}
 	for(; (p < pend) && (*p != ' ') && (*p != '\t') && (*p != '\n')
 			&& (*p != '\r');
 			p++)
@@ -76,6 +87,15 @@ inline static char *eat_token_end(const char *p, const char *pend)
 
 inline static char *eat_token2_end(const char *p, const char *pend, char delim)
 {
+	unsigned long long w;
+
+	while(p + sizeof(w) <= pend) {
+		memcpy(&w, p, sizeof(w));
+		if(KSR_SWAR_HASBYTE(w, delim) | KSR_SWAR_HASBYTE(w, '\n')
+				| KSR_SWAR_HASBYTE(w, '\r'))
+			break;
+		p += sizeof(w);
+	}
 	for(; (p < pend) && (*p != (delim)) && (*p != '\n') && (*p != '\r'); p++)
 		;
 	return (char *)p;
@@ -38,6 +38,42 @@
 #define SDP_USE_PKG_MEM 0
 #define SDP_USE_SHM_MEM 1
 
+#define SDP_ARENA_BLK_SIZE 2048 /* usable bytes per arena block */
+#define SDP_ARENA_ALIGN(s) (((s) + (sizeof(void *) - 1)) & ~(sizeof(void *) - 1))
+
+/**
+ * Allocate (zeroed) space for a tree node from the sdp arena
+ * - grows the arena with pkg blocks as needed; everything is released
+ *   at once in free_sdp()
+ */
+void *sdp_arena_alloc(sdp_info_t *_sdp, int size)
+{
+	sdp_arena_blk_t *blk;
+	unsigned int bsize;
+	char *p;
+
+	size = SDP_ARENA_ALIGN(size);
+	blk = _sdp->arena;
+	if(blk == NULL || blk->used + size > blk->size) {
+		bsize = ((unsigned int)size > SDP_ARENA_BLK_SIZE)
+						? (unsigned int)size
+						: SDP_ARENA_BLK_SIZE;
+		blk = (sdp_arena_blk_t *)pkg_malloc(sizeof(sdp_arena_blk_t) + bsize);
+		if(blk == NULL) {
+			PKG_MEM_ERROR;
+			return NULL;
+		}
+		blk->size = bsize;
+		blk->used = 0;
+		blk->next = _sdp->arena;
+		_sdp->arena = blk;
+	}
+	p = (char *)(blk + 1) + blk->used;
+	blk->used += size;
+	memset(p, 0, size);
+	return p;
+}
+
 /**
  * Creates and initialize a new sdp_info structure
  */
@@ -68,12 +104,10 @@ static inline sdp_session_cell_t *add_sdp_session(
 	int len;
 
 	len = sizeof(sdp_session_cell_t);
-	session = (sdp_session_cell_t *)pkg_malloc(len);
+	session = (sdp_session_cell_t *)sdp_arena_alloc(_sdp, len);
 	if(session == NULL) {
-		PKG_MEM_ERROR;
 		return NULL;
 	}
-	memset(session, 0, len);
 
 	session->session_num = session_num;
 	if(cnt_disp != NULL) {
@@ -92,20 +126,18 @@ static inline sdp_session_cell_t *add_sdp_session(
 /**
  * Allocate a new stream cell.
  */
-static inline sdp_stream_cell_t *add_sdp_stream(sdp_session_cell_t *_session,
-		int stream_num, str *media, str *port, str *transport, str *payloads,
-		int is_rtp, int pf, str *sdp_ip)
+static inline sdp_stream_cell_t *add_sdp_stream(sdp_info_t *_sdp,
+		sdp_session_cell_t *_session, int stream_num, str *media, str *port,
+		str *transport, str *payloads, int is_rtp, int pf, str *sdp_ip)
 {
 	sdp_stream_cell_t *stream;
 	int len;
 
 	len = sizeof(sdp_stream_cell_t);
-	stream = (sdp_stream_cell_t *)pkg_malloc(len);
+	stream = (sdp_stream_cell_t *)sdp_arena_alloc(_sdp, len);
 	if(stream == NULL) {
-		PKG_MEM_ERROR;
 		return NULL;
 	}
-	memset(stream, 0, len);
 
 	stream->stream_num = stream_num;
 
@@ -135,19 +167,17 @@ static inline sdp_stream_cell_t *add_sdp_stream(sdp_session_cell_t *_session,
 /**
  * Allocate a new payload.
  */
-static inline sdp_payload_attr_t *add_sdp_payload(
+static inline sdp_payload_attr_t *add_sdp_payload(sdp_info_t *_sdp,
 		sdp_stream_cell_t *_stream, int payload_num, str *payload)
 {
 	sdp_payload_attr_t *payload_attr;
 	int len;
 
 	len = sizeof(sdp_payload_attr_t);
-	payload_attr = (sdp_payload_attr_t *)pkg_malloc(len);
+	payload_attr = (sdp_payload_attr_t *)sdp_arena_alloc(_sdp, len);
 	if(payload_attr == NULL) {
-		PKG_MEM_ERROR;
 		return NULL;
 	}
-	memset(payload_attr, 0, len);
 
 	payload_attr->payload_num = payload_num;
 	payload_attr->rtp_payload.s = payload->s;
@@ -166,7 +196,7 @@ static inline sdp_payload_attr_t *add_sdp_payload(
  * Initialize fast access pointers.
  */
 static inline sdp_payload_attr_t **init_p_payload_attr(
-		sdp_stream_cell_t *_stream, int pkg)
+		sdp_info_t *_sdp, sdp_stream_cell_t *_stream, int pkg)
 {
 	int payloads_num, i;
 	sdp_payload_attr_t *payload;
@@ -181,8 +211,8 @@ static inline sdp_payload_attr_t **init_p_payload_attr(
 		return NULL;
 	}
 	if(pkg == SDP_USE_PKG_MEM) {
-		_stream->p_payload_attr = (sdp_payload_attr_t **)pkg_malloc(
-				payloads_num * sizeof(sdp_payload_attr_t *));
+		_stream->p_payload_attr = (sdp_payload_attr_t **)sdp_arena_alloc(
+				_sdp, payloads_num * sizeof(sdp_payload_attr_t *));
 	} else if(pkg == SDP_USE_SHM_MEM) {
 		_stream->p_payload_attr = (sdp_payload_attr_t **)shm_malloc(
 				payloads_num * sizeof(sdp_payload_attr_t *));
@@ -544,8 +574,8 @@ static int parse_sdp_session(
 		}
 
 		/* Allocate a stream cell */
-		stream = add_sdp_stream(session, stream_num, &sdp_media, &sdp_port,
-				&sdp_transport, &sdp_payload, is_rtp, pf, &sdp_ip);
+		stream = add_sdp_stream(_sdp, session, stream_num, &sdp_media,
+				&sdp_port, &sdp_transport, &sdp_payload, is_rtp, pf, &sdp_ip);
 		if(stream == 0)
 			return -1;
 
@@ -573,7 +603,8 @@ static int parse_sdp_session(
 				a1p = eat_token_end(tmpstr1.s, tmpstr1.s + tmpstr1.len);
 				payload.s = tmpstr1.s;
 				payload.len = a1p - tmpstr1.s;
-				payload_attr = add_sdp_payload(stream, payloadnum, &payload);
+				payload_attr =
+						add_sdp_payload(_sdp, stream, payloadnum, &payload);
 				if(payload_attr == NULL)
 					return -1;
 				tmpstr1.len -= payload.len;
@@ -587,7 +618,7 @@ static int parse_sdp_session(
 			}
 
 			/* Initialize fast access pointers */
-			if(NULL == init_p_payload_attr(stream, SDP_USE_PKG_MEM)) {
+			if(NULL == init_p_payload_attr(_sdp, stream, SDP_USE_PKG_MEM)) {
 				return -1;
 			}
 			parse_payload_attr = 1;
@@ -637,10 +668,10 @@ static int parse_sdp_session(
 						stream, &rtp_payload);
 				set_sdp_payload_fmtp(payload_attr, &fmtp_string);
 			} else if(parse_payload_attr
-					  && extract_candidate(&tmpstr1, stream) == 0) {
+					  && extract_candidate(_sdp, &tmpstr1, stream) == 0) {
 				a1p += 2;
 			} else if(parse_payload_attr
-					  && extract_ice_option(&tmpstr1, stream) == 0) {
+					  && extract_ice_option(_sdp, &tmpstr1, stream) == 0) {
 				a1p += 2;
 			} else if(parse_payload_attr
 					  && extract_field(&tmpstr1, &stream->remote_candidates,
@@ -942,49 +973,20 @@ int parse_sdp(struct sip_msg *_m)
 void free_sdp(sdp_info_t **_sdp)
 {
 	sdp_info_t *sdp = *_sdp;
-	sdp_session_cell_t *session, *l_session;
-	sdp_stream_cell_t *stream, *l_stream;
-	sdp_payload_attr_t *payload, *l_payload;
-	sdp_ice_attr_t *ice_attr, *l_ice_attr;
-	sdp_ice_opt_t *ice_opt, *l_ice_opt;
+	sdp_arena_blk_t *blk, *l_blk;
 
 	LM_DBG("_sdp = %p\n", _sdp);
 	if(sdp == NULL)
 		return;
 	LM_DBG("sdp = %p\n", sdp);
-	session = sdp->sessions;
-	LM_DBG("session = %p\n", session);
-	while(session) {
-		l_session = session;
-		session = session->next;
-		stream = l_session->streams;
-		while(stream) {
-			l_stream = stream;
-			stream = stream->next;
-			payload = l_stream->payload_attr;
-			while(payload) {
-				l_payload = payload;
-				payload = payload->next;
-				pkg_free(l_payload);
-			}
-			if(l_stream->p_payload_attr) {
-				pkg_free(l_stream->p_payload_attr);
-			}
-			ice_attr = l_stream->ice_attr;
-			while(ice_attr) {
-				l_ice_attr = ice_attr;
-				ice_attr = ice_attr->next;
-				pkg_free(l_ice_attr);
-			}
-			ice_opt = l_stream->ice_opt;
-			while(ice_opt) {
-				l_ice_opt = ice_opt;
-				ice_opt = ice_opt->next;
-				pkg_free(l_ice_opt);
-			}
-			pkg_free(l_stream);
-		}
-		pkg_free(l_session);
+	/* the whole tree (sessions, streams, payloads, ice attrs/opts and the
+	 * p_payload_attr arrays) lives in the arena blocks - release them in
+	 * one pass instead of walking the tree */
+	blk = sdp->arena;
+	while(blk) {
+		l_blk = blk;
+		blk = blk->next;
+		pkg_free(l_blk);
 	}
 	pkg_free(sdp);
 	*_sdp = NULL;
@@ -1358,7 +1360,7 @@ sdp_stream_cell_t *clone_sdp_stream_cell(sdp_stream_cell_t *stream)
 	clone_stream->payloads_num = stream->payloads_num;
 
 	if(clone_stream->payloads_num) {
-		if(NULL == init_p_payload_attr(clone_stream, SDP_USE_SHM_MEM)) {
+		if(NULL == init_p_payload_attr(NULL, clone_stream, SDP_USE_SHM_MEM)) {
 			goto error;
 		}
 	}
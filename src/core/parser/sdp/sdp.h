@@ -140,6 +140,17 @@ typedef struct sdp_session_cell
 	struct sdp_stream_cell *streams;
 } sdp_session_cell_t;
 
+/**
+ * Arena block holding parsed sdp tree nodes - all the blocks of a message
+ * are released at once in free_sdp()
+ */
+typedef struct sdp_arena_blk
+{
+	struct sdp_arena_blk *next;
+	unsigned int size; /**< usable data bytes following the header */
+	unsigned int used; /**< data bytes handed out so far */
+} sdp_arena_blk_t;
+
 /**
  * Here we hold the head of the parsed sdp structure
  */
@@ -152,8 +163,14 @@ typedef struct sdp_info
 	int streams_num;  /**< total number of streams for all SDP sessions */
 	str raw_sdp; /* Pointer to the Raw SDP (Might be embedded in multipart body) */
 	struct sdp_session_cell *sessions;
+	sdp_arena_blk_t *arena; /**< blocks the tree nodes are carved from */
 } sdp_info_t;
 
+/**
+ * Allocate (zeroed) space for a tree node from the sdp arena.
+ */
+void *sdp_arena_alloc(sdp_info_t *_sdp, int size);
+
 
 /*
  * Parse SDP.
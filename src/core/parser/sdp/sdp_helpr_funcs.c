@@ -266,18 +266,17 @@ int extract_fmtp(str *body, str *fmtp_payload, str *fmtp_string)
 /**
  * Allocate a new ice attribute
  */
-static inline sdp_ice_attr_t *add_sdp_ice(sdp_stream_cell_t *_stream)
+static inline sdp_ice_attr_t *add_sdp_ice(
+		sdp_info_t *_sdp, sdp_stream_cell_t *_stream)
 {
 	sdp_ice_attr_t *ice_attr;
 	int len;
 
 	len = sizeof(sdp_ice_attr_t);
-	ice_attr = (sdp_ice_attr_t *)pkg_malloc(len);
+	ice_attr = (sdp_ice_attr_t *)sdp_arena_alloc(_sdp, len);
 	if(ice_attr == NULL) {
-		PKG_MEM_ERROR;
 		return NULL;
 	}
-	memset(ice_attr, 0, len);
 
 	/* Insert the new ice attribute */
 	ice_attr->next = _stream->ice_attr;
@@ -287,18 +286,17 @@ static inline sdp_ice_attr_t *add_sdp_ice(sdp_stream_cell_t *_stream)
 	return ice_attr;
 }
 
-static inline sdp_ice_opt_t *add_sdp_ice_opt(sdp_stream_cell_t *_stream)
+static inline sdp_ice_opt_t *add_sdp_ice_opt(
+		sdp_info_t *_sdp, sdp_stream_cell_t *_stream)
 {
 	sdp_ice_opt_t *ice_opt;
 	int len;
 
 	len = sizeof(sdp_ice_opt_t);
-	ice_opt = (sdp_ice_opt_t *)pkg_malloc(len);
+	ice_opt = (sdp_ice_opt_t *)sdp_arena_alloc(_sdp, len);
 	if(ice_opt == NULL) {
-		PKG_MEM_ERROR;
 		return NULL;
 	}
-	memset(ice_opt, 0, len);
 
 	/* Insert the new ice option */
 	ice_opt->next = _stream->ice_opt;
@@ -308,7 +306,7 @@ static inline sdp_ice_opt_t *add_sdp_ice_opt(sdp_stream_cell_t *_stream)
 	return ice_opt;
 }
 
-int extract_candidate(str *body, sdp_stream_cell_t *stream)
+int extract_candidate(sdp_info_t *sdp, str *body, sdp_stream_cell_t *stream)
 {
 	char *space, *start;
 	int len, fl;
@@ -339,7 +337,7 @@ int extract_candidate(str *body, sdp_stream_cell_t *stream)
 		return -1;
 	}
 
-	ice_attr = add_sdp_ice(stream);
+	ice_attr = add_sdp_ice(sdp, stream);
 	if(ice_attr == NULL) {
 		LM_ERR("failed to add ice attribute\n");
 		return -1;
@@ -375,7 +373,7 @@ int extract_field(str *body, str *value, str field)
 	return 0;
 }
 
-int extract_ice_option(str *body, sdp_stream_cell_t *stream)
+int extract_ice_option(sdp_info_t *sdp, str *body, sdp_stream_cell_t *stream)
 {
 	sdp_ice_opt_t *ice_opt;
 
@@ -403,7 +401,7 @@ int extract_ice_option(str *body, sdp_stream_cell_t *stream)
 			ptr_src++;
 		}
 
-		ice_opt = add_sdp_ice_opt(stream);
+		ice_opt = add_sdp_ice_opt(sdp, stream);
 		if(ice_opt == NULL) {
 			LM_ERR("failed to add ice option\n");
 			return -1;
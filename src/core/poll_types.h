@@ -41,6 +41,7 @@ enum poll_types
 	POLL_SELECT,
 	POLL_KQUEUE,
 	POLL_DEVPOLL,
+	POLL_IO_URING,
 	POLL_END
 };
 
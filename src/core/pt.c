@@ -21,6 +21,8 @@
  */
 
 
+#define _GNU_SOURCE /* for sched_setaffinity() on linux */
+
 #include "pt.h"
 #include "tcp_init.h"
 #include "sr_module.h"
@@ -39,6 +41,10 @@
 
 #include <stdio.h>
 #include <time.h> /* time(), used to initialize random numbers */
+#ifdef __OS_linux
+#include <sched.h>
+#include <unistd.h>
+#endif
 
 #define FORK_DONT_WAIT /* child doesn't wait for parent before starting
 						 * => faster startup, but the child should not assume
@@ -67,6 +73,42 @@ unsigned int set_fork_delay(unsigned int v)
 	return r;
 }
 
+/* pin forked processes round-robin over the online cpus (0 = disabled) */
+static int cpu_pin_workers = 0;
+
+int set_cpu_pin_workers(int v)
+{
+	int r;
+	r = cpu_pin_workers;
+	cpu_pin_workers = v;
+	return r;
+}
+
+/* bind the current (child) process to one online cpu, chosen round-robin
+ * by process number, so a worker keeps its cache and memory locality */
+static void pin_worker_cpu(void)
+{
+#ifdef __OS_linux
+	cpu_set_t cset;
+	long ncpu;
+
+	if(likely(cpu_pin_workers == 0))
+		return;
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if(ncpu <= 0)
+		return;
+	CPU_ZERO(&cset);
+	CPU_SET(process_no % ncpu, &cset);
+	if(sched_setaffinity(0, sizeof(cset), &cset) < 0) {
+		LM_WARN("failed to set cpu affinity for process %d: %s\n", process_no,
+				strerror(errno));
+	}
+#else
+	if(cpu_pin_workers != 0)
+		LM_WARN("cpu worker pinning not supported on this platform\n");
+#endif
+}
+
 /* number of known "common" used fds */
 static int calc_common_open_fds_no(void)
 {
@@ -294,6 +336,7 @@ int fork_process(int child_id, char *desc, int make_sock)
 		/* child */
 		_ksr_is_main = 0; /* a forked process cannot be the "main" one */
 		process_no = child_process_no;
+		pin_worker_cpu();
 		daemon_status_on_fork_cleanup();
 		/* close tcp unix sockets if this is not tcp main */
 #ifdef USE_TCP
@@ -441,6 +484,7 @@ int fork_tcp_process(int child_id, char *desc, int r, int *reader_fd_1)
 	if(pid == 0) {
 		_ksr_is_main = 0; /* a forked process cannot be the "main" one */
 		process_no = child_process_no;
+		pin_worker_cpu();
 		/* close unneeded unix sockets */
 		close_extra_socks(child_id, process_no);
 		/* same for unneeded tcp_children <-> tcp_main unix socks */
@@ -98,6 +98,7 @@ void mem_dump_pkg_cb(str *gname, str *name);
 int mem_dump_shm_fixup(void *handle, str *gname, str *name, void **val);
 
 unsigned int set_fork_delay(unsigned int v);
+int set_cpu_pin_workers(int v);
 
 int sr_instance_started(void);
 
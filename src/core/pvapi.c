@@ -59,6 +59,9 @@ typedef struct _pv_item
 static pv_item_t *_pv_table[PV_TABLE_SIZE];
 static int _pv_table_set = 0;
 
+/* spec cache for the pv names seen by this process - pkg memory and
+ * written only by the owning process (at fixup or on first use of a
+ * name), so lookups run without any locking */
 static pv_cache_t *_pv_cache[PV_CACHE_SIZE];
 static int _pv_cache_set = 0;
 static int _pv_cache_counter = 0;
@@ -344,10 +347,9 @@ int pv_cache_drop(void)
 /**
  *
  */
-pv_spec_t *pv_cache_add(str *name)
+static pv_spec_t *pv_cache_add_pvid(str *name, unsigned int pvid)
 {
 	pv_cache_t *pvn;
-	unsigned int pvid;
 	char *p;
 
 	if(_pv_cache_set == 0) {
@@ -364,7 +366,6 @@ pv_spec_t *pv_cache_add(str *name)
 			}
 		}
 	}
-	pvid = get_hash1_raw(name->s, name->len);
 	pvn = (pv_cache_t *)pkg_malloc(sizeof(pv_cache_t) + name->len + 1);
 	if(pvn == 0) {
 		PKG_MEM_ERROR;
@@ -392,16 +393,22 @@ pv_spec_t *pv_cache_add(str *name)
 /**
  *
  */
-pv_spec_t *pv_cache_lookup(str *name)
+pv_spec_t *pv_cache_add(str *name)
+{
+	return pv_cache_add_pvid(name, get_hash1_raw(name->s, name->len));
+}
+
+/**
+ *
+ */
+static pv_spec_t *pv_cache_lookup_pvid(str *name, unsigned int pvid)
 {
 	pv_cache_t *pvi;
-	unsigned int pvid;
 	int found;
 
 	if(_pv_cache_set == 0)
 		return NULL;
 
-	pvid = get_hash1_raw(name->s, name->len);
 	pvi = _pv_cache[pvid % PV_CACHE_SIZE];
 	while(pvi) {
 		if(pvi->pvid == pvid) {
@@ -419,6 +426,14 @@ pv_spec_t *pv_cache_lookup(str *name)
 	return NULL;
 }
 
+/**
+ *
+ */
+pv_spec_t *pv_cache_lookup(str *name)
+{
+	return pv_cache_lookup_pvid(name, get_hash1_raw(name->s, name->len));
+}
+
 /**
  *
  */
@@ -426,6 +441,7 @@ pv_spec_t *pv_cache_get(str *name)
 {
 	pv_spec_t *pvs;
 	str tname;
+	unsigned int pvid;
 
 	if(name->s == NULL || name->len == 0) {
 		LM_ERR("invalid parameters\n");
@@ -438,12 +454,14 @@ pv_spec_t *pv_cache_get(str *name)
 	if(tname.len < 0)
 		return NULL;
 
-	pvs = pv_cache_lookup(&tname);
+	/* hash once for both the lookup and the add on miss */
+	pvid = get_hash1_raw(tname.s, tname.len);
+	pvs = pv_cache_lookup_pvid(&tname, pvid);
 
 	if(pvs != NULL)
 		return pvs;
 
-	return pv_cache_add(&tname);
+	return pv_cache_add_pvid(&tname, pvid);
 }
 
 str *pv_cache_get_name(pv_spec_t *spec)
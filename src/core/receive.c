@@ -41,6 +41,8 @@
 #include "forward.h"
 #include "action.h"
 #include "mem/mem.h"
+#include "mem/zeroaudit.h"
+#include <stddef.h> /* offsetof */
 #include "ip_addr.h"
 #include "script_cb.h"
 #include "nonsip_hooks.h"
@@ -55,6 +57,7 @@
 #include "tcp_options.h" /* for access to tcp_accept_aliases*/
 #include "cfg/cfg.h"
 #include "core_stats.h"
+#include "latency_hist.h"
 #include "kemi.h"
 
 #ifdef DEBUG_DMALLOC
@@ -301,6 +304,7 @@ int receive_msg(char *buf, unsigned int len, receive_info_t *rcv_info)
 	struct run_act_ctx *bctx = NULL;
 	int ret = -1;
 	struct timeval tvb = {0}, tve = {0};
+	struct timeval lhtv0 = {0}, lhtvp = {0}, lhtvx = {0};
 	unsigned int diff = 0;
 	str inb = STR_NULL;
 	sr_net_info_t netinfo = {0};
@@ -311,6 +315,10 @@ int receive_msg(char *buf, unsigned int len, receive_info_t *rcv_info)
 	int errsipmsg = 0;
 	int exectime = 0;
 
+	if(unlikely(ksr_lathist_enabled)) {
+		gettimeofday(&lhtv0, NULL);
+	}
+
 	if(rcv_info->bind_address == NULL) {
 		LM_ERR("critical - incoming message without local socket [%.*s ...]\n",
 				(len > 128) ? 128 : len, buf);
@@ -350,7 +358,12 @@ int receive_msg(char *buf, unsigned int len, receive_info_t *rcv_info)
 	/* number of vias parsed -- good for diagnostic info in replies */
 	via_cnt = 0;
 
-	memset(msg, 0, sizeof(struct sip_msg)); /* init everything to 0 */
+	/* init everything to 0, except rcv, which is fully overwritten
+	 * right below (zeroing it first would be dead stores) */
+	memset(msg, 0, offsetof(struct sip_msg, rcv));
+	memset(&msg->rcv + 1, 0,
+			sizeof(struct sip_msg) - offsetof(struct sip_msg, rcv)
+					- sizeof(msg->rcv));
 	/* fill in msg */
 	msg->buf = buf;
 	msg->len = len;
@@ -398,6 +411,10 @@ int receive_msg(char *buf, unsigned int len, receive_info_t *rcv_info)
 			(msg->cseq && msg->cseq->body.s) ? msg->cseq->body.len : 0,
 			(msg->cseq && msg->cseq->body.s) ? msg->cseq->body.s : "");
 
+	if(unlikely(ksr_lathist_enabled)) {
+		gettimeofday(&lhtvp, NULL);
+	}
+
 	/* set log prefix */
 	log_prefix_set(msg);
 
@@ -633,8 +650,21 @@ int receive_msg(char *buf, unsigned int len, receive_info_t *rcv_info)
 	}
 
 end:
+	if(unlikely(ksr_lathist_enabled && lhtvp.tv_sec != 0)) {
+		gettimeofday(&lhtvx, NULL);
+		ksr_lathist_record(msg->rcv.proto,
+				msg->first_line.type == SIP_REQUEST,
+				(msg->first_line.type == SIP_REQUEST)
+						? msg->first_line.u.request.method_value
+						: 0,
+				(unsigned long long)(lhtvp.tv_sec - lhtv0.tv_sec) * 1000000
+						+ (lhtvp.tv_usec - lhtv0.tv_usec),
+				(unsigned long long)(lhtvx.tv_sec - lhtvp.tv_sec) * 1000000
+						+ (lhtvx.tv_usec - lhtvp.tv_usec));
+	}
 	ksr_msg_env_reset();
 	LM_DBG("cleaning up\n");
+	ksr_zero_audit_check(msg, sizeof(struct sip_msg), "sip_msg");
 	free_sip_msg(msg);
 	pkg_free(msg);
 	/* reset log prefix */
@@ -653,6 +683,7 @@ error_req:
 	exec_post_script_cb(msg, REQUEST_CB_TYPE);
 error03:
 error02:
+	ksr_zero_audit_check(msg, sizeof(struct sip_msg), "sip_msg");
 	free_sip_msg(msg);
 	pkg_free(msg);
 error00:
@@ -56,7 +56,7 @@
 #include "mem/mem.h"
 #include "select.h"
 #include "onsend.h"
-#include "str_hash.h"
+#include "str_map.h"
 #include "ut.h"
 #include "switch.h"
 #include "cfg/cfg_struct.h"
@@ -82,26 +82,12 @@ int scr_opt_lev = 9;
 
 inline static void destroy_rlist(struct route_list *rt)
 {
-	struct str_hash_entry *e;
-	struct str_hash_entry *tmp;
-
 	if(rt->rlist) {
 		pkg_free(rt->rlist);
 		rt->rlist = 0;
 		rt->entries = 0;
 	}
-	if(rt->names.table) {
-		int i;
-		for(i = 0; i < RT_HASH_SIZE; i++) {
-			clist_foreach_safe(&rt->names.table[i], e, tmp, next)
-			{
-				pkg_free(e);
-			}
-		}
-		pkg_free(rt->names.table);
-		rt->names.table = 0;
-		rt->names.size = 0;
-	}
+	str_map_destroy(&rt->names);
 }
 
 
@@ -121,19 +107,18 @@ void destroy_routes()
  */
 static int route_add(struct route_list *rt, char *name, int i)
 {
-	struct str_hash_entry *e;
+	str_map_entry_t *e;
+	str key;
 
-	e = pkg_malloc(sizeof(struct str_hash_entry));
+	LM_DBG("mapping routing block (%p)[%s] to %d\n", rt, name, i);
+	key.s = name;
+	key.len = strlen(name);
+	e = str_map_add(&rt->names, &key);
 	if(e == 0) {
 		PKG_MEM_CRITICAL;
 		goto error;
 	}
-	LM_DBG("mapping routing block (%p)[%s] to %d\n", rt, name, i);
-	e->key.s = name;
-	e->key.len = strlen(name);
-	e->flags = 0;
 	e->u.n = i;
-	str_hash_add(&rt->names, e);
 	return 0;
 error:
 	return -1;
@@ -152,11 +137,10 @@ inline static int init_rlist(
 	memset(rt->rlist, 0, sizeof(struct action *) * n_entries);
 	rt->idx = 1; /* idx=0 == default == reserved */
 	rt->entries = n_entries;
-	if(str_hash_alloc(&rt->names, hash_size) < 0) {
+	if(str_map_init(&rt->names, hash_size) < 0) {
 		LM_CRIT("\"%s\" route table: failed to alloc hash\n", r_name);
 		goto error;
 	}
-	str_hash_init(&rt->names);
 	route_add(rt, "0", 0); /* default route */
 
 	return 0;
@@ -221,12 +205,12 @@ end:
 int route_get(struct route_list *rt, char *name)
 {
 	int len;
-	struct str_hash_entry *e;
+	str_map_entry_t *e;
 	int i;
 
 	len = strlen(name);
 	/* check if exists and non empty*/
-	e = str_hash_get(&rt->names, name, len);
+	e = str_map_get(&rt->names, name, len);
 	if(e) {
 		i = e->u.n;
 	} else {
@@ -251,11 +235,11 @@ error:
 int route_lookup(struct route_list *rt, char *name)
 {
 	int len;
-	struct str_hash_entry *e;
+	str_map_entry_t *e;
 
 	len = strlen(name);
 	/* check if exists and non empty*/
-	e = str_hash_get(&rt->names, name, len);
+	e = str_map_get(&rt->names, name, len);
 	if(e) {
 		return e->u.n;
 	} else {
@@ -2150,6 +2134,62 @@ error:
 }
 
 
+/** linearize an action list into one contiguous block.
+ * The parser allocates one pkg chunk per action, so the statements of a
+ * block end up scattered through memory and the interpreter chases a
+ * pointer for every step. Copy each list into a single array (next
+ * simply points to the adjacent element) and recurse into the nested
+ * blocks (if/else and while bodies, switch cases), releasing the
+ * original nodes. Must run before fix_actions() so that fixups and the
+ * switch jump tables reference the final nodes.
+ * @return the new list head (the original one if no memory is left -
+ * the list stays valid, only the locality is lost).
+ */
+static struct action *compact_actions(struct action *a)
+{
+	struct action *block;
+	struct action *t;
+	struct action *nxt;
+	struct case_stms *c;
+	int n;
+	int i;
+	int j;
+
+	if(a == 0)
+		return 0;
+	n = 0;
+	for(t = a; t; t = t->next)
+		n++;
+	block = (struct action *)pkg_malloc(n * sizeof(struct action));
+	if(block == 0) {
+		PKG_MEM_ERROR;
+		return a;
+	}
+	i = 0;
+	for(t = a; t; t = nxt) {
+		nxt = t->next;
+		memcpy(&block[i], t, sizeof(struct action));
+		block[i].next = (nxt) ? &block[i + 1] : 0;
+		pkg_free(t);
+		i++;
+	}
+	for(i = 0; i < n; i++) {
+		t = &block[i];
+		if(t->type == SWITCH_T && t->val[1].type == CASE_ST) {
+			for(c = (struct case_stms *)t->val[1].u.data; c; c = c->next)
+				c->actions = compact_actions(c->actions);
+		} else {
+			for(j = 0; j < MAX_ACTIONS; j++) {
+				if(t->val[j].type == ACTIONS_ST)
+					t->val[j].u.data = compact_actions(
+							(struct action *)t->val[j].u.data);
+			}
+		}
+	}
+	return block;
+}
+
+
 static int fix_rl(struct route_list *rt)
 {
 	int i;
@@ -2157,6 +2197,7 @@ static int fix_rl(struct route_list *rt)
 
 	for(i = 0; i < rt->idx; i++) {
 		if(rt->rlist[i]) {
+			rt->rlist[i] = compact_actions(rt->rlist[i]);
 			if((ret = fix_actions(rt->rlist[i])) != 0) {
 				return ret;
 			}
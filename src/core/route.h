@@ -39,7 +39,7 @@
 #include "route_struct.h"
 #include "action.h"
 #include "parser/msg_parser.h"
-#include "str_hash.h"
+#include "str_map.h"
 
 /*#include "cfg_parser.h" */
 
@@ -80,7 +80,7 @@ struct route_list
 	struct action **rlist;
 	int idx;					 /* first empty entry */
 	int entries;				 /* total number of entries */
-	struct str_hash_table names; /* name to route index mappings */
+	str_map_t names;			 /* name to route index mappings */
 };
 
 
@@ -22,7 +22,7 @@
  */
 
 #include "rpc.h"
-#include "str_hash.h"
+#include "str_map.h"
 #include "ut.h"
 #include "dprint.h"
 #include "mem/shm.h"
@@ -30,7 +30,7 @@
 #define RPC_HASH_SIZE 32
 #define RPC_SARRAY_SIZE 32 /* initial size */
 
-static struct str_hash_table rpc_hash_table;
+static str_map_t rpc_map;
 
 /* array of pointer to rpc exports, sorted after their name
  *  (used by listMethods) */
@@ -45,9 +45,8 @@ int ksr_rpc_exec_delta = 0;
  */
 int init_rpcs(void)
 {
-	if(str_hash_alloc(&rpc_hash_table, RPC_HASH_SIZE) < 0)
+	if(str_map_init(&rpc_map, RPC_HASH_SIZE) < 0)
 		return -1;
-	str_hash_init(&rpc_hash_table);
 	rpc_sarray_max_size = RPC_SARRAY_SIZE;
 	rpc_sarray = pkg_malloc(sizeof(*rpc_sarray) * rpc_sarray_max_size);
 	if(rpc_sarray) {
@@ -62,27 +61,21 @@ int init_rpcs(void)
 
 void destroy_rpcs(void)
 {
-	int r;
-	struct str_hash_entry *e;
-	struct str_hash_entry *bak;
+	unsigned int r;
+	str_map_entry_t *e;
 	rpc_exportx_t *rx;
-	for(r = 0; r < rpc_hash_table.size; r++) {
-		clist_foreach_safe(&rpc_hash_table.table[r], e, bak, next)
-		{
-			rx = (rpc_exportx_t *)e->u.p;
-			if(rx->xdata != NULL) {
-				lock_destroy(&rx->xdata->elock);
-				shm_free(rx->xdata);
-			}
-			pkg_free(e);
+	str_map_foreach(&rpc_map, e, r)
+	{
+		rx = (rpc_exportx_t *)e->u.p;
+		if(rx->xdata != NULL) {
+			lock_destroy(&rx->xdata->elock);
+			shm_free(rx->xdata);
 		}
+		pkg_free(rx);
 	}
-	if(rpc_hash_table.table)
-		pkg_free(rpc_hash_table.table);
+	str_map_destroy(&rpc_map);
 	if(rpc_sarray)
 		pkg_free(rpc_sarray);
-	rpc_hash_table.table = 0;
-	rpc_hash_table.size = 0;
 	rpc_sarray = 0;
 	rpc_sarray_crt_size = 0;
 	rpc_sarray_max_size = 0;
@@ -94,7 +87,8 @@ void destroy_rpcs(void)
  */
 static int rpc_hash_add(struct rpc_export *rpc)
 {
-	struct str_hash_entry *e;
+	str_map_entry_t *e;
+	str key;
 	int name_len;
 	int doc0_len, doc1_len;
 	rpc_exportx_t *n_rpc;
@@ -106,24 +100,22 @@ static int rpc_hash_add(struct rpc_export *rpc)
 	doc1_len = rpc->doc_str[1] ? strlen(rpc->doc_str[1]) : 0;
 	/* alloc everything into one block */
 
-	e = pkg_malloc(ROUND_POINTER(sizeof(struct str_hash_entry))
-				   + ROUND_POINTER(sizeof(rpc_exportx_t)) + 2 * sizeof(char *)
-				   + +name_len + 1 + doc0_len + (rpc->doc_str[0] != 0)
-				   + doc1_len + (rpc->doc_str[1] != 0));
-	if(e == 0) {
+	n_rpc = pkg_malloc(ROUND_POINTER(sizeof(rpc_exportx_t))
+					   + 2 * sizeof(char *) + +name_len + 1 + doc0_len
+					   + (rpc->doc_str[0] != 0) + doc1_len
+					   + (rpc->doc_str[1] != 0));
+	if(n_rpc == 0) {
 		PKG_MEM_ERROR;
 		goto error;
 	}
 	if(rpc->flags & RPC_EXEC_DELTA) {
 		xd = (rpc_xdata_t *)shm_mallocxz(sizeof(rpc_xdata_t));
 		if(xd == NULL) {
-			pkg_free(e);
+			pkg_free(n_rpc);
 			goto error;
 		}
 		lock_init(&xd->elock);
 	}
-	n_rpc = (rpc_exportx_t *)((char *)e
-							  + ROUND_POINTER(sizeof(struct str_hash_entry)));
 	/* copy rpc into n_rpc */
 	n_rpc->r = *rpc;
 	n_rpc->xdata = xd;
@@ -149,11 +141,18 @@ static int rpc_hash_add(struct rpc_export *rpc)
 		n_rpc->r.doc_str[1] = 0;
 	}
 
-	e->key.s = (char *)n_rpc->r.name;
-	e->key.len = name_len;
-	e->flags = 0;
+	key.s = (char *)n_rpc->r.name;
+	key.len = name_len;
+	e = str_map_add(&rpc_map, &key);
+	if(e == 0) {
+		if(xd != NULL) {
+			lock_destroy(&xd->elock);
+			shm_free(xd);
+		}
+		pkg_free(n_rpc);
+		goto error;
+	}
 	e->u.p = n_rpc;
-	str_hash_add(&rpc_hash_table, e);
 
 	/* insert it into the sorted array */
 	if(rpc_sarray_max_size <= rpc_sarray_crt_size) {
@@ -189,9 +188,9 @@ error:
  */
 rpc_export_t *rpc_lookup(const char *name, int len)
 {
-	struct str_hash_entry *e;
+	str_map_entry_t *e;
 
-	e = str_hash_get(&rpc_hash_table, (char *)name, len);
+	e = str_map_get(&rpc_map, name, len);
 	return e ? &(((rpc_exportx_t *)e->u.p)->r) : 0;
 }
 
@@ -204,9 +203,9 @@ rpc_exportx_t *rpc_lookupx(const char *name, int len, unsigned int *rdata)
 	rpc_exportx_t *rx;
 	time_t tnow;
 
-	struct str_hash_entry *e;
+	str_map_entry_t *e;
 
-	e = str_hash_get(&rpc_hash_table, (char *)name, len);
+	e = str_map_get(&rpc_map, name, len);
 	*rdata = 0;
 	if(e != NULL) {
 		rx = (rpc_exportx_t *)e->u.p;
@@ -116,8 +116,26 @@ inline static void rval_force_clean(struct rvalue *rv)
 }
 
 
+/* recycle lists for the rvalue structures produced while evaluating
+ * expressions - every intermediate and final result is a pkg_malloc'ed
+ * struct rvalue, so long routes churn the allocator on each message.
+ * Allocations are rounded up to RVAL_POOL_STEP size classes and freed
+ * structures are kept on per-process lists for reuse; oversized ones
+ * keep going straight to pkg. The nodes stay plain pkg chunks, a direct
+ * pkg_free() on one of them remains safe. */
+#define RVAL_POOL_STEP 64
+#define RVAL_POOL_CLASSES 8 /* covers structures up to 512 bytes */
+#define RVAL_POOL_MAX 32	/* cached structures per class */
+
+static struct rvalue *_rval_pool[RVAL_POOL_CLASSES];
+static unsigned int _rval_pool_no[RVAL_POOL_CLASSES];
+
+
 static inline void rval_destroy_helper(struct rvalue *rv, int allocated)
 {
+	int size;
+	int c;
+
 	if(rv && rv_unref(rv)) {
 		rval_force_clean(rv);
 		/* still an un-regfreed RE ? */
@@ -128,7 +146,18 @@ static inline void rval_destroy_helper(struct rvalue *rv, int allocated)
 		}
 		if(rv->flags & RV_RV_ALLOCED_F) {
 			if(likely(allocated)) {
-				pkg_free(rv);
+				size = rv->bsize + sizeof(*rv) + sizeof(rv->buf);
+				c = size / RVAL_POOL_STEP - 1;
+				/* only class-sized structures are recycled */
+				if(likely(c >= 0 && c < RVAL_POOL_CLASSES
+						   && (size % RVAL_POOL_STEP) == 0
+						   && _rval_pool_no[c] < RVAL_POOL_MAX)) {
+					rv->v.p = _rval_pool[c];
+					_rval_pool[c] = rv;
+					_rval_pool_no[c]++;
+				} else {
+					pkg_free(rv);
+				}
 			} else {
 				/* not expected to be allocated */
 				abort(); /* abort, otherwise is lost - find bugs quicker */
@@ -241,19 +270,31 @@ struct rvalue *rval_new_empty(int extra_size)
 	struct rvalue *rv;
 	int size; /* extra size at the end */
 
+	int c;
+
 	size = ROUND_LONG(
 			sizeof(*rv) - sizeof(rv->buf) + extra_size); /* round up */
+	c = (size + RVAL_POOL_STEP - 1) / RVAL_POOL_STEP;
+	if(likely(c <= RVAL_POOL_CLASSES)) {
+		size = c * RVAL_POOL_STEP;
+		c--;
+		if(likely(_rval_pool[c] != NULL)) {
+			rv = _rval_pool[c];
+			_rval_pool[c] = (struct rvalue *)rv->v.p;
+			_rval_pool_no[c]--;
+			goto found;
+		}
+	}
 	rv = pkg_malloc(size);
-	if(likely(rv)) {
-		rv->bsize = size - sizeof(*rv)
-					- sizeof(rv->buf); /* remaining size->buffer*/
-		rv->flags = RV_RV_ALLOCED_F;
-		rv->refcnt = 1;
-		rv->type = RV_NONE;
-	} else {
+	if(unlikely(rv == NULL)) {
 		PKG_MEM_ERROR;
 		return 0;
 	}
+found:
+	rv->bsize = size - sizeof(*rv) - sizeof(rv->buf); /* remaining size->buffer*/
+	rv->flags = RV_RV_ALLOCED_F;
+	rv->refcnt = 1;
+	rv->type = RV_NONE;
 	return rv;
 }
 
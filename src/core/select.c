@@ -100,6 +100,12 @@ int w_parse_select(char **p, select_t *sel)
 		(*p)++;
 	select_name = *p;
 	sel->n = 0;
+	/* disabled by default - only parse_select() (pkg, process owned)
+	 * re-enables it; shm or embedded selects must not keep runtime
+	 * memo state */
+	sel->memo = -1;
+	sel->memo_mbuf = NULL;
+	sel->memo_buf = NULL;
 	while(isalpha((unsigned char)*(*p))) {
 		if(sel->n > MAX_SELECT_PARAMS - 2) {
 			LM_ERR("select depth exceeds max\n");
@@ -224,14 +230,19 @@ int parse_select(char **p, select_t **s)
 		pkg_free(sel);
 		return -2;
 	}
+	/* pkg select owned by this process - may use the per-message memo */
+	sel->memo = 0;
 	*s = sel;
 	return 0;
 }
 
 void free_select(select_t *s)
 {
-	if(s)
+	if(s) {
+		if(s->memo_buf)
+			pkg_free(s->memo_buf);
 		pkg_free(s);
+	}
 }
 
 void shm_free_select(select_t *s)
@@ -450,6 +461,16 @@ int run_select(str *res, select_t *s, struct sip_msg *msg)
 	}
 	LM_DBG("Calling SELECT %p\n", s->f);
 
+	if(unlikely(s->memo == 0))
+		s->memo = (select_memoizable(s)) ? 1 : -1;
+	if(s->memo == 1 && msg != NULL && s->memo_mbuf == msg->buf
+			&& s->memo_msgid == msg->id && s->memo_msgpid == msg->pid
+			&& s->memo_mlen == msg->len) {
+		/* same message and buffer - reuse the cached extraction */
+		*res = s->memo_res;
+		return s->memo_ret;
+	}
+
 	/* reset the uri pointer */
 	select_uri_p = NULL;
 
@@ -463,6 +484,31 @@ int run_select(str *res, select_t *s, struct sip_msg *msg)
 		ret = s->f[select_level](res, s, msg);
 	}
 	select_level = orig_level;
+	if(s->memo == 1 && msg != NULL && ret >= 0
+			&& res->len <= MAX_SELECT_MEMO_SIZE
+			&& (res->len == 0 || res->s != NULL)) {
+		if(res->len > 0) {
+			if(s->memo_buf == NULL) {
+				s->memo_buf = (char *)pkg_malloc(MAX_SELECT_MEMO_SIZE);
+				if(s->memo_buf == NULL) {
+					PKG_MEM_ERROR;
+					s->memo = -1;
+					return ret;
+				}
+			}
+			/* own copy - results often live in the rotating static buffer */
+			memcpy(s->memo_buf, res->s, res->len);
+			s->memo_res.s = s->memo_buf;
+		} else {
+			s->memo_res.s = res->s;
+		}
+		s->memo_res.len = res->len;
+		s->memo_ret = ret;
+		s->memo_mbuf = msg->buf;
+		s->memo_mlen = msg->len;
+		s->memo_msgid = msg->id;
+		s->memo_msgpid = msg->pid;
+	}
 	return ret;
 }
 
@@ -123,6 +123,9 @@ struct select;
 
 typedef int (*select_f)(str *res, struct select *s, struct sip_msg *msg);
 
+/* largest select result kept in the per-message memo */
+#define MAX_SELECT_MEMO_SIZE 256
+
 typedef struct select
 {
 	select_f f[MAX_NESTED_CALLS];
@@ -131,6 +134,18 @@ typedef struct select
 	select_param_t params[MAX_SELECT_PARAMS];
 	/* how many elements are used in 'params' */
 	int n;
+	/* per-message memoization for read-only message extractions, decided
+	 * lazily on first evaluation - see run_select(). Runtime state of the
+	 * evaluating process, must stay disabled for selects living in shm */
+	short memo;				 /* 0: unknown, 1: memoizable, -1: disabled */
+	unsigned int memo_msgid; /* message the cached result belongs to */
+	int memo_msgpid;
+	char *memo_mbuf; /* msg->buf of the cached result (changes when the
+					  * message buffer is rebuilt) */
+	int memo_mlen;
+	str memo_res;	/* cached result (pointing into memo_buf when set) */
+	int memo_ret;	/* cached return code */
+	char *memo_buf; /* pkg buffer holding the cached result */
 } select_t;
 
 typedef struct
@@ -170,6 +185,10 @@ int resolve_select(select_t *s);
  * Run the select function
  */
 int run_select(str *res, select_t *s, struct sip_msg *msg);
+/* returns 1 when the whole resolution chain of s only extracts read-only
+ * data from the parsed message and its result may be memoized per message,
+ * 0 otherwise (implemented in select_core.c, which knows the handlers) */
+int select_memoizable(select_t *s);
 
 /*
  * Print select for debugging purposes
@@ -1839,3 +1839,69 @@ int select_branch_dst_uri(str *res, select_t *s, struct sip_msg *msg)
 {
 	return select_branch_uri(res, s, msg);
 }
+
+/* select handlers that only extract read-only data from the parsed
+ * message: no branch/destination state (mutable during routing), no
+ * system or cfg values, no module handlers of unknown volatility.
+ * Used by run_select() to decide if a result can be memoized for the
+ * lifetime of the message. */
+/* clang-format off */
+static const select_f _ksr_pure_select_fs[] = {
+	select_from, select_from_uri, select_from_tag, select_from_name,
+	select_from_params,
+	select_to, select_to_uri, select_to_tag, select_to_name,
+	select_to_params,
+	select_refer_to, select_refer_to_uri, select_refer_to_tag,
+	select_refer_to_name, select_refer_to_params,
+	select_rpid, select_rpid_uri, select_rpid_tag, select_rpid_name,
+	select_rpid_params,
+	select_contact, select_contact_uri, select_contact_name,
+	select_contact_params, select_contact_params_spec,
+	select_via, select_via_name, select_via_version, select_via_transport,
+	select_via_host, select_via_port, select_via_comment,
+	select_via_params, select_via_params_spec,
+	select_msg, select_msg_first_line, select_msg_type, select_msg_len,
+	select_msg_id, select_msg_id_hex, select_msg_body,
+	select_msg_body_sdp, select_sdp_line, select_msg_header,
+	select_anyheader, select_anyheader_params,
+	select_msg_request, select_msg_request_method,
+	select_msg_request_version,
+	select_msg_response, select_msg_response_version,
+	select_msg_response_status, select_msg_response_reason,
+	select_version,
+	select_any_nameaddr, select_nameaddr_name, select_nameaddr_uri,
+	select_nameaddr_params, select_any_params,
+	select_any_uri, select_uri_type, select_uri_user, select_uri_rn_user,
+	select_uri_pwd, select_uri_host, select_uri_port, select_uri_hostport,
+	select_uri_params, select_uri_proto,
+	select_event,
+	select_rr, select_rr_uri, select_rr_name, select_rr_params,
+	select_cseq, select_cseq_method, select_cseq_num,
+	select_auth, select_auth_param, select_auth_username,
+	select_auth_username_comp,
+	select_src, select_dst, select_rcv, select_ip_port,
+	select_call_id, select_expires, select_max_forwards,
+	select_content_type, select_content_length,
+	select_subject, select_organization, select_priority,
+	select_session_expires, select_min_se, select_user_agent,
+	select_sip_if_match,
+	select_date, select_identity, select_identity_info,
+	NULL
+};
+/* clang-format on */
+
+int select_memoizable(select_t *s)
+{
+	int i;
+	int j;
+
+	for(i = 0; i < MAX_NESTED_CALLS && s->f[i]; i++) {
+		for(j = 0; _ksr_pure_select_fs[j]; j++) {
+			if(s->f[i] == _ksr_pure_select_fs[j])
+				break;
+		}
+		if(_ksr_pure_select_fs[j] == NULL)
+			return 0;
+	}
+	return (i != 0);
+}
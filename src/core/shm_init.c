@@ -71,6 +71,10 @@ int init_shm()
 	if(shm_init_manager(shm_mname) < 0)
 		goto error;
 	shm_init = 1;
+	/* the sampling allocation profiler is advisory - failing to set up
+	 * its table is not fatal */
+	if(ksr_shm_profile_init() < 0)
+		LM_WARN("could not initialize the shm allocation profiler\n");
 	return 0;
 error:
 	return -1;
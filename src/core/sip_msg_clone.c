@@ -357,14 +357,15 @@ static inline int clone_authorized_hooks(
 #define HOOK_SET(hook) (new_msg->hook != org_msg->hook)
 
 
-/** Creates a shm clone for a sip_msg.
+/** Creates a single-block clone for a sip_msg.
  * org_msg is cloned along with most of its headers and lumps into one
- * shm memory block (so that a shm_free() on the result will free everything)
- * @return shm malloced sip_msg on success, 0 on error
+ * memory block (so that one free on the result will free everything),
+ * allocated from pkg when use_pkg is set, else from shm
+ * @return malloced sip_msg on success, 0 on error
  * Warning: Cloner does not clone all hdr_field headers (From, To, etc.).
  */
-struct sip_msg *sip_msg_shm_clone(
-		struct sip_msg *org_msg, int *sip_msg_len, int clone_lumps)
+static struct sip_msg *sip_msg_clone_helper(
+		struct sip_msg *org_msg, int *sip_msg_len, int clone_lumps, int use_pkg)
 {
 	unsigned int len;
 	struct hdr_field *hdr, *new_hdr, *last_hdr;
@@ -492,10 +493,18 @@ struct sip_msg *sip_msg_shm_clone(
 		RPL_LUMP_LIST_LEN(len, org_msg->reply_lump);
 	}
 
-	p = (char *)shm_malloc(len);
-	if(!p) {
-		SHM_MEM_ERROR;
-		return 0;
+	if(use_pkg) {
+		p = (char *)pkg_malloc(len);
+		if(!p) {
+			PKG_MEM_ERROR;
+			return 0;
+		}
+	} else {
+		p = (char *)shm_malloc(len);
+		if(!p) {
+			SHM_MEM_ERROR;
+			return 0;
+		}
 	}
 	if(sip_msg_len)
 		*sip_msg_len = len;
@@ -935,6 +944,33 @@ struct sip_msg *sip_msg_shm_clone(
 }
 
 
+/** Creates a shm clone for a sip_msg.
+ * org_msg is cloned along with most of its headers and lumps into one
+ * shm memory block (so that a shm_free() on the result will free everything)
+ * @return shm malloced sip_msg on success, 0 on error
+ * Warning: Cloner does not clone all hdr_field headers (From, To, etc.).
+ */
+struct sip_msg *sip_msg_shm_clone(
+		struct sip_msg *org_msg, int *sip_msg_len, int clone_lumps)
+{
+	return sip_msg_clone_helper(org_msg, sip_msg_len, clone_lumps, 0);
+}
+
+
+/** Creates a pkg clone for a sip_msg.
+ * Same layout as sip_msg_shm_clone() - everything in one block, released
+ * with a single pkg_free() - but in private memory, for clones that never
+ * leave the calling process (e.g. the faked request handed to failure
+ * routes), so they skip the global shm lock and do not fragment shm.
+ * @return pkg malloced sip_msg on success, 0 on error
+ */
+struct sip_msg *sip_msg_pkg_clone(
+		struct sip_msg *org_msg, int *sip_msg_len, int clone_lumps)
+{
+	return sip_msg_clone_helper(org_msg, sip_msg_len, clone_lumps, 1);
+}
+
+
 /** clones the data and reply lumps from pkg_msg to shm_msg.
  * A new memory block is allocated for the lumps (the lumps will point
  * into it).
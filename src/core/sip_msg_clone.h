@@ -22,6 +22,9 @@
 struct sip_msg *sip_msg_shm_clone(
 		struct sip_msg *org_msg, int *sip_msg_len, int clone_lumps);
 
+struct sip_msg *sip_msg_pkg_clone(
+		struct sip_msg *org_msg, int *sip_msg_len, int clone_lumps);
+
 int msg_lump_cloner(struct sip_msg *pkg_msg, struct lump **add_rm,
 		struct lump **body_lumps, struct lump_rpl **reply_lump);
 
@@ -46,11 +46,13 @@
 #include "ppcfg.h"
 #include "fmsg.h"
 #include "async_task.h"
+#include "hashes.h"
 #include "shm_init.h"
 #include "str_list.h"
 #include "daemonize.h"
 
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <regex.h>
 #include <dlfcn.h>
 #include <strings.h>
@@ -108,6 +110,10 @@ response_function *mod_response_cbks = 0;
 /* number of usec to wait before initializing a module */
 static unsigned int modinit_delay = 0;
 
+/* warn when a module init or child init takes longer than this
+ * number of ms (0 - disabled); set with modinit_time_warn */
+unsigned int ksr_modinit_twarn = 0;
+
 unsigned int set_modinit_delay(unsigned int v)
 {
 	unsigned int r;
@@ -752,6 +758,112 @@ static inline int sr_cmd_flags_match(int cflags, int rflags)
 	return 0;
 }
 
+/* cache of resolved export lookups - the config parse and fixup phases
+ * resolve the same functions over and over with linear scans over all
+ * module command tables; only successful lookups are cached, so modules
+ * loaded later in the config are still found */
+
+#define KSR_EXPCACHE_SIZE 512
+
+typedef struct ksr_expcache_entry
+{
+	char *mod;
+	char *name;
+	int param_no;
+	int flags;
+	ksr_cmd_export_t *cmd;
+	struct ksr_expcache_entry *next;
+} ksr_expcache_entry_t;
+
+static ksr_expcache_entry_t **_ksr_expcache = NULL;
+
+static unsigned int ksr_expcache_hash(char *mod, char *name)
+{
+	unsigned int h;
+
+	h = get_hash1_raw(name, strlen(name));
+	if(mod != NULL)
+		h += get_hash1_raw(mod, strlen(mod));
+	return h % KSR_EXPCACHE_SIZE;
+}
+
+static ksr_cmd_export_t *ksr_expcache_get(
+		char *mod, char *name, int param_no, int flags)
+{
+	ksr_expcache_entry_t *e;
+
+	if(_ksr_expcache == NULL)
+		return NULL;
+	for(e = _ksr_expcache[ksr_expcache_hash(mod, name)]; e != NULL;
+			e = e->next) {
+		if(e->param_no == param_no && e->flags == flags
+				&& strcmp(e->name, name) == 0
+				&& ((e->mod == NULL && mod == NULL)
+						|| (e->mod != NULL && mod != NULL
+								&& strcmp(e->mod, mod) == 0))) {
+			return e->cmd;
+		}
+	}
+	return NULL;
+}
+
+static void ksr_expcache_add(
+		char *mod, char *name, int param_no, int flags, ksr_cmd_export_t *cmd)
+{
+	ksr_expcache_entry_t *e;
+	unsigned int h;
+
+	if(_ksr_expcache == NULL) {
+		_ksr_expcache = pkg_malloc(
+				KSR_EXPCACHE_SIZE * sizeof(ksr_expcache_entry_t *));
+		if(_ksr_expcache == NULL) {
+			PKG_MEM_ERROR;
+			return;
+		}
+		memset(_ksr_expcache, 0,
+				KSR_EXPCACHE_SIZE * sizeof(ksr_expcache_entry_t *));
+	}
+	e = pkg_malloc(sizeof(ksr_expcache_entry_t) + strlen(name) + 1
+				   + ((mod != NULL) ? strlen(mod) + 1 : 0));
+	if(e == NULL) {
+		PKG_MEM_ERROR;
+		return;
+	}
+	e->name = (char *)(e + 1);
+	strcpy(e->name, name);
+	if(mod != NULL) {
+		e->mod = e->name + strlen(name) + 1;
+		strcpy(e->mod, mod);
+	} else {
+		e->mod = NULL;
+	}
+	e->param_no = param_no;
+	e->flags = flags;
+	e->cmd = cmd;
+	h = ksr_expcache_hash(mod, name);
+	e->next = _ksr_expcache[h];
+	_ksr_expcache[h] = e;
+}
+
+void ksr_expcache_destroy(void)
+{
+	ksr_expcache_entry_t *e, *bar;
+	int i;
+
+	if(_ksr_expcache == NULL)
+		return;
+	for(i = 0; i < KSR_EXPCACHE_SIZE; i++) {
+		e = _ksr_expcache[i];
+		while(e) {
+			bar = e->next;
+			pkg_free(e);
+			e = bar;
+		}
+	}
+	pkg_free(_ksr_expcache);
+	_ksr_expcache = NULL;
+}
+
 /* searches the module list for function name in module mod and returns
  *  a pointer to the "name" function record union or 0 if not found
  * mod==0 is a wildcard matching all modules
@@ -763,6 +875,11 @@ ksr_cmd_export_t *find_mod_export_record(
 	struct sr_module *t;
 	ksr_cmd_export_t *cmd;
 
+	cmd = ksr_expcache_get(mod, name, param_no, flags);
+	if(cmd != NULL) {
+		LM_DBG("found cached export of <%s>\n", name);
+		return cmd;
+	}
 	for(t = modules; t; t = t->next) {
 		if(mod != 0 && (strcmp(t->exports.name, mod) != 0))
 			continue;
@@ -774,6 +891,7 @@ ksr_cmd_export_t *find_mod_export_record(
 						&& (sr_cmd_flags_match(cmd->flags, flags) == 1)) {
 					LM_DBG("found export of <%s> in module %s [%s]\n", name,
 							t->exports.name, t->path);
+					ksr_expcache_add(mod, name, param_no, flags, cmd);
 					return cmd;
 				}
 			}
@@ -884,6 +1002,7 @@ void destroy_modules()
 	if(_ksr_shutdown_phase != NULL) {
 		*_ksr_shutdown_phase = 1;
 	}
+	ksr_expcache_destroy();
 
 	LM_DBG("starting modules destroy phase\n");
 
@@ -919,6 +1038,8 @@ void destroy_modules()
 static int init_mod_child(struct sr_module *m, int rank)
 {
 	int ret;
+	unsigned int dur;
+	struct timeval tvb = {0}, tve = {0};
 	if(m) {
 		/* iterate through the list; if error occurs,
 		 * propagate it up the stack
@@ -931,7 +1052,17 @@ static int init_mod_child(struct sr_module *m, int rank)
 					|| (m->modflags & KSRMOD_FLAG_POSTCHILDINIT)) {
 				LM_DBG("idx %d rank %d: %s [%s]\n", process_no, rank,
 						m->exports.name, my_desc());
+				gettimeofday(&tvb, NULL);
 				ret = m->exports.init_child_f(rank);
+				gettimeofday(&tve, NULL);
+				dur = (tve.tv_sec - tvb.tv_sec) * 1000
+						+ (tve.tv_usec - tvb.tv_usec) / 1000;
+				m->cinit_dur_ms += dur;
+				if(ksr_modinit_twarn > 0 && dur >= ksr_modinit_twarn) {
+					LM_WARN("child init of module %s took %u ms"
+							" (idx: %d rank: %d)\n",
+							m->exports.name, dur, process_no, rank);
+				}
 				if(ret < 0) {
 					LM_ERR("error while initializing module %s (%s)"
 						   " (idx: %d rank: %d desc: [%s])\n",
@@ -1038,6 +1169,7 @@ void ksr_module_set_flag(unsigned int flag)
 static int init_mod(struct sr_module *m)
 {
 	int ret;
+	struct timeval tvb = {0}, tve = {0};
 	if(m) {
 		/* iterate through the list; if error occurs,
 		 * propagate it up the stack
@@ -1047,8 +1179,16 @@ static int init_mod(struct sr_module *m)
 		if(m->exports.init_mod_f) {
 			LM_DBG("%s\n", m->exports.name);
 			ksr_module_init_ptr = m;
+			gettimeofday(&tvb, NULL);
 			ret = m->exports.init_mod_f();
+			gettimeofday(&tve, NULL);
 			ksr_module_init_ptr = NULL;
+			m->init_dur_ms = (tve.tv_sec - tvb.tv_sec) * 1000
+							 + (tve.tv_usec - tvb.tv_usec) / 1000;
+			if(ksr_modinit_twarn > 0 && m->init_dur_ms >= ksr_modinit_twarn) {
+				LM_WARN("init of module %s took %u ms\n", m->exports.name,
+						m->init_dur_ms);
+			}
 			if(ret != 0) {
 				LM_ERR("Error while initializing module %s (%s)\n",
 						m->exports.name, m->path);
@@ -1078,6 +1218,9 @@ int init_modules(void)
 	if(async_task_init() < 0)
 		return -1;
 
+	if(ksr_log_async_init() < 0)
+		return -1;
+
 	i = init_mod(modules);
 	if(i != 0)
 		return i;
@@ -341,6 +341,8 @@ typedef struct sr_module
 	void *handle;
 	ksr_module_exports_t exports;
 	unsigned int modflags;
+	unsigned int init_dur_ms;  /* duration of mod_init() */
+	unsigned int cinit_dur_ms; /* child init duration, per process */
 	struct sr_module *next;
 } sr_module_t;
 
@@ -568,6 +570,8 @@ int is_sip_worker(int rank);
 int is_rpc_worker(int rank);
 
 unsigned int set_modinit_delay(unsigned int v);
+extern unsigned int ksr_modinit_twarn;
+void ksr_expcache_destroy(void);
 int destroy_modules_phase(void);
 int ksr_shutdown_phase_init(void);
 int ksr_shutdown_phase(void);
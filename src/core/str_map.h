@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2006 iptelorg GmbH
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _str_map_h
+#define _str_map_h
+
+#include "str.h"
+#include "hashes.h"
+#include "ut.h"
+#include "mem/mem.h"
+#include <string.h>
+
+/* open addressing str keyed map - a denser alternative to str_hash for
+ * lookup heavy tables (rpc dispatch, route names, ...):
+ *  - all entries live in one slot array, no per entry allocations and no
+ *    list pointers to chase across cachelines
+ *  - probing walks one byte hash tags in groups of 8 with the SWAR
+ *    helpers from ut.h, so a whole group is rejected with a couple of
+ *    word ops and the full keys are touched only on a tag match
+ *  - grows automatically (rehash at 3/4 load)
+ * Limitations (on purpose, the users above don't need more):
+ *  - no entry removal - destroy and rebuild the map instead
+ *  - entry pointers returned by add/get are invalidated by further adds
+ *    (the slot array may be rehashed); copy out what is needed
+ *  - keys are referenced, not copied - the caller keeps them alive
+ *  - like with str_hash, the plain and the _case_ variants must not be
+ *    mixed on the same map
+ */
+
+#define STR_MAP_GROUP 8 /* tag bytes probed at a time */
+#define STR_MAP_MIN_SIZE 16
+
+typedef struct str_map_entry
+{
+	str key;
+	unsigned int hash;
+	union
+	{
+		void *p;
+		char *s;
+		int n;
+	} u;
+} str_map_entry_t;
+
+typedef struct str_map
+{
+	unsigned char *tags; /* 1 per slot, 0 = empty, else 0x80|hash tag;
+						  * the first STR_MAP_GROUP tags are mirrored after
+						  * the end so that group loads never wrap */
+	str_map_entry_t *slots;
+	unsigned int mask; /* number of slots - 1 (power of 2) */
+	unsigned int used;
+} str_map_t;
+
+
+/* returns 0 on success, <0 on failure; size is rounded up to a power of 2 */
+inline static int str_map_init(str_map_t *m, unsigned int size)
+{
+	unsigned int s;
+
+	for(s = STR_MAP_MIN_SIZE; s < size; s *= 2)
+		;
+	m->tags = (unsigned char *)pkg_mallocxz(s + STR_MAP_GROUP);
+	if(m->tags == 0) {
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	m->slots = (str_map_entry_t *)pkg_malloc(s * sizeof(str_map_entry_t));
+	if(m->slots == 0) {
+		PKG_MEM_ERROR;
+		pkg_free(m->tags);
+		m->tags = 0;
+		return -1;
+	}
+	m->mask = s - 1;
+	m->used = 0;
+	return 0;
+}
+
+
+inline static void str_map_destroy(str_map_t *m)
+{
+	if(m->tags) {
+		pkg_free(m->tags);
+		m->tags = 0;
+	}
+	if(m->slots) {
+		pkg_free(m->slots);
+		m->slots = 0;
+	}
+	m->mask = 0;
+	m->used = 0;
+}
+
+
+/* iterate over the used entries; i is an unsigned counter variable
+ * (safe on a never initialized, zeroed map) */
+#define str_map_foreach(m, e, i)                            \
+	for((i) = 0; (m)->tags != 0 && (i) <= (m)->mask; (i)++) \
+		if((m)->tags[i] != 0 && ((e) = &(m)->slots[i]))
+
+
+#define STR_MAP_TAG(h) (0x80 | (((h) >> 24) & 0x7f))
+
+/* find the slot holding key or the empty slot ending its probe sequence;
+ * cmpcase selects strncasecmp() instead of memcmp() */
+inline static str_map_entry_t *_str_map_probe(
+		str_map_t *m, const char *key, int len, unsigned int h, int cmpcase)
+{
+	unsigned int idx;
+	unsigned char tag;
+	str_map_entry_t *e;
+#ifdef __IS_LITTLE_ENDIAN
+	unsigned long long w, mm, em;
+	unsigned int i;
+
+	tag = STR_MAP_TAG(h);
+	idx = h & m->mask;
+	for(;;) {
+		memcpy(&w, &m->tags[idx], sizeof(w));
+		mm = KSR_SWAR_HASBYTE(w, tag);
+		em = KSR_SWAR_HASZERO(w);
+		if(em)
+			/* drop tag matches past the first empty slot: an insert would
+			 * have stopped there, so they belong to other sequences */
+			mm &= (em ^ (em - 1));
+		while(mm) {
+			i = (idx + (__builtin_ctzll(mm) >> 3)) & m->mask;
+			e = &m->slots[i];
+			if(e->hash == h && e->key.len == len
+					&& (cmpcase ? (strncasecmp(e->key.s, key, len) == 0)
+								: (memcmp(e->key.s, key, len) == 0)))
+				return e;
+			mm &= mm - 1;
+		}
+		if(em)
+			return &m->slots[(idx + (__builtin_ctzll(em) >> 3)) & m->mask];
+		idx = (idx + STR_MAP_GROUP) & m->mask;
+	}
+#else  /* __IS_LITTLE_ENDIAN */
+	/* plain linear probing - the byte position extraction above relies on
+	 * little endian word loads */
+	tag = STR_MAP_TAG(h);
+	idx = h & m->mask;
+	for(;;) {
+		if(m->tags[idx] == 0)
+			return &m->slots[idx];
+		if(m->tags[idx] == tag) {
+			e = &m->slots[idx];
+			if(e->hash == h && e->key.len == len
+					&& (cmpcase ? (strncasecmp(e->key.s, key, len) == 0)
+								: (memcmp(e->key.s, key, len) == 0)))
+				return e;
+		}
+		idx = (idx + 1) & m->mask;
+	}
+#endif /* __IS_LITTLE_ENDIAN */
+}
+
+
+inline static void _str_map_set_tag(str_map_t *m, unsigned int i,
+		unsigned char tag)
+{
+	m->tags[i] = tag;
+	if(i < STR_MAP_GROUP)
+		m->tags[m->mask + 1 + i] = tag; /* keep the mirror in sync */
+}
+
+
+/* doubles the slot array and rehashes everything; returns 0 or -1 */
+inline static int _str_map_grow(str_map_t *m)
+{
+	str_map_t n;
+	str_map_entry_t *e;
+	unsigned int i;
+
+	str_map_entry_t *ne;
+
+	if(str_map_init(&n, 2 * (m->mask + 1)) < 0)
+		return -1;
+	str_map_foreach(m, e, i)
+	{
+		ne = _str_map_probe(&n, e->key.s, e->key.len, e->hash, 0);
+		_str_map_set_tag(&n, (unsigned int)(ne - n.slots),
+				STR_MAP_TAG(e->hash));
+		*ne = *e;
+	}
+	n.used = m->used;
+	pkg_free(m->tags);
+	pkg_free(m->slots);
+	*m = n;
+	return 0;
+}
+
+
+/* adds key with hash h (no duplicate check, like str_hash_add);
+ * returns the new entry (fill in e->u) or 0 on out of memory */
+inline static str_map_entry_t *_str_map_add_hash(
+		str_map_t *m, const str *key, unsigned int h)
+{
+	str_map_entry_t *e;
+
+	if(unlikely(4 * (m->used + 1) > 3 * (m->mask + 1)) && _str_map_grow(m) < 0)
+		return 0;
+	e = _str_map_probe(m, key->s, key->len, h, 0);
+	if(m->tags[e - m->slots] == 0) { /* new slot (not a duplicate key) */
+		m->used++;
+		_str_map_set_tag(m, e - m->slots, STR_MAP_TAG(h));
+	}
+	e->key = *key;
+	e->hash = h;
+	return e;
+}
+
+
+inline static str_map_entry_t *str_map_add(str_map_t *m, const str *key)
+{
+	return _str_map_add_hash(m, key, get_hash1_raw(key->s, key->len));
+}
+
+
+inline static str_map_entry_t *str_map_case_add(str_map_t *m, const str *key)
+{
+	return _str_map_add_hash(m, key, get_hash1_case_raw(key->s, key->len));
+}
+
+
+inline static str_map_entry_t *str_map_get(
+		str_map_t *m, const char *key, int len)
+{
+	str_map_entry_t *e;
+
+	e = _str_map_probe(m, key, len, get_hash1_raw(key, len), 0);
+	return (m->tags[e - m->slots] != 0) ? e : 0;
+}
+
+
+inline static str_map_entry_t *str_map_case_get(
+		str_map_t *m, const char *key, int len)
+{
+	str_map_entry_t *e;
+
+	e = _str_map_probe(m, key, len, get_hash1_case_raw(key, len), 1);
+	return (m->tags[e - m->slots] != 0) ? e : 0;
+}
+
+#endif
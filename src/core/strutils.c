@@ -578,10 +578,10 @@ int cmp_str_params(str *s1, str *s2)
 	for(pit1 = pl1; pit1; pit1 = pit1->next) {
 		for(pit2 = pl2; pit2; pit2 = pit2->next) {
 			if(pit1->name.len == pit2->name.len
-					&& strncasecmp(pit1->name.s, pit2->name.s, pit2->name.len)
+					&& ksr_strncaseeq(pit1->name.s, pit2->name.s, pit2->name.len)
 							   == 0) {
 				if(pit1->body.len != pit2->body.len
-						|| strncasecmp(
+						|| ksr_strncaseeq(
 								   pit1->body.s, pit2->body.s, pit2->body.len)
 								   != 0)
 					return 1;
@@ -372,8 +372,35 @@ typedef struct tcp_connection
 	} while(0)
 
 
-#define TCPCONN_LOCK lock_get(tcpconn_lock);
-#define TCPCONN_UNLOCK lock_release(tcpconn_lock);
+/* number of locks the tcpconn hashes are striped over (must be a power
+ * of 2); both the id hash and the alias hash buckets map into the same
+ * stripe array, so per-connection operations only serialize with
+ * operations touching the same buckets instead of every tcp worker */
+#define TCP_LOCK_STRIPES 64
+
+extern gen_lock_t *tcpconn_locks;
+
+#define TCPCONN_STRIPE(h) ((h) & (TCP_LOCK_STRIPES - 1))
+#define TCPCONN_STRIPE_LOCK(h) lock_get(&tcpconn_locks[TCPCONN_STRIPE(h)]);
+#define TCPCONN_STRIPE_UNLOCK(h) \
+	lock_release(&tcpconn_locks[TCPCONN_STRIPE(h)]);
+
+/* lock/unlock the whole tcpconn hash (all the stripes, in increasing
+ * order so it cannot deadlock with the per-connection stripe locking);
+ * needed only by operations that walk or change more buckets than a
+ * single connection's entries (rpc dumps, shutdown a.s.o.) */
+#define TCPCONN_LOCK                                           \
+	do {                                                       \
+		int _tc_si;                                            \
+		for(_tc_si = 0; _tc_si < TCP_LOCK_STRIPES; _tc_si++)   \
+			lock_get(&tcpconn_locks[_tc_si]);                  \
+	} while(0);
+#define TCPCONN_UNLOCK                                             \
+	do {                                                           \
+		int _tc_si;                                                \
+		for(_tc_si = TCP_LOCK_STRIPES - 1; _tc_si >= 0; _tc_si--)  \
+			lock_release(&tcpconn_locks[_tc_si]);                  \
+	} while(0);
 
 #define TCP_ALIAS_HASH_SIZE 4096
 #define TCP_ID_HASH_SIZE 1024
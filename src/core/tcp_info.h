@@ -40,4 +40,8 @@ struct tcp_gen_info
 
 void tcp_get_info(struct tcp_gen_info *ti);
 
+/* current summed accept backlog depth of the tcp/tls listen sockets
+ * (0 where the OS does not export it) */
+int tcp_get_acceptq(void);
+
 #endif
@@ -66,6 +66,9 @@ int tcp_fix_child_sockets(int *fd);
 
 void tcp_timer_check_connections(unsigned int ticks, void *param);
 
+int tcp_drain_start(void);
+int tcp_drain_status(void);
+
 /* sets source address used when opening new sockets and no source is specified
  *  (by default the address is choosen by the kernel)
  * Should be used only on init.
@@ -26,6 +26,8 @@
 #ifndef __tcp_int_send_h
 #define __tcp_int_send_h
 
+#include <sys/uio.h>
+
 #include "tcp_conn.h"
 
 int tcpconn_send_unsafe(int fd, struct tcp_connection *c, const char *buf,
@@ -35,6 +37,11 @@ int tcpconn_send_unsafe(int fd, struct tcp_connection *c, const char *buf,
 int _tcpconn_write_nb(
 		int fd, struct tcp_connection *c, const char *buf, int len);
 
+/* direct non-blocking, unsafe (assumes locked) scatter-gather send on a
+ * tcp connection */
+int _tcpconn_writev_nb(
+		int fd, struct tcp_connection *c, struct iovec *iov, int iovcnt);
+
 
 #endif /*__tcp_int_send_h*/
 
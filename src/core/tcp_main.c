@@ -185,7 +185,7 @@ static int *tls_connections_no = 0; /* current tls open connections */
 struct tcp_conn_alias **tcpconn_aliases_hash = 0;
 /* connection hash table (after connection id) */
 struct tcp_connection **tcpconn_id_hash = 0;
-gen_lock_t *tcpconn_lock = 0;
+gen_lock_t *tcpconn_locks = 0; /* TCP_LOCK_STRIPES hash stripe locks */
 
 struct tcp_child *tcp_children = 0;
 static int *connection_id = 0; /*  unique for each connection, used for
@@ -198,6 +198,10 @@ static int tcp_proto_no = -1; /* tcp protocol number as returned by
 
 static io_wait_h io_h;
 
+/* draining mode (core.tcp_drain rpc): 0 - off, 1 - requested,
+ * 2 - listen sockets closed; in shm so any process can request it */
+static int *ksr_tcp_drain = NULL;
+
 static struct local_timer tcp_main_ltimer;
 static ticks_t tcp_main_prev_ticks;
 
@@ -334,6 +338,18 @@ static int init_sock_opt(int s, int af)
 	}
 #endif
 
+#if defined(TSEND_ZEROCOPY) && defined(SO_ZEROCOPY)
+	if(cfg_get(tcp, tcp_cfg, zerocopy_min) > 0) {
+		optval = 1;
+		if(setsockopt(
+				   s, SOL_SOCKET, SO_ZEROCOPY, (void *)&optval, sizeof(optval))
+				== -1) {
+			LM_WARN("setsockopt SO_ZEROCOPY %s\n", strerror(errno));
+			/* continue, large sends will fall back to copying */
+		}
+	}
+#endif
+
 #ifdef HAVE_TCP_SYNCNT
 	if((optval = cfg_get(tcp, tcp_cfg, syncnt))) {
 		if(setsockopt(s, IPPROTO_TCP, TCP_SYNCNT, &optval, sizeof(optval))
@@ -805,39 +821,70 @@ inline static void _wbufq_destroy(struct tcp_wbuffer_queue *q)
 /* tries to empty the queue  (safe version, c->write_lock must not be hold)
  * returns -1 on error, bytes written on success (>=0)
  * if the whole queue is emptied => sets *empty*/
+#define TCP_WBUFQ_IOV_MAX 32
+
 inline static int wbufq_run(int fd, struct tcp_connection *c, int *empty)
 {
 	struct tcp_wbuffer_queue *q;
 	struct tcp_wbuffer *wb;
+	struct iovec iov[TCP_WBUFQ_IOV_MAX];
 	int n;
+	int w;
 	int ret;
-	int block_size;
-	char *buf;
+	int niov;
+	unsigned int block_size;
+	unsigned int to_send;
+	unsigned int offs;
+	unsigned int wr_max;
 
 	*empty = 0;
 	ret = 0;
+	wr_max = cfg_get(tcp, tcp_cfg, wq_write_max);
 	lock_get(&c->write_lock);
 	q = &c->wbuf_q;
 	while(q->first) {
-		block_size = ((q->first == q->last) ? q->last_used : q->first->b_size)
-					 - q->offset;
-		buf = q->first->buf + q->offset;
-		n = _tcpconn_write_nb(fd, c, buf, block_size);
+		/* coalesce several queued blocks (e.g. a burst of messages sent
+		 * to the same connection within one timer run) into a single
+		 * writev, up to the wq_write_max byte budget */
+		niov = 0;
+		to_send = 0;
+		offs = q->offset;
+		wb = q->first;
+		do {
+			block_size = ((wb == q->last) ? q->last_used : wb->b_size) - offs;
+			iov[niov].iov_base = wb->buf + offs;
+			iov[niov].iov_len = block_size;
+			to_send += block_size;
+			niov++;
+			offs = 0;
+			wb = wb->next;
+		} while(wb && niov < TCP_WBUFQ_IOV_MAX && wr_max != 0
+				&& to_send < wr_max);
+		n = _tcpconn_writev_nb(fd, c, iov, niov);
 		if(likely(n > 0)) {
 			ret += n;
-			if(likely(n == block_size)) {
-				wb = q->first;
-				q->first = q->first->next;
-				shm_free(wb);
-				q->offset = 0;
-				q->queued -= block_size;
-				atomic_add_int((int *)tcp_total_wq, -block_size);
-			} else {
-				q->offset += n;
-				q->queued -= n;
-				atomic_add_int((int *)tcp_total_wq, -n);
-				break;
+			q->queued -= n;
+			atomic_add_int((int *)tcp_total_wq, -n);
+			/* release the fully written blocks and advance the offset
+			 * inside a partially written one */
+			w = n;
+			while(w > 0) {
+				block_size = ((q->first == q->last) ? q->last_used
+													: q->first->b_size)
+							 - q->offset;
+				if((unsigned int)w >= block_size) {
+					wb = q->first;
+					q->first = q->first->next;
+					shm_free(wb);
+					q->offset = 0;
+					w -= block_size;
+				} else {
+					q->offset += w;
+					w = 0;
+				}
 			}
+			if((unsigned int)n < to_send)
+				break; /* short write => kernel buffer full */
 		} else {
 			if(n < 0) {
 				/* EINTR is handled inside _tcpconn_write_nb */
@@ -1203,6 +1250,101 @@ int tcp_connection_limit_srcip(union sockaddr_union *srcaddr, int limit)
 	return (n >= limit) ? 1 : 0;
 }
 
+
+/* upper bound for the number of distinct lock stripes one connection's
+ * hash entries can use: the id hash bucket, the already set aliases and
+ * the aliases about to be added by the caller */
+#define TCPCONN_STRIPES_MAX (TCP_CON_MAX_ALIASES + 6)
+
+/* insert the stripe for hash into the sorted stripes array, skipping
+ * duplicates; returns the new number of entries */
+static int tcpconn_stripes_ins(int *stripes, int n, unsigned hash)
+{
+	int i;
+	int j;
+	int s;
+
+	s = TCPCONN_STRIPE(hash);
+	for(i = 0; i < n; i++) {
+		if(stripes[i] == s)
+			return n;
+		if(stripes[i] > s)
+			break;
+	}
+	for(j = n; j > i; j--)
+		stripes[j] = stripes[j - 1];
+	stripes[i] = s;
+	return n + 1;
+}
+
+
+/* collect the sorted stripe set covering c's current hash entries (id
+ * bucket + alias buckets) and nx extra alias bucket hashes (for aliases
+ * the caller is about to add); returns the number of stripes */
+static int tcpconn_conn_stripes(
+		struct tcp_connection *c, unsigned *xhash, int nx, int *stripes)
+{
+	int n;
+	int r;
+
+	n = tcpconn_stripes_ins(stripes, 0, c->id_hash);
+	for(r = 0; r < c->aliases; r++)
+		n = tcpconn_stripes_ins(stripes, n, c->con_aliases[r].hash);
+	for(r = 0; r < nx; r++)
+		n = tcpconn_stripes_ins(stripes, n, xhash[r]);
+	return n;
+}
+
+
+static void tcpconn_stripes_get(int *stripes, int n)
+{
+	int r;
+
+	for(r = 0; r < n; r++)
+		lock_get(&tcpconn_locks[stripes[r]]);
+}
+
+
+static void tcpconn_stripes_release(int *stripes, int n)
+{
+	int r;
+
+	for(r = n - 1; r >= 0; r--)
+		lock_release(&tcpconn_locks[stripes[r]]);
+}
+
+
+/* lock all the hash stripes needed for changing c's hash entries (plus
+ * nx extra alias bucket hashes for aliases about to be added); the
+ * stripes are always taken in increasing order, so it cannot deadlock
+ * with TCPCONN_LOCK or with another connection's stripe set.
+ * Since an alias might be added to c in-between by a process not yet
+ * blocked on one of our stripes (e.g. tcpconn_add_alias()), the set is
+ * re-checked after acquiring it and re-acquired on changes (every alias
+ * change needs at least c's id bucket stripe, which we hold once the
+ * sets match, so the loop terminates).
+ * returns the number of locked stripes (to be passed together with
+ * stripes to tcpconn_stripes_release()) */
+static int tcpconn_conn_lock(
+		struct tcp_connection *c, unsigned *xhash, int nx, int *stripes)
+{
+	int stripes2[TCPCONN_STRIPES_MAX];
+	int n;
+	int n2;
+
+	n = tcpconn_conn_stripes(c, xhash, nx, stripes);
+	for(;;) {
+		tcpconn_stripes_get(stripes, n);
+		n2 = tcpconn_conn_stripes(c, xhash, nx, stripes2);
+		if(n2 == n && memcmp(stripes, stripes2, n * sizeof(int)) == 0)
+			return n;
+		tcpconn_stripes_release(stripes, n);
+		n = n2;
+		memcpy(stripes, stripes2, n * sizeof(int));
+	}
+}
+
+
 struct tcp_connection *tcpconn_new(int sock, union sockaddr_union *su,
 		union sockaddr_union *local_addr, struct socket_info *ba, int type,
 		int state)
@@ -1554,6 +1696,9 @@ int tcpconn_finish_connect(struct tcp_connection *c, union sockaddr_union *from)
 	enum tcp_conn_states state;
 	struct tcp_conn_alias *a;
 	int new_conn_alias_flags;
+	unsigned xhash[2];
+	int stripes[TCPCONN_STRIPES_MAX];
+	int nstripes;
 
 	s = tcp_do_connect(&c->rcv.src_su, from, c->type, &c->send_flags,
 			&local_addr, &si, &state);
@@ -1569,15 +1714,23 @@ int tcpconn_finish_connect(struct tcp_connection *c, union sockaddr_union *from)
 	if(likely(from == 0)) {
 		new_conn_alias_flags = cfg_get(tcp, tcp_cfg, new_conn_alias_flags);
 		/* add aliases */
-		TCPCONN_LOCK;
+		xhash[0] = tcp_addr_hash(
+				&c->rcv.src_ip, c->rcv.src_port, &c->rcv.dst_ip, 0);
+		xhash[1] = tcp_addr_hash(&c->rcv.src_ip, c->rcv.src_port,
+				&c->rcv.dst_ip, c->rcv.dst_port);
+		nstripes = tcpconn_conn_lock(c, xhash, 2, stripes);
 		_tcpconn_add_alias_unsafe(
 				c, c->rcv.src_port, &c->rcv.dst_ip, 0, new_conn_alias_flags);
 		_tcpconn_add_alias_unsafe(c, c->rcv.src_port, &c->rcv.dst_ip,
 				c->rcv.dst_port, new_conn_alias_flags);
-		TCPCONN_UNLOCK;
+		tcpconn_stripes_release(stripes, nstripes);
 	} else if(su_cmp(from, &local_addr) != 1) {
 		new_conn_alias_flags = cfg_get(tcp, tcp_cfg, new_conn_alias_flags);
-		TCPCONN_LOCK;
+		xhash[0] = tcp_addr_hash(
+				&c->rcv.src_ip, c->rcv.src_port, &c->rcv.dst_ip, 0);
+		xhash[1] = tcp_addr_hash(&c->rcv.src_ip, c->rcv.src_port,
+				&c->rcv.dst_ip, c->rcv.dst_port);
+		nstripes = tcpconn_conn_lock(c, xhash, 2, stripes);
 		/* remove all the aliases except the first one and re-add them
 			 * (there shouldn't be more than the 3 default aliases at this
 			 * stage) */
@@ -1593,7 +1746,7 @@ int tcpconn_finish_connect(struct tcp_connection *c, union sockaddr_union *from)
 				c, c->rcv.src_port, &c->rcv.dst_ip, 0, new_conn_alias_flags);
 		_tcpconn_add_alias_unsafe(c, c->rcv.src_port, &c->rcv.dst_ip,
 				c->rcv.dst_port, new_conn_alias_flags);
-		TCPCONN_UNLOCK;
+		tcpconn_stripes_release(stripes, nstripes);
 	}
 
 	return s;
@@ -1607,13 +1760,34 @@ inline static struct tcp_connection *tcpconn_add(struct tcp_connection *c)
 {
 	struct ip_addr zero_ip;
 	int new_conn_alias_flags;
+	unsigned xhash[5];
+	int nx;
+	int stripes[TCPCONN_STRIPES_MAX];
+	int nstripes;
 
 	if(likely(c)) {
 		ip_addr_mk_any(c->rcv.src_ip.af, &zero_ip);
 		c->id_hash = tcp_id_hash(c->id);
 		c->aliases = 0;
 		new_conn_alias_flags = cfg_get(tcp, tcp_cfg, new_conn_alias_flags);
-		TCPCONN_LOCK;
+		/* pre-compute the alias bucket hashes that the adds below will
+		 * use, so that all the needed lock stripes can be taken upfront */
+		nx = 0;
+		xhash[nx++] = tcp_addr_hash(&c->rcv.src_ip, c->rcv.src_port, &zero_ip, 0);
+		if(likely(c->rcv.dst_ip.af && !ip_addr_any(&c->rcv.dst_ip))) {
+			xhash[nx++] = tcp_addr_hash(
+					&c->rcv.src_ip, c->rcv.src_port, &c->rcv.dst_ip, 0);
+			xhash[nx++] = tcp_addr_hash(&c->rcv.src_ip, c->rcv.src_port,
+					&c->rcv.dst_ip, c->rcv.dst_port);
+		}
+		if(unlikely(c->cinfo.dst_ip.af && !ip_addr_any(&c->cinfo.dst_ip)
+					&& !ip_addr_cmp(&c->rcv.dst_ip, &c->cinfo.dst_ip))) {
+			xhash[nx++] = tcp_addr_hash(
+					&c->rcv.src_ip, c->rcv.src_port, &c->cinfo.dst_ip, 0);
+			xhash[nx++] = tcp_addr_hash(&c->rcv.src_ip, c->rcv.src_port,
+					&c->cinfo.dst_ip, c->cinfo.dst_port);
+		}
+		nstripes = tcpconn_conn_lock(c, xhash, nx, stripes);
 		c->flags |= F_CONN_HASHED;
 		/* add it at the beginning of the list*/
 		tcpconn_listadd(tcpconn_id_hash[c->id_hash], c, id_next, id_prev);
@@ -1648,7 +1822,7 @@ inline static struct tcp_connection *tcpconn_add(struct tcp_connection *c)
 		/* ignore add_alias errors, there are some valid cases when one
 		 *  of the add_alias would fail (e.g. first add_alias for 2 connections
 		 *   with the same destination but different src. ip*/
-		TCPCONN_UNLOCK;
+		tcpconn_stripes_release(stripes, nstripes);
 		LM_DBG("hashes: %d:%d:%d, %d\n", c->con_aliases[0].hash,
 				c->con_aliases[1].hash, c->con_aliases[2].hash, c->id_hash);
 		return c;
@@ -1697,14 +1871,17 @@ void _tcpconn_rm(struct tcp_connection *c)
 void tcpconn_rm(struct tcp_connection *c)
 {
 	int r;
-	TCPCONN_LOCK;
+	int stripes[TCPCONN_STRIPES_MAX];
+	int nstripes;
+
+	nstripes = tcpconn_conn_lock(c, 0, 0, stripes);
 	tcpconn_listrm(tcpconn_id_hash[c->id_hash], c, id_next, id_prev);
 	/* remove all the aliases */
 	for(r = 0; r < c->aliases; r++)
 		tcpconn_listrm(tcpconn_aliases_hash[c->con_aliases[r].hash],
 				&c->con_aliases[r], next, prev);
 	c->aliases = 0;
-	TCPCONN_UNLOCK;
+	tcpconn_stripes_release(stripes, nstripes);
 	lock_destroy(&c->write_lock);
 #ifdef USE_TLS
 	if((c->type == PROTO_TLS || c->type == PROTO_WSS) && (c->extra_data))
@@ -1787,10 +1964,18 @@ int tcpconn_exists(int conn_id, ip_addr_t *peer_ip, int peer_port,
 		ip_addr_t *local_ip, int local_port, sip_protos_t proto)
 {
 	tcp_connection_t *c;
+	unsigned hash;
 
-	TCPCONN_LOCK;
+	if(likely(conn_id)) {
+		hash = tcp_id_hash(conn_id);
+	} else if(likely(peer_ip)) {
+		hash = tcp_addr_hash(peer_ip, peer_port, local_ip, local_port);
+	} else {
+		return 0;
+	}
+	TCPCONN_STRIPE_LOCK(hash);
 	c = _tcpconn_find(conn_id, peer_ip, peer_port, local_ip, local_port, proto);
-	TCPCONN_UNLOCK;
+	TCPCONN_STRIPE_UNLOCK(hash);
 	if(c) {
 		return 1;
 	}
@@ -1812,6 +1997,7 @@ struct tcp_connection *tcpconn_lookup(int id, struct ip_addr *ip, int port,
 	struct tcp_connection *c;
 	struct ip_addr local_ip;
 	int local_port;
+	unsigned hash;
 
 	local_port = 0;
 	c = NULL;
@@ -1824,24 +2010,43 @@ struct tcp_connection *tcpconn_lookup(int id, struct ip_addr *ip, int port,
 			local_port = 0;
 		}
 	}
-	TCPCONN_LOCK;
-	if(likely(try_local_port != 0) && likely(local_port == 0)) {
+	if(unlikely(id == 0 && ip == 0))
+		return NULL;
+	/* only the stripe covering the bucket of each probe is locked; a
+	 * search by id always hits the same bucket, so the try_local_port
+	 * probe is needed only for an address based search */
+	hash = 0;
+	if(unlikely(id == 0) && likely(try_local_port != 0)
+			&& likely(local_port == 0)) {
+		hash = tcp_addr_hash(ip, port, &local_ip, try_local_port);
+		TCPCONN_STRIPE_LOCK(hash);
 		c = _tcpconn_find(id, ip, port, &local_ip, try_local_port, proto);
+		if(likely(c == NULL))
+			TCPCONN_STRIPE_UNLOCK(hash);
 	}
-	if(unlikely(c == NULL)) {
+	if(likely(c == NULL)) {
+		if(likely(id))
+			hash = tcp_id_hash(id);
+		else
+			hash = tcp_addr_hash(ip, port, &local_ip, local_port);
+		TCPCONN_STRIPE_LOCK(hash);
 		c = _tcpconn_find(id, ip, port, &local_ip, local_port, proto);
+		if(unlikely(c == NULL)) {
+			TCPCONN_STRIPE_UNLOCK(hash);
+			return NULL;
+		}
 	}
-	if(likely(c)) {
-		atomic_inc(&c->refcnt);
-		/* update the timeout only if the connection is not handled
-			 * by a tcp reader _and_the timeout is non-zero  (the tcp
-			 * reader process uses c->timeout for its own internal
-			 * timeout and c->timeout will be overwritten * anyway on
-			 * return to tcp_main) */
-		if(likely(c->reader_pid == 0 && timeout != 0))
-			c->timeout = get_ticks_raw() + timeout;
-	}
-	TCPCONN_UNLOCK;
+	/* the stripe of the bucket c was found in is still held here, which
+	 * keeps c from being detached and freed concurrently */
+	atomic_inc(&c->refcnt);
+	/* update the timeout only if the connection is not handled
+		 * by a tcp reader _and_the timeout is non-zero  (the tcp
+		 * reader process uses c->timeout for its own internal
+		 * timeout and c->timeout will be overwritten * anyway on
+		 * return to tcp_main) */
+	if(likely(c->reader_pid == 0 && timeout != 0))
+		c->timeout = get_ticks_raw() + timeout;
+	TCPCONN_STRIPE_UNLOCK(hash);
 	return c;
 }
 
@@ -1864,7 +2069,9 @@ struct tcp_connection *tcpconn_get(int id, struct ip_addr *ip, int port,
  *                                new one
  * returns 0 on success, <0 on failure ( -1  - null c, -2 too many aliases,
  *  -3 alias already present and pointing to another connection)
- * WARNING: must be called with TCPCONN_LOCK held */
+ * WARNING: must be called with the lock stripes covering c's hash
+ * entries and the new alias bucket held (tcpconn_conn_lock() or
+ * TCPCONN_LOCK) */
 inline static int _tcpconn_add_alias_unsafe(struct tcp_connection *c, int port,
 		struct ip_addr *l_ip, int l_port, int flags)
 {
@@ -1986,6 +2193,8 @@ int tcpconn_add_alias(int id, int port, int proto)
 
 	/* fix the port */
 	port = port ? port : ((proto == PROTO_TLS) ? SIPS_PORT : SIP_PORT);
+	/* all the stripes are taken here: the alias buckets depend on the
+	 * connection, which is known only after the lookup by id */
 	TCPCONN_LOCK;
 	/* check if alias already exists */
 	c = _tcpconn_find(id, 0, 0, 0, 0, PROTO_NONE);
@@ -2540,11 +2749,16 @@ conn_wait_close:
 	/* here the connection is for sure in the hash (tcp_main will not
 	 * remove it because it's marked as PENDing) and the refcnt is at least 2
 	 */
-	TCPCONN_LOCK;
-	_tcpconn_detach(c);
-	c->flags &= ~F_CONN_HASHED;
-	tcpconn_put(c);
-	TCPCONN_UNLOCK;
+	{
+		int stripes[TCPCONN_STRIPES_MAX];
+		int nstripes;
+
+		nstripes = tcpconn_conn_lock(c, 0, 0, stripes);
+		_tcpconn_detach(c);
+		c->flags &= ~F_CONN_HASHED;
+		tcpconn_put(c);
+		tcpconn_stripes_release(stripes, nstripes);
+	}
 	/* dec refcnt -> mark it for destruction */
 	tcpconn_chld_put(c);
 	return n;
@@ -2879,6 +3093,9 @@ static int tcpconn_do_send(int fd, struct tcp_connection *c, const char *buf,
 #ifdef TCP_ASYNC
 	int enable_write_watch;
 #endif /* TCP_ASYNC */
+#ifdef TSEND_ZEROCOPY
+	int zc_min;
+#endif /* TSEND_ZEROCOPY */
 
 	LM_DBG("sending...\n");
 	*resp = CONN_NOP;
@@ -2907,6 +3124,15 @@ static int tcpconn_do_send(int fd, struct tcp_connection *c, const char *buf,
 		n = _tcpconn_write_nb(fd, c, buf, len);
 	} else {
 #endif /* TCP_ASYNC */
+#ifdef TSEND_ZEROCOPY
+	zc_min = cfg_get(tcp, tcp_cfg, zerocopy_min);
+	if(unlikely(zc_min > 0 && len >= (unsigned)zc_min))
+		/* large message - pin the buffer pages instead of copying them
+			 * into the kernel (needs SO_ZEROCOPY, see init_sock_opt()) */
+		n = tsend_stream_zc(fd, buf, len,
+				TICKS_TO_S(cfg_get(tcp, tcp_cfg, send_timeout)) * 1000);
+	else
+#endif /* TSEND_ZEROCOPY */
 		n = tsend_stream(fd, buf, len,
 				TICKS_TO_S(cfg_get(tcp, tcp_cfg, send_timeout)) * 1000);
 #ifdef TCP_ASYNC
@@ -3425,14 +3651,17 @@ inline static void tcpconn_destroy(struct tcp_connection *tcpconn)
 	LM_DBG("destroying connection %p (%d, %d) flags %04x\n", tcpconn,
 			tcpconn->id, tcpconn->s, tcpconn->flags);
 	if(unlikely(tcpconn->flags & F_CONN_HASHED)) {
+		int stripes[TCPCONN_STRIPES_MAX];
+		int nstripes;
+
 		LM_CRIT("called with hashed connection (%p)\n", tcpconn);
 		/* try to continue */
 		if(likely(tcpconn->flags & F_CONN_MAIN_TIMER))
 			local_timer_del(&tcp_main_ltimer, &tcpconn->timer);
-		TCPCONN_LOCK;
+		nstripes = tcpconn_conn_lock(tcpconn, 0, 0, stripes);
 		_tcpconn_detach(tcpconn);
 		tcpconn->flags &= ~(F_CONN_HASHED | F_CONN_MAIN_TIMER);
-		TCPCONN_UNLOCK;
+		tcpconn_stripes_release(stripes, nstripes);
 	}
 	if(likely(!(tcpconn->flags & F_CONN_FD_CLOSED))) {
 		tcpconn_close_main_fd(tcpconn);
@@ -3463,16 +3692,19 @@ inline static int tcpconn_put_destroy(struct tcp_connection *tcpconn)
 						 | F_CONN_READ_W)))) {
 		/* sanity check */
 		if(unlikely(tcpconn->flags & F_CONN_HASHED)) {
+			int stripes[TCPCONN_STRIPES_MAX];
+			int nstripes;
+
 			LM_CRIT("called with hashed and/or"
 					"on timer connection (%p), flags = %0x\n",
 					tcpconn, tcpconn->flags);
 			/* try to continue */
 			if(likely(tcpconn->flags & F_CONN_MAIN_TIMER))
 				local_timer_del(&tcp_main_ltimer, &tcpconn->timer);
-			TCPCONN_LOCK;
+			nstripes = tcpconn_conn_lock(tcpconn, 0, 0, stripes);
 			_tcpconn_detach(tcpconn);
 			tcpconn->flags &= ~(F_CONN_HASHED | F_CONN_MAIN_TIMER);
-			TCPCONN_UNLOCK;
+			tcpconn_stripes_release(stripes, nstripes);
 		} else {
 			LM_CRIT("%p flags = %0x\n", tcpconn, tcpconn->flags);
 		}
@@ -3510,6 +3742,9 @@ inline static int tcpconn_put_destroy(struct tcp_connection *tcpconn)
  */
 inline static int tcpconn_try_unhash(struct tcp_connection *tcpconn)
 {
+	int stripes[TCPCONN_STRIPES_MAX];
+	int nstripes;
+
 	if(likely(tcpconn->flags & F_CONN_HASHED)) {
 		tcpconn->state = S_CONN_BAD;
 		if(likely(tcpconn->flags & F_CONN_MAIN_TIMER)) {
@@ -3518,14 +3753,14 @@ inline static int tcpconn_try_unhash(struct tcp_connection *tcpconn)
 		} else
 			/* in case it's still in a reader timer */
 			tcpconn->timeout = get_ticks_raw();
-		TCPCONN_LOCK;
+		nstripes = tcpconn_conn_lock(tcpconn, 0, 0, stripes);
 		if(tcpconn->flags & F_CONN_HASHED) {
 			tcpconn->flags &= ~F_CONN_HASHED;
 			_tcpconn_detach(tcpconn);
-			TCPCONN_UNLOCK;
+			tcpconn_stripes_release(stripes, nstripes);
 		} else {
 			/* tcp_send was faster and did unhash it itself */
-			TCPCONN_UNLOCK;
+			tcpconn_stripes_release(stripes, nstripes);
 			return 0;
 		}
 #ifdef TCP_ASYNC
@@ -3718,6 +3953,37 @@ again:
 	return n;
 }
 
+
+/* non blocking scatter-gather write on a tcp connection, unsafe version
+ * (should be called while holding c->write_lock). The fd should be
+ * non-blocking.
+ *  returns number of bytes written on success, -1 on error (and sets errno)
+ */
+int _tcpconn_writev_nb(
+		int fd, struct tcp_connection *c, struct iovec *iov, int iovcnt)
+{
+	int n;
+	struct msghdr msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovcnt;
+again:
+	n = sendmsg(fd, &msg,
+#ifdef HAVE_MSG_NOSIGNAL
+			MSG_NOSIGNAL
+#else
+			0
+#endif /* HAVE_MSG_NOSIGNAL */
+	);
+	if(unlikely(n < 0)) {
+		if(errno == EINTR)
+			goto again;
+	}
+	return n;
+}
+
+
 static tcp_connection_t *_ksr_tcpcon_evcb = NULL;
 
 tcp_connection_t *ksr_tcpcon_evcb_get(void)
@@ -4475,6 +4741,90 @@ inline static int send2child(struct tcp_connection *tcpconn)
  *           io events queued), >0 on success. success/error refer only to
  *           the accept.
  */
+/* token bucket pacing for accepts (see the accept_cps tcp option); runs
+ * only in the tcp_main process, so plain static state is enough.
+ * returns 1 when the new connection should be shed, 0 otherwise */
+static int tcp_accept_paced_drop(unsigned int acps)
+{
+	static ticks_t last = 0;
+	static unsigned int tokens_k = 0; /* tokens x1000 */
+	ticks_t t;
+	unsigned int delta_ms;
+
+	t = get_ticks_raw();
+	if(unlikely(last == 0)) {
+		/* first run: full bucket */
+		last = t;
+		tokens_k = acps * 1000;
+	}
+	delta_ms = TICKS_TO_MS(t - last);
+	if(delta_ms) {
+		if(delta_ms > 1000)
+			delta_ms = 1000; /* burst capacity: 1s worth of tokens */
+		tokens_k += acps * delta_ms;
+		if(tokens_k > acps * 1000)
+			tokens_k = acps * 1000;
+		last = t;
+	}
+	if(tokens_k < 1000)
+		return 1;
+	tokens_k -= 1000;
+	return 0;
+}
+
+
+/* request draining mode: on the next accept event tcp_main closes all
+ * its listen sockets and keeps serving only the established
+ * connections, so an overlapping instance started with reuse_port=1
+ * takes over the new connections (see the core.tcp_drain rpc).
+ * May be called from any process. */
+int tcp_drain_start(void)
+{
+	if(ksr_tcp_drain == NULL)
+		return -1;
+	*ksr_tcp_drain = 1;
+	return 0;
+}
+
+
+/* returns the draining mode state: 0 - off, 1 - requested,
+ * 2 - listen sockets closed */
+int tcp_drain_status(void)
+{
+	if(ksr_tcp_drain == NULL)
+		return 0;
+	return *ksr_tcp_drain;
+}
+
+
+/* close all the tcp/tls listen sockets; runs only in tcp_main */
+static void tcp_drain_close_listeners(void)
+{
+	struct socket_info *si;
+
+	for(si = tcp_listen; si; si = si->next) {
+		if(si->proto == PROTO_TCP && si->socket != -1) {
+			io_watch_del(&io_h, si->socket, -1, IO_FD_CLOSING);
+			tcp_safe_close(si->socket);
+			si->socket = -1;
+		}
+	}
+#ifdef USE_TLS
+	if(!tls_disable && tls_loaded()) {
+		for(si = tls_listen; si; si = si->next) {
+			if(si->proto == PROTO_TLS && si->socket != -1) {
+				io_watch_del(&io_h, si->socket, -1, IO_FD_CLOSING);
+				tcp_safe_close(si->socket);
+				si->socket = -1;
+			}
+		}
+	}
+#endif
+	LM_NOTICE("draining mode: tcp/tls listen sockets closed, established"
+			  " connections are kept\n");
+}
+
+
 static inline int handle_new_connect(struct socket_info *si)
 {
 	union sockaddr_union su;
@@ -4485,6 +4835,15 @@ static inline int handle_new_connect(struct socket_info *si)
 	socklen_t su_len;
 	int new_sock;
 
+	if(unlikely(ksr_tcp_drain != NULL && *ksr_tcp_drain == 1)) {
+		/* draining requested - close the listeners instead of accepting;
+		 * connections still queued on them are reset by the kernel and
+		 * the peers retry against the overlapping instance */
+		tcp_drain_close_listeners();
+		*ksr_tcp_drain = 2;
+		return 0;
+	}
+
 	/* got a connection on r */
 	su_len = sizeof(su);
 	new_sock = accept(si->socket, &(su.s), &su_len);
@@ -4495,6 +4854,17 @@ static inline int handle_new_connect(struct socket_info *si)
 				strerror(errno));
 		return -1;
 	}
+	if(unlikely(cfg_get(tcp, tcp_cfg, accept_cps) != 0
+				&& tcp_accept_paced_drop(
+						cfg_get(tcp, tcp_cfg, accept_cps)))) {
+		/* over the admission rate (e.g. re-registration avalanche after
+		 * a restart) - close right away so the peer gets an orderly
+		 * close and retries later, instead of collapsing under shm and
+		 * handshake pressure; still drains the backlog quickly */
+		tcp_safe_close(new_sock);
+		TCP_STATS_ACCEPT_SHED();
+		return 1; /* success, because the accept was successful */
+	}
 	if(unlikely(
 			   *tcp_connections_no >= cfg_get(tcp, tcp_cfg, max_connections))) {
 		LM_ERR("maximum number of connections exceeded: %d/%d\n",
@@ -4790,9 +5160,19 @@ inline static int handle_io(struct fd_map *fm, short ev, int idx)
 	cfg_update();
 
 	switch(fm->type) {
-		case F_SOCKINFO:
-			ret = handle_new_connect((struct socket_info *)fm->data);
+		case F_SOCKINFO: {
+			int aburst;
+
+			/* drain the accept queue in bursts - one listen fd wakeup
+			 * can cost a full io loop iteration, which adds up during
+			 * connection storms (e.g. post-restart re-registrations) */
+			aburst = cfg_get(tcp, tcp_cfg, accept_burst);
+			do {
+				ret = handle_new_connect((struct socket_info *)fm->data);
+				aburst--;
+			} while(ret > 0 && aburst > 0);
 			break;
+		}
 		case F_TCPCONN:
 			ret = handle_tcpconn_ev((struct tcp_connection *)fm->data, ev, idx);
 			break;
@@ -4876,11 +5256,14 @@ static ticks_t tcpconn_main_timeout(ticks_t t, struct timer_ln *tl, void *data)
 #endif /* TCP_ASYNC */
 	LM_DBG("timeout for %p\n", c);
 	if(likely(c->flags & F_CONN_HASHED)) {
+		int stripes[TCPCONN_STRIPES_MAX];
+		int nstripes;
+
 		c->flags &= ~(F_CONN_HASHED | F_CONN_MAIN_TIMER);
 		c->state = S_CONN_BAD;
-		TCPCONN_LOCK;
+		nstripes = tcpconn_conn_lock(c, 0, 0, stripes);
 		_tcpconn_detach(c);
-		TCPCONN_UNLOCK;
+		tcpconn_stripes_release(stripes, nstripes);
 	} else {
 		c->flags &= ~F_CONN_MAIN_TIMER;
 		LM_CRIT("timer: called with unhashed connection %p\n", c);
@@ -5119,6 +5502,15 @@ void tcp_main_loop()
 				tcp_timer_run();
 			}
 			break;
+#endif
+#ifdef HAVE_IO_URING
+		case POLL_IO_URING:
+			while(1) {
+				io_wait_loop_uring(&io_h, TCP_MAIN_SELECT_TIMEOUT, 0);
+				send_fd_queue_run(&send2child_q); /* then new io */
+				tcp_timer_run();
+			}
+			break;
 #endif
 		default:
 			LM_CRIT("no support for poll method %s (%d)\n",
@@ -5139,11 +5531,11 @@ error:
 void destroy_tcp()
 {
 	if(tcpconn_id_hash) {
-		if(tcpconn_lock)
-			TCPCONN_UNLOCK; /* hack: force-unlock the tcp lock in case
-								   some process was terminated while holding
-								   it; this will allow an almost gracious
-								   shutdown */
+		if(tcpconn_locks)
+			TCPCONN_UNLOCK; /* hack: force-unlock the tcp hash locks in
+								   case some process was terminated while
+								   holding one of them; this will allow an
+								   almost gracious shutdown */
 		tcpconn_destroy_all();
 		shm_free(tcpconn_id_hash);
 		tcpconn_id_hash = 0;
@@ -5171,10 +5563,13 @@ void destroy_tcp()
 		shm_free(tcpconn_aliases_hash);
 		tcpconn_aliases_hash = 0;
 	}
-	if(tcpconn_lock) {
-		lock_destroy(tcpconn_lock);
-		lock_dealloc((void *)tcpconn_lock);
-		tcpconn_lock = 0;
+	if(tcpconn_locks) {
+		int r;
+
+		for(r = 0; r < TCP_LOCK_STRIPES; r++)
+			lock_destroy(&tcpconn_locks[r]);
+		shm_free(tcpconn_locks);
+		tcpconn_locks = 0;
 	}
 	if(tcp_children) {
 		pkg_free(tcp_children);
@@ -5187,23 +5582,28 @@ void destroy_tcp()
 int init_tcp()
 {
 	char *poll_err;
+	int r;
 
 	tcp_options_check();
 	if(tcp_cfg == 0) {
 		BUG("tcp_cfg not initialized\n");
 		goto error;
 	}
-	/* init lock */
-	tcpconn_lock = lock_alloc();
-	if(tcpconn_lock == 0) {
-		LM_CRIT("could not alloc lock\n");
+	/* init the hash lock stripes */
+	tcpconn_locks = shm_malloc(TCP_LOCK_STRIPES * sizeof(gen_lock_t));
+	if(tcpconn_locks == 0) {
+		SHM_MEM_CRITICAL;
 		goto error;
 	}
-	if(lock_init(tcpconn_lock) == 0) {
-		LM_CRIT("could not init lock\n");
-		lock_dealloc((void *)tcpconn_lock);
-		tcpconn_lock = 0;
-		goto error;
+	for(r = 0; r < TCP_LOCK_STRIPES; r++) {
+		if(lock_init(&tcpconn_locks[r]) == 0) {
+			LM_CRIT("could not init lock\n");
+			for(; r > 0; r--)
+				lock_destroy(&tcpconn_locks[r - 1]);
+			shm_free(tcpconn_locks);
+			tcpconn_locks = 0;
+			goto error;
+		}
 	}
 	/* init globals */
 	tcp_connections_no = shm_malloc(sizeof(int));
@@ -5226,6 +5626,12 @@ int init_tcp()
 		goto error;
 	}
 	*connection_id = 1;
+	ksr_tcp_drain = shm_malloc(sizeof(int));
+	if(ksr_tcp_drain == 0) {
+		SHM_MEM_CRITICAL;
+		goto error;
+	}
+	*ksr_tcp_drain = 0;
 #ifdef TCP_ASYNC
 	tcp_total_wq = shm_malloc(sizeof(*tcp_total_wq));
 	if(tcp_total_wq == 0) {
@@ -5446,6 +5852,38 @@ void tcp_get_info(struct tcp_gen_info *ti)
 }
 
 
+/* summed accept backlog depth over all the tcp/tls listen sockets, read
+ * via TCP_INFO (connections that finished the handshake but were not yet
+ * accept()ed); 0 where the OS does not export it */
+int tcp_get_acceptq(void)
+{
+	int n;
+
+	n = 0;
+#if defined(__OS_linux) && defined(TCP_INFO)
+	{
+		struct socket_info *si;
+		struct tcp_info ti;
+		socklen_t tlen;
+
+		for(si = tcp_listen; si; si = si->next) {
+			tlen = sizeof(ti);
+			if(getsockopt(si->socket, IPPROTO_TCP, TCP_INFO, &ti, &tlen) == 0)
+				n += ti.tcpi_unacked;
+		}
+#ifdef USE_TLS
+		for(si = tls_listen; si; si = si->next) {
+			tlen = sizeof(ti);
+			if(getsockopt(si->socket, IPPROTO_TCP, TCP_INFO, &ti, &tlen) == 0)
+				n += ti.tcpi_unacked;
+		}
+#endif /* USE_TLS */
+	}
+#endif /* __OS_linux && TCP_INFO */
+	return n;
+}
+
+
 /* finds an ws/wss tcpconn & sends on it
  * uses the dst members to, proto (ws/wss) and id and tries to send
  * returns: number of bytes written (>=0) on success
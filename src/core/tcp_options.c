@@ -27,6 +27,7 @@
 #include "timer_ticks.h"
 #include "cfg/cfg.h"
 #include "tcp_init.h" /* DEFAULT* */
+#include "tsend.h"	  /* TSEND_ZEROCOPY */
 
 
 /* default/initial values for tcp config options
@@ -76,6 +77,9 @@ static cfg_def_t tcp_cfg_def[] = {
 		{"wq_max", CFG_VAR_INT | CFG_ATOMIC, 0, 1 << 30, 0, 0,
 				"maximum bytes queued for write allowed globally (depends on "
 				"async)"},
+		{"wq_write_max", CFG_VAR_INT | CFG_ATOMIC, 0, 16777216, 0, 0,
+				"maximum bytes coalesced from the write queue into one writev "
+				"(0 = one queue block per write, depends on async)"},
 		/* see also send_timeout above */
 		/* tcp socket options */
 		{"defer_accept", CFG_VAR_INT | CFG_READONLY, 0, 3600, 0, 0,
@@ -113,6 +117,14 @@ static cfg_def_t tcp_cfg_def[] = {
 				"accept TCP messages without Content-Length "},
 		{"reuse_port", CFG_VAR_INT | CFG_ATOMIC, 0, 1, 0, 0,
 				"reuse TCP ports "},
+		{"zerocopy_min", CFG_VAR_INT | CFG_ATOMIC, 0, 16777216, 0, 0,
+				"minimum message size for MSG_ZEROCOPY tcp sends (0 - "
+				"disabled)"},
+		{"accept_burst", CFG_VAR_INT | CFG_ATOMIC, 1, 1024, 0, 0,
+				"maximum connections accepted per listen socket event"},
+		{"accept_cps", CFG_VAR_INT | CFG_ATOMIC, 0, 1000000, 0, 0,
+				"maximum connections accepted per second, token bucket paced "
+				"(0 - unlimited)"},
 		{"wait_data_ms", CFG_VAR_INT | CFG_ATOMIC, 0, 7200000, 0, 0,
 				"wait for data on new tcp connections (milliseconds)"},
 		{"close_rst", CFG_VAR_INT | CFG_READONLY, 0, 1, 0, 0,
@@ -147,6 +159,7 @@ void init_tcp_options()
 	tcp_default_cfg.async = 1;
 	tcp_default_cfg.tcpconn_wq_max = 32 * 1024;	   /* 32 k */
 	tcp_default_cfg.tcp_wq_max = 10 * 1024 * 1024; /* 10 MB */
+	tcp_default_cfg.wq_write_max = 64 * 1024;	   /* 64 k */
 #ifdef TCP_CONNECT_WAIT
 	tcp_default_cfg.tcp_connect_wait = 1;
 #endif /* TCP_CONNECT_WAIT */
@@ -174,6 +187,9 @@ void init_tcp_options()
 	tcp_default_cfg.rd_buf_size = DEFAULT_TCP_BUF_SIZE;
 	tcp_default_cfg.wq_blk_size = DEFAULT_TCP_WBUF_SIZE;
 	tcp_default_cfg.reuse_port = 0;
+	tcp_default_cfg.zerocopy_min = 0;
+	tcp_default_cfg.accept_burst = 32;
+	tcp_default_cfg.accept_cps = 0;
 	tcp_default_cfg.wait_data_ms = 5000;
 	tcp_default_cfg.close_rst = 0;
 }
@@ -330,6 +346,7 @@ void tcp_options_check()
 	W_OPT_NC(async);
 	W_OPT_NC(tcpconn_wq_max);
 	W_OPT_NC(tcp_wq_max);
+	W_OPT_NC(wq_write_max);
 #endif /* TCP_ASYNC */
 #ifndef TCP_CONNECT_WAIT
 	W_OPT_NC(tcp_connect_wait);
@@ -366,6 +383,9 @@ void tcp_options_check()
 #endif
 #ifndef HAVE_TCP_QUICKACK
 	W_OPT_NS(delayed_ack);
+#endif
+#ifndef TSEND_ZEROCOPY
+	W_OPT_NS(zerocopy_min);
 #endif
 	/* fix various timeouts */
 	fix_timeout("tcp_connect_timeout", &tcp_default_cfg.connect_timeout_s,
@@ -127,6 +127,8 @@ struct cfg_group_tcp
 	int tcp_connect_wait;		 /* on / off, depends on async */
 	unsigned int tcpconn_wq_max; /* maximum queue len per connection */
 	unsigned int tcp_wq_max;	 /* maximum overall queued bytes */
+	unsigned int wq_write_max;	 /* max bytes coalesced per async writev */
+	unsigned int accept_cps;	 /* max accepted connections per second */
 
 	/* tcp socket options */
 	int defer_accept; /* on / off */
@@ -145,6 +147,8 @@ struct cfg_group_tcp
 	int new_conn_alias_flags;
 	int accept_no_cl; /* on/off - accept messages without content-length */
 	int reuse_port;	  /* enable SO_REUSEPORT */
+	int zerocopy_min; /* min. msg. size for MSG_ZEROCOPY sends (0=off) */
+	int accept_burst; /* max. connections accepted per listen fd event */
 	int wait_data_ms; /* wait for data in milliseconds */
 	int close_rst;	  /* on /off trigger an RST on connection close */
 
@@ -82,12 +82,25 @@
 
 #define TCPCONN_TIMEOUT_MIN_RUN 1 /* run the timers each new tick */
 
+#if defined(HAVE_EPOLL) && defined(__OS_linux)
+/* with epoll, drive the connection timeouts from a timerfd in the fd set
+ * instead of checking the local timer on every loop iteration: expired
+ * deadlines are then processed in batched runs when the timerfd fires and
+ * a loop busy with i/o events does no timer bookkeeping at all */
+#define TCP_READER_TIMERFD
+#include <sys/timerfd.h>
+/* batch interval; the reader deadlines have seconds granularity
+ * (TCP_CHILD_TIMEOUT), so expiring them up to half a second late is fine */
+#define TCP_READER_TIMERFD_INTERVAL_MS 500
+#endif
+
 /* types used in io_wait* */
 enum fd_types
 {
 	F_NONE,
 	F_TCPMAIN,
-	F_TCPCONN
+	F_TCPCONN,
+	F_TIMERFD
 };
 
 /* list of tcp connections handled by this process */
@@ -95,6 +108,10 @@ static struct tcp_connection *tcp_conn_lst = 0;
 static io_wait_h io_w; /* io_wait handler*/
 static int tcpmain_sock = -1;
 
+#ifdef TCP_READER_TIMERFD
+static int tcp_reader_tfd = -1;
+#endif
+
 static struct local_timer tcp_reader_ltimer;
 static ticks_t tcp_reader_prev_ticks;
 
@@ -1760,6 +1777,8 @@ static ticks_t tcpconn_read_timeout(ticks_t t, struct timer_ln *tl, void *data)
  *         >0 on successfull read from the fd (when there might be more io
  *            queued -- the receive buffer might still be non-empty)
  */
+inline static void tcp_reader_timer_run(void); /* fwd. decl. */
+
 inline static int handle_io(struct fd_map *fm, short events, int idx)
 {
 	int ret;
@@ -1770,6 +1789,9 @@ inline static int handle_io(struct fd_map *fm, short events, int idx)
 	long resp;
 	ticks_t t;
 	fd_map_t *ee = NULL;
+#ifdef TCP_READER_TIMERFD
+	unsigned long long texp;
+#endif
 
 	/* update the local config */
 	cfg_update();
@@ -1950,6 +1972,17 @@ inline static int handle_io(struct fd_map *fm, short events, int idx)
 						- 1);
 			}
 			break;
+#ifdef TCP_READER_TIMERFD
+		case F_TIMERFD:
+			/* drain the expiration counter (read until EAGAIN so that it
+			 * works with edge triggered epoll too), then process all the
+			 * deadlines accumulated since the last run in one batch */
+			while(read(tcp_reader_tfd, &texp, sizeof(texp)) == sizeof(texp))
+				;
+			tcp_reader_timer_run();
+			ret = 0;
+			break;
+#endif
 		case F_NONE:
 			LM_CRIT("empty fd map %p (%d): {%d, %d, %p}\n", fm,
 					(int)(fm - io_w.fd_hash), fm->fd, fm->type, fm->data);
@@ -1983,6 +2016,9 @@ inline static void tcp_reader_timer_run(void)
 
 void tcp_receive_loop(int unix_sock)
 {
+#ifdef TCP_READER_TIMERFD
+	struct itimerspec its;
+#endif
 
 	/* init */
 	tcpmain_sock = unix_sock; /* init com. socket */
@@ -1997,6 +2033,31 @@ void tcp_receive_loop(int unix_sock)
 		goto error;
 	}
 
+#ifdef TCP_READER_TIMERFD
+	if(io_w.poll_method == POLL_EPOLL_LT || io_w.poll_method == POLL_EPOLL_ET) {
+		tcp_reader_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+		if(tcp_reader_tfd != -1) {
+			memset(&its, 0, sizeof(its));
+			its.it_interval.tv_sec = TCP_READER_TIMERFD_INTERVAL_MS / 1000;
+			its.it_interval.tv_nsec =
+					(TCP_READER_TIMERFD_INTERVAL_MS % 1000) * 1000000L;
+			its.it_value = its.it_interval;
+			if(timerfd_settime(tcp_reader_tfd, 0, &its, 0) != 0
+					|| io_watch_add(&io_w, tcp_reader_tfd, POLLIN, F_TIMERFD, 0)
+							   < 0) {
+				LM_WARN("failed to set up the expiry timerfd, falling back to"
+						" per loop timer checks\n");
+				close(tcp_reader_tfd);
+				tcp_reader_tfd = -1;
+			}
+		} else {
+			LM_WARN("timerfd_create failed: %s - falling back to per loop"
+					" timer checks\n",
+					strerror(errno));
+		}
+	}
+#endif
+
 	/* initialize the config framework */
 	if(cfg_child_init())
 		goto error;
@@ -2029,12 +2090,20 @@ void tcp_receive_loop(int unix_sock)
 		case POLL_EPOLL_LT:
 			while(1) {
 				io_wait_loop_epoll(&io_w, TCP_CHILD_SELECT_TIMEOUT, 0);
+#ifdef TCP_READER_TIMERFD
+				if(likely(tcp_reader_tfd != -1))
+					continue; /* expiry is driven by the timerfd */
+#endif
 				tcp_reader_timer_run();
 			}
 			break;
 		case POLL_EPOLL_ET:
 			while(1) {
 				io_wait_loop_epoll(&io_w, TCP_CHILD_SELECT_TIMEOUT, 1);
+#ifdef TCP_READER_TIMERFD
+				if(likely(tcp_reader_tfd != -1))
+					continue; /* expiry is driven by the timerfd */
+#endif
 				tcp_reader_timer_run();
 			}
 			break;
@@ -2054,6 +2123,14 @@ void tcp_receive_loop(int unix_sock)
 				tcp_reader_timer_run();
 			}
 			break;
+#endif
+#ifdef HAVE_IO_URING
+		case POLL_IO_URING:
+			while(1) {
+				io_wait_loop_uring(&io_w, TCP_CHILD_SELECT_TIMEOUT, 0);
+				tcp_reader_timer_run();
+			}
+			break;
 #endif
 		default:
 			LM_CRIT("no support for poll method %s (%d)\n",
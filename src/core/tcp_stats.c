@@ -35,7 +35,8 @@ enum tcp_info_req
 {
 	TCP_INFO_NONE,
 	TCP_INFO_CONN_NO,
-	TCP_INFO_WR_QUEUE_SZ
+	TCP_INFO_WR_QUEUE_SZ,
+	TCP_INFO_ACCEPT_Q
 };
 
 static counter_val_t tcp_info(counter_handle_t h, void *what);
@@ -66,12 +67,17 @@ counter_def_t tcp_cnt_defs[] = {
 				"number of send attempts that failed because of exceeded "
 				"buffering"
 				"capacity (send queue full, works only in tcp async mode)."},
+		{&tcp_cnts_h.accept_shed, "accept_shed", 0, 0, 0,
+				"number of accepted connections immediately closed by the "
+				"accept_cps rate limiter."},
 		{0, "current_opened_connections", 0, tcp_info,
 				(void *)(long)TCP_INFO_CONN_NO,
 				"number of currently opened connections."},
 		{0, "current_write_queue_size", 0, tcp_info,
 				(void *)(long)TCP_INFO_WR_QUEUE_SZ,
 				"current sum of all the connections write queue sizes."},
+		{0, "current_accept_queue", 0, tcp_info, (void *)(long)TCP_INFO_ACCEPT_Q,
+				"current depth of the listen sockets accept backlogs (linux)."},
 		{0, 0, 0, 0, 0, 0}};
 
 
@@ -91,6 +97,8 @@ static counter_val_t tcp_info(counter_handle_t h, void *what)
 			return ti.tcp_connections_no;
 		case TCP_INFO_WR_QUEUE_SZ:
 			return ti.tcp_write_queued;
+		case TCP_INFO_ACCEPT_Q:
+			return tcp_get_acceptq();
 		case TCP_INFO_NONE:
 			break;
 	};
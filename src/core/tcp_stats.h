@@ -38,6 +38,7 @@
 #define TCP_STATS_CON_RESET()
 #define TCP_STATS_SEND_TIMEOUT()
 #define TCP_STATS_SENDQ_FULL()
+#define TCP_STATS_ACCEPT_SHED()
 
 #else /* USE_TCP_STATS */
 
@@ -54,6 +55,7 @@ struct tcp_counters_h
 	counter_handle_t con_reset;
 	counter_handle_t send_timeout;
 	counter_handle_t sendq_full;
+	counter_handle_t accept_shed;
 };
 
 extern struct tcp_counters_h tcp_cnts_h;
@@ -111,6 +113,11 @@ void tcp_stats_destroy(void);
   */
 #define TCP_STATS_SENDQ_FULL() counter_inc(tcp_cnts_h.sendq_full)
 
+/** called each time a new connection is shed by the accept rate limiter.
+  * (see the accept_cps tcp option)
+  */
+#define TCP_STATS_ACCEPT_SHED() counter_inc(tcp_cnts_h.accept_shed)
+
 #endif /* USE_TCP_STATS */
 
 #endif /*__tcp_stats_h*/
@@ -44,6 +44,7 @@
 #include "config.h"
 */
 #include "globals.h"
+#include "pt.h"
 #include "mem/mem.h"
 #include "mem/shm_mem.h"
 #include "locking.h"
@@ -71,21 +72,23 @@ static struct timeval start_time; /* for debugging */
 static volatile int run_timer = 0;
 static int timer_id = 0;
 
-static gen_lock_t *timer_lock = 0;
-static struct timer_ln *volatile *running_timer = 0; /* running timer handler */
+static gen_lock_t *timer_locks = 0; /* one lock per timer wheel */
+static struct timer_ln *volatile *running_timer = 0; /* running timer handler,
+													  * one slot per wheel */
 static int in_timer = 0;
+static int crt_wheel = 0; /* wheel processed by the timer process */
 
 #define IS_IN_TIMER() (in_timer)
 
-#define LOCK_TIMER_LIST() lock_get(timer_lock)
-#define UNLOCK_TIMER_LIST() lock_release(timer_lock)
+#define LOCK_TIMER_WHEEL(w) lock_get(&timer_locks[(w)])
+#define UNLOCK_TIMER_WHEEL(w) lock_release(&timer_locks[(w)])
 
 /* we can get away without atomic_set/atomic_cmp and write barriers because we
- * always call SET_RUNNING and IS_RUNNING while holding the timer lock
+ * always call SET_RUNNING and IS_RUNNING while holding the wheel lock
  * => it's implicitly atomic and the lock acts as write barrier */
-#define SET_RUNNING(t) (*running_timer = (t))
-#define IS_RUNNING(t) (*running_timer == (t))
-#define UNSET_RUNNING() (*running_timer = 0)
+#define SET_RUNNING(w, t) (running_timer[(w)] = (t))
+#define IS_RUNNING(w, t) (running_timer[(w)] == (t))
+#define UNSET_RUNNING(w) (running_timer[(w)] = 0)
 
 #ifdef USE_SLOW_TIMER
 
@@ -100,7 +103,11 @@ static int in_timer = 0;
 
 
 static gen_lock_t *slow_timer_lock; /* slow timer lock */
-static struct timer_head *slow_timer_lists;
+static struct timer_head *slow_timer_lists; /* SLOW_LISTS_NO lists per wheel,
+											 * so that the timer process fills
+											 * them under the wheel lock */
+
+#define SLOW_TIMER_LIST(w, i) (&slow_timer_lists[(w)*SLOW_LISTS_NO + (i)])
 static volatile unsigned short *t_idx; /* "main" timer index in slow_lists[] */
 static volatile unsigned short *s_idx; /* "slow" timer index in slow_lists[] */
 static struct timer_ln *volatile *running_timer2 = 0; /* timer handler running
@@ -136,15 +143,17 @@ void sig_timer(int signo)
 void destroy_timer()
 {
 	struct itimerval it;
+	int r;
 
 	/* disable timer */
 	memset(&it, 0, sizeof(it));
 	setitimer(ITIMER_REAL, &it, 0);
 	set_sig_h(SIGALRM, SIG_IGN);
-	if(timer_lock) {
-		lock_destroy(timer_lock);
-		lock_dealloc(timer_lock);
-		timer_lock = 0;
+	if(timer_locks) {
+		for(r = 0; r < TIMER_WHEELS_NO; r++)
+			lock_destroy(&timer_locks[r]);
+		shm_free(timer_locks);
+		timer_locks = 0;
 	}
 	if(ticks) {
 		shm_free(ticks);
@@ -188,25 +197,31 @@ void destroy_timer()
 int init_timer()
 {
 	int r;
+	int w;
 	int ret;
 
 	ret = -1;
 
-	/* init the locks */
-	timer_lock = lock_alloc();
-	if(timer_lock == 0) {
+	/* init the wheel locks */
+	timer_locks = shm_malloc(sizeof(gen_lock_t) * TIMER_WHEELS_NO);
+	if(timer_locks == 0) {
+		SHM_MEM_CRITICAL;
 		ret = E_OUT_OF_MEM;
 		goto error;
 	}
-	if(lock_init(timer_lock) == 0) {
-		lock_dealloc(timer_lock);
-		timer_lock = 0;
-		ret = -1;
-		goto error;
+	for(r = 0; r < TIMER_WHEELS_NO; r++) {
+		if(lock_init(&timer_locks[r]) == 0) {
+			while(r > 0)
+				lock_destroy(&timer_locks[--r]);
+			shm_free(timer_locks);
+			timer_locks = 0;
+			ret = -1;
+			goto error;
+		}
 	}
 	/* init the shared structs */
 	ticks = shm_malloc(sizeof(ticks_t));
-	timer_lst = shm_malloc(sizeof(struct timer_lists));
+	timer_lst = shm_malloc(sizeof(struct timer_lists) * TIMER_WHEELS_NO);
 	if(ticks == 0) {
 		SHM_MEM_CRITICAL;
 		ret = E_OUT_OF_MEM;
@@ -217,7 +232,7 @@ int init_timer()
 		ret = E_OUT_OF_MEM;
 		goto error;
 	}
-	running_timer = shm_malloc(sizeof(struct timer_ln *));
+	running_timer = shm_malloc(sizeof(struct timer_ln *) * TIMER_WHEELS_NO);
 	if(running_timer == 0) {
 		SHM_MEM_CRITICAL;
 		ret = E_OUT_OF_MEM;
@@ -225,10 +240,11 @@ int init_timer()
 	}
 
 	/* initial values */
-	memset(timer_lst, 0, sizeof(struct timer_lists));
+	memset(timer_lst, 0, sizeof(struct timer_lists) * TIMER_WHEELS_NO);
 	*ticks = random(); /* random value for start, for debugging */
 	prev_ticks = last_ticks = last_adj_check = *ticks;
-	*running_timer = 0;
+	for(r = 0; r < TIMER_WHEELS_NO; r++)
+		running_timer[r] = 0;
 	if(gettimeofday(&start_time, 0) < 0) {
 		LM_ERR("gettimeofday failed: %s [%d]\n", strerror(errno), errno);
 		ret = -1;
@@ -238,13 +254,15 @@ int init_timer()
 	LM_DBG("starting with *ticks=%u\n", (unsigned)*ticks);
 
 	/* init timer structures */
-	for(r = 0; r < H0_ENTRIES; r++)
-		_timer_init_list(&timer_lst->h0[r]);
-	for(r = 0; r < H1_ENTRIES; r++)
-		_timer_init_list(&timer_lst->h1[r]);
-	for(r = 0; r < H2_ENTRIES; r++)
-		_timer_init_list(&timer_lst->h2[r]);
-	_timer_init_list(&timer_lst->expired);
+	for(w = 0; w < TIMER_WHEELS_NO; w++) {
+		for(r = 0; r < H0_ENTRIES; r++)
+			_timer_init_list(&timer_lst[w].h0[r]);
+		for(r = 0; r < H1_ENTRIES; r++)
+			_timer_init_list(&timer_lst[w].h1[r]);
+		for(r = 0; r < H2_ENTRIES; r++)
+			_timer_init_list(&timer_lst[w].h2[r]);
+		_timer_init_list(&timer_lst[w].expired);
+	}
 
 #ifdef USE_SLOW_TIMER
 
@@ -262,7 +280,8 @@ int init_timer()
 	}
 	t_idx = shm_malloc(sizeof(*t_idx));
 	s_idx = shm_malloc(sizeof(*s_idx));
-	slow_timer_lists = shm_malloc(sizeof(struct timer_head) * SLOW_LISTS_NO);
+	slow_timer_lists = shm_malloc(
+			sizeof(struct timer_head) * SLOW_LISTS_NO * TIMER_WHEELS_NO);
 	running_timer2 = shm_malloc(sizeof(struct timer_ln *));
 	if((t_idx == 0) || (s_idx == 0) || (slow_timer_lists == 0)
 			|| (running_timer2 == 0)) {
@@ -272,13 +291,14 @@ int init_timer()
 	}
 	*t_idx = *s_idx = 0;
 	*running_timer2 = 0;
-	for(r = 0; r < SLOW_LISTS_NO; r++)
-		_timer_init_list(&slow_timer_lists[r]);
+	for(w = 0; w < TIMER_WHEELS_NO; w++)
+		for(r = 0; r < SLOW_LISTS_NO; r++)
+			_timer_init_list(SLOW_TIMER_LIST(w, r));
 
 #endif
 
-	LM_DBG("timer_list between %p and %p\n", &timer_lst->h0[0],
-			&timer_lst->h2[H2_ENTRIES]);
+	LM_DBG("timer_list between %p and %p (%u wheels)\n", &timer_lst[0].h0[0],
+			&timer_lst[TIMER_WHEELS_NO - 1].h2[H2_ENTRIES], TIMER_WHEELS_NO);
 	return 0;
 error:
 	destroy_timer();
@@ -504,7 +524,7 @@ void timer_free(struct timer_ln *t)
 
 /* unsafe (no lock ) timer add function
  * t = current ticks
- * tl must be filled (the initial_timeout and flags must be set)
+ * tl must be filled (the initial_timeout, flags and wheel must be set)
  * returns -1 on error, 0 on success */
 static inline int _timer_add(ticks_t t, struct timer_ln *tl)
 {
@@ -516,7 +536,7 @@ static inline int _timer_add(ticks_t t, struct timer_ln *tl)
 #endif
 	delta = tl->initial_timeout;
 	tl->expire = t + delta;
-	return _timer_dist_tl(tl, delta);
+	return _timer_dist_tl(&timer_lst[tl->wheel], tl, delta);
 }
 
 
@@ -536,8 +556,34 @@ int timer_add_safe(struct timer_ln *tl, ticks_t delta)
 #endif
 {
 	int ret;
-
-	LOCK_TIMER_LIST();
+	unsigned short wheel;
+	unsigned short owheel;
+
+	/* shard by the adding process - timers armed by the same worker share
+	 * a wheel, so workers do not all contend on one global lock; pinned
+	 * timers keep the wheel chosen by their owner (e.g. tm pins all the
+	 * timers of a transaction to the wheel of the creating worker) */
+	if(unlikely(tl->flags & F_TIMER_PIN_WHEEL))
+		wheel = tl->wheel & TIMER_WHEELS_MASK;
+	else
+		wheel = (unsigned short)((process_no > 0 ? process_no : 0)
+								 & TIMER_WHEELS_MASK);
+	/* when the timer moves to another wheel, hold the old wheel lock too
+	 * (in index order, to avoid deadlocks): a concurrent timer_del()
+	 * serializes on the old wheel, so it cannot walk the new wheel list
+	 * with the wrong lock while the timer is re-linked */
+	owheel = tl->wheel & TIMER_WHEELS_MASK;
+	if(unlikely(owheel != wheel)) {
+		if(owheel < wheel) {
+			LOCK_TIMER_WHEEL(owheel);
+			LOCK_TIMER_WHEEL(wheel);
+		} else {
+			LOCK_TIMER_WHEEL(wheel);
+			LOCK_TIMER_WHEEL(owheel);
+		}
+	} else {
+		LOCK_TIMER_WHEEL(wheel);
+	}
 	if(tl->flags & F_TIMER_ACTIVE) {
 #ifdef TIMER_DEBUG
 		LOG(timerlog,
@@ -575,9 +621,13 @@ int timer_add_safe(struct timer_ln *tl, ticks_t delta)
 	tl->add_line = line;
 	tl->add_calls++;
 #endif
+	/* the wheel is re-assigned only while both wheel locks are held */
+	tl->wheel = wheel;
 	ret = _timer_add(*ticks, tl);
 error:
-	UNLOCK_TIMER_LIST();
+	if(unlikely(owheel != wheel))
+		UNLOCK_TIMER_WHEEL(owheel);
+	UNLOCK_TIMER_WHEEL(wheel);
 	return ret;
 }
 
@@ -595,6 +645,7 @@ int timer_del_safe(struct timer_ln *tl)
 #endif
 {
 	int ret;
+	unsigned short wheel;
 
 	ret = -1;
 again:
@@ -695,15 +746,22 @@ again:
 		UNLOCK_SLOW_TIMER_LIST();
 	} else {
 #endif
-		LOCK_TIMER_LIST();
+		wheel = tl->wheel & TIMER_WHEELS_MASK;
+		LOCK_TIMER_WHEEL(wheel);
+		if(unlikely((tl->wheel & TIMER_WHEELS_MASK) != wheel)) {
+			/* the timer was re-armed from another process and migrated
+			 * to a different wheel in the meantime - retry on that one */
+			UNLOCK_TIMER_WHEEL(wheel);
+			goto again;
+		}
 #ifdef USE_SLOW_TIMER
 		if(IS_ON_SLOW_LIST(tl) && (tl->slow_idx != *t_idx)) {
-			UNLOCK_TIMER_LIST();
+			UNLOCK_TIMER_WHEEL(wheel);
 			goto again;
 		}
 #endif
-		if(IS_RUNNING(tl)) {
-			UNLOCK_TIMER_LIST();
+		if(IS_RUNNING(wheel, tl)) {
+			UNLOCK_TIMER_WHEEL(wheel);
 			if(IS_IN_TIMER()) {
 				/* if somebody tries to shoot himself in the foot,
 					 * warn him and ignore the delete */
@@ -765,7 +823,7 @@ again:
 #endif
 			ret = -1;
 		}
-		UNLOCK_TIMER_LIST();
+		UNLOCK_TIMER_WHEEL(wheel);
 #ifdef USE_SLOW_TIMER
 	}
 #endif
@@ -789,7 +847,7 @@ again:
 void timer_allow_del(void)
 {
 	if(IS_IN_TIMER()) {
-		UNSET_RUNNING();
+		UNSET_RUNNING(crt_wheel);
 	} else
 #ifdef USE_SLOW_TIMER
 			if(IS_IN_TIMER_SLOW()) {
@@ -800,11 +858,11 @@ void timer_allow_del(void)
 }
 
 
-/* called from timer_handle, must be called with the timer lock held
+/* called from timer_handle, must be called with the wheel lock held
  * WARNING: expired one shot timers are _not_ automatically reinit
  *          (because they could have been already freed from the timer
  *           handler so a reinit would not be safe!) */
-inline static void timer_list_expire(ticks_t t, struct timer_head *h
+inline static void timer_list_expire(ticks_t t, int w, struct timer_head *h
 #ifdef USE_SLOW_TIMER
 		,
 		struct timer_head *slow_l, slow_idx_t slow_mark
@@ -838,7 +896,7 @@ inline static void timer_list_expire(ticks_t t, struct timer_head *h
 					tl->data, tl->f, tl->flags, h, h->next, h->prev);
 			LM_CRIT("-timer_list_expire-: cycle %d, first %p,"
 					"running %p\n",
-					i, first, *running_timer);
+					i, first, running_timer[w]);
 			LM_CRIT("-timer_list_expire-: added %d times"
 					", last from: %s(%s):%d, deleted %d times"
 					", last from: %s(%s):%d, init %d times, expired %d \n",
@@ -854,25 +912,25 @@ inline static void timer_list_expire(ticks_t t, struct timer_head *h
 		if(IS_FAST_TIMER(tl)) {
 #endif
 			/* if fast timer */
-			SET_RUNNING(tl);
+			SET_RUNNING(w, tl);
 			tl->next = tl->prev = 0; /* debugging */
 #ifdef TIMER_DEBUG
 			tl->expires_no++;
 #endif
-			UNLOCK_TIMER_LIST(); /* acts also as write barrier */
+			UNLOCK_TIMER_WHEEL(w); /* acts also as write barrier */
 			ret = tl->f(t, tl, tl->data);
 			/* reset the configuration group handles */
 			cfg_reset_all();
 			if(ret == 0) {
-				UNSET_RUNNING();
-				LOCK_TIMER_LIST();
+				UNSET_RUNNING(w);
+				LOCK_TIMER_WHEEL(w);
 			} else {
 				/* not one-shot, re-add it */
-				LOCK_TIMER_LIST();
+				LOCK_TIMER_WHEEL(w);
 				if(ret != (ticks_t)-1) /* ! periodic */
 					tl->initial_timeout = ret;
 				_timer_add(t, tl);
-				UNSET_RUNNING();
+				UNSET_RUNNING(w);
 			}
 #ifdef USE_SLOW_TIMER
 		} else {
@@ -894,6 +952,8 @@ inline static void timer_list_expire(ticks_t t, struct timer_head *h
 static void timer_handler(void)
 {
 	ticks_t saved_ticks;
+	ticks_t t;
+	int w;
 #ifdef USE_SLOW_TIMER
 	int run_slow_timer;
 	int i;
@@ -907,7 +967,6 @@ static void timer_handler(void)
 	*/
 	run_timer = 0; /* reset run_timer */
 	adjust_ticks();
-	LOCK_TIMER_LIST();
 	do {
 		saved_ticks = *ticks; /* protect against time running backwards */
 		if(prev_ticks >= saved_ticks) {
@@ -916,25 +975,40 @@ static void timer_handler(void)
 			prev_ticks = saved_ticks - 1;
 			break;
 		}
-		/* go through all the "missed" ticks, taking a possible overflow
-		 * into account */
-		for(prev_ticks = prev_ticks + 1; prev_ticks != saved_ticks;
-				prev_ticks++)
-			timer_run(prev_ticks);
-		timer_run(prev_ticks);		/* do it for saved_ticks too */
+		/* go through all the "missed" ticks for each wheel, taking a
+		 * possible overflow into account */
+		for(w = 0; w < TIMER_WHEELS_NO; w++) {
+			LOCK_TIMER_WHEEL(w);
+			for(t = prev_ticks + 1; t != saved_ticks; t++)
+				timer_run(&timer_lst[w], t);
+			timer_run(&timer_lst[w], saved_ticks); /* saved_ticks too */
+			UNLOCK_TIMER_WHEEL(w);
+		}
+		prev_ticks = saved_ticks;
 	} while(saved_ticks != *ticks); /* in case *ticks changed */
+	for(w = 0; w < TIMER_WHEELS_NO; w++) {
+		crt_wheel = w;
+		LOCK_TIMER_WHEEL(w);
 #ifdef USE_SLOW_TIMER
-	timer_list_expire(
-			*ticks, &timer_lst->expired, &slow_timer_lists[i], *t_idx);
+		timer_list_expire(*ticks, w, &timer_lst[w].expired,
+				SLOW_TIMER_LIST(w, i), *t_idx);
 #else
-	timer_list_expire(*ticks, &timer_lst->expired);
+		timer_list_expire(*ticks, w, &timer_lst[w].expired);
 #endif
+		UNLOCK_TIMER_WHEEL(w);
+	}
 	/* WARNING: add_timer(...,0) must go directly to expired list, since
 	 * otherwise there is a race between timer running and adding it
 	 * (it could expire it H0_ENTRIES ticks later instead of 'now')*/
 #ifdef USE_SLOW_TIMER
-	if(slow_timer_lists[i].next != (struct timer_ln *)&slow_timer_lists[i]) {
-		run_slow_timer = 1;
+	for(w = 0; w < TIMER_WHEELS_NO; w++) {
+		if(SLOW_TIMER_LIST(w, i)->next
+				!= (struct timer_ln *)SLOW_TIMER_LIST(w, i)) {
+			run_slow_timer = 1;
+			break;
+		}
+	}
+	if(run_slow_timer) {
 		if((slow_idx_t)(*t_idx - *s_idx) < (SLOW_LISTS_NO - 1U))
 			(*t_idx)++;
 		else {
@@ -943,9 +1017,6 @@ static void timer_handler(void)
 			/* trying to continue */
 		}
 	}
-#endif
-	UNLOCK_TIMER_LIST();
-#ifdef USE_SLOW_TIMER
 	/* wake up the "slow" timer */
 	if(run_slow_timer)
 		kill(slow_timer_pid, SLOW_TIMER_SIG);
@@ -1053,6 +1124,7 @@ void slow_timer_main()
 	ticks_t ret;
 	struct timer_ln *tl;
 	unsigned short i;
+	int w;
 #ifdef USE_SIGWAIT
 	int sig;
 #endif
@@ -1091,45 +1163,48 @@ void slow_timer_main()
 		LOCK_SLOW_TIMER_LIST();
 		while(*s_idx != *t_idx) {
 			i = *s_idx % SLOW_LISTS_NO;
-			while(slow_timer_lists[i].next
-					!= (struct timer_ln *)&slow_timer_lists[i]) {
-				tl = slow_timer_lists[i].next;
-				_timer_rm_list(tl);
-				tl->next = tl->prev = 0;
+			for(w = 0; w < TIMER_WHEELS_NO; w++) {
+				while(SLOW_TIMER_LIST(w, i)->next
+						!= (struct timer_ln *)SLOW_TIMER_LIST(w, i)) {
+					tl = SLOW_TIMER_LIST(w, i)->next;
+					_timer_rm_list(tl);
+					tl->next = tl->prev = 0;
 #ifdef TIMER_DEBUG
-				tl->expires_no++;
+					tl->expires_no++;
 #endif
-				SET_RUNNING_SLOW(tl);
-				UNLOCK_SLOW_TIMER_LIST();
-				if(likely(tl->f)) {
-					ret = tl->f(*ticks, tl, tl->data);
-				} else {
-					ret = 0;
+					SET_RUNNING_SLOW(tl);
+					UNLOCK_SLOW_TIMER_LIST();
+					if(likely(tl->f)) {
+						ret = tl->f(*ticks, tl, tl->data);
+					} else {
+						ret = 0;
 #ifdef TIMER_DEBUG
-					LM_WARN("null timer callback for %p (%s:%u - %s(...))\n",
-							tl, (tl->add_file) ? tl->add_file : "unknown",
-							tl->add_line,
-							(tl->add_func) ? tl->add_func : "unknown");
+						LM_WARN("null timer callback for %p (%s:%u - "
+								"%s(...))\n",
+								tl, (tl->add_file) ? tl->add_file : "unknown",
+								tl->add_line,
+								(tl->add_func) ? tl->add_func : "unknown");
 #else
-					LM_WARN("null callback function for %p\n", tl);
+						LM_WARN("null callback function for %p\n", tl);
 #endif
-				}
-				/* reset the configuration group handles */
-				cfg_reset_all();
-				if(ret == 0) {
-					/* one shot */
-					UNSET_RUNNING_SLOW();
-					LOCK_SLOW_TIMER_LIST();
-				} else {
-					/* not one shot, re-add it */
-					LOCK_TIMER_LIST(); /* add it to the "main"  list */
-					RESET_SLOW_LIST(tl);
-					if(ret != (ticks_t)-1) /* != periodic */
-						tl->initial_timeout = ret;
-					_timer_add(*ticks, tl);
-					UNLOCK_TIMER_LIST();
-					LOCK_SLOW_TIMER_LIST();
-					UNSET_RUNNING_SLOW();
+					}
+					/* reset the configuration group handles */
+					cfg_reset_all();
+					if(ret == 0) {
+						/* one shot */
+						UNSET_RUNNING_SLOW();
+						LOCK_SLOW_TIMER_LIST();
+					} else {
+						/* not one shot, re-add it to its own wheel */
+						LOCK_TIMER_WHEEL(tl->wheel);
+						RESET_SLOW_LIST(tl);
+						if(ret != (ticks_t)-1) /* != periodic */
+							tl->initial_timeout = ret;
+						_timer_add(*ticks, tl);
+						UNLOCK_TIMER_WHEEL(tl->wheel);
+						LOCK_SLOW_TIMER_LIST();
+						UNSET_RUNNING_SLOW();
+					}
 				}
 			}
 			(*s_idx)++;
@@ -87,6 +87,9 @@ typedef ticks_t(timer_handler_f)(ticks_t t, struct timer_ln *tl, void *data);
 
 /* timer flags */
 #define F_TIMER_FAST 1
+#define F_TIMER_PIN_WHEEL 2 /* keep the caller preset tl->wheel on \
+							 * timer_add instead of sharding by the  \
+							 * adding process */
 #define F_TIMER_ON_SLOW_LIST 0x100
 #define F_TIMER_ACTIVE \
 	0x200 /* timer is running or has run and expired
@@ -104,6 +107,8 @@ struct timer_ln
 	void *data;
 	timer_handler_f *f;
 	volatile unsigned int flags;
+	unsigned short wheel; /* timer wheel (shard) - set by timer_add based on
+							 * the adding process */
 #ifdef USE_SLOW_TIMER
 	volatile slow_idx_t slow_idx;
 #endif
@@ -150,6 +155,16 @@ void timer_free(struct timer_ln *t);
 #define timer_reinit(tl) (tl)->flags &= ~(F_TIMER_ON_SLOW_LIST | F_TIMER_ACTIVE)
 #endif
 
+/* pin tl to a fixed wheel (e.g. the wheel of the worker that created the
+ * owning structure) so that later re-arms from other processes do not
+ * migrate it; w is masked to the valid range by timer_add; set it after
+ * timer_init and before the first timer_add (survives timer_reinit) */
+#define timer_set_pinned_wheel(tl, w)           \
+	do {                                        \
+		(tl)->wheel = (unsigned short)(w);      \
+		(tl)->flags |= F_TIMER_PIN_WHEEL;       \
+	} while(0)
+
 #define timer_init(tl, fun, param, flgs)          \
 	do {                                          \
 		memset((tl), 0, sizeof(struct timer_ln)); \
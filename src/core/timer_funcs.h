@@ -74,6 +74,17 @@ struct timer_head
 
 /*@} */
 
+/** @brief number of timer wheels (shards), must be a power of two
+ *
+ * Timers are distributed over the wheels based on the process that adds
+ * them, each wheel having its own lock, so that heavy timer users (e.g. tm
+ * arming retransmission/fr timers for each transaction) do not all contend
+ * on a single global lock. All the wheels are still driven by the main
+ * timer process.
+ */
+#define TIMER_WHEELS_NO 4U
+#define TIMER_WHEELS_MASK (TIMER_WHEELS_NO - 1U)
+
 struct timer_lists
 {
 	struct timer_head h0[H0_ENTRIES];
@@ -82,7 +93,7 @@ struct timer_lists
 	struct timer_head expired; /* list of expired entries */
 };
 
-extern struct timer_lists *timer_lst;
+extern struct timer_lists *timer_lst; /* array of TIMER_WHEELS_NO wheels */
 
 
 #define _timer_init_list(head) clist_init((head), next, prev)
@@ -103,116 +114,68 @@ extern struct timer_lists *timer_lst;
  * from current time to the timer desired expire (should be tl->expire-*tick)
  * If you don't know delta, you probably want to call _timer_add instead.
  */
-static inline int _timer_dist_tl(struct timer_ln *tl, ticks_t delta)
+static inline int _timer_dist_tl(
+		struct timer_lists *tls, struct timer_ln *tl, ticks_t delta)
 {
 	if(delta < H0_ENTRIES) {
 		if(delta == 0) {
 			LM_WARN("0 expire timer added\n");
-			_timer_add_list(&timer_lst->expired, tl);
+			_timer_add_list(&tls->expired, tl);
 		} else {
-			_timer_add_list(&timer_lst->h0[tl->expire & H0_MASK], tl);
+			_timer_add_list(&tls->h0[tl->expire & H0_MASK], tl);
 		}
 	} else if(delta < (H0_ENTRIES * H1_ENTRIES)) {
-		_timer_add_list(
-				&timer_lst->h1[(tl->expire & H1_H0_MASK) >> H0_BITS], tl);
+		_timer_add_list(&tls->h1[(tl->expire & H1_H0_MASK) >> H0_BITS], tl);
 	} else {
-		_timer_add_list(&timer_lst->h2[tl->expire >> (H1_BITS + H0_BITS)], tl);
+		_timer_add_list(&tls->h2[tl->expire >> (H1_BITS + H0_BITS)], tl);
 	}
 	return 0;
 }
 
 
-#define _timer_mv_expire(h)                                                 \
-	do {                                                                    \
-		if((h)->next != (struct timer_ln *)(h)) {                           \
-			clist_append_sublist(                                           \
-					&timer_lst->expired, (h)->next, (h)->prev, next, prev); \
-			_timer_init_list(h);                                            \
-		}                                                                   \
+#define _timer_mv_expire(tls, h)                                         \
+	do {                                                                 \
+		if((h)->next != (struct timer_ln *)(h)) {                        \
+			clist_append_sublist(                                        \
+					&(tls)->expired, (h)->next, (h)->prev, next, prev);  \
+			_timer_init_list(h);                                         \
+		}                                                                \
 	} while(0)
 
 
-#if 1
-
-static inline void timer_redist(ticks_t t, struct timer_head *h)
+static inline void timer_redist(
+		struct timer_lists *tls, ticks_t t, struct timer_head *h)
 {
 	struct timer_ln *tl;
 	struct timer_ln *tmp;
 
 	timer_foreach_safe(tl, tmp, h)
 	{
-		_timer_dist_tl(tl, tl->expire - t);
+		_timer_dist_tl(tls, tl, tl->expire - t);
 	}
 	/* clear the current list */
 	_timer_init_list(h);
 }
 
-static inline void timer_run(ticks_t t)
+static inline void timer_run(struct timer_lists *tls, ticks_t t)
 {
 	struct timer_head *thp;
 
 	/* trust the compiler for optimizing */
 	if((t & H0_MASK) == 0) {		/*r1*/
 		if((t & H1_H0_MASK) == 0) { /*r2*/
-			timer_redist(t, &timer_lst->h2[t >> (H0_BITS + H1_BITS)]);
+			timer_redist(tls, t, &tls->h2[t >> (H0_BITS + H1_BITS)]);
 		}
 
-		timer_redist(
-				t, &timer_lst->h1[(t & H1_H0_MASK) >> H0_BITS]); /*r2 >> H0*/
+		timer_redist(tls, t,
+				&tls->h1[(t & H1_H0_MASK) >> H0_BITS]); /*r2 >> H0*/
 	}
 	/*
 	DBG("timer_run: ticks %u, expire h0[%u]\n",
 						(unsigned ) t, (unsigned)(t & H0_MASK));*/
-	thp = &timer_lst->h0[t & H0_MASK];
-	_timer_mv_expire(thp); /*r1*/
+	thp = &tls->h0[t & H0_MASK];
+	_timer_mv_expire(tls, thp); /*r1*/
 }
-#else
-
-static inline void timer_lst_mv0(ticks_t t, struct timer_head *h)
-{
-	struct timer_ln *tl;
-	struct timer_ln *tmp;
-
-	timer_foreach_safe(tl, tmp, h)
-	{
-		_timer_dist_tl(tl, &timer_lst->h0[tl->expire & H0_MASK]);
-	}
-	/* clear the current list */
-	_timer_init_list(h);
-}
-
-static inline void timer_lst_mv1(ticks_t t, struct timer_head *h)
-{
-	struct timer_ln *tl;
-	struct timer_ln *tmp;
-
-	timer_foreach_safe(tl, tmp, h)
-	{
-		if((tl->expire & H0_MASK) == 0) /* directly to h0 */
-			_timer_add_list(tl, &timer_lst->h0[tl->expire & H0_MASK]);
-		else /* to h1 */
-			_timer_add_list(
-					tl, &timer_lst->h1[(tl->expire & H1_H0_MASK) >> H0_BITS]);
-	}
-	/* clear the current list */
-	_timer_init_list(h);
-}
-
-
-/** @brief possible faster version */
-static inline void timer_run(ticks_t t)
-{
-	/* trust the compiler for optimizing */
-	if((t & H0_MASK) == 0) {	  /*r1*/
-		if((t & H1_H0_MASK) == 0) /*r2*/
-			/* just move the list "down" to hash1 */
-			timer_lst_mv1(&timer_lst->h2[t >> (H0_BITS + H1_BITS)]);
-		/* move "down" to hash0 */
-		timer_lst_mv0(&timer_lst->h1[(t & H1_H0_MASK) >> H0_BITS]);
-	}
-	_timer_mv_expire(t, &timer_lst->h0[t & H0_MASK]); /*r1*/
-}
-#endif
 
 
 #endif
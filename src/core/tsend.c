@@ -35,6 +35,12 @@
 #include <sys/socket.h>
 #include <sys/uio.h>
 
+#include "tsend.h"
+#ifdef TSEND_ZEROCOPY
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#endif
+
 #include "dprint.h"
 #include "timer.h"
 #include "timer_ticks.h"
@@ -137,6 +143,168 @@ error:
 }
 
 
+/* gather variant of tsend_stream(): sends the iovec array (e.g. produced
+ * by sip_msg_lumps_to_iovec()) without flattening it into one buffer
+ * first; on partial writes the iovec array is adjusted in place => the
+ * caller must not rely on its contents afterwards
+ * returns: -1 on error, or number of bytes written
+ */
+int tsend_stream_iov(int fd, struct iovec *v, int count, int timeout)
+{
+	int written;
+	TSEND_INIT;
+
+	written = 0;
+again:
+	n = writev(fd, v, count);
+	TSEND_ERR_CHECK("tsend_stream_iov");
+	written += n;
+	/* drop the fully written entries */
+	while(count > 0 && n >= (int)v[0].iov_len) {
+		n -= v[0].iov_len;
+		v++;
+		count--;
+	}
+	if(count > 0) {
+		/* partial write inside v[0] */
+		v[0].iov_base = (char *)v[0].iov_base + n;
+		v[0].iov_len -= n;
+	} else {
+		/* successful full write */
+		return written;
+	}
+	TSEND_POLL("tsend_stream_iov");
+error:
+	return -1;
+}
+
+
+#ifdef TSEND_ZEROCOPY
+
+/* reap nsends MSG_ZEROCOPY completion notifications from the socket
+ * error queue, waiting (up to the deadline in expire) if they did not
+ * arrive yet; the send buffer pages are shared with the kernel until
+ * the matching notification is received
+ * returns: 0 on success, -1 on error/timeout
+ */
+static int tsend_zc_reap(int fd, int nsends, ticks_t expire, int timeout)
+{
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct sock_extended_err *serr;
+	char control[64];
+	struct pollfd pf;
+	int n;
+	s_ticks_t diff;
+	int completed;
+
+	completed = 0;
+	pf.fd = fd;
+	pf.events = 0; /* error queue readiness is signaled via POLLERR */
+	while(completed < nsends) {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		n = recvmsg(fd, &msg, MSG_ERRQUEUE);
+		if(n == -1) {
+			if(errno == EINTR)
+				continue;
+			if(errno != EAGAIN && errno != EWOULDBLOCK) {
+				LM_ERR("zerocopy completion recvmsg: %s [%d]\n",
+						strerror(errno), errno);
+				return -1;
+			}
+			/* no notification queued yet => wait for it */
+			if(timeout == -1)
+				n = poll(&pf, 1, -1);
+			else {
+				diff = expire - get_ticks_raw();
+				if(diff <= 0) {
+					LM_ERR("zerocopy completion timeout (%d)\n", timeout);
+					return -1;
+				}
+				n = poll(&pf, 1, TICKS_TO_MS((ticks_t)diff));
+			}
+			if(n == -1 && errno != EINTR) {
+				LM_ERR("zerocopy completion poll: %s [%d]\n", strerror(errno),
+						errno);
+				return -1;
+			}
+			if(n == 0) {
+				LM_ERR("zerocopy completion timeout (p %d)\n", timeout);
+				return -1;
+			}
+			continue;
+		}
+		for(cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if(!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+					   || (cmsg->cmsg_level == SOL_IPV6
+							   && cmsg->cmsg_type == IPV6_RECVERR)))
+				continue;
+			serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+			if(serr->ee_errno != 0
+					|| serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+			/* one notification can cover a range of send calls */
+			completed += serr->ee_data - serr->ee_info + 1;
+			if(unlikely(serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED))
+				LM_DBG("zerocopy send on fd %d was copied by the kernel\n",
+						fd);
+		}
+	}
+	return 0;
+}
+
+
+/* zero-copy variant of tsend_stream(): hands the buffer pages to the
+ * kernel with MSG_ZEROCOPY (the socket must have SO_ZEROCOPY set) and
+ * waits for the completion notifications before returning, so the
+ * caller remains free to reuse/release the buffer; worth it only for
+ * large messages - the caller is expected to apply a minimum length
+ * threshold (see the tcp zerocopy_min config option)
+ * returns: -1 on error, or number of bytes written
+ */
+int tsend_stream_zc(int fd, const char *buf, unsigned int len, int timeout)
+{
+	int written;
+	int nsends;
+	TSEND_INIT;
+
+	written = 0;
+	nsends = 0;
+again:
+	n = send(fd, buf, len, MSG_NOSIGNAL | MSG_ZEROCOPY);
+	if(unlikely(n == -1 && errno == ENOBUFS)) {
+		/* socket optmem limit hit - finish with a copying send */
+		if(nsends != 0 && tsend_zc_reap(fd, nsends, expire, timeout) < 0)
+			goto error;
+		n = tsend_stream(fd, buf, len, timeout);
+		if(unlikely(n < 0))
+			goto error;
+		return written + n;
+	}
+	TSEND_ERR_CHECK("tsend_stream_zc");
+	nsends++;
+	written += n;
+	if(n < (int)len) {
+		/* partial write */
+		buf += n;
+		len -= n;
+	} else {
+		/* all the bytes were handed over to the kernel - wait for the
+		 * zerocopy completions before the buffer can be reused */
+		if(unlikely(tsend_zc_reap(fd, nsends, expire, timeout) < 0))
+			goto error;
+		return written;
+	}
+	TSEND_POLL("tsend_stream_zc");
+error:
+	return -1;
+}
+
+#endif /* TSEND_ZEROCOPY */
+
+
 /* sends on dgram fd (which must be O_NONBLOCK); if it cannot send any data
  * in timeout milliseconds it will return ERROR
  * returns: -1 on error, or number of bytes written
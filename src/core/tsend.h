@@ -23,8 +23,18 @@
 #ifndef __tsend_h
 #define __tsend_h
 
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#if defined(__OS_linux) && defined(MSG_ZEROCOPY)
+#define TSEND_ZEROCOPY
+#endif
 
 int tsend_stream(int fd, const char *buf, unsigned int len, int timeout);
+int tsend_stream_iov(int fd, struct iovec *v, int count, int timeout);
+#ifdef TSEND_ZEROCOPY
+int tsend_stream_zc(int fd, const char *buf, unsigned int len, int timeout);
+#endif
 int tsend_dgram(int fd, const char *buf, unsigned int len,
 		const struct sockaddr *to, socklen_t tolen, int timeout);
 int tsend_dgram_ev(int fd, const struct iovec *v, int count, int timeout);
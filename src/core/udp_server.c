@@ -28,6 +28,10 @@
  * Module: @ref core
  */
 
+#if defined(__OS_linux) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* for recvmmsg() / sendmmsg() */
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -35,6 +39,7 @@
 #include <netinet/in.h>
 #include <netinet/in_systm.h>
 #include <netinet/ip.h>
+#include <netinet/udp.h>
 #include <errno.h>
 #include <arpa/inet.h>
 #ifdef __linux__
@@ -59,6 +64,7 @@
 #include "events.h"
 #include "async_task.h"
 #include "stun.h"
+#include "parser/parse_fline.h"
 #ifdef USE_RAW_SOCKS
 #include "raw_sock.h"
 #endif /* USE_RAW_SOCKS */
@@ -451,6 +457,43 @@ int udp_init(struct socket_info *sock_info)
 		LM_ERR("setsockopt: %s\n", strerror(errno));
 		goto error;
 	}
+#ifdef SO_REUSEPORT
+	if(ksr_udp_reuseport) {
+		/* worker socket sharding - the kernel hashes the flows over all
+		 * the sockets bound with SO_REUSEPORT on the same address, so
+		 * retransmissions of a request stay on the same worker */
+		optval = 1;
+		if(setsockopt(sock_info->socket, SOL_SOCKET, SO_REUSEPORT,
+				   (void *)&optval, sizeof(optval))
+				== -1) {
+			LM_ERR("setsockopt SO_REUSEPORT: %s\n", strerror(errno));
+			goto error;
+		}
+	}
+#endif
+#ifdef SO_BUSY_POLL
+	if(ksr_udp_busy_poll > 0) {
+		/* let the kernel busy poll the device queue for this long (in
+		 * microseconds) before sleeping in blocking receives - cuts the
+		 * wakeup latency and the softirq overhead on high-rate sockets */
+		optval = ksr_udp_busy_poll;
+		if(setsockopt(sock_info->socket, SOL_SOCKET, SO_BUSY_POLL,
+				   (void *)&optval, sizeof(optval))
+				== -1) {
+			LM_WARN("setsockopt SO_BUSY_POLL: %s\n", strerror(errno));
+			/* continue since this is not critical */
+		}
+#ifdef SO_PREFER_BUSY_POLL
+		optval = 1;
+		if(setsockopt(sock_info->socket, SOL_SOCKET, SO_PREFER_BUSY_POLL,
+				   (void *)&optval, sizeof(optval))
+				== -1) {
+			LM_WARN("setsockopt SO_PREFER_BUSY_POLL: %s\n", strerror(errno));
+			/* continue since this is not critical */
+		}
+#endif /* SO_PREFER_BUSY_POLL */
+	}
+#endif /* SO_BUSY_POLL */
 	/* tos */
 	optval = tos;
 	if(addr->s.sa_family == AF_INET) {
@@ -632,6 +675,324 @@ error:
 #define UDP_RCV_PRINTBUF_SIZE 512
 #define UDP_RCV_PRINT_LEN 100
 
+#ifdef __OS_linux
+
+#define UDP_MMSG_BATCH_MAX 64
+#define UDP_MMSG_SEND_BUF 3072
+
+#ifdef UDP_SEGMENT
+/* generic segmentation offload is usable for the send queue */
+#define UDP_MMSG_GSO
+/* kernel side limit (UDP_MAX_SEGMENTS) */
+#define UDP_GSO_MAX_SEGS 64
+#endif /* UDP_SEGMENT */
+
+typedef struct udp_mmsg_sendq
+{
+	struct mmsghdr hdrs[UDP_MMSG_BATCH_MAX];
+	struct iovec iov[UDP_MMSG_BATCH_MAX];
+	union sockaddr_union to[UDP_MMSG_BATCH_MAX];
+	char bufs[UDP_MMSG_BATCH_MAX][UDP_MMSG_SEND_BUF];
+#ifdef UDP_MMSG_GSO
+	unsigned short seglen[UDP_MMSG_BATCH_MAX]; /* gso segment size */
+	unsigned short nsegs[UDP_MMSG_BATCH_MAX];  /* datagrams in the entry */
+	char cbufs[UDP_MMSG_BATCH_MAX][CMSG_SPACE(sizeof(unsigned short))];
+#endif /* UDP_MMSG_GSO */
+	int socket; /* all queued replies go out over this socket */
+	int count;
+	int active;
+} udp_mmsg_sendq_t;
+
+static udp_mmsg_sendq_t *udp_mmsg_sq = NULL;
+
+/**
+ * flush the replies queued while processing the current receive batch
+ * with one sendmmsg() call
+ */
+static void udp_mmsg_sendq_flush(void)
+{
+	int n;
+	int sent;
+#ifdef UDP_MMSG_GSO
+	struct msghdr *mh;
+	struct cmsghdr *cm;
+	int i;
+
+	/* entries holding several equal sized datagrams for the same
+	 * destination are sent as one gso train, segmented by the kernel */
+	for(i = 0; i < udp_mmsg_sq->count; i++) {
+		if(udp_mmsg_sq->nsegs[i] <= 1)
+			continue;
+		mh = &udp_mmsg_sq->hdrs[i].msg_hdr;
+		mh->msg_control = udp_mmsg_sq->cbufs[i];
+		mh->msg_controllen = CMSG_SPACE(sizeof(unsigned short));
+		cm = CMSG_FIRSTHDR(mh);
+		cm->cmsg_level = SOL_UDP;
+		cm->cmsg_type = UDP_SEGMENT;
+		cm->cmsg_len = CMSG_LEN(sizeof(unsigned short));
+		*(unsigned short *)CMSG_DATA(cm) = udp_mmsg_sq->seglen[i];
+	}
+#endif /* UDP_MMSG_GSO */
+
+	sent = 0;
+	while(sent < udp_mmsg_sq->count) {
+		n = sendmmsg(udp_mmsg_sq->socket, &udp_mmsg_sq->hdrs[sent],
+				udp_mmsg_sq->count - sent, 0);
+		if(n == -1) {
+			if(errno == EINTR)
+				continue;
+			LM_ERR("sendmmsg on %d (%d/%d queued): %s (%d)\n",
+					udp_mmsg_sq->socket, sent, udp_mmsg_sq->count,
+					strerror(errno), errno);
+			/* only the first message of the remaining set failed (e.g. an
+			 * unreachable destination) - skip it and keep flushing, as the
+			 * other queued messages were already reported as sent */
+			sent++;
+			continue;
+		}
+		sent += n;
+	}
+	udp_mmsg_sq->count = 0;
+	udp_mmsg_sq->socket = -1;
+}
+
+/**
+ * queue one reply for the batched sendmmsg() flush - returns len when the
+ * message was queued or -2 if it cannot be queued (caller sends directly)
+ */
+static int udp_mmsg_sendq_add(struct dest_info *dst, char *buf, unsigned len)
+{
+	struct mmsghdr *hdr;
+	int idx;
+
+#ifdef USE_RAW_SOCKS
+	/* raw socket sends keep their own path */
+	if(unlikely(raw_udp4_send_sock >= 0 && cfg_get(core, core_cfg, udp4_raw)
+				&& dst->send_sock->address.af == AF_INET))
+		return -2;
+#endif /* USE_RAW_SOCKS */
+	if(len >= UDP_MMSG_SEND_BUF)
+		return -2;
+	/* queue only sip replies - forwarded requests and other messages
+	 * generated while the batch is processed must not be delayed until
+	 * the end of the batch */
+	if(len <= SIP_VERSION_LEN || memcmp(buf, SIP_VERSION, SIP_VERSION_LEN) != 0
+			|| buf[SIP_VERSION_LEN] != ' ')
+		return -2;
+#ifdef UDP_MMSG_GSO
+	if(ksr_udp_gso && udp_mmsg_sq->count > 0
+			&& udp_mmsg_sq->socket == dst->send_sock->socket) {
+		idx = udp_mmsg_sq->count - 1;
+		if(udp_mmsg_sq->seglen[idx] == len
+				&& udp_mmsg_sq->nsegs[idx] < UDP_GSO_MAX_SEGS
+				&& udp_mmsg_sq->iov[idx].iov_len + len <= UDP_MMSG_SEND_BUF
+				&& su_cmp(&dst->to, &udp_mmsg_sq->to[idx])) {
+			/* same size and destination as the last queued datagram =>
+			 * append it as one more gso segment (typical for
+			 * retransmission or keepalive bursts) */
+			memcpy(udp_mmsg_sq->bufs[idx] + udp_mmsg_sq->iov[idx].iov_len,
+					buf, len);
+			udp_mmsg_sq->iov[idx].iov_len += len;
+			udp_mmsg_sq->nsegs[idx]++;
+			return (int)len;
+		}
+	}
+#endif /* UDP_MMSG_GSO */
+	if(udp_mmsg_sq->count > 0
+			&& udp_mmsg_sq->socket != dst->send_sock->socket) {
+		/* different outgoing socket - push out what is queued so far */
+		udp_mmsg_sendq_flush();
+	}
+	if(udp_mmsg_sq->count >= UDP_MMSG_BATCH_MAX)
+		udp_mmsg_sendq_flush();
+
+	idx = udp_mmsg_sq->count;
+	udp_mmsg_sq->socket = dst->send_sock->socket;
+	memcpy(udp_mmsg_sq->bufs[idx], buf, len);
+	udp_mmsg_sq->to[idx] = dst->to;
+	udp_mmsg_sq->iov[idx].iov_base = udp_mmsg_sq->bufs[idx];
+	udp_mmsg_sq->iov[idx].iov_len = len;
+	hdr = &udp_mmsg_sq->hdrs[idx];
+	memset(&hdr->msg_hdr, 0, sizeof(struct msghdr));
+	hdr->msg_hdr.msg_iov = &udp_mmsg_sq->iov[idx];
+	hdr->msg_hdr.msg_iovlen = 1;
+	hdr->msg_hdr.msg_name = &udp_mmsg_sq->to[idx].s;
+	hdr->msg_hdr.msg_namelen = sockaddru_len(udp_mmsg_sq->to[idx]);
+#ifdef UDP_MMSG_GSO
+	udp_mmsg_sq->seglen[idx] = (unsigned short)len;
+	udp_mmsg_sq->nsegs[idx] = 1;
+#endif /* UDP_MMSG_GSO */
+	udp_mmsg_sq->count++;
+	return (int)len;
+}
+
+/**
+ * receive loop pulling up to udp_mmsg_batch datagrams per recvmmsg() call
+ * into a preallocated buffer ring, processing them in a tight loop and
+ * flushing replies generated within the batch with sendmmsg()
+ */
+static int udp_rcv_loop_mmsg(void)
+{
+	struct mmsghdr hdrs[UDP_MMSG_BATCH_MAX];
+	struct iovec iov[UDP_MMSG_BATCH_MAX];
+	union sockaddr_union fromaddr[UDP_MMSG_BATCH_MAX];
+	char *bufs;
+	char *buf;
+	char *tmp;
+	receive_info_t rcvi;
+	sr_event_param_t evp = {0};
+	int nbatch;
+	int nrecv;
+	int len;
+	int i;
+
+	nbatch = ksr_udp_mmsg_batch;
+	if(nbatch > UDP_MMSG_BATCH_MAX)
+		nbatch = UDP_MMSG_BATCH_MAX;
+
+	/* buffer ring - one full-size message buffer per batch slot */
+	bufs = (char *)pkg_malloc((size_t)nbatch * (BUF_SIZE + 1));
+	if(bufs == NULL) {
+		PKG_MEM_ERROR;
+		goto error;
+	}
+	udp_mmsg_sq = (udp_mmsg_sendq_t *)pkg_malloc(sizeof(udp_mmsg_sendq_t));
+	if(udp_mmsg_sq == NULL) {
+		PKG_MEM_ERROR;
+		goto error;
+	}
+	memset(udp_mmsg_sq, 0, sizeof(udp_mmsg_sendq_t));
+	udp_mmsg_sq->socket = -1;
+
+	memset(&rcvi, 0, sizeof(receive_info_t));
+	/* these do not change, set only once*/
+	rcvi.bind_address = bind_address;
+	rcvi.dst_port = bind_address->port_no;
+	rcvi.dst_ip = bind_address->address;
+	rcvi.proto = PROTO_UDP;
+
+	/* initialize the config framework */
+	if(cfg_child_init())
+		goto error;
+
+	LM_DBG("batched udp receive on socket %d - %d messages per syscall\n",
+			bind_address->socket, nbatch);
+
+	for(;;) {
+		for(i = 0; i < nbatch; i++) {
+			iov[i].iov_base = bufs + (size_t)i * (BUF_SIZE + 1);
+			iov[i].iov_len = BUF_SIZE;
+			memset(&hdrs[i].msg_hdr, 0, sizeof(struct msghdr));
+			hdrs[i].msg_hdr.msg_iov = &iov[i];
+			hdrs[i].msg_hdr.msg_iovlen = 1;
+			hdrs[i].msg_hdr.msg_name = &fromaddr[i];
+			hdrs[i].msg_hdr.msg_namelen = sizeof(union sockaddr_union);
+		}
+		nrecv = recvmmsg(
+				bind_address->socket, hdrs, nbatch, MSG_WAITFORONE, NULL);
+		if(nrecv == -1) {
+			if(errno == EAGAIN) {
+				LM_DBG("packet with bad checksum received\n");
+				continue;
+			}
+			LM_ERR("recvmmsg:[%d] %s\n", errno, strerror(errno));
+			if((errno == EINTR) || (errno == EWOULDBLOCK)
+					|| (errno == ECONNREFUSED))
+				continue;
+			else
+				goto error;
+		}
+
+		/* update the local config once per batch */
+		cfg_update();
+		udp_mmsg_sq->active = 1;
+
+		for(i = 0; i < nrecv; i++) {
+			len = hdrs[i].msg_len;
+			buf = bufs + (size_t)i * (BUF_SIZE + 1);
+			if(ksr_msg_recv_max_size <= len) {
+				LOG(cfg_get(core, core_cfg, corelog),
+						"read message too large: %d\n", len);
+				continue;
+			}
+			if(hdrs[i].msg_hdr.msg_namelen
+					!= (unsigned int)sockaddru_len(bind_address->su)) {
+				LM_ERR("ignoring data - unexpected from addr len: %u != %u\n",
+						hdrs[i].msg_hdr.msg_namelen,
+						(unsigned int)sockaddru_len(bind_address->su));
+				continue;
+			}
+			/* we must 0-term the messages, receive_msg expects it */
+			buf[len] = 0; /* no need to save the previous char */
+
+			rcvi.src_su = fromaddr[i];
+			su2ip_addr(&rcvi.src_ip, &fromaddr[i]);
+			rcvi.src_port = su_getport(&fromaddr[i]);
+
+			if(unlikely(sr_event_enabled(SREV_NET_DGRAM_IN))) {
+				void *sredp[3];
+				sredp[0] = (void *)buf;
+				sredp[1] = (void *)(&len);
+				sredp[2] = (void *)(&rcvi);
+				evp.data = (void *)sredp;
+				if(sr_event_exec(SREV_NET_DGRAM_IN, &evp) < 0) {
+					/* data handled by callback - continue to next packet */
+					continue;
+				}
+			}
+#ifndef NO_ZERO_CHECKS
+			if(!unlikely(sr_event_enabled(SREV_STUN_IN))
+					|| (unsigned char)*buf != 0x00) {
+				if(len < MIN_UDP_PACKET) {
+					tmp = ip_addr2a(&rcvi.src_ip);
+					LM_DBG("probing packet received from %s %d\n", tmp,
+							htons(rcvi.src_port));
+					continue;
+				}
+			}
+#endif
+#ifdef DBG_MSG_QA
+			if(!dbg_msg_qa(buf, len)) {
+				LM_WARN("an incoming message didn't pass test,"
+						"  drop it: %.*s\n",
+						len, buf);
+				continue;
+			}
+#endif
+			if(rcvi.src_port == 0) {
+				tmp = ip_addr2a(&rcvi.src_ip);
+				LM_INFO("dropping 0 port packet from %s\n", tmp);
+				continue;
+			}
+
+			if(unlikely(sr_event_enabled(SREV_STUN_IN))
+					&& (unsigned char)*buf == 0x00) {
+				/* stun_process_msg releases buf memory if necessary */
+				if((stun_process_msg(buf, len, &rcvi)) != 0) {
+					continue; /* some error occurred */
+				}
+			} else {
+				receive_msg(buf, len, &rcvi);
+			}
+		}
+
+		udp_mmsg_sq->active = 0;
+		if(udp_mmsg_sq->count > 0)
+			udp_mmsg_sendq_flush();
+	}
+
+error:
+	if(bufs)
+		pkg_free(bufs);
+	if(udp_mmsg_sq) {
+		pkg_free(udp_mmsg_sq);
+		udp_mmsg_sq = NULL;
+	}
+	return -1;
+}
+
+#endif /* __OS_linux */
+
 /**
  *
  */
@@ -649,6 +1010,10 @@ int udp_rcv_loop()
 	int j;
 	int l;
 
+#ifdef __OS_linux
+	if(ksr_udp_mmsg_batch > 0)
+		return udp_rcv_loop_mmsg();
+#endif
 
 	fromaddr = (union sockaddr_union *)pkg_malloc(sizeof(union sockaddr_union));
 	if(fromaddr == 0) {
@@ -804,6 +1169,14 @@ int udp_send(struct dest_info *dst, char *buf, unsigned len)
 		abort();
 	}
 #endif
+#ifdef __OS_linux
+	if(unlikely(udp_mmsg_sq != NULL && udp_mmsg_sq->active)) {
+		n = udp_mmsg_sendq_add(dst, buf, len);
+		if(n != -2)
+			return n;
+		/* not queueable - send it directly */
+	}
+#endif
 #ifdef USE_RAW_SOCKS
 	if(likely(!(raw_udp4_send_sock >= 0 && cfg_get(core, core_cfg, udp4_raw)
 				&& dst->send_sock->address.af == AF_INET))) {
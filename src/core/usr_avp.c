@@ -41,9 +41,14 @@
 #include "str.h"
 #include "ut.h"
 #include "mem/shm_mem.h"
+#include "mem/shm_slab.h"
 #include "mem/mem.h"
 #include "usr_avp.h"
 
+/*! slab pages the avp nodes are carved from - the avps of one call share
+ * pages, each page is released with a single shm operation */
+static ksr_shm_slab_t _avp_slab = {NULL};
+
 enum idx
 {
 	IDX_FROM_URI = 0,
@@ -147,6 +152,7 @@ inline static avp_id_t compute_ID(str *name)
 avp_t *create_avp(avp_flags_t flags, avp_name_t name, avp_value_t val)
 {
 	avp_t *avp;
+	ksr_shm_slab_page_t *pg;
 	str *s;
 	struct str_num_data *sid;
 	struct str_str_data *ssd;
@@ -177,12 +183,13 @@ avp_t *create_avp(avp_flags_t flags, avp_name_t name, avp_value_t val)
 		}
 	}
 
-	avp = (struct usr_avp *)shm_malloc(len);
+	avp = (struct usr_avp *)ksr_shm_slab_alloc(&_avp_slab, len, &pg);
 	if(avp == 0) {
 		SHM_MEM_ERROR;
 		return 0;
 	}
 
+	avp->ppage = pg;
 	avp->flags = flags;
 	avp->id = (flags & AVP_NAME_STR) ? compute_ID(&name.s) : name.n;
 	avp->next = NULL;
@@ -615,7 +622,11 @@ void destroy_avp(avp_t *avp_del)
 				} else {
 					*crt_list[i] = avp->next;
 				}
-				shm_free(avp);
+				if(avp->ppage) {
+					ksr_shm_slab_page_unref(avp->ppage);
+				} else {
+					shm_free(avp);
+				}
 				return;
 			}
 		}
@@ -628,7 +639,11 @@ void destroy_avp(avp_t *avp_del)
 			} else {
 				**crt_glist = avp->next;
 			}
-			shm_free(avp);
+			if(avp->ppage) {
+				ksr_shm_slab_page_unref(avp->ppage);
+			} else {
+				shm_free(avp);
+			}
 			return;
 		}
 	}
@@ -643,7 +658,11 @@ void destroy_avp_list_unsafe(avp_list_t *list)
 	while(avp) {
 		foo = avp;
 		avp = avp->next;
-		shm_free_unsafe(foo);
+		if(foo->ppage) {
+			ksr_shm_slab_page_unref_unsafe(foo->ppage);
+		} else {
+			shm_free_unsafe(foo);
+		}
 	}
 	*list = 0;
 }
@@ -658,7 +677,11 @@ inline void destroy_avp_list(avp_list_t *list)
 	while(avp) {
 		foo = avp;
 		avp = avp->next;
-		shm_free(foo);
+		if(foo->ppage) {
+			ksr_shm_slab_page_unref(foo->ppage);
+		} else {
+			shm_free(foo);
+		}
 	}
 	*list = 0;
 }
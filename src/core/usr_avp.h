@@ -97,13 +97,17 @@ union usr_avp_data
 	char data[sizeof(void *)]; /* used to access other types, var length */
 };
 
+struct ksr_shm_slab_page;
+
 typedef struct usr_avp
 {
 	avp_id_t id;
 	/* Flags that are kept for the AVP lifetime */
 	avp_flags_t flags;
 	struct usr_avp *next;
-	union usr_avp_data d; /* var length */
+	struct ksr_shm_slab_page *ppage; /* slab page owning the node - NULL
+									  * when it is a plain shm chunk */
+	union usr_avp_data d;			 /* var length */
 } avp_t;
 
 typedef avp_t *avp_list_t;
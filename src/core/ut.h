@@ -41,6 +41,7 @@
 #include "compiler_opt.h"
 #include "config.h"
 #include "dprint.h"
+#include "endianness.h"
 #include "str.h"
 #include "mem/mem.h"
 #include "mem/shm_mem.h"
@@ -173,6 +174,42 @@ struct msgid_var
 static char fourbits2char[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8',
 		'9', 'a', 'b', 'c', 'd', 'e', 'f'};
 
+/* 2 digits at a time conversion table ("00", "01", ... "99") */
+static const char ksr_digits100[200] =
+		"0001020304050607080910111213141516171819"
+		"2021222324252627282930313233343536373839"
+		"4041424344454647484950515253545556575859"
+		"6061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+
+/* hex digit values, 0xff for non-hex chars (branchless validation: or-ing
+ * the looked up values stays <= 0xf iff all the chars were hex digits) */
+static const unsigned char ksr_hexval[256] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+		0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0a,
+		0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0a, 0x0b,
+		0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff};
+
 
 /* converts a str to an u. short, returns the u. short and sets *err on
  * error and if err!=null
@@ -301,6 +338,12 @@ static inline char *int2strbuf(unsigned long l, char *r, int r_size, int *len)
 	}
 	i = INT2STR_MAX_LEN - 2;
 	r[INT2STR_MAX_LEN - 1] = 0; /* null terminate */
+	/* 2 digits at a time: half the divisions and no per digit branches */
+	while(l >= 100 && i >= 2) {
+		memcpy(&r[i - 1], &ksr_digits100[(l % 100) * 2], 2);
+		i -= 2;
+		l /= 100;
+	}
 	do {
 		r[i] = l % 10 + '0';
 		i--;
@@ -429,12 +472,46 @@ static inline char *ushort2str(unsigned short u)
 }
 
 
-/* fast memchr version */
+/* SWAR (word-at-a-time) byte search helpers - the expressions evaluate to
+ * non-zero if any byte of the word is zero, respectively equal to b */
+#define KSR_SWAR_ONES 0x0101010101010101ULL
+#define KSR_SWAR_MSBS 0x8080808080808080ULL
+#define KSR_SWAR_HASZERO(x) (((x)-KSR_SWAR_ONES) & ~(x) & KSR_SWAR_MSBS)
+#define KSR_SWAR_HASBYTE(x, b) \
+	KSR_SWAR_HASZERO(          \
+			(x) ^ (KSR_SWAR_ONES * (unsigned long long)(unsigned char)(b)))
+
+/* evaluates to non-zero if any byte of the word is outside '0'..'9' */
+#define KSR_SWAR_HASNONDIGIT(x)                                     \
+	((((x)&0xf0f0f0f0f0f0f0f0ULL)                                   \
+			 | ((((x) + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) \
+					 >> 4))                                         \
+			!= 0x3333333333333333ULL)
+
+/* converts 8 ascii digits packed in a little endian word (first/most
+ * significant digit in the lowest byte) to their numeric value;
+ * no validation (see KSR_SWAR_HASNONDIGIT()) */
+static inline unsigned int ksr_swar_parse8(unsigned long long w)
+{
+	w = ((w & 0x0f0f0f0f0f0f0f0fULL) * 2561) >> 8;
+	w = ((w & 0x00ff00ff00ff00ffULL) * 6553601) >> 16;
+	return (unsigned int)(((w & 0x0000ffff0000ffffULL) * 42949672960001ULL)
+						  >> 32);
+}
+
+/* fast memchr version - skips word-at-a-time over runs without c */
 static inline char *q_memchr(char *p, int c, unsigned int size)
 {
 	char *end;
+	unsigned long long w;
 
 	end = p + size;
+	while(p + sizeof(w) <= end) {
+		memcpy(&w, p, sizeof(w));
+		if(KSR_SWAR_HASBYTE(w, c))
+			break;
+		p += sizeof(w);
+	}
 	for(; p < end; p++) {
 		if(*p == (unsigned char)c)
 			return p;
@@ -443,6 +520,29 @@ static inline char *q_memchr(char *p, int c, unsigned int size)
 }
 
 
+/* ASCII case-insensitive equality test for two buffers of the same length
+ * - returns 0 if equal, non-zero otherwise (no ordering)
+ * - compares word-at-a-time and only falls back to strncasecmp() for the
+ *   words that differ as raw bytes, so identical-case matches (the common
+ *   case for header names, tokens, call-ids, ...) cost one compare per
+ *   8 bytes */
+static inline int ksr_strncaseeq(const char *a, const char *b, int len)
+{
+	unsigned long long w1, w2;
+
+	while(len >= (int)sizeof(w1)) {
+		memcpy(&w1, a, sizeof(w1));
+		memcpy(&w2, b, sizeof(w2));
+		if(w1 != w2 && strncasecmp(a, b, sizeof(w1)) != 0)
+			return 1;
+		a += sizeof(w1);
+		b += sizeof(w1);
+		len -= sizeof(w1);
+	}
+	return (len > 0) ? (strncasecmp(a, b, len) != 0) : 0;
+}
+
+
 /* fast reverse char search */
 
 static inline char *q_memrchr(char *p, int c, unsigned int size)
@@ -457,26 +557,23 @@ static inline char *q_memrchr(char *p, int c, unsigned int size)
 	return 0;
 }
 
-/* returns -1 on error, 1! on success (consistent with int2reverse_hex) */
+/* returns -1 on error, 1! on success (consistent with int2reverse_hex)
+ * note: on error *res is undefined */
 inline static int reverse_hex2int(char *c, int len, unsigned int *res)
 {
 	char *pc;
-	char mychar;
+	unsigned int v, bad;
 
 	*res = 0;
+	bad = 0;
 	for(pc = c + len - 1; len > 0; pc--, len--) {
-		*res <<= 4;
-		mychar = *pc;
-		if(mychar >= '0' && mychar <= '9')
-			*res += mychar - '0';
-		else if(mychar >= 'a' && mychar <= 'f')
-			*res += mychar - 'a' + 10;
-		else if(mychar >= 'A' && mychar <= 'F')
-			*res += mychar - 'A' + 10;
-		else
-			return -1;
+		/* branchless: accumulate the 0xff the table yields for non-hex
+		 * chars and check only once at the end */
+		v = ksr_hexval[(unsigned char)*pc];
+		bad |= v;
+		*res = (*res << 4) | (v & 0xf);
 	}
-	return 1;
+	return unlikely(bad > 0xf) ? -1 : 1;
 }
 
 inline static int int2reverse_hex(char **c, int *size, unsigned int nr)
@@ -698,6 +795,24 @@ static inline int str2ulong(str *_s, unsigned long *_r)
  */
 static inline int str2int(str *_s, unsigned int *_r)
 {
+#ifdef __IS_LITTLE_ENDIAN
+	unsigned long long w;
+
+	/* fast path for the common case (cseq numbers, ports, expires,
+	 * content-length: up to 8 digits, no sign): pad virtually with
+	 * leading '0's, validate and convert the whole number with a few
+	 * SWAR ops instead of a checked loop over the digits; everything
+	 * else ('+' prefix, 9+ digits, errors) takes the generic path */
+	if(likely(_s != NULL && _r != NULL && _s->s != NULL
+			   && ((unsigned int)_s->len - 1) < 8)) {
+		w = 0x3030303030303030ULL;
+		memcpy((unsigned char *)&w + (8 - _s->len), _s->s, _s->len);
+		if(likely(!KSR_SWAR_HASNONDIGIT(w))) {
+			*_r = ksr_swar_parse8(w);
+			return 0;
+		}
+	}
+#endif /* __IS_LITTLE_ENDIAN */
 	str2unval(_s, _r, int, UINT_MAX);
 }
 
@@ -25,10 +25,15 @@
 
 #include "mem/mem.h"
 #include "mem/shm_mem.h"
+#include "mem/shm_slab.h"
 #include "dprint.h"
 #include "hashes.h"
 #include "xavp.h"
 
+/*! slab pages the xavp/xavu/xavi nodes are carved from - the nodes of one
+ * call share pages, each page is released with a single shm operation */
+static ksr_shm_slab_t _xavp_slab = {NULL};
+
 /*! XAVP list head */
 static sr_xavp_t *_xavp_list_head = 0;
 /*! Pointer to XAVP current list */
@@ -78,7 +83,11 @@ void xavp_free(sr_xavp_t *xa)
 	} else if(xa->val.type == SR_XTYPE_XAVP) {
 		xavp_destroy_list(&xa->val.v.xavp);
 	}
-	shm_free(xa);
+	if(xa->ppage) {
+		ksr_shm_slab_page_unref(xa->ppage);
+	} else {
+		shm_free(xa);
+	}
 }
 
 void xavp_free_unsafe(sr_xavp_t *xa)
@@ -98,12 +107,17 @@ void xavp_free_unsafe(sr_xavp_t *xa)
 	} else if(xa->val.type == SR_XTYPE_XAVP) {
 		xavp_destroy_list_unsafe(&xa->val.v.xavp);
 	}
-	shm_free_unsafe(xa);
+	if(xa->ppage) {
+		ksr_shm_slab_page_unref_unsafe(xa->ppage);
+	} else {
+		shm_free_unsafe(xa);
+	}
 }
 
 static sr_xavp_t *xavp_new_value(str *name, sr_xval_t *val)
 {
 	sr_xavp_t *avp;
+	ksr_shm_slab_page_t *pg;
 	int size;
 	unsigned int id;
 
@@ -114,12 +128,13 @@ static sr_xavp_t *xavp_new_value(str *name, sr_xval_t *val)
 	size = sizeof(sr_xavp_t) + name->len + 1;
 	if(val->type == SR_XTYPE_STR)
 		size += val->v.s.len + 1;
-	avp = (sr_xavp_t *)shm_malloc(size);
+	avp = (sr_xavp_t *)ksr_shm_slab_alloc(&_xavp_slab, size, &pg);
 	if(avp == NULL) {
 		SHM_MEM_ERROR;
 		return NULL;
 	}
 	memset(avp, 0, size);
+	avp->ppage = pg;
 	avp->id = id;
 	avp->name.s = (char *)avp + sizeof(sr_xavp_t);
 	memcpy(avp->name.s, name->s, name->len);
@@ -1707,6 +1722,7 @@ static int xavi_rm_internal(str *name, sr_xavp_t **head, int idx);
 static sr_xavp_t *xavi_new_value(str *name, sr_xval_t *val)
 {
 	sr_xavp_t *avi;
+	ksr_shm_slab_page_t *pg;
 	int size;
 	unsigned int id;
 
@@ -1717,12 +1733,13 @@ static sr_xavp_t *xavi_new_value(str *name, sr_xval_t *val)
 	size = sizeof(sr_xavp_t) + name->len + 1;
 	if(val->type == SR_XTYPE_STR)
 		size += val->v.s.len + 1;
-	avi = (sr_xavp_t *)shm_malloc(size);
+	avi = (sr_xavp_t *)ksr_shm_slab_alloc(&_xavp_slab, size, &pg);
 	if(avi == NULL) {
 		SHM_MEM_ERROR;
 		return NULL;
 	}
 	memset(avi, 0, size);
+	avi->ppage = pg;
 	avi->id = id;
 	avi->name.s = (char *)avi + sizeof(sr_xavp_t);
 	memcpy(avi->name.s, name->s, name->len);
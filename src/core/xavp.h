@@ -64,6 +64,8 @@ typedef struct _sr_xval
 	} v;
 } sr_xval_t;
 
+struct ksr_shm_slab_page;
+
 /* structure for extended avp */
 typedef struct _sr_xavp
 {
@@ -71,6 +73,8 @@ typedef struct _sr_xavp
 	str name;			   /* name of the xavp */
 	sr_xval_t val;		   /* value of the xavp */
 	struct _sr_xavp *next; /* pointer to next xavp in list */
+	struct ksr_shm_slab_page *ppage; /* slab page owning the node - NULL
+									  * when it is a plain shm chunk */
 } sr_xavp_t;
 
 int xavp_init_head(void);
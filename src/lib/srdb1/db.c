@@ -147,6 +147,14 @@ int db_check_api(db_func_t *dbf, char *mname)
 		dbf->cap |= DB_CAP_AFFECTED_ROWS;
 	}
 
+	if(dbf->batch_start && dbf->batch_end) {
+		dbf->cap |= DB_CAP_BATCH;
+	}
+
+	if(dbf->async_query) {
+		dbf->cap |= DB_CAP_ASYNC_QUERY;
+	}
+
 	return 0;
 error:
 	return -1;
@@ -214,6 +214,42 @@ typedef int (*db_raw_query_f)(
 typedef int (*db_raw_query_async_f)(const db1_con_t *_h, const str *_s);
 
 
+/**
+ * \brief Completion callback for an asynchronous query.
+ *
+ * Executed in the async worker process once the query has finished.
+ * The result is freed right after the callback returns, so any values
+ * that are needed later must be copied out. The argument pointer is
+ * passed through unchanged from the query submission; it has to point
+ * to shared memory (or be self contained) because the callback runs
+ * in a different process, and the callback owns it afterwards. A
+ * suspended transaction can be resumed from here via the tm API.
+ * \param _r the query result, NULL on failure or for write queries
+ * \param _ret return code of the query execution
+ * \param _arg argument given at query submission
+ */
+typedef void (*db_async_cbk_f)(db1_res_t *_r, int _ret, void *_arg);
+
+
+/**
+ * \brief Raw SQL query via async framework with completion callback.
+ *
+ * Unlike db_raw_query_async_f, which discards the outcome, the query
+ * result is handed to the given callback in the async worker process,
+ * so the caller can suspend the transaction and pick up the result
+ * without blocking a SIP worker. The same escaping precautions as for
+ * db_raw_query_f apply.
+ * \see db_raw_query_f
+ * \param _h structure representing database connection
+ * \param _s the SQL query
+ * \param _cbk completion callback
+ * \param _arg argument passed through to the callback
+ * \return returns 0 if everything is OK, otherwise returns value < 0
+ */
+typedef int (*db_async_query_f)(
+		const db1_con_t *_h, const str *_s, db_async_cbk_f _cbk, void *_arg);
+
+
 /**
  * \brief Free a result allocated by db_query.
  *
@@ -398,6 +434,28 @@ typedef int (*db_end_transaction_f)(db1_con_t *_h);
  */
 typedef int (*db_abort_transaction_f)(db1_con_t *_h);
 
+/**
+ * \brief Start a statement batch on the connection.
+ *
+ * Write statements submitted while a batch is open are queued on the
+ * connection and sent to the server together, so many statements cost
+ * only one network round-trip. Their results are not available before
+ * the batch is ended, therefore queries that read a result must not be
+ * executed inside a batch.
+ * \param _h structure representing database connection
+ * \return 0 if everything is OK, otherwise returns < 0
+ */
+typedef int (*db_batch_start_f)(db1_con_t *_h);
+
+/**
+ * \brief End a statement batch.
+ *
+ * Flush the queued statements to the server and collect their results.
+ * \param _h structure representing database connection
+ * \return 0 if all batched statements succeeded, otherwise returns < 0
+ */
+typedef int (*db_batch_end_f)(db1_con_t *_h);
+
 /**
  * \brief Database module callbacks
  *
@@ -434,6 +492,9 @@ typedef struct db_func
 	db_abort_transaction_f abort_transaction; /* Abort a transaction */
 	db_query_f query_lock; /* query a table and lock rows for update */
 	db_raw_query_async_f raw_query_async; /* Raw query - SQL */
+	db_batch_start_f batch_start;		  /* Start a statement batch */
+	db_batch_end_f batch_end; /* Flush a statement batch to the server */
+	db_async_query_f async_query; /* Raw query with completion callback */
 } db_func_t;
 
 
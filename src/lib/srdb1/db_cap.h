@@ -72,7 +72,13 @@ typedef enum db_cap
 			<< 9, /*!< driver can do insert delayed                                */
 	DB_CAP_AFFECTED_ROWS =
 			1
-			<< 10 /*!< driver can return number of rows affected by the last query  */
+			<< 10, /*!< driver can return number of rows affected by the last query  */
+	DB_CAP_BATCH =
+			1
+			<< 11, /*!< driver can batch write statements into one server round-trip */
+	DB_CAP_ASYNC_QUERY =
+			1
+			<< 12 /*!< driver can run queries with completion callbacks          */
 } db_cap_t;
 
 
@@ -28,12 +28,42 @@
  */
 
 #include "../../core/dprint.h"
+#include "../../core/globals.h"
+#include "../../core/mem/mem.h"
 #include "db_pool.h"
 
 
 /* The head of the pool */
 static struct pool_con *db_pool = 0;
 
+/* Side list with the pool state that cannot live in struct pool_con
+ * itself - the backends mirror that structure field by field */
+struct pool_slot
+{
+	struct pool_con *con;	/* the pooled connection */
+	unsigned int busy;		/* a query is running on it right now */
+	struct pool_slot *next; /* next element in the list */
+};
+
+static struct pool_slot *pool_slots = 0;
+
+/* handout and contention counters - printed when the pool empties */
+static unsigned int pool_cnt_opened = 0;
+static unsigned int pool_cnt_shared = 0;
+static unsigned int pool_cnt_overlap = 0;
+
+
+static struct pool_slot *pool_slot_get(const struct pool_con *con)
+{
+	struct pool_slot *slot;
+
+	for(slot = pool_slots; slot; slot = slot->next) {
+		if(slot->con == con)
+			return slot;
+	}
+	return 0;
+}
+
 
 /*
  * Search the pool for a connection with
@@ -43,22 +73,49 @@ static struct pool_con *db_pool = 0;
 struct pool_con *pool_get(const struct db_id *id)
 {
 	struct pool_con *ptr;
+	struct pool_con *best;
+	struct pool_slot *slot;
+	int matched;
 
 	if(!id) {
 		LM_ERR("invalid parameter value\n");
 		return 0;
 	}
 
+	/* hand out the least shared connection for the id, preferring
+	 * one that is not busy with a query right now */
+	best = 0;
+	matched = 0;
 	ptr = db_pool;
 	while(ptr) {
 		if(cmp_db_id(id, ptr->id)) {
-			ptr->ref++;
-			return ptr;
+			matched++;
+			if(!best) {
+				best = ptr;
+			} else {
+				slot = pool_slot_get(ptr);
+				if((ptr->ref < best->ref)
+						|| (ptr->ref == best->ref && slot && !slot->busy))
+					best = ptr;
+			}
 		}
 		ptr = ptr->next;
 	}
 
-	return 0;
+	if(!best)
+		return 0;
+
+	if(matched < db_pool_size && best->ref >= 1) {
+		/* below the per-url limit - let the caller open another
+		 * connection instead of piling up on the existing ones */
+		LM_DBG("pool has %d of %d connections for id %p - opening new\n",
+				matched, db_pool_size, id);
+		return 0;
+	}
+
+	best->ref++;
+	pool_cnt_shared++;
+	return best;
 }
 
 
@@ -67,11 +124,58 @@ struct pool_con *pool_get(const struct db_id *id)
  */
 void pool_insert(struct pool_con *con)
 {
+	struct pool_slot *slot;
+
 	if(!con)
 		return;
 
 	con->next = db_pool;
 	db_pool = con;
+
+	slot = (struct pool_slot *)pkg_malloc(sizeof(struct pool_slot));
+	if(!slot) {
+		PKG_MEM_ERROR;
+		return;
+	}
+	slot->con = con;
+	slot->busy = 0;
+	slot->next = pool_slots;
+	pool_slots = slot;
+	pool_cnt_opened++;
+}
+
+
+/*
+ * Mark a connection as executing a query - a second mark before the
+ * release means the connection got monopolized by nested use and is
+ * counted as contention
+ */
+void pool_busy_set(struct pool_con *con)
+{
+	struct pool_slot *slot;
+
+	slot = pool_slot_get(con);
+	if(!slot)
+		return;
+	if(slot->busy) {
+		pool_cnt_overlap++;
+		LM_DBG("query submitted on busy connection %p\n", con);
+	}
+	slot->busy++;
+}
+
+
+/*
+ * Mark a connection as idle again after the query finished
+ */
+void pool_busy_clear(struct pool_con *con)
+{
+	struct pool_slot *slot;
+
+	slot = pool_slot_get(con);
+	if(!slot || slot->busy == 0)
+		return;
+	slot->busy--;
 }
 
 
@@ -88,6 +192,8 @@ void pool_insert(struct pool_con *con)
 int pool_remove(struct pool_con *con)
 {
 	struct pool_con *ptr;
+	struct pool_slot *slot;
+	struct pool_slot *prev;
 
 	if(!con)
 		return -2;
@@ -121,5 +227,26 @@ int pool_remove(struct pool_con *con)
 		}
 	}
 
+	if(pool_slots && pool_slots->con == con) {
+		slot = pool_slots;
+		pool_slots = slot->next;
+		pkg_free(slot);
+	} else {
+		for(slot = pool_slots; slot && slot->next; slot = slot->next) {
+			if(slot->next->con == con) {
+				prev = slot;
+				slot = slot->next;
+				prev->next = slot->next;
+				pkg_free(slot);
+				break;
+			}
+		}
+	}
+
+	if(db_pool == 0) {
+		LM_DBG("pool stats: opened %u - shared %u - overlapped %u\n",
+				pool_cnt_opened, pool_cnt_shared, pool_cnt_overlap);
+	}
+
 	return 1;
 }
@@ -81,4 +81,19 @@ void pool_insert(struct pool_con *con);
 int pool_remove(struct pool_con *con);
 
 
+/**
+ * Mark a connection as executing a query. A nested mark before the
+ * matching clear is counted as pool contention.
+ * \param con the connection running the query
+ */
+void pool_busy_set(struct pool_con *con);
+
+
+/**
+ * Mark a connection as idle again after its query finished.
+ * \param con the connection that ran the query
+ */
+void pool_busy_clear(struct pool_con *con);
+
+
 #endif /* _DB1_POOL_H */
@@ -34,12 +34,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "../../core/dprint.h"
 #include "db_ut.h"
+#include "db.h"
 #include "db_query.h"
+#include "db_pool.h"
+#include "db_id.h"
 #include "../../core/globals.h"
 #include "../../core/timer.h"
+#include "../../core/async_task.h"
+#include "../../core/mem/shm_mem.h"
 
 static str sql_str;
 static char *sql_buf = NULL;
@@ -57,7 +63,9 @@ static inline int db_do_submit_query(const db1_con_t *_h, const str *_query,
 		gettimeofday(&tvb, &tz);
 	}
 
+	pool_busy_set((struct pool_con *)_h->tail);
 	ret = submit_query(_h, _query);
+	pool_busy_clear((struct pool_con *)_h->tail);
 
 	if(unlikely(cfg_get(core, core_cfg, latency_limit_db) > 0)
 			&& is_printable(cfg_get(core, core_cfg, latency_log))) {
@@ -221,6 +229,107 @@ int db_do_raw_query(const db1_con_t *_h, const str *_s, db1_res_t **_r,
 }
 
 
+/*! \brief async query task - the driver functions are taken along so
+ * the task can be executed generically in the async worker process */
+typedef struct db_async_query_task
+{
+	str url;
+	str query;
+	db_async_cbk_f cbk;
+	void *arg;
+	db_init_f init;
+	db_close_f close;
+	db_raw_query_f raw_query;
+	db_free_result_f free_result;
+} db_async_query_task_t;
+
+
+static void db_async_query_exec_task(void *param)
+{
+	db_async_query_task_t *tp;
+	db1_con_t *dbc;
+	db1_res_t *res = NULL;
+	int ret;
+
+	tp = (db_async_query_task_t *)param;
+	dbc = tp->init(&tp->url);
+	if(dbc == NULL) {
+		LM_ERR("failed to open connection for [%.*s]\n", tp->url.len,
+				tp->url.s);
+		tp->cbk(NULL, -1, tp->arg);
+		return;
+	}
+	ret = tp->raw_query(dbc, &tp->query, &res);
+	if(ret < 0) {
+		LM_ERR("failed to execute query [%.*s] on async worker\n",
+				(tp->query.len > 100) ? 100 : tp->query.len, tp->query.s);
+	}
+	tp->cbk(res, ret, tp->arg);
+	if(res)
+		tp->free_result(dbc, res);
+	tp->close(dbc);
+}
+
+
+int db_do_async_query(const db1_con_t *_h, const str *_s,
+		void (*cbk)(db1_res_t *, int, void *), void *arg,
+		db1_con_t *(*init)(const str *), void (*close)(db1_con_t *),
+		int (*raw_query)(const db1_con_t *_h, const str *_s, db1_res_t **_r),
+		int (*free_result)(db1_con_t *_h, db1_res_t *_r))
+{
+	struct db_id *di;
+	async_task_t *atask;
+	db_async_query_task_t *tp;
+	int asize;
+
+	if(!_h || !_s || !cbk || !init || !close || !raw_query || !free_result) {
+		LM_ERR("invalid parameter value\n");
+		return -1;
+	}
+	if(!async_task_workers_active()) {
+		LM_ERR("no async workers started - set async_workers core"
+			   " parameter\n");
+		return -1;
+	}
+
+	di = ((struct pool_con *)_h->tail)->id;
+
+	asize = sizeof(async_task_t) + sizeof(db_async_query_task_t) + di->url.len
+			+ _s->len + 2;
+	atask = shm_malloc(asize);
+	if(atask == NULL) {
+		SHM_MEM_ERROR_FMT("size %d\n", asize);
+		return -1;
+	}
+
+	atask->exec = db_async_query_exec_task;
+	atask->param = (char *)atask + sizeof(async_task_t);
+
+	tp = (db_async_query_task_t *)atask->param;
+	tp->url.s = (char *)tp + sizeof(db_async_query_task_t);
+	tp->url.len = di->url.len;
+	strncpy(tp->url.s, di->url.s, di->url.len);
+	tp->url.s[tp->url.len] = '\0';
+	tp->query.s = tp->url.s + tp->url.len + 1;
+	tp->query.len = _s->len;
+	strncpy(tp->query.s, _s->s, _s->len);
+	tp->query.s[tp->query.len] = '\0';
+	tp->cbk = cbk;
+	tp->arg = arg;
+	tp->init = init;
+	tp->close = close;
+	tp->raw_query = raw_query;
+	tp->free_result = free_result;
+
+	if(async_task_push(atask) < 0) {
+		shm_free(atask);
+		return -1;
+	}
+
+	return 0;
+}
+
+
 int db_do_insert_cmd(const db1_con_t *_h, const db_key_t *_k,
 		const db_val_t *_v, const int _n,
 		int (*val2str)(const db1_con_t *, const db_val_t *, char *, int *),
@@ -122,6 +122,31 @@ int db_do_raw_query(const db1_con_t *_h, const str *_s, db1_res_t **_r,
 		int (*store_result)(const db1_con_t *_h, db1_res_t **_r));
 
 
+/**
+ * \brief Helper function for raw db queries with completion callback
+ *
+ * This method clones the query into an async task together with the
+ * driver functions needed to run it; the task opens its own connection
+ * in the async worker process, executes the query and hands the result
+ * to the callback before freeing it.
+ *
+ * \param _h structure representing database connection
+ * \param _s char holding the raw query
+ * \param (*cbk) completion callback, executed in the async worker
+ * \param arg argument passed through to the callback
+ * \param (*init) function pointer to the db specific init function
+ * \param (*close) function pointer to the db specific close function
+ * \param (*raw_query) function pointer to the db specific raw query function
+ * \param (*free_result) function pointer to the db specific free result function
+ * \return zero on success, negative on errors
+ */
+int db_do_async_query(const db1_con_t *_h, const str *_s,
+		void (*cbk)(db1_res_t *, int, void *), void *arg,
+		db1_con_t *(*init)(const str *), void (*close)(db1_con_t *),
+		int (*raw_query)(const db1_con_t *_h, const str *_s, db1_res_t **_r),
+		int (*free_result)(db1_con_t *_h, db1_res_t *_r));
+
+
 /**
  * \brief Helper function for db insert operations
  *
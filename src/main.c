@@ -147,6 +147,7 @@
 #include "core/timer_proc.h"
 #include "core/srapi.h"
 #include "core/receive.h"
+#include "core/latency_hist.h"
 
 #ifdef DEBUG_DMALLOC
 #include <dmalloc.h>
@@ -391,6 +392,9 @@ int server_signature = 1;
 str server_hdr = {SERVER_HDR, SERVER_HDR_LEN};
 str user_agent_hdr = {USER_AGENT, USER_AGENT_LEN};
 str version_table = {VERSION_TABLE, VERSION_TABLE_LEN};
+/* max database connections opened per url in each process - the
+ * db pool hands module handles to the least shared connection */
+int db_pool_size = 1;
 /* should ser try to locate outbound interface on multihomed
  * host? by default not -- too expensive
  */
@@ -432,6 +436,9 @@ int open_files_limit = -1; /* don't touch it by default */
 int shm_force_alloc = 0; /* force immediate (on startup) page allocation
 						  (by writing 0 in the pages), useful if
 						  mlock_pages is also 1 */
+int shm_huge_pages = 0;	 /* back the shm segment with huge pages (try
+						  MAP_HUGETLB first, else advise transparent
+						  huge pages), reducing TLB pressure */
 int mlock_pages = 0;	 /* default off, try to disable swapping */
 
 /* real time options */
@@ -514,6 +521,10 @@ int ksr_verbose_startup = 0;
 int ksr_all_errors = 0;
 int ksr_udp_receiver_mode = 0;
 int ksr_udp_mtreceivers = 0;
+int ksr_udp_mmsg_batch = 0;
+int ksr_udp_reuseport = 0;
+int ksr_udp_gso = 0;
+int ksr_udp_busy_poll = 0;
 
 /* cfg parsing */
 int cfg_errors = 0;
@@ -1501,6 +1512,8 @@ int main_loop(void)
 		cfg_main_reset_local();
 		if(counters_prefork_init(get_max_procs()) == -1)
 			goto error;
+		if(ksr_log_async_prefork_init(get_max_procs()) < 0)
+			goto error;
 
 #ifdef USE_SLOW_TIMER
 		/* we need another process to act as the "slow" timer*/
@@ -1544,6 +1557,9 @@ int main_loop(void)
 			LM_CRIT("Cannot start wtimer\n");
 			goto error;
 		}
+		/* fork the log writer process, if async logging is enabled */
+		if(ksr_log_async_start() < 0)
+			goto error;
 		/* main process, receive loop */
 		process_no = 0; /*main process number*/
 		pt[process_no].pid = getpid();
@@ -1802,6 +1818,8 @@ int main_loop(void)
 
 		if(counters_prefork_init(get_max_procs()) == -1)
 			goto error;
+		if(ksr_log_async_prefork_init(get_max_procs()) < 0)
+			goto error;
 
 
 		woneinit = 0;
@@ -1888,7 +1906,21 @@ int main_loop(void)
 				} else if(pid == 0) {
 					/* child */
 					bind_address = si; /* shortcut */
-
+#ifdef SO_REUSEPORT
+					if(ksr_udp_reuseport && i > 0) {
+						/* bind an own SO_REUSEPORT socket per worker, so
+						 * the kernel shards the flows between the workers
+						 * (worker 0 keeps the inherited socket - unread
+						 * sockets in the group would blackhole traffic) */
+						close(si->socket);
+						if(udp_init(si) == -1) {
+							LM_ERR("failed to bind per-worker socket on"
+								   " %.*s\n",
+									si->sock_str.len, si->sock_str.s);
+							goto error;
+						}
+					}
+#endif
 					if(woneinit == 0) {
 						if(run_child_one_init_route() < 0)
 							goto error;
@@ -2020,6 +2052,9 @@ int main_loop(void)
 			LM_CRIT("Cannot start wtimer\n");
 			goto error;
 		}
+		/* fork the log writer process, if async logging is enabled */
+		if(ksr_log_async_start() < 0)
+			goto error;
 
 		/* init childs with rank==MAIN before starting tcp main (in case they want
 	 * to fork  a tcp capable process, the corresponding tcp. comm. fds in
@@ -2265,6 +2300,7 @@ int main(int argc, char **argv)
 	dont_fork_cnt = 0;
 
 	ksr_hname_init_index();
+	ksr_hash_init();
 	sr_cfgenv_init();
 	daemon_status_init();
 
@@ -3407,6 +3443,17 @@ int main(int argc, char **argv)
 		goto error;
 	};
 	fixup_complete = 1;
+	/* the export lookup cache is only useful while parsing and fixing
+	 * the config - release it before forking */
+	ksr_expcache_destroy();
+
+	/* allocate the route profiler table before forking, if enabled */
+	if(ksr_rprof_init() < 0)
+		LM_WARN("could not initialize the route profiler\n");
+
+	/* allocate the latency histogram table before forking, if enabled */
+	if(ksr_lathist_init() < 0)
+		LM_WARN("could not initialize the latency histograms\n");
 
 	ret = main_loop();
 	if(ret < 0)
@@ -46,6 +46,7 @@
 #include "../../modules/tm/t_funcs.h"
 #include "acc_mod.h"
 #include "acc.h"
+#include "acc_queue.h"
 #include "acc_extra.h"
 #include "acc_logic.h"
 #include "acc_api.h"
@@ -416,6 +417,26 @@ void acc_db_close(void)
 }
 
 
+/* execute an insert with the process-own db connection - used by the
+ * queue drainer process for records serialized by the sip workers */
+int acc_db_exec_insert(str *table, db_key_t *keys, db_val_t *vals, int n)
+{
+	if(db_handle == 0) {
+		LM_ERR("no database connection\n");
+		return -1;
+	}
+	if(acc_dbf.use_table(db_handle, table) < 0) {
+		LM_ERR("error in use_table\n");
+		return -1;
+	}
+	if(acc_dbf.insert(db_handle, keys, vals, n) < 0) {
+		LM_ERR("failed to insert into database\n");
+		return -1;
+	}
+	return 1;
+}
+
+
 int acc_db_request(struct sip_msg *rq)
 {
 	int m;
@@ -483,7 +504,12 @@ int acc_db_request(struct sip_msg *rq)
 
 	/* multi-leg columns */
 	if(!leg_info) {
-		if(acc_db_insert_mode == 1 && acc_dbf.insert_delayed != NULL) {
+		if(acc_db_insert_mode == 3) {
+			if(acc_queue_push(&acc_env.text, db_keys, db_vals, m) < 0) {
+				LM_ERR("failed to queue record for database\n");
+				goto error;
+			}
+		} else if(acc_db_insert_mode == 1 && acc_dbf.insert_delayed != NULL) {
 			if(acc_dbf.insert_delayed(db_handle, db_keys, db_vals, m) < 0) {
 				LM_ERR("failed to insert delayed into database\n");
 				goto error;
@@ -512,7 +538,14 @@ int acc_db_request(struct sip_msg *rq)
 					VAL_STR(db_vals + i) = val_arr[i];
 				}
 			}
-			if(acc_db_insert_mode == 1 && acc_dbf.insert_delayed != NULL) {
+			if(acc_db_insert_mode == 3) {
+				if(acc_queue_push(&acc_env.text, db_keys, db_vals, m + n)
+						< 0) {
+					LM_ERR("failed to queue record for database\n");
+					goto error;
+				}
+			} else if(acc_db_insert_mode == 1
+					  && acc_dbf.insert_delayed != NULL) {
 				if(acc_dbf.insert_delayed(db_handle, db_keys, db_vals, m + n)
 						< 0) {
 					LM_ERR("failed to insert delayed into database\n");
@@ -33,6 +33,8 @@
 #ifndef _ACC_ACC_H_
 #define _ACC_ACC_H_
 
+#include "../../lib/srdb1/db.h"
+
 /* leading text for a request accounted from a script */
 #define ACC "ACC: "
 #define ACC_REQUEST ACC "request accounted: "
@@ -87,6 +89,7 @@ int acc_db_init(const str *db_url);
 int acc_db_init_child(const str *db_url);
 void acc_db_close(void);
 int acc_db_request(struct sip_msg *req);
+int acc_db_exec_insert(str *table, db_key_t *keys, db_val_t *vals, int n);
 int acc_get_db_handlers(void **vf, void **vh);
 
 int is_eng_acc_on(sip_msg_t *msg);
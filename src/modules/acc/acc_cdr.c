@@ -43,6 +43,7 @@
 
 #include "acc_cdr.h"
 #include "acc_mod.h"
+#include "acc_queue.h"
 #include "acc_extra.h"
 #include "acc.h"
 
@@ -269,7 +270,13 @@ static int db_write_cdr(struct dlg_cell *dialog, struct sip_msg *message)
 		goto error;
 	}
 
-	if(acc_db_insert_mode == 1 && df->insert_delayed != NULL) {
+	if(acc_db_insert_mode == 3) {
+		if(acc_queue_push(&acc_cdrs_table, db_cdr_keys, db_cdr_vals, attr_cnt)
+				< 0) {
+			LM_ERR("failed to queue cdr for database\n");
+			goto error;
+		}
+	} else if(acc_db_insert_mode == 1 && df->insert_delayed != NULL) {
 		if(df->insert_delayed(dh, db_cdr_keys, db_cdr_vals, attr_cnt) < 0) {
 			LM_ERR("failed to insert delayed into database\n");
 			goto error;
@@ -49,6 +49,7 @@
 #include "../../core/str.h"
 #include "../../core/mod_fix.h"
 #include "../../core/kemi.h"
+#include "../../core/timer_proc.h"
 #include "../rr/api.h"
 #include "acc.h"
 #include "acc_api.h"
@@ -56,6 +57,7 @@
 #include "acc_extra.h"
 #include "acc_logic.h"
 #include "acc_cdr.h"
+#include "acc_queue.h"
 
 MODULE_VERSION
 
@@ -164,6 +166,9 @@ str acc_sipcode_col = str_init("sip_code");
 str acc_sipreason_col = str_init("sip_reason");
 str acc_time_col = str_init("time");
 int acc_db_insert_mode = 0;
+int acc_queue_size = 0;		 /*!< shm queue slots - 0 disables the queue */
+int acc_queue_interval = 1;	 /*!< drainer wake up interval in seconds */
+char *acc_queue_spill_dir = 0; /*!< directory for overflow spill file */
 
 /*@}*/
 
@@ -244,6 +249,9 @@ static param_export_t params[] = {
 	{"acc_sip_reason_column",PARAM_STR, &acc_sipreason_col  },
 	{"acc_time_column",      PARAM_STR, &acc_time_col       },
 	{"db_insert_mode",       PARAM_INT, &acc_db_insert_mode },
+	{"queue_size",           PARAM_INT, &acc_queue_size     },
+	{"queue_interval",       PARAM_INT, &acc_queue_interval },
+	{"queue_spill_dir",      PARAM_STRING, &acc_queue_spill_dir },
 	/* time-mode-specific */
 	{"time_mode",            PARAM_INT, &acc_time_mode        },
 	{"time_attr",            PARAM_STR, &acc_time_attr        },
@@ -565,6 +573,23 @@ static int mod_init(void)
 			LM_ERR("db_missed_flag set to invalid value\n");
 			return -1;
 		}
+
+		if(acc_db_insert_mode == 3) {
+			if(acc_queue_size <= 0) {
+				LM_ERR("db_insert_mode 3 requires queue_size greater"
+					   " than zero\n");
+				return -1;
+			}
+			if(acc_queue_interval <= 0) {
+				LM_ERR("queue_interval must be greater than zero\n");
+				return -1;
+			}
+			if(acc_queue_init() < 0) {
+				LM_ERR("failed to init accounting queue\n");
+				return -1;
+			}
+			register_basic_timers(1);
+		}
 	} else {
 		db_url.s = NULL;
 		db_url.len = 0;
@@ -590,7 +615,20 @@ static int mod_init(void)
 
 static int child_init(int rank)
 {
-	if(rank == PROC_INIT || rank == PROC_MAIN || rank == PROC_TCP_MAIN)
+	if(rank == PROC_MAIN) {
+		if(db_url.s && acc_db_insert_mode == 3) {
+			/* drainer process - gets its own db connection via the
+			 * module child_init executed after fork */
+			if(fork_basic_timer(PROC_TIMER, "ACC DB DRAINER", 1,
+					   acc_queue_timer, 0, acc_queue_interval)
+					< 0) {
+				LM_ERR("failed to fork queue drainer process\n");
+				return -1;
+			}
+		}
+		return 0;
+	}
+	if(rank == PROC_INIT || rank == PROC_TCP_MAIN)
 		return 0; /* do nothing for the main process */
 
 	if(db_url.s && acc_db_init_child(&db_url) < 0) {
@@ -607,6 +645,7 @@ static void destroy(void)
 	if(log_extra)
 		destroy_extras(log_extra);
 	acc_db_close();
+	acc_queue_destroy();
 	if(db_extra)
 		destroy_extras(db_extra);
 
@@ -0,0 +1,459 @@
+/*
+ * Accounting module
+ *
+ * Copyright (C) 2001-2003 FhG Fokus
+ * Copyright (C) 2006 Voice Sistem SRL
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*! \file
+ * \ingroup acc
+ * \brief Acc:: Shared memory queue towards the database drainer process
+ *
+ * SIP workers serialize accounting records into compact shared memory
+ * blocks and append them to a ring of pointers; a dedicated timer
+ * process pops and executes the inserts, so a slow or hiccuping
+ * database server never blocks the SIP processing path. When the ring
+ * is full, records are spilled to a file on disk (if queue_spill_dir
+ * is set) and replayed by the drainer once the ring is empty again.
+ *
+ * - Module: \ref acc
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "../../core/dprint.h"
+#include "../../core/mem/mem.h"
+#include "../../core/mem/shm_mem.h"
+#include "../../core/locking.h"
+#include "../../core/parser/msg_parser.h"
+#include "acc.h"
+#include "acc_queue.h"
+
+#define ACC_QREC_MAX_SIZE (1 << 20)
+
+/*! \brief serialized accounting record - table name, keys and values
+ * follow the header in one block */
+typedef struct acc_qrec
+{
+	int size;  /*!< total size of the block, header included */
+	int ncols; /*!< number of key/value pairs */
+} acc_qrec_t;
+
+typedef struct acc_queue
+{
+	gen_lock_t lock;
+	int size;	/*!< number of slots in the ring */
+	int head;	/*!< oldest record */
+	int tail;	/*!< next free slot */
+	int count;	/*!< records currently queued */
+	unsigned int dropped; /*!< records lost on overflow */
+	unsigned int spilled; /*!< records written to the spill file */
+	acc_qrec_t **slots;
+} acc_queue_t;
+
+static acc_queue_t *_acc_queue = NULL;
+
+static char acc_queue_spill_path[256];
+
+
+int acc_queue_init(void)
+{
+	int len;
+
+	if(acc_queue_size <= 0)
+		return 0;
+	len = sizeof(acc_queue_t) + acc_queue_size * sizeof(acc_qrec_t *);
+	_acc_queue = (acc_queue_t *)shm_malloc(len);
+	if(_acc_queue == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_acc_queue, 0, len);
+	if(lock_init(&_acc_queue->lock) == NULL) {
+		LM_ERR("failed to init queue lock\n");
+		shm_free(_acc_queue);
+		_acc_queue = NULL;
+		return -1;
+	}
+	_acc_queue->size = acc_queue_size;
+	_acc_queue->slots = (acc_qrec_t **)(_acc_queue + 1);
+	if(acc_queue_spill_dir != NULL && acc_queue_spill_dir[0] != '\0') {
+		if(snprintf(acc_queue_spill_path, sizeof(acc_queue_spill_path),
+				   "%s/acc_queue.spill", acc_queue_spill_dir)
+				>= (int)sizeof(acc_queue_spill_path)) {
+			LM_ERR("queue_spill_dir path too long\n");
+			lock_destroy(&_acc_queue->lock);
+			shm_free(_acc_queue);
+			_acc_queue = NULL;
+			return -1;
+		}
+	} else {
+		acc_queue_spill_path[0] = '\0';
+	}
+	return 0;
+}
+
+
+void acc_queue_destroy(void)
+{
+	int i;
+
+	if(_acc_queue == NULL)
+		return;
+	if(_acc_queue->count > 0 || _acc_queue->dropped > 0
+			|| _acc_queue->spilled > 0)
+		LM_WARN("acc queue stats: pending %d - dropped %u - spilled %u\n",
+				_acc_queue->count, _acc_queue->dropped, _acc_queue->spilled);
+	for(i = 0; i < _acc_queue->count; i++)
+		shm_free(_acc_queue->slots[(_acc_queue->head + i) % _acc_queue->size]);
+	lock_destroy(&_acc_queue->lock);
+	shm_free(_acc_queue);
+	_acc_queue = NULL;
+}
+
+
+/*! \brief serialize one record - layout is the header, the table name
+ * and then per column the key, type, null flag and value, all fields
+ * copied with memcpy so the buffer needs no alignment */
+static acc_qrec_t *acc_qrec_new(str *table, db_key_t *keys, db_val_t *vals,
+		int n)
+{
+	acc_qrec_t *rec;
+	char *p;
+	int len;
+	int i;
+
+	len = sizeof(acc_qrec_t) + sizeof(int) + table->len;
+	for(i = 0; i < n; i++) {
+		len += sizeof(int) + keys[i]->len + 2 * sizeof(char);
+		if(VAL_NULL(vals + i))
+			continue;
+		switch(VAL_TYPE(vals + i)) {
+			case DB1_STR:
+				len += sizeof(int) + VAL_STR(vals + i).len;
+				break;
+			case DB1_STRING:
+				len += sizeof(int) + strlen(VAL_STRING(vals + i)) + 1;
+				break;
+			case DB1_INT:
+				len += sizeof(int);
+				break;
+			case DB1_DOUBLE:
+				len += sizeof(double);
+				break;
+			case DB1_DATETIME:
+				len += sizeof(time_t);
+				break;
+			default:
+				LM_ERR("unsupported column type %d\n", VAL_TYPE(vals + i));
+				return NULL;
+		}
+	}
+	rec = (acc_qrec_t *)shm_malloc(len);
+	if(rec == NULL) {
+		SHM_MEM_ERROR;
+		return NULL;
+	}
+	rec->size = len;
+	rec->ncols = n;
+	p = (char *)(rec + 1);
+	memcpy(p, &table->len, sizeof(int));
+	p += sizeof(int);
+	memcpy(p, table->s, table->len);
+	p += table->len;
+	for(i = 0; i < n; i++) {
+		memcpy(p, &keys[i]->len, sizeof(int));
+		p += sizeof(int);
+		memcpy(p, keys[i]->s, keys[i]->len);
+		p += keys[i]->len;
+		*p++ = (char)VAL_TYPE(vals + i);
+		*p++ = (char)(VAL_NULL(vals + i) ? 1 : 0);
+		if(VAL_NULL(vals + i))
+			continue;
+		switch(VAL_TYPE(vals + i)) {
+			case DB1_STR:
+				memcpy(p, &VAL_STR(vals + i).len, sizeof(int));
+				p += sizeof(int);
+				memcpy(p, VAL_STR(vals + i).s, VAL_STR(vals + i).len);
+				p += VAL_STR(vals + i).len;
+				break;
+			case DB1_STRING:
+				len = strlen(VAL_STRING(vals + i)) + 1;
+				memcpy(p, &len, sizeof(int));
+				p += sizeof(int);
+				memcpy(p, VAL_STRING(vals + i), len);
+				p += len;
+				break;
+			case DB1_INT:
+				memcpy(p, &VAL_INT(vals + i), sizeof(int));
+				p += sizeof(int);
+				break;
+			case DB1_DOUBLE:
+				memcpy(p, &VAL_DOUBLE(vals + i), sizeof(double));
+				p += sizeof(double);
+				break;
+			case DB1_DATETIME:
+				memcpy(p, &VAL_TIME(vals + i), sizeof(time_t));
+				p += sizeof(time_t);
+				break;
+			default:
+				break;
+		}
+	}
+	return rec;
+}
+
+
+/*! \brief rebuild key/value arrays from a record and run the insert -
+ * strings point straight into the record buffer, no copies */
+static int acc_qrec_exec(acc_qrec_t *rec)
+{
+	static str *qkeys = NULL;
+	static db_key_t *qkeyp = NULL;
+	static db_val_t *qvals = NULL;
+	static int qcols = 0;
+	str table;
+	char *p;
+	char vtype;
+	char vnull;
+	int len;
+	int i;
+
+	if(rec->ncols > qcols) {
+		if(qkeys)
+			pkg_free(qkeys);
+		if(qkeyp)
+			pkg_free(qkeyp);
+		if(qvals)
+			pkg_free(qvals);
+		qkeys = (str *)pkg_malloc(rec->ncols * sizeof(str));
+		qkeyp = (db_key_t *)pkg_malloc(rec->ncols * sizeof(db_key_t));
+		qvals = (db_val_t *)pkg_malloc(rec->ncols * sizeof(db_val_t));
+		if(qkeys == NULL || qkeyp == NULL || qvals == NULL) {
+			PKG_MEM_ERROR;
+			qcols = 0;
+			return -1;
+		}
+		qcols = rec->ncols;
+	}
+	p = (char *)(rec + 1);
+	memcpy(&table.len, p, sizeof(int));
+	p += sizeof(int);
+	table.s = p;
+	p += table.len;
+	for(i = 0; i < rec->ncols; i++) {
+		memcpy(&qkeys[i].len, p, sizeof(int));
+		p += sizeof(int);
+		qkeys[i].s = p;
+		p += qkeys[i].len;
+		qkeyp[i] = &qkeys[i];
+		vtype = *p++;
+		vnull = *p++;
+		memset(&qvals[i], 0, sizeof(db_val_t));
+		VAL_TYPE(qvals + i) = (db_type_t)vtype;
+		if(vnull) {
+			VAL_NULL(qvals + i) = 1;
+			continue;
+		}
+		switch(VAL_TYPE(qvals + i)) {
+			case DB1_STR:
+				memcpy(&VAL_STR(qvals + i).len, p, sizeof(int));
+				p += sizeof(int);
+				VAL_STR(qvals + i).s = p;
+				p += VAL_STR(qvals + i).len;
+				break;
+			case DB1_STRING:
+				memcpy(&len, p, sizeof(int));
+				p += sizeof(int);
+				VAL_STRING(qvals + i) = p;
+				p += len;
+				break;
+			case DB1_INT:
+				memcpy(&VAL_INT(qvals + i), p, sizeof(int));
+				p += sizeof(int);
+				break;
+			case DB1_DOUBLE:
+				memcpy(&VAL_DOUBLE(qvals + i), p, sizeof(double));
+				p += sizeof(double);
+				break;
+			case DB1_DATETIME:
+				memcpy(&VAL_TIME(qvals + i), p, sizeof(time_t));
+				p += sizeof(time_t);
+				break;
+			default:
+				LM_ERR("corrupted record - column type %d\n", vtype);
+				return -1;
+		}
+	}
+	return acc_db_exec_insert(&table, qkeyp, qvals, rec->ncols);
+}
+
+
+/*! \brief append an overflowed record to the spill file - called with
+ * the queue lock held, so writes from different processes do not
+ * interleave; open/write/close per record keeps the drainer free to
+ * rename the file away between two records */
+static int acc_queue_spill(acc_qrec_t *rec)
+{
+	int fd;
+	int ret;
+
+	if(acc_queue_spill_path[0] == '\0')
+		return -1;
+	fd = open(acc_queue_spill_path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if(fd < 0) {
+		LM_ERR("failed to open spill file [%s]\n", acc_queue_spill_path);
+		return -1;
+	}
+	ret = write(fd, rec, rec->size);
+	close(fd);
+	if(ret != rec->size) {
+		LM_ERR("failed to write record to spill file [%s]\n",
+				acc_queue_spill_path);
+		return -1;
+	}
+	return 0;
+}
+
+
+int acc_queue_push(str *table, db_key_t *keys, db_val_t *vals, int n)
+{
+	acc_qrec_t *rec;
+
+	if(_acc_queue == NULL) {
+		LM_ERR("accounting queue is not initialized\n");
+		return -1;
+	}
+	rec = acc_qrec_new(table, keys, vals, n);
+	if(rec == NULL)
+		return -1;
+	lock_get(&_acc_queue->lock);
+	if(_acc_queue->count == _acc_queue->size) {
+		/* ring full - spill to disk instead of waiting for the db */
+		if(acc_queue_spill(rec) == 0) {
+			_acc_queue->spilled++;
+		} else {
+			_acc_queue->dropped++;
+			lock_release(&_acc_queue->lock);
+			shm_free(rec);
+			LM_ERR("accounting queue overflow - record dropped\n");
+			return -1;
+		}
+		lock_release(&_acc_queue->lock);
+		shm_free(rec);
+		return 0;
+	}
+	_acc_queue->slots[_acc_queue->tail] = rec;
+	_acc_queue->tail = (_acc_queue->tail + 1) % _acc_queue->size;
+	_acc_queue->count++;
+	lock_release(&_acc_queue->lock);
+	return 0;
+}
+
+
+/*! \brief replay records spilled to disk while the ring was full */
+static void acc_queue_replay_spill(void)
+{
+	char rpath[sizeof(acc_queue_spill_path) + 8];
+	acc_qrec_t *rec;
+	acc_qrec_t hdr;
+	FILE *f;
+	int ret;
+
+	if(acc_queue_spill_path[0] == '\0')
+		return;
+	if(access(acc_queue_spill_path, F_OK) != 0)
+		return;
+	snprintf(rpath, sizeof(rpath), "%s.replay", acc_queue_spill_path);
+	/* take the file away under the lock so no producer is mid-write */
+	lock_get(&_acc_queue->lock);
+	ret = rename(acc_queue_spill_path, rpath);
+	lock_release(&_acc_queue->lock);
+	if(ret != 0) {
+		LM_ERR("failed to rename spill file [%s]\n", acc_queue_spill_path);
+		return;
+	}
+	f = fopen(rpath, "r");
+	if(f == NULL) {
+		LM_ERR("failed to open spill file [%s]\n", rpath);
+		return;
+	}
+	while(fread(&hdr, sizeof(hdr), 1, f) == 1) {
+		if(hdr.size <= (int)sizeof(hdr) || hdr.size > ACC_QREC_MAX_SIZE
+				|| hdr.ncols <= 0) {
+			LM_ERR("corrupted spill file [%s] - replay aborted\n", rpath);
+			break;
+		}
+		rec = (acc_qrec_t *)pkg_malloc(hdr.size);
+		if(rec == NULL) {
+			PKG_MEM_ERROR;
+			break;
+		}
+		*rec = hdr;
+		if(fread(rec + 1, hdr.size - sizeof(hdr), 1, f) != 1) {
+			LM_ERR("truncated spill file [%s] - replay aborted\n", rpath);
+			pkg_free(rec);
+			break;
+		}
+		if(acc_qrec_exec(rec) < 0)
+			LM_ERR("failed to insert replayed accounting record\n");
+		pkg_free(rec);
+	}
+	fclose(f);
+	unlink(rpath);
+}
+
+
+/*! \brief executed in the dedicated drainer process - pop and insert
+ * all pending records, then replay any disk spill */
+void acc_queue_timer(unsigned int ticks, void *param)
+{
+	acc_qrec_t *rec;
+	int drained;
+
+	if(_acc_queue == NULL || !acc_is_db_ready())
+		return;
+	drained = 0;
+	while(1) {
+		lock_get(&_acc_queue->lock);
+		if(_acc_queue->count == 0) {
+			lock_release(&_acc_queue->lock);
+			break;
+		}
+		rec = _acc_queue->slots[_acc_queue->head];
+		_acc_queue->head = (_acc_queue->head + 1) % _acc_queue->size;
+		_acc_queue->count--;
+		lock_release(&_acc_queue->lock);
+		if(acc_qrec_exec(rec) < 0)
+			LM_ERR("failed to insert queued accounting record\n");
+		shm_free(rec);
+		drained++;
+	}
+	if(drained > 0)
+		LM_DBG("drained %d accounting records\n", drained);
+	acc_queue_replay_spill();
+}
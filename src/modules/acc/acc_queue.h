@@ -0,0 +1,49 @@
+/*
+ * Accounting module
+ *
+ * Copyright (C) 2001-2003 FhG Fokus
+ * Copyright (C) 2006 Voice Sistem SRL
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*! \file
+ * \ingroup acc
+ * \brief Acc:: Shared memory queue towards the database drainer process
+ *
+ * - Module: \ref acc
+ */
+
+#ifndef _ACC_QUEUE_H_
+#define _ACC_QUEUE_H_
+
+#include "../../core/str.h"
+#include "../../lib/srdb1/db.h"
+
+extern int acc_queue_size;
+extern int acc_queue_interval;
+extern char *acc_queue_spill_dir;
+
+int acc_queue_init(void);
+void acc_queue_destroy(void);
+int acc_queue_push(str *table, db_key_t *keys, db_val_t *vals, int n);
+void acc_queue_timer(unsigned int ticks, void *param);
+
+#endif
@@ -68,6 +68,11 @@ int app_lua_openlibs_register(app_lua_openlibs_f rfunc)
  * default: 0 (off)
  */
 static unsigned int _app_lua_sr_reload = 1;
+/**
+ * drop the ffi module when running on LuaJIT
+ * default: 0 (keep it)
+ */
+int _app_lua_disable_ffi = 0;
 /**
  *
  */
@@ -96,6 +101,18 @@ static sr_lua_load_t *_sr_lua_load_list = NULL;
 static gen_lock_set_t *sr_lua_locks = NULL;
 static sr_lua_script_ver_t *sr_lua_script_ver = NULL;
 
+/**
+ * bytecode of the load-time scripts - compiled once, kept in shared
+ * memory and executed read-only by all the workers
+ */
+typedef struct _sr_lua_script_bc
+{
+	char *buf;
+	int len;
+} sr_lua_script_bc_t;
+
+static sr_lua_script_bc_t *sr_lua_script_bc = NULL;
+
 
 int lua_sr_alloc_script_ver(void)
 {
@@ -117,6 +134,14 @@ int lua_sr_alloc_script_ver(void)
 	memset(sr_lua_script_ver->version, 0, sizeof(unsigned int) * size);
 	sr_lua_script_ver->len = size;
 
+	sr_lua_script_bc = (sr_lua_script_bc_t *)shm_malloc(
+			sizeof(sr_lua_script_bc_t) * size);
+	if(sr_lua_script_bc == NULL) {
+		SHM_MEM_ERROR;
+		goto error;
+	}
+	memset(sr_lua_script_bc, 0, sizeof(sr_lua_script_bc_t) * size);
+
 	if((sr_lua_locks = lock_set_alloc(size)) == 0) {
 		LM_CRIT("failed to alloc lock set\n");
 		goto error;
@@ -128,6 +153,10 @@ int lua_sr_alloc_script_ver(void)
 
 	return 0;
 error:
+	if(sr_lua_script_bc != NULL) {
+		shm_free(sr_lua_script_bc);
+		sr_lua_script_bc = NULL;
+	}
 	if(sr_lua_script_ver != NULL) {
 		if(sr_lua_script_ver->version != NULL) {
 			shm_free(sr_lua_script_ver->version);
@@ -144,6 +173,141 @@ error:
 	return -1;
 }
 
+typedef struct _sr_lua_bc_wbuf
+{
+	char *s;
+	int len;
+	int size;
+} sr_lua_bc_wbuf_t;
+
+/**
+ * lua_Writer callback collecting the bytecode of a chunk into a growing
+ * pkg buffer
+ */
+static int lua_sr_bc_writer(
+		lua_State *L, const void *p, size_t sz, void *ud)
+{
+	sr_lua_bc_wbuf_t *wb = (sr_lua_bc_wbuf_t *)ud;
+	char *nbuf;
+	int nsize;
+
+	if(wb->len + (int)sz > wb->size) {
+		nsize = (wb->size > 0) ? 2 * wb->size : 4096;
+		while(nsize < wb->len + (int)sz)
+			nsize *= 2;
+		nbuf = (char *)pkg_realloc(wb->s, nsize);
+		if(nbuf == NULL) {
+			PKG_MEM_ERROR;
+			return -1;
+		}
+		wb->s = nbuf;
+		wb->size = nsize;
+	}
+	memcpy(wb->s + wb->len, p, sz);
+	wb->len += (int)sz;
+	return 0;
+}
+
+/**
+ * Compile a script to bytecode and publish it in the shared cache, so
+ * the workers can execute it without reading and compiling the file
+ * again. Returns 0 on success and -1 on failure, leaving a previously
+ * published chunk in place.
+ */
+static int lua_sr_compile_script(int pos, const char *script)
+{
+	lua_State *L;
+	sr_lua_bc_wbuf_t wb;
+	char *nbuf = NULL;
+	char *obuf = NULL;
+	char *txt;
+	int ret;
+
+	if(sr_lua_script_bc == NULL || pos < 0
+			|| pos >= (int)sr_lua_script_ver->len)
+		return -1;
+
+	L = luaL_newstate();
+	if(L == NULL) {
+		LM_ERR("cannot open lua for compiling\n");
+		return -1;
+	}
+	if(luaL_loadfile(L, script) != 0) {
+		txt = (char *)lua_tostring(L, -1);
+		LM_ERR("failed to compile Lua script: %s (%s)\n", script,
+				(txt) ? txt : "unknown");
+		lua_close(L);
+		return -1;
+	}
+
+	memset(&wb, 0, sizeof(wb));
+#if LUA_VERSION_NUM >= 503
+	ret = lua_dump(L, lua_sr_bc_writer, &wb, 0);
+#else
+	ret = lua_dump(L, lua_sr_bc_writer, &wb);
+#endif
+	lua_close(L);
+	if(ret != 0 || wb.len <= 0) {
+		LM_ERR("failed to dump the bytecode of script: %s\n", script);
+		if(wb.s != NULL)
+			pkg_free(wb.s);
+		return -1;
+	}
+
+	nbuf = (char *)shm_malloc(wb.len);
+	if(nbuf == NULL) {
+		SHM_MEM_ERROR;
+		pkg_free(wb.s);
+		return -1;
+	}
+	memcpy(nbuf, wb.s, wb.len);
+	pkg_free(wb.s);
+
+	lock_set_get(sr_lua_locks, pos);
+	obuf = sr_lua_script_bc[pos].buf;
+	sr_lua_script_bc[pos].buf = nbuf;
+	sr_lua_script_bc[pos].len = wb.len;
+	lock_set_release(sr_lua_locks, pos);
+	if(obuf != NULL)
+		shm_free(obuf);
+
+	LM_DBG("published %d bytes of bytecode for script <%s>\n", wb.len,
+			script);
+	return 0;
+}
+
+/**
+ * Execute a load-time script in the loading state - from the shared
+ * bytecode when available, from the file otherwise. Mirrors the return
+ * convention of luaL_dofile().
+ */
+static int lua_sr_run_script(int pos, sr_lua_load_t *li)
+{
+	char *lbuf = NULL;
+	int llen = 0;
+	int ret;
+
+	if(sr_lua_script_bc != NULL && pos >= 0 && pos < (int)sr_lua_script_ver->len) {
+		lock_set_get(sr_lua_locks, pos);
+		if(sr_lua_script_bc[pos].buf != NULL) {
+			llen = sr_lua_script_bc[pos].len;
+			lbuf = (char *)pkg_malloc(llen);
+			if(lbuf != NULL)
+				memcpy(lbuf, sr_lua_script_bc[pos].buf, llen);
+		}
+		lock_set_release(sr_lua_locks, pos);
+	}
+	if(lbuf == NULL) {
+		return luaL_dofile(_sr_L_env.LL, (const char *)li->script);
+	}
+
+	ret = luaL_loadbuffer(_sr_L_env.LL, lbuf, llen, li->script);
+	if(ret == 0)
+		ret = lua_pcall(_sr_L_env.LL, 0, LUA_MULTRET, 0);
+	pkg_free(lbuf);
+	return ret;
+}
+
 /**
  *
  */
@@ -251,17 +415,48 @@ void lua_sr_openlibs(lua_State *L)
 	lua_sr_kemi_register_libs(L);
 }
 
+/**
+ * drop the ffi module when the engine is LuaJIT, so the scripts cannot
+ * step outside the KEMI exports - no-op on plain Lua
+ */
+static void lua_sr_disable_ffi(lua_State *L)
+{
+	if(_app_lua_disable_ffi == 0)
+		return;
+	if(luaL_dostring(L, "if rawget(_G, 'jit') ~= nil then"
+						" package.preload['ffi'] = nil;"
+						" package.loaded['ffi'] = nil;"
+						" rawset(_G, 'ffi', nil);"
+						" end")
+			!= 0) {
+		LM_WARN("failed to disable the ffi module\n");
+		lua_pop(L, 1);
+	}
+}
+
 /**
  *
  */
 int lua_sr_init_mod(void)
 {
+	sr_lua_load_t *li;
+	int i;
+
 	/* allocate shm */
 	if(lua_sr_alloc_script_ver() < 0) {
 		LM_CRIT("failed to alloc shm for version\n");
 		return -1;
 	}
 
+	/* precompile the scripts before forking, so the workers only run
+	 * the shared bytecode instead of compiling per process */
+	for(i = 0, li = _sr_lua_load_list; li != NULL; i++, li = li->next) {
+		if(lua_sr_compile_script(i, li->script) < 0) {
+			LM_ERR("failed to precompile script: %s\n", li->script);
+			return -1;
+		}
+	}
+
 	memset(&_sr_L_env, 0, sizeof(sr_lua_env_t));
 
 	return 0;
@@ -284,6 +479,7 @@ int lua_sr_init_probe(void)
 	}
 	luaL_openlibs(L);
 	lua_sr_openlibs(L);
+	lua_sr_disable_ffi(L);
 
 	/* force loading lua lib now */
 	if(luaL_dostring(L, "KSR.x.probe()") != 0) {
@@ -319,6 +515,7 @@ int lua_sr_init_child(void)
 {
 	sr_lua_load_t *li;
 	int ret;
+	int i;
 	char *txt;
 
 	memset(&_sr_L_env, 0, sizeof(sr_lua_env_t));
@@ -329,6 +526,7 @@ int lua_sr_init_child(void)
 	}
 	luaL_openlibs(_sr_L_env.L);
 	lua_sr_openlibs(_sr_L_env.L);
+	lua_sr_disable_ffi(_sr_L_env.L);
 
 	/* set KSR lib version */
 #if LUA_VERSION_NUM >= 502
@@ -347,6 +545,7 @@ int lua_sr_init_child(void)
 		}
 		luaL_openlibs(_sr_L_env.LL);
 		lua_sr_openlibs(_sr_L_env.LL);
+		lua_sr_disable_ffi(_sr_L_env.LL);
 
 		/* set SR lib version */
 #if LUA_VERSION_NUM >= 502
@@ -367,8 +566,9 @@ int lua_sr_init_child(void)
 		}
 
 		li = _sr_lua_load_list;
+		i = 0;
 		while(li) {
-			ret = luaL_dofile(_sr_L_env.LL, (const char *)li->script);
+			ret = lua_sr_run_script(i, li);
 			if(ret != 0) {
 				LM_ERR("failed to load Lua script: %s (err: %d)\n", li->script,
 						ret);
@@ -379,6 +579,7 @@ int lua_sr_init_child(void)
 				return -1;
 			}
 			li = li->next;
+			i++;
 		}
 	}
 	LM_DBG("Lua initialized!\n");
@@ -390,6 +591,8 @@ int lua_sr_init_child(void)
  */
 void lua_sr_destroy(void)
 {
+	int i;
+
 	if(_sr_L_env.L != NULL) {
 		lua_close(_sr_L_env.L);
 		_sr_L_env.L = NULL;
@@ -400,6 +603,17 @@ void lua_sr_destroy(void)
 	}
 	memset(&_sr_L_env, 0, sizeof(sr_lua_env_t));
 
+	if(sr_lua_script_bc != NULL) {
+		if(sr_lua_script_ver != NULL) {
+			for(i = 0; i < (int)sr_lua_script_ver->len; i++) {
+				if(sr_lua_script_bc[i].buf != NULL)
+					shm_free(sr_lua_script_bc[i].buf);
+			}
+		}
+		shm_free(sr_lua_script_bc);
+		sr_lua_script_bc = NULL;
+	}
+
 	if(sr_lua_script_ver != NULL) {
 		shm_free(sr_lua_script_ver->version);
 		shm_free(sr_lua_script_ver);
@@ -432,6 +646,7 @@ int lua_sr_list_script(sr_lua_load_t **list)
  */
 int lua_sr_reload_script(int pos)
 {
+	sr_lua_load_t *li;
 	int i, len = sr_lua_script_ver->len;
 	if(_sr_lua_load_list != NULL) {
 		if(!sr_lua_script_ver) {
@@ -442,23 +657,25 @@ int lua_sr_reload_script(int pos)
 			LM_ERR("reload is not activated\n");
 			return -3;
 		}
-		if(pos < 0) {
-			// let's mark all the scripts to be reloaded
-			for(i = 0; i < len; i++) {
-				lock_set_get(sr_lua_locks, i);
-				sr_lua_script_ver->version[i] += 1;
-				lock_set_release(sr_lua_locks, i);
-			}
-		} else {
-			if(pos < len) {
-				lock_set_get(sr_lua_locks, pos);
-				sr_lua_script_ver->version[pos] += 1;
-				lock_set_release(sr_lua_locks, pos);
-				LM_DBG("pos: %d set to reloaded\n", pos);
-			} else {
-				LM_ERR("pos out of range\n");
-				return -2;
+		if(pos >= len) {
+			LM_ERR("pos out of range\n");
+			return -2;
+		}
+		/* recompile into the shared bytecode cache first and bump the
+		 * version only on success, so the workers either pick up the
+		 * new chunk or keep running the old one */
+		for(i = 0, li = _sr_lua_load_list; li != NULL; i++, li = li->next) {
+			if(pos >= 0 && pos != i)
+				continue;
+			if(lua_sr_compile_script(i, li->script) < 0) {
+				LM_ERR("failed to recompile script: %s - not reloaded\n",
+						li->script);
+				continue;
 			}
+			lock_set_get(sr_lua_locks, i);
+			sr_lua_script_ver->version[i] += 1;
+			lock_set_release(sr_lua_locks, i);
+			LM_DBG("pos: %d set to reloaded\n", i);
 		}
 		return 0;
 	}
@@ -498,7 +715,7 @@ int sr_lua_reload_script(void)
 		if(li->version != _app_lua_sv[i]) {
 			LM_DBG("loaded version:%d needed: %d Let's reload <%s>\n",
 					li->version, _app_lua_sv[i], li->script);
-			ret = luaL_dofile(_sr_L_env.LL, (const char *)li->script);
+			ret = lua_sr_run_script(i, li);
 			if(ret != 0) {
 				LM_ERR("failed to load Lua script: %s (err: %d)\n", li->script,
 						ret);
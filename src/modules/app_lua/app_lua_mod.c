@@ -64,11 +64,14 @@ int app_lua_reload_param(modparam_t type, void *val);
 
 int _ksr_app_lua_log_mode = 0;
 
+extern int _app_lua_disable_ffi;
+
 /* clang-format off */
 static param_export_t params[] = {
 	{"load", PARAM_STRING | PARAM_USE_FUNC, (void *)app_lua_load_param},
 	{"reload", PARAM_INT | PARAM_USE_FUNC, (void *)app_lua_reload_param},
 	{"log_mode", PARAM_INT, &_ksr_app_lua_log_mode},
+	{"disable_ffi", PARAM_INT, &_app_lua_disable_ffi},
 	{0, 0, 0}
 };
 
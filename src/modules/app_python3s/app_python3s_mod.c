@@ -412,6 +412,8 @@ int apy_reload_script(void)
 	}
 	Py_DECREF(_sr_apy3s_handler_script);
 	_sr_apy3s_handler_script = pModule;
+	/* the cached callables belong to the replaced module */
+	apy3s_exec_func_cache_reset();
 
 	if(apy3s_script_init_exec(
 			   pModule, &_sr_apy3s_script_child_init, &_apy3s_process_rank)
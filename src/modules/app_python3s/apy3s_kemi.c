@@ -66,6 +66,71 @@ sr_apy_env_t *sr_apy_env_get()
 	return &_sr_apy_env;
 }
 
+#define APY3S_FCACHE_SIZE 8
+#define APY3S_FCACHE_NAME_SIZE 64
+
+typedef struct apy3s_fcache_entry
+{
+	char name[APY3S_FCACHE_NAME_SIZE];
+	PyObject *func;
+} apy3s_fcache_entry_t;
+
+/* per-process cache of the handler script callables - the route
+ * callbacks form a small fixed set, so the attribute lookup and the
+ * name conversion are paid only once per function */
+static apy3s_fcache_entry_t _apy3s_fcache[APY3S_FCACHE_SIZE];
+
+/**
+ * drop the cached callables - to be run with the interpreter lock held
+ * whenever the handler script is replaced
+ */
+void apy3s_exec_func_cache_reset(void)
+{
+	int i;
+
+	for(i = 0; i < APY3S_FCACHE_SIZE; i++) {
+		if(_apy3s_fcache[i].func != NULL) {
+			Py_DECREF(_apy3s_fcache[i].func);
+			_apy3s_fcache[i].func = NULL;
+		}
+		_apy3s_fcache[i].name[0] = '\0';
+	}
+}
+
+/**
+ * resolve a function of the handler script, through the cache when
+ * possible - returns a new reference, like PyObject_GetAttrString()
+ */
+static PyObject *apy3s_exec_func_get(char *fname)
+{
+	PyObject *pFunc;
+	int empty = -1;
+	int i;
+
+	for(i = 0; i < APY3S_FCACHE_SIZE; i++) {
+		if(_apy3s_fcache[i].func != NULL) {
+			if(strcmp(_apy3s_fcache[i].name, fname) == 0) {
+				Py_INCREF(_apy3s_fcache[i].func);
+				return _apy3s_fcache[i].func;
+			}
+		} else if(empty < 0) {
+			empty = i;
+		}
+	}
+
+	pFunc = PyObject_GetAttrString(_sr_apy3s_handler_script, fname);
+	/* pFunc is a new reference */
+	if(pFunc == NULL || !PyCallable_Check(pFunc)) {
+		return pFunc;
+	}
+	if(empty >= 0 && strlen(fname) < APY3S_FCACHE_NAME_SIZE) {
+		strcpy(_apy3s_fcache[empty].name, fname);
+		Py_INCREF(pFunc);
+		_apy3s_fcache[empty].func = pFunc;
+	}
+	return pFunc;
+}
+
 /**
  *
  */
@@ -87,9 +152,12 @@ int apy3s_exec_func(sip_msg_t *_msg, char *fname, char *fparam, int emode)
 	}
 	PyErr_Clear();
 
-	if(lock_try(_sr_python_reload_lock) == 0) {
-		if(_sr_python_reload_version
-				&& *_sr_python_reload_version != _sr_python_local_version) {
+	/* take the reload lock only when a new version is pending, so the
+	 * common path does not touch the shared lock at all */
+	if(_sr_python_reload_version
+			&& *_sr_python_reload_version != _sr_python_local_version
+			&& lock_try(_sr_python_reload_lock) == 0) {
+		if(*_sr_python_reload_version != _sr_python_local_version) {
 			LM_INFO("Reloading script %d->%d\n", _sr_python_local_version,
 					*_sr_python_reload_version);
 			if(apy_reload_script()) {
@@ -104,7 +172,7 @@ int apy3s_exec_func(sip_msg_t *_msg, char *fname, char *fparam, int emode)
 	bmsg = _sr_apy_env.msg;
 	_sr_apy_env.msg = _msg;
 
-	pFunc = PyObject_GetAttrString(_sr_apy3s_handler_script, fname);
+	pFunc = apy3s_exec_func_get(fname);
 	/* pFunc is a new reference */
 
 	if(pFunc == NULL || !PyCallable_Check(pFunc)) {
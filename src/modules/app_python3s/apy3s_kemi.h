@@ -33,6 +33,7 @@ int sr_kemi_config_engine_python(
 		sip_msg_t *msg, int rtype, str *rname, str *rparam);
 
 int apy3s_exec_func(sip_msg_t *_msg, char *fname, char *fparam, int emode);
+void apy3s_exec_func_cache_reset(void);
 
 PyObject *sr_apy_kemi_exec_func(PyObject *self, PyObject *args, int idx);
 
@@ -33,6 +33,8 @@
 #include "../../core/timer_proc.h"
 #include "../../core/route_struct.h"
 #include "../../core/async_task.h"
+#include "../../core/rpc.h"
+#include "../../core/rpc_lookup.h"
 #include "../../core/kemi.h"
 #include "../../modules/tm/tm_load.h"
 
@@ -108,6 +110,40 @@ static pv_export_t mod_pvs[] = {
 	{ {0, 0}, 0, 0, 0, 0, 0, 0, 0 }
 };
 
+static void async_rpc_ms_stats(rpc_t *rpc, void *ctx)
+{
+	async_ms_wheel_stats_t st;
+	void *th;
+
+	if(async_ms_wheel_get_stats(&st) < 0) {
+		rpc->fault(ctx, 500, "ms timer not enabled");
+		return;
+	}
+	if(rpc->add(ctx, "{", &th) < 0) {
+		rpc->fault(ctx, 500, "Internal error creating rpc");
+		return;
+	}
+	if(rpc->struct_add(th, "ddLL", "len", st.len, "max_len", st.max_len,
+			   "inserted", (long long)st.inserted, "fired",
+			   (long long)st.fired)
+			< 0) {
+		rpc->fault(ctx, 500, "Internal error creating rpc");
+		return;
+	}
+}
+
+static const char *async_rpc_ms_stats_doc[] = {
+		"Statistics of the millisecond timer wheel: current and highest"
+		" number of parked transactions, inserted and fired timers.",
+		0};
+
+/* clang-format off */
+static rpc_export_t async_rpc_cmds[] = {
+	{"async.ms_stats", async_rpc_ms_stats, async_rpc_ms_stats_doc, 0},
+	{0, 0, 0, 0}
+};
+/* clang-format on */
+
 struct module_exports exports = {
 	"async",
 	DEFAULT_DLFLAGS, /* dlopen flags */
@@ -128,6 +164,11 @@ struct module_exports exports = {
  */
 static int mod_init(void)
 {
+	if(rpc_register_array(async_rpc_cmds) != 0) {
+		LM_ERR("failed to register RPC commands\n");
+		return -1;
+	}
+
 	/* init faked sip msg */
 	if(faked_msg_init() < 0) {
 		LM_ERR("failed to init local sip msg\n");
@@ -65,7 +65,7 @@ typedef struct async_item {
 
 typedef struct async_ms_item {
 	async_task_t *at;
-	struct timeval due;
+	unsigned long long due; /* absolute fire time in milliseconds */
 	struct async_ms_item *next;
 } async_ms_item_t;
 
@@ -75,19 +75,28 @@ typedef struct async_slot {
 	gen_lock_t lock;
 } async_slot_t;
 
-#define ASYNC_RING_SIZE	100
+#define ASYNC_SEC_RING_SIZE 100
 #define MAX_MS_SLEEP 30*1000
-#define MAX_MS_SLEEP_QUEUE 10000
-
-static struct async_ms_list {
-	async_ms_item_t *lstart;
-	async_ms_item_t *lend;
-	int	len;
+#define MAX_MS_SLEEP_QUEUE 100000
+
+/* timer wheel with one slot per millisecond - the span has to be a power
+ * of two larger than MAX_MS_SLEEP, so the items of a slot are all due at
+ * the same tick and insert and fire are O(1) */
+#define ASYNC_MS_WHEEL_SIZE 32768
+#define ASYNC_MS_WHEEL_MASK (ASYNC_MS_WHEEL_SIZE - 1)
+
+static struct async_ms_wheel {
+	async_ms_item_t *slots[ASYNC_MS_WHEEL_SIZE];
+	unsigned long long wticks; /* last drained millisecond */
+	int len;
+	int max_len;
+	unsigned long long inserted;
+	unsigned long long fired;
 	gen_lock_t lock;
-} *_async_ms_list = NULL;
+} *_async_ms_wheel = NULL;
 
 static struct async_list_head {
-	async_slot_t ring[ASYNC_RING_SIZE];
+	async_slot_t ring[ASYNC_SEC_RING_SIZE];
 	async_slot_t *later;
 } *_async_list_head = NULL;
 
@@ -114,7 +123,7 @@ int async_init_timer_list(void)
 		return -1;
 	}
 	memset(_async_list_head, 0, sizeof(struct async_list_head));
-	for(i = 0; i < ASYNC_RING_SIZE; i++) {
+	for(i = 0; i < ASYNC_SEC_RING_SIZE; i++) {
 		if(lock_init(&_async_list_head->ring[i].lock) == 0) {
 			LM_ERR("cannot init lock at %d\n", i);
 			i--;
@@ -131,30 +140,42 @@ int async_init_timer_list(void)
 	return 0;
 }
 
+/**
+ * current time in milliseconds
+ */
+static unsigned long long async_ms_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
 int async_init_ms_timer_list(void)
 {
-	_async_ms_list =
-			(struct async_ms_list *)shm_malloc(sizeof(struct async_ms_list));
-	if(_async_ms_list == NULL) {
+	_async_ms_wheel =
+			(struct async_ms_wheel *)shm_malloc(sizeof(struct async_ms_wheel));
+	if(_async_ms_wheel == NULL) {
 		SHM_MEM_ERROR;
 		return -1;
 	}
-	memset(_async_ms_list, 0, sizeof(struct async_ms_list));
-	if(lock_init(&_async_ms_list->lock) == 0) {
+	memset(_async_ms_wheel, 0, sizeof(struct async_ms_wheel));
+	if(lock_init(&_async_ms_wheel->lock) == 0) {
 		LM_ERR("cannot init lock \n");
-		shm_free(_async_ms_list);
-		_async_ms_list = NULL;
+		shm_free(_async_ms_wheel);
+		_async_ms_wheel = NULL;
 		return -1;
 	}
+	_async_ms_wheel->wticks = async_ms_now();
 	return 0;
 }
 
 int async_destroy_ms_timer_list(void)
 {
-	if(_async_ms_list) {
-		lock_destroy(&_async_ms_list->lock);
-		shm_free(_async_ms_list);
-		_async_ms_list = NULL;
+	if(_async_ms_wheel) {
+		lock_destroy(&_async_ms_wheel->lock);
+		shm_free(_async_ms_wheel);
+		_async_ms_wheel = NULL;
 	}
 	return 0;
 }
@@ -164,7 +185,7 @@ int async_destroy_timer_list(void)
 	int i;
 	if(_async_list_head == NULL)
 		return 0;
-	for(i = 0; i < ASYNC_RING_SIZE; i++) {
+	for(i = 0; i < ASYNC_SEC_RING_SIZE; i++) {
 		/* TODO: clean the list */
 		lock_destroy(&_async_list_head->ring[i].lock);
 	}
@@ -175,40 +196,23 @@ int async_destroy_timer_list(void)
 
 int async_insert_item(async_ms_item_t *ai)
 {
-	struct timeval *due = &ai->due;
+	unsigned int slot;
 
-	if(unlikely(_async_ms_list == NULL))
+	if(unlikely(_async_ms_wheel == NULL))
 		return -1;
-	lock_get(&_async_ms_list->lock);
-	// Check if we want to insert in front
-	if(_async_ms_list->lstart == NULL
-			|| timercmp(due, &_async_ms_list->lstart->due, <=)) {
-		ai->next = _async_ms_list->lstart;
-		_async_ms_list->lstart = ai;
-		if(_async_ms_list->lend == NULL)
-			_async_ms_list->lend = ai;
-	} else {
-		// Check if we want to add to the tail
-		if(_async_ms_list->lend
-				&& timercmp(due, &_async_ms_list->lend->due, >)) {
-			_async_ms_list->lend->next = ai;
-			_async_ms_list->lend = ai;
-		} else {
-			async_ms_item_t *aip;
-			// Find the place to insert into a sorted timer list
-			// Most likely head && tail scanarios are covered above
-			int i = 1;
-			for(aip = _async_ms_list->lstart; aip->next; aip = aip->next, i++) {
-				if(timercmp(due, &aip->next->due, <=)) {
-					ai->next = aip->next;
-					aip->next = ai;
-					break;
-				}
-			}
-		}
-	}
-	_async_ms_list->len++;
-	lock_release(&_async_ms_list->lock);
+	lock_get(&_async_ms_wheel->lock);
+	if(ai->due <= _async_ms_wheel->wticks) {
+		/* already past its slot - fire on the next tick */
+		ai->due = _async_ms_wheel->wticks + 1;
+	}
+	slot = (unsigned int)(ai->due & ASYNC_MS_WHEEL_MASK);
+	ai->next = _async_ms_wheel->slots[slot];
+	_async_ms_wheel->slots[slot] = ai;
+	_async_ms_wheel->len++;
+	_async_ms_wheel->inserted++;
+	if(_async_ms_wheel->len > _async_ms_wheel->max_len)
+		_async_ms_wheel->max_len = _async_ms_wheel->len;
+	lock_release(&_async_ms_wheel->lock);
 	return 0;
 }
 
@@ -224,8 +228,8 @@ int async_sleep(sip_msg_t *msg, int seconds, cfg_action_t *act, str *cbname)
 		LM_ERR("negative or zero sleep time (%d)\n", seconds);
 		return -1;
 	}
-	if(seconds >= ASYNC_RING_SIZE) {
-		LM_ERR("max sleep time is %d sec (%d)\n", ASYNC_RING_SIZE, seconds);
+	if(seconds >= ASYNC_SEC_RING_SIZE) {
+		LM_ERR("max sleep time is %d sec (%d)\n", ASYNC_SEC_RING_SIZE, seconds);
 		return -1;
 	}
 	if(cbname && cbname->len >= ASYNC_CBNAME_SIZE - 1) {
@@ -246,7 +250,7 @@ int async_sleep(sip_msg_t *msg, int seconds, cfg_action_t *act, str *cbname)
 	}
 
 	ticks = seconds + get_ticks();
-	slot = ticks % ASYNC_RING_SIZE;
+	slot = ticks % ASYNC_SEC_RING_SIZE;
 	ai = (async_item_t *)shm_malloc(sizeof(async_item_t));
 	if(ai == NULL) {
 		SHM_MEM_ERROR;
@@ -287,7 +291,7 @@ void async_timer_exec(unsigned int ticks, void *param)
 	if(_async_list_head == NULL)
 		return;
 
-	idx = ticks % ASYNC_RING_SIZE;
+	idx = ticks % ASYNC_SEC_RING_SIZE;
 
 	if(idx == _async_timer_exec_last_slot) {
 		/* timer faster than 1sec */
@@ -297,10 +301,10 @@ void async_timer_exec(unsigned int ticks, void *param)
 	if(_async_timer_exec_last_slot == UINT_MAX) {
 		_async_timer_exec_last_slot = idx;
 	}
-	slot = (_async_timer_exec_last_slot + 1) % ASYNC_RING_SIZE;
+	slot = (_async_timer_exec_last_slot + 1) % ASYNC_SEC_RING_SIZE;
 	if(slot != idx) {
 		LM_DBG("need to catch up from slot %u to %u (slots: %u)\n", slot, idx,
-				ASYNC_RING_SIZE);
+				ASYNC_SEC_RING_SIZE);
 	}
 
 	do {
@@ -332,7 +336,7 @@ void async_timer_exec(unsigned int ticks, void *param)
 		if(slot == idx) {
 			break;
 		}
-		slot = (slot + 1) % ASYNC_RING_SIZE;
+		slot = (slot + 1) % ASYNC_SEC_RING_SIZE;
 	} while(1);
 
 	_async_timer_exec_last_slot = idx;
@@ -340,30 +344,38 @@ void async_timer_exec(unsigned int ticks, void *param)
 
 void async_mstimer_exec(unsigned int ticks, void *param)
 {
-	struct timeval now;
-	gettimeofday(&now, NULL);
+	unsigned long long now;
+	unsigned int steps;
+	unsigned int slot;
+	async_ms_item_t *aip;
+	async_ms_item_t *next;
 
-	if(_async_ms_list == NULL)
+	if(_async_ms_wheel == NULL)
 		return;
-	lock_get(&_async_ms_list->lock);
-
-	async_ms_item_t *aip, *next;
-	int i = 0;
-	for(aip = _async_ms_list->lstart; aip; aip = next, i++) {
-		next = aip->next;
-		if(timercmp(&now, &aip->due, >=)) {
-			if((_async_ms_list->lstart = next) == NULL)
-				_async_ms_list->lend = NULL;
+
+	now = async_ms_now();
+	lock_get(&_async_ms_wheel->lock);
+	steps = 0;
+	while(_async_ms_wheel->wticks < now && steps < ASYNC_MS_WHEEL_SIZE) {
+		_async_ms_wheel->wticks++;
+		steps++;
+		slot = (unsigned int)(_async_ms_wheel->wticks & ASYNC_MS_WHEEL_MASK);
+		aip = _async_ms_wheel->slots[slot];
+		_async_ms_wheel->slots[slot] = NULL;
+		for(; aip != NULL; aip = next) {
+			next = aip->next;
 			if(async_task_push(aip->at) < 0) {
 				shm_free(aip->at);
 			}
-			_async_ms_list->len--;
-			continue;
+			_async_ms_wheel->len--;
+			_async_ms_wheel->fired++;
 		}
-		break;
 	}
-
-	lock_release(&_async_ms_list->lock);
+	/* one turn of the wheel visits every slot - anything further behind
+	 * has been drained already */
+	if(_async_ms_wheel->wticks < now)
+		_async_ms_wheel->wticks = now;
+	lock_release(&_async_ms_wheel->lock);
 
 	return;
 }
@@ -409,8 +421,8 @@ int async_ms_sleep(
 	async_task_param_t *atp;
 	async_task_t *at;
 
-	if(_async_ms_list == NULL) {
-		LM_ERR("async timer list not initialized - check modparams\n");
+	if(_async_ms_wheel == NULL) {
+		LM_ERR("async timer wheel not initialized - check modparams\n");
 		return -1;
 	}
 	if(milliseconds <= 0) {
@@ -421,7 +433,7 @@ int async_ms_sleep(
 		LM_ERR("max sleep time is %d msec\n", MAX_MS_SLEEP);
 		return -1;
 	}
-	if(_async_ms_list->len >= MAX_MS_SLEEP_QUEUE) {
+	if(_async_ms_wheel->len >= MAX_MS_SLEEP_QUEUE) {
 		LM_ERR("max sleep queue length exceeded (%d) \n", MAX_MS_SLEEP_QUEUE);
 		return -1;
 	}
@@ -478,17 +490,29 @@ int async_ms_sleep(
 		atp->cbname_len = cbname->len;
 	}
 
-	struct timeval now, upause;
-	gettimeofday(&now, NULL);
-	upause.tv_sec = milliseconds / 1000;
-	upause.tv_usec = (milliseconds * 1000) % 1000000;
-
-	timeradd(&now, &upause, &ai->due);
+	ai->due = async_ms_now() + milliseconds;
 	async_insert_item(ai);
 
 	return 0;
 }
 
+/**
+ * snapshot of the ms timer wheel counters - returns -1 when the ms timer
+ * is not enabled
+ */
+int async_ms_wheel_get_stats(async_ms_wheel_stats_t *st)
+{
+	if(_async_ms_wheel == NULL)
+		return -1;
+	lock_get(&_async_ms_wheel->lock);
+	st->len = _async_ms_wheel->len;
+	st->max_len = _async_ms_wheel->max_len;
+	st->inserted = _async_ms_wheel->inserted;
+	st->fired = _async_ms_wheel->fired;
+	lock_release(&_async_ms_wheel->lock);
+	return 0;
+}
+
 /**
  *
  */
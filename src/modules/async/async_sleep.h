@@ -50,6 +50,15 @@ int async_ms_sleep(
 		sip_msg_t *msg, int milliseconds, cfg_action_t *act, str *cbname);
 void async_mstimer_exec(unsigned int ticks, void *param);
 
+typedef struct async_ms_wheel_stats {
+	int len;
+	int max_len;
+	unsigned long long inserted;
+	unsigned long long fired;
+} async_ms_wheel_stats_t;
+
+int async_ms_wheel_get_stats(async_ms_wheel_stats_t *st);
+
 int async_send_task(sip_msg_t *msg, cfg_action_t *act, str *cbname, str *gname);
 int async_send_data(cfg_action_t *act, str *cbname, str *gname, str *sdata);
 
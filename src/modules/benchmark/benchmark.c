@@ -244,6 +244,8 @@ void bm_reset_timer(int i)
 	bm_mycfg->tindex[i]->period_sum = 0;
 	bm_mycfg->tindex[i]->period_max = 0;
 	bm_mycfg->tindex[i]->period_min = 0xffffffff;
+	memset(bm_mycfg->tindex[i]->hist, 0,
+			BM_HIST_BUCKETS * sizeof(unsigned long long));
 }
 
 void reset_timers(void)
@@ -325,6 +327,7 @@ int _bm_log_timer(unsigned int id)
 	bm_mycfg->tindex[id]->sum += tdiff;
 	bm_mycfg->tindex[id]->last_sum += tdiff;
 	bm_mycfg->tindex[id]->calls++;
+	bm_mycfg->tindex[id]->hist[bm_hist_bucket(tdiff)]++;
 
 	if(tdiff < bm_mycfg->tindex[id]->last_min)
 		bm_mycfg->tindex[id]->last_min = tdiff;
@@ -773,6 +776,101 @@ void bm_rpc_timer_name_list(rpc_t *rpc, void *ctx)
 	return;
 }
 
+/**
+ * Upper bound estimate of a percentile (given in permille) from the
+ * log2 histogram of a timer.
+ */
+static unsigned long long bm_hist_percentile(
+		unsigned long long *hist, unsigned long long total, int permille)
+{
+	unsigned long long rank, acc = 0;
+	int b;
+
+	if(total == 0)
+		return 0;
+
+	rank = (total * permille + 999) / 1000;
+	for(b = 0; b < BM_HIST_BUCKETS; b++) {
+		acc += hist[b];
+		if(acc >= rank)
+			return (2ULL << b) - 1;
+	}
+	return 0;
+}
+
+void bm_rpc_timer_hist(rpc_t *rpc, void *ctx)
+{
+	char *name = NULL;
+	int reset = 0;
+	unsigned int id = 0;
+	unsigned long long hist[BM_HIST_BUCKETS];
+	unsigned long long total = 0;
+	void *handle;
+	int b, len;
+	static int permilles[4] = {500, 950, 990, 999};
+	static char *pnames[4] = {"p50", "p95", "p99", "p999"};
+
+	if(rpc->scan(ctx, "s", &name) < 1) {
+		LM_WARN("invalid timer name\n");
+		rpc->fault(ctx, 400, "Invalid timer name");
+		return;
+	}
+	rpc->scan(ctx, "*d", &reset);
+
+	if(_bm_register_timer(name, 0, &id) != 0) {
+		rpc->fault(ctx, 500, "Register timer failure");
+		return;
+	}
+
+	/* snapshot the histogram and, when asked to, reset it in the same
+	 * step so no sample is counted in two reports */
+	memcpy(hist, bm_mycfg->tindex[id]->hist, sizeof(hist));
+	if(reset != 0)
+		memset(bm_mycfg->tindex[id]->hist, 0, sizeof(hist));
+
+	for(b = 0; b < BM_HIST_BUCKETS; b++)
+		total += hist[b];
+
+	if(rpc->add(ctx, "{", &handle) < 0)
+		return;
+
+	if(rpc->struct_add(handle, "s", "name", bm_mycfg->tindex[id]->name) < 0)
+		return;
+
+	len = snprintf(buffer_s, BUFFER_S_LEN, "%llu", total);
+	if(len <= 0 || len >= BUFFER_S_LEN) {
+		LM_ERR("Buffer overflow\n");
+		return;
+	}
+	if(rpc->struct_add(handle, "s", "samples", buffer_s) < 0)
+		return;
+
+	for(b = 0; b < 4; b++) {
+		len = snprintf(buffer_s, BUFFER_S_LEN, "%llu",
+				bm_hist_percentile(hist, total, permilles[b]));
+		if(len <= 0 || len >= BUFFER_S_LEN) {
+			LM_ERR("Buffer overflow\n");
+			return;
+		}
+		if(rpc->struct_add(handle, "s", pnames[b], buffer_s) < 0)
+			return;
+	}
+
+	for(b = 0; b < BM_HIST_BUCKETS; b++) {
+		if(hist[b] == 0)
+			continue;
+		len = snprintf(buffer_s, BUFFER_S_LEN, "le_%llu", (2ULL << b) - 1);
+		if(len <= 0 || len >= BUFFER_S_LEN) {
+			LM_ERR("Buffer overflow\n");
+			return;
+		}
+		if(rpc->struct_printf(handle, buffer_s, "%llu", hist[b]) < 0)
+			return;
+	}
+
+	return;
+}
+
 static const char *bm_rpc_enable_global_doc[2] = {
 		"Enable/disable benchmarking", 0};
 
@@ -789,6 +887,11 @@ static const char *bm_rpc_timer_list_doc[2] = {"List all timers", 0};
 static const char *bm_rpc_timer_name_list_doc[2] = {
 		"List a timer based on its name", 0};
 
+static const char *bm_rpc_timer_hist_doc[2] = {
+		"Dump the latency histogram and percentiles of a timer, optionally "
+		"resetting it. Usage: benchmark.timer_hist name [reset]",
+		0};
+
 rpc_export_t bm_rpc_cmds[] = {{"benchmark.enable_global", bm_rpc_enable_global,
 									  bm_rpc_enable_global_doc, 0},
 		{"benchmark.enable_timer", bm_rpc_enable_timer, bm_rpc_enable_timer_doc,
@@ -799,6 +902,7 @@ rpc_export_t bm_rpc_cmds[] = {{"benchmark.enable_global", bm_rpc_enable_global,
 		{"benchmark.timer_list", bm_rpc_timer_list, bm_rpc_timer_list_doc, 0},
 		{"benchmark.timer_name_list", bm_rpc_timer_name_list,
 				bm_rpc_timer_name_list_doc, 0},
+		{"benchmark.timer_hist", bm_rpc_timer_hist, bm_rpc_timer_hist_doc, 0},
 		{0, 0, 0, 0}};
 
 /**
@@ -46,6 +46,10 @@
 
 #define BM_NAME_LEN 32
 
+/* log2 histogram buckets - bucket b counts timings with
+ * 2^b <= tdiff < 2^(b+1), last bucket takes the rest */
+#define BM_HIST_BUCKETS 28
+
 #ifdef BM_CLOCK_REALTIME
 /* nano seconds */
 typedef struct timespec bm_timeval_t;
@@ -72,6 +76,8 @@ typedef struct benchmark_timer
 			period_sum; /* Sum for last completed period (between granularity) */
 	unsigned long long period_max; /* Maximum for last completed period ... */
 	unsigned long long period_min; /* Minimum for last completed period ... */
+	unsigned long long
+			hist[BM_HIST_BUCKETS]; /* log2 histogram of all timings */
 	struct benchmark_timer *next;
 } benchmark_timer_t;
 
@@ -106,4 +112,15 @@ static inline unsigned long long bm_diff_time(
 	return tdiff;
 }
 
+static inline int bm_hist_bucket(unsigned long long tdiff)
+{
+	int b = 0;
+
+	while(tdiff > 1 && b < BM_HIST_BUCKETS - 1) {
+		tdiff >>= 1;
+		b++;
+	}
+	return b;
+}
+
 #endif /* _BENCHMARK_MOD_H_ */
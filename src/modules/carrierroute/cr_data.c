@@ -442,7 +442,7 @@ static struct domain_data_t *get_domain_data_or_add(struct route_data_t *rd,
 			destroy_domain_data(domain_data);
 			return NULL;
 		}
-		LM_INFO("added domain %d '%.*s' to carrier %d '%.*s'", domain_id,
+		LM_DBG("added domain %d '%.*s' to carrier %d '%.*s'", domain_id,
 				domain_name->len, domain_name->s, carrier_data->id,
 				carrier_data->name->len, carrier_data->name->s);
 	}
@@ -490,7 +490,7 @@ int add_route(struct route_data_t *rd, int carrier_id, int domain_id,
 {
 	struct carrier_data_t *carrier_data = NULL;
 	struct domain_data_t *domain_data = NULL;
-	LM_INFO("adding prefix %.*s, prob %f\n", scan_prefix->len, scan_prefix->s,
+	LM_DBG("adding prefix %.*s, prob %f\n", scan_prefix->len, scan_prefix->s,
 			prob);
 
 	if((carrier_data = get_carrier_data(rd, carrier_id)) == NULL) {
@@ -506,7 +506,7 @@ int add_route(struct route_data_t *rd, int carrier_id, int domain_id,
 	}
 	domain_data->sum_prob = domain_data->sum_prob + prob;
 
-	LM_INFO("found carrier and domain, now adding route\n");
+	LM_DBG("found carrier and domain, now adding route\n");
 	return add_route_to_tree(domain_data->tree, scan_prefix, flags, mask,
 			scan_prefix, max_targets, prob, rewrite_hostpart, strip,
 			rewrite_local_prefix, rewrite_local_suffix, status, hash_index,
@@ -539,7 +539,7 @@ int add_failure_route(struct route_data_t *rd, int carrier_id, int domain_id,
 {
 	struct carrier_data_t *carrier_data = NULL;
 	struct domain_data_t *domain_data = NULL;
-	LM_INFO("adding prefix %.*s, reply code %.*s\n", scan_prefix->len,
+	LM_DBG("adding prefix %.*s, reply code %.*s\n", scan_prefix->len,
 			scan_prefix->s, reply_code->len, reply_code->s);
 
 	if(reply_code->len != 3) {
@@ -558,7 +558,7 @@ int add_failure_route(struct route_data_t *rd, int carrier_id, int domain_id,
 		return -1;
 	}
 
-	LM_INFO("found carrier and domain, now adding failure route\n");
+	LM_DBG("found carrier and domain, now adding failure route\n");
 	return add_failure_route_to_tree(domain_data->failure_tree, scan_prefix,
 			scan_prefix, host, reply_code, flags, mask, next_domain_id,
 			comment);
@@ -653,7 +653,7 @@ static int rule_fixup_recursor(struct dtrie_node_t *node)
 						return -1;
 					}
 					rf->rules[rr->hash_index - 1] = rr;
-					LM_INFO("rule with host %.*s hash has hashindex %i.\n",
+					LM_DBG("rule with host %.*s hash has hashindex %i.\n",
 							rr->host.len, rr->host.s, rr->hash_index);
 				}
 			}
@@ -667,7 +667,7 @@ static int rule_fixup_recursor(struct dtrie_node_t *node)
 					} else {
 						rf->rules[i] = rr;
 						rr->hash_index = i + 1;
-						LM_INFO("hashless rule with host %.*s hash, hash_index "
+						LM_DBG("hashless rule with host %.*s hash, hash_index "
 								"%i\n",
 								rr->host.len, rr->host.s, i + 1);
 						rr = rr->next;
@@ -711,7 +711,7 @@ int rule_fixup(struct route_data_t *rd)
 		for(j = 0; j < rd->carriers[i]->domain_num; j++) {
 			if(rd->carriers[i]->domains[j]
 					&& rd->carriers[i]->domains[j]->tree) {
-				LM_INFO("fixing tree %.*s\n",
+				LM_DBG("fixing tree %.*s\n",
 						rd->carriers[i]->domains[j]->name->len,
 						rd->carriers[i]->domains[j]->name->s);
 				if(rule_fixup_recursor(rd->carriers[i]->domains[j]->tree) < 0) {
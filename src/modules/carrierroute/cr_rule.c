@@ -119,7 +119,7 @@ int add_route_rule(struct route_flags *rf, const str *prefix, int max_targets,
 	shm_rr->backed_up = NULL;
 	t_bu = backed_up;
 	if(!backed_up) {
-		LM_INFO("no backed up rules\n");
+		LM_DBG("no backed up rules\n");
 	}
 	while(t_bu && *t_bu != -1) {
 		if((t_rl = shm_malloc(sizeof(struct route_rule_p_list))) == NULL) {
@@ -38,10 +38,12 @@ void check_calls_by_money(unsigned int ticks, void *param)
 	call_t *tmp_call = NULL;
 	int i;
 
-	cnxcc_lock(_data.money.lock);
-
 	if(_data.money.credit_data_by_client->table)
-		for(i = 0; i < _data.money.credit_data_by_client->size; i++)
+		for(i = 0; i < _data.money.credit_data_by_client->size; i++) {
+			/* hold the table lock one bucket at a time, so call setups and
+			 * teardowns of clients hashed elsewhere are not serialized
+			 * behind the whole sweep */
+			cnxcc_lock(_data.money.lock);
 			clist_foreach_safe(&_data.money.credit_data_by_client->table[i],
 					h_entry, tmp, next)
 			{
@@ -147,8 +149,8 @@ void check_calls_by_money(unsigned int ticks, void *param)
 
 				cnxcc_unlock(credit_data->lock);
 			}
-
-	cnxcc_unlock(_data.money.lock);
+			cnxcc_unlock(_data.money.lock);
+		}
 }
 
 void check_calls_by_time(unsigned int ticks, void *param)
@@ -158,10 +160,10 @@ void check_calls_by_time(unsigned int ticks, void *param)
 	call_t *tmp_call = NULL;
 	int i;
 
-	cnxcc_lock(_data.time.lock);
-
 	if(_data.time.credit_data_by_client->table)
-		for(i = 0; i < _data.time.credit_data_by_client->size; i++)
+		for(i = 0; i < _data.time.credit_data_by_client->size; i++) {
+			/* lock the table one bucket at a time, see check_calls_by_money() */
+			cnxcc_lock(_data.time.lock);
 			clist_foreach_safe(&_data.time.credit_data_by_client->table[i],
 					h_entry, tmp, next)
 			{
@@ -243,6 +245,6 @@ void check_calls_by_time(unsigned int ticks, void *param)
 
 				cnxcc_unlock(credit_data->lock);
 			}
-
-	cnxcc_unlock(_data.time.lock);
+			cnxcc_unlock(_data.time.lock);
+		}
 }
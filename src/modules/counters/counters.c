@@ -85,6 +85,12 @@ static void cnt_grp_get_all_rpc(rpc_t *rpc, void *ctx);
 static const char *cnt_grp_get_all_doc[] = {
 		"list all counter names and values in a specified group", 0};
 
+static void cnt_fetch_rpc(rpc_t *rpc, void *ctx);
+static const char *cnt_fetch_doc[] = {
+		"get the values of several counters in one call (takes a list of"
+		" [group.]name parameters)",
+		0};
+
 static void cnt_help_rpc(rpc_t *rpc, void *ctx);
 static const char *cnt_help_doc[] = {
 		"print the description of a counter (group and counter name required).",
@@ -100,6 +106,7 @@ static rpc_export_t counters_rpc[] = {{"cnt.get", cnt_get_rpc, cnt_get_doc, 0},
 		{"cnt.var_list", cnt_var_list_rpc, cnt_var_list_doc, RET_ARRAY},
 		{"cnt.get_vars", cnt_grp_get_all_rpc, cnt_grp_get_all_doc, 0},
 		{"cnt.grp_get_all", cnt_grp_get_all_rpc, cnt_grp_get_all_doc, 0},
+		{"cnt.fetch", cnt_fetch_rpc, cnt_fetch_doc, 0},
 		{"cnt.help", cnt_help_rpc, cnt_help_doc, 0}, {0, 0, 0, 0}};
 
 
@@ -473,6 +480,40 @@ static void cnt_grp_get_all_rpc(rpc_t *rpc, void *c)
 }
 
 
+/* bulk counter get: each parameter is a [grp.]name counter id and all the
+ * values are returned in one struct, so pollers reading many counters need
+ * a single round-trip instead of one cnt.get per counter */
+static void cnt_fetch_rpc(rpc_t *rpc, void *c)
+{
+	char *arg;
+	char *name;
+	char *grp;
+	char *p;
+	void *s;
+	counter_handle_t h;
+
+	if(rpc->add(c, "{", &s) < 0)
+		return;
+	while(rpc->scan(c, "*s", &arg) > 0) {
+		name = arg;
+		grp = cnt_script_grp; /* default group */
+		if((p = strchr(name, '.')) != 0) {
+			/* found group */
+			grp = name;
+			name = p + 1;
+			*p = 0;
+		}
+		if(counter_lookup(&h, grp, name) < 0) {
+			rpc->fault(c, 400, "non-existent counter %s.%s\n", grp, name);
+			return;
+		}
+		if(p)
+			*p = '.'; /* restore the full id for the reply member name */
+		rpc->struct_add(s, "d", arg, (int)counter_get_val(h));
+	}
+}
+
+
 static void cnt_help_rpc(rpc_t *rpc, void *ctx)
 {
 	char *group;
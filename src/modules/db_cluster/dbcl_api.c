@@ -46,7 +46,9 @@ extern int dbcl_max_query_length;
 		int i;                                                                 \
 		int j;                                                                 \
 		int k;                                                                 \
+		int lidx[DBCL_CLIST_SIZE];                                             \
 		unsigned int sec = 0;                                                  \
+		struct timeval ltv;                                                    \
 		db1_con_t *dbh = NULL;                                                 \
 		dbcl_cls_t *cls = NULL;                                                \
 		cls = (dbcl_cls_t *)_h->tail;                                          \
@@ -125,6 +127,43 @@ extern int dbcl_max_query_length;
 						}                                                      \
 					}                                                          \
 					break;                                                     \
+				case 'l':                                                      \
+				case 'L':                                                      \
+					dbcl_sort_by_latency(&cls->rlist[i], lidx);                \
+					for(k = 0; k < cls->rlist[i].clen; k++) {                  \
+						j = lidx[k];                                           \
+						if(dbcl_valid_con(cls->rlist[i].clist[j]) == 0) {      \
+							LM_DBG("latency operation - cluster [%.*s] "       \
+								   "(%d/%d)\n",                                \
+									cls->name.len, cls->name.s, i, j);         \
+							sec = get_ticks();                                 \
+							dbh = cls->rlist[i].clist[j]->dbh;                 \
+							if(cls->rlist[i].clist[j]->dbf.qfunc == NULL) {    \
+								LM_ERR("unsupported command by db "            \
+									   "connector\n");                         \
+								return -1;                                     \
+							}                                                  \
+							dbcl_lat_start(&ltv);                              \
+							ret = cls->rlist[i].clist[j]->dbf.command;         \
+							dbcl_lat_update(cls->rlist[i].clist[j], &ltv);     \
+							if(ret == 0) {                                     \
+								cls->usedcon = cls->rlist[i].clist[j];         \
+								return 0;                                      \
+							} else {                                           \
+								LM_WARN("latency operation - failure on "      \
+										"cluster"                              \
+										" [%.*s] (%d/%d) [%.*s]\n",            \
+										cls->name.len, cls->name.s, i, j,      \
+										cls->rlist[i].clist[j]->name.len,      \
+										cls->rlist[i].clist[j]->name.s);       \
+								sec = get_ticks() - sec;                       \
+								if(sec >= dbcl_max_query_length) {             \
+									dbcl_inactive_con(cls->rlist[i].clist[j]); \
+								}                                              \
+							}                                                  \
+						}                                                      \
+					}                                                          \
+					break;                                                     \
 				default:                                                       \
 					LM_ERR("invalid mode %c (%d)\n", cls->rlist[i].mode,       \
 							cls->rlist[i].mode);                               \
@@ -144,7 +183,9 @@ extern int dbcl_max_query_length;
 		int i;                                                                 \
 		int j;                                                                 \
 		int k;                                                                 \
+		int lidx[DBCL_CLIST_SIZE];                                             \
 		unsigned int sec = 0;                                                  \
+		struct timeval ltv;                                                    \
 		db1_con_t *dbh = NULL;                                                 \
 		dbcl_cls_t *cls = NULL;                                                \
 		cls = (dbcl_cls_t *)_h->tail;                                          \
@@ -261,6 +302,43 @@ extern int dbcl_max_query_length;
 					if(rok == 1 && cls->wlist[i].clen > 0)                     \
 						return 0;                                              \
 					break;                                                     \
+				case 'l':                                                      \
+				case 'L':                                                      \
+					dbcl_sort_by_latency(&cls->wlist[i], lidx);                \
+					for(k = 0; k < cls->wlist[i].clen; k++) {                  \
+						j = lidx[k];                                           \
+						if(dbcl_valid_con(cls->wlist[i].clist[j]) == 0) {      \
+							LM_DBG("latency operation - cluster [%.*s] "       \
+								   "(%d/%d)\n",                                \
+									cls->name.len, cls->name.s, i, j);         \
+							sec = get_ticks();                                 \
+							dbh = cls->wlist[i].clist[j]->dbh;                 \
+							if(cls->wlist[i].clist[j]->dbf.qfunc == NULL) {    \
+								LM_ERR("unsupported command by db "            \
+									   "connector\n");                         \
+								return -1;                                     \
+							}                                                  \
+							dbcl_lat_start(&ltv);                              \
+							ret = cls->wlist[i].clist[j]->dbf.command;         \
+							dbcl_lat_update(cls->wlist[i].clist[j], &ltv);     \
+							if(ret == 0) {                                     \
+								cls->usedcon = cls->wlist[i].clist[j];         \
+								return 0;                                      \
+							} else {                                           \
+								LM_WARN("latency operation - failure on "      \
+										"cluster"                              \
+										" [%.*s] (%d/%d) [%.*s]\n",            \
+										cls->name.len, cls->name.s, i, j,      \
+										cls->wlist[i].clist[j]->name.len,      \
+										cls->wlist[i].clist[j]->name.s);       \
+								sec = get_ticks() - sec;                       \
+								if(sec >= dbcl_max_query_length) {             \
+									dbcl_inactive_con(cls->wlist[i].clist[j]); \
+								}                                              \
+							}                                                  \
+						}                                                      \
+					}                                                          \
+					break;                                                     \
 				default:                                                       \
 					LM_ERR("invalid mode %c (%d)\n", cls->rlist[i].mode,       \
 							cls->rlist[i].mode);                               \
@@ -281,7 +359,9 @@ extern int dbcl_max_query_length;
 		int i;                                                                 \
 		int j;                                                                 \
 		int k;                                                                 \
+		int lidx[DBCL_CLIST_SIZE];                                             \
 		unsigned int sec = 0;                                                  \
+		struct timeval ltv;                                                    \
 		db1_con_t *dbh = NULL;                                                 \
 		dbcl_cls_t *cls = NULL;                                                \
 		cls = (dbcl_cls_t *)_h->tail;                                          \
@@ -416,6 +496,49 @@ extern int dbcl_max_query_length;
 					if(rok == 1 && cls->wlist[i].clen > 0)                     \
 						return 0;                                              \
 					break;                                                     \
+				case 'l':                                                      \
+				case 'L':                                                      \
+					dbcl_sort_by_latency(&cls->wlist[i], lidx);                \
+					for(k = 0; k < cls->wlist[i].clen; k++) {                  \
+						j = lidx[k];                                           \
+						if(dbcl_valid_con(cls->wlist[i].clist[j]) == 0) {      \
+							LM_DBG("latency operation - cluster [%.*s] "       \
+								   "(%d/%d)\n",                                \
+									cls->name.len, cls->name.s, i, j);         \
+							sec = get_ticks();                                 \
+							dbh = cls->wlist[i].clist[j]->dbh;                 \
+							dbcl_lat_start(&ltv);                              \
+							if(cls->wlist[i].clist[j]->dbf.qfuncx == NULL) {   \
+								if(cls->wlist[i].clist[j]->dbf.qfunc           \
+										== NULL) {                             \
+									LM_ERR("unsupported command by db "        \
+										   "connector\n");                     \
+									return -1;                                 \
+								} else {                                       \
+									ret = cls->wlist[i].clist[j]->dbf.command; \
+								}                                              \
+							} else {                                           \
+								ret = cls->wlist[i].clist[j]->dbf.commandx;    \
+							}                                                  \
+							dbcl_lat_update(cls->wlist[i].clist[j], &ltv);     \
+							if(ret == 0) {                                     \
+								cls->usedcon = cls->wlist[i].clist[j];         \
+								return 0;                                      \
+							} else {                                           \
+								LM_WARN("latency operation - failure on "      \
+										"cluster"                              \
+										" [%.*s] (%d/%d) [%.*s]\n",            \
+										cls->name.len, cls->name.s, i, j,      \
+										cls->wlist[i].clist[j]->name.len,      \
+										cls->wlist[i].clist[j]->name.s);       \
+								sec = get_ticks() - sec;                       \
+								if(sec >= dbcl_max_query_length) {             \
+									dbcl_inactive_con(cls->wlist[i].clist[j]); \
+								}                                              \
+							}                                                  \
+						}                                                      \
+					}                                                          \
+					break;                                                     \
 				default:                                                       \
 					LM_ERR("invalid mode %c (%d)\n", cls->rlist[i].mode,       \
 							cls->rlist[i].mode);                               \
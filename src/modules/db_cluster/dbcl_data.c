@@ -154,6 +154,66 @@ int dbcl_inactive_con(dbcl_con_t *sc)
 	return 0;
 }
 
+/**
+ * start a latency sample for a query on a cluster connection
+ */
+void dbcl_lat_start(struct timeval *tv)
+{
+	gettimeofday(tv, NULL);
+}
+
+/**
+ * fold the finished latency sample into the moving average of the
+ * connection, kept in shared memory so all workers steer on the same
+ * view of the backends
+ */
+void dbcl_lat_update(dbcl_con_t *sc, struct timeval *tv)
+{
+	struct timeval now;
+	unsigned int us;
+
+	if(sc == NULL || sc->sinfo == NULL)
+		return;
+	gettimeofday(&now, NULL);
+	us = (unsigned int)((now.tv_sec - tv->tv_sec) * 1000000L
+						+ (now.tv_usec - tv->tv_usec));
+	/* unlocked exponential moving average (alpha 1/4) - a lost update
+	 * costs only one sample, not worth a lock on the query path */
+	if(sc->sinfo->lat_ewma == 0)
+		sc->sinfo->lat_ewma = us;
+	else
+		sc->sinfo->lat_ewma = (3 * sc->sinfo->lat_ewma + us) / 4;
+}
+
+static unsigned int dbcl_con_latency(dbcl_con_t *sc)
+{
+	return (sc != NULL && sc->sinfo != NULL) ? sc->sinfo->lat_ewma : 0;
+}
+
+/**
+ * order the connections of a priority slot by ascending latency
+ * average - idx is filled with the positions in clist. Connections
+ * without a sample yet sort first so every backend gets measured.
+ */
+void dbcl_sort_by_latency(dbcl_cdata_t *cdata, int *idx)
+{
+	int i, j, t;
+
+	for(i = 0; i < cdata->clen; i++)
+		idx[i] = i;
+	/* insertion sort - lists have at most DBCL_CLIST_SIZE entries */
+	for(i = 1; i < cdata->clen; i++) {
+		for(j = i; j > 0; j--) {
+			if(dbcl_con_latency(cdata->clist[idx[j - 1]])
+					<= dbcl_con_latency(cdata->clist[idx[j]]))
+				break;
+			t = idx[j];
+			idx[j] = idx[j - 1];
+			idx[j - 1] = t;
+		}
+	}
+}
+
 int dbcl_disable_con(dbcl_con_t *sc, int seconds)
 {
 	LM_INFO("disable connection [%.*s] for %d seconds\n", sc->name.len,
@@ -271,7 +331,8 @@ int dbcl_cls_set_connections(dbcl_cls_t *cls, str *cons)
 			goto error;
 		}
 		i = s.s[0] - '0';
-		if(s.s[1] != 's' && s.s[1] != 'S' && s.s[1] != 'r' && s.s[1] != 'R') {
+		if(s.s[1] != 's' && s.s[1] != 'S' && s.s[1] != 'r' && s.s[1] != 'R'
+				&& s.s[1] != 'l' && s.s[1] != 'L') {
 			LM_ERR("invalid parameter [%.*s] for connection id [%.*s]\n",
 					pit->body.len, pit->body.s, pit->name.len, pit->name.s);
 			goto error;
@@ -296,7 +357,8 @@ int dbcl_cls_set_connections(dbcl_cls_t *cls, str *cons)
 		}
 		i = s.s[2] - '0';
 		if(s.s[3] != 's' && s.s[3] != 'S' && s.s[3] != 'r' && s.s[3] != 'R'
-				&& s.s[3] != 'p' && s.s[3] != 'P') {
+				&& s.s[3] != 'p' && s.s[3] != 'P' && s.s[3] != 'l'
+				&& s.s[3] != 'L') {
 			LM_ERR("invalid parameter [%.*s] for connection id [%.*s]\n",
 					pit->body.len, pit->body.s, pit->name.len, pit->name.s);
 			goto error;
@@ -33,6 +33,8 @@
 #define _DBCL_DATA_H_
 
 
+#include <sys/time.h>
+
 #include "../../lib/srdb1/db.h"
 #include "../../core/str.h"
 
@@ -45,6 +47,7 @@ typedef struct dbcl_shared
 {
 	int state;
 	unsigned int aticks;
+	unsigned int lat_ewma; /*!< moving average of query latency (microsec) */
 } dbcl_shared_t;
 
 typedef struct dbcl_con
@@ -90,6 +93,9 @@ dbcl_con_t *dbcl_get_connection_root();
 
 int dbcl_valid_con(dbcl_con_t *sc);
 int dbcl_inactive_con(dbcl_con_t *sc);
+void dbcl_lat_start(struct timeval *tv);
+void dbcl_lat_update(dbcl_con_t *sc, struct timeval *tv);
+void dbcl_sort_by_latency(dbcl_cdata_t *cdata, int *idx);
 int dbcl_disable_con(dbcl_con_t *sc, int seconds);
 int dbcl_enable_con(dbcl_con_t *sc);
 
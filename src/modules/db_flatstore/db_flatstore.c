@@ -64,6 +64,20 @@ str flat_pid = STR_NULL;
 /** Enable/disable flushing after eaach write. */
 int flat_flush = 1;
 
+/** Group commit interval in milliseconds.
+ * When set to a value greater than zero and flushing is enabled, rows are
+ * flushed to the file at most once within this interval instead of after
+ * every write.
+ */
+int flat_flush_time = 0;
+
+/** Size of the per-file write buffer in bytes.
+ * When set to a value greater than zero, each file gets a write buffer of
+ * this size, so buffered rows go to the kernel in one large write instead
+ * of many small ones.
+ */
+int flat_flush_size = 0;
+
 /** Escape delimiter using
  * ""%" HEX HEX" mechanism for escaping from RFC 2396
  *  */
@@ -119,6 +133,8 @@ static cmd_export_t cmds[] = {{"db_uri", (cmd_function)flat_uri, 0, 0, 0, 0},
 
 /* Exported parameters */
 static param_export_t params[] = {{"flush", PARAM_INT, &flat_flush},
+		{"flush_time", PARAM_INT, &flat_flush_time},
+		{"flush_size", PARAM_INT, &flat_flush_size},
 		{"encode_delimiter", PARAM_INT, &encode_delimiter},
 		{"field_delimiter", PARAM_STR, &flat_delimiter},
 		{"record_delimiter", PARAM_STR, &flat_record_delimiter},
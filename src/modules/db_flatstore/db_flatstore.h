@@ -39,6 +39,8 @@
 
 extern str flat_pid;
 extern int flat_flush;
+extern int flat_flush_time;
+extern int flat_flush_size;
 extern str flat_record_delimiter;
 extern str flat_delimiter;
 extern str flat_escape;
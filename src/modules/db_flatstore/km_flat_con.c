@@ -29,6 +29,7 @@
 #include "../../core/ut.h"
 #include "km_flatstore_mod.h"
 #include "km_flat_con.h"
+#include "db_flatstore.h"
 
 #define FILE_SUFFIX ".log"
 #define FILE_SUFFIX_LEN (sizeof(FILE_SUFFIX) - 1)
@@ -128,6 +129,18 @@ struct flat_con *flat_new_connection(struct flat_id *id)
 		return 0;
 	}
 
+	if(flat_flush_size > 0) {
+		res->buf = pkg_malloc(flat_flush_size);
+		if(!res->buf) {
+			PKG_MEM_ERROR;
+			fclose(res->file);
+			pkg_free(res);
+			return 0;
+		}
+		setvbuf(res->file, res->buf, _IOFBF, flat_flush_size);
+	}
+	gettimeofday(&res->ftime, NULL);
+
 	return res;
 }
 
@@ -144,6 +157,8 @@ void flat_free_connection(struct flat_con *con)
 	if(con->file) {
 		fclose(con->file);
 	}
+	if(con->buf)
+		pkg_free(con->buf);
 	pkg_free(con);
 }
 
@@ -177,6 +192,12 @@ int flat_reopen_connection(struct flat_con *con)
 			LM_ERR("invalid parameter value\n");
 			return -1;
 		}
+
+		/* the buffer of the old file was flushed by fclose() - rearm it
+		 * on the new file */
+		if(con->buf)
+			setvbuf(con->file, con->buf, _IOFBF, flat_flush_size);
+		gettimeofday(&con->ftime, NULL);
 	}
 
 	return 0;
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <time.h>
+#include <sys/time.h>
 #include "km_flat_id.h"
 
 struct flat_con
@@ -34,6 +35,8 @@ struct flat_con
 	struct flat_id *id;	   /* Connection identifier */
 	int ref;			   /* Reference count */
 	FILE *file;			   /* File descriptor structure */
+	char *buf;			   /* Write buffer when flush_size is set */
+	struct timeval ftime;  /* Time of the last flush */
 	struct flat_con *next; /* Next connection in the pool */
 };
 
@@ -41,7 +44,8 @@ struct flat_con
 /*
  * Some convenience wrappers
  */
-#define CON_FILE(db_con) (((struct flat_con *)((db_con)->tail))->file)
+#define CON_FLAT(db_con) ((struct flat_con *)((db_con)->tail))
+#define CON_FILE(db_con) (CON_FLAT(db_con)->file)
 
 
 /*
@@ -154,6 +154,7 @@ int flat_db_insert(
 	int i;
 	int l;
 	char *s, *p;
+	struct timeval tv;
 
 	if(km_local_timestamp < *km_flat_rotate) {
 		flat_rotate_logs();
@@ -244,7 +245,19 @@ int flat_db_insert(
 	fprintf(f, "\n");
 
 	if(flat_flush) {
-		fflush(f);
+		if(flat_flush_time > 0) {
+			/* group commit - flush at most once per flush_time interval,
+			 * buffered rows in between go out in one write */
+			gettimeofday(&tv, NULL);
+			if((tv.tv_sec - CON_FLAT(h)->ftime.tv_sec) * 1000
+							+ (tv.tv_usec - CON_FLAT(h)->ftime.tv_usec) / 1000
+					>= flat_flush_time) {
+				fflush(f);
+				CON_FLAT(h)->ftime = tv;
+			}
+		} else {
+			fflush(f);
+		}
 	}
 
 	return 0;
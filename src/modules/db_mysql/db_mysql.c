@@ -101,6 +101,7 @@ static param_export_t params[] = {
 		{"timeout_interval", PARAM_INT, &db_mysql_timeout_interval},
 		{"auto_reconnect", PARAM_INT, &db_mysql_auto_reconnect},
 		{"insert_delayed", PARAM_INT, &db_mysql_insert_all_delayed},
+		{"insert_stmt", PARAM_INT, &db_mysql_insert_all_stmt},
 		{"update_affected_found", PARAM_INT, &db_mysql_update_affected_found},
 		{"unsigned_type", PARAM_INT, &db_mysql_unsigned_type},
 		{"opt_ssl_ca", PARAM_STRING, &db_mysql_opt_ssl_ca},
@@ -45,6 +45,7 @@
 unsigned int db_mysql_timeout_interval = 2;		 /* Default is 6 seconds */
 unsigned int db_mysql_auto_reconnect = 1;		 /* Default is enabled   */
 unsigned int db_mysql_insert_all_delayed = 0;	 /* Default is off */
+unsigned int db_mysql_insert_all_stmt = 0;		 /* Default is off */
 unsigned int db_mysql_update_affected_found = 0; /* Default is off */
 
 /* MODULE_VERSION */
@@ -110,6 +111,7 @@ int db_mysql_bind_api(db_func_t *dbb)
 	dbb->end_transaction = db_mysql_end_transaction;
 	dbb->abort_transaction = db_mysql_abort_transaction;
 	dbb->raw_query_async = db_mysql_raw_query_async;
+	dbb->async_query = db_mysql_async_query;
 	dbb->insert_async = db_mysql_insert_async;
 
 	return 0;
@@ -486,6 +486,355 @@ int db_mysql_raw_query_async(const db1_con_t *_h, const str *_s)
 	return db_mysql_submit_query_async(_h, _s);
 }
 
+/**
+ * Execute a raw SQL query via core async framework with a completion
+ * callback receiving the result in the async worker process.
+ * \param _h handle for the database
+ * \param _s raw query string
+ * \param _cbk completion callback
+ * \param _arg argument passed through to the callback
+ * \return zero on success, negative value on failure
+ */
+int db_mysql_async_query(
+		const db1_con_t *_h, const str *_s, db_async_cbk_f _cbk, void *_arg)
+{
+	return db_do_async_query(_h, _s, _cbk, _arg, db_mysql_init, db_mysql_close,
+			db_mysql_raw_query, (db_free_result_f)db_mysql_free_result);
+}
+
+/* per-process bind arrays, grown on demand for the widest insert seen */
+static MYSQL_BIND *mysql_ps_bind = NULL;
+static MYSQL_TIME *mysql_ps_time = NULL;
+static unsigned long *mysql_ps_len = NULL;
+static int mysql_ps_bind_size = 0;
+
+
+/**
+ * Make sure the per-process bind arrays can hold _n parameters.
+ * \param _n number of parameters
+ * \return zero on success, negative value on failure
+ */
+static int db_mysql_ps_bind_grow(const int _n)
+{
+	MYSQL_BIND *b;
+	MYSQL_TIME *t;
+	unsigned long *l;
+
+	if(_n <= mysql_ps_bind_size)
+		return 0;
+
+	b = (MYSQL_BIND *)pkg_realloc(mysql_ps_bind, _n * sizeof(MYSQL_BIND));
+	if(!b) {
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	mysql_ps_bind = b;
+	t = (MYSQL_TIME *)pkg_realloc(mysql_ps_time, _n * sizeof(MYSQL_TIME));
+	if(!t) {
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	mysql_ps_time = t;
+	l = (unsigned long *)pkg_realloc(
+			mysql_ps_len, _n * sizeof(unsigned long));
+	if(!l) {
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	mysql_ps_len = l;
+	mysql_ps_bind_size = _n;
+
+	return 0;
+}
+
+
+/**
+ * Build the statement shape for an insert - the SQL text with ?
+ * placeholders instead of the values. Inserts repeating the same table
+ * and column list share the shape and thus the prepared statement.
+ * \param _h structure representing database connection
+ * \param _k key names
+ * \param _n number of keys
+ * \param _s written statement shape (points into the module buffer)
+ * \return zero on success, negative value on failure
+ */
+static int db_mysql_ps_shape(
+		const db1_con_t *_h, const db_key_t *_k, const int _n, str *_s)
+{
+	int off, ret, i;
+
+	ret = snprintf(mysql_sql_buf, sql_buffer_size, "insert into %s%.*s%s (",
+			CON_TQUOTESZ(_h), CON_TABLE(_h)->len, CON_TABLE(_h)->s,
+			CON_TQUOTESZ(_h));
+	if(ret < 0 || ret >= sql_buffer_size)
+		return -1;
+	off = ret;
+
+	ret = db_print_columns(mysql_sql_buf + off, sql_buffer_size - off, _k, _n,
+			CON_TQUOTESZ(_h));
+	if(ret < 0)
+		return -1;
+	off += ret;
+
+	ret = snprintf(mysql_sql_buf + off, sql_buffer_size - off, ") values (");
+	if(ret < 0 || ret >= (sql_buffer_size - off))
+		return -1;
+	off += ret;
+
+	for(i = 0; i < _n; i++) {
+		if(off + 3 > sql_buffer_size)
+			return -1;
+		if(i)
+			mysql_sql_buf[off++] = ',';
+		mysql_sql_buf[off++] = '?';
+	}
+	if(off + 2 > sql_buffer_size)
+		return -1;
+	mysql_sql_buf[off++] = ')';
+	mysql_sql_buf[off] = '\0';
+
+	_s->s = mysql_sql_buf;
+	_s->len = off;
+
+	return 0;
+}
+
+
+/**
+ * Drop a cached prepared statement from its connection, e.g. after the
+ * server invalidated it on reconnect. The next insert with the same
+ * shape prepares it again.
+ * \param _h structure representing database connection
+ * \param ps cached statement to drop
+ */
+static void db_mysql_ps_drop(const db1_con_t *_h, struct my_stmt *ps)
+{
+	struct my_stmt **pp;
+
+	for(pp = &CON_STMT_LIST(_h); *pp; pp = &(*pp)->next) {
+		if(*pp == ps) {
+			*pp = ps->next;
+			break;
+		}
+	}
+	if(ps->stmt)
+		mysql_stmt_close(ps->stmt);
+	pkg_free(ps);
+}
+
+
+/**
+ * Get the prepared statement for a shape, preparing and caching it on
+ * the connection on first use.
+ * \param _h structure representing database connection
+ * \param _s statement shape
+ * \param _n number of parameters
+ * \return cached statement or NULL on failure
+ */
+static struct my_stmt *db_mysql_ps_get(
+		const db1_con_t *_h, const str *_s, const int _n)
+{
+	struct my_stmt *ps;
+	MYSQL_STMT *stmt;
+
+	for(ps = CON_STMT_LIST(_h); ps; ps = ps->next) {
+		if(ps->sql.len == _s->len
+				&& memcmp(ps->sql.s, _s->s, _s->len) == 0)
+			return ps;
+	}
+
+	stmt = mysql_stmt_init(CON_CONNECTION(_h));
+	if(!stmt) {
+		LM_ERR("driver error on stmt init: %s\n",
+				mysql_error(CON_CONNECTION(_h)));
+		return NULL;
+	}
+	if(mysql_stmt_prepare(stmt, _s->s, _s->len)) {
+		LM_ERR("driver error on prepare: %s\n", mysql_stmt_error(stmt));
+		mysql_stmt_close(stmt);
+		return NULL;
+	}
+
+	ps = (struct my_stmt *)pkg_malloc(sizeof(struct my_stmt) + _s->len + 1);
+	if(!ps) {
+		PKG_MEM_ERROR;
+		mysql_stmt_close(stmt);
+		return NULL;
+	}
+	ps->sql.s = (char *)(ps + 1);
+	memcpy(ps->sql.s, _s->s, _s->len);
+	ps->sql.s[_s->len] = '\0';
+	ps->sql.len = _s->len;
+	ps->stmt = stmt;
+	ps->ncols = _n;
+	ps->next = CON_STMT_LIST(_h);
+	CON_STMT_LIST(_h) = ps;
+
+	return ps;
+}
+
+
+/**
+ * Fill the bind array from the db values. The fixed size types point
+ * straight into the db_val_t storage, only datetime values need a
+ * conversion into the per-process MYSQL_TIME array.
+ * \param bind bind array to fill (already zeroed)
+ * \param _v values of the keys
+ * \param _n number of values
+ * \return zero on success, negative value on failure
+ */
+static int db_mysql_ps_bind_values(
+		MYSQL_BIND *bind, const db_val_t *_v, const int _n)
+{
+	db_val_t *v = (db_val_t *)_v;
+	struct tm t;
+	int i;
+
+	for(i = 0; i < _n; i++) {
+		if(VAL_NULL(v + i)) {
+			bind[i].buffer_type = MYSQL_TYPE_NULL;
+			continue;
+		}
+		switch(VAL_TYPE(v + i)) {
+			case DB1_INT:
+				bind[i].buffer_type = MYSQL_TYPE_LONG;
+				bind[i].buffer = &VAL_INT(v + i);
+				break;
+			case DB1_UINT:
+				bind[i].buffer_type = MYSQL_TYPE_LONG;
+				bind[i].buffer = &VAL_UINT(v + i);
+				bind[i].is_unsigned = 1;
+				break;
+			case DB1_BIGINT:
+				bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+				bind[i].buffer = &VAL_BIGINT(v + i);
+				break;
+			case DB1_UBIGINT:
+				bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+				bind[i].buffer = &VAL_UBIGINT(v + i);
+				bind[i].is_unsigned = 1;
+				break;
+			case DB1_DOUBLE:
+				bind[i].buffer_type = MYSQL_TYPE_DOUBLE;
+				bind[i].buffer = &VAL_DOUBLE(v + i);
+				break;
+			case DB1_BITMAP:
+				bind[i].buffer_type = MYSQL_TYPE_LONG;
+				bind[i].buffer = &VAL_BITMAP(v + i);
+				bind[i].is_unsigned = 1;
+				break;
+			case DB1_STRING:
+				bind[i].buffer_type = MYSQL_TYPE_STRING;
+				bind[i].buffer = (char *)VAL_STRING(v + i);
+				mysql_ps_len[i] = strlen(VAL_STRING(v + i));
+				bind[i].length = &mysql_ps_len[i];
+				break;
+			case DB1_STR:
+				bind[i].buffer_type = MYSQL_TYPE_STRING;
+				bind[i].buffer = VAL_STR(v + i).s;
+				mysql_ps_len[i] = VAL_STR(v + i).len;
+				bind[i].length = &mysql_ps_len[i];
+				break;
+			case DB1_BLOB:
+				bind[i].buffer_type = MYSQL_TYPE_BLOB;
+				bind[i].buffer = VAL_BLOB(v + i).s;
+				mysql_ps_len[i] = VAL_BLOB(v + i).len;
+				bind[i].length = &mysql_ps_len[i];
+				break;
+			case DB1_DATETIME:
+				/* the text path prints FROM_UNIXTIME() in this case,
+				 * which a bound parameter cannot express */
+				if(my_server_timezone)
+					return -1;
+				localtime_r(&VAL_TIME(v + i), &t);
+				memset(&mysql_ps_time[i], 0, sizeof(MYSQL_TIME));
+				mysql_ps_time[i].year = 1900 + t.tm_year;
+				mysql_ps_time[i].month = t.tm_mon + 1;
+				mysql_ps_time[i].day = t.tm_mday;
+				mysql_ps_time[i].hour = t.tm_hour;
+				mysql_ps_time[i].minute = t.tm_min;
+				mysql_ps_time[i].second = t.tm_sec;
+				bind[i].buffer_type = MYSQL_TYPE_DATETIME;
+				bind[i].buffer = &mysql_ps_time[i];
+				break;
+			default:
+				LM_DBG("unhandled value type %d\n", VAL_TYPE(v + i));
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * Insert a row using a server-side prepared statement. The statement is
+ * prepared once per shape and connection and executed with binary
+ * protocol binds, skipping value escaping and SQL parsing on the
+ * server. On any failure the caller falls back to the text protocol.
+ * \param _h structure representing database connection
+ * \param _k key names
+ * \param _v values of the keys
+ * \param _n number of key=value pairs
+ * \return zero on success, negative value on failure
+ */
+static int db_mysql_insert_stmt(const db1_con_t *_h, const db_key_t *_k,
+		const db_val_t *_v, const int _n)
+{
+	struct my_stmt *ps;
+	str shape;
+	time_t t;
+	int i;
+
+	if(CON_TRANSACTION(_h) || CON_LOCKEDTABLES(_h))
+		return -1;
+
+	if(db_mysql_ps_bind_grow(_n) < 0)
+		return -1;
+
+	if(db_mysql_ps_shape(_h, _k, _n, &shape) < 0)
+		return -1;
+
+	if(my_ping_interval) {
+		t = time(0);
+		if((t - CON_TIMESTAMP(_h)) > my_ping_interval) {
+			for(i = 0; i < (db_mysql_auto_reconnect ? 3 : 1); i++) {
+				if(mysql_ping(CON_CONNECTION(_h))) {
+					LM_INFO("driver error on ping: %s\n",
+							mysql_error(CON_CONNECTION(_h)));
+					counter_inc(mysql_cnts_h.driver_err);
+				} else {
+					break;
+				}
+			}
+		}
+		CON_TIMESTAMP(_h) = t;
+	}
+
+	ps = db_mysql_ps_get(_h, &shape, _n);
+	if(!ps)
+		return -1;
+
+	memset(mysql_ps_bind, 0, _n * sizeof(MYSQL_BIND));
+	if(db_mysql_ps_bind_values(mysql_ps_bind, _v, _n) < 0)
+		return -1;
+
+	if(mysql_stmt_bind_param(ps->stmt, mysql_ps_bind)) {
+		LM_ERR("driver error on bind: %s\n", mysql_stmt_error(ps->stmt));
+		db_mysql_ps_drop(_h, ps);
+		return -1;
+	}
+	if(mysql_stmt_execute(ps->stmt)) {
+		LM_ERR("driver error on execute: %s\n", mysql_stmt_error(ps->stmt));
+		counter_inc(mysql_cnts_h.driver_err);
+		db_mysql_ps_drop(_h, ps);
+		return -1;
+	}
+
+	return 0;
+}
+
+
 /**
  * Insert a row into a specified table.
  * \param _h structure representing database connection
@@ -500,9 +849,13 @@ int db_mysql_insert(const db1_con_t *_h, const db_key_t *_k, const db_val_t *_v,
 	if(unlikely(db_mysql_insert_all_delayed == 1))
 		return db_do_insert_delayed(
 				_h, _k, _v, _n, db_mysql_val2str, db_mysql_submit_query);
-	else
-		return db_do_insert(
-				_h, _k, _v, _n, db_mysql_val2str, db_mysql_submit_query);
+
+	if(db_mysql_insert_all_stmt == 1
+			&& db_mysql_insert_stmt(_h, _k, _v, _n) == 0)
+		return 0;
+
+	return db_do_insert(
+			_h, _k, _v, _n, db_mysql_val2str, db_mysql_submit_query);
 }
 
 
@@ -34,6 +34,7 @@
 #define KM_DBASE_H
 
 
+#include "../../lib/srdb1/db.h"
 #include "../../lib/srdb1/db_con.h"
 #include "../../lib/srdb1/db_res.h"
 #include "../../lib/srdb1/db_key.h"
@@ -86,6 +87,13 @@ int db_mysql_raw_query(const db1_con_t *_h, const str *_s, db1_res_t **_r);
 int db_mysql_raw_query_async(const db1_con_t *_h, const str *_s);
 
 
+/*! \brief
+ * Raw SQL query with completion callback via async framework
+ */
+int db_mysql_async_query(
+		const db1_con_t *_h, const str *_s, db_async_cbk_f _cbk, void *_arg);
+
+
 /*! \brief
  * Insert a row into table
  */
@@ -250,6 +250,7 @@ err:
 void db_mysql_free_connection(struct pool_con *con)
 {
 	struct my_con *_c;
+	struct my_stmt *ps;
 
 	if(!con)
 		return;
@@ -258,6 +259,13 @@ void db_mysql_free_connection(struct pool_con *con)
 
 	if(_c->id)
 		free_db_id(_c->id);
+	while(_c->stmt_list) {
+		ps = _c->stmt_list;
+		_c->stmt_list = ps->next;
+		if(ps->stmt)
+			mysql_stmt_close(ps->stmt);
+		pkg_free(ps);
+	}
 	if(_c->con) {
 		mysql_close(_c->con);
 		pkg_free(_c->con);
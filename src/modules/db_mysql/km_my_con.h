@@ -39,6 +39,19 @@
 #include <mysql.h>
 
 
+/*! \brief
+ * Server-side prepared statement cached on a connection, looked up
+ * by the statement shape (SQL text with ? placeholders)
+ */
+struct my_stmt
+{
+	str sql;			  /*!< Statement shape with ? placeholders */
+	MYSQL_STMT *stmt;	  /*!< Server-side prepared statement */
+	int ncols;			  /*!< Number of bound parameters */
+	struct my_stmt *next; /*!< Next cached statement */
+};
+
+
 struct my_con
 {
 	struct db_id *id;	   /*!< Connection identifier */
@@ -49,6 +62,7 @@ struct my_con
 	time_t timestamp; /*!< Timestamp of last query */
 	int transaction;  /*!< Multi-query transaction is currently open */
 	int lockedtables; /*!< Table locks were aquired */
+	struct my_stmt *stmt_list; /*!< Cached prepared statements */
 };
 
 
@@ -61,6 +75,7 @@ struct my_con
 	(((struct my_con *)((db_con)->tail))->transaction)
 #define CON_LOCKEDTABLES(db_con) \
 	(((struct my_con *)((db_con)->tail))->lockedtables)
+#define CON_STMT_LIST(db_con) (((struct my_con *)((db_con)->tail))->stmt_list)
 
 
 /*! \brief
@@ -98,7 +98,10 @@ int db_postgres_bind_api(db_func_t *dbb)
 	dbb->abort_transaction = db_postgres_abort_transaction;
 	dbb->query_lock = db_postgres_query_lock;
 	dbb->raw_query_async = db_postgres_raw_query_async;
+	dbb->async_query = db_postgres_async_query;
 	dbb->insert_async = db_postgres_insert_async;
+	dbb->batch_start = db_postgres_batch_start;
+	dbb->batch_end = db_postgres_batch_end;
 
 	return 0;
 }
@@ -199,6 +199,29 @@ static int db_postgres_submit_query(const db1_con_t *_con, const str *_s)
 	memcpy(s, _s->s, _s->len);
 	s[_s->len] = '\0';
 
+#ifdef LIBPQ_HAS_PIPELINING
+	if(CON_BATCH(_con) >= 0) {
+		/* pipeline batch open - just queue the statement, the results
+		 * are collected when the batch is ended */
+		if(PQpipelineStatus(CON_CONNECTION(_con)) != PQ_PIPELINE_ON) {
+			LM_ERR("%p batch open but pipeline mode is gone\n", _con);
+			pkg_free(s);
+			return -1;
+		}
+		if(PQsendQueryParams(CON_CONNECTION(_con), s, 0, NULL, NULL, NULL,
+				   NULL, 0)
+				== 0) {
+			LM_ERR("%p failed to queue query: %s Query: %.*s\n", _con,
+					PQerrorMessage(CON_CONNECTION(_con)), _s->len, _s->s);
+			pkg_free(s);
+			return -1;
+		}
+		CON_BATCH(_con)++;
+		pkg_free(s);
+		return 0;
+	}
+#endif
+
 	for(i = 0; i <= retries; i++) {
 		/* free any previous query that is laying about */
 		db_postgres_free_query(_con);
@@ -576,6 +599,22 @@ int db_postgres_raw_query_async(const db1_con_t *_h, const str *_s)
 	return db_postgres_submit_query_async(_h, _s);
 }
 
+/**
+ * Execute a raw SQL query via core async framework with a completion
+ * callback receiving the result in the async worker process.
+ * \param _h handle for the database
+ * \param _s raw query string
+ * \param _cbk completion callback
+ * \param _arg argument passed through to the callback
+ * \return zero on success, negative value on failure
+ */
+int db_postgres_async_query(
+		const db1_con_t *_h, const str *_s, db_async_cbk_f _cbk, void *_arg)
+{
+	return db_do_async_query(_h, _s, _cbk, _arg, db_postgres_init,
+			db_postgres_close, db_postgres_raw_query, db_postgres_free_result);
+}
+
 /*!
  * \brief Retrieve result set
  * \param _con structure representing the database connection
@@ -678,6 +717,11 @@ int db_postgres_insert(const db1_con_t *_h, const db_key_t *_k,
 
 	int ret = db_do_insert(
 			_h, _k, _v, _n, db_postgres_val2str, db_postgres_submit_query);
+
+	/* in an open batch the result is collected at batch end */
+	if(CON_BATCH(_h) >= 0)
+		return ret;
+
 	// finish the async query, otherwise the next query will not complete
 	int tmp = db_postgres_store_result(_h, &_r);
 
@@ -1191,6 +1235,129 @@ int db_postgres_abort_transaction(db1_con_t *_h)
 	return 1;
 }
 
+/**
+ * Start a statement batch using the libpq pipeline mode. Until the
+ * batch is ended, write statements on the connection are only queued
+ * and many of them are flushed to the server in a single round-trip.
+ * Queries that read a result must not be issued inside a batch.
+ * \param _h database handle
+ * \return 0 on success, negative on failure
+ */
+int db_postgres_batch_start(db1_con_t *_h)
+{
+#ifdef LIBPQ_HAS_PIPELINING
+	if(!_h) {
+		LM_ERR("invalid parameter value\n");
+		return -1;
+	}
+	if(CON_BATCH(_h) >= 0) {
+		LM_ERR("batch already in progress\n");
+		return -1;
+	}
+	if(CON_TRANSACTION(_h) == 1) {
+		LM_ERR("cannot batch inside an open transaction\n");
+		return -1;
+	}
+
+	/* throw out any result laying about from a previous query */
+	db_postgres_free_query(_h);
+
+	if(PQstatus(CON_CONNECTION(_h)) != CONNECTION_OK) {
+		PQreset(CON_CONNECTION(_h));
+		if(PQstatus(CON_CONNECTION(_h)) != CONNECTION_OK) {
+			LM_ERR("%p PQstatus(%s) invalid\n", _h,
+					PQerrorMessage(CON_CONNECTION(_h)));
+			return -1;
+		}
+	}
+
+	if(PQenterPipelineMode(CON_CONNECTION(_h)) == 0) {
+		LM_ERR("failed to enter pipeline mode: %s\n",
+				PQerrorMessage(CON_CONNECTION(_h)));
+		return -1;
+	}
+	CON_BATCH(_h) = 0;
+	return 0;
+#else
+	LM_ERR("postgres client library has no pipeline support\n");
+	return -1;
+#endif
+}
+
+/**
+ * End a statement batch - flush the queued statements to the server
+ * and collect their results.
+ * \param _h database handle
+ * \return 0 if all batched statements succeeded, negative on failure
+ */
+int db_postgres_batch_end(db1_con_t *_h)
+{
+#ifdef LIBPQ_HAS_PIPELINING
+	PGresult *res;
+	ExecStatusType pqresult;
+	int queued, done = 0, failed = 0;
+
+	if(!_h) {
+		LM_ERR("invalid parameter value\n");
+		return -1;
+	}
+	if(CON_BATCH(_h) < 0) {
+		LM_ERR("batch not in progress\n");
+		return -1;
+	}
+	queued = CON_BATCH(_h);
+	CON_BATCH(_h) = -1;
+
+	if(PQpipelineSync(CON_CONNECTION(_h)) == 0) {
+		LM_ERR("pipeline sync failed: %s\n",
+				PQerrorMessage(CON_CONNECTION(_h)));
+		PQexitPipelineMode(CON_CONNECTION(_h));
+		return -1;
+	}
+
+	/* each queued statement produces one result followed by a NULL,
+	 * then the sync point itself is reported */
+	while(done < queued) {
+		res = PQgetResult(CON_CONNECTION(_h));
+		if(res == NULL) {
+			done++;
+			continue;
+		}
+		pqresult = PQresultStatus(res);
+		if(pqresult == PGRES_PIPELINE_SYNC) {
+			PQclear(res);
+			goto out;
+		}
+		if(pqresult != PGRES_COMMAND_OK && pqresult != PGRES_TUPLES_OK) {
+			failed++;
+			LM_ERR("statement %d of the batch failed with code %d (%s): %s\n",
+					done + 1, pqresult, PQresStatus(pqresult),
+					PQresultErrorMessage(res));
+		}
+		PQclear(res);
+	}
+
+	/* consume the sync point result */
+	res = PQgetResult(CON_CONNECTION(_h));
+	if(res)
+		PQclear(res);
+
+out:
+	if(PQexitPipelineMode(CON_CONNECTION(_h)) == 0) {
+		LM_ERR("failed to leave pipeline mode: %s\n",
+				PQerrorMessage(CON_CONNECTION(_h)));
+		return -1;
+	}
+	if(failed) {
+		LM_ERR("%d of %d batched statements failed\n", failed, queued);
+		return -1;
+	}
+	return 0;
+#else
+	return -1;
+#endif
+}
+
 /*!
  * Store name of table that will be used by subsequent database functions
  * \param _con database connection
@@ -31,6 +31,7 @@
 #ifndef KM_DBASE_H
 #define KM_DBASE_H
 
+#include "../../lib/srdb1/db.h"
 #include "../../lib/srdb1/db_con.h"
 #include "../../lib/srdb1/db_res.h"
 #include "../../lib/srdb1/db_key.h"
@@ -103,6 +104,10 @@ int db_postgres_raw_query(const db1_con_t *_h, const str *_s, db1_res_t **_r);
  */
 int db_postgres_raw_query_async(const db1_con_t *_h, const str *_s);
 
+/*! \brief Raw SQL query with completion callback via async framework */
+int db_postgres_async_query(
+		const db1_con_t *_h, const str *_s, db_async_cbk_f _cbk, void *_arg);
+
 /*
  * Insert a row into table
  */
@@ -160,6 +165,16 @@ int db_postgres_end_transaction(db1_con_t *_h);
  */
 int db_postgres_abort_transaction(db1_con_t *_h);
 
+/*! \brief
+ * Start a pipeline statement batch
+ */
+int db_postgres_batch_start(db1_con_t *_h);
+
+/*! \brief
+ * Flush a pipeline statement batch to the server
+ */
+int db_postgres_batch_end(db1_con_t *_h);
+
 /*
  * Store name of table that will be used by
  * subsequent database functions
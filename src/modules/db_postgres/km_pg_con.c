@@ -76,6 +76,7 @@ struct pg_con *db_postgres_new_connection(struct db_id *id)
 
 	memset(ptr, 0, sizeof(struct pg_con));
 	ptr->ref = 1;
+	ptr->batch = -1;
 
 	memset(keywords, 0, (sizeof(char *) * 10));
 	memset(values, 0, (sizeof(char *) * 10));
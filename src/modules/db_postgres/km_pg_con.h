@@ -53,6 +53,7 @@ struct pg_con
 	time_t timestamp;  /*!< Timestamp of last query */
 	int affected_rows; /*!< Number of rows affected by the last statement */
 	int transaction; /*!< indicates whether a multi-query transaction is currently open */
+	int batch; /*!< statements queued in an open pipeline batch, -1 when no batch is open */
 };
 
 #define CON_SQLURL(db_con) (((struct pg_con *)((db_con)->tail))->sqlurl)
@@ -66,6 +67,7 @@ struct pg_con
 	(((struct pg_con *)((db_con)->tail))->affected_rows)
 #define CON_TRANSACTION(db_con) \
 	(((struct pg_con *)((db_con)->tail))->transaction)
+#define CON_BATCH(db_con) (((struct pg_con *)((db_con)->tail))->batch)
 
 /*
  * Create a new connection structure,
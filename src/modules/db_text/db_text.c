@@ -51,6 +51,7 @@ int _db_text_read_buffer_size = DEFAULT_DB_TEXT_READ_BUFFER_SIZE;
 int _db_text_max_result_rows = DEFAULT_MAX_RESULT_ROWS;
 int _dbt_delim = ':';				/* ':' is the default delim */
 str _dbt_delim_str = str_init(":"); /* ':' is the default delim */
+int _dbt_hash_index = 0; /* hash indexes for equality lookups disabled */
 str dbt_default_connection = str_init("");
 
 int dbt_bind_api(db_func_t *dbb);
@@ -71,7 +72,8 @@ static param_export_t params[] = {{"db_mode", PARAM_INT, &db_mode},
 		{"file_buffer_size", PARAM_INT, &_db_text_read_buffer_size},
 		{"max_result_rows", PARAM_INT, &_db_text_max_result_rows},
 		{"default_connection", PARAM_STR, &dbt_default_connection},
-		{"db_delim", PARAM_STR, &_dbt_delim_str}, {0, 0, 0}};
+		{"db_delim", PARAM_STR, &_dbt_delim_str},
+		{"hash_index", PARAM_INT, &_dbt_hash_index}, {0, 0, 0}};
 
 static rpc_export_t rpc_methods[];
 
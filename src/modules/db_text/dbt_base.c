@@ -166,6 +166,9 @@ int dbt_query(db1_con_t *_h, db_key_t *_k, db_op_t *_op, db_val_t *_v,
 	dbt_table_p _tbc_temp = NULL;
 	dbt_row_p _drp = NULL;
 	dbt_row_p *_res = NULL;
+	dbt_index_p _idx = NULL;
+	dbt_ientry_p _ie = NULL;
+	unsigned int _hv = 0;
 	//	dbt_result_p _dres = NULL;
 	int result = 0;
 	int counter = 0;
@@ -270,20 +273,47 @@ int dbt_query(db1_con_t *_h, db_key_t *_k, db_op_t *_op, db_val_t *_v,
 	}
 
 
-	_drp = _tbc->rows;
-	while(_drp && counter < _db_text_max_result_rows) {
-		if(dbt_row_match(_tbc, _drp, lkey, _op, _v, _n)) {
-			_res[counter] = _drp;
-			//			if(dbt_result_extract_fields(_tbc, _drp, lres, _dres))
-			//			{
-			//				LM_ERR("failed to extract result fields!\n");
-			//				goto clean;
-			//			}
-			counter++;
+	/* with hash indexes enabled, look for an equality key over a hashable
+	 * value and walk only the rows from its bucket instead of the full
+	 * table - dbt_row_match() still verifies the complete where clause */
+	if(_dbt_hash_index != 0 && lkey) {
+		for(i = 0; i < _n; i++) {
+			if(_op && strcmp(_op[i], OP_EQ) != 0)
+				continue;
+			if(dbt_idx_hash_qval(&_v[i], &_hv) < 0)
+				continue;
+			_idx = dbt_table_get_index(_tbc, lkey[i]);
+			if(_idx != NULL)
+				break;
+		}
+	}
+
+	if(_idx != NULL) {
+		_ie = _idx->slots[_hv & (DBT_IDX_HSIZE - 1)];
+		while(_ie && counter < _db_text_max_result_rows) {
+			if(_ie->hashv == _hv
+					&& dbt_row_match(_tbc, _ie->row, lkey, _op, _v, _n)) {
+				_res[counter] = _ie->row;
+				counter++;
+			}
+			_ie = _ie->next;
+		}
+	} else {
+		_drp = _tbc->rows;
+		while(_drp && counter < _db_text_max_result_rows) {
+			if(dbt_row_match(_tbc, _drp, lkey, _op, _v, _n)) {
+				_res[counter] = _drp;
+				//			if(dbt_result_extract_fields(_tbc, _drp, lres, _dres))
+				//			{
+				//				LM_ERR("failed to extract result fields!\n");
+				//				goto clean;
+				//			}
+				counter++;
+			}
+			_drp = _drp->next;
 		}
-		_drp = _drp->next;
 	}
-	if(_drp && counter == _db_text_max_result_rows) {
+	if((_drp || _ie) && counter == _db_text_max_result_rows) {
 		LM_ERR("Truncated table at [%d] rows. Please increase "
 			   "'max_result_rows' param!\n",
 				counter);
@@ -46,6 +46,8 @@
 #define DBT_DELIM_C ' '
 #define DBT_DELIM_R '\n'
 
+#define DBT_IDX_HSIZE 4096 /* buckets per column hash index - power of 2 */
+
 /*
  *  * Module parameters variables
  *   */
@@ -57,6 +59,7 @@ extern int
 extern int _dbt_delim;
 extern str _dbt_delim_str;			 /* the delimiter inside db_text files */
 extern int _db_text_max_result_rows; /* max result rows */
+extern int _dbt_hash_index; /* build hash indexes for equality lookups */
 
 typedef db_val_t dbt_val_t, *dbt_val_p;
 
@@ -78,6 +81,22 @@ typedef struct _dbt_column
 
 } dbt_column_t, *dbt_column_p;
 
+typedef struct _dbt_ientry
+{
+	unsigned int hashv;
+	dbt_row_p row;
+	struct _dbt_ientry *next;
+
+} dbt_ientry_t, *dbt_ientry_p;
+
+typedef struct _dbt_index
+{
+	int col;
+	dbt_ientry_p *slots;
+	struct _dbt_index *next;
+
+} dbt_index_t, *dbt_index_p;
+
 
 typedef struct _dbt_table
 {
@@ -93,6 +112,7 @@ typedef struct _dbt_table
 	dbt_column_p *colv;
 	int nrrows;
 	dbt_row_p rows;
+	dbt_index_p idx;
 	time_t mt;
 	struct _dbt_table *next;
 	struct _dbt_table *prev;
@@ -136,6 +156,10 @@ int dbt_table_free_rows(dbt_table_p);
 int dbt_table_free(dbt_table_p);
 int dbt_db_del_table(dbt_cache_p _dc, const str *_s, int sync);
 
+dbt_index_p dbt_table_get_index(dbt_table_p, int);
+int dbt_table_free_indexes(dbt_table_p);
+int dbt_idx_hash_qval(db_val_t *, unsigned int *);
+
 int dbt_row_set_val(dbt_row_p, dbt_val_p, int, int);
 int dbt_row_update_val(dbt_row_p, dbt_val_p, int, int);
 int dbt_table_add_row(dbt_table_p, dbt_row_p);
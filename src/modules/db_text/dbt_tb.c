@@ -34,6 +34,7 @@
 #include "../../core/mem/mem.h"
 #include "../../core/dprint.h"
 #include "../../core/locking.h"
+#include "../../core/hashes.h"
 
 #include "dbt_util.h"
 #include "dbt_lib.h"
@@ -169,6 +170,7 @@ dbt_table_p dbt_table_new(
 	dtp->rows = NULL;
 	dtp->cols = NULL;
 	dtp->colv = NULL;
+	dtp->idx = NULL;
 	dtp->mark = (int)time(NULL);
 	dtp->flag = DBT_TBFL_ZERO;
 	dtp->nrrows = dtp->nrcols = dtp->auto_val = 0;
@@ -229,6 +231,154 @@ int dbt_table_add_row(dbt_table_p _dtp, dbt_row_p _drp)
 	return 0;
 }
 
+/**
+ * hash of a stored field value - strings are hashed case insensitive
+ * to stay consistent with dbt_cmp_val()
+ */
+static unsigned int dbt_idx_hash_field(dbt_val_p _vp)
+{
+	switch(_vp->type) {
+		case DB1_STR:
+		case DB1_STRING:
+		case DB1_BLOB:
+			return get_hash1_case_raw(_vp->val.str_val.s, _vp->val.str_val.len);
+		default:
+			/* int, datetime and bitmap are all stored in int_val */
+			return (unsigned int)_vp->val.int_val;
+	}
+}
+
+/**
+ * hash of a query value - returns -1 for types that cannot be indexed
+ */
+int dbt_idx_hash_qval(db_val_t *_v, unsigned int *_hv)
+{
+	if(!_v || !_hv || _v->nul)
+		return -1;
+
+	switch(VAL_TYPE(_v)) {
+		case DB1_INT:
+			*_hv = (unsigned int)_v->val.int_val;
+			return 0;
+		case DB1_DATETIME:
+			*_hv = (unsigned int)_v->val.time_val;
+			return 0;
+		case DB1_BITMAP:
+			*_hv = (unsigned int)_v->val.bitmap_val;
+			return 0;
+		case DB1_STRING:
+			*_hv = get_hash1_case_raw(
+					_v->val.string_val, strlen(_v->val.string_val));
+			return 0;
+		case DB1_STR:
+			*_hv = get_hash1_case_raw(_v->val.str_val.s, _v->val.str_val.len);
+			return 0;
+		case DB1_BLOB:
+			*_hv = get_hash1_case_raw(_v->val.blob_val.s, _v->val.blob_val.len);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+/**
+ *
+ */
+static int dbt_index_free(dbt_index_p _idx)
+{
+	int i;
+	dbt_ientry_p _ie = NULL, _ie0 = NULL;
+
+	if(!_idx)
+		return -1;
+	if(_idx->slots) {
+		for(i = 0; i < DBT_IDX_HSIZE; i++) {
+			_ie = _idx->slots[i];
+			while(_ie) {
+				_ie0 = _ie;
+				_ie = _ie->next;
+				shm_free(_ie0);
+			}
+		}
+		shm_free(_idx->slots);
+	}
+	shm_free(_idx);
+
+	return 0;
+}
+
+/**
+ * get the hash index over a column, building it on first use - the caller
+ * must hold the table lock; rows with null value in the column are not
+ * indexed, so lookups for null values have to scan
+ */
+dbt_index_p dbt_table_get_index(dbt_table_p _dtp, int _cid)
+{
+	dbt_index_p _idx = NULL;
+	dbt_ientry_p _ie = NULL;
+	dbt_row_p _drp = NULL;
+
+	if(!_dtp || _cid < 0 || _cid >= _dtp->nrcols)
+		return NULL;
+
+	for(_idx = _dtp->idx; _idx; _idx = _idx->next) {
+		if(_idx->col == _cid)
+			return _idx;
+	}
+
+	_idx = (dbt_index_p)shm_malloc(sizeof(dbt_index_t));
+	if(!_idx)
+		return NULL;
+	memset(_idx, 0, sizeof(dbt_index_t));
+	_idx->col = _cid;
+	_idx->slots =
+			(dbt_ientry_p *)shm_malloc(DBT_IDX_HSIZE * sizeof(dbt_ientry_p));
+	if(!_idx->slots) {
+		shm_free(_idx);
+		return NULL;
+	}
+	memset(_idx->slots, 0, DBT_IDX_HSIZE * sizeof(dbt_ientry_p));
+
+	for(_drp = _dtp->rows; _drp; _drp = _drp->next) {
+		if(_drp->fields[_cid].nul)
+			continue;
+		_ie = (dbt_ientry_p)shm_malloc(sizeof(dbt_ientry_t));
+		if(!_ie) {
+			dbt_index_free(_idx);
+			return NULL;
+		}
+		_ie->hashv = dbt_idx_hash_field(&_drp->fields[_cid]);
+		_ie->row = _drp;
+		_ie->next = _idx->slots[_ie->hashv & (DBT_IDX_HSIZE - 1)];
+		_idx->slots[_ie->hashv & (DBT_IDX_HSIZE - 1)] = _ie;
+	}
+
+	_idx->next = _dtp->idx;
+	_dtp->idx = _idx;
+
+	return _idx;
+}
+
+/**
+ *
+ */
+int dbt_table_free_indexes(dbt_table_p _dtp)
+{
+	dbt_index_p _idx = NULL, _idx0 = NULL;
+
+	if(!_dtp)
+		return -1;
+	_idx = _dtp->idx;
+	while(_idx) {
+		_idx0 = _idx;
+		_idx = _idx->next;
+		dbt_index_free(_idx0);
+	}
+	_dtp->idx = NULL;
+
+	return 0;
+}
+
 /**
  *
  */
@@ -247,6 +397,8 @@ int dbt_table_free(dbt_table_p _dtp)
 	if(_dtp->rows && _dtp->nrrows > 0)
 		dbt_table_free_rows(_dtp);
 
+	dbt_table_free_indexes(_dtp);
+
 	_cp = _dtp->cols;
 	while(_cp) {
 		_cp0 = _cp;
@@ -467,9 +619,13 @@ int dbt_table_update_flags(dbt_table_p _dtp, int _f, int _o, int _m)
 	if(!_dtp)
 		return -1;
 
-	if(_o == DBT_FL_SET)
+	if(_o == DBT_FL_SET) {
 		_dtp->flag |= _f;
-	else if(_o == DBT_FL_UNSET)
+		/* rows are being changed - drop the hash indexes, they are
+		 * rebuilt on the next indexed lookup */
+		if(_f & DBT_TBFL_MODI)
+			dbt_table_free_indexes(_dtp);
+	} else if(_o == DBT_FL_UNSET)
 		_dtp->flag &= ~_f;
 
 	if(_m)
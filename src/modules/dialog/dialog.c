@@ -350,6 +350,7 @@ static param_export_t mod_params[]={
 	{ "vars_value_column",     PARAM_STR, &vars_value_column      },
 
 	{ "db_update_period",      PARAM_INT, &db_update_period         },
+	{ "db_flush_batch",        PARAM_INT, &dlg_db_flush_batch       },
 	{ "db_fetch_rows",         PARAM_INT, &db_fetch_rows            },
 	{ "profiles_with_value",   PARAM_STRING, &profiles_wv_s            },
 	{ "profiles_no_value",     PARAM_STRING, &profiles_nv_s            },
@@ -369,6 +370,7 @@ static param_export_t mod_params[]={
 	{ "db_skip_load",          PARAM_INT, &db_skip_load             },
 	{ "ka_failed_limit",       PARAM_INT, &dlg_ka_failed_limit      },
 	{ "enable_dmq",            PARAM_INT, &dlg_enable_dmq           },
+	{ "dmq_batch_dlgs",        PARAM_INT, &dlg_dmq_batch_dlgs       },
 	{ "event_callback",        PARAM_STR, &dlg_event_callback       },
 	{ "early_timeout",         PARAM_INT, &dlg_early_timeout        },
 	{ "noack_timeout",         PARAM_INT, &dlg_noack_timeout        },
@@ -3194,8 +3196,8 @@ static void internal_rpc_profile_print_dlgs(
 	if(profile->has_value == 0)
 		value = NULL;
 
-	lock_get(&profile->lock);
 	for(i = 0; i < profile->size; i++) {
+		lock_get(&profile->entries[i].lock);
 		ph = profile->entries[i].first;
 		if(ph) {
 			do {
@@ -3207,8 +3209,8 @@ static void internal_rpc_profile_print_dlgs(
 				ph = ph->next;
 			} while(ph != profile->entries[i].first);
 		}
+		lock_release(&profile->entries[i].lock);
 	}
-	lock_release(&profile->lock);
 }
 
 /*
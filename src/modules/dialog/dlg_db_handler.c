@@ -72,6 +72,7 @@ str req_uri_column = str_init(REQ_URI_COL);
 str xdata_column = str_init(XDATA_COL);
 str dialog_table_name = str_init(DIALOG_TABLE_NAME);
 int dlg_db_mode = DB_MODE_NONE;
+int dlg_db_flush_batch = 0;
 
 str vars_h_id_column = str_init(VARS_HASH_ID_COL);
 str vars_h_entry_column = str_init(VARS_HASH_ENTRY_COL);
@@ -1034,6 +1035,69 @@ int update_dialog_dbinfo(struct dlg_cell *cell)
 	return 0;
 }
 
+
+static int dlg_db_batch_open = 0; /*!< Flush transaction in progress */
+static int dlg_db_batch_ops = 0;  /*!< Write operations in the open batch */
+
+/*!
+ * \brief Start a flush batch transaction
+ *
+ * Open a transaction grouping the database writes of a timer pass, so
+ * one commit round-trip covers up to db_flush_batch dirty dialogs
+ * instead of one per statement. No-op unless db_flush_batch is set and
+ * the driver supports transactions.
+ */
+static void dlg_db_batch_start(void)
+{
+	if(dlg_db_flush_batch <= 0 || dialog_dbf.start_transaction == NULL)
+		return;
+	if(dialog_dbf.start_transaction(dialog_db_handle, DB_LOCKING_NONE) < 0) {
+		LM_ERR("failed to start the flush transaction\n");
+		return;
+	}
+	dlg_db_batch_open = 1;
+	dlg_db_batch_ops = 0;
+}
+
+
+/*!
+ * \brief Commit the flush batch transaction
+ */
+static void dlg_db_batch_end(void)
+{
+	if(!dlg_db_batch_open)
+		return;
+	dlg_db_batch_open = 0;
+	if(dialog_dbf.end_transaction == NULL)
+		return;
+	if(dialog_dbf.end_transaction(dialog_db_handle) < 0) {
+		LM_ERR("failed to commit the flush transaction - the database may"
+			   " miss %d dialog updates until the dialogs change again\n",
+				dlg_db_batch_ops);
+		if(dialog_dbf.abort_transaction)
+			dialog_dbf.abort_transaction(dialog_db_handle);
+	}
+}
+
+
+/*!
+ * \brief Account a write operation done within the flush batch
+ *
+ * Commits and reopens the transaction once db_flush_batch operations
+ * were collected, keeping the transaction size bounded.
+ */
+static void dlg_db_batch_step(void)
+{
+	if(!dlg_db_batch_open)
+		return;
+	dlg_db_batch_ops++;
+	if(dlg_db_batch_ops < dlg_db_flush_batch)
+		return;
+	dlg_db_batch_end();
+	dlg_db_batch_start();
+}
+
+
 void dialog_update_db(unsigned int ticks, void *param)
 {
 	int i;
@@ -1041,14 +1105,22 @@ void dialog_update_db(unsigned int ticks, void *param)
 
 	LM_DBG("saving current_info \n");
 
+	dlg_db_batch_start();
 	for(i = 0; i < d_table->size; i++) {
 		/* lock the slot */
 		dlg_lock(d_table, &d_table->entries[i]);
 		for(cell = d_table->entries[i].first; cell != NULL; cell = cell->next) {
+			if((cell->dflags
+					   & (DLG_FLAG_NEW | DLG_FLAG_CHANGED
+							   | DLG_FLAG_CHANGED_VARS))
+					== 0)
+				continue;
 			/* if update fails for one dlg, still do it for the next ones */
 			update_dialog_dbinfo_unsafe(cell);
+			dlg_db_batch_step();
 		}
 		dlg_unlock(d_table, &d_table->entries[i]);
 	}
+	dlg_db_batch_end();
 	return;
 }
@@ -105,6 +105,7 @@ extern str sflags_column;
 extern str toroute_name_column;
 extern str dialog_table_name;
 extern int dlg_db_mode;
+extern int dlg_db_flush_batch;
 
 /* Dialog-Vars Table */
 extern str vars_h_id_column;
@@ -39,6 +39,10 @@ int dlg_dmq_request_sync();
 
 extern int dlg_enable_stats;
 
+/*! number of dialogs packed into one dmq message on full sync
+ * - 0 keeps one message per dialog */
+int dlg_dmq_batch_dlgs = 0;
+
 /**
 * @brief add notification peer
 */
@@ -93,20 +97,17 @@ int dlg_dmq_send(str *body, dmq_node_t *node)
 
 
 /**
-* @brief ht dmq callback
+* @brief process one json dialog object received via dmq
 */
-int dlg_dmq_handle_msg(
-		struct sip_msg *msg, peer_reponse_t *resp, dmq_node_t *node)
+static int dlg_dmq_handle_obj(srjson_doc_t *jdoc, srjson_t *obj,
+		dlg_dmq_action_t action, dmq_node_t *node)
 {
-	int content_length;
-	str body;
 	dlg_cell_t *dlg = NULL;
 	int unref = 0;
 	int ret;
-	srjson_doc_t jdoc, prof_jdoc;
+	srjson_doc_t prof_jdoc;
 	srjson_t *it = NULL;
 
-	dlg_dmq_action_t action = DLG_DMQ_NONE;
 	dlg_iuid_t iuid = {0};
 	str profiles = {0, 0}, callid = {0, 0}, tag1 = {0, 0}, tag2 = {0, 0},
 		contact1 = {0, 0}, contact2 = {0, 0}, k = {0, 0}, v = {0, 0};
@@ -119,50 +120,15 @@ int dlg_dmq_handle_msg(
 	int newdlg = 0;
 	dlg_entry_t *d_entry = NULL;
 
-	/* received dmq message */
-	LM_DBG("dmq message received\n");
-
-	if(!msg->content_length) {
-		LM_ERR("no content length header found\n");
-		goto invalid2;
-	}
-	content_length = get_content_length(msg);
-	if(!content_length) {
-		LM_DBG("content length is 0\n");
-		goto invalid2;
-	}
-
-	body.s = get_body(msg);
-	body.len = content_length;
-
-	if(!body.s) {
-		LM_ERR("unable to get body\n");
-		goto error;
-	}
-
-	/* parse body */
-	LM_DBG("body: %.*s\n", body.len, body.s);
-
-	srjson_InitDoc(&jdoc, NULL);
-	jdoc.buf = body;
-
-	if(jdoc.root == NULL) {
-		jdoc.root = srjson_Parse(&jdoc, jdoc.buf.s);
-		if(jdoc.root == NULL) {
-			LM_ERR("invalid json doc [[%s]]\n", jdoc.buf.s);
-			goto invalid;
-		}
-	}
-
-	for(it = jdoc.root->child; it; it = it->next) {
-		if((it->string == NULL) || (strcmp(it->string, "vars") == 0))
+	for(it = obj->child; it; it = it->next) {
+		if((it->string == NULL) || (strcmp(it->string, "vars") == 0)
+				|| (strcmp(it->string, "action") == 0)
+				|| (strcmp(it->string, "dialogs") == 0))
 			continue;
 
 		LM_DBG("found field: %s\n", it->string);
 
-		if(strcmp(it->string, "action") == 0) {
-			action = SRJSON_GET_UINT(it);
-		} else if(strcmp(it->string, "h_entry") == 0) {
+		if(strcmp(it->string, "h_entry") == 0) {
 			iuid.h_entry = SRJSON_GET_UINT(it);
 		} else if(strcmp(it->string, "h_id") == 0) {
 			iuid.h_id = SRJSON_GET_UINT(it);
@@ -265,7 +231,7 @@ int dlg_dmq_handle_msg(
 			dlg->init_ts = init_ts;
 			dlg->start_ts = start_ts;
 
-			vj = srjson_GetObjectItem(&jdoc, jdoc.root, "vars");
+			vj = srjson_GetObjectItem(jdoc, obj, "vars");
 			if(vj != NULL) {
 				for(it = vj->child; it; it = it->next) {
 					k.s = it->string;
@@ -412,6 +378,81 @@ int dlg_dmq_handle_msg(
 	if(newdlg == 0 && d_entry != NULL) {
 		dlg_unlock(d_table, d_entry);
 	}
+	return 0;
+
+error:
+	if(newdlg == 0 && d_entry != NULL) {
+		dlg_unlock(d_table, d_entry);
+	}
+	return -1;
+}
+
+
+/**
+* @brief ht dmq callback
+*/
+int dlg_dmq_handle_msg(
+		struct sip_msg *msg, peer_reponse_t *resp, dmq_node_t *node)
+{
+	int content_length;
+	str body;
+	srjson_doc_t jdoc;
+	srjson_t *it = NULL;
+	srjson_t *aj = NULL;
+	dlg_dmq_action_t action = DLG_DMQ_NONE;
+	int ret = 0;
+
+	/* received dmq message */
+	LM_DBG("dmq message received\n");
+
+	if(!msg->content_length) {
+		LM_ERR("no content length header found\n");
+		goto invalid2;
+	}
+	content_length = get_content_length(msg);
+	if(!content_length) {
+		LM_DBG("content length is 0\n");
+		goto invalid2;
+	}
+
+	body.s = get_body(msg);
+	body.len = content_length;
+
+	if(!body.s) {
+		LM_ERR("unable to get body\n");
+		goto error;
+	}
+
+	/* parse body */
+	LM_DBG("body: %.*s\n", body.len, body.s);
+
+	srjson_InitDoc(&jdoc, NULL);
+	jdoc.buf = body;
+
+	if(jdoc.root == NULL) {
+		jdoc.root = srjson_Parse(&jdoc, jdoc.buf.s);
+		if(jdoc.root == NULL) {
+			LM_ERR("invalid json doc [[%s]]\n", jdoc.buf.s);
+			goto invalid;
+		}
+	}
+
+	it = srjson_GetObjectItem(&jdoc, jdoc.root, "action");
+	if(it != NULL)
+		action = SRJSON_GET_UINT(it);
+
+	aj = srjson_GetObjectItem(&jdoc, jdoc.root, "dialogs");
+	if(aj != NULL) {
+		/* batched message - apply the action to every packed dialog */
+		for(it = aj->child; it; it = it->next) {
+			if(dlg_dmq_handle_obj(&jdoc, it, action, node) < 0)
+				ret = -1;
+		}
+	} else {
+		ret = dlg_dmq_handle_obj(&jdoc, jdoc.root, action, node);
+	}
+	if(ret < 0)
+		goto error;
 
 	srjson_DestroyDoc(&jdoc);
 	resp->reason = dmq_200_rpl;
@@ -426,9 +467,6 @@ invalid2:
 	return 0;
 
 error:
-	if(newdlg == 0 && d_entry != NULL) {
-		dlg_unlock(d_table, d_entry);
-	}
 	srjson_DestroyDoc(&jdoc);
 	resp->reason = dmq_500_rpl;
 	resp->resp_code = 500;
@@ -477,81 +515,50 @@ error:
 }
 
 
-int dlg_dmq_replicate_action(dlg_dmq_action_t action, dlg_cell_t *dlg,
-		int needlock, dmq_node_t *node)
+/**
+* @brief serialize one dialog into a json object, following the action
+*/
+static void dlg_dmq_json_add_dlg(srjson_doc_t *jdoc, srjson_t *obj,
+		dlg_dmq_action_t action, dlg_cell_t *dlg)
 {
-
-	srjson_doc_t jdoc, prof_jdoc;
+	srjson_doc_t prof_jdoc;
 	dlg_var_t *var;
 
-	LM_DBG("replicating action [%d] on [%u:%u] to dmq peers\n", action,
-			dlg->h_entry, dlg->h_id);
-
-	if(action == DLG_DMQ_UPDATE) {
-		if(!node && (dlg->iflags & DLG_IFLAG_DMQ_SYNC)
-				&& ((dlg->dflags & DLG_FLAG_CHANGED_PROF) == 0)) {
-			LM_DBG("dlg not changed, no sync\n");
-			return 1;
-		}
-	} else if((dlg->iflags & DLG_IFLAG_DMQ_SYNC) == 0) {
-		LM_DBG("dlg not synced, no sync\n");
-		return 1;
-	}
-	if(action == DLG_DMQ_STATE
-			&& (dlg->state != DLG_STATE_CONFIRMED
-					&& dlg->state != DLG_STATE_DELETED
-					&& dlg->state != DLG_STATE_EARLY)) {
-		LM_DBG("not syncing state %u\n", dlg->state);
-		return 1;
-	}
-
-	srjson_InitDoc(&jdoc, NULL);
-
-	jdoc.root = srjson_CreateObject(&jdoc);
-	if(jdoc.root == NULL) {
-		LM_ERR("cannot create json root\n");
-		goto error;
-	}
-
-	if(needlock)
-		dlg_lock(d_table, &(d_table->entries[dlg->h_entry]));
-
-	srjson_AddNumberToObject(&jdoc, jdoc.root, "action", action);
-	srjson_AddNumberToObject(&jdoc, jdoc.root, "h_entry", dlg->h_entry);
-	srjson_AddNumberToObject(&jdoc, jdoc.root, "h_id", dlg->h_id);
+	srjson_AddNumberToObject(jdoc, obj, "h_entry", dlg->h_entry);
+	srjson_AddNumberToObject(jdoc, obj, "h_id", dlg->h_id);
 
 	switch(action) {
 		case DLG_DMQ_UPDATE:
 			dlg->iflags |= DLG_IFLAG_DMQ_SYNC;
 			dlg->dflags &= ~DLG_FLAG_CHANGED_PROF;
-			srjson_AddNumberToObject(&jdoc, jdoc.root, "init_ts", dlg->init_ts);
+			srjson_AddNumberToObject(jdoc, obj, "init_ts", dlg->init_ts);
 			srjson_AddStrToObject(
-					&jdoc, jdoc.root, "callid", dlg->callid.s, dlg->callid.len);
+					jdoc, obj, "callid", dlg->callid.s, dlg->callid.len);
 
-			srjson_AddStrToObject(&jdoc, jdoc.root, "from_uri", dlg->from_uri.s,
+			srjson_AddStrToObject(jdoc, obj, "from_uri", dlg->from_uri.s,
 					dlg->from_uri.len);
 			srjson_AddStrToObject(
-					&jdoc, jdoc.root, "to_uri", dlg->to_uri.s, dlg->to_uri.len);
-			srjson_AddStrToObject(&jdoc, jdoc.root, "req_uri", dlg->req_uri.s,
+					jdoc, obj, "to_uri", dlg->to_uri.s, dlg->to_uri.len);
+			srjson_AddStrToObject(jdoc, obj, "req_uri", dlg->req_uri.s,
 					dlg->req_uri.len);
 
 			srjson_AddStrToObject(
-					&jdoc, jdoc.root, "tag1", dlg->tag[0].s, dlg->tag[0].len);
-			srjson_AddStrToObject(&jdoc, jdoc.root, "cseq1", dlg->cseq[0].s,
+					jdoc, obj, "tag1", dlg->tag[0].s, dlg->tag[0].len);
+			srjson_AddStrToObject(jdoc, obj, "cseq1", dlg->cseq[0].s,
 					dlg->cseq[0].len);
-			srjson_AddStrToObject(&jdoc, jdoc.root, "route_set1",
+			srjson_AddStrToObject(jdoc, obj, "route_set1",
 					dlg->route_set[0].s, dlg->route_set[0].len);
-			srjson_AddStrToObject(&jdoc, jdoc.root, "contact1",
+			srjson_AddStrToObject(jdoc, obj, "contact1",
 					dlg->contact[0].s, dlg->contact[0].len);
 
 			if(dlg->vars != NULL) {
 				srjson_t *pj = NULL;
-				pj = srjson_CreateObject(&jdoc);
+				pj = srjson_CreateObject(jdoc);
 				for(var = dlg->vars; var; var = var->next) {
-					srjson_AddStrToObject(&jdoc, pj, var->key.s, var->value.s,
+					srjson_AddStrToObject(jdoc, pj, var->key.s, var->value.s,
 							var->value.len);
 				}
-				srjson_AddItemToObject(&jdoc, jdoc.root, "vars", pj);
+				srjson_AddItemToObject(jdoc, obj, "vars", pj);
 			}
 
 			if(dlg->profile_links) {
@@ -560,7 +567,7 @@ int dlg_dmq_replicate_action(dlg_dmq_action_t action, dlg_cell_t *dlg,
 				if(prof_jdoc.buf.s != NULL) {
 					LM_DBG("adding profiles: [%.*s]\n", prof_jdoc.buf.len,
 							prof_jdoc.buf.s);
-					srjson_AddStrToObject(&jdoc, jdoc.root, "profiles",
+					srjson_AddStrToObject(jdoc, obj, "profiles",
 							prof_jdoc.buf.s, prof_jdoc.buf.len);
 					prof_jdoc.free_fn(prof_jdoc.buf.s);
 					prof_jdoc.buf.s = NULL;
@@ -570,48 +577,48 @@ int dlg_dmq_replicate_action(dlg_dmq_action_t action, dlg_cell_t *dlg,
 			/* intentional fallthrough */
 
 		case DLG_DMQ_STATE:
-			srjson_AddNumberToObject(&jdoc, jdoc.root, "state", dlg->state);
+			srjson_AddNumberToObject(jdoc, obj, "state", dlg->state);
 			switch(dlg->state) {
 				case DLG_STATE_EARLY:
 					srjson_AddNumberToObject(
-							&jdoc, jdoc.root, "start_ts", dlg->start_ts);
+							jdoc, obj, "start_ts", dlg->start_ts);
 					srjson_AddNumberToObject(
-							&jdoc, jdoc.root, "lifetime", dlg->lifetime);
+							jdoc, obj, "lifetime", dlg->lifetime);
 
 					if(action != DLG_DMQ_UPDATE) {
-						srjson_AddStrToObject(&jdoc, jdoc.root, "tag1",
+						srjson_AddStrToObject(jdoc, obj, "tag1",
 								dlg->tag[0].s, dlg->tag[0].len);
-						srjson_AddStrToObject(&jdoc, jdoc.root, "cseq1",
+						srjson_AddStrToObject(jdoc, obj, "cseq1",
 								dlg->cseq[0].s, dlg->cseq[0].len);
-						srjson_AddStrToObject(&jdoc, jdoc.root, "route_set1",
+						srjson_AddStrToObject(jdoc, obj, "route_set1",
 								dlg->route_set[0].s, dlg->route_set[0].len);
-						srjson_AddStrToObject(&jdoc, jdoc.root, "contact1",
+						srjson_AddStrToObject(jdoc, obj, "contact1",
 								dlg->contact[0].s, dlg->contact[0].len);
 					}
 					break;
 				case DLG_STATE_CONFIRMED:
 					srjson_AddNumberToObject(
-							&jdoc, jdoc.root, "start_ts", dlg->start_ts);
+							jdoc, obj, "start_ts", dlg->start_ts);
 					srjson_AddNumberToObject(
-							&jdoc, jdoc.root, "lifetime", dlg->lifetime);
+							jdoc, obj, "lifetime", dlg->lifetime);
 
 					if(action != DLG_DMQ_UPDATE) {
-						srjson_AddStrToObject(&jdoc, jdoc.root, "tag1",
+						srjson_AddStrToObject(jdoc, obj, "tag1",
 								dlg->tag[0].s, dlg->tag[0].len);
-						srjson_AddStrToObject(&jdoc, jdoc.root, "cseq1",
+						srjson_AddStrToObject(jdoc, obj, "cseq1",
 								dlg->cseq[0].s, dlg->cseq[0].len);
-						srjson_AddStrToObject(&jdoc, jdoc.root, "route_set1",
+						srjson_AddStrToObject(jdoc, obj, "route_set1",
 								dlg->route_set[0].s, dlg->route_set[0].len);
-						srjson_AddStrToObject(&jdoc, jdoc.root, "contact1",
+						srjson_AddStrToObject(jdoc, obj, "contact1",
 								dlg->contact[0].s, dlg->contact[0].len);
 					}
-					srjson_AddStrToObject(&jdoc, jdoc.root, "tag2",
+					srjson_AddStrToObject(jdoc, obj, "tag2",
 							dlg->tag[1].s, dlg->tag[1].len);
-					srjson_AddStrToObject(&jdoc, jdoc.root, "cseq2",
+					srjson_AddStrToObject(jdoc, obj, "cseq2",
 							dlg->cseq[1].s, dlg->cseq[1].len);
-					srjson_AddStrToObject(&jdoc, jdoc.root, "route_set2",
+					srjson_AddStrToObject(jdoc, obj, "route_set2",
 							dlg->route_set[1].s, dlg->route_set[1].len);
-					srjson_AddStrToObject(&jdoc, jdoc.root, "contact2",
+					srjson_AddStrToObject(jdoc, obj, "contact2",
 							dlg->contact[1].s, dlg->contact[1].len);
 					break;
 				case DLG_STATE_DELETED:
@@ -623,7 +630,7 @@ int dlg_dmq_replicate_action(dlg_dmq_action_t action, dlg_cell_t *dlg,
 			break;
 
 		case DLG_DMQ_RM:
-			srjson_AddNumberToObject(&jdoc, jdoc.root, "state", dlg->state);
+			srjson_AddNumberToObject(jdoc, obj, "state", dlg->state);
 			dlg->iflags &= ~DLG_IFLAG_DMQ_SYNC;
 			break;
 
@@ -631,6 +638,50 @@ int dlg_dmq_replicate_action(dlg_dmq_action_t action, dlg_cell_t *dlg,
 		case DLG_DMQ_SYNC:
 			break;
 	}
+}
+
+
+int dlg_dmq_replicate_action(dlg_dmq_action_t action, dlg_cell_t *dlg,
+		int needlock, dmq_node_t *node)
+{
+
+	srjson_doc_t jdoc;
+
+	LM_DBG("replicating action [%d] on [%u:%u] to dmq peers\n", action,
+			dlg->h_entry, dlg->h_id);
+
+	if(action == DLG_DMQ_UPDATE) {
+		if(!node && (dlg->iflags & DLG_IFLAG_DMQ_SYNC)
+				&& ((dlg->dflags & DLG_FLAG_CHANGED_PROF) == 0)) {
+			LM_DBG("dlg not changed, no sync\n");
+			return 1;
+		}
+	} else if((dlg->iflags & DLG_IFLAG_DMQ_SYNC) == 0) {
+		LM_DBG("dlg not synced, no sync\n");
+		return 1;
+	}
+	if(action == DLG_DMQ_STATE
+			&& (dlg->state != DLG_STATE_CONFIRMED
+					&& dlg->state != DLG_STATE_DELETED
+					&& dlg->state != DLG_STATE_EARLY)) {
+		LM_DBG("not syncing state %u\n", dlg->state);
+		return 1;
+	}
+
+	srjson_InitDoc(&jdoc, NULL);
+
+	jdoc.root = srjson_CreateObject(&jdoc);
+	if(jdoc.root == NULL) {
+		LM_ERR("cannot create json root\n");
+		goto error;
+	}
+
+	if(needlock)
+		dlg_lock(d_table, &(d_table->entries[dlg->h_entry]));
+
+	srjson_AddNumberToObject(&jdoc, jdoc.root, "action", action);
+	dlg_dmq_json_add_dlg(&jdoc, jdoc.root, action, dlg);
+
 	if(needlock)
 		dlg_unlock(d_table, &(d_table->entries[dlg->h_entry]));
 
@@ -660,26 +711,117 @@ error:
 }
 
 
+/**
+* @brief start a batch document packing multiple dialogs in one message
+*/
+static int dlg_dmq_batch_init(srjson_doc_t *jdoc, srjson_t **aj)
+{
+	srjson_InitDoc(jdoc, NULL);
+	jdoc->root = srjson_CreateObject(jdoc);
+	if(jdoc->root == NULL) {
+		LM_ERR("cannot create json root\n");
+		return -1;
+	}
+	srjson_AddNumberToObject(jdoc, jdoc->root, "action", DLG_DMQ_UPDATE);
+	*aj = srjson_CreateArray(jdoc);
+	if(*aj == NULL) {
+		LM_ERR("cannot create json dialogs array\n");
+		srjson_DestroyDoc(jdoc);
+		return -1;
+	}
+	srjson_AddItemToObject(jdoc, jdoc->root, "dialogs", *aj);
+	return 0;
+}
+
+
+/**
+* @brief serialize and send the batch document
+*/
+static int dlg_dmq_batch_send(srjson_doc_t *jdoc, dmq_node_t *node)
+{
+	int ret = 0;
+
+	jdoc->buf.s = srjson_PrintUnformatted(jdoc, jdoc->root);
+	if(jdoc->buf.s == NULL) {
+		LM_ERR("unable to serialize data\n");
+		srjson_DestroyDoc(jdoc);
+		return -1;
+	}
+	jdoc->buf.len = strlen(jdoc->buf.s);
+	LM_DBG("sending serialized data %.*s\n", jdoc->buf.len, jdoc->buf.s);
+	if(dlg_dmq_send(&jdoc->buf, node) != 0)
+		ret = -1;
+	jdoc->free_fn(jdoc->buf.s);
+	jdoc->buf.s = NULL;
+	srjson_DestroyDoc(jdoc);
+	return ret;
+}
+
+
 int dmq_send_all_dlgs(dmq_node_t *dmq_node)
 {
 	int index;
 	dlg_entry_t *entry;
 	dlg_cell_t *dlg;
+	srjson_doc_t jdoc;
+	srjson_t *aj = NULL;
+	srjson_t *pj = NULL;
+	int n = 0;
 
 	LM_DBG("sending all dialogs \n");
 
+	if(dlg_dmq_batch_dlgs <= 0) {
+		/* one message per dialog */
+		for(index = 0; index < d_table->size; index++) {
+			/* lock the whole entry */
+			entry = &d_table->entries[index];
+			dlg_lock(d_table, entry);
+
+			for(dlg = entry->first; dlg != NULL; dlg = dlg->next) {
+				dlg->dflags |= DLG_FLAG_CHANGED_PROF;
+				dlg_dmq_replicate_action(DLG_DMQ_UPDATE, dlg, 0, dmq_node);
+			}
+
+			dlg_unlock(d_table, entry);
+		}
+
+		return 0;
+	}
+
+	/* pack up to dlg_dmq_batch_dlgs dialogs per message */
+	if(dlg_dmq_batch_init(&jdoc, &aj) < 0)
+		return -1;
+
 	for(index = 0; index < d_table->size; index++) {
-		/* lock the whole entry */
 		entry = &d_table->entries[index];
 		dlg_lock(d_table, entry);
 
 		for(dlg = entry->first; dlg != NULL; dlg = dlg->next) {
 			dlg->dflags |= DLG_FLAG_CHANGED_PROF;
-			dlg_dmq_replicate_action(DLG_DMQ_UPDATE, dlg, 0, dmq_node);
+			pj = srjson_CreateObject(&jdoc);
+			if(pj == NULL) {
+				LM_ERR("cannot create json dialog object\n");
+				continue;
+			}
+			dlg_dmq_json_add_dlg(&jdoc, pj, DLG_DMQ_UPDATE, dlg);
+			srjson_AddItemToArray(&jdoc, aj, pj);
+			n++;
+			if(n >= dlg_dmq_batch_dlgs) {
+				dlg_dmq_batch_send(&jdoc, dmq_node);
+				n = 0;
+				if(dlg_dmq_batch_init(&jdoc, &aj) < 0) {
+					dlg_unlock(d_table, entry);
+					return -1;
+				}
+			}
 		}
 
 		dlg_unlock(d_table, entry);
 	}
 
+	if(n > 0)
+		return dlg_dmq_batch_send(&jdoc, dmq_node);
+
+	srjson_DestroyDoc(&jdoc);
 	return 0;
 }
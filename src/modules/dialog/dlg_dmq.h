@@ -33,6 +33,7 @@
 
 extern dmq_api_t dlg_dmqb;
 extern dmq_peer_t *dlg_dmq_peer;
+extern int dlg_dmq_batch_dlgs;
 
 typedef enum
 {
@@ -59,9 +59,22 @@ extern int dlg_h_id_step;
 /*! global dialog table */
 struct dlg_table *d_table = 0;
 
-dlg_ka_t **dlg_ka_list_head = NULL;
-dlg_ka_t **dlg_ka_list_tail = NULL;
-gen_lock_t *dlg_ka_list_lock = NULL;
+/*! slot of the keep-alive wheel - one list per second of the interval */
+typedef struct dlg_ka_slot
+{
+	gen_lock_t lock;	/*!< lock protecting the slot list */
+	dlg_ka_t *first;	/*!< first keep-alive item in the slot */
+} dlg_ka_slot_t;
+
+/*! keep-alive wheel with one slot per second of the keep-alive interval -
+ * each dialog is hashed to a fixed slot, so the pings sent in one timer
+ * step are only those of the slots covered by that step, instead of all
+ * dialogs that were confirmed within the same second */
+static dlg_ka_slot_t *dlg_ka_slots = NULL;
+static unsigned int dlg_ka_slots_no = 0;
+
+#define dlg_ka_slot_idx(_he, _hi) \
+	((((_he) + (_hi)) * 2654435761u) % dlg_ka_slots_no)
 
 /*!
  * \brief Reference a dialog without locking
@@ -114,8 +127,9 @@ gen_lock_t *dlg_ka_list_lock = NULL;
 int dlg_ka_add(dlg_cell_t *dlg)
 {
 	dlg_ka_t *dka;
+	dlg_ka_slot_t *kslot;
 
-	if(dlg_ka_interval <= 0)
+	if(dlg_ka_interval <= 0 || dlg_ka_slots == NULL)
 		return 0;
 	if(!(dlg->iflags & (DLG_IFLAG_KA_SRC | DLG_IFLAG_KA_DST)))
 		return 0;
@@ -126,19 +140,19 @@ int dlg_ka_add(dlg_cell_t *dlg)
 		return -1;
 	}
 	memset(dka, 0, sizeof(dlg_ka_t));
+	/* do not ping earlier than one interval after confirmation */
 	dka->katime = get_ticks() + dlg_ka_interval;
 	dka->iuid.h_entry = dlg->h_entry;
 	dka->iuid.h_id = dlg->h_id;
 	dka->iflags = dlg->iflags;
 
-	lock_get(dlg_ka_list_lock);
-	if(*dlg_ka_list_tail != NULL)
-		(*dlg_ka_list_tail)->next = dka;
-	if(*dlg_ka_list_head == NULL)
-		*dlg_ka_list_head = dka;
-	*dlg_ka_list_tail = dka;
-	lock_release(dlg_ka_list_lock);
-	LM_DBG("added dlg[%d,%d] to KA list\n", dlg->h_entry, dlg->h_id);
+	kslot = &dlg_ka_slots[dlg_ka_slot_idx(dlg->h_entry, dlg->h_id)];
+	lock_get(&kslot->lock);
+	dka->next = kslot->first;
+	kslot->first = dka;
+	lock_release(&kslot->lock);
+	LM_DBG("added dlg[%d,%d] to KA slot %u\n", dlg->h_entry, dlg->h_id,
+			dlg_ka_slot_idx(dlg->h_entry, dlg->h_id));
 	return 0;
 }
 
@@ -148,44 +162,58 @@ int dlg_ka_add(dlg_cell_t *dlg)
  */
 int dlg_ka_run(ticks_t ti)
 {
+	static ticks_t katlast = 0;
 	dlg_ka_t *dka;
+	dlg_ka_t *dknext;
+	dlg_ka_t *dkprev;
+	dlg_ka_t *dkdue;
+	dlg_ka_t *dkkeep;
+	dlg_ka_slot_t *kslot;
 	dlg_cell_t *dlg;
+	ticks_t ts;
 
-	if(dlg_ka_interval <= 0)
+	if(dlg_ka_interval <= 0 || dlg_ka_slots == NULL)
 		return 0;
 
-	while(1) {
-		/* get head item */
-		lock_get(dlg_ka_list_lock);
-		if(*dlg_ka_list_head == NULL) {
-			lock_release(dlg_ka_list_lock);
-			return 0;
-		}
-		dka = *dlg_ka_list_head;
-#if 0
-		LM_DBG("dlg ka timer at %lu for"
-				" dlg[%u,%u] on %lu\n", (unsigned long)ti,
-				dka->iuid.h_entry, dka->iuid.h_id,
-				(unsigned long)dka->katime);
-#endif
-		if(dka->katime > ti) {
-			lock_release(dlg_ka_list_lock);
-			return 0;
-		}
-		if(*dlg_ka_list_head == *dlg_ka_list_tail) {
-			*dlg_ka_list_head = NULL;
-			*dlg_ka_list_tail = NULL;
-		} else {
-			*dlg_ka_list_head = dka->next;
+	if(katlast == 0 || katlast >= ti)
+		katlast = ti - 1;
+	/* each slot is due once per interval - no point covering more */
+	if(ti - katlast > dlg_ka_slots_no)
+		katlast = ti - dlg_ka_slots_no;
+
+	for(ts = katlast + 1; ts <= ti; ts++) {
+		kslot = &dlg_ka_slots[ts % dlg_ka_slots_no];
+		/* move the due items to a local list */
+		dkdue = NULL;
+		dkprev = NULL;
+		lock_get(&kslot->lock);
+		dka = kslot->first;
+		while(dka != NULL) {
+			dknext = dka->next;
+			if(dka->katime <= ts) {
+				if(dkprev == NULL)
+					kslot->first = dknext;
+				else
+					dkprev->next = dknext;
+				dka->next = dkdue;
+				dkdue = dka;
+			} else {
+				dkprev = dka;
+			}
+			dka = dknext;
 		}
-		lock_release(dlg_ka_list_lock);
-
-		/* send keep-alive for dka */
-		dlg = dlg_get_by_iuid(&dka->iuid);
-		if(dlg == NULL) {
-			shm_free(dka);
-			dka = NULL;
-		} else {
+		lock_release(&kslot->lock);
+
+		/* send keep-alives without holding the slot lock */
+		dkkeep = NULL;
+		while(dkdue != NULL) {
+			dka = dkdue;
+			dkdue = dka->next;
+			dlg = dlg_get_by_iuid(&dka->iuid);
+			if(dlg == NULL) {
+				shm_free(dka);
+				continue;
+			}
 			if((dka->iflags & DLG_IFLAG_KA_SRC)
 					&& (dlg->state == DLG_STATE_CONFIRMED))
 				dlg_send_ka(dlg, DLG_CALLER_LEG);
@@ -193,23 +221,28 @@ int dlg_ka_run(ticks_t ti)
 					&& (dlg->state == DLG_STATE_CONFIRMED))
 				dlg_send_ka(dlg, DLG_CALLEE_LEG);
 			if(dlg->state == DLG_STATE_DELETED) {
+				dlg_release(dlg);
 				shm_free(dka);
-				dka = NULL;
+				continue;
 			}
 			dlg_release(dlg);
+			dka->katime = ts + dlg_ka_interval;
+			dka->next = dkkeep;
+			dkkeep = dka;
 		}
-		/* append to tail */
-		if(dka != NULL) {
-			dka->katime = ti + dlg_ka_interval;
-			lock_get(dlg_ka_list_lock);
-			if(*dlg_ka_list_tail != NULL)
-				(*dlg_ka_list_tail)->next = dka;
-			if(*dlg_ka_list_head == NULL)
-				*dlg_ka_list_head = dka;
-			*dlg_ka_list_tail = dka;
-			lock_release(dlg_ka_list_lock);
+		/* put the items that are still alive back in their slot */
+		if(dkkeep != NULL) {
+			lock_get(&kslot->lock);
+			while(dkkeep != NULL) {
+				dka = dkkeep;
+				dkkeep = dka->next;
+				dka->next = kslot->first;
+				kslot->first = dka;
+			}
+			lock_release(&kslot->lock);
 		}
 	}
+	katlast = ti;
 
 	return 0;
 }
@@ -272,24 +305,24 @@ int init_dlg_table(unsigned int size)
 {
 	unsigned int i;
 
-	dlg_ka_list_head = (dlg_ka_t **)shm_malloc(sizeof(dlg_ka_t *));
-	if(dlg_ka_list_head == NULL) {
-		LM_ERR("no more shm mem (h)\n");
-		goto error0;
-	}
-	dlg_ka_list_tail = (dlg_ka_t **)shm_malloc(sizeof(dlg_ka_t *));
-	if(dlg_ka_list_tail == NULL) {
-		LM_ERR("no more shm mem (t)\n");
-		goto error0;
-	}
-	*dlg_ka_list_head = NULL;
-	*dlg_ka_list_tail = NULL;
-	dlg_ka_list_lock = (gen_lock_t *)shm_malloc(sizeof(gen_lock_t));
-	if(dlg_ka_list_lock == NULL) {
-		LM_ERR("no more shm mem (l)\n");
-		goto error0;
+	if(dlg_ka_interval > 0) {
+		dlg_ka_slots_no = (unsigned int)dlg_ka_interval;
+		dlg_ka_slots = (dlg_ka_slot_t *)shm_malloc(
+				dlg_ka_slots_no * sizeof(dlg_ka_slot_t));
+		if(dlg_ka_slots == NULL) {
+			LM_ERR("no more shm mem (k)\n");
+			goto error0;
+		}
+		memset(dlg_ka_slots, 0, dlg_ka_slots_no * sizeof(dlg_ka_slot_t));
+		for(i = 0; i < dlg_ka_slots_no; i++) {
+			if(lock_init(&dlg_ka_slots[i].lock) < 0) {
+				LM_ERR("failed to init lock for ka slot: %d\n", i);
+				while(i > 0)
+					lock_destroy(&dlg_ka_slots[--i].lock);
+				goto error0;
+			}
+		}
 	}
-	lock_init(dlg_ka_list_lock);
 
 	d_table = (struct dlg_table *)shm_malloc(
 			sizeof(struct dlg_table) + size * sizeof(struct dlg_entry));
@@ -322,12 +355,10 @@ error1:
 	shm_free(d_table);
 	d_table = NULL;
 error0:
-	if(dlg_ka_list_head != NULL)
-		shm_free(dlg_ka_list_head);
-	if(dlg_ka_list_tail != NULL)
-		shm_free(dlg_ka_list_tail);
-	dlg_ka_list_head = NULL;
-	dlg_ka_list_tail = NULL;
+	if(dlg_ka_slots != NULL)
+		shm_free(dlg_ka_slots);
+	dlg_ka_slots = NULL;
+	dlg_ka_slots_no = 0;
 	return -1;
 }
 
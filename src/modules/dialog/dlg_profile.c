@@ -197,19 +197,24 @@ static struct dlg_profile_table *new_dlg_profile(
 	memset(profile, 0, len);
 	profile->size = size;
 	profile->has_value = (has_value == 0) ? 0 : 1;
-
-	/* init lock */
-	if(lock_init(&profile->lock) == NULL) {
-		LM_ERR("failed to init lock\n");
-		shm_free(profile);
-		return NULL;
-	}
+	atomic_set(&profile->count, 0);
 
 	/* set inner pointers */
 	profile->entries = (struct dlg_profile_entry *)(profile + 1);
 	profile->name.s = ((char *)profile->entries)
 					  + size * sizeof(struct dlg_profile_entry);
 
+	/* init per entry locks */
+	for(i = 0; i < size; i++) {
+		if(lock_init(&profile->entries[i].lock) == NULL) {
+			LM_ERR("failed to init lock of entry %u\n", i);
+			while(i > 0)
+				lock_destroy(&profile->entries[--i].lock);
+			shm_free(profile);
+			return NULL;
+		}
+	}
+
 	/* copy the name of the profile */
 	memcpy(profile->name.s, name->s, name->len);
 	profile->name.len = name->len;
@@ -235,10 +240,13 @@ static struct dlg_profile_table *new_dlg_profile(
  */
 static void destroy_dlg_profile(struct dlg_profile_table *profile)
 {
+	unsigned int i;
+
 	if(profile == NULL)
 		return;
 
-	lock_destroy(&profile->lock);
+	for(i = 0; i < profile->size; i++)
+		lock_destroy(&profile->entries[i].lock);
 	shm_free(profile);
 	return;
 }
@@ -276,7 +284,7 @@ void destroy_linkers(struct dlg_profile_link *linker)
 		/* unlink from profile table */
 		if(l->hash_linker.next) {
 			p_entry = &l->profile->entries[l->hash_linker.hash];
-			lock_get(&l->profile->lock);
+			lock_get(&p_entry->lock);
 			lh = &l->hash_linker;
 			/* last element on the list? */
 			if(lh == lh->next) {
@@ -289,7 +297,8 @@ void destroy_linkers(struct dlg_profile_link *linker)
 			}
 			lh->next = lh->prev = NULL;
 			p_entry->content--;
-			lock_release(&l->profile->lock);
+			atomic_dec(&l->profile->count);
+			lock_release(&p_entry->lock);
 		}
 		/* free memory */
 		shm_free(l);
@@ -336,8 +345,8 @@ void remove_expired_remote_profiles(time_t te)
 		if(profile->flags & FLAG_PROFILE_REMOTE) {
 			for(i = 0; i < profile->size; i++) {
 				/* space for optimization */
-				lock_get(&profile->lock);
 				p_entry = &profile->entries[i];
+				lock_get(&p_entry->lock);
 				lh = p_entry->first;
 				while(lh) {
 					kh = lh->next;
@@ -355,12 +364,13 @@ void remove_expired_remote_profiles(time_t te)
 						if(lh->linker)
 							shm_free(lh->linker);
 						p_entry->content--;
-						lock_release(&profile->lock);
+						atomic_dec(&profile->count);
+						lock_release(&p_entry->lock);
 						return;
 					}
 					lh = kh;
 				}
-				lock_release(&profile->lock);
+				lock_release(&p_entry->lock);
 			}
 		}
 	}
@@ -379,8 +389,8 @@ int remove_profile(dlg_profile_table_t *profile, str *value, str *puid)
 	struct dlg_profile_hash *lh;
 
 	hash = calc_hash_profile(value, puid, profile);
-	lock_get(&profile->lock);
 	p_entry = &profile->entries[hash];
+	lock_get(&p_entry->lock);
 	lh = p_entry->first;
 	if(lh) {
 		do {
@@ -401,13 +411,14 @@ int remove_profile(dlg_profile_table_t *profile, str *value, str *puid)
 				if(lh->linker)
 					shm_free(lh->linker);
 				p_entry->content--;
-				lock_release(&profile->lock);
+				atomic_dec(&profile->count);
+				lock_release(&p_entry->lock);
 				return 1;
 			}
 			lh = lh->next;
 		} while(lh != p_entry->first);
 	}
-	lock_release(&profile->lock);
+	lock_release(&p_entry->lock);
 	return 0;
 }
 
@@ -485,7 +496,7 @@ static void link_profile(struct dlg_profile_link *linker, str *vkey)
 
 	/* insert into profile hash table */
 	p_entry = &linker->profile->entries[hash];
-	lock_get(&linker->profile->lock);
+	lock_get(&p_entry->lock);
 	if(p_entry->first) {
 		linker->hash_linker.prev = p_entry->first->prev;
 		linker->hash_linker.next = p_entry->first;
@@ -496,7 +507,8 @@ static void link_profile(struct dlg_profile_link *linker, str *vkey)
 				&linker->hash_linker;
 	}
 	p_entry->content++;
-	lock_release(&linker->profile->lock);
+	atomic_inc(&linker->profile->count);
+	lock_release(&p_entry->lock);
 }
 
 /*!
@@ -849,18 +861,15 @@ unsigned int get_profile_size(struct dlg_profile_table *profile, str *value)
 	struct dlg_profile_hash *ph;
 
 	if(profile->has_value == 0 || value == NULL) {
-		/* iterate through the hash and count all records */
-		lock_get(&profile->lock);
-		for(i = 0, n = 0; i < profile->size; i++)
-			n += profile->entries[i].content;
-		lock_release(&profile->lock);
-		return n;
+		/* the total is maintained atomically on insert and remove,
+		 * no need to take any lock or walk the hash table */
+		return (unsigned int)atomic_get(&profile->count);
 	} else {
 		/* iterate through the hash entry and count only matching */
 		/* calculate the hash position */
 		i = calc_hash_profile(value, NULL, profile);
 		n = 0;
-		lock_get(&profile->lock);
+		lock_get(&profile->entries[i].lock);
 		ph = profile->entries[i].first;
 		if(ph) {
 			do {
@@ -874,7 +883,7 @@ unsigned int get_profile_size(struct dlg_profile_table *profile, str *value)
 				ph = ph->next;
 			} while(ph != profile->entries[i].first);
 		}
-		lock_release(&profile->lock);
+		lock_release(&profile->entries[i].lock);
 		return n;
 	}
 }
@@ -964,19 +973,22 @@ int dlg_set_timeout_by_profile(
 	 */
 
 	if(profile->has_value == 0 || value == NULL) {
-		lock_get(&profile->lock);
-
 		for(i = 0; i < profile->size; i++) {
+			lock_get(&profile->entries[i].lock);
 			ph = profile->entries[i].first;
 
-			if(!ph)
+			if(!ph) {
+				lock_release(&profile->entries[i].lock);
 				continue;
+			}
 
 			do {
 				struct dlg_map_list *d = malloc(sizeof(struct dlg_map_list));
 
-				if(!d)
+				if(!d) {
+					lock_release(&profile->entries[i].lock);
 					goto error;
+				}
 
 				memset(d, 0, sizeof(struct dlg_map_list));
 
@@ -992,13 +1004,13 @@ int dlg_set_timeout_by_profile(
 
 				ph = ph->next;
 			} while(ph != profile->entries[i].first);
-		}
 
-		lock_release(&profile->lock);
+			lock_release(&profile->entries[i].lock);
+		}
 	} else {
 		i = calc_hash_profile(value, NULL, profile);
 
-		lock_get(&profile->lock);
+		lock_get(&profile->entries[i].lock);
 
 		ph = profile->entries[i].first;
 
@@ -1009,8 +1021,10 @@ int dlg_set_timeout_by_profile(
 					struct dlg_map_list *d =
 							malloc(sizeof(struct dlg_map_list));
 
-					if(!d)
+					if(!d) {
+						lock_release(&profile->entries[i].lock);
 						goto error;
+					}
 
 					memset(d, 0, sizeof(struct dlg_map_list));
 
@@ -1029,7 +1043,7 @@ int dlg_set_timeout_by_profile(
 			} while(ph && ph != profile->entries[i].first);
 		}
 
-		lock_release(&profile->lock);
+		lock_release(&profile->entries[i].lock);
 	}
 
 	/* Walk the list and bulk-set the timeout */
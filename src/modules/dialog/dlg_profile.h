@@ -39,6 +39,7 @@
 #include "../../core/utils/srjson.h"
 #include "../../core/utils/sruid.h"
 #include "../../core/locking.h"
+#include "../../core/atomic_ops.h"
 #include "../../core/str.h"
 #include "../../modules/tm/h_table.h"
 
@@ -81,6 +82,7 @@ typedef struct dlg_profile_entry
 {
 	struct dlg_profile_hash *first;
 	unsigned int content; /*!< content of the entry */
+	gen_lock_t lock;	  /*!< lock for operations on the entry */
 } dlg_profile_entry_t;
 
 #define FLAG_PROFILE_REMOTE 1
@@ -93,7 +95,9 @@ typedef struct dlg_profile_table
 	unsigned int
 			has_value; /*!< 0 for profiles without value, otherwise it has a value */
 	int flags;		   /*!< flags related to the profile */
-	gen_lock_t lock; /*! lock for concurrent access */
+	atomic_t count; /*!< number of items over all entries - kept in sync with
+					 * the per entry content counters so the total size can be
+					 * read without taking any lock */
 	struct dlg_profile_entry *entries;
 	struct dlg_profile_table *next;
 } dlg_profile_table_t;
@@ -96,6 +96,7 @@ int dp_fetch_rows = 1000;
 int dp_match_dynamic = 0;
 int dp_append_branch = 1;
 int dp_reload_delta = 5;
+int dp_match_cache_size = 0;
 
 static time_t *dp_rpc_reload_time = NULL;
 /* clang-format off */
@@ -115,6 +116,7 @@ static param_export_t mod_params[]={
 	{ "match_dynamic",	PARAM_INT,	&dp_match_dynamic },
 	{ "append_branch",	PARAM_INT,	&dp_append_branch },
 	{ "reload_delta",	PARAM_INT,	&dp_reload_delta },
+	{ "match_cache_size",	PARAM_INT,	&dp_match_cache_size },
 	{0,0,0}
 };
 
@@ -194,6 +196,14 @@ static int mod_init(void)
 	if(dp_reload_delta < 0)
 		dp_reload_delta = 5;
 
+	if(dp_match_cache_size < 0)
+		dp_match_cache_size = 0;
+
+	if(dp_match_cache_size > 0 && dp_cache_init() != 0) {
+		LM_ERR("could not initialize the match cache\n");
+		return -1;
+	}
+
 	if(init_data() != 0) {
 		LM_ERR("could not initialize data\n");
 		return -1;
@@ -227,6 +237,7 @@ static void mod_destroy(void)
 		shm_free(dp_rpc_reload_time);
 		dp_rpc_reload_time = 0;
 	}
+	dp_cache_destroy();
 	destroy_data();
 }
 
@@ -81,6 +81,7 @@ typedef struct dpl_index
 typedef struct dpl_id
 {
 	int dp_id;
+	unsigned int dflags;	  /*ORed tflags of all its rules*/
 	dpl_index_t *first_index; /*fast access :rules with specific length*/
 	struct dpl_id *next;
 } dpl_id_t, *dpl_id_p;
@@ -99,6 +100,12 @@ typedef struct dp_param
 	} v;
 } dp_param_t, *dp_param_p;
 
+extern int dp_match_cache_size;
+extern unsigned int *dp_reload_gen;
+
+int dp_cache_init(void);
+void dp_cache_destroy(void);
+
 int init_data();
 void destroy_data();
 int dp_load_db();
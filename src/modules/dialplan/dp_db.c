@@ -82,6 +82,9 @@ static dpl_id_p *dp_rules_hash = NULL;
 static int *dp_crt_idx = NULL;
 static int *dp_next_idx = NULL;
 
+/* bumped on every reload - generation stamp for per-process caches */
+unsigned int *dp_reload_gen = NULL;
+
 
 /**
  * check if string has pvs
@@ -241,6 +244,13 @@ int init_data(void)
 	dp_next_idx = p + 1;
 	*dp_crt_idx = *dp_next_idx = 0;
 
+	dp_reload_gen = (unsigned int *)shm_malloc(sizeof(unsigned int));
+	if(!dp_reload_gen) {
+		LM_ERR("out of shm memory\n");
+		return -1;
+	}
+	*dp_reload_gen = 0;
+
 	LM_DBG("trying to initialize data from db\n");
 	if(init_db_data() != 0)
 		return -1;
@@ -272,6 +282,11 @@ void destroy_data(void)
 	if(dp_crt_idx) {
 		shm_free(dp_crt_idx);
 	}
+
+	if(dp_reload_gen) {
+		shm_free(dp_reload_gen);
+		dp_reload_gen = NULL;
+	}
 }
 
 
@@ -362,6 +377,8 @@ int dp_load_db(void)
 end:
 	/*update data*/
 	*dp_crt_idx = *dp_next_idx;
+	/* invalidate the per-process translation caches */
+	(*dp_reload_gen)++;
 	list_hash(*dp_crt_idx);
 	dp_dbf.free_result(dp_db_handle, res);
 	return 0;
@@ -618,6 +635,8 @@ int add_rule2hash(dpl_node_t *rule, int h_index)
 		LM_DBG("new dpl_id %i\n", rule->dpid);
 	}
 
+	crt_idp->dflags |= rule->tflags;
+
 	/*search for the corresponding dpl_index*/
 	for(indexp = last_indexp = crt_idp->first_index; indexp != NULL;
 			last_indexp = indexp, indexp = indexp->next) {
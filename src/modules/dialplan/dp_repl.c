@@ -36,6 +36,8 @@
 #include "../../core/re.h"
 #include "../../core/str_list.h"
 #include "../../core/mem/shm_mem.h"
+#include "../../core/hashes.h"
+#include "../../core/counters.h"
 #include "dialplan.h"
 
 typedef struct dpl_dyn_pcre
@@ -401,6 +403,28 @@ error:
 }
 
 
+static pcre2_match_data *dpl_pcre_md = NULL;
+static uint32_t dpl_pcre_md_pairs = 0;
+
+/* per-process match data reused across matches, grown on demand - the
+ * compiled rules carry the shm general context, so creating match data
+ * from the pattern would do a shm alloc/free round trip on every match */
+static pcre2_match_data *dpl_get_match_data(uint32_t ovecsize)
+{
+	if(dpl_pcre_md == NULL || dpl_pcre_md_pairs < ovecsize) {
+		if(dpl_pcre_md != NULL)
+			pcre2_match_data_free(dpl_pcre_md);
+		dpl_pcre_md = pcre2_match_data_create(ovecsize, NULL);
+		if(dpl_pcre_md == NULL) {
+			LM_ERR("failed to create pcre2 match data\n");
+			dpl_pcre_md_pairs = 0;
+			return NULL;
+		}
+		dpl_pcre_md_pairs = ovecsize;
+	}
+	return dpl_pcre_md;
+}
+
 #define MAX_PHONE_NB_DIGITS 127
 static char dp_output_buf[MAX_PHONE_NB_DIGITS + 1];
 int rule_translate(sip_msg_t *msg, str *instr, dpl_node_t *rule,
@@ -446,7 +470,9 @@ int rule_translate(sip_msg_t *msg, str *instr, dpl_node_t *rule,
 		}
 
 		/*search for the pattern from the compiled subst_exp*/
-		pcre_md = pcre2_match_data_create_from_pattern(subst_comp, NULL);
+		pcre_md = dpl_get_match_data(cap_cnt + 1);
+		if(pcre_md == NULL)
+			return -1;
 		if(pcre2_match(subst_comp, (PCRE2_SPTR)instr->s, (PCRE2_SIZE)instr->len,
 				   0, 0, pcre_md, NULL)
 				<= 0) {
@@ -454,8 +480,6 @@ int rule_translate(sip_msg_t *msg, str *instr, dpl_node_t *rule,
 				   "the match_exp %.*s but not the subst_exp %.*s!\n",
 					instr->len, instr->s, rule->match_exp.len,
 					rule->match_exp.s, rule->subst_exp.len, rule->subst_exp.s);
-			if(pcre_md)
-				pcre2_match_data_free(pcre_md);
 			return -1;
 		}
 		ovector = pcre2_get_ovector_pointer(pcre_md);
@@ -472,8 +496,6 @@ int rule_translate(sip_msg_t *msg, str *instr, dpl_node_t *rule,
 		memcpy(result->s, repl_comp->replacement.s, repl_comp->replacement.len);
 		result->len = repl_comp->replacement.len;
 		result->s[result->len] = '\0';
-		if(pcre_md)
-			pcre2_match_data_free(pcre_md);
 		return 0;
 	}
 
@@ -582,20 +604,152 @@ int rule_translate(sip_msg_t *msg, str *instr, dpl_node_t *rule,
 	}
 
 	result->s[result->len] = '\0';
-	if(pcre_md)
-		pcre2_match_data_free(pcre_md);
 	return 0;
 
 error:
 	result->s = 0;
 	result->len = 0;
-	if(pcre_md)
-		pcre2_match_data_free(pcre_md);
 	return -1;
 }
 
 #define DP_MAX_ATTRS_LEN 255
 static char dp_attrs_buf[DP_MAX_ATTRS_LEN + 1];
+
+counter_handle_t dp_cache_hits;
+counter_handle_t dp_cache_misses;
+
+typedef struct dpl_cache_entry
+{
+	int dpid;
+	unsigned int gen; /* reload generation the entry was filled at */
+	str input;
+	str output;
+	str attrs;
+} dpl_cache_entry_t;
+
+/* per-process memo of translations for dialplans without dynamic
+ * expressions - hash indexed, entries are replaced on collision */
+static dpl_cache_entry_t *dp_match_cache = NULL;
+
+int dp_cache_init(void)
+{
+	counter_register(&dp_cache_hits, "dialplan", "cache_hits", 0, 0, 0,
+			"translations served from the match cache", 0);
+	counter_register(&dp_cache_misses, "dialplan", "cache_misses", 0, 0, 0,
+			"translations not found in the match cache", 0);
+	return 0;
+}
+
+void dp_cache_destroy(void)
+{
+	int i;
+
+	if(dpl_pcre_md != NULL) {
+		pcre2_match_data_free(dpl_pcre_md);
+		dpl_pcre_md = NULL;
+	}
+	if(dp_match_cache == NULL)
+		return;
+	for(i = 0; i < dp_match_cache_size; i++) {
+		if(dp_match_cache[i].input.s != NULL)
+			pkg_free(dp_match_cache[i].input.s);
+	}
+	pkg_free(dp_match_cache);
+	dp_match_cache = NULL;
+}
+
+/* get the slot for <dpid, input>, allocating the per-process table on
+ * first use after forking */
+static dpl_cache_entry_t *dp_cache_entry(int dpid, str *input)
+{
+	unsigned int slot;
+
+	if(dp_match_cache == NULL) {
+		dp_match_cache = (dpl_cache_entry_t *)pkg_malloc(
+				dp_match_cache_size * sizeof(dpl_cache_entry_t));
+		if(dp_match_cache == NULL) {
+			PKG_MEM_ERROR;
+			return NULL;
+		}
+		memset(dp_match_cache, 0,
+				dp_match_cache_size * sizeof(dpl_cache_entry_t));
+	}
+	slot = (get_hash1_raw(input->s, input->len) ^ (unsigned int)dpid)
+		   % (unsigned int)dp_match_cache_size;
+	return &dp_match_cache[slot];
+}
+
+static int dp_cache_lookup(int dpid, str *input, str *output, str *attrs)
+{
+	dpl_cache_entry_t *e;
+
+	e = dp_cache_entry(dpid, input);
+	if(e == NULL)
+		return -1;
+	if(e->input.s == NULL || e->gen != *dp_reload_gen || e->dpid != dpid
+			|| e->input.len != input->len
+			|| memcmp(e->input.s, input->s, input->len) != 0) {
+		counter_inc(dp_cache_misses);
+		return -1;
+	}
+	if(attrs) {
+		attrs->s = 0;
+		attrs->len = 0;
+		if(e->attrs.len > 0) {
+			attrs->s = dp_attrs_buf;
+			memcpy(attrs->s, e->attrs.s, e->attrs.len);
+			attrs->len = e->attrs.len;
+			attrs->s[attrs->len] = '\0';
+		}
+	}
+	if(output) {
+		output->s = dp_output_buf;
+		memcpy(output->s, e->output.s, e->output.len);
+		output->len = e->output.len;
+		output->s[output->len] = '\0';
+	}
+	counter_inc(dp_cache_hits);
+	return 0;
+}
+
+static void dp_cache_store(int dpid, str *input, str *output, str *attrs)
+{
+	dpl_cache_entry_t *e;
+	char *p;
+
+	if(output == NULL || output->len > MAX_PHONE_NB_DIGITS
+			|| (attrs != NULL && attrs->len > DP_MAX_ATTRS_LEN))
+		return;
+	e = dp_cache_entry(dpid, input);
+	if(e == NULL)
+		return;
+	p = (char *)pkg_malloc(
+			input->len + output->len + ((attrs != NULL) ? attrs->len : 0));
+	if(p == NULL) {
+		PKG_MEM_ERROR;
+		return;
+	}
+	if(e->input.s != NULL)
+		pkg_free(e->input.s);
+	memset(e, 0, sizeof(dpl_cache_entry_t));
+	e->dpid = dpid;
+	e->gen = *dp_reload_gen;
+	e->input.s = p;
+	e->input.len = input->len;
+	memcpy(p, input->s, input->len);
+	p += input->len;
+	e->output.s = p;
+	e->output.len = output->len;
+	memcpy(p, output->s, output->len);
+	p += output->len;
+	if(attrs != NULL && attrs->len > 0) {
+		e->attrs.s = p;
+		e->attrs.len = attrs->len;
+		memcpy(p, attrs->s, attrs->len);
+	}
+	return;
+}
+
 int dp_translate_helper(
 		sip_msg_t *msg, str *input, str *output, dpl_id_p idp, str *attrs)
 {
@@ -612,6 +766,13 @@ int dp_translate_helper(
 		return -1;
 	}
 
+	if(dp_match_cache_size > 0 && idp->dflags == 0
+			&& dp_cache_lookup(idp->dp_id, input, output, attrs) == 0) {
+		LM_DBG("translation of [%.*s] served from cache\n", input->len,
+				input->s);
+		return 0;
+	}
+
 	user_len = input->len;
 	for(indexp = idp->first_index; indexp != NULL; indexp = indexp->next)
 		if(!indexp->len || (indexp->len != 0 && indexp->len == user_len))
@@ -640,29 +801,28 @@ search_rule:
 					rez = -1;
 					do {
 						if(rez < 0) {
-							pcre_md = pcre2_match_data_create_from_pattern(
-									re_list->re, NULL);
-							rez = pcre2_match(re_list->re, (PCRE2_SPTR)input->s,
-									(PCRE2_SIZE)input->len, 0, 0, pcre_md,
-									NULL);
+							pcre_md = dpl_get_match_data(1);
+							if(pcre_md != NULL)
+								rez = pcre2_match(re_list->re,
+										(PCRE2_SPTR)input->s,
+										(PCRE2_SIZE)input->len, 0, 0, pcre_md,
+										NULL);
 							LM_DBG("match check: [%.*s] %d\n",
 									re_list->expr.len, re_list->expr.s, rez);
 						} else
 							LM_DBG("match check skipped: [%.*s] %d\n",
 									re_list->expr.len, re_list->expr.s, rez);
 						rt = re_list->next;
-						if(pcre_md)
-							pcre2_match_data_free(pcre_md);
 						pcre2_code_free(re_list->re);
 						pkg_free(re_list);
 						re_list = rt;
 					} while(re_list);
 				} else {
-					pcre_md = pcre2_match_data_create_from_pattern(
-							rulep->match_comp, NULL);
+					pcre_md = dpl_get_match_data(1);
+					if(pcre_md == NULL)
+						return -1;
 					rez = pcre2_match(rulep->match_comp, (PCRE2_SPTR)input->s,
 							(PCRE2_SIZE)input->len, 0, 0, pcre_md, 0);
-					pcre2_match_data_free(pcre_md);
 				}
 				break;
 
@@ -769,5 +929,7 @@ repl:
 			return -1;
 		}
 	}
+	if(dp_match_cache_size > 0 && idp->dflags == 0)
+		dp_cache_store(idp->dp_id, input, output, attrs);
 	return 0;
 }
@@ -82,6 +82,7 @@
 #define DS_ALG_RELWEIGHT 11
 #define DS_ALG_PARALLEL 12
 #define DS_ALG_LATENCY 13
+#define DS_ALG_CHASH 14
 #define DS_ALG_OVERLOAD 64 /* 2^6 - can be also used as a flag */
 
 #define DS_HN_SIZE 256
@@ -985,6 +986,123 @@ randomize:
 	return 0;
 }
 
+/**
+ *
+ */
+static int dp_chash_node_cmp(const void *pa, const void *pb)
+{
+	const ds_chash_node_t *na = (const ds_chash_node_t *)pa;
+	const ds_chash_node_t *nb = (const ds_chash_node_t *)pb;
+
+	if(na->hash != nb->hash)
+		return (na->hash < nb->hash) ? -1 : 1;
+	return na->dst - nb->dst;
+}
+
+/*! \brief build the consistent hashing ring of virtual nodes for a set
+ *
+ * Each destination gets chash_vnodes virtual nodes, hashed from its uri
+ * and the virtual node index, sorted in a ring. The ring covers all the
+ * destinations regardless of their state - unusable ones are skipped at
+ * lookup time, so only their own segments are remapped and flows going
+ * to the other destinations stay where they are.
+ */
+int dp_init_chash_ring(ds_set_t *dset)
+{
+	ds_chash_node_t *ring = NULL;
+	char vbuf[16];
+	str vstr;
+	int j;
+	int v;
+	int t;
+
+	if(dset == NULL || dset->dlist == NULL)
+		return -1;
+
+	if(dset->chash != NULL) {
+		shm_free(dset->chash);
+		dset->chash = NULL;
+		dset->chash_nr = 0;
+	}
+
+	if(ds_chash_vnodes <= 0 || dset->nr <= 0)
+		return 0;
+
+	ring = (ds_chash_node_t *)shm_malloc(
+			dset->nr * ds_chash_vnodes * sizeof(ds_chash_node_t));
+	if(ring == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+
+	t = 0;
+	for(j = 0; j < dset->nr; j++) {
+		for(v = 0; v < ds_chash_vnodes; v++) {
+			vstr.s = vbuf;
+			vstr.len = snprintf(vbuf, sizeof(vbuf), "%d", v);
+			ring[t].hash = ds_get_hash(&dset->dlist[j].uri, &vstr);
+			ring[t].dst = j;
+			t++;
+		}
+	}
+	qsort(ring, t, sizeof(ds_chash_node_t), dp_chash_node_cmp);
+
+	dset->chash = ring;
+	dset->chash_nr = t;
+
+	return 0;
+}
+
+/*! \brief get the destination for a hash from the consistent hashing ring
+ *
+ * Walks the ring from the first virtual node after the hash and returns
+ * the first destination that can be used. When the natural owner of the
+ * segment is skipped, the remap counter of the set is incremented.
+ */
+static int ds_chash_get(ds_set_t *dset, unsigned int hash, int dlimit, int alg)
+{
+	int lo, hi, mid;
+	int pos;
+	int n;
+	int i;
+	int owner = -1;
+
+	if(dset->chash == NULL || dset->chash_nr <= 0 || dlimit <= 0)
+		return -1;
+
+	/* first virtual node with hash >= the message hash (with wrap) */
+	lo = 0;
+	hi = dset->chash_nr;
+	while(lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if(dset->chash[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	pos = (lo == dset->chash_nr) ? 0 : lo;
+
+	for(n = 0; n < dset->chash_nr; n++) {
+		i = dset->chash[(pos + n) % dset->chash_nr].dst;
+		if(i >= dlimit) {
+			/* default destination - not part of the selection */
+			continue;
+		}
+		if(owner == -1)
+			owner = i;
+		if(ds_skip_dst(dset->dlist[i].flags) || ds_oc_skip(dset, alg, i))
+			continue;
+		if(i != owner) {
+			lock_get(&dset->lock);
+			dset->chash_remaps++;
+			lock_release(&dset->lock);
+		}
+		return i;
+	}
+
+	return -1;
+}
+
 /*! \brief  compact destinations from sets for fast access */
 int reindex_dests(ds_set_t *node)
 {
@@ -1027,6 +1145,7 @@ int reindex_dests(ds_set_t *node)
 	node->dlist = dp0;
 	dp_init_weights(node);
 	dp_init_relative_weights(node);
+	dp_init_chash_ring(node);
 
 	return 0;
 
@@ -2706,6 +2825,26 @@ int ds_manage_routes(sip_msg_t *msg, ds_select_state_t *rstate)
 				return -1;
 			xavp_filled = 1;
 			break;
+		case DS_ALG_CHASH: /* 14 - consistent hashing over call-id */
+			if(ds_hash_callid(msg, &hash) != 0) {
+				LM_ERR("can't get callid hash\n");
+				return -1;
+			}
+			i = ds_chash_get(idx, hash,
+					(ds_use_default != 0 && idx->nr != 1) ? idx->nr - 1
+														  : idx->nr,
+					rstate->alg);
+			if(i < 0) {
+				/* no usable destination on the ring - let the generic
+				 * search below pick the default one, if any */
+				hash = 0;
+			} else {
+				/* the ring lookup returned a usable destination - the
+				 * modulo and the search for an active address below
+				 * keep it unchanged */
+				hash = i;
+			}
+			break;
 		case DS_ALG_OVERLOAD: /* 64 - round robin with overload control */
 			lock_get(&idx->lock);
 			hash = idx->last;
@@ -4120,6 +4259,9 @@ static inline int ds_ping_result_helper(ds_set_t *node, int j)
 	return 0;
 }
 
+/* current one second slot within the ping interval (spread mode) */
+static unsigned int _ds_ping_slot = 0;
+
 /**
  *
  */
@@ -4139,6 +4281,13 @@ void ds_ping_set(ds_set_t *node)
 		ds_ping_set(node->next[i]);
 
 	for(j = 0; j < node->nr; j++) {
+		/* with spreading active, ping only the destinations assigned to
+		 * the current one second slot of the interval */
+		if(ds_ping_spread > 0
+				&& (ds_get_hash(&node->dlist[j].uri, NULL)
+						   % (unsigned int)ds_ping_interval)
+						   != _ds_ping_slot)
+			continue;
 		/* skip addresses set in disabled state by admin */
 		if((node->dlist[j].flags & DS_DISABLED_DST) != 0)
 			continue;
@@ -4251,6 +4400,12 @@ void ds_check_timer(unsigned int ticks, void *param)
 		return;
 	}
 
+	if(ds_ping_spread > 0) {
+		/* the timer fires every second - advance the slot so that each
+		 * destination is still pinged once per ds_ping_interval */
+		_ds_ping_slot = (_ds_ping_slot + 1) % (unsigned int)ds_ping_interval;
+	}
+
 	ds_ping_set(_ds_list);
 }
 
@@ -4451,6 +4606,8 @@ void ds_avl_destroy(ds_set_t **node_ptr)
 	}
 	if(node->dlist != NULL)
 		shm_free(node->dlist);
+	if(node->chash != NULL)
+		shm_free(node->chash);
 	shm_free(node);
 
 	*node_ptr = NULL;
@@ -102,6 +102,7 @@ extern str ds_dest_attrs_col;
 
 extern int ds_flags;
 extern int ds_use_default;
+extern int ds_chash_vnodes;
 
 extern str ds_xavp_dst;
 extern int ds_xavp_dst_mode;
@@ -129,6 +130,8 @@ extern pv_spec_t ds_attrs_pv;
 extern struct tm_binds tmb;
 extern str ds_ping_method;
 extern str ds_ping_from;
+extern int ds_ping_interval;
+extern int ds_ping_spread;
 extern int probing_threshold;  /*!< number of failed requests,
 								before a destination is taken into probing */
 extern int inactive_threshold; /*!< number of successful requests,
@@ -255,6 +258,11 @@ typedef struct _ds_dest {
 	struct _ds_dest *next;
 } ds_dest_t;
 
+typedef struct _ds_chash_node {
+	unsigned int hash;	/*!< hash of the virtual node */
+	int dst;			/*!< index of the destination owning it */
+} ds_chash_node_t;
+
 typedef struct _ds_set {
 	int id;				/*!< id of dst set */
 	int nr;				/*!< number of items in dst set */
@@ -264,6 +272,9 @@ typedef struct _ds_set {
 	ds_dest_t *dlist;
 	unsigned int wlist[100];
 	unsigned int rwlist[100];
+	ds_chash_node_t *chash;		/*!< sorted ring of virtual nodes */
+	int chash_nr;				/*!< number of virtual nodes in the ring */
+	unsigned int chash_remaps;	/*!< lookups remapped from an unusable owner */
 	struct _ds_set *next[2];
 	int longer;
 	gen_lock_t lock;
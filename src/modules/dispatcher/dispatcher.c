@@ -75,6 +75,7 @@ char *dslistfile = CFG_DIR"dispatcher.list";
 int  ds_force_dst   = 1;
 int  ds_flags       = 0;
 int  ds_use_default = 0;
+int  ds_chash_vnodes = 128;
 str ds_xavp_dst = str_init("_dsdst_");
 int ds_xavp_dst_mode = 0;
 str ds_xavp_ctx = str_init("_dsctx_");
@@ -101,7 +102,8 @@ int inactive_threshold = 1; /* number of replied requests, before a destination
 							 * is taken into back in active state */
 str ds_ping_method = str_init("OPTIONS");
 str ds_ping_from   = str_init("sip:dispatcher@localhost");
-static int ds_ping_interval = 0;
+int ds_ping_interval = 0;
+int ds_ping_spread = 0;
 int ds_ping_latency_stats = 0;
 int ds_ping_fr_timeout = 0;
 int ds_retain_latency_stats = 0;
@@ -290,6 +292,7 @@ static param_export_t params[]={
 	{"force_dst",       PARAM_INT, &ds_force_dst},
 	{"flags",           PARAM_INT, &ds_flags},
 	{"use_default",     PARAM_INT, &ds_use_default},
+	{"chash_vnodes",    PARAM_INT, &ds_chash_vnodes},
 	{"xavp_dst",        PARAM_STR, &ds_xavp_dst},
 	{"xavp_dst_mode",   PARAM_INT, &ds_xavp_dst_mode},
 	{"xavp_ctx",        PARAM_STR, &ds_xavp_ctx},
@@ -302,6 +305,7 @@ static param_export_t params[]={
 	{"ds_ping_method",     PARAM_STR, &ds_ping_method},
 	{"ds_ping_from",       PARAM_STR, &ds_ping_from},
 	{"ds_ping_interval",   PARAM_INT, &ds_ping_interval},
+	{"ds_ping_spread",     PARAM_INT, &ds_ping_spread},
 	{"ds_ping_fr_timeout", PARAM_INT, &ds_ping_fr_timeout},
 	{"ds_ping_latency_stats", PARAM_INT, &ds_ping_latency_stats},
 	{"ds_retain_latency_stats", PARAM_INT, &ds_retain_latency_stats},
@@ -538,7 +542,23 @@ static int mod_init(void)
 		/*****************************************************
 		 * Register the PING-Timer
 		 *****************************************************/
-		if(ds_timer_mode == 1) {
+		if(ds_ping_spread > 0 && ds_ping_interval <= 1) {
+			LM_WARN("ds_ping_spread needs ds_ping_interval greater than 1"
+					" - disabling it\n");
+			ds_ping_spread = 0;
+		}
+		if(ds_ping_spread > 0) {
+			/* fire every second and ping only the destinations assigned
+			 * to the current slot of the interval, so the probes are
+			 * spread instead of sent in one burst */
+			if(ds_timer_mode == 1) {
+				if(sr_wtimer_add(ds_check_timer, NULL, 1) < 0)
+					return -1;
+			} else {
+				if(register_timer(ds_check_timer, NULL, 1) < 0)
+					return -1;
+			}
+		} else if(ds_timer_mode == 1) {
 			if(sr_wtimer_add(ds_check_timer, NULL, ds_ping_interval) < 0)
 				return -1;
 		} else {
@@ -1942,6 +1962,12 @@ int ds_rpc_print_set(
 		rpc->fault(ctx, 500, "Internal error creating set id");
 		return -1;
 	}
+	if(node->chash_nr > 0
+			&& rpc->struct_add(sh, "u", "CHASH_REMAPS", node->chash_remaps)
+					   < 0) {
+		rpc->fault(ctx, 500, "Internal error creating set remaps");
+		return -1;
+	}
 
 	for(j = 0; j < node->nr; j++) {
 		if(rpc->struct_add(rh, "{", "DEST", &vh) < 0) {
@@ -30,6 +30,7 @@
 #include "../../core/mod_fix.h"
 
 #include "usrloc_sync.h"
+#include "usrloc_journal.h"
 
 static int mod_init(void);
 static int child_init(int);
@@ -45,6 +46,7 @@ int _dmq_usrloc_batch_usleep = 0;
 str _dmq_usrloc_domain = str_init("location");
 int _dmq_usrloc_delete = 1;
 int _dmq_usrloc_delete_expired = 0;
+int _dmq_usrloc_journal_size = 0;
 
 usrloc_api_t dmq_ul;
 
@@ -63,6 +65,7 @@ static param_export_t params[] = {
 	{"usrloc_domain", PARAM_STR, &_dmq_usrloc_domain},
 	{"usrloc_delete", PARAM_INT, &_dmq_usrloc_delete},
 	{"usrloc_delete_expired", PARAM_INT, &_dmq_usrloc_delete_expired},
+	{"journal_size", PARAM_INT, &_dmq_usrloc_journal_size},
 	{0, 0, 0}
 };
 
@@ -119,6 +122,12 @@ static int mod_init(void)
 		} else {
 			LM_ERR("Error in dmq_usrloc_initialize()\n");
 		}
+		if(_dmq_usrloc_journal_size > 0) {
+			if(usrloc_journal_init(_dmq_usrloc_journal_size) < 0) {
+				LM_ERR("failed to initialize the change journal\n");
+				return -1;
+			}
+		}
 	}
 
 	return 0;
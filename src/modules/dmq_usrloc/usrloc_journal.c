@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2014 Andrey Rybkin <rybkin.a@bks.tv>
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Sequence-numbered change journal used to answer peer sync requests with
+ * a delta instead of a full location table walk. The journal records only
+ * the identity (aor, ruid) of changed contacts - the current contact state
+ * is read from usrloc at replay time. Each node tags its updates with a
+ * random instance id (jid) and its journal sequence; receivers remember
+ * the highest sequence per jid and advertise them when requesting sync.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../core/dprint.h"
+#include "../../core/locking.h"
+#include "../../core/ut.h"
+#include "../../core/rand/kam_rand.h"
+#include "../../core/mem/shm_mem.h"
+#include "../../core/utils/sruid.h"
+
+#include "usrloc_sync.h"
+#include "usrloc_journal.h"
+
+/* number of remote journal instances tracked for delta sync */
+#define DMQ_USRLOC_JRN_PEERS 16
+
+typedef struct usrloc_journal_entry
+{
+	unsigned int seq;
+	int action;
+	int aor_len; /* -1 if the change could not be journaled */
+	int ruid_len;
+	char aor[DMQ_USRLOC_JRN_AOR_SIZE];
+	char ruid[SRUID_SIZE];
+} usrloc_journal_entry_t;
+
+typedef struct usrloc_journal_peer
+{
+	char jid[DMQ_USRLOC_JID_LEN + 1];
+	unsigned int seq;
+} usrloc_journal_peer_t;
+
+typedef struct usrloc_journal
+{
+	gen_lock_t lock;
+	unsigned int seq; /* last allocated sequence - 0 means empty */
+	int size;
+	char jid[DMQ_USRLOC_JID_LEN + 1];
+	usrloc_journal_peer_t peers[DMQ_USRLOC_JRN_PEERS];
+	usrloc_journal_entry_t ring[1];
+} usrloc_journal_t;
+
+static usrloc_journal_t *_usrloc_journal = NULL;
+
+int usrloc_journal_init(int size)
+{
+	usrloc_journal_t *jl;
+
+	if(size <= 0)
+		return 0;
+
+	jl = (usrloc_journal_t *)shm_malloc(sizeof(usrloc_journal_t)
+										+ (size - 1)
+												  * sizeof(usrloc_journal_entry_t));
+	if(jl == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(jl, 0,
+			sizeof(usrloc_journal_t)
+					+ (size - 1) * sizeof(usrloc_journal_entry_t));
+	if(lock_init(&jl->lock) == NULL) {
+		LM_ERR("failed to init journal lock\n");
+		shm_free(jl);
+		return -1;
+	}
+	jl->size = size;
+	snprintf(jl->jid, DMQ_USRLOC_JID_LEN + 1, "%08x%08x",
+			(unsigned int)time(NULL) ^ (unsigned int)kam_rand(),
+			(unsigned int)kam_rand());
+	_usrloc_journal = jl;
+	LM_DBG("change journal initialized - id [%s] size [%d]\n", jl->jid, size);
+	return 0;
+}
+
+int usrloc_journal_enabled(void)
+{
+	return (_usrloc_journal != NULL) ? 1 : 0;
+}
+
+/**
+ * record a local contact change - an entry that does not fit is kept with
+ * aor_len set to -1 so replay over it falls back to full sync
+ */
+void usrloc_journal_add(int action, str *aor, str *ruid)
+{
+	usrloc_journal_t *jl = _usrloc_journal;
+	usrloc_journal_entry_t *e;
+
+	if(jl == NULL)
+		return;
+
+	lock_get(&jl->lock);
+	jl->seq++;
+	e = &jl->ring[jl->seq % jl->size];
+	e->seq = jl->seq;
+	e->action = action;
+	if(aor->len > DMQ_USRLOC_JRN_AOR_SIZE || ruid->len > SRUID_SIZE
+			|| ruid->len <= 0) {
+		e->aor_len = -1;
+		e->ruid_len = 0;
+		lock_release(&jl->lock);
+		LM_WARN("change not journaled - aor %d / ruid %d bytes\n", aor->len,
+				ruid->len);
+		return;
+	}
+	memcpy(e->aor, aor->s, aor->len);
+	e->aor_len = aor->len;
+	memcpy(e->ruid, ruid->s, ruid->len);
+	e->ruid_len = ruid->len;
+	lock_release(&jl->lock);
+}
+
+/**
+ * copy the entry with the given sequence into the caller provided strs
+ * (their buffers must hold DMQ_USRLOC_JRN_AOR_SIZE / SRUID_SIZE bytes)
+ * \return 0 on success, -1 if the entry was overwritten or not usable
+ */
+int usrloc_journal_fetch(unsigned int seq, int *action, str *aor, str *ruid)
+{
+	usrloc_journal_t *jl = _usrloc_journal;
+	usrloc_journal_entry_t *e;
+
+	if(jl == NULL)
+		return -1;
+
+	lock_get(&jl->lock);
+	e = &jl->ring[seq % jl->size];
+	if(e->seq != seq || e->aor_len < 0) {
+		lock_release(&jl->lock);
+		return -1;
+	}
+	*action = e->action;
+	memcpy(aor->s, e->aor, e->aor_len);
+	aor->len = e->aor_len;
+	memcpy(ruid->s, e->ruid, e->ruid_len);
+	ruid->len = e->ruid_len;
+	lock_release(&jl->lock);
+	return 0;
+}
+
+/**
+ * check whether a delta can be served from the advertised sequences
+ * \return 0 and the replay window (last, cur] on success, -1 if the
+ * requester is unknown or has fallen out of the journal window
+ */
+int usrloc_journal_window(srjson_t *jseqs, unsigned int *last, unsigned int *cur)
+{
+	usrloc_journal_t *jl = _usrloc_journal;
+	srjson_t *it;
+
+	if(jl == NULL || jseqs == NULL)
+		return -1;
+
+	for(it = jseqs->child; it; it = it->next) {
+		if(it->string != NULL && strcmp(it->string, jl->jid) == 0)
+			break;
+	}
+	if(it == NULL) {
+		LM_DBG("requester does not know this journal instance\n");
+		return -1;
+	}
+	*last = SRJSON_GET_UINT(it);
+
+	lock_get(&jl->lock);
+	*cur = jl->seq;
+	lock_release(&jl->lock);
+
+	if(*last > *cur || *cur - *last > (unsigned int)jl->size) {
+		LM_DBG("advertised seq %u outside journal window (cur %u size %d)\n",
+				*last, *cur, jl->size);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * tag an outgoing update with this journal instance and its sequence
+ */
+void usrloc_journal_stamp(srjson_doc_t *jdoc, srjson_t *obj)
+{
+	usrloc_journal_t *jl = _usrloc_journal;
+	unsigned int seq;
+
+	if(jl == NULL)
+		return;
+
+	lock_get(&jl->lock);
+	seq = jl->seq;
+	lock_release(&jl->lock);
+	srjson_AddStrToObject(jdoc, obj, "jid", jl->jid, DMQ_USRLOC_JID_LEN);
+	srjson_AddNumberToObject(jdoc, obj, "jseq", seq);
+}
+
+/**
+ * remember the highest sequence received from a remote journal instance
+ */
+void usrloc_journal_note_peer(str *jid, unsigned int seq)
+{
+	usrloc_journal_t *jl = _usrloc_journal;
+	usrloc_journal_peer_t *p;
+	int i;
+	int empty;
+
+	if(jl == NULL || jid->len != DMQ_USRLOC_JID_LEN)
+		return;
+
+	lock_get(&jl->lock);
+	empty = -1;
+	for(i = 0; i < DMQ_USRLOC_JRN_PEERS; i++) {
+		p = &jl->peers[i];
+		if(p->jid[0] == '\0') {
+			if(empty < 0)
+				empty = i;
+			continue;
+		}
+		if(memcmp(p->jid, jid->s, DMQ_USRLOC_JID_LEN) == 0) {
+			if(seq > p->seq)
+				p->seq = seq;
+			lock_release(&jl->lock);
+			return;
+		}
+	}
+	if(empty < 0) {
+		lock_release(&jl->lock);
+		LM_WARN("journal peer table full - not tracking %.*s\n", jid->len,
+				jid->s);
+		return;
+	}
+	p = &jl->peers[empty];
+	memcpy(p->jid, jid->s, DMQ_USRLOC_JID_LEN);
+	p->jid[DMQ_USRLOC_JID_LEN] = '\0';
+	p->seq = seq;
+	lock_release(&jl->lock);
+}
+
+/**
+ * add the per-instance sequences seen so far to a sync request
+ */
+void usrloc_journal_add_jseqs(srjson_doc_t *jdoc, srjson_t *root)
+{
+	usrloc_journal_t *jl = _usrloc_journal;
+	srjson_t *jseqs;
+	int i;
+
+	if(jl == NULL)
+		return;
+
+	jseqs = srjson_CreateObject(jdoc);
+	if(jseqs == NULL) {
+		LM_ERR("cannot create jseqs object\n");
+		return;
+	}
+	lock_get(&jl->lock);
+	for(i = 0; i < DMQ_USRLOC_JRN_PEERS; i++) {
+		if(jl->peers[i].jid[0] != '\0') {
+			srjson_AddNumberToObject(
+					jdoc, jseqs, jl->peers[i].jid, jl->peers[i].seq);
+		}
+	}
+	lock_release(&jl->lock);
+	srjson_AddItemToObject(jdoc, root, "jseqs", jseqs);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2014 Andrey Rybkin <rybkin.a@bks.tv>
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ *
+ * This file is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _DMQ_USRLOC_JOURNAL_H_
+#define _DMQ_USRLOC_JOURNAL_H_
+
+#include "../../core/str.h"
+#include "../../core/utils/srjson.h"
+#include "../../core/utils/sruid.h"
+
+/* hex chars in the journal instance id */
+#define DMQ_USRLOC_JID_LEN 16
+
+/* largest aor that can be journaled - ruids are bound by SRUID_SIZE */
+#define DMQ_USRLOC_JRN_AOR_SIZE 256
+
+int usrloc_journal_init(int size);
+int usrloc_journal_enabled(void);
+void usrloc_journal_add(int action, str *aor, str *ruid);
+int usrloc_journal_fetch(unsigned int seq, int *action, str *aor, str *ruid);
+int usrloc_journal_window(
+		srjson_t *jseqs, unsigned int *last, unsigned int *cur);
+void usrloc_journal_stamp(srjson_doc_t *jdoc, srjson_t *obj);
+void usrloc_journal_note_peer(str *jid, unsigned int seq);
+void usrloc_journal_add_jseqs(srjson_doc_t *jdoc, srjson_t *root);
+
+#endif
@@ -24,6 +24,7 @@
  */
 
 #include "usrloc_sync.h"
+#include "usrloc_journal.h"
 #include "../usrloc/usrloc.h"
 #include "../usrloc/ul_callback.h"
 #include "../usrloc/dlist.h"
@@ -50,6 +51,8 @@ int usrloc_dmq_send_contact(
 int usrloc_dmq_send_multi_contact(
 		ucontact_t *ptr, str aor, int action, dmq_node_t *node);
 void usrloc_dmq_send_multi_contact_flush(dmq_node_t *node);
+int usrloc_dmq_send_rm(str *aor, str *ruid, dmq_node_t *node);
+int usrloc_dmq_replay_journal(srjson_t *jseqs, dmq_node_t *node);
 
 static int traverse_avp_tree(
 		sr_xavp_t *avp_list, srjson_doc_t *jdoc, srjson_t *root);
@@ -355,6 +358,9 @@ static int usrloc_dmq_execute_action(srjson_t *jdoc_action, dmq_node_t *node)
 		instance = STR_NULL, sockname = STR_NULL;
 	static str host = STR_NULL, c = STR_NULL, callid = STR_NULL,
 			   path = STR_NULL, user_agent = STR_NULL;
+	str jid = STR_NULL;
+	unsigned int jseq = 0;
+	srjson_t *jseqs = NULL;
 
 	sr_xavp_t *xavp = NULL;
 
@@ -437,6 +443,13 @@ static int usrloc_dmq_execute_action(srjson_t *jdoc_action, dmq_node_t *node)
 			reg_id = SRJSON_GET_UINT(it);
 		} else if(strcmp(it->string, "server_id") == 0) {
 			server_id = SRJSON_GET_UINT(it);
+		} else if(strcmp(it->string, "jid") == 0) {
+			jid.s = it->valuestring;
+			jid.len = strlen(jid.s);
+		} else if(strcmp(it->string, "jseq") == 0) {
+			jseq = SRJSON_GET_UINT(it);
+		} else if(strcmp(it->string, "jseqs") == 0) {
+			jseqs = it;
 		} else if(strncmp(it->string, "xavps", 5) == 0) {
 			srjson_to_xavp(it->child, &xavp);
 		} else {
@@ -472,14 +485,18 @@ static int usrloc_dmq_execute_action(srjson_t *jdoc_action, dmq_node_t *node)
 		case DMQ_UPDATE:
 			LM_DBG("Received DMQ_UPDATE. Update contact info...\n");
 			add_contact(aor, &ci);
+			usrloc_journal_note_peer(&jid, jseq);
 			break;
 		case DMQ_RM:
 			LM_DBG("Received DMQ_RM. Delete contact info...\n");
 			delete_contact(aor, &ci);
+			usrloc_journal_note_peer(&jid, jseq);
 			break;
 		case DMQ_SYNC:
 			LM_DBG("Received DMQ_SYNC. Sending all contacts...\n");
-			usrloc_get_all_ucontact(node);
+			if(jseqs == NULL || usrloc_dmq_replay_journal(jseqs, node) < 0) {
+				usrloc_get_all_ucontact(node);
+			}
 			break;
 		case DMQ_NONE:
 			LM_DBG("Received DMQ_NONE. Not used...\n");
@@ -619,6 +636,9 @@ int usrloc_dmq_request_sync()
 	}
 
 	srjson_AddNumberToObject(&jdoc, jdoc.root, "action", DMQ_SYNC);
+	/* advertise the journal sequences seen so far - peers that can serve
+	 * the delta from their change journal skip the full table walk */
+	usrloc_journal_add_jseqs(&jdoc, jdoc.root);
 	jdoc.buf.s = srjson_PrintUnformatted(&jdoc, jdoc.root);
 	if(jdoc.buf.s == NULL) {
 		LM_ERR("unable to serialize data\n");
@@ -795,6 +815,8 @@ int usrloc_dmq_send_multi_contact(
 	jdoc_contact_group.size += snprintf(NULL, 0, "%d", ptr->reg_id);
 	srjson_AddNumberToObject(jdoc, jdoc_contact, "server_id", ptr->server_id);
 	jdoc_contact_group.size += snprintf(NULL, 0, "%d", ptr->server_id);
+	usrloc_journal_stamp(jdoc, jdoc_contact);
+	jdoc_contact_group.size += DMQ_USRLOC_JID_LEN + 32; // "jid":"","jseq":
 
 	char idx[5];
 	jdoc_contact_group.count++;
@@ -860,6 +882,7 @@ int usrloc_dmq_send_contact(
 	srjson_AddNumberToObject(&jdoc, jdoc.root, "methods", ptr->methods);
 	srjson_AddNumberToObject(&jdoc, jdoc.root, "reg_id", ptr->reg_id);
 	srjson_AddNumberToObject(&jdoc, jdoc.root, "server_id", ptr->server_id);
+	usrloc_journal_stamp(&jdoc, jdoc.root);
 
 	/*  Loop through Χavp attributes of the contact and and create a json object */
 	jdoc_xavp = srjson_CreateObject(&jdoc);
@@ -897,6 +920,114 @@ error:
 	return -1;
 }
 
+/**
+ * send a contact removal built from a journal entry - only the identity
+ * is needed, the receiver deletes by ruid
+ */
+int usrloc_dmq_send_rm(str *aor, str *ruid, dmq_node_t *node)
+{
+	srjson_doc_t jdoc;
+	srjson_InitDoc(&jdoc, NULL);
+
+	jdoc.root = srjson_CreateObject(&jdoc);
+	if(!jdoc.root) {
+		LM_ERR("cannot create json root\n");
+		goto error;
+	}
+
+	srjson_AddNumberToObject(&jdoc, jdoc.root, "action", DMQ_RM);
+	srjson_AddStrToObject(&jdoc, jdoc.root, "aor", aor->s, aor->len);
+	srjson_AddStrToObject(&jdoc, jdoc.root, "ruid", ruid->s, ruid->len);
+	usrloc_journal_stamp(&jdoc, jdoc.root);
+
+	jdoc.buf.s = srjson_PrintUnformatted(&jdoc, jdoc.root);
+	if(jdoc.buf.s == NULL) {
+		LM_ERR("unable to serialize data\n");
+		goto error;
+	}
+	jdoc.buf.len = strlen(jdoc.buf.s);
+
+	LM_DBG("sending serialized data %.*s\n", jdoc.buf.len, jdoc.buf.s);
+	if(usrloc_dmq_send(&jdoc.buf, node) != 0) {
+		goto error;
+	}
+
+	jdoc.free_fn(jdoc.buf.s);
+	jdoc.buf.s = NULL;
+	srjson_DestroyDoc(&jdoc);
+	return 0;
+
+error:
+	if(jdoc.buf.s != NULL) {
+		jdoc.free_fn(jdoc.buf.s);
+		jdoc.buf.s = NULL;
+	}
+	srjson_DestroyDoc(&jdoc);
+	return -1;
+}
+
+/**
+ * serve a sync request from the change journal - send the current state
+ * of every contact changed after the sequence advertised by the requester
+ * \return 0 on success, -1 if the delta cannot be served (caller falls
+ * back to the full table walk)
+ */
+int usrloc_dmq_replay_journal(srjson_t *jseqs, dmq_node_t *node)
+{
+	unsigned int last, cur, s;
+	int action;
+	char abuf[DMQ_USRLOC_JRN_AOR_SIZE];
+	char rbuf[SRUID_SIZE];
+	str aor, ruid;
+	udomain_t *_d;
+	urecord_t *r;
+	ucontact_t *ptr;
+	int n = 0;
+
+	if(usrloc_journal_window(jseqs, &last, &cur) < 0)
+		return -1;
+	if(last == cur) {
+		LM_DBG("sync peer is already up to date (seq %u)\n", cur);
+		return 0;
+	}
+	if(dmq_ul.get_udomain(_dmq_usrloc_domain.s, &_d) < 0) {
+		LM_ERR("Failed to get domain\n");
+		return -1;
+	}
+
+	for(s = last + 1; s != cur + 1; s++) {
+		aor.s = abuf;
+		ruid.s = rbuf;
+		if(usrloc_journal_fetch(s, &action, &aor, &ruid) < 0) {
+			LM_DBG("journal entry %u no longer available - full sync\n", s);
+			return -1;
+		}
+		if(action == DMQ_RM) {
+			usrloc_dmq_send_rm(&aor, &ruid, node);
+		} else {
+			r = 0;
+			ptr = 0;
+			if(dmq_ul.get_urecord_by_ruid(
+					   _d, dmq_ul.get_aorhash(&aor), &ruid, &r, &ptr)
+					== 0) {
+				if(_dmq_usrloc_batch_msg_contacts > 1) {
+					usrloc_dmq_send_multi_contact(ptr, aor, DMQ_UPDATE, node);
+				} else {
+					usrloc_dmq_send_contact(ptr, aor, DMQ_UPDATE, node);
+				}
+				dmq_ul.release_urecord(r);
+				dmq_ul.unlock_udomain(_d, &aor);
+			}
+			/* contact gone without a journaled removal - nothing to send */
+		}
+		n++;
+	}
+	usrloc_dmq_send_multi_contact_flush(node);
+	LM_INFO("served sync request with %d journaled changes (seq %u..%u)\n", n,
+			last + 1, cur);
+	return 0;
+}
+
 int traverse_avp_tree(sr_xavp_t *avp_list, srjson_doc_t *jdoc, srjson_t *root)
 {
 	if(!avp_list) {
@@ -1031,18 +1162,22 @@ void dmq_ul_cb_contact(ucontact_t *ptr, int type, void *param)
 		LM_DBG("Replicating local update to other nodes...\n");
 		switch(type) {
 			case UL_CONTACT_INSERT:
+				usrloc_journal_add(DMQ_UPDATE, &aor, &ptr->ruid);
 				usrloc_dmq_send_contact(ptr, aor, DMQ_UPDATE, 0);
 				break;
 			case UL_CONTACT_UPDATE:
+				usrloc_journal_add(DMQ_UPDATE, &aor, &ptr->ruid);
 				usrloc_dmq_send_contact(ptr, aor, DMQ_UPDATE, 0);
 				break;
 			case UL_CONTACT_DELETE:
 				if(_dmq_usrloc_delete >= 1) {
+					usrloc_journal_add(DMQ_RM, &aor, &ptr->ruid);
 					usrloc_dmq_send_contact(ptr, aor, DMQ_RM, 0);
 				}
 				break;
 			case UL_CONTACT_EXPIRE:
 				if(_dmq_usrloc_delete_expired >= 1) {
+					usrloc_journal_add(DMQ_RM, &aor, &ptr->ruid);
 					usrloc_dmq_send_contact(ptr, aor, DMQ_RM, 0);
 				}
 				LM_DBG("Contact <%.*s> expired\n", aor.len, aor.s);
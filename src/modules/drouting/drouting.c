@@ -33,6 +33,7 @@
 #include "../../core/mem/mem.h"
 #include "../../core/mem/shm_mem.h"
 #include "../../core/locking.h"
+#include "../../core/atomic_ops.h"
 #include "../../core/action.h"
 #include "../../core/error.h"
 #include "../../core/ut.h"
@@ -105,10 +106,12 @@ int tree_size = 0;
 int inode = 0;
 int unode = 0;
 
-/* lock, ref counter and flag used for reloading the date */
+/* lock serializing the reloads; readers do not lock - they reference
+ * the current data generation, reloads swap the data pointer, flip the
+ * generation and drain the old one before freeing the old data */
 static gen_lock_t *ref_lock = 0;
-static int *data_refcnt = 0;
-static int *reload_flag = 0;
+static atomic_t *data_refcnt = 0;
+static volatile int *data_crt = 0;
 
 static int dr_init(void);
 static int dr_child_init(int rank);
@@ -235,6 +238,7 @@ static inline int dr_reload_data(void)
 {
 	rt_data_t *new_data;
 	rt_data_t *old_data;
+	int crt;
 
 	new_data = dr_load_routing_info(
 			&dr_dbf, db_hdl, &drd_table, &drl_table, &drr_table);
@@ -243,24 +247,20 @@ static inline int dr_reload_data(void)
 		return -1;
 	}
 
-	/* block access to data for all readers */
+	/* swap in the new data and flip the generation - readers keep
+	 * routing; wait for the old generation to drain before freeing.
+	 * The busy waiting is not critical, at this point the old counter
+	 * can only be decremented */
 	lock_get(ref_lock);
-	*reload_flag = 1;
-	lock_release(ref_lock);
-
-	/* wait for all readers to finish - it's a kind of busy waitting but
-	 * it's not critical;
-	 * at this point, data_refcnt can only be decremented */
-	while(*data_refcnt) {
-		usleep(10);
-	}
-
-	/* no more activ readers -> do the swapping */
 	old_data = *rdata;
 	*rdata = new_data;
-
-	/* release the readers */
-	*reload_flag = 0;
+	crt = *data_crt;
+	membar_write();
+	*data_crt = 1 - crt;
+	while(atomic_get(&data_refcnt[crt]) != 0) {
+		usleep(10);
+	}
+	lock_release(ref_lock);
 
 	/* destroy old data */
 	if(old_data)
@@ -362,18 +362,19 @@ static int dr_init(void)
 		LM_CRIT("failed to init ref_lock\n");
 		goto error;
 	}
-	data_refcnt = (int *)shm_malloc(sizeof(int));
-	reload_flag = (int *)shm_malloc(sizeof(int));
-	if(!data_refcnt || !reload_flag) {
+	data_refcnt = (atomic_t *)shm_malloc(2 * sizeof(atomic_t));
+	data_crt = (int *)shm_malloc(sizeof(int));
+	if(!data_refcnt || !data_crt) {
 		SHM_MEM_ERROR;
 		if(data_refcnt)
 			shm_free(data_refcnt);
-		if(reload_flag)
-			shm_free(reload_flag);
+		if(data_crt)
+			shm_free((void *)data_crt);
 		goto error;
 	}
-	*data_refcnt = 0;
-	*reload_flag = 0;
+	atomic_set(&data_refcnt[0], 0);
+	atomic_set(&data_refcnt[1], 0);
+	*data_crt = 0;
 
 	/* bind to the mysql module */
 	if(db_bind_mod(&db_url, &dr_dbf)) {
@@ -466,8 +467,8 @@ static void dr_exit(void)
 		ref_lock = 0;
 	}
 
-	if(reload_flag)
-		shm_free(reload_flag);
+	if(data_crt)
+		shm_free((void *)data_crt);
 	if(data_refcnt)
 		shm_free(data_refcnt);
 
@@ -739,6 +740,8 @@ static int do_routing(struct sip_msg *msg, int grp_id)
 	static int local_gwlist[DR_MAX_GWLIST];
 	int gwlist_size;
 	int ret;
+	int crt;
+	rt_data_t *rtd;
 	pgw_t *dest;
 
 	ret = -1;
@@ -758,25 +761,24 @@ static int do_routing(struct sip_msg *msg, int grp_id)
 		goto error1;
 	}
 
-/* ref the data for reading */
+/* ref the data for reading - lock-free, a reload swapping the data
+ * meanwhile moves to the other generation and waits for this one to
+ * be released before freeing the old data */
 again:
-	lock_get(ref_lock);
-	/* if reload must be done, do un ugly busy waiting
-	 * until reload is finished */
-	if(*reload_flag) {
-		lock_release(ref_lock);
-		usleep(5);
+	crt = *data_crt;
+	atomic_inc(&data_refcnt[crt]);
+	if(crt != *data_crt) {
+		atomic_dec(&data_refcnt[crt]);
 		goto again;
 	}
-	*data_refcnt = *data_refcnt + 1;
-	lock_release(ref_lock);
+	rtd = *rdata;
 
 	/* search a prefix */
-	rt_info = get_prefix((*rdata)->pt, &uri.user, (unsigned int)grp_id);
+	rt_info = get_prefix(rtd->pt, &uri.user, (unsigned int)grp_id);
 	if(rt_info == 0) {
 		LM_DBG("no matching for prefix \"%.*s\"\n", uri.user.len, uri.user.s);
 		/* try prefixless rules */
-		rt_info = check_rt(&(*rdata)->noprefix, (unsigned int)grp_id);
+		rt_info = check_rt(&rtd->noprefix, (unsigned int)grp_id);
 		if(rt_info == 0) {
 			LM_DBG("no prefixless matching for "
 				   "grp %d\n",
@@ -967,9 +969,7 @@ again:
 	}
 
 	/* we are done reading -> unref the data */
-	lock_get(ref_lock);
-	*data_refcnt = *data_refcnt - 1;
-	lock_release(ref_lock);
+	atomic_dec(&data_refcnt[crt]);
 
 	/* what hev we get here?? */
 	if(ruri == 0) {
@@ -987,9 +987,7 @@ again:
 	return 1;
 error2:
 	/* we are done reading -> unref the data */
-	lock_get(ref_lock);
-	*data_refcnt = *data_refcnt - 1;
-	lock_release(ref_lock);
+	atomic_dec(&data_refcnt[crt]);
 error1:
 	return ret;
 }
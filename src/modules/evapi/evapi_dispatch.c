@@ -27,6 +27,7 @@
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
@@ -57,6 +58,7 @@ extern int _evapi_wait_increase;
 #define EVAPI_IPADDR_SIZE 64
 #define EVAPI_TAG_SIZE 64
 #define CLIENT_BUFFER_SIZE 32768
+#define EVAPI_RELAY_BATCH_SIZE 32
 typedef struct _evapi_client
 {
 	int connected;
@@ -444,6 +446,70 @@ int evapi_dispatch_notify(evapi_msg_t *emsg)
 	return n;
 }
 
+/**
+ * send a batch of messages with one writev() per client - the payloads are
+ * serialized once by the workers and shared across all the subscribers
+ */
+int evapi_dispatch_notify_batch(evapi_msg_t **emsgs, int n)
+{
+	int i;
+	int k;
+	int sent;
+	int wlen;
+	int blen;
+	int iovcnt;
+	struct iovec iov[EVAPI_RELAY_BATCH_SIZE];
+
+	if(_evapi_clients == NULL) {
+		return 0;
+	}
+
+	sent = 0;
+	/* unicast messages target one client only - dispatch them one by one */
+	for(k = 0; k < n; k++) {
+		if(emsgs[k]->unicast) {
+			sent += evapi_dispatch_notify(emsgs[k]);
+		}
+	}
+
+	for(i = 0; i < EVAPI_MAX_CLIENTS; i++) {
+		if(_evapi_clients[i].connected != 1 || _evapi_clients[i].sock < 0) {
+			continue;
+		}
+		iovcnt = 0;
+		blen = 0;
+		for(k = 0; k < n; k++) {
+			if(emsgs[k]->unicast) {
+				continue;
+			}
+			if(emsgs[k]->tag.s == NULL
+					|| (emsgs[k]->tag.len == _evapi_clients[i].stag.len
+							&& strncmp(_evapi_clients[i].stag.s,
+									   emsgs[k]->tag.s, emsgs[k]->tag.len)
+									   == 0)) {
+				iov[iovcnt].iov_base = emsgs[k]->data.s;
+				iov[iovcnt].iov_len = emsgs[k]->data.len;
+				blen += emsgs[k]->data.len;
+				iovcnt++;
+			}
+		}
+		if(iovcnt == 0) {
+			continue;
+		}
+		wlen = writev(_evapi_clients[i].sock, iov, iovcnt);
+		if(wlen != blen) {
+			LM_DBG("failed to write all the batch (%d out of %d) on socket"
+				   " %d index [%d]\n",
+					wlen, blen, _evapi_clients[i].sock, i);
+		}
+		sent += iovcnt;
+	}
+
+	LM_DBG("the batch of %d messages was sent %d times\n", n, sent);
+
+	return sent;
+}
+
 /**
  *
  */
@@ -737,8 +803,14 @@ void evapi_accept_client(
  */
 void evapi_recv_notify(struct ev_loop *loop, struct ev_io *watcher, int revents)
 {
-	evapi_msg_t *emsg = NULL;
+	static char cbuf[sizeof(evapi_msg_t *)];
+	static unsigned int clen = 0;
+	evapi_msg_t *emsgs[EVAPI_RELAY_BATCH_SIZE];
+	char rbuf[EVAPI_RELAY_BATCH_SIZE * sizeof(evapi_msg_t *)];
+	unsigned int tlen;
 	int rlen;
+	int n;
+	int i;
 
 	if(EV_ERROR & revents) {
 		perror("received invalid event\n");
@@ -747,18 +819,46 @@ void evapi_recv_notify(struct ev_loop *loop, struct ev_io *watcher, int revents)
 
 	cfg_update();
 
-	/* read message from client */
-	rlen = read(watcher->fd, &emsg, sizeof(evapi_msg_t *));
+	/* read the pointers queued by the sip workers - as many as already
+	 * pending, so one wake-up drains a burst and the per-client writes
+	 * can be batched */
+	if(clen > 0) {
+		memcpy(rbuf, cbuf, clen);
+	}
+	rlen = read(watcher->fd, rbuf + clen, sizeof(rbuf) - clen);
 
-	if(rlen != sizeof(evapi_msg_t *) || emsg == NULL) {
+	if(rlen <= 0) {
 		LM_ERR("cannot read the sip worker message\n");
 		return;
 	}
 
-	LM_DBG("received [%p] [%.*s] (%d)\n", (void *)emsg, emsg->data.len,
-			emsg->data.s, emsg->data.len);
-	evapi_dispatch_notify(emsg);
-	shm_free(emsg);
+	tlen = clen + (unsigned int)rlen;
+	n = tlen / sizeof(evapi_msg_t *);
+	clen = tlen % sizeof(evapi_msg_t *);
+	if(clen > 0) {
+		/* incomplete pointer - keep the bytes for the next read */
+		memcpy(cbuf, rbuf + n * sizeof(evapi_msg_t *), clen);
+	}
+	if(n == 0) {
+		return;
+	}
+	memcpy(emsgs, rbuf, n * sizeof(evapi_msg_t *));
+	for(i = 0; i < n; i++) {
+		if(emsgs[i] == NULL) {
+			LM_ERR("invalid sip worker message\n");
+			return;
+		}
+		LM_DBG("received [%p] [%.*s] (%d)\n", (void *)emsgs[i],
+				emsgs[i]->data.len, emsgs[i]->data.s, emsgs[i]->data.len);
+	}
+	if(n == 1) {
+		evapi_dispatch_notify(emsgs[0]);
+	} else {
+		evapi_dispatch_notify_batch(emsgs, n);
+	}
+	for(i = 0; i < n; i++) {
+		shm_free(emsgs[i]);
+	}
 }
 
 /**
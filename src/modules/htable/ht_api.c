@@ -40,6 +40,7 @@
 
 
 extern str ht_event_callback;
+extern int ht_lockfree_get;
 
 ht_t *_ht_root = NULL;
 ht_cell_t *ht_expired_cell;
@@ -151,6 +152,8 @@ void ht_slot_lock(ht_t *ht, int idx)
 	mypid = my_pid();
 	if(likely(atomic_get(&ht->entries[idx].locker_pid) != mypid)) {
 		lock_get(&ht->entries[idx].lock);
+		/* make the slot sequence odd - the lock-free readers back off */
+		mb_atomic_inc(&ht->entries[idx].seq);
 		atomic_set(&ht->entries[idx].locker_pid, mypid);
 	} else {
 		/* locked within the same process that executed us */
@@ -165,6 +168,9 @@ void ht_slot_unlock(ht_t *ht, int idx)
 {
 	if(likely(ht->entries[idx].rec_lock_level == 0)) {
 		atomic_set(&ht->entries[idx].locker_pid, 0);
+		/* back to an even sequence - new value tells the lock-free
+		 * readers that their snapshot may have seen the updates */
+		mb_atomic_inc(&ht->entries[idx].seq);
 		lock_release(&ht->entries[idx].lock);
 	} else {
 		/* recursive locked => decrease lock count */
@@ -534,6 +540,8 @@ int ht_set_cell_ex(
 						it->expire = now + exv;
 					}
 				}
+				if(exv > 0)
+					ht_entry_expire_track(&ht->entries[idx], now + exv);
 				if(mode)
 					ht_slot_unlock(ht, idx);
 				return 0;
@@ -571,6 +579,8 @@ int ht_set_cell_ex(
 						it->expire = now + exv;
 					}
 				}
+				if(exv > 0)
+					ht_entry_expire_track(&ht->entries[idx], now + exv);
 				if(mode)
 					ht_slot_unlock(ht, idx);
 				return 0;
@@ -606,6 +616,7 @@ int ht_set_cell_ex(
 		prev->next = cell;
 	}
 	ht->entries[idx].esize++;
+	ht_entry_expire_track(&ht->entries[idx], cell->expire);
 	if(mode)
 		ht_slot_unlock(ht, idx);
 	return 0;
@@ -783,6 +794,7 @@ ht_cell_t *ht_cell_value_add(ht_t *ht, str *name, int val, ht_cell_t *old)
 		return NULL;
 	}
 	it->expire = now + ht->htexpire;
+	ht_entry_expire_track(&ht->entries[idx], it->expire);
 	if(prev == NULL) {
 		if(ht->entries[idx].first != NULL) {
 			it->next = ht->entries[idx].first;
@@ -813,6 +825,88 @@ ht_cell_t *ht_cell_value_add(ht_t *ht, str *name, int val, ht_cell_t *old)
 }
 
 
+/**
+ * attempt to copy the cell without taking the slot lock
+ * - the slot sequence is bumped by ht_slot_lock()/ht_slot_unlock(), thus it
+ *   is odd while a writer is inside the slot; every pointer loaded from the
+ *   slot is dereferenced only after re-reading the sequence, so a pointer
+ *   planted by a concurrent writer is never followed - stale reads land in
+ *   the still-mapped shm pool and the final check discards the snapshot
+ * \return 0 on a consistent snapshot (*res set, NULL when the item is not
+ *   found or expired), -1 when a writer interfered and the locked walk has
+ *   to be done
+ */
+static int ht_cell_pkg_copy_nolock(ht_t *ht, unsigned int idx,
+		unsigned int hid, str *name, ht_cell_t *old, ht_cell_t **res)
+{
+	int seq;
+	int expired;
+	unsigned int msize;
+	ht_cell_t *it;
+	ht_cell_t *cell;
+
+	seq = mb_atomic_get(&ht->entries[idx].seq);
+	if(seq & 1)
+		return -1;
+
+	for(it = ht->entries[idx].first; it != NULL; it = it->next) {
+		/* it was loaded from the slot - recheck the sequence before
+		 * dereferencing it */
+		if(mb_atomic_get(&ht->entries[idx].seq) != seq)
+			return -1;
+		if(it->cellid > hid)
+			break;
+		if(it->cellid != hid || name->len != it->name.len)
+			continue;
+		/* the name is stored inline right after the header - compute the
+		 * pointer from the cell layout instead of loading name.s, which
+		 * can hold garbage if the cell was freed and the chunk reused
+		 * between the sequence recheck and this read */
+		if(strncmp(name->s, (char *)it + sizeof(ht_cell_t), name->len) != 0)
+			continue;
+		/* found - snapshot the fields needed for the copy, validate them */
+		msize = it->msize;
+		expired = (ht->htexpire > 0 && it->expire != 0
+						  && it->expire < time(NULL))
+						  ? 1
+						  : 0;
+		if(mb_atomic_get(&ht->entries[idx].seq) != seq)
+			return -1;
+		if(expired) {
+			/* entry has expired, return NULL */
+			*res = NULL;
+			return 0;
+		}
+		if(old != NULL && old->msize >= msize) {
+			memcpy(old, it, msize);
+			if(mb_atomic_get(&ht->entries[idx].seq) != seq)
+				return -1;
+			*res = old;
+			return 0;
+		}
+		cell = (ht_cell_t *)pkg_malloc(msize);
+		if(cell == NULL) {
+			*res = NULL;
+			return 0;
+		}
+		memcpy(cell, it, msize);
+		if(mb_atomic_get(&ht->entries[idx].seq) != seq) {
+			pkg_free(cell);
+			return -1;
+		}
+		cell->name.s = (char *)cell + sizeof(ht_cell_t);
+		if(cell->flags & AVP_VAL_STR) {
+			cell->value.s.s = (char *)cell->name.s + cell->name.len + 1;
+		}
+		*res = cell;
+		return 0;
+	}
+	if(mb_atomic_get(&ht->entries[idx].seq) != seq)
+		return -1;
+	*res = NULL;
+	return 0;
+}
+
 ht_cell_t *ht_cell_pkg_copy(ht_t *ht, str *name, ht_cell_t *old)
 {
 	unsigned int idx;
@@ -834,6 +928,13 @@ ht_cell_t *ht_cell_pkg_copy(ht_t *ht, str *name, ht_cell_t *old)
 	if(ht->entries[idx].first == NULL)
 		return NULL;
 
+	if(ht_lockfree_get != 0
+			&& ht_cell_pkg_copy_nolock(ht, idx, hid, name, old, &cell) == 0) {
+		atomic_inc(&ht->rd_nolock);
+		return cell;
+	}
+
+	atomic_inc(&ht->rd_locked);
 	ht_slot_lock(ht, idx);
 	it = ht->entries[idx].first;
 	while(it != NULL && it->cellid < hid)
@@ -1114,20 +1215,42 @@ int ht_has_autoexpire(void)
 }
 
 extern int ht_timer_procs;
+extern int ht_expire_budget;
 
 void ht_timer(unsigned int ticks, void *param)
 {
+	/* per-process resume positions, one per hash table, for the
+	 * budget-bounded sweeping */
+	static unsigned int *_ht_sweep_pos = NULL;
+	static int _ht_sweep_cnt = 0;
 	ht_t *ht;
 	ht_cell_t *it;
 	ht_cell_t *it0;
 	time_t now;
+	time_t smin;
+	unsigned int nown;
+	unsigned int c;
 	int i;
+	int k;
 	int istart;
 	int istep;
+	int budget;
 
 	if(_ht_root == NULL)
 		return;
 
+	if(_ht_sweep_pos == NULL) {
+		for(ht = _ht_root; ht != NULL; ht = ht->next)
+			_ht_sweep_cnt++;
+		_ht_sweep_pos = (unsigned int *)pkg_malloc(
+				_ht_sweep_cnt * sizeof(unsigned int));
+		if(_ht_sweep_pos == NULL) {
+			PKG_MEM_ERROR;
+			return;
+		}
+		memset(_ht_sweep_pos, 0, _ht_sweep_cnt * sizeof(unsigned int));
+	}
+
 	now = time(NULL);
 
 	istart = (int)(long)param;
@@ -1137,11 +1260,30 @@ void ht_timer(unsigned int ticks, void *param)
 		istep = ht_timer_procs;
 
 	ht = _ht_root;
+	k = 0;
 	while(ht) {
 		if(ht->htexpire > 0) {
-			for(i = istart; i < ht->htsize; i += istep) {
+			budget = (ht_expire_budget > 0) ? ht_expire_budget : -1;
+			/* number of slots owned by this timer process */
+			nown = (ht->htsize > (unsigned int)istart)
+						   ? ((ht->htsize - istart + istep - 1) / istep)
+						   : 0;
+			for(c = 0; c < nown; c++) {
+				i = istart + (int)(((_ht_sweep_pos[k] + c) % nown) * istep);
+				/* skip the slots with no item due yet - the earliest
+				 * expire time is maintained by the writers under the slot
+				 * lock, the unlocked read here can at most delay a slot
+				 * by one timer run */
+				if(ht->entries[i].min_expire == 0
+						|| ht->entries[i].min_expire > now)
+					continue;
+				if(budget == 0) {
+					/* budget exhausted - resume from this slot next run */
+					break;
+				}
 				/* free entries */
 				ht_slot_lock(ht, i);
+				smin = 0;
 				it = ht->entries[i].first;
 				while(it) {
 					it0 = it->next;
@@ -1156,13 +1298,21 @@ void ht_timer(unsigned int ticks, void *param)
 							it->next->prev = it->prev;
 						ht->entries[i].esize--;
 						ht_cell_free(it);
+					} else if(it->expire != 0
+							  && (smin == 0 || it->expire < smin)) {
+						smin = it->expire;
 					}
 					it = it0;
 				}
+				ht->entries[i].min_expire = smin;
 				ht_slot_unlock(ht, i);
+				if(budget > 0)
+					budget--;
 			}
+			_ht_sweep_pos[k] = (c < nown) ? ((_ht_sweep_pos[k] + c) % nown) : 0;
 		}
 		ht = ht->next;
+		k++;
 	}
 	return;
 }
@@ -1259,6 +1409,7 @@ int ht_set_cell_expire(ht_t *ht, str *name, int type, int_str *val)
 				&& strncmp(name->s, it->name.s, name->len) == 0) {
 			/* update value */
 			it->expire = now;
+			ht_entry_expire_track(&ht->entries[idx], now);
 			ht_slot_unlock(ht, idx);
 			return 0;
 		}
@@ -2015,6 +2166,8 @@ int ht_iterator_setex(str *iname, int exval)
 
 	/* update expire */
 	itb->expire = time(NULL) + exval;
+	ht_entry_expire_track(
+			&_ht_iterators[k].ht->entries[_ht_iterators[k].slot], itb->expire);
 
 	return 0;
 }
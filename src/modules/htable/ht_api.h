@@ -51,8 +51,20 @@ typedef struct _ht_entry
 	gen_lock_t lock;	 /* mutex to access items in the slot */
 	atomic_t locker_pid; /* pid of the process that holds the lock */
 	int rec_lock_level;	 /* recursive lock count */
+	atomic_t seq;		 /* bumped on lock and unlock - odd while locked */
+	time_t min_expire;	 /* earliest expire time of the items in the slot */
 } ht_entry_t;
 
+/* track the earliest expire time of the items in the slot - has to be
+ * called with the slot locked; 0 means no expiring item is known, the
+ * value may lag behind (item removed or expiry extended meanwhile), the
+ * timer recomputes it whenever it sweeps the slot */
+static inline void ht_entry_expire_track(ht_entry_t *e, time_t expire)
+{
+	if(expire != 0 && (e->min_expire == 0 || expire < e->min_expire))
+		e->min_expire = expire;
+}
+
 #define HT_MAX_COLS 8
 #define HT_EVEX_NAME_SIZE 64
 
@@ -76,6 +88,8 @@ typedef struct _ht
 	char evex_name_buf[HT_EVEX_NAME_SIZE];
 	str evex_name;
 	ht_entry_t *entries;
+	atomic_t rd_nolock; /* gets served without taking the slot lock */
+	atomic_t rd_locked; /* gets that fell back to the locked walk */
 	struct _ht *next;
 } ht_t;
 
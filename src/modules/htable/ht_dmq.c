@@ -23,6 +23,8 @@
  */
 
 
+#include <zlib.h>
+
 #include "ht_dmq.h"
 #include "ht_api.h"
 
@@ -46,18 +48,34 @@ typedef struct _ht_dmq_jdoc_cell_group
 } ht_dmq_jdoc_cell_group_t;
 
 static str ht_dmq_content_type = str_init("application/json");
+static str ht_dmq_content_type_bin = str_init("application/octet-stream");
 static str dmq_200_rpl = str_init("OK");
 static str dmq_400_rpl = str_init("Bad Request");
 static str dmq_500_rpl = str_init("Server Internal Error");
 static int dmq_cell_group_empty_size = 12; // {"cells":[]}
-static int dmq_cell_group_max_size = 60000;
 static ht_dmq_jdoc_cell_group_t ht_dmq_jdoc_cell_group;
+/* sequence number of the sync chunks sent by this node */
+static int ht_dmq_snd_seq = 0;
+/* sequence number of the last sync chunk received */
+static int ht_dmq_rcv_seq = 0;
+/* time of the last resync triggered by a chunk gap */
+static time_t ht_dmq_rcv_resync = 0;
 extern int ht_dmq_init_sync;
+extern int ht_dmq_sync_chunk_size;
+extern int ht_dmq_sync_compress;
+
+/* header in front of compressed sync chunks: magic + uncompressed length */
+#define HT_DMQ_ZMAGIC "HTZ0"
+#define HT_DMQ_ZHDR_SIZE 8
+
+/* do not trigger loss resync more often than this (seconds) */
+#define HT_DMQ_RESYNC_MIN_INTERVAL 60
 
 dmq_api_t ht_dmqb;
 dmq_peer_t *ht_dmq_peer = NULL;
 
 int ht_dmq_send(str *body, dmq_node_t *node);
+static int ht_dmq_send_ctype(str *body, dmq_node_t *node, str *ctype);
 int ht_dmq_send_sync(dmq_node_t *node, str *htname);
 int ht_dmq_handle_sync(srjson_doc_t *jdoc);
 
@@ -145,14 +163,23 @@ static int ht_dmq_cell_group_write(str *htname, ht_cell_t *ptr)
 	return 0;
 }
 
-static int ht_dmq_cell_group_flush(dmq_node_t *node)
+static int ht_dmq_cell_group_flush(dmq_node_t *node, int last)
 {
 
 	srjson_doc_t *jdoc = &ht_dmq_jdoc_cell_group.jdoc;
 	srjson_t *jdoc_cells = ht_dmq_jdoc_cell_group.jdoc_cells;
+	str body;
+	str zbuf = STR_NULL;
+	uLongf zlen;
 	int ret = 0;
 
 	srjson_AddItemToObject(jdoc, jdoc->root, "cells", jdoc_cells);
+	/* number the chunks so the receiver can spot lost ones; mark the
+	 * final chunk of the stream */
+	ht_dmq_snd_seq++;
+	srjson_AddNumberToObject(jdoc, jdoc->root, "seq", ht_dmq_snd_seq);
+	if(last)
+		srjson_AddNumberToObject(jdoc, jdoc->root, "last", 1);
 
 	LM_DBG("jdoc size[%d]\n", ht_dmq_jdoc_cell_group.size);
 	jdoc->buf.s = srjson_PrintUnformatted(jdoc, jdoc->root);
@@ -163,15 +190,51 @@ static int ht_dmq_cell_group_flush(dmq_node_t *node)
 	}
 	jdoc->buf.len = strlen(jdoc->buf.s);
 
+	body = jdoc->buf;
+	if(ht_dmq_sync_compress != 0) {
+		zlen = compressBound((uLong)jdoc->buf.len);
+		zbuf.s = (char *)pkg_malloc(HT_DMQ_ZHDR_SIZE + zlen);
+		if(zbuf.s == NULL) {
+			PKG_MEM_ERROR;
+			ret = -1;
+			goto cleanup;
+		}
+		if(compress2((Bytef *)zbuf.s + HT_DMQ_ZHDR_SIZE, &zlen,
+				   (const Bytef *)jdoc->buf.s, (uLong)jdoc->buf.len,
+				   Z_DEFAULT_COMPRESSION)
+				!= Z_OK) {
+			/* send this chunk uncompressed */
+			LM_ERR("failed to compress sync chunk - sending it plain\n");
+			pkg_free(zbuf.s);
+			zbuf.s = NULL;
+		} else {
+			memcpy(zbuf.s, HT_DMQ_ZMAGIC, 4);
+			zbuf.s[4] = (jdoc->buf.len >> 24) & 0xff;
+			zbuf.s[5] = (jdoc->buf.len >> 16) & 0xff;
+			zbuf.s[6] = (jdoc->buf.len >> 8) & 0xff;
+			zbuf.s[7] = jdoc->buf.len & 0xff;
+			zbuf.len = HT_DMQ_ZHDR_SIZE + (int)zlen;
+			body = zbuf;
+		}
+	}
+
 	LM_DBG("sending serialized data %.*s\n", jdoc->buf.len, jdoc->buf.s);
-	if(ht_dmq_send(&jdoc->buf, node) != 0) {
+	if(ht_dmq_send_ctype(&body, node,
+			   (body.s == zbuf.s) ? &ht_dmq_content_type_bin
+								  : &ht_dmq_content_type)
+			!= 0) {
 		LM_ERR("unable to send data\n");
 		ret = -1;
 	}
 
 cleanup:
 
+	if(zbuf.s != NULL)
+		pkg_free(zbuf.s);
 	srjson_DeleteItemFromObject(jdoc, jdoc->root, "cells");
+	srjson_DeleteItemFromObject(jdoc, jdoc->root, "seq");
+	if(last)
+		srjson_DeleteItemFromObject(jdoc, jdoc->root, "last");
 	ht_dmq_jdoc_cell_group.count = 0;
 	ht_dmq_jdoc_cell_group.size = dmq_cell_group_empty_size;
 
@@ -209,6 +272,12 @@ int ht_dmq_initialize()
 {
 	dmq_peer_t not_peer;
 
+	if(ht_dmq_sync_chunk_size < 1024) {
+		LM_WARN("dmq_sync_chunk_size %d too small - using 1024\n",
+				ht_dmq_sync_chunk_size);
+		ht_dmq_sync_chunk_size = 1024;
+	}
+
 	/* load the DMQ API */
 	if(dmq_load_api(&ht_dmqb) != 0) {
 		LM_ERR("cannot load dmq api\n");
@@ -236,7 +305,7 @@ error:
 	return -1;
 }
 
-int ht_dmq_send(str *body, dmq_node_t *node)
+static int ht_dmq_send_ctype(str *body, dmq_node_t *node, str *ctype)
 {
 	if(!ht_dmq_peer) {
 		LM_ERR("ht_dmq_peer is null!\n");
@@ -244,16 +313,19 @@ int ht_dmq_send(str *body, dmq_node_t *node)
 	}
 	if(node) {
 		LM_DBG("sending dmq message ...\n");
-		ht_dmqb.send_message(
-				ht_dmq_peer, body, node, NULL, 1, &ht_dmq_content_type);
+		ht_dmqb.send_message(ht_dmq_peer, body, node, NULL, 1, ctype);
 	} else {
 		LM_DBG("sending dmq broadcast...\n");
-		ht_dmqb.bcast_message(
-				ht_dmq_peer, body, 0, NULL, 1, &ht_dmq_content_type);
+		ht_dmqb.bcast_message(ht_dmq_peer, body, 0, NULL, 1, ctype);
 	}
 	return 0;
 }
 
+int ht_dmq_send(str *body, dmq_node_t *node)
+{
+	return ht_dmq_send_ctype(body, node, &ht_dmq_content_type);
+}
+
 /**
  * @brief ht dmq callback
  */
@@ -262,6 +334,9 @@ int ht_dmq_handle_msg(
 {
 	int content_length;
 	str body;
+	str dbuf = STR_NULL;
+	uLongf dlen;
+	unsigned int ulen;
 	ht_dmq_action_t action = HT_DMQ_NONE;
 	str htname = str_init("");
 	str cname;
@@ -293,6 +368,36 @@ int ht_dmq_handle_msg(
 		goto error;
 	}
 
+	if(body.len > HT_DMQ_ZHDR_SIZE
+			&& strncmp(body.s, HT_DMQ_ZMAGIC, 4) == 0) {
+		/* compressed sync chunk - uncompressed length is in the header */
+		ulen = (((unsigned char)body.s[4]) << 24)
+			   | (((unsigned char)body.s[5]) << 16)
+			   | (((unsigned char)body.s[6]) << 8)
+			   | ((unsigned char)body.s[7]);
+		if(ulen == 0 || ulen > 16 * 1024 * 1024) {
+			LM_ERR("invalid uncompressed length %u\n", ulen);
+			goto invalid;
+		}
+		dbuf.s = (char *)pkg_malloc(ulen + 1);
+		if(dbuf.s == NULL) {
+			PKG_MEM_ERROR;
+			goto error;
+		}
+		dlen = ulen;
+		if(uncompress((Bytef *)dbuf.s, &dlen,
+				   (const Bytef *)body.s + HT_DMQ_ZHDR_SIZE,
+				   (uLong)(body.len - HT_DMQ_ZHDR_SIZE))
+						!= Z_OK
+				|| dlen != ulen) {
+			LM_ERR("failed to uncompress sync chunk\n");
+			goto invalid;
+		}
+		dbuf.s[ulen] = '\0';
+		dbuf.len = (int)ulen;
+		body = dbuf;
+	}
+
 	/* parse body */
 	LM_DBG("body: %.*s\n", body.len, body.s);
 
@@ -345,18 +450,24 @@ int ht_dmq_handle_msg(
 		}
 	}
 
+	if(dbuf.s != NULL)
+		pkg_free(dbuf.s);
 	srjson_DestroyDoc(&jdoc);
 	resp->reason = dmq_200_rpl;
 	resp->resp_code = 200;
 	return 0;
 
 invalid:
+	if(dbuf.s != NULL)
+		pkg_free(dbuf.s);
 	srjson_DestroyDoc(&jdoc);
 	resp->reason = dmq_400_rpl;
 	resp->resp_code = 400;
 	return 0;
 
 error:
+	if(dbuf.s != NULL)
+		pkg_free(dbuf.s);
 	srjson_DestroyDoc(&jdoc);
 	resp->reason = dmq_500_rpl;
 	resp->resp_code = 500;
@@ -523,6 +634,8 @@ int ht_dmq_send_sync(dmq_node_t *node, str *htname)
 	if(ht_dmq_cell_group_init() < 0)
 		return -1;
 
+	ht_dmq_snd_seq = 0;
+
 	now = time(NULL);
 
 	while(ht != NULL) {
@@ -552,11 +665,11 @@ int ht_dmq_send_sync(dmq_node_t *node, str *htname)
 					goto error;
 				}
 
-				if(ht_dmq_jdoc_cell_group.size >= dmq_cell_group_max_size) {
+				if(ht_dmq_jdoc_cell_group.size >= ht_dmq_sync_chunk_size) {
 					LM_DBG("sending group count[%d]size[%d]\n",
 							ht_dmq_jdoc_cell_group.count,
 							ht_dmq_jdoc_cell_group.size);
-					if(ht_dmq_cell_group_flush(node) < 0) {
+					if(ht_dmq_cell_group_flush(node, 0) < 0) {
 						ht_slot_unlock(ht, i);
 						goto error;
 					}
@@ -571,7 +684,7 @@ int ht_dmq_send_sync(dmq_node_t *node, str *htname)
 		ht = ht->next;
 	}
 
-	if(ht_dmq_cell_group_flush(node) < 0)
+	if(ht_dmq_cell_group_flush(node, 1) < 0)
 		goto error;
 
 	ht_dmq_cell_group_destroy();
@@ -594,14 +707,50 @@ int ht_dmq_handle_sync(srjson_doc_t *jdoc)
 	int type = 0;
 	int_str val = {0};
 	int expire = 0;
+	int seq = 0;
+	int last = 0;
 	ht_t *ht = NULL;
 	time_t now = 0;
 
-	cells = jdoc->root->child;
-	cell = cells->child;
-
 	now = time(NULL);
 
+	for(it = jdoc->root->child; it; it = it->next) {
+		if(strcmp(it->string, "cells") == 0) {
+			cells = it;
+		} else if(strcmp(it->string, "seq") == 0) {
+			seq = SRJSON_GET_INT(it);
+		} else if(strcmp(it->string, "last") == 0) {
+			last = SRJSON_GET_INT(it);
+		}
+	}
+	if(cells == NULL) {
+		LM_ERR("no cells in sync chunk\n");
+		return -1;
+	}
+
+	if(seq > 0) {
+		if(seq != 1 && seq != ht_dmq_rcv_seq + 1) {
+			/* a chunk was lost - the stream cannot be resumed from the
+			 * sender, so ask the peers for a fresh full sync, but not
+			 * more often than once per minute */
+			LM_WARN("sync chunk gap detected (received %d after %d)\n", seq,
+					ht_dmq_rcv_seq);
+			if(now - ht_dmq_rcv_resync > HT_DMQ_RESYNC_MIN_INTERVAL) {
+				ht_dmq_rcv_resync = now;
+				if(ht_dmq_request_sync(NULL) < 0) {
+					LM_ERR("failed to request new sync\n");
+				}
+			}
+		}
+		ht_dmq_rcv_seq = seq;
+		if(last) {
+			LM_DBG("sync stream completed after %d chunks\n", seq);
+			ht_dmq_rcv_seq = 0;
+		}
+	}
+
+	cell = cells->child;
+
 	while(cell) {
 		for(it = cell->child; it; it = it->next) {
 			if(strcmp(it->string, "htname") == 0) {
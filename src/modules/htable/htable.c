@@ -55,7 +55,11 @@ int ht_timer_interval = 20;
 int ht_db_expires_flag = 0;
 int ht_enable_dmq = 0;
 int ht_dmq_init_sync = 0;
+int ht_dmq_sync_chunk_size = 60000;
+int ht_dmq_sync_compress = 0;
 int ht_timer_procs = 0;
+int ht_expire_budget = 0;
+int ht_lockfree_get = 1;
 static int ht_event_callback_mode = 0;
 
 str ht_event_callback = STR_NULL;
@@ -181,7 +185,11 @@ static param_export_t params[] = {
 	{"db_expires", PARAM_INT, &ht_db_expires_flag},
 	{"enable_dmq", PARAM_INT, &ht_enable_dmq},
 	{"dmq_init_sync", PARAM_INT, &ht_dmq_init_sync},
+	{"dmq_sync_chunk_size", PARAM_INT, &ht_dmq_sync_chunk_size},
+	{"dmq_sync_compress", PARAM_INT, &ht_dmq_sync_compress},
 	{"timer_procs", PARAM_INT, &ht_timer_procs},
+	{"expire_budget", PARAM_INT, &ht_expire_budget},
+	{"lockfree_get", PARAM_INT, &ht_lockfree_get},
 	{"event_callback", PARAM_STR, &ht_event_callback},
 	{"event_callback_mode", PARAM_INT, &ht_event_callback_mode},
 	{0, 0, 0}
@@ -1958,11 +1966,13 @@ static void htable_rpc_stats(rpc_t *rpc, void *c)
 			ht_slot_unlock(ht, i);
 		}
 
-		if(rpc->struct_add(th, "Sdddd", "name", &ht->name, /* str */
-				   "slots", (int)ht->htsize,			   /* uint */
-				   "all", (int)all,						   /* uint */
-				   "min", (int)min,						   /* uint */
-				   "max", (int)max						   /* uint */
+		if(rpc->struct_add(th, "Sdddddd", "name", &ht->name, /* str */
+				   "slots", (int)ht->htsize,				 /* uint */
+				   "all", (int)all,							 /* uint */
+				   "min", (int)min,							 /* uint */
+				   "max", (int)max,							 /* uint */
+				   "rd_nolock", atomic_get(&ht->rd_nolock),	 /* int */
+				   "rd_locked", atomic_get(&ht->rd_locked)	 /* int */
 				   )
 				< 0) {
 			rpc->fault(c, 500, "Internal error creating rpc structure");
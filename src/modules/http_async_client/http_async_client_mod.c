@@ -75,6 +75,7 @@ int tls_verify_host = 1; // By default verify host in HTTPS requests
 int tls_verify_peer = 1; // By default verify peer in HTTPS requests
 int curl_verbose = 0;
 int curl_follow_redirect = 0;
+int curl_multiplex = 0; /* HTTP/2 multiplexing on pooled connections */
 char *tls_client_cert = NULL; // client SSL certificate path, defaults to NULL
 char *tls_client_key =
 		NULL;			  // client SSL certificate key path, defaults to NULL
@@ -128,6 +129,8 @@ stat_var *requests;
 stat_var *replies;
 stat_var *errors;
 stat_var *timeouts;
+stat_var *connections;
+stat_var *connreused;
 
 enum http_req_name_t
 {
@@ -176,6 +179,7 @@ static param_export_t params[] = {
 	{"tls_verify_peer", PARAM_INT, &tls_verify_peer},
 	{"curl_verbose", PARAM_INT, &curl_verbose},
 	{"curl_follow_redirect", PARAM_INT, &curl_follow_redirect},
+	{"curl_multiplex", PARAM_INT, &curl_multiplex},
 	{"tls_client_cert", PARAM_STRING, &tls_client_cert},
 	{"tls_client_key", PARAM_STRING, &tls_client_key},
 	{"tls_ca_path", PARAM_STRING, &tls_ca_path},
@@ -192,7 +196,9 @@ stat_export_t mod_stats[] = {
 	{"requests", STAT_NO_RESET, &requests},
 	{"replies", STAT_NO_RESET, &replies},
 	{"errors", STAT_NO_RESET, &errors},
-	{"timeouts", STAT_NO_RESET, &timeouts}, {0, 0, 0}};
+	{"timeouts", STAT_NO_RESET, &timeouts},
+	{"connections", STAT_NO_RESET, &connections},
+	{"connreused", STAT_NO_RESET, &connreused}, {0, 0, 0}};
 
 static pv_export_t pvs[] = {
 	{STR_STATIC_INIT("http_hdr"), PVT_HDR, ah_get_hdr, 0,
@@ -419,7 +419,19 @@ int init_http_multi(struct event_base *evbase, struct http_m_global *wg)
 	curl_multi_setopt(g->multi, CURLMOPT_SOCKETDATA, g);
 	curl_multi_setopt(g->multi, CURLMOPT_TIMERFUNCTION, multi_timer_cb);
 	curl_multi_setopt(g->multi, CURLMOPT_TIMERDATA, g);
-	curl_multi_setopt(g->multi, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+	if(curl_multiplex) {
+#ifdef CURLPIPE_MULTIPLEX
+		/* let concurrent transfers to the same host share one connection
+		 * over http/2 streams instead of opening a connection each */
+		curl_multi_setopt(g->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#else
+		LM_WARN("curl_multiplex configured, but installed cURL version "
+				"doesn't include CURLPIPE_MULTIPLEX\n");
+		curl_multi_setopt(g->multi, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+#endif
+	} else {
+		curl_multi_setopt(g->multi, CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+	}
 
 	return init_http_m_table(hash_size);
 }
@@ -488,6 +500,15 @@ int new_request(str *query, http_m_params_t *query_params, http_multi_cbe_t cb,
 	}
 	curl_easy_setopt(cell->easy, CURLOPT_ERRORBUFFER, cell->error);
 	curl_easy_setopt(cell->easy, CURLOPT_PRIVATE, cell);
+#ifdef CURLPIPE_MULTIPLEX
+	if(curl_multiplex) {
+		curl_easy_setopt(
+				cell->easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+		/* wait for an existing connection to multiplex on instead of
+		 * opening a new one */
+		curl_easy_setopt(cell->easy, CURLOPT_PIPEWAIT, 1L);
+	}
+#endif
 	curl_easy_setopt(
 			cell->easy, CURLOPT_SSL_VERIFYPEER, cell->params.tls_verify_peer);
 	curl_easy_setopt(cell->easy, CURLOPT_SSL_VERIFYHOST,
@@ -606,6 +627,7 @@ void check_multi_info(struct http_m_global *g)
 
 	struct http_m_cell *cell = NULL;
 	double tmp_time;
+	long num_connects;
 
 	LM_DBG("REMAINING: %d\n", g->still_running);
 	while((msg = curl_multi_info_read(g->multi, &msgs_left))) {
@@ -625,6 +647,15 @@ void check_multi_info(struct http_m_global *g)
 				curl_easy_cleanup(easy);
 				continue;
 			}
+			if(curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &num_connects)
+					== CURLE_OK) {
+				if(num_connects > 0) {
+					update_stat(connections, (int)num_connects);
+				} else {
+					/* transfer completed on a reused connection */
+					update_stat(connreused, 1);
+				}
+			}
 			if(msg->data.result != 0) {
 				LM_ERR("handle %p returned error %d: %s\n", easy, res,
 						cell->error);
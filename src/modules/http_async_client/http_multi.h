@@ -56,9 +56,12 @@ extern stat_var *requests;
 extern stat_var *replies;
 extern stat_var *errors;
 extern stat_var *timeouts;
+extern stat_var *connections;
+extern stat_var *connreused;
 extern int tls_version;
 extern int curl_verbose;
 extern int curl_follow_redirect;
+extern int curl_multiplex;
 
 void set_curl_mem_callbacks(void);
 int init_http_multi(struct event_base *evbase, struct http_m_global *wg);
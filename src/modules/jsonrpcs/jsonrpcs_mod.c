@@ -25,6 +25,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <math.h>
+#include <float.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -80,6 +82,11 @@ static int jsonrpc_transport = 6; /* fifo + datagram */
 
 static int jsonrpc_pretty_format = 1;
 
+/*!< 0 - disabled; >0 - initial size of the per-process reply print buffer
+ * that is reused across requests instead of building the response with
+ * one allocation per json node */
+static int jsonrpc_pooled_buffer_size = 0;
+
 static int jsonrpc_register_rpc(void);
 
 static int mod_init(void);
@@ -154,6 +161,7 @@ static cmd_export_t cmds[] = {
 
 static param_export_t params[] = {
 	{"pretty_format", PARAM_INT, &jsonrpc_pretty_format},
+	{"pooled_buffer_size", PARAM_INT, &jsonrpc_pooled_buffer_size},
 	{"transport", PARAM_INT, &jsonrpc_transport},
 	{"fifo_name", PARAM_STRING, &jsonrpc_fifo},
 	{"fifo_mode", PARAM_INT, &jsonrpc_fifo_mode},
@@ -221,6 +229,10 @@ char *jsonrpcs_stored_id_get(void)
 
 static jsonrpc_plain_reply_t _jsonrpc_plain_reply;
 
+/*!< set when rbody points inside the pooled print buffer - then it must
+ * not be freed, the buffer is owned by the module and reused */
+static int _jsonrpc_plain_reply_pooled = 0;
+
 jsonrpc_plain_reply_t *jsonrpc_plain_reply_get(void)
 {
 	return &_jsonrpc_plain_reply;
@@ -229,9 +241,10 @@ jsonrpc_plain_reply_t *jsonrpc_plain_reply_get(void)
 static void jsonrpc_set_plain_reply(
 		int rcode, str *rtext, str *rbody, void (*free_fn)(void *))
 {
-	if(_jsonrpc_plain_reply.rbody.s) {
+	if(_jsonrpc_plain_reply.rbody.s && !_jsonrpc_plain_reply_pooled) {
 		free_fn(_jsonrpc_plain_reply.rbody.s);
 	}
+	_jsonrpc_plain_reply_pooled = 0;
 	_jsonrpc_plain_reply.rcode = rcode;
 	_jsonrpc_plain_reply.rtext = *rtext;
 	if(rbody) {
@@ -244,13 +257,232 @@ static void jsonrpc_set_plain_reply(
 
 static void jsonrpc_reset_plain_reply(void (*free_fn)(void *))
 {
-	if(_jsonrpc_plain_reply.rbody.s) {
+	if(_jsonrpc_plain_reply.rbody.s && !_jsonrpc_plain_reply_pooled) {
 		free_fn(_jsonrpc_plain_reply.rbody.s);
 	}
+	_jsonrpc_plain_reply_pooled = 0;
 	memset(&_jsonrpc_plain_reply, 0, sizeof(jsonrpc_plain_reply_t));
 }
 
 
+/** Per-process print buffer reused across requests.
+ *
+ * When pooled_buffer_size is set, the json reply is serialized directly
+ * into this buffer instead of going through srjson_Print(), which builds
+ * the document with one allocation per node plus join copies - on rpc
+ * workers polled at high rate with large dumps that allocation churn is
+ * significant. The buffer grows to the high-water mark and is kept for
+ * the next request.
+ */
+typedef struct jsonrpc_pbuf
+{
+	char *s;
+	int len;
+	int size;
+} jsonrpc_pbuf_t;
+
+static jsonrpc_pbuf_t _jsonrpc_pbuf = {NULL, 0, 0};
+
+static int jsonrpc_pbuf_ensure(int need)
+{
+	char *nbuf;
+	int nsize;
+
+	if(_jsonrpc_pbuf.len + need <= _jsonrpc_pbuf.size)
+		return 0;
+	if(_jsonrpc_pbuf.size > 0) {
+		nsize = _jsonrpc_pbuf.size;
+	} else {
+		nsize = (jsonrpc_pooled_buffer_size < 1024)
+						? 1024
+						: jsonrpc_pooled_buffer_size;
+	}
+	while(_jsonrpc_pbuf.len + need > nsize)
+		nsize *= 2;
+	nbuf = (char *)pkg_realloc(_jsonrpc_pbuf.s, nsize);
+	if(nbuf == NULL) {
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	_jsonrpc_pbuf.s = nbuf;
+	_jsonrpc_pbuf.size = nsize;
+	return 0;
+}
+
+static int jsonrpc_pbuf_append(const char *s, int len)
+{
+	if(jsonrpc_pbuf_ensure(len) < 0)
+		return -1;
+	memcpy(_jsonrpc_pbuf.s + _jsonrpc_pbuf.len, s, len);
+	_jsonrpc_pbuf.len += len;
+	return 0;
+}
+
+/* render the number the same way as srjson print_number() */
+static int jsonrpc_pbuf_print_number(srjson_t *item)
+{
+	char buf[64];
+	int blen;
+	double d = item->valuedouble;
+	int i = (int)d;
+
+	if(fabs(((double)i) - d) <= DBL_EPSILON && d <= INT_MAX && d >= INT_MIN) {
+		blen = snprintf(buf, sizeof(buf), "%d", i);
+	} else if(fabs(floor(d) - d) <= DBL_EPSILON) {
+		blen = snprintf(buf, sizeof(buf), "%.0f", d);
+	} else if(fabs(d) < 1.0e-6 || fabs(d) > 1.0e9) {
+		blen = snprintf(buf, sizeof(buf), "%e", d);
+	} else {
+		blen = snprintf(buf, sizeof(buf), "%f", d);
+	}
+	if(blen < 0 || blen >= (int)sizeof(buf))
+		return -1;
+	return jsonrpc_pbuf_append(buf, blen);
+}
+
+/* render the string with the same escaping as srjson print_string_ptr() */
+static int jsonrpc_pbuf_print_string(const char *str)
+{
+	const char *ptr;
+	char *ptr2;
+	int len = 2;
+	unsigned char token;
+
+	if(str == NULL)
+		str = "";
+	for(ptr = str; (token = (unsigned char)*ptr) != 0; ptr++) {
+		len++;
+		if(strchr("\"\\\b\f\n\r\t", token))
+			len++;
+		else if(token < 32)
+			len += 5;
+	}
+	/* one extra byte for the terminating zero of the \u escape snprintf */
+	if(jsonrpc_pbuf_ensure(len + 1) < 0)
+		return -1;
+	ptr2 = _jsonrpc_pbuf.s + _jsonrpc_pbuf.len;
+	*ptr2++ = '\"';
+	for(ptr = str; *ptr;) {
+		if((unsigned char)*ptr > 31 && *ptr != '\"' && *ptr != '\\') {
+			*ptr2++ = *ptr++;
+		} else {
+			*ptr2++ = '\\';
+			switch(token = (unsigned char)*ptr++) {
+				case '\\':
+					*ptr2++ = '\\';
+					break;
+				case '\"':
+					*ptr2++ = '\"';
+					break;
+				case '\b':
+					*ptr2++ = 'b';
+					break;
+				case '\f':
+					*ptr2++ = 'f';
+					break;
+				case '\n':
+					*ptr2++ = 'n';
+					break;
+				case '\r':
+					*ptr2++ = 'r';
+					break;
+				case '\t':
+					*ptr2++ = 't';
+					break;
+				default:
+					snprintf(ptr2, 6, "u%04x", token);
+					ptr2 += 5;
+					break;
+			}
+		}
+	}
+	*ptr2++ = '\"';
+	_jsonrpc_pbuf.len = (int)(ptr2 - _jsonrpc_pbuf.s);
+	return 0;
+}
+
+/* serialize the node into the pooled buffer, matching the layout
+ * produced by srjson print_value() for the same fmt setting */
+static int jsonrpc_pbuf_print_value(srjson_t *item, int depth, int fmt)
+{
+	srjson_t *child;
+	int i;
+
+	if(item == NULL)
+		return -1;
+	switch((item->type) & 255) {
+		case srjson_NULL:
+			return jsonrpc_pbuf_append("null", 4);
+		case srjson_False:
+			return jsonrpc_pbuf_append("false", 5);
+		case srjson_True:
+			return jsonrpc_pbuf_append("true", 4);
+		case srjson_Number:
+			return jsonrpc_pbuf_print_number(item);
+		case srjson_String:
+			return jsonrpc_pbuf_print_string(item->valuestring);
+		case srjson_Array:
+			if(jsonrpc_pbuf_append("[", 1) < 0)
+				return -1;
+			for(child = item->child; child; child = child->next) {
+				if(jsonrpc_pbuf_print_value(child, depth + 1, fmt) < 0)
+					return -1;
+				if(child->next != NULL
+						&& jsonrpc_pbuf_append((fmt) ? ", " : ",",
+								   (fmt) ? 2 : 1)
+								   < 0)
+					return -1;
+			}
+			return jsonrpc_pbuf_append("]", 1);
+		case srjson_Object:
+			if(jsonrpc_pbuf_append((fmt) ? "{\n" : "{", (fmt) ? 2 : 1) < 0)
+				return -1;
+			for(child = item->child; child; child = child->next) {
+				if(fmt) {
+					for(i = 0; i <= depth; i++) {
+						if(jsonrpc_pbuf_append("\t", 1) < 0)
+							return -1;
+					}
+				}
+				if(jsonrpc_pbuf_print_string(child->string) < 0)
+					return -1;
+				if(jsonrpc_pbuf_append((fmt) ? ":\t" : ":", (fmt) ? 2 : 1) < 0)
+					return -1;
+				if(jsonrpc_pbuf_print_value(child, depth + 1, fmt) < 0)
+					return -1;
+				if(child->next != NULL && jsonrpc_pbuf_append(",", 1) < 0)
+					return -1;
+				if(fmt && jsonrpc_pbuf_append("\n", 1) < 0)
+					return -1;
+			}
+			if(fmt) {
+				for(i = 0; i < depth; i++) {
+					if(jsonrpc_pbuf_append("\t", 1) < 0)
+						return -1;
+				}
+			}
+			return jsonrpc_pbuf_append("}", 1);
+	}
+	LM_ERR("invalid json node type %d\n", item->type);
+	return -1;
+}
+
+/* serialize the reply document into the pooled buffer */
+static int jsonrpc_pbuf_print(jsonrpc_ctx_t *ctx, str *rbuf)
+{
+	_jsonrpc_pbuf.len = 0;
+	if(jsonrpc_pbuf_print_value(ctx->jrpl->root, 0, jsonrpc_pretty_format) < 0
+			|| jsonrpc_pbuf_ensure(1) < 0) {
+		_jsonrpc_pbuf.len = 0;
+		return -1;
+	}
+	_jsonrpc_pbuf.s[_jsonrpc_pbuf.len] = '\0';
+	rbuf->s = _jsonrpc_pbuf.s;
+	rbuf->len = _jsonrpc_pbuf.len;
+	return 0;
+}
+
+
 /** Initialize jsonrpc reply data structure.
  *
  * This function initializes the data structure that contains all data related
@@ -437,13 +669,21 @@ static int jsonrpc_send_mode(jsonrpc_ctx_t *ctx, int mode)
 		}
 	}
 
-	if(jsonrpc_pretty_format == 0) {
-		rbuf.s = srjson_PrintUnformatted(ctx->jrpl, ctx->jrpl->root);
+	rbuf.s = NULL;
+	rbuf.len = 0;
+	if(jsonrpc_pooled_buffer_size > 0) {
+		if(jsonrpc_pbuf_print(ctx, &rbuf) < 0) {
+			LM_ERR("failed to print the reply in the pooled buffer\n");
+		}
 	} else {
-		rbuf.s = srjson_Print(ctx->jrpl, ctx->jrpl->root);
-	}
-	if(rbuf.s != NULL) {
-		rbuf.len = strlen(rbuf.s);
+		if(jsonrpc_pretty_format == 0) {
+			rbuf.s = srjson_PrintUnformatted(ctx->jrpl, ctx->jrpl->root);
+		} else {
+			rbuf.s = srjson_Print(ctx->jrpl, ctx->jrpl->root);
+		}
+		if(rbuf.s != NULL) {
+			rbuf.len = strlen(rbuf.s);
+		}
 	}
 	if(rbuf.s != NULL) {
 		LM_DBG("sending response with body: %p - %d %.*s\n", ctx->msg,
@@ -454,6 +694,7 @@ static int jsonrpc_send_mode(jsonrpc_ctx_t *ctx, int mode)
 		} else {
 			jsonrpc_set_plain_reply(
 					ctx->http_code, &ctx->http_text, &rbuf, ctx->jrpl->free_fn);
+			_jsonrpc_plain_reply_pooled = (jsonrpc_pooled_buffer_size > 0);
 			rbuf.s = NULL;
 		}
 	} else {
@@ -467,7 +708,7 @@ static int jsonrpc_send_mode(jsonrpc_ctx_t *ctx, int mode)
 					ctx->http_code, &ctx->http_text, NULL, ctx->jrpl->free_fn);
 		}
 	}
-	if(rbuf.s != NULL) {
+	if(rbuf.s != NULL && jsonrpc_pooled_buffer_size <= 0) {
 		ctx->jrpl->free_fn(rbuf.s);
 	}
 
@@ -1353,6 +1594,13 @@ static void mod_destroy(void)
 	jsonrpc_fifo_destroy();
 	jsonrpc_dgram_destroy();
 
+	if(_jsonrpc_pbuf.s != NULL) {
+		pkg_free(_jsonrpc_pbuf.s);
+		_jsonrpc_pbuf.s = NULL;
+		_jsonrpc_pbuf.len = 0;
+		_jsonrpc_pbuf.size = 0;
+	}
+
 	return;
 }
 
@@ -31,6 +31,7 @@
 #define _KEEPALIVE_H_
 
 #include <time.h>
+#include <sys/time.h>
 #include "../../core/sr_module.h"
 #include "../../core/locking.h"
 #include "../../core/str.h"
@@ -44,6 +45,7 @@
 #define KA_STATES_ALL 15  /*!< all bits for the states of destination */
 
 extern int ka_ping_interval;
+extern int ka_ping_spread;
 
 #define ds_skip_dst(flags) ((flags) & (KA_INACTIVE_DST | KA_DISABLED_DST))
 
@@ -81,6 +83,9 @@ typedef struct _ka_dest
 	time_t last_down;	   /*!< Time of last failure SIP reply */
 	int counter;		   /*!< Counts unreachable attempts */
 	ticks_t ping_interval; /*!< Actual interval between OPTIONS  */
+	struct timeval last_ping; /*!< Time the last OPTIONS was sent */
+	unsigned int rtt_last_ms; /*!< Round trip time of last answered OPTIONS */
+	unsigned int rtt_ewma_ms; /*!< Smoothed OPTIONS round trip time */
 
 	void *user_attr;
 	ka_statechanged_f statechanged_clb;
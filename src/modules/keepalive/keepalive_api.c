@@ -36,6 +36,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "../../core/rand/kam_rand.h"
 #include "../tm/tm_load.h"
 
 #include "keepalive.h"
@@ -70,6 +71,7 @@ int ka_add_dest(str *uri, str *owner, int flags, int ping_interval,
 {
 	struct sip_uri _uri;
 	ka_dest_t *dest = 0, *hollow = 0;
+	ticks_t first_delay;
 
 	LM_DBG("adding destination: %.*s\n", uri->len, uri->s);
 	ka_lock_destination_list();
@@ -130,7 +132,14 @@ int ka_add_dest(str *uri, str *owner, int flags, int ping_interval,
 
 	timer_init(dest->timer, ka_check_timer, dest, 0);
 
-	if(timer_add(dest->timer, MS_TO_TICKS(KA_FIRST_TRY_DELAY)) < 0) {
+	/* spread the first OPTIONS over the ping interval, so that
+	 * destinations added in one batch do not keep firing in one
+	 * burst every interval */
+	first_delay = MS_TO_TICKS(KA_FIRST_TRY_DELAY);
+	if(ka_ping_spread > 0 && dest->ping_interval > 0)
+		first_delay += kam_rand() % dest->ping_interval;
+
+	if(timer_add(dest->timer, first_delay) < 0) {
 		LM_ERR("failed to start timer\n");
 		goto err;
 	}
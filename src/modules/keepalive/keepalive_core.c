@@ -34,6 +34,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include "../../core/fmsg.h"
@@ -78,6 +79,8 @@ ticks_t ka_check_timer(ticks_t ticks, struct timer_ln *tl, void *param)
 	set_uac_req(&uac_r, &ka_ping_method, 0, 0, 0, TMCB_LOCAL_COMPLETED,
 			ka_options_callback, (void *)uuid);
 
+	gettimeofday(&ka_dest->last_ping, NULL);
+
 	if(tmb.t_request(&uac_r, &ka_dest->uri, &ka_dest->uri, &ka_ping_from,
 			   &ka_outbound_proxy)
 			< 0) {
@@ -101,6 +104,8 @@ static void ka_options_callback(
 	str uri = {0, 0};
 	sip_msg_t *msg = NULL;
 	ka_state state;
+	struct timeval tnow;
+	long rtt;
 
 	char *state_routes[] = {"", "keepalive:dst-up", "keepalive:dst-down"};
 
@@ -135,6 +140,20 @@ static void ka_options_callback(
 		state = KA_STATE_UP;
 		ka_dest->last_up = time(NULL);
 		ka_dest->counter = 0;
+		/* smoothed round trip time of the answered OPTIONS */
+		if(ka_dest->last_ping.tv_sec > 0) {
+			gettimeofday(&tnow, NULL);
+			rtt = (tnow.tv_sec - ka_dest->last_ping.tv_sec) * 1000
+				  + (tnow.tv_usec - ka_dest->last_ping.tv_usec) / 1000;
+			if(rtt >= 0) {
+				ka_dest->rtt_last_ms = (unsigned int)rtt;
+				ka_dest->rtt_ewma_ms =
+						(ka_dest->rtt_ewma_ms == 0)
+								? (unsigned int)rtt
+								: (7 * ka_dest->rtt_ewma_ms + (unsigned int)rtt)
+										  / 8;
+			}
+		}
 	} else {
 		state = KA_STATE_DOWN;
 		ka_dest->last_down = time(NULL);
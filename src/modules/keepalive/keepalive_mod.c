@@ -65,6 +65,7 @@ static int ka_add_initial_destinations();
 extern struct tm_binds tmb;
 
 int ka_ping_interval = 30;
+int ka_ping_spread = 1;
 ka_destinations_list_t *ka_destinations_list = NULL;
 ka_initial_dest_t *ka_initial_destinations_list = NULL;
 sruid_t ka_sruid;
@@ -89,6 +90,7 @@ static cmd_export_t cmds[] = {
 
 static param_export_t params[] = {
 	{"ping_interval", PARAM_INT, &ka_ping_interval},
+	{"ping_spread", PARAM_INT, &ka_ping_spread},
 	{"destination", PARAM_STRING | PARAM_USE_FUNC,
 		(void *)ka_mod_add_destination},
 	{"ping_from", PARAM_STR, &ka_ping_from},
@@ -93,6 +93,8 @@ static void keepalive_rpc_list(rpc_t *rpc, void *ctx)
 		ctime_r(&dest->last_down, t_buf);
 		rpc->struct_add(sub, "s", "last down", t_buf);
 		rpc->struct_add(sub, "d", "state", (int)dest->state);
+		rpc->struct_add(sub, "dd", "rtt_last_ms", (int)dest->rtt_last_ms,
+				"rtt_ewma_ms", (int)dest->rtt_ewma_ms);
 	}
 
 	return;
@@ -210,8 +212,9 @@ static void keepalive_rpc_get(rpc_t *rpc, void *ctx)
 
 	rpc->add(ctx, "{", &sub);
 
-	rpc->struct_add(sub, "SSd", "uri", &target->uri, "owner", &target->owner,
-			"state", target->state);
+	rpc->struct_add(sub, "SSddd", "uri", &target->uri, "owner", &target->owner,
+			"state", target->state, "rtt_last_ms", (int)target->rtt_last_ms,
+			"rtt_ewma_ms", (int)target->rtt_ewma_ms);
 
 	ka_unlock_destination_list();
 
@@ -522,9 +522,23 @@ struct rpc_list_params
 	void *hst;
 	int numeric;
 	int clear;
+	counter_val_t *snap; /* batched values snapshot (0 - read live) */
+	int snap_no;		 /* number of snapshot entries */
 };
 
 
+/**
+ * Get a counter value from the snapshot, if one was taken.
+ */
+static unsigned long rpc_stats_snap_val(
+		struct rpc_list_params *packed_params, counter_handle_t h)
+{
+	if(packed_params->snap != 0 && h.id < packed_params->snap_no)
+		return (unsigned long)packed_params->snap[h.id];
+	return (unsigned long)counter_get_val(h);
+}
+
+
 /**
  * Statistic getter RPC callback.
  */
@@ -539,7 +553,7 @@ static void rpc_get_grp_vars_cbk(void *p, str *g, str *n, counter_handle_t h)
 	ctx = packed_params->ctx;
 
 	rpc->rpl_printf(ctx, "%.*s:%.*s = %lu", g->len, g->s, n->len, n->s,
-			counter_get_val(h));
+			rpc_stats_snap_val(packed_params, h));
 }
 
 /**
@@ -563,13 +577,19 @@ static void stats_get_all(rpc_t *rpc, void *ctx, char *stat)
 	if(len == 3 && strcmp("all", stat) == 0) {
 		packed_params.rpc = rpc;
 		packed_params.ctx = ctx;
+		packed_params.snap = counter_snapshot(&packed_params.snap_no);
 		counter_iterate_grp_names(rpc_get_all_grps_cbk, &packed_params);
+		if(packed_params.snap)
+			pkg_free(packed_params.snap);
 	} else if(stat[len - 1] == ':') {
 		packed_params.rpc = rpc;
 		packed_params.ctx = ctx;
+		packed_params.snap = counter_snapshot(&packed_params.snap_no);
 		stat[len - 1] = '\0';
 		counter_iterate_grp_vars(stat, rpc_get_grp_vars_cbk, &packed_params);
 		stat[len - 1] = ':';
+		if(packed_params.snap)
+			pkg_free(packed_params.snap);
 	} else {
 		s_statistic.s = stat;
 		s_statistic.len = strlen(stat);
@@ -630,8 +650,8 @@ static void rpc_fetch_grp_vars_cbk(void *p, str *g, str *n, counter_handle_t h)
 	struct rpc_list_params *packed_params = p;
 
 	rpc_fetch_add_stat(packed_params->rpc, packed_params->ctx,
-			packed_params->hst, g->s, n->s, counter_get_val(h),
-			packed_params->numeric);
+			packed_params->hst, g->s, n->s,
+			rpc_stats_snap_val(packed_params, h), packed_params->numeric);
 }
 
 /**
@@ -661,15 +681,21 @@ static void stats_fetch_all(
 		packed_params.ctx = ctx;
 		packed_params.hst = th;
 		packed_params.numeric = numeric;
+		packed_params.snap = counter_snapshot(&packed_params.snap_no);
 		counter_iterate_grp_names(rpc_fetch_all_grps_cbk, &packed_params);
+		if(packed_params.snap)
+			pkg_free(packed_params.snap);
 	} else if(stat[len - 1] == ':') {
 		packed_params.rpc = rpc;
 		packed_params.ctx = ctx;
 		packed_params.hst = th;
 		packed_params.numeric = numeric;
+		packed_params.snap = counter_snapshot(&packed_params.snap_no);
 		stat[len - 1] = '\0';
 		counter_iterate_grp_vars(stat, rpc_fetch_grp_vars_cbk, &packed_params);
 		stat[len - 1] = ':';
+		if(packed_params.snap)
+			pkg_free(packed_params.snap);
 	} else {
 		s_statistic.s = stat;
 		s_statistic.len = strlen(stat);
@@ -209,6 +209,7 @@ str mtree_param = {"lcr", 3};
 
 static pcre2_general_context *lcr_gctx = NULL;
 static pcre2_compile_context *lcr_ctx = NULL;
+static pcre2_match_data *lcr_pcre_md = NULL;
 
 /*
  * Other module types and variables
@@ -826,6 +827,10 @@ static int child_init(int rank)
 static void destroy(void)
 {
 	lcr_db_close();
+	if(lcr_pcre_md) {
+		pcre2_match_data_free(lcr_pcre_md);
+		lcr_pcre_md = NULL;
+	}
 	if(lcr_ctx) {
 		pcre2_compile_context_free(lcr_ctx);
 	}
@@ -942,6 +947,25 @@ static pcre2_code *reg_ex_comp(const char *pattern)
 }
 
 
+/*
+ * Per process match data reused for all rule matching. The compiled
+ * patterns live in shared memory, so match data created from them with
+ * pcre2_match_data_create_from_pattern() would be allocated and freed
+ * in shared memory for every evaluated rule. One heap block per
+ * process is enough - the rule matching only needs the yes/no result,
+ * captures beyond the ovector size are simply not stored.
+ */
+static pcre2_match_data *lcr_get_match_data(void)
+{
+	if(lcr_pcre_md == NULL) {
+		lcr_pcre_md = pcre2_match_data_create(1, NULL);
+		if(lcr_pcre_md == NULL)
+			LM_ERR("cannot create pcre2 match data\n");
+	}
+	return lcr_pcre_md;
+}
+
+
 /*
  * Compare gateways based on their IP address
  */
@@ -2216,14 +2240,9 @@ int load_gws_dummy(int lcr_id, str *ruri_user, str *from_uri, str *request_uri,
 				goto next;
 
 			if(rule->from_uri_len != 0) {
-				pcre_md = pcre2_match_data_create_from_pattern(
-						rule->from_uri_re, NULL);
+				pcre_md = lcr_get_match_data();
 				rc = pcre2_match(rule->from_uri_re, (PCRE2_SPTR)from_uri->s,
 						(PCRE2_SIZE)from_uri->len, 0, 0, pcre_md, NULL);
-				if(pcre_md) {
-					pcre2_match_data_free(pcre_md);
-					pcre_md = NULL;
-				}
 				if(rc < 0)
 					goto next;
 			}
@@ -2259,15 +2278,10 @@ int load_gws_dummy(int lcr_id, str *ruri_user, str *from_uri, str *request_uri,
 						   "param has not been given.\n");
 					return -1;
 				}
-				pcre_md = pcre2_match_data_create_from_pattern(
-						rule->request_uri_re, NULL);
+				pcre_md = lcr_get_match_data();
 				rc = pcre2_match(rule->request_uri_re,
 						(PCRE2_SPTR)request_uri->s,
 						(PCRE2_SIZE)request_uri->len, 0, 0, pcre_md, NULL);
-				if(pcre_md) {
-					pcre2_match_data_free(pcre_md);
-					pcre_md = NULL;
-				}
 				if(rc < 0)
 					goto next;
 			}
@@ -2395,14 +2409,9 @@ static int ki_load_gws_furi(
 
 			/* Match from uri */
 			if(rule->from_uri_len != 0) {
-				pcre_md = pcre2_match_data_create_from_pattern(
-						rule->from_uri_re, NULL);
+				pcre_md = lcr_get_match_data();
 				rc = pcre2_match(rule->from_uri_re, (PCRE2_SPTR)from_uri->s,
 						(PCRE2_SIZE)from_uri->len, 0, 0, pcre_md, NULL);
-				if(pcre_md) {
-					pcre2_match_data_free(pcre_md);
-					pcre_md = NULL;
-				}
 				if(rc < 0) {
 					LM_DBG("from uri <%.*s> did not match to from regex "
 						   "<%.*s>\n",
@@ -2439,15 +2448,10 @@ static int ki_load_gws_furi(
 
 			/* Match request uri */
 			if(rule->request_uri_len != 0) {
-				pcre_md = pcre2_match_data_create_from_pattern(
-						rule->request_uri_re, NULL);
+				pcre_md = lcr_get_match_data();
 				rc = pcre2_match(rule->request_uri_re,
 						(PCRE2_SPTR)request_uri->s,
 						(PCRE2_SIZE)request_uri->len, 0, 0, pcre_md, NULL);
-				if(pcre_md) {
-					pcre2_match_data_free(pcre_md);
-					pcre_md = NULL;
-				}
 				if(rc < 0) {
 					LM_DBG("request uri <%.*s> did not match to request regex "
 						   "<%.*s>\n",
@@ -22,6 +22,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "../../core/sr_module.h"
 #include "../../core/mem/mem.h"
@@ -1252,6 +1253,195 @@ static void rpc_mt_test_list(rpc_t *rpc, void *c)
 }
 
 
+/* benchmark RPCs: timed runs with structured (machine readable via the
+ * jsonrpcs transport) results */
+
+
+/* test message for mt.bench_parse, loaded once from the message_data or
+ * message_file modparam */
+static char mt_bench_msg_buf[4 * BUF_SIZE];
+static int mt_bench_msg_len = 0;
+
+static int mt_bench_msg_load(void)
+{
+	FILE *f;
+	long fsize;
+
+	if(mt_bench_msg_len > 0)
+		return mt_bench_msg_len;
+
+	if(misctest_message_data.s != 0 && misctest_message_data.len > 0) {
+		if(misctest_message_data.len >= 4 * BUF_SIZE - 2) {
+			LM_ERR("the data is too big\n");
+			return -1;
+		}
+		memcpy(mt_bench_msg_buf, misctest_message_data.s,
+				misctest_message_data.len);
+		mt_bench_msg_buf[misctest_message_data.len] = '\0';
+		mt_bench_msg_len = misctest_message_data.len;
+	} else if(misctest_message_file.s != 0 && misctest_message_file.len > 0) {
+		f = fopen(misctest_message_file.s, "r");
+		if(f == NULL) {
+			LM_ERR("cannot open file: %.*s\n", misctest_message_file.len,
+					misctest_message_file.s);
+			return -1;
+		}
+		fseek(f, 0, SEEK_END);
+		fsize = ftell(f);
+		if(fsize < 0 || fsize >= 4 * BUF_SIZE - 2) {
+			LM_ERR("invalid file data size\n");
+			fclose(f);
+			return -1;
+		}
+		fseek(f, 0, SEEK_SET);
+		if(fread(mt_bench_msg_buf, 1, fsize, f) != fsize) {
+			LM_ERR("error reading from file: %.*s\n", misctest_message_file.len,
+					misctest_message_file.s);
+			fclose(f);
+			return -1;
+		}
+		fclose(f);
+		mt_bench_msg_buf[fsize] = '\0';
+		mt_bench_msg_len = (int)fsize;
+	} else {
+		LM_ERR("no input data - set message_data or message_file\n");
+		return -1;
+	}
+	return mt_bench_msg_len;
+}
+
+
+static const char *rpc_mt_bench_mem_doc[2] = {
+		"Timed shared memory allocator benchmark. Takes 3 parameters: ops, "
+		"min and max (chunk size in bytes), plus an optional 4th: the number "
+		"of chunks kept live (default 1024). Each op allocates a random sized "
+		"chunk, freeing the oldest one once the live set is full, so the "
+		"allocator is exercised with a steady working set. Runs in the "
+		"calling rpc worker process - start it concurrently over several "
+		"connections to measure contention. Reports ops, errors, elapsed_us "
+		"and ops_per_sec.",
+		0};
+
+
+static void rpc_mt_bench_mem(rpc_t *rpc, void *c)
+{
+	int nops, min, max, live;
+	int i, errs, ring_pos;
+	unsigned long crt_size;
+	void **ring;
+	struct timeval tstart, tend;
+	unsigned long long elapsed;
+	void *h;
+
+	live = 1024;
+	if(rpc->scan(c, "ddd", &nops, &min, &max) < 3) {
+		return;
+	}
+	rpc->scan(c, "*d", &live);
+	if(nops <= 0 || min < 0 || min > max || max == 0 || live <= 0) {
+		rpc->fault(c, 400, "invalid parameter values");
+		return;
+	}
+	ring = pkg_malloc(live * sizeof(void *));
+	if(ring == 0) {
+		PKG_MEM_ERROR;
+		rpc->fault(c, 500, "no more pkg memory");
+		return;
+	}
+	memset(ring, 0, live * sizeof(void *));
+
+	errs = 0;
+	ring_pos = 0;
+	gettimeofday(&tstart, NULL);
+	for(i = 0; i < nops; i++) {
+		crt_size = fastrand_max(max - min) + min;
+		if(ring[ring_pos])
+			shm_free(ring[ring_pos]);
+		ring[ring_pos] = shm_malloc(crt_size);
+		errs += (ring[ring_pos] == 0);
+		ring_pos++;
+		if(ring_pos == live)
+			ring_pos = 0;
+	}
+	gettimeofday(&tend, NULL);
+
+	for(i = 0; i < live; i++) {
+		if(ring[i])
+			shm_free(ring[i]);
+	}
+	pkg_free(ring);
+
+	elapsed = (tend.tv_sec - tstart.tv_sec) * 1000000ULL
+			  + (tend.tv_usec - tstart.tv_usec);
+	rpc->add(c, "{", &h);
+	rpc->struct_add(h, "ddddd", "ops", nops, "errors", errs, "live_chunks",
+			live, "min", min, "max", max);
+	rpc->struct_printf(h, "elapsed_us", "%llu", elapsed);
+	rpc->struct_printf(h, "ops_per_sec", "%llu",
+			(elapsed != 0) ? ((unsigned long long)nops * 1000000ULL) / elapsed
+						   : 0ULL);
+	return;
+}
+
+
+static const char *rpc_mt_bench_parse_doc[2] = {
+		"Timed message parser benchmark. Takes 1 parameter: the number of "
+		"iterations. Each iteration parses the message set with the "
+		"message_data or message_file modparam (first line plus all headers) "
+		"and frees it again. Reports msgs, errors, elapsed_us and "
+		"msgs_per_sec.",
+		0};
+
+
+static void rpc_mt_bench_parse(rpc_t *rpc, void *c)
+{
+	int niters, i, errs, mlen;
+	sip_msg_t tmsg;
+	struct timeval tstart, tend;
+	unsigned long long elapsed;
+	void *h;
+
+	if(rpc->scan(c, "d", &niters) < 1) {
+		return;
+	}
+	if(niters <= 0) {
+		rpc->fault(c, 400, "invalid parameter values");
+		return;
+	}
+	mlen = mt_bench_msg_load();
+	if(mlen <= 0) {
+		rpc->fault(c, 500,
+				"no test message - set the message_data or message_file"
+				" modparam");
+		return;
+	}
+
+	errs = 0;
+	gettimeofday(&tstart, NULL);
+	for(i = 0; i < niters; i++) {
+		memset(&tmsg, 0, sizeof(tmsg));
+		tmsg.buf = mt_bench_msg_buf;
+		tmsg.len = mlen;
+		if(parse_msg(tmsg.buf, tmsg.len, &tmsg) < 0
+				|| parse_headers(&tmsg, HDR_EOH_F, 0) < 0)
+			errs++;
+		free_sip_msg(&tmsg);
+	}
+	gettimeofday(&tend, NULL);
+
+	elapsed = (tend.tv_sec - tstart.tv_sec) * 1000000ULL
+			  + (tend.tv_usec - tstart.tv_usec);
+	rpc->add(c, "{", &h);
+	rpc->struct_add(h, "dd", "msgs", niters, "errors", errs);
+	rpc->struct_printf(h, "elapsed_us", "%llu", elapsed);
+	rpc->struct_printf(h, "msgs_per_sec", "%llu",
+			(elapsed != 0)
+					? ((unsigned long long)niters * 1000000ULL) / elapsed
+					: 0ULL);
+	return;
+}
+
+
 /* clang-format off */
 static rpc_export_t mt_rpc[] = {
 	{"mt.mem_alloc", rpc_mt_alloc, rpc_mt_alloc_doc, 0},
@@ -1265,6 +1455,8 @@ static rpc_export_t mt_rpc[] = {
 	{"mt.mem_test_destroy_all", rpc_mt_test_destroy_all,
 								rpc_mt_test_destroy_all_doc, 0},
 	{"mt.mem_test_list", rpc_mt_test_list, rpc_mt_test_list_doc, 0},
+	{"mt.bench_mem", rpc_mt_bench_mem, rpc_mt_bench_mem_doc, 0},
+	{"mt.bench_parse", rpc_mt_bench_parse, rpc_mt_bench_parse_doc, 0},
 	{0, 0, 0, 0}
 };
 /* clang-format on */
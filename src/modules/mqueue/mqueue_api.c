@@ -89,6 +89,15 @@ void mq_destroy(void)
 	_mq_head_list = 0;
 	mp = _mq_pv_list;
 	while(mp != NULL) {
+		if(mp->item != NULL) {
+			shm_free(mp->item);
+		}
+		mi = mp->ifirst;
+		while(mi != NULL) {
+			mi1 = mi;
+			mi = mi->next;
+			shm_free(mi1);
+		}
 		mp1 = mp;
 		mp = mp->next;
 		pkg_free(mp1);
@@ -218,10 +227,23 @@ mq_pv_t *mq_pv_get(str *name)
  *
  */
 int mq_head_fetch(str *name)
+{
+	return mq_head_fetch_n(name, 1);
+}
+
+/**
+ * fetch the next item, refilling the local per-process batch with up to
+ * n items detached from the shared queue in one lock operation
+ */
+int mq_head_fetch_n(str *name, int n)
 {
 	mq_head_t *mh = NULL;
 	mq_pv_t *mp = NULL;
+	mq_item_t *mi = NULL;
+	int i;
 
+	if(n <= 0)
+		n = 1;
 	mp = mq_pv_get(name);
 	if(mp == NULL)
 		return -1;
@@ -229,6 +251,13 @@ int mq_head_fetch(str *name)
 		shm_free(mp->item);
 		mp->item = NULL;
 	}
+	if(mp->ifirst != NULL) {
+		/* serve from the batch detached on a previous call - no locking */
+		mp->item = mp->ifirst;
+		mp->ifirst = mp->ifirst->next;
+		mp->item->next = NULL;
+		return 0;
+	}
 	mh = mq_head_get(name);
 	if(mh == NULL)
 		return -1;
@@ -240,14 +269,21 @@ int mq_head_fetch(str *name)
 		return -2;
 	}
 
+	mi = mh->ifirst;
+	for(i = 1; i < n && mi->next != NULL; i++) {
+		mi = mi->next;
+	}
 	mp->item = mh->ifirst;
-	mh->ifirst = mh->ifirst->next;
+	mh->ifirst = mi->next;
 	if(mh->ifirst == NULL) {
 		mh->ilast = NULL;
 	}
-	mh->csize--;
+	mh->csize -= i;
 
 	lock_release(&mh->lock);
+	mi->next = NULL;
+	mp->ifirst = mp->item->next;
+	mp->item->next = NULL;
 	return 0;
 }
 
@@ -257,6 +293,8 @@ int mq_head_fetch(str *name)
 void mq_pv_free(str *name)
 {
 	mq_pv_t *mp = NULL;
+	mq_item_t *mi = NULL;
+	mq_item_t *mi1 = NULL;
 
 	mp = mq_pv_get(name);
 	if(mp == NULL)
@@ -265,6 +303,13 @@ void mq_pv_free(str *name)
 		shm_free(mp->item);
 		mp->item = NULL;
 	}
+	mi = mp->ifirst;
+	while(mi != NULL) {
+		mi1 = mi;
+		mi = mi->next;
+		shm_free(mi1);
+	}
+	mp->ifirst = NULL;
 }
 
 /**
@@ -343,6 +388,7 @@ int mq_item_add(str *qname, str *key, str *val)
 	memcpy(mi->val.s, val->s, val->len);
 	mi->val.len = val->len;
 	mi->val.s[val->len] = '\0';
+	mi->itime = time(NULL);
 
 	if(oplock == 0) {
 		lock_get(&mh->lock);
@@ -536,3 +582,23 @@ int _mq_get_csize(str *name)
 
 	return mqueue_size;
 }
+
+/**
+ * Return the wait time, in seconds, of the oldest item in a given queue
+ * (0 for empty queue) - a gauge of how far behind the consumers are
+ */
+int _mq_get_wait(str *name)
+{
+	mq_head_t *mh = mq_head_get(name);
+	int mqueue_wait = 0;
+
+	if(mh == NULL)
+		return -1;
+
+	lock_get(&mh->lock);
+	if(mh->ifirst != NULL)
+		mqueue_wait = (int)(time(NULL) - mh->ifirst->itime);
+	lock_release(&mh->lock);
+
+	return mqueue_wait;
+}
@@ -23,6 +23,8 @@
 #ifndef _MQUEUE_API_H_
 #define _MQUEUE_API_H_
 
+#include <time.h>
+
 #include "../../core/pvar.h"
 #include "../../core/parser/msg_parser.h"
 
@@ -33,6 +35,7 @@ typedef struct _mq_item
 {
 	str key;
 	str val;
+	time_t itime;
 	struct _mq_item *next;
 } mq_item_t;
 
@@ -59,6 +62,7 @@ typedef struct _mq_pv
 {
 	str *name;
 	mq_item_t *item;
+	mq_item_t *ifirst;
 	struct _mq_pv *next;
 } mq_pv_t;
 
@@ -73,11 +77,13 @@ int mq_head_defined(void);
 void mq_destroy(void);
 int mq_head_add(str *name, int msize, int addmode);
 int mq_head_fetch(str *name);
+int mq_head_fetch_n(str *name, int n);
 void mq_pv_free(str *name);
 int mq_item_add(str *qname, str *key, str *val);
 mq_head_t *mq_head_get(str *name);
 
 int _mq_get_csize(str *);
+int _mq_get_wait(str *);
 int mq_set_dbmode(str *, int dbmode);
 
 #endif
@@ -46,6 +46,7 @@ static int mod_init(void);
 static void mod_destroy(void);
 
 static int w_mq_fetch(struct sip_msg *msg, char *mq, char *str2);
+static int w_mq_fetch_n(struct sip_msg *msg, char *mq, char *n);
 static int w_mq_size(struct sip_msg *msg, char *mq, char *str2);
 static int w_mq_add(struct sip_msg *msg, char *mq, char *key, char *val);
 static int w_mq_pv_free(struct sip_msg *msg, char *mq, char *str2);
@@ -74,6 +75,8 @@ static pv_export_t mod_pvs[] = {
 static cmd_export_t cmds[] = {
 	{"mq_fetch", (cmd_function)w_mq_fetch, 1,
 		fixup_spve_null, fixup_free_spve_null, ANY_ROUTE},
+	{"mq_fetch_n", (cmd_function)w_mq_fetch_n, 2,
+		fixup_spve_igp, fixup_free_spve_igp, ANY_ROUTE},
 	{"mq_add", (cmd_function)w_mq_add, 3,
 		fixup_mq_add, fixup_free_mq_add, ANY_ROUTE},
 	{"mq_pv_free", (cmd_function)w_mq_pv_free, 1,
@@ -156,6 +159,26 @@ static int w_mq_fetch(struct sip_msg *msg, char *mq, char *str2)
 	return 1;
 }
 
+static int w_mq_fetch_n(struct sip_msg *msg, char *mq, char *n)
+{
+	int ret;
+	str q;
+	int batch = 0;
+
+	if(fixup_get_svalue(msg, (gparam_t *)mq, &q) < 0) {
+		LM_ERR("cannot get the queue\n");
+		return -1;
+	}
+	if(fixup_get_ivalue(msg, (gparam_t *)n, &batch) < 0) {
+		LM_ERR("cannot get the batch size\n");
+		return -1;
+	}
+	ret = mq_head_fetch_n(&q, batch);
+	if(ret < 0)
+		return ret;
+	return 1;
+}
+
 static int w_mq_size(struct sip_msg *msg, char *mq, char *str2)
 {
 	int ret;
@@ -361,7 +384,8 @@ static void mqueue_rpc_get_size(rpc_t *rpc, void *ctx)
 		rpc->fault(ctx, 500, "Server error");
 		return;
 	}
-	rpc->struct_add(vh, "Sd", "name", &mqueue_name, "size", mqueue_sz);
+	rpc->struct_add(vh, "Sdd", "name", &mqueue_name, "size", mqueue_sz, "wait",
+			_mq_get_wait(&mqueue_name));
 }
 
 static const char *mqueue_rpc_get_size_doc[2] = {"Get size of mqueue.", 0};
@@ -371,6 +395,7 @@ static void mqueue_rpc_get_sizes(rpc_t *rpc, void *ctx)
 	mq_head_t *mh = mq_head_get(NULL);
 	void *vh;
 	int size;
+	int wait;
 
 	while(mh != NULL) {
 		if(rpc->add(ctx, "{", &vh) < 0) {
@@ -379,8 +404,11 @@ static void mqueue_rpc_get_sizes(rpc_t *rpc, void *ctx)
 		}
 		lock_get(&mh->lock);
 		size = mh->csize;
+		wait = (mh->ifirst != NULL) ? (int)(time(NULL) - mh->ifirst->itime)
+									: 0;
 		lock_release(&mh->lock);
-		rpc->struct_add(vh, "Sd", "name", &mh->name, "size", size);
+		rpc->struct_add(vh, "Sdd", "name", &mh->name, "size", size, "wait",
+				wait);
 		mh = mh->next;
 	}
 }
@@ -487,6 +515,18 @@ static int ki_mq_fetch(sip_msg_t *msg, str *mq)
 	return 1;
 }
 
+/**
+ *
+ */
+static int ki_mq_fetch_n(sip_msg_t *msg, str *mq, int n)
+{
+	int ret;
+	ret = mq_head_fetch_n(mq, n);
+	if(ret < 0)
+		return ret;
+	return 1;
+}
+
 /**
  *
  */
@@ -602,6 +642,11 @@ static sr_kemi_t sr_kemi_mqueue_exports[] = {
 		{ SR_KEMIP_STR, SR_KEMIP_NONE, SR_KEMIP_NONE,
 			SR_KEMIP_NONE, SR_KEMIP_NONE, SR_KEMIP_NONE }
 	},
+	{ str_init("mqueue"), str_init("mq_fetch_n"),
+		SR_KEMIP_INT, ki_mq_fetch_n,
+		{ SR_KEMIP_STR, SR_KEMIP_INT, SR_KEMIP_NONE,
+			SR_KEMIP_NONE, SR_KEMIP_NONE, SR_KEMIP_NONE }
+	},
 	{ str_init("mqueue"), str_init("mq_size"),
 		SR_KEMIP_INT, ki_mq_size,
 		{ SR_KEMIP_STR, SR_KEMIP_NONE, SR_KEMIP_NONE,
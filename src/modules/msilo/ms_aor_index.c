@@ -0,0 +1,219 @@
+/**
+ * MSILO module
+ *
+ * Copyright (C) 2001-2003 FhG Fokus
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <string.h>
+
+#include "../../core/mem/shm_mem.h"
+#include "../../core/dprint.h"
+#include "../../core/hashes.h"
+
+#include "ms_aor_index.h"
+
+/**
+ * match an entry against user (case sensitive) and host (case insensitive)
+ */
+static int aidx_entry_match(aidx_entry ae, str *user, str *host)
+{
+	if(ae->user.len != user->len || ae->host.len != host->len)
+		return 0;
+	if(memcmp(ae->user.s, user->s, user->len) != 0)
+		return 0;
+	if(strncasecmp(ae->host.s, host->s, host->len) != 0)
+		return 0;
+	return 1;
+}
+
+/**
+ * init the hash table of AoRs with stored messages
+ */
+aidx_table aidx_init(int size)
+{
+	aidx_table at = NULL;
+	int i;
+
+	if(size <= 0)
+		return NULL;
+
+	at = (aidx_table)shm_malloc(sizeof(t_aidx_table));
+	if(at == NULL)
+		return NULL;
+	memset(at, 0, sizeof(t_aidx_table));
+	at->size = size;
+
+	at->slots = (aidx_slot)shm_malloc(size * sizeof(t_aidx_slot));
+	if(at->slots == NULL) {
+		shm_free(at);
+		return NULL;
+	}
+	memset(at->slots, 0, size * sizeof(t_aidx_slot));
+
+	for(i = 0; i < size; i++) {
+		if(lock_init(&at->slots[i].lock) == 0) {
+			LM_CRIT("could not initialize a lock\n");
+			while(i > 0)
+				lock_destroy(&at->slots[--i].lock);
+			shm_free(at->slots);
+			shm_free(at);
+			return NULL;
+		}
+	}
+
+	return at;
+}
+
+/**
+ * free the hash table
+ */
+void aidx_free(aidx_table at)
+{
+	aidx_entry p0, p1;
+	int i;
+
+	if(at == NULL)
+		return;
+
+	for(i = 0; i < at->size; i++) {
+		p0 = at->slots[i].first;
+		while(p0) {
+			p1 = p0;
+			p0 = p0->next;
+			shm_free(p1);
+		}
+		lock_destroy(&at->slots[i].lock);
+	}
+	shm_free(at->slots);
+	shm_free(at);
+}
+
+/**
+ * mark an AoR as having stored messages
+ */
+int aidx_add(aidx_table at, str *user, str *host)
+{
+	aidx_entry ae;
+	unsigned int hashid;
+	int slotid;
+
+	if(at == NULL || user == NULL || user->len <= 0 || host == NULL
+			|| host->len <= 0)
+		return AIDX_ERR;
+
+	hashid = get_hash1_raw(user->s, user->len);
+	slotid = hashid % at->size;
+
+	lock_get(&at->slots[slotid].lock);
+	for(ae = at->slots[slotid].first; ae != NULL; ae = ae->next) {
+		if(ae->hashid == hashid && aidx_entry_match(ae, user, host)) {
+			lock_release(&at->slots[slotid].lock);
+			return AIDX_OK;
+		}
+	}
+
+	ae = (aidx_entry)shm_malloc(
+			sizeof(t_aidx_entry) + user->len + host->len);
+	if(ae == NULL) {
+		lock_release(&at->slots[slotid].lock);
+		LM_ERR("no more shm for aor index entry\n");
+		return AIDX_ERR;
+	}
+	ae->hashid = hashid;
+	ae->user.s = (char *)ae + sizeof(t_aidx_entry);
+	ae->user.len = user->len;
+	memcpy(ae->user.s, user->s, user->len);
+	ae->host.s = ae->user.s + user->len;
+	ae->host.len = host->len;
+	memcpy(ae->host.s, host->s, host->len);
+	ae->next = at->slots[slotid].first;
+	at->slots[slotid].first = ae;
+	at->nr++;
+	lock_release(&at->slots[slotid].lock);
+
+	return AIDX_OK;
+}
+
+/**
+ * check if an AoR may have stored messages
+ * return 1 if it is in the index, 0 otherwise
+ */
+int aidx_check(aidx_table at, str *user, str *host)
+{
+	aidx_entry ae;
+	unsigned int hashid;
+	int slotid;
+
+	if(at == NULL || user == NULL || user->len <= 0 || host == NULL
+			|| host->len <= 0)
+		return 1;
+
+	hashid = get_hash1_raw(user->s, user->len);
+	slotid = hashid % at->size;
+
+	lock_get(&at->slots[slotid].lock);
+	for(ae = at->slots[slotid].first; ae != NULL; ae = ae->next) {
+		if(ae->hashid == hashid && aidx_entry_match(ae, user, host)) {
+			lock_release(&at->slots[slotid].lock);
+			return 1;
+		}
+	}
+	lock_release(&at->slots[slotid].lock);
+
+	return 0;
+}
+
+/**
+ * drop an AoR from the index - no stored messages left for it
+ */
+int aidx_remove(aidx_table at, str *user, str *host)
+{
+	aidx_entry ae, prev;
+	unsigned int hashid;
+	int slotid;
+
+	if(at == NULL || user == NULL || user->len <= 0 || host == NULL
+			|| host->len <= 0)
+		return AIDX_ERR;
+
+	hashid = get_hash1_raw(user->s, user->len);
+	slotid = hashid % at->size;
+
+	lock_get(&at->slots[slotid].lock);
+	prev = NULL;
+	for(ae = at->slots[slotid].first; ae != NULL; ae = ae->next) {
+		if(ae->hashid == hashid && aidx_entry_match(ae, user, host)) {
+			if(prev == NULL)
+				at->slots[slotid].first = ae->next;
+			else
+				prev->next = ae->next;
+			at->nr--;
+			lock_release(&at->slots[slotid].lock);
+			shm_free(ae);
+			return AIDX_OK;
+		}
+		prev = ae;
+	}
+	lock_release(&at->slots[slotid].lock);
+
+	return AIDX_OK;
+}
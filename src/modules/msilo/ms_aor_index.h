@@ -0,0 +1,63 @@
+/**
+ * MSILO module
+ *
+ * Copyright (C) 2001-2003 FhG Fokus
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _MS_AOR_INDEX_H_
+#define _MS_AOR_INDEX_H_
+
+#include "../../core/str.h"
+#include "../../core/locking.h"
+
+#define AIDX_OK 0
+#define AIDX_ERR -1
+
+/* one AoR that has stored messages in the database */
+typedef struct _aidx_entry
+{
+	unsigned int hashid;
+	str user;
+	str host;
+	struct _aidx_entry *next;
+} t_aidx_entry, *aidx_entry;
+
+typedef struct _aidx_slot
+{
+	aidx_entry first;
+	gen_lock_t lock;
+} t_aidx_slot, *aidx_slot;
+
+typedef struct _aidx_table
+{
+	int size;
+	int nr;
+	aidx_slot slots;
+} t_aidx_table, *aidx_table;
+
+aidx_table aidx_init(int size);
+void aidx_free(aidx_table);
+int aidx_add(aidx_table, str *user, str *host);
+int aidx_check(aidx_table, str *user, str *host);
+int aidx_remove(aidx_table, str *user, str *host);
+
+#endif
@@ -51,6 +51,7 @@
 #include "../../modules/tm/tm_load.h"
 
 #include "ms_msg_list.h"
+#include "ms_aor_index.h"
 #include "msfuncs.h"
 #include "api.h"
 
@@ -108,6 +109,10 @@ static db_func_t msilo_dbf;
 /** processed msg list - used for dumping the messages */
 static msg_list _msilo_ml = NULL;
 
+/** AoRs with stored messages - lets m_dump() skip the database
+ * query for users that have nothing in the silo */
+static aidx_table _msilo_aidx = NULL;
+
 /** TM bind */
 static struct tm_binds _msilo_tmb;
 
@@ -138,6 +143,7 @@ int ms_add_date = 1;
 int ms_add_contact = 0;
 int ms_max_messages = 0;
 int ms_use_mode = 0;
+int ms_aor_index_size = 0;
 
 static str ms_snd_time_avp_param = {NULL, 0};
 avp_name_t ms_snd_time_avp_name;
@@ -229,6 +235,7 @@ static param_export_t params[] = {
 	{"add_contact", PARAM_INT, &ms_add_contact},
 	{"skip_notification_flag", PARAM_INT, &ms_skip_notification_flag},
 	{"use_mode", PARAM_INT, &ms_use_mode},
+	{"aor_index_size", PARAM_INT, &ms_aor_index_size},
 	{0, 0, 0}
 };
 
@@ -240,6 +247,7 @@ stat_var *ms_dumped_msgs;
 stat_var *ms_failed_msgs;
 stat_var *ms_dumped_rmds;
 stat_var *ms_failed_rmds;
+stat_var *ms_skipped_dumps;
 
 stat_export_t msilo_stats[] = {
 	{"stored_messages", 0, &ms_stored_msgs},
@@ -247,6 +255,7 @@ stat_export_t msilo_stats[] = {
 	{"failed_messages", 0, &ms_failed_msgs},
 	{"dumped_reminders", 0, &ms_dumped_rmds},
 	{"failed_reminders", 0, &ms_failed_rmds},
+	{"skipped_dumps", 0, &ms_skipped_dumps},
 	{0, 0, 0}
 };
 
@@ -276,6 +285,54 @@ static int bind_msilo(msilo_api_t *api)
 	return 0;
 }
 
+/**
+ * load the AoRs of already stored messages into the index, so that
+ * messages stored before a restart are still dumped
+ */
+static int m_aidx_preload(void)
+{
+	db_key_t db_cols[2];
+	db1_res_t *db_res = NULL;
+	str str_vals[2];
+	int i;
+
+	db_cols[0] = &sc_uri_user;
+	db_cols[1] = &sc_uri_host;
+
+	if(msilo_dbf.use_table(db_con, &ms_db_table) < 0) {
+		LM_ERR("failed to use_table\n");
+		return -1;
+	}
+	if(msilo_dbf.query(db_con, NULL, NULL, NULL, db_cols, 0, 2, NULL, &db_res)
+					< 0
+			|| db_res == NULL) {
+		LM_ERR("failed to query stored messages\n");
+		if(db_res != NULL && msilo_dbf.free_result(db_con, db_res) < 0) {
+			LM_ERR("failed to free the query result\n");
+		}
+		return -1;
+	}
+
+	for(i = 0; i < RES_ROW_N(db_res); i++) {
+		memset(str_vals, 0, 2 * sizeof(str));
+		SET_STR_VAL(str_vals[0], db_res, i, 0); /* username */
+		SET_STR_VAL(str_vals[1], db_res, i, 1); /* domain */
+		if(aidx_add(_msilo_aidx, &str_vals[0], &str_vals[1]) < 0) {
+			LM_ERR("failed to index stored message [%d]\n", i);
+			if(msilo_dbf.free_result(db_con, db_res) < 0)
+				LM_ERR("failed to free the query result\n");
+			return -1;
+		}
+	}
+	LM_DBG("indexed [%d] AoRs from [%d] stored messages\n", _msilo_aidx->nr,
+			RES_ROW_N(db_res));
+
+	if(msilo_dbf.free_result(db_con, db_res) < 0)
+		LM_ERR("failed to free result of query\n");
+
+	return 0;
+}
+
 /**
  * init module function
  */
@@ -359,6 +416,22 @@ static int mod_init(void)
 		db_con = NULL;
 		return -1;
 	}
+
+	if(ms_aor_index_size > 0) {
+		_msilo_aidx = aidx_init(ms_aor_index_size);
+		if(_msilo_aidx == NULL) {
+			LM_ERR("can't initialize aor index\n");
+			msilo_dbf.close(db_con);
+			db_con = NULL;
+			return -1;
+		}
+		if(m_aidx_preload() < 0) {
+			LM_WARN("failed to preload the aor index - disabling it\n");
+			aidx_free(_msilo_aidx);
+			_msilo_aidx = NULL;
+		}
+	}
+
 	if(db_con)
 		msilo_dbf.close(db_con);
 	db_con = NULL;
@@ -813,6 +886,10 @@ static int m_store_addrs(sip_msg_t *msg, str *owner, str *srcaddr, str *dstaddr)
 	LM_DBG("message stored. T:<%.*s> F:<%.*s>\n", pto->uri.len, pto->uri.s,
 			pfrom->uri.len, pfrom->uri.s);
 
+	if(_msilo_aidx != NULL
+			&& aidx_add(_msilo_aidx, &puri.user, &puri.host) < 0)
+		LM_ERR("failed to index the stored message\n");
+
 #ifdef STATISTICS
 	update_stat(ms_stored_msgs, 1);
 #endif
@@ -1038,6 +1115,16 @@ static int m_dump(sip_msg_t *msg, str *owner_s)
 		goto error;
 	}
 
+	if(_msilo_aidx != NULL
+			&& aidx_check(_msilo_aidx, &puri.user, &puri.host) == 0) {
+		LM_DBG("no stored message for <%.*s> - skipping the query\n",
+				pto->uri.len, pto->uri.s);
+#ifdef STATISTICS
+		update_stat(ms_skipped_dumps, 1);
+#endif
+		return 1;
+	}
+
 	db_vals[0].type = DB1_STR;
 	db_vals[0].nul = 0;
 	db_vals[0].val.str_val.s = puri.user.s;
@@ -1075,6 +1162,8 @@ static int m_dump(sip_msg_t *msg, str *owner_s)
 
 	if(RES_ROW_N(db_res) <= 0) {
 		LM_DBG("no stored message for <%.*s>!\n", pto->uri.len, pto->uri.s);
+		if(_msilo_aidx != NULL)
+			aidx_remove(_msilo_aidx, &puri.user, &puri.host);
 		goto done;
 	}
 
@@ -1299,6 +1388,7 @@ void m_clean_silo(unsigned int ticks, void *param)
 static void destroy(void)
 {
 	msg_list_free(_msilo_ml);
+	aidx_free(_msilo_aidx);
 
 	if(db_con && msilo_dbf.close)
 		msilo_dbf.close(db_con);
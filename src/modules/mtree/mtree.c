@@ -304,6 +304,90 @@ int mt_add_to_tree(m_tree_t *pt, str *sp, str *svalue)
 	return 0;
 }
 
+int mt_remove_from_tree(m_tree_t *pt, str *sp)
+{
+	int l, i;
+	mt_node_t *path[MT_MAX_DEPTH];
+	unsigned char branch[MT_MAX_DEPTH];
+	mt_node_t *itn;
+	mt_is_t *tvalues, *next;
+	unsigned char mtch;
+
+	if(pt == NULL || sp == NULL || sp->s == NULL) {
+		LM_ERR("bad parameters\n");
+		return -1;
+	}
+
+	if(sp->len >= MT_MAX_DEPTH) {
+		LM_ERR("max prefix len exceeded\n");
+		return -1;
+	}
+
+	LM_DBG("removing from tree <%.*s> of type <%d>\n", pt->tname.len,
+			pt->tname.s, pt->type);
+
+	if(pt->head == NULL)
+		return 1;
+
+	/* walk down to the node keeping the path for pruning */
+	itn = pt->head;
+	for(l = 0; l < sp->len; l++) {
+		mtch = _mt_char_table[(unsigned char)sp->s[l]];
+		if(mtch == MT_CHAR_TABLE_NOTSET) {
+			LM_ERR("invalid char at %d in [%.*s] [%c (0x%x)]\n", l, sp->len,
+					sp->s, sp->s[l], sp->s[l]);
+			return -1;
+		}
+		if(itn == NULL)
+			return 1;
+		path[l] = itn;
+		branch[l] = mtch;
+		if(l < sp->len - 1)
+			itn = itn[mtch].child;
+	}
+
+	itn = path[sp->len - 1];
+	mtch = branch[sp->len - 1];
+	if(itn[mtch].tvalues == NULL)
+		return 1;
+
+	tvalues = itn[mtch].tvalues;
+	while(tvalues != NULL) {
+		if((pt->type != MT_TREE_IVAL) && (tvalues->tvalue.s.s != NULL)) {
+			pt->memsize -= (tvalues->tvalue.s.len + 1) * sizeof(char);
+			pt->nritems--;
+			shm_free(tvalues->tvalue.s.s);
+		}
+		next = tvalues->next;
+		shm_free(tvalues);
+		tvalues = next;
+	}
+	itn[mtch].tvalues = NULL;
+	mt_node_unset_payload(&itn[mtch], pt->type);
+
+	/* prune node blocks left without values and children */
+	for(l = sp->len - 1; l >= 0; l--) {
+		itn = path[l];
+		if(itn[branch[l]].tvalues != NULL || itn[branch[l]].child != NULL)
+			break;
+		for(i = 0; i < MT_NODE_SIZE; i++) {
+			if(itn[i].tvalues != NULL || itn[i].child != NULL)
+				break;
+		}
+		if(i < MT_NODE_SIZE)
+			break;
+		shm_free(itn);
+		pt->nrnodes--;
+		pt->memsize -= MT_NODE_SIZE * sizeof(mt_node_t);
+		if(l == 0)
+			pt->head = NULL;
+		else
+			path[l - 1][branch[l - 1]].child = NULL;
+	}
+
+	return 0;
+}
+
 m_tree_t *mt_get_tree(str *tname)
 {
 	m_tree_t *it;
@@ -87,6 +87,7 @@ typedef struct _m_tree
 
 /* prefix tree operations */
 int mt_add_to_tree(m_tree_t *pt, str *tprefix, str *svalue);
+int mt_remove_from_tree(m_tree_t *pt, str *tprefix);
 
 m_tree_t *mt_get_tree(str *tname);
 m_tree_t *mt_get_first_tree();
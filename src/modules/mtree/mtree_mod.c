@@ -969,6 +969,106 @@ static const char *rpc_mtree_match_doc[6] = {"Match prefix value against mtree",
 		"uses three required parameters", "tname - tree name",
 		"prefix - prefix for matching", "mode - mode for matching (0 or 2)", 0};
 
+void rpc_mtree_add(rpc_t *rpc, void *ctx)
+{
+	str tname = STR_NULL;
+	str tprefix = STR_NULL;
+	str tvalue = STR_NULL;
+	m_tree_t *tr;
+	int ret;
+
+	if(!mt_defined_trees()) {
+		rpc->fault(ctx, 500, "Empty tree list.");
+		return;
+	}
+
+	if(rpc->scan(ctx, ".SSS", &tname, &tprefix, &tvalue) < 3) {
+		rpc->fault(ctx, 500, "Invalid Parameters");
+		return;
+	}
+
+	tr = mt_get_tree(&tname);
+	if(tr == NULL) {
+		rpc->fault(ctx, 404, "Tree not found");
+		return;
+	}
+
+	/* block all readers while updating the tree */
+	lock_get(mt_lock);
+	mt_reload_flag = 1;
+	lock_release(mt_lock);
+
+	while(mt_tree_refcnt) {
+		sleep_us(10);
+	}
+
+	ret = mt_add_to_tree(tr, &tprefix, &tvalue);
+
+	mt_reload_flag = 0;
+
+	if(ret < 0) {
+		rpc->fault(ctx, 500, "Failed to add prefix");
+		return;
+	}
+	rpc->rpl_printf(ctx, "Ok. Prefix added.");
+	return;
+}
+
+static const char *rpc_mtree_add_doc[5] = {"Add a prefix to an mtree",
+		"tname - tree name", "prefix - prefix to add",
+		"value - value stored for the prefix", 0};
+
+void rpc_mtree_rm(rpc_t *rpc, void *ctx)
+{
+	str tname = STR_NULL;
+	str tprefix = STR_NULL;
+	m_tree_t *tr;
+	int ret;
+
+	if(!mt_defined_trees()) {
+		rpc->fault(ctx, 500, "Empty tree list.");
+		return;
+	}
+
+	if(rpc->scan(ctx, ".SS", &tname, &tprefix) < 2) {
+		rpc->fault(ctx, 500, "Invalid Parameters");
+		return;
+	}
+
+	tr = mt_get_tree(&tname);
+	if(tr == NULL) {
+		rpc->fault(ctx, 404, "Tree not found");
+		return;
+	}
+
+	/* block all readers while updating the tree */
+	lock_get(mt_lock);
+	mt_reload_flag = 1;
+	lock_release(mt_lock);
+
+	while(mt_tree_refcnt) {
+		sleep_us(10);
+	}
+
+	ret = mt_remove_from_tree(tr, &tprefix);
+
+	mt_reload_flag = 0;
+
+	if(ret < 0) {
+		rpc->fault(ctx, 500, "Failed to remove prefix");
+		return;
+	}
+	if(ret > 0) {
+		rpc->fault(ctx, 404, "Prefix not found");
+		return;
+	}
+	rpc->rpl_printf(ctx, "Ok. Prefix removed.");
+	return;
+}
+
+static const char *rpc_mtree_rm_doc[4] = {"Remove a prefix from an mtree",
+		"tname - tree name", "prefix - prefix to remove", 0};
+
 
 int rpc_mtree_print_node(rpc_t *rpc, void *ctx, m_tree_t *tree, mt_node_t *pt,
 		char *code, int len)
@@ -1080,6 +1180,8 @@ rpc_export_t mtree_rpc[] = {
 		{"mtree.summary", rpc_mtree_summary, rpc_mtree_summary_doc, RET_ARRAY},
 		{"mtree.reload", rpc_mtree_reload, rpc_mtree_reload_doc, 0},
 		{"mtree.match", rpc_mtree_match, rpc_mtree_match_doc, 0},
+		{"mtree.add", rpc_mtree_add, rpc_mtree_add_doc, 0},
+		{"mtree.rm", rpc_mtree_rm, rpc_mtree_rm_doc, 0},
 		{"mtree.list", rpc_mtree_list, rpc_mtree_list_doc, RET_ARRAY},
 		{0, 0, 0, 0}};
 
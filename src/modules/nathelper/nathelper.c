@@ -21,6 +21,10 @@
  *
  */
 
+#if defined(__OS_linux) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* for sendmmsg() */
+#endif
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -184,6 +188,8 @@ static str force_socket_str = STR_NULL;
 static int sipping_flag = -1;
 static int natping_disable_flag = -1;
 static int natping_processes = 1;
+static int natping_batch = 0;
+static int natping_pause = 1000;
 
 static str nortpproxy_str = str_init("a=nortpproxy:yes");
 
@@ -275,6 +281,8 @@ static param_export_t params[] = {
 	{"sipping_bflag",         PARAM_INT, &sipping_flag          },
 	{"natping_disable_bflag", PARAM_INT, &natping_disable_flag  },
 	{"natping_processes",     PARAM_INT, &natping_processes     },
+	{"natping_batch",         PARAM_INT, &natping_batch         },
+	{"natping_pause",         PARAM_INT, &natping_pause         },
 	{"natping_socket",        PARAM_STRING, &natping_socket        },
 	{"keepalive_timeout",     PARAM_INT, &nh_keepalive_timeout  },
 	{"udpping_from_path",     PARAM_INT, &udpping_from_path     },
@@ -2198,15 +2206,17 @@ static u_short raw_checksum(unsigned char *buffer, int len)
 }
 
 
-static int send_raw(const char *buf, int buf_len, union sockaddr_union *to,
-		const unsigned int s_ip, const unsigned int s_port)
+#define NH_RAW_PKT_SIZE 50
+
+static int build_raw_packet(unsigned char *packet, const char *buf, int buf_len,
+		union sockaddr_union *to, const unsigned int s_ip,
+		const unsigned int s_port)
 {
 	struct ip *ip;
 	struct udphdr *udp;
-	unsigned char packet[50];
 	int len = sizeof(struct ip) + sizeof(struct udphdr) + buf_len;
 
-	if(len > sizeof(packet)) {
+	if(len > NH_RAW_PKT_SIZE) {
 		LM_ERR("payload too big\n");
 		return -1;
 	}
@@ -2234,10 +2244,93 @@ static int send_raw(const char *buf, int buf_len, union sockaddr_union *to,
 	udp->uh_ulen = htons((unsigned short)sizeof(struct udphdr) + buf_len);
 	udp->uh_sum = 0;
 
+	return len;
+}
+
+static int send_raw(const char *buf, int buf_len, union sockaddr_union *to,
+		const unsigned int s_ip, const unsigned int s_port)
+{
+	unsigned char packet[NH_RAW_PKT_SIZE];
+	int len;
+
+	len = build_raw_packet(packet, buf, buf_len, to, s_ip, s_port);
+	if(len < 0)
+		return -1;
+
 	return sendto(raw_sock, packet, len, 0, (struct sockaddr *)to,
 			sizeof(struct sockaddr_in));
 }
 
+#if defined(__OS_linux) && defined(_GNU_SOURCE)
+
+#define NH_RAW_BATCH_MAX 64
+
+static unsigned char nh_raw_pkts[NH_RAW_BATCH_MAX][NH_RAW_PKT_SIZE];
+static struct sockaddr_in nh_raw_dsts[NH_RAW_BATCH_MAX];
+static struct iovec nh_raw_iov[NH_RAW_BATCH_MAX];
+static struct mmsghdr nh_raw_hdrs[NH_RAW_BATCH_MAX];
+static int nh_raw_count = 0;
+
+/**
+ * send the raw pings queued by send_raw_buffered() with one sendmmsg() call
+ */
+static void flush_raw_batch(void)
+{
+	int n;
+
+	if(nh_raw_count == 0)
+		return;
+	n = sendmmsg(raw_sock, nh_raw_hdrs, nh_raw_count, 0);
+	if(n < nh_raw_count) {
+		LM_ERR("sendmmsg sent %d out of %d raw pings: %s (%d)\n", n,
+				nh_raw_count, strerror(errno), errno);
+	}
+	nh_raw_count = 0;
+}
+
+/**
+ * queue a raw ping for the batched sendmmsg() flush
+ */
+static int send_raw_buffered(const char *buf, int buf_len,
+		union sockaddr_union *to, const unsigned int s_ip,
+		const unsigned int s_port)
+{
+	int len;
+
+	len = build_raw_packet(nh_raw_pkts[nh_raw_count], buf, buf_len, to, s_ip,
+			s_port);
+	if(len < 0)
+		return -1;
+	memcpy(&nh_raw_dsts[nh_raw_count], &to->sin, sizeof(struct sockaddr_in));
+	nh_raw_iov[nh_raw_count].iov_base = nh_raw_pkts[nh_raw_count];
+	nh_raw_iov[nh_raw_count].iov_len = len;
+	memset(&nh_raw_hdrs[nh_raw_count], 0, sizeof(struct mmsghdr));
+	nh_raw_hdrs[nh_raw_count].msg_hdr.msg_name = &nh_raw_dsts[nh_raw_count];
+	nh_raw_hdrs[nh_raw_count].msg_hdr.msg_namelen =
+			sizeof(struct sockaddr_in);
+	nh_raw_hdrs[nh_raw_count].msg_hdr.msg_iov = &nh_raw_iov[nh_raw_count];
+	nh_raw_hdrs[nh_raw_count].msg_hdr.msg_iovlen = 1;
+	nh_raw_count++;
+	if(nh_raw_count == NH_RAW_BATCH_MAX)
+		flush_raw_batch();
+	return len;
+}
+
+#else
+
+static void flush_raw_batch(void)
+{
+}
+
+static int send_raw_buffered(const char *buf, int buf_len,
+		union sockaddr_union *to, const unsigned int s_ip,
+		const unsigned int s_port)
+{
+	return send_raw(buf, buf_len, to, s_ip, s_port);
+}
+
+#endif
+
 /**
  * quick function to extract ip:port from path
  */
@@ -2310,6 +2403,7 @@ static void nh_timer(unsigned int ticks, void *timer_idx)
 	unsigned short path_port = 0;
 	int options = 0;
 	int send_sip_ping = 0;
+	int npings = 0;
 
 	if((*natping_state) == 0)
 		goto done;
@@ -2460,12 +2554,20 @@ static void nh_timer(unsigned int ticks, void *timer_idx)
 				LM_ERR("sip udp_send failed\n");
 			}
 		} else if(raw_ip) {
-			if(send_raw((char *)sbuf, sizeof(sbuf), &dst.to, raw_ip, raw_port)
+			if((natping_batch > 0
+							   ? send_raw_buffered((char *)sbuf, sizeof(sbuf),
+									   &dst.to, raw_ip, raw_port)
+							   : send_raw((char *)sbuf, sizeof(sbuf), &dst.to,
+									   raw_ip, raw_port))
 					< 0) {
 				LM_ERR("send_raw failed\n");
 			}
 		} else if(udpping_from_path) {
-			if(send_raw((char *)sbuf, sizeof(sbuf), &dst.to, path_ip, path_port)
+			if((natping_batch > 0
+							   ? send_raw_buffered((char *)sbuf, sizeof(sbuf),
+									   &dst.to, path_ip, path_port)
+							   : send_raw((char *)sbuf, sizeof(sbuf), &dst.to,
+									   path_ip, path_port))
 					< 0) {
 				LM_ERR("send_raw from path failed\n");
 			}
@@ -2474,7 +2576,17 @@ static void nh_timer(unsigned int ticks, void *timer_idx)
 				LM_ERR("udp_send failed\n");
 			}
 		}
+		npings++;
+		if(natping_batch > 0 && npings % natping_batch == 0) {
+			/* pace the pings within the tick - flush what is queued and
+			 * give the wire (and this cpu) a short break, instead of
+			 * blasting the whole partition back-to-back */
+			flush_raw_batch();
+			if(natping_pause > 0)
+				sleep_us(natping_pause);
+		}
 	}
+	flush_raw_batch();
 	pkg_free(buf);
 done:
 	iteration++;
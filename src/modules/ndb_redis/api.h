@@ -30,6 +30,9 @@ typedef redisc_server_t *(*redisc_get_server_f)(str *name);
 typedef int (*redisc_exec_f)(str *srv, str *res, str *cmd, ...);
 typedef redisReply *(*redisc_exec_argv_f)(redisc_server_t *rsrv, int argc,
 		const char **argv, const size_t *argvlen);
+typedef int (*redisc_exec_argv_many_f)(redisc_server_t *rsrv, int ncmd,
+		const int *argcv, const char ***argvv, const size_t **argvlenv,
+		redisReply **rplv);
 typedef redisc_reply_t *(*redisc_get_reply_f)(str *name);
 typedef int (*redisc_free_reply_f)(str *name);
 
@@ -44,6 +47,7 @@ typedef struct ndb_redis_api
 	redisc_exec_argv_f exec_argv;
 	redisc_get_reply_f get_reply;
 	redisc_free_reply_f free_reply;
+	redisc_exec_argv_many_f exec_argv_many;
 } ndb_redis_api_t;
 
 typedef int (*bind_ndb_redis_f)(ndb_redis_api_t *api);
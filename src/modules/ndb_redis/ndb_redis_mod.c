@@ -369,10 +369,6 @@ static int w_redis_pipe_cmd3(
 {
 	str s[3];
 
-	if(redis_cluster_param) {
-		LM_ERR("Pipelining is not supported if cluster parameter is enabled\n");
-		return -1;
-	}
 	if(fixup_get_svalue(msg, (gparam_t *)ssrv, &s[0]) != 0) {
 		LM_ERR("no redis server name\n");
 		return -1;
@@ -401,10 +397,6 @@ static int w_redis_pipe_cmd4(
 	str arg1;
 	char c1;
 
-	if(redis_cluster_param) {
-		LM_ERR("Pipelining is not supported if cluster parameter is enabled\n");
-		return -1;
-	}
 	if(fixup_get_svalue(msg, (gparam_t *)ssrv, &s[0]) != 0) {
 		LM_ERR("no redis server name\n");
 		return -1;
@@ -441,10 +433,6 @@ static int w_redis_pipe_cmd5(struct sip_msg *msg, char *ssrv, char *scmd,
 	str arg1, arg2;
 	char c1, c2;
 
-	if(redis_cluster_param) {
-		LM_ERR("Pipelining is not supported if cluster parameter is enabled\n");
-		return -1;
-	}
 	if(fixup_get_svalue(msg, (gparam_t *)ssrv, &s[0]) != 0) {
 		LM_ERR("no redis server name\n");
 		return -1;
@@ -488,10 +476,6 @@ static int w_redis_pipe_cmd6(struct sip_msg *msg, char *ssrv, char *scmd,
 	str arg1, arg2, arg3;
 	char c1, c2, c3;
 
-	if(redis_cluster_param) {
-		LM_ERR("Pipelining is not supported if cluster parameter is enabled\n");
-		return -1;
-	}
 	if(fixup_get_svalue(msg, (gparam_t *)ssrv, &s[0]) != 0) {
 		LM_ERR("no redis server name\n");
 		return -1;
@@ -540,10 +524,6 @@ static int w_redis_execute(struct sip_msg *msg, char *ssrv)
 	str s;
 	int rv;
 
-	if(redis_cluster_param) {
-		LM_ERR("Pipelining is not supported if cluster parameter is enabled\n");
-		return -1;
-	}
 	if(fixup_get_svalue(msg, (gparam_t *)ssrv, &s) != 0) {
 		LM_ERR("no redis server name\n");
 		return -1;
@@ -954,6 +934,7 @@ int bind_ndb_redis(ndb_redis_api_t *api)
 	api->exec_argv = redisc_exec_argv;
 	api->get_reply = redisc_get_reply;
 	api->free_reply = redisc_free_reply;
+	api->exec_argv_many = redisc_exec_argv_many;
 
 	return 0;
 }
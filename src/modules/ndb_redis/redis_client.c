@@ -55,6 +55,8 @@ static redisc_server_t *_redisc_srv_list = NULL;
 
 static redisc_reply_t *_redisc_rpl_list = NULL;
 
+int check_cluster_reply(redisReply *reply, redisc_server_t **rsrv);
+
 extern int init_without_redis;
 extern int redis_connect_timeout_param;
 extern int redis_cmd_timeout_param;
@@ -795,10 +797,40 @@ void redisc_free_pipelined_cmds(redisc_server_t *rsrv)
 	rsrv->piped.pending_commands = 0;
 }
 
+/**
+ * Append an already formatted command to the pipeline of a server,
+ * used when a cluster redirect moves a command to another node.
+ */
+static int redisc_append_formatted(
+		redisc_server_t *rsrv, str *cmd, redisc_reply_t *rpl)
+{
+	char *s;
+
+	if(rsrv->piped.pending_commands >= MAXIMUM_PIPELINED_COMMANDS) {
+		LM_ERR("Too many pipelined commands, maximum is %d\n",
+				MAXIMUM_PIPELINED_COMMANDS);
+		return -1;
+	}
+	/* command buffers are released with free() */
+	s = malloc(cmd->len);
+	if(s == NULL) {
+		SYS_MEM_ERROR;
+		return -1;
+	}
+	memcpy(s, cmd->s, cmd->len);
+	rsrv->piped.commands[rsrv->piped.pending_commands].s = s;
+	rsrv->piped.commands[rsrv->piped.pending_commands].len = cmd->len;
+	rsrv->piped.replies[rsrv->piped.pending_commands] = rpl;
+	rsrv->piped.pending_commands++;
+	return 0;
+}
+
+#define MAXIMUM_REDIRECT_SERVERS 16
+
 /**
  *
  */
-int redisc_exec_pipelined(redisc_server_t *rsrv)
+static int redisc_exec_pipelined_l(redisc_server_t *rsrv, int redirect)
 {
 	redisc_reply_t *rpl;
 	int i;
@@ -872,6 +904,53 @@ int redisc_exec_pipelined(redisc_server_t *rsrv)
 		}
 		LM_DBG_redis_reply(rpl->rplRedis);
 	}
+
+	if(redirect && redis_cluster_param) {
+		/* a resharded cluster answers MOVED for the commands hashing to
+		 * a slot served by another node - requeue those commands on the
+		 * node the cluster pointed to, so commands moved to the same
+		 * node still share one round-trip */
+		redisc_server_t *moved_srv[MAXIMUM_REDIRECT_SERVERS];
+		redisc_server_t *rsrv2;
+		int moved_cnt = 0;
+		int ret = 0;
+		int j;
+
+		for(i = 0; i < rsrv->piped.pending_commands; i++) {
+			rpl = rsrv->piped.replies[i];
+			if(rpl->rplRedis == NULL
+					|| rpl->rplRedis->type != REDIS_REPLY_ERROR)
+				continue;
+			rsrv2 = NULL;
+			if(!check_cluster_reply(rpl->rplRedis, &rsrv2))
+				continue;
+			if(rsrv2 == rsrv)
+				continue;
+			if(redisc_append_formatted(
+					   rsrv2, &rsrv->piped.commands[i], rpl)
+					< 0)
+				continue;
+			for(j = 0; j < moved_cnt; j++) {
+				if(moved_srv[j] == rsrv2)
+					break;
+			}
+			if(j == moved_cnt) {
+				if(moved_cnt < MAXIMUM_REDIRECT_SERVERS) {
+					moved_srv[moved_cnt++] = rsrv2;
+				} else if(redisc_exec_pipelined_l(rsrv2, 0) < 0) {
+					ret = -1;
+				}
+			}
+		}
+		redisc_free_pipelined_cmds(rsrv);
+		rsrv->disable.consecutive_errors = 0;
+		for(j = 0; j < moved_cnt; j++) {
+			if(redisc_exec_pipelined_l(moved_srv[j], 0) < 0)
+				ret = -1;
+		}
+		return ret;
+	}
+
 	redisc_free_pipelined_cmds(rsrv);
 	rsrv->disable.consecutive_errors = 0;
 	return 0;
@@ -885,6 +964,14 @@ srv_disabled:
 	return -2;
 }
 
+/**
+ *
+ */
+int redisc_exec_pipelined(redisc_server_t *rsrv)
+{
+	return redisc_exec_pipelined_l(rsrv, 1);
+}
+
 int check_cluster_reply(redisReply *reply, redisc_server_t **rsrv)
 {
 	redisc_server_t *rsrv_new;
@@ -1223,6 +1310,74 @@ again:
 	return res;
 }
 
+/**
+ * Execute a batch of argv-style commands in one pipelined round trip.
+ * The replies are stored in rplv[] (to be freed by the caller with
+ * freeReplyObject()). On a broken connection the partial replies are
+ * discarded and the whole batch is replayed once after reconnecting.
+ * @return the number of replies on success, -1 on error
+ */
+int redisc_exec_argv_many(redisc_server_t *rsrv, int ncmd, const int *argcv,
+		const char ***argvv, const size_t **argvlenv, redisReply **rplv)
+{
+	int i;
+	int rtried = 0;
+
+	if(rsrv == NULL || ncmd <= 0 || argcv == NULL || argvv == NULL
+			|| rplv == NULL) {
+		LM_ERR("invalid parameters\n");
+		return -1;
+	}
+	if(rsrv->ctxRedis == NULL) {
+		LM_ERR("no redis context found for server %.*s\n", rsrv->sname->len,
+				rsrv->sname->s);
+		return -1;
+	}
+	for(i = 0; i < ncmd; i++)
+		rplv[i] = NULL;
+
+again:
+	for(i = 0; i < ncmd; i++) {
+		if(redisAppendCommandArgv(rsrv->ctxRedis, argcv[i], argvv[i],
+				   (argvlenv) ? argvlenv[i] : NULL)
+				!= REDIS_OK) {
+			LM_ERR("failed to append command %d to the pipeline\n", i);
+			break;
+		}
+	}
+	if(i == ncmd) {
+		for(i = 0; i < ncmd; i++) {
+			if(redisGetReply(rsrv->ctxRedis, (void **)&rplv[i]) != REDIS_OK
+					|| rplv[i] == NULL) {
+				rplv[i] = NULL;
+				break;
+			}
+		}
+	}
+	if(rsrv->ctxRedis->err) {
+		LOG(ndb_redis_debug, "Redis error: %s\n", rsrv->ctxRedis->errstr);
+	}
+	if(i == ncmd)
+		return ncmd;
+
+	/* failed talking to the server - drop the partial replies, reconnect
+	 * and replay the whole batch once */
+	for(i = 0; i < ncmd; i++) {
+		if(rplv[i] != NULL) {
+			freeReplyObject(rplv[i]);
+			rplv[i] = NULL;
+		}
+	}
+	if(rtried == 0 && redisc_reconnect_server(rsrv) == 0) {
+		LOG(ndb_redis_debug, "Trying to reconnect to server\n");
+		rtried = 1;
+		goto again;
+	}
+	LM_ERR("Unable to execute pipelined commands on server: %.*s\n",
+			rsrv->sname->len, rsrv->sname->s);
+	return -1;
+}
+
 /**
  *
  */
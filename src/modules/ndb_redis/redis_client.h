@@ -115,6 +115,8 @@ int redisc_create_pipelined_message(redisc_server_t *rsrv);
 void redisc_free_pipelined_cmds(redisc_server_t *rsrv);
 redisReply *redisc_exec_argv(redisc_server_t *rsrv, int argc, const char **argv,
 		const size_t *argvlen);
+int redisc_exec_argv_many(redisc_server_t *rsrv, int ncmd, const int *argcv,
+		const char ***argvv, const size_t **argvlenv, redisReply **rplv);
 redisc_reply_t *redisc_get_reply(str *name);
 int redisc_free_reply(str *name);
 int redisc_check_auth(redisc_server_t *rsrv, char *pass);
@@ -41,6 +41,7 @@
 #include "../../core/timer.h"
 #include "../../core/ut.h"
 #include "../../core/locking.h"
+#include "../../core/atomic_ops.h"
 #include "../../core/action.h"
 #include "../../core/mod_fix.h"
 #include "../../core/parser/parse_from.h"
@@ -79,10 +80,13 @@ str pdt_prefix = {"", 0};
 /* List of allowed chars for a prefix*/
 str pdt_char_list = {"0123456789", 10};
 
-/* lock, ref counter and flag used for reloading the date */
+/* lock serializing the reloads; readers do not lock - they take a
+ * reference on the generation they read, reloads build the new tree
+ * aside, swap the tree pointer and drain the old generation counter
+ * before freeing the old tree */
 static gen_lock_t *pdt_lock = 0;
-static volatile int pdt_tree_refcnt = 0;
-static volatile int pdt_reload_flag = 0;
+static atomic_t *pdt_tree_refcnt = NULL;
+static volatile int *pdt_tree_crt = NULL;
 
 static int w_prefix2domain(struct sip_msg *msg, char *str1, char *str2);
 static int w_prefix2domain_1(struct sip_msg *msg, char *mode, char *str2);
@@ -202,6 +206,21 @@ static int mod_init(void)
 	}
 	*_ptree = 0;
 
+	/* per-generation reader counters and current generation index */
+	pdt_tree_refcnt = (atomic_t *)shm_malloc(2 * sizeof(atomic_t));
+	if(pdt_tree_refcnt == NULL) {
+		LM_ERR("out of shm mem for tree refcnt\n");
+		goto error1;
+	}
+	atomic_set(&pdt_tree_refcnt[0], 0);
+	atomic_set(&pdt_tree_refcnt[1], 0);
+	pdt_tree_crt = (int *)shm_malloc(sizeof(int));
+	if(pdt_tree_crt == NULL) {
+		LM_ERR("out of shm mem for tree generation\n");
+		goto error1;
+	}
+	*pdt_tree_crt = 0;
+
 	/* loading all information from database */
 	if(pdt_load_db() != 0) {
 		LM_ERR("cannot load info from database\n");
@@ -228,6 +247,14 @@ error1:
 		shm_free(_ptree);
 		_ptree = 0;
 	}
+	if(pdt_tree_refcnt != NULL) {
+		shm_free(pdt_tree_refcnt);
+		pdt_tree_refcnt = NULL;
+	}
+	if(pdt_tree_crt != NULL) {
+		shm_free((void *)pdt_tree_crt);
+		pdt_tree_crt = NULL;
+	}
 
 	if(db_con != NULL) {
 		pdt_dbf.close(db_con);
@@ -267,6 +294,14 @@ static void mod_destroy(void)
 		lock_dealloc(pdt_lock);
 		pdt_lock = 0;
 	}
+	if(pdt_tree_refcnt != NULL) {
+		shm_free(pdt_tree_refcnt);
+		pdt_tree_refcnt = NULL;
+	}
+	if(pdt_tree_crt != NULL) {
+		shm_free((void *)pdt_tree_crt);
+		pdt_tree_crt = NULL;
+	}
 }
 
 
@@ -348,6 +383,8 @@ static int pd_translate(sip_msg_t *msg, str *sdomain, int rmode, int fmode)
 	str *d, p;
 	str sdall = {"*", 1};
 	int plen;
+	int crt;
+	pdt_tree_t *ptree;
 
 	if(msg == NULL) {
 		LM_ERR("received null msg\n");
@@ -381,20 +418,21 @@ static int pd_translate(sip_msg_t *msg, str *sdomain, int rmode, int fmode)
 	p.len = msg->parsed_uri.user.len - pdt_prefix.len;
 
 again:
-	lock_get(pdt_lock);
-	if(pdt_reload_flag) {
-		lock_release(pdt_lock);
-		sleep_us(5);
+	/* take a reference on the current generation - no lock, a reload
+	 * swapping the tree meanwhile moves to the other generation and
+	 * waits for this one to be released before freeing the old tree */
+	crt = *pdt_tree_crt;
+	atomic_inc(&pdt_tree_refcnt[crt]);
+	if(crt != *pdt_tree_crt) {
+		atomic_dec(&pdt_tree_refcnt[crt]);
 		goto again;
 	}
-	pdt_tree_refcnt++;
-	lock_release(pdt_lock);
-
+	ptree = *_ptree;
 
-	if((d = pdt_get_domain(*_ptree, sdomain, &p, &plen)) == NULL) {
+	if((d = pdt_get_domain(ptree, sdomain, &p, &plen)) == NULL) {
 		plen = 0;
 		if((fmode == 0)
-				|| (d = pdt_get_domain(*_ptree, &sdall, &p, &plen)) == NULL) {
+				|| (d = pdt_get_domain(ptree, &sdall, &p, &plen)) == NULL) {
 			LM_INFO("no prefix PDT prefix matched [%.*s]\n", p.len, p.s);
 			goto error;
 		}
@@ -407,15 +445,11 @@ again:
 		goto error;
 	}
 
-	lock_get(pdt_lock);
-	pdt_tree_refcnt--;
-	lock_release(pdt_lock);
+	atomic_dec(&pdt_tree_refcnt[crt]);
 	return 1;
 
 error:
-	lock_get(pdt_lock);
-	pdt_tree_refcnt--;
-	lock_release(pdt_lock);
+	atomic_dec(&pdt_tree_refcnt[crt]);
 	return -1;
 }
 
@@ -542,7 +576,7 @@ int pdt_load_db(void)
 	db_key_t db_cols[3] = {&sdomain_column, &prefix_column, &domain_column};
 	str p, d, sdomain;
 	db1_res_t *db_res = NULL;
-	int i, ret;
+	int i, ret, crt;
 	pdt_tree_t *_ptree_new = NULL;
 	pdt_tree_t *old_tree = NULL;
 
@@ -634,19 +668,21 @@ int pdt_load_db(void)
 	pdt_dbf.free_result(db_con, db_res);
 
 
-	/* block all readers */
+	/* swap in the new tree and flip the generation - readers keep
+	 * working, the old tree is freed once its generation is released */
 	lock_get(pdt_lock);
-	pdt_reload_flag = 1;
-	lock_release(pdt_lock);
-
-	while(pdt_tree_refcnt) {
-		sleep_us(10);
-	}
 
 	old_tree = *_ptree;
 	*_ptree = _ptree_new;
+	crt = *pdt_tree_crt;
+	membar_write();
+	*pdt_tree_crt = 1 - crt;
+
+	while(atomic_get(&pdt_tree_refcnt[crt]) != 0) {
+		sleep_us(10);
+	}
 
-	pdt_reload_flag = 0;
+	lock_release(pdt_lock);
 
 	/* free old data */
 	if(old_tree != NULL)
@@ -426,6 +426,8 @@ int reload_address_table(void)
 		return ret;
 	}
 
+	subnet_table_sort(atg.subnet_table);
+
 	*perm_addr_table = atg.address_table;
 	*perm_subnet_table = atg.subnet_table;
 	*perm_domain_table = atg.domain_table;
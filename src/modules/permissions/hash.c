@@ -640,13 +640,13 @@ struct subnet *new_subnet_table(void)
 
 
 /*
- * Add <grp, subnet, mask, port, tag> into subnet table so that table is
- * kept in increasing ordered according to grp.
+ * Add <grp, subnet, mask, port, tag> at the end of subnet table. The
+ * table is ordered by subnet_table_sort() after the load is completed,
+ * before it is made the current one.
  */
 int subnet_table_insert(struct subnet *table, unsigned int grp,
 		ip_addr_t *subnet, unsigned int mask, unsigned int port, str *tagv)
 {
-	int i;
 	unsigned int count;
 	str tags;
 
@@ -671,22 +671,86 @@ int subnet_table_insert(struct subnet *table, unsigned int grp,
 		tags.s[tags.len] = '\0';
 	}
 
-	i = count - 1;
+	table[count].grp = grp;
+	memcpy(&table[count].subnet, subnet, sizeof(ip_addr_t));
+	table[count].port = port;
+	table[count].mask = mask;
+	table[count].tag = tags;
+
+	table[PERM_MAX_SUBNETS].grp = count + 1;
+
+	return 1;
+}
 
-	while((i >= 0) && (table[i].grp > grp)) {
-		table[i + 1] = table[i];
-		i--;
+
+/*
+ * Compare the first mask bits of two addresses of the same family
+ */
+static int subnet_masked_cmp(
+		const ip_addr_t *a, const ip_addr_t *b, unsigned int mask)
+{
+	int mbytes, mbits;
+	unsigned char ca, cb;
+	int ret;
+
+	mbytes = mask / 8;
+	if(mbytes > 0) {
+		ret = memcmp(a->u.addr, b->u.addr, mbytes);
+		if(ret != 0)
+			return (ret < 0) ? -1 : 1;
 	}
+	mbits = mask % 8;
+	if(mbits == 0)
+		return 0;
+	ca = a->u.addr[mbytes] & (~((1 << (8 - mbits)) - 1));
+	cb = b->u.addr[mbytes] & (~((1 << (8 - mbits)) - 1));
+	if(ca != cb)
+		return (ca < cb) ? -1 : 1;
+	return 0;
+}
 
-	table[i + 1].grp = grp;
-	memcpy(&table[i + 1].subnet, subnet, sizeof(ip_addr_t));
-	table[i + 1].port = port;
-	table[i + 1].mask = mask;
-	table[i + 1].tag = tags;
 
-	table[PERM_MAX_SUBNETS].grp = count + 1;
+/*
+ * Compare a subnet record against <af, addr> masked to the record run's
+ * mask - helper for the binary searches in match_subnet_table()
+ */
+static int subnet_record_key_cmp(
+		const struct subnet *sn, int af, const ip_addr_t *addr,
+		unsigned int mask)
+{
+	if(sn->subnet.af != af)
+		return (sn->subnet.af < af) ? -1 : 1;
+	return subnet_masked_cmp(&sn->subnet, addr, mask);
+}
 
-	return 1;
+
+/*
+ * Order subnet records by group, mask, family and network so that
+ * lookups can binary search instead of scanning the whole table
+ */
+static int subnet_record_cmp(const void *pa, const void *pb)
+{
+	const struct subnet *a = (const struct subnet *)pa;
+	const struct subnet *b = (const struct subnet *)pb;
+
+	if(a->grp != b->grp)
+		return (a->grp < b->grp) ? -1 : 1;
+	if(a->mask != b->mask)
+		return (a->mask < b->mask) ? -1 : 1;
+	if(a->subnet.af != b->subnet.af)
+		return (a->subnet.af < b->subnet.af) ? -1 : 1;
+	return subnet_masked_cmp(&a->subnet, &b->subnet, a->mask);
+}
+
+
+/*
+ * Sort subnet table for binary search lookups - to be called after all
+ * entries have been inserted, before the table is made the current one
+ */
+void subnet_table_sort(struct subnet *table)
+{
+	qsort(table, table[PERM_MAX_SUBNETS].grp, sizeof(struct subnet),
+			subnet_record_cmp);
 }
 
 
@@ -697,35 +761,91 @@ int subnet_table_insert(struct subnet *table, unsigned int grp,
 int match_subnet_table(struct subnet *table, unsigned int grp, ip_addr_t *addr,
 		unsigned int port)
 {
-	unsigned int count, i;
+	int count, left, right, mid, lo, hi, i, j;
+	unsigned int mask;
 	avp_value_t val;
 
 	count = table[PERM_MAX_SUBNETS].grp;
 
-	i = 0;
-	while((i < count) && (table[i].grp < grp))
-		i++;
-
-	if(i == count)
-		return -1;
-
-	while((i < count) && (table[i].grp == grp)) {
-		if(((table[i].port == port) || (table[i].port == 0))
-				&& (ip_addr_match_net(addr, &table[i].subnet, table[i].mask)
-						== 0)) {
-			if(tag_avp.n && table[i].tag.s) {
-				val.s = table[i].tag;
-				if(add_avp(tag_avp_type | AVP_VAL_STR, tag_avp, val) != 0) {
-					LM_ERR("setting of tag_avp failed\n");
-					return -1;
-				}
+	/* the range of the group - lower and upper bound on grp */
+	left = 0;
+	right = count;
+	while(left < right) {
+		mid = left + (right - left) / 2;
+		if(table[mid].grp < grp)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	lo = left;
+	right = count;
+	while(left < right) {
+		mid = left + (right - left) / 2;
+		if(table[mid].grp <= grp)
+			left = mid + 1;
+		else
+			right = mid;
+	}
+	hi = left;
+
+	/* walk the distinct mask lengths from longest to shortest and binary
+	 * search the masked address among the networks of each run */
+	j = hi;
+	while(j > lo) {
+		mask = table[j - 1].mask;
+		/* start of the run with this mask */
+		left = lo;
+		right = j;
+		while(left < right) {
+			mid = left + (right - left) / 2;
+			if(table[mid].mask < mask)
+				left = mid + 1;
+			else
+				right = mid;
+		}
+		i = left;
+		if(mask == 0) {
+			/* mask 0 matches any address regardless of family */
+			for(mid = i; mid < j; mid++) {
+				if((table[mid].port == port) || (table[mid].port == 0))
+					goto found;
+			}
+		} else {
+			/* lower bound of <af, masked addr> in the run [i, j) */
+			left = i;
+			right = j;
+			while(left < right) {
+				mid = left + (right - left) / 2;
+				if(subnet_record_key_cmp(&table[mid], addr->af, addr, mask)
+						< 0)
+					left = mid + 1;
+				else
+					right = mid;
+			}
+			/* scan the records with matching network - ports and tags
+			 * may differ */
+			for(mid = left; mid < j
+					&& subnet_record_key_cmp(&table[mid], addr->af, addr, mask)
+							   == 0;
+					mid++) {
+				if((table[mid].port == port) || (table[mid].port == 0))
+					goto found;
 			}
-			return 1;
 		}
-		i++;
+		j = i;
 	}
 
 	return -1;
+
+found:
+	if(tag_avp.n && table[mid].tag.s) {
+		val.s = table[mid].tag;
+		if(add_avp(tag_avp_type | AVP_VAL_STR, tag_avp, val) != 0) {
+			LM_ERR("setting of tag_avp failed\n");
+			return -1;
+		}
+	}
+	return 1;
 }
 
 
@@ -224,13 +224,19 @@ void free_subnet_table(struct subnet *table);
 
 
 /*
- * Add <grp, subnet, mask, port> into subnet table so that table is
- * kept ordered according to subnet, port, grp.
+ * Add <grp, subnet, mask, port> at the end of subnet table.
  */
 int subnet_table_insert(struct subnet *table, unsigned int grp,
 		ip_addr_t *subnet, unsigned int mask, unsigned int port, str *tagv);
 
 
+/*
+ * Sort subnet table for binary search lookups - to be called after all
+ * entries have been inserted, before the table is made the current one.
+ */
+void subnet_table_sort(struct subnet *table);
+
+
 /*
  * Print subnets stored in subnet table
  */
@@ -30,6 +30,8 @@
 
 #include "../../core/dprint.h"
 #include "../../core/mem/shm_mem.h"
+#include "../../core/timer.h"
+#include "../../core/hashes.h"
 #include "ip_tree.h"
 
 
@@ -45,14 +47,14 @@ static inline pike_ip_node_t *prv_get_tree_branch(unsigned char b)
 /* locks a tree branch */
 static inline void prv_lock_tree_branch(unsigned char b)
 {
-	lock_set_get(pike_root->entry_lock_set, pike_root->entries[b].lock_idx);
+	lock_get(&pike_root->entries[b].lock);
 }
 
 
 /* unlocks a tree branch */
 static inline void prv_unlock_tree_branch(unsigned char b)
 {
-	lock_set_release(pike_root->entry_lock_set, pike_root->entries[b].lock_idx);
+	lock_release(&pike_root->entries[b].lock);
 }
 
 
@@ -71,44 +73,11 @@ void unlock_tree_branch(unsigned char b)
 }
 
 
-/* size must be a power of 2  */
-static gen_lock_set_t *init_lock_set(int *size)
-{
-	gen_lock_set_t *lset;
-
-	lset = 0; /* kill warnings */
-	for(; *size; *size = ((*size) >> 1)) {
-		LM_INFO("probing %d set size\n", *size);
-		/* create a lock set */
-		lset = lock_set_alloc(*size);
-		if(lset == 0) {
-			LM_INFO("cannot get %d locks\n", *size);
-			continue;
-		}
-		/* init lock set */
-		if(lock_set_init(lset) == 0) {
-			LM_INFO("cannot init %d locks\n", *size);
-			lock_set_dealloc(lset);
-			lset = 0;
-			continue;
-		}
-		/* alloc and init successful */
-		break;
-	}
-
-	if(*size == 0) {
-		LM_ERR("cannot get a lock set\n");
-		return 0;
-	}
-	return lset;
-}
-
-
 /* Builds and Inits a new IP tree */
-int init_ip_tree(int maximum_hits)
+int init_ip_tree(int maximum_hits, int hot_expire)
 {
-	int size;
 	int i;
+	int j;
 
 	/* create the pike_root */
 	pike_root = (pike_ip_tree_t *)shm_malloc(sizeof(pike_ip_tree_t));
@@ -118,20 +87,20 @@ int init_ip_tree(int maximum_hits)
 	}
 	memset(pike_root, 0, sizeof(pike_ip_tree_t));
 
-	/* init lock set */
-	size = MAX_IP_BRANCHES;
-	pike_root->entry_lock_set = init_lock_set(&size);
-	if(pike_root->entry_lock_set == 0) {
-		LM_ERR("failed to create locks\n");
-		goto error;
-	}
-	/* assign to each branch a lock */
+	/* give each branch its own lock, so traffic on one leading
+	 * address byte does not contend with the other branches */
 	for(i = 0; i < MAX_IP_BRANCHES; i++) {
 		pike_root->entries[i].node = 0;
-		pike_root->entries[i].lock_idx = i % size;
+		if(lock_init(&pike_root->entries[i].lock) == 0) {
+			LM_ERR("failed to init lock for branch %d\n", i);
+			for(j = 0; j < i; j++)
+				lock_destroy(&pike_root->entries[j].lock);
+			goto error;
+		}
 	}
 
 	pike_root->max_hits = maximum_hits;
+	pike_root->hot_expire = (hot_expire > 0) ? hot_expire : 1;
 
 	return 0;
 error:
@@ -147,6 +116,57 @@ unsigned int get_max_hits()
 	return (pike_root != 0) ? pike_root->max_hits : -1;
 }
 
+
+/* slot index in the hot list for an IP address */
+static inline unsigned int prv_hotlist_slot(unsigned char *ip, int ip_len)
+{
+	return get_hash1_raw((char *)ip, ip_len) & (PIKE_HOTLIST_SIZE - 1);
+}
+
+
+/* lock-free check if the IP address is in the hot list of currently
+ * blocked sources - returns 1 if blocked, 0 otherwise; to be used as
+ * fast path before walking the tree under the branch lock */
+int pike_hotlist_check(unsigned char *ip, int ip_len)
+{
+	pike_hot_slot_t *slot;
+	unsigned int expires;
+
+	if(pike_root == 0 || ip_len <= 0 || ip_len > PIKE_HOTLIST_IPLEN)
+		return 0;
+
+	slot = &pike_root->hotlist[prv_hotlist_slot(ip, ip_len)];
+	expires = slot->expires;
+	if(expires == 0 || expires <= get_ticks())
+		return 0;
+	if(slot->ip_len != ip_len || memcmp(slot->ip, ip, ip_len) != 0)
+		return 0;
+	/* re-read to catch a concurrent rewrite of the slot - if the address
+	 * changed meanwhile, fall back to the tree walk */
+	if(slot->expires != expires)
+		return 0;
+	return 1;
+}
+
+
+/* put a blocked IP address into the hot list - a slot collision simply
+ * overwrites the old entry, the evicted address falls back to the tree
+ * walk; a racing writer can at worst leave a mixed address in the slot,
+ * which no real source matches, so the slot is wasted until it expires */
+void pike_hotlist_add(unsigned char *ip, int ip_len)
+{
+	pike_hot_slot_t *slot;
+
+	if(pike_root == 0 || ip_len <= 0 || ip_len > PIKE_HOTLIST_IPLEN)
+		return;
+
+	slot = &pike_root->hotlist[prv_hotlist_slot(ip, ip_len)];
+	slot->expires = 0;
+	memcpy(slot->ip, ip, ip_len);
+	slot->ip_len = ip_len;
+	slot->expires = get_ticks() + pike_root->hot_expire;
+}
+
 /* destroy an ip_node and all nodes under it; the nodes must be first removed
  * from any other lists/timers */
 static inline void destroy_ip_node(pike_ip_node_t *node)
@@ -172,16 +192,12 @@ void destroy_ip_tree(void)
 	if(pike_root == 0)
 		return;
 
-	/* destroy and free the lock set */
-	if(pike_root->entry_lock_set) {
-		lock_set_destroy(pike_root->entry_lock_set);
-		lock_set_dealloc(pike_root->entry_lock_set);
-	}
-
-	/* destroy all the nodes */
-	for(i = 0; i < MAX_IP_BRANCHES; i++)
+	/* destroy all the nodes and the branch locks */
+	for(i = 0; i < MAX_IP_BRANCHES; i++) {
 		if(pike_root->entries[i].node)
 			destroy_ip_node(pike_root->entries[i].node);
+		lock_destroy(&pike_root->entries[i].lock);
+	}
 
 	shm_free(pike_root);
 	pike_root = 0;
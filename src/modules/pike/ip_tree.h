@@ -61,15 +61,30 @@ typedef struct pike_ip_node
 } pike_ip_node_t;
 
 
+/* number of slots in the hot list of currently blocked sources
+ * - must be a power of 2 */
+#define PIKE_HOTLIST_SIZE 1024
+
+/* maximum length of an IP address kept in a hot list slot (ipv6) */
+#define PIKE_HOTLIST_IPLEN 16
+
+typedef struct pike_hot_slot
+{
+	volatile unsigned int expires;
+	int ip_len;
+	unsigned char ip[PIKE_HOTLIST_IPLEN];
+} pike_hot_slot_t;
+
 typedef struct ip_tree
 {
 	struct entry
 	{
 		pike_ip_node_t *node;
-		int lock_idx;
+		gen_lock_t lock;
 	} entries[MAX_IP_BRANCHES];
 	unsigned short max_hits;
-	gen_lock_set_t *entry_lock_set;
+	unsigned int hot_expire;
+	pike_hot_slot_t hotlist[PIKE_HOTLIST_SIZE];
 } pike_ip_tree_t;
 
 
@@ -78,8 +93,10 @@ typedef struct ip_tree
 						- (unsigned long)(&((pike_ip_node_t *)0)->timer_ll)))
 
 
-int init_ip_tree(int);
+int init_ip_tree(int, int);
 void destroy_ip_tree(void);
+int pike_hotlist_check(unsigned char *ip, int ip_len);
+void pike_hotlist_add(unsigned char *ip, int ip_len);
 pike_ip_node_t *mark_node(unsigned char *ip, int ip_len,
 		pike_ip_node_t **father, unsigned char *flag);
 void remove_node(pike_ip_node_t *node);
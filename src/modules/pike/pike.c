@@ -115,7 +115,7 @@ static int pike_init(void)
 	}
 
 	/* init the IP tree */
-	if(init_ip_tree(pike_max_reqs) != 0) {
+	if(init_ip_tree(pike_max_reqs, pike_time_unit) != 0) {
 		LM_ERR(" ip_tree creation failed!\n");
 		goto error2;
 	}
@@ -59,6 +59,13 @@ int pike_check_ipaddr(sip_msg_t *msg, ip_addr_t *ip)
 	pike_ip_node_t *father;
 	unsigned char flags;
 
+	/* lock-free check of the hot list with the currently blocked sources,
+	 * so a flood from an already blocked IP does not touch the tree lock */
+	if(pike_hotlist_check(ip->u.addr, ip->len)) {
+		LM_DBG("src IP [%s] found in the blocked hot list\n", ip_addr2a(ip));
+		return -1;
+	}
+
 	/* first lock the proper tree branch and mark the IP with one more hit*/
 	lock_tree_branch(ip->u.addr[0]);
 	node = mark_node(ip->u.addr, ip->len, &father, &flags);
@@ -132,6 +139,10 @@ int pike_check_ipaddr(sip_msg_t *msg, ip_addr_t *ip)
 	/*print_tree( 0 );*/ /* debug */
 
 	if(flags & RED_NODE) {
+		/* remember the blocked source for the lock-free fast path - the
+		 * entry expires after one sampling unit, so an unblocked source
+		 * goes back to the tree walk right away */
+		pike_hotlist_add(ip->u.addr, ip->len);
 		if(flags & NEWRED_NODE) {
 			LM_GEN1(pike_log_level, "PIKE - BLOCKing ip %s, node=%p\n",
 					ip_addr2a(ip), node);
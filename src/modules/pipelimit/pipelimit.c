@@ -51,6 +51,7 @@
 #include "../../core/data_lump.h"
 #include "../../core/data_lump_rpl.h"
 #include "../../core/counters.h"
+#include "../../core/pt.h"
 #include "../../modules/sl/sl.h"
 #include "../../core/rpc.h"
 #include "../../core/rpc_lookup.h"
@@ -535,14 +536,18 @@ int hash[100] = {18, 50, 51, 39, 49, 68, 8, 78, 61, 75, 53, 32, 45, 77, 31, 12,
 
 /**
  * runs the pipe's algorithm
- * (expects pl_lock to be taken), TODO revert to "return" instead of "ret ="
+ * TODO revert to "return" instead of "ret ="
  * \return	-1 if drop needed, 1 if allowed
  */
 static int pipe_push_direct(pl_pipe_t *pipe)
 {
 	int ret;
+	int counter;
 
-	pipe->counter++;
+	/* hit only the sub-bucket of this process - no shared counter or
+	 * lock on the common path */
+	atomic_inc(&pipe->wcounters[process_no & (PL_WBUCKETS - 1)].count);
+	counter = pl_pipe_counter(pipe);
 
 	switch(pipe->algo) {
 		case PIPE_ALGO_NOP:
@@ -551,16 +556,16 @@ static int pipe_push_direct(pl_pipe_t *pipe)
 			ret = 2;
 			break;
 		case PIPE_ALGO_TAILDROP:
-			ret = (pipe->counter <= pipe->limit) ? 1 : -1;
+			ret = (counter <= pipe->limit) ? 1 : -1;
 			break;
 		case PIPE_ALGO_RED:
 			if(pipe->load == 0)
 				ret = 1;
 			else
-				ret = (!(pipe->counter % pipe->load)) ? 1 : -1;
+				ret = (!(counter % pipe->load)) ? 1 : -1;
 			break;
 		case PIPE_ALGO_FEEDBACK:
-			ret = (hash[pipe->counter % 100] < *drop_rate) ? -1 : 1;
+			ret = (hash[counter % 100] < *drop_rate) ? -1 : 1;
 			break;
 		case PIPE_ALGO_NETWORK:
 			ret = -1 * pipe->load;
@@ -572,11 +577,9 @@ static int pipe_push_direct(pl_pipe_t *pipe)
 	LM_DBG("pipe=%.*s algo=%d limit=%d pkg_load=%d counter=%d "
 		   "load=%2.1lf network_load=%d => %s\n",
 			pipe->name.len, pipe->name.s, pipe->algo, pipe->limit, pipe->load,
-			pipe->counter, *load_value, *network_load_value,
+			counter, *load_value, *network_load_value,
 			(ret == 1) ? "ACCEPT" : "DROP");
 
-	pl_pipe_release(&pipe->name);
-
 	return ret;
 }
 
@@ -584,7 +587,10 @@ static int pipe_push(struct sip_msg *msg, str *pipeid)
 {
 	pl_pipe_t *pipe = NULL;
 
-	pipe = pl_pipe_get(pipeid, 1);
+	/* removed pipes are freed only after a grace period, so the slot
+	 * lock can be dropped right after the lookup and the check runs on
+	 * the per-process sub-buckets without serializing the workers */
+	pipe = pl_pipe_get(pipeid, 0);
 	if(pipe == NULL) {
 		LM_ERR("pipe not found [%.*s]\n", pipeid->len, pipeid->s);
 		return -2;
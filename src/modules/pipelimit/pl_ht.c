@@ -38,6 +38,7 @@
 #include "../../core/str.h"
 #include "../../core/hashes.h"
 #include "../../core/mem/shm_mem.h"
+#include "../../core/timer.h"
 #include "../../core/rpc_lookup.h"
 
 #include "pl_ht.h"
@@ -80,6 +81,13 @@ int pl_init_htable(unsigned int hsize)
 	}
 	memset(_pl_pipes_ht->slots, 0, _pl_pipes_ht->htsize * sizeof(rlp_slot_t));
 
+	if(lock_init(&_pl_pipes_ht->glock) == 0) {
+		LM_ERR("cannot initialize removed pipes lock\n");
+		shm_free(_pl_pipes_ht->slots);
+		shm_free(_pl_pipes_ht);
+		return -1;
+	}
+
 	for(i = 0; i < _pl_pipes_ht->htsize; i++) {
 		if(lock_init(&_pl_pipes_ht->slots[i].lock) == 0) {
 			LM_ERR("cannot initialize lock[%d]\n", i);
@@ -88,6 +96,7 @@ int pl_init_htable(unsigned int hsize)
 				lock_destroy(&_pl_pipes_ht->slots[j].lock);
 				j--;
 			}
+			lock_destroy(&_pl_pipes_ht->glock);
 			shm_free(_pl_pipes_ht->slots);
 			shm_free(_pl_pipes_ht);
 			return -1;
@@ -104,6 +113,49 @@ void pl_pipe_free(pl_pipe_t *it)
 	return;
 }
 
+/* park an unlinked pipe - the cell is freed by the timer only after a
+ * grace period, so a process that looked the pipe up without keeping
+ * the slot lock is never left with a dangling pointer */
+static void pl_pipe_park(pl_pipe_t *it)
+{
+	it->gone_ticks = get_ticks();
+	it->prev = NULL;
+	lock_get(&_pl_pipes_ht->glock);
+	it->next = _pl_pipes_ht->gone;
+	_pl_pipes_ht->gone = it;
+	lock_release(&_pl_pipes_ht->glock);
+}
+
+/* free the parked pipes older than one second */
+static void pl_pipe_gone_sweep(void)
+{
+	pl_pipe_t *it, *it0, *prev;
+	unsigned int now;
+
+	if(_pl_pipes_ht->gone == NULL)
+		return;
+
+	now = get_ticks();
+	lock_get(&_pl_pipes_ht->glock);
+	prev = NULL;
+	it = _pl_pipes_ht->gone;
+	while(it) {
+		if(it->gone_ticks < now) {
+			it0 = it;
+			it = it->next;
+			if(prev == NULL)
+				_pl_pipes_ht->gone = it;
+			else
+				prev->next = it;
+			pl_pipe_free(it0);
+		} else {
+			prev = it;
+			it = it->next;
+		}
+	}
+	lock_release(&_pl_pipes_ht->glock);
+}
+
 int pl_destroy_htable(void)
 {
 	int i;
@@ -124,6 +176,14 @@ int pl_destroy_htable(void)
 		/* free locks */
 		lock_destroy(&_pl_pipes_ht->slots[i].lock);
 	}
+	/* free the parked pipes */
+	it = _pl_pipes_ht->gone;
+	while(it) {
+		it0 = it;
+		it = it->next;
+		pl_pipe_free(it0);
+	}
+	lock_destroy(&_pl_pipes_ht->glock);
 	shm_free(_pl_pipes_ht->slots);
 	shm_free(_pl_pipes_ht);
 	_pl_pipes_ht = NULL;
@@ -265,7 +325,7 @@ int pl_pipe_rm(str *pipeid)
 				it->prev = it0->prev;
 			}
 			_pl_pipes_ht->slots[idx].ssize--;
-			pl_pipe_free(it0);
+			pl_pipe_park(it0);
 
 			lock_release(&_pl_pipes_ht->slots[idx].lock);
 			return 1;
@@ -309,7 +369,7 @@ int pl_print_pipes(void)
 					it->cellid, i);
 			LM_DBG("+++ ++++ algo: %d\n", it->algo);
 			LM_DBG("+++ ++++ limit: %d\n", it->limit);
-			LM_DBG("+++ ++++ counter: %d\n", it->counter);
+			LM_DBG("+++ ++++ counter: %d\n", pl_pipe_counter(it));
 			LM_DBG("+++ ++++ last_counter: %d\n", it->last_counter);
 			LM_DBG("+++ ++++ load: %d\n", it->load);
 			LM_DBG("+++ ++++ unused intervals: %d\n", it->unused_intervals);
@@ -365,12 +425,15 @@ void pl_pipe_timer_update(int interval, int netload)
 	if(_pl_pipes_ht == NULL)
 		return;
 
+	int cnt;
+
 	for(i = 0; i < _pl_pipes_ht->htsize; i++) {
 		lock_get(&_pl_pipes_ht->slots[i].lock);
 		it = _pl_pipes_ht->slots[i].first;
 		while(it) {
+			cnt = pl_pipe_counter(it);
 			if(pl_clean_unused) {
-				if(it->counter > 0) {
+				if(cnt > 0) {
 					// used, reset unused intervals counter
 					it->unused_intervals = 0;
 				} else {
@@ -387,7 +450,7 @@ void pl_pipe_timer_update(int interval, int netload)
 							it->prev = it0->prev;
 						}
 						_pl_pipes_ht->slots[i].ssize--;
-						pl_pipe_free(it0);
+						pl_pipe_park(it0);
 						continue;
 					} else {
 						it->unused_intervals++;
@@ -398,16 +461,20 @@ void pl_pipe_timer_update(int interval, int netload)
 				if(it->algo == PIPE_ALGO_NETWORK) {
 					it->load = (netload > it->limit) ? 1 : -1;
 				} else if(it->limit && interval) {
-					it->load = it->counter / it->limit;
+					it->load = cnt / it->limit;
 				}
-				it->last_counter = it->counter;
-				it->counter = 0;
+				/* fold the sub-buckets into the base, starting a new
+				 * interval - the buckets themselves are never reset */
+				it->last_counter = cnt;
+				it->counter_base += (unsigned int)cnt;
 			}
 
 			it = it->next;
 		}
 		lock_release(&_pl_pipes_ht->slots[i].lock);
 	}
+
+	pl_pipe_gone_sweep();
 }
 
 extern int _pl_cfg_setpoint;
@@ -480,7 +547,7 @@ void rpc_pl_get_pipes(rpc_t *rpc, void *c)
 				if(rpc->rpl_printf(c,
 						   "PIPE: id=%.*s algorithm=%.*s limit=%d counter=%d",
 						   it->name.len, it->name.s, algo.len, algo.s,
-						   it->limit, it->counter)
+						   it->limit, pl_pipe_counter(it))
 						< 0) {
 					lock_release(&_pl_pipes_ht->slots[i].lock);
 					return;
@@ -510,7 +577,7 @@ int rpc_pl_list_pipe(rpc_t *rpc, void *c, pl_pipe_t *it)
 		return -1;
 	}
 	if(rpc->struct_add(th, "ssdddd", "name", it->name.s, "algorithm", algo.s,
-			   "limit", it->limit, "counter", it->counter, "last_counter",
+			   "limit", it->limit, "counter", pl_pipe_counter(it), "last_counter",
 			   it->last_counter, "unused_intervals", it->unused_intervals)
 			< 0) {
 		rpc->fault(c, 500, "Internal error address list structure");
@@ -613,7 +680,9 @@ void rpc_pl_reset_pipe(rpc_t *rpc, void *c)
 		return;
 	}
 
-	it->counter = 0;
+	/* fold the pending hits into the base - this zeroes the counter of
+	 * the current interval without touching the sub-buckets */
+	it->counter_base += (unsigned int)pl_pipe_counter(it);
 	it->last_counter = 0;
 	it->load = 0;
 	it->unused_intervals = 0;
@@ -33,6 +33,19 @@
 #define _RL_HT_H_
 
 #include "../../core/str.h"
+#include "../../core/atomic_ops.h"
+
+/* number of per-process sub-buckets for the pipe counter
+ * - must be a power of 2 */
+#define PL_WBUCKETS 16
+
+/* one counting sub-bucket, padded to a cache line so the processes
+ * hashed to different buckets do not invalidate each other's line */
+typedef struct _pl_wbucket
+{
+	atomic_t count;
+	char pad[64 - sizeof(atomic_t)];
+} pl_wbucket_t;
 
 typedef struct _pl_pipe
 {
@@ -43,16 +56,33 @@ typedef struct _pl_pipe
 	int algo;
 	int limit;
 
+	/* per-process sub-buckets - each process increments only its own
+	 * slot, the values are monotonic and never reset; the hits in the
+	 * current interval are the sum of the buckets minus counter_base */
+	pl_wbucket_t wcounters[PL_WBUCKETS];
+	unsigned int counter_base;
+
 	/* updated values */
-	int counter;
 	int last_counter;
 	int load;
 	int unused_intervals;
+	unsigned int gone_ticks;
 
 	struct _pl_pipe *prev;
 	struct _pl_pipe *next;
 } pl_pipe_t;
 
+/* hits taken by the pipe in the current interval */
+static inline int pl_pipe_counter(pl_pipe_t *pipe)
+{
+	unsigned int total = 0;
+	int i;
+
+	for(i = 0; i < PL_WBUCKETS; i++)
+		total += (unsigned int)atomic_get(&pipe->wcounters[i].count);
+	return (int)(total - pipe->counter_base);
+}
+
 typedef struct _rlp_slot
 {
 	unsigned int ssize;
@@ -64,6 +94,9 @@ typedef struct _rlp_htable
 {
 	unsigned int htsize;
 	rlp_slot_t *slots;
+	/* removed pipes parked until it is safe to free them */
+	gen_lock_t glock;
+	pl_pipe_t *gone;
 } rlp_htable_t;
 
 int pl_init_htable(unsigned int hsize);
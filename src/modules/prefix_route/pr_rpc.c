@@ -33,12 +33,17 @@
 #include "../../core/str.h"
 #include "../../core/dprint.h"
 #include "../../core/rpc.h"
+#include "../../core/route.h"
 #include "tree.h"
 #include "pr.h"
 
 
 static const char *rpc_dump_doc[2] = {"Dump the prefix route tree", NULL};
 static const char *rpc_reload_doc[2] = {"Reload prefix routes from DB", NULL};
+static const char *rpc_add_doc[2] = {
+		"Add a prefix route without reloading the tree", NULL};
+static const char *rpc_rm_doc[2] = {
+		"Remove a prefix route without reloading the tree", NULL};
 
 
 /**
@@ -89,5 +94,62 @@ static void rpc_reload(rpc_t *rpc, void *c)
 }
 
 
+/**
+ * RPC command - add a single prefix route to the tree
+ */
+static void rpc_add(rpc_t *rpc, void *c)
+{
+	char *prefix, *route;
+	int ix;
+
+	if(rpc->scan(c, "ss", &prefix, &route) < 2) {
+		rpc->fault(c, 400, "prefix and route expected");
+		return;
+	}
+
+	ix = route_lookup(&main_rt, route);
+	if(ix < 0 || ix >= main_rt.entries) {
+		rpc->fault(c, 404, "route not defined");
+		return;
+	}
+
+	if(0 != tree_route_add(prefix, route, ix)) {
+		rpc->fault(c, 500, "failed to add prefix route");
+		return;
+	}
+
+	rpc->rpl_printf(c, "Prefix route added");
+}
+
+
+/**
+ * RPC command - remove a single prefix route from the tree
+ */
+static void rpc_rm(rpc_t *rpc, void *c)
+{
+	char *prefix;
+	int err;
+
+	if(rpc->scan(c, "s", &prefix) < 1) {
+		rpc->fault(c, 400, "prefix expected");
+		return;
+	}
+
+	err = tree_route_rm(prefix);
+	if(err < 0) {
+		rpc->fault(c, 500, "failed to remove prefix route");
+		return;
+	}
+	if(err > 0) {
+		rpc->fault(c, 404, "no route for prefix");
+		return;
+	}
+
+	rpc->rpl_printf(c, "Prefix route removed");
+}
+
+
 rpc_export_t pr_rpc[] = {{"prefix_route.reload", rpc_reload, rpc_reload_doc, 0},
-		{"prefix_route.dump", rpc_dump, rpc_dump_doc, 0}, {0, 0, 0, 0}};
+		{"prefix_route.dump", rpc_dump, rpc_dump_doc, 0},
+		{"prefix_route.add", rpc_add, rpc_add_doc, 0},
+		{"prefix_route.rm", rpc_rm, rpc_rm_doc, 0}, {0, 0, 0, 0}};
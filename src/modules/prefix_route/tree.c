@@ -383,6 +383,105 @@ int tree_swap(struct tree_item *root)
 }
 
 
+/**
+ * Add a single prefix route to the live tree. New nodes are fully
+ * initialized before being linked, so concurrent lookups never see a
+ * partial branch; writers are serialized by the shared tree lock.
+ */
+int tree_route_add(const char *prefix, const char *route, int route_ix)
+{
+	struct tree *tree;
+	struct tree_item *item, *new_item;
+	const char *p;
+	int digit;
+
+	if(NULL == prefix || NULL == route || route_ix <= 0)
+		return -1;
+
+	lock_get(shared_tree_lock);
+
+	tree = shared_tree ? *shared_tree : NULL;
+	if(NULL == tree || NULL == tree->root) {
+		lock_release(shared_tree_lock);
+		return -1;
+	}
+
+	item = tree->root;
+	for(p = prefix; '\0' != *p; p++) {
+		if(!isdigit(*p))
+			continue;
+
+		digit = *p - '0';
+
+		if(NULL == item->digits[digit]) {
+			new_item = tree_item_alloc();
+			if(NULL == new_item) {
+				lock_release(shared_tree_lock);
+				return -1;
+			}
+			membar_write();
+			item->digits[digit] = new_item;
+		}
+
+		item = item->digits[digit];
+	}
+
+	strncpy(item->name, route, sizeof(item->name) - 1);
+	item->name[sizeof(item->name) - 1] = '\0';
+	membar_write();
+	item->route = route_ix;
+
+	lock_release(shared_tree_lock);
+
+	return 0;
+}
+
+
+/**
+ * Remove a single prefix route from the live tree. Only the route mark
+ * is cleared so that concurrent lookups can finish their walk; empty
+ * branches are released at the next full reload. Returns 1 when no
+ * route is set for the prefix.
+ */
+int tree_route_rm(const char *prefix)
+{
+	struct tree *tree;
+	struct tree_item *item;
+	const char *p;
+
+	if(NULL == prefix)
+		return -1;
+
+	lock_get(shared_tree_lock);
+
+	tree = shared_tree ? *shared_tree : NULL;
+	if(NULL == tree || NULL == tree->root) {
+		lock_release(shared_tree_lock);
+		return -1;
+	}
+
+	item = tree->root;
+	for(p = prefix; '\0' != *p && NULL != item; p++) {
+		if(!isdigit(*p))
+			continue;
+
+		item = item->digits[*p - '0'];
+	}
+
+	if(NULL == item || item->route <= 0) {
+		lock_release(shared_tree_lock);
+		return 1;
+	}
+
+	item->route = 0;
+	item->name[0] = '\0';
+
+	lock_release(shared_tree_lock);
+
+	return 0;
+}
+
+
 int tree_route_get(const str *user)
 {
 	struct tree *tree;
@@ -44,6 +44,8 @@ struct tree;
 int tree_init(void);
 void tree_close(void);
 int tree_swap(struct tree_item *root);
+int tree_route_add(const char *prefix, const char *route, int route_ix);
+int tree_route_rm(const char *prefix);
 int tree_route_get(const str *user);
 void tree_print(FILE *f);
 #endif
@@ -1435,14 +1435,136 @@ error:
 	return NULL;
 }
 
-int publ_notify(presentity_t *p, str pres_uri, str *body, str *offline_etag,
-		str *rules_doc)
+/*! number of dedicated processes doing the notify fan-out on publish */
+int pres_fanout_processes = 0;
+
+/*! queued publish fan-out work - the strings are packed after the struct */
+typedef struct publ_fanout_job
+{
+	str pres_uri;
+	str ev_name;
+	str sender;
+	str body;
+	str etag;
+	str rules_doc;
+	struct publ_fanout_job *next;
+} publ_fanout_job_t;
+
+typedef struct publ_fanout_queue
+{
+	gen_lock_t lock;
+	publ_fanout_job_t *first;
+	publ_fanout_job_t *last;
+} publ_fanout_queue_t;
+
+static publ_fanout_queue_t *publ_fanout_queue = NULL;
+
+int pres_fanout_init(void)
+{
+	publ_fanout_queue =
+			(publ_fanout_queue_t *)shm_malloc(sizeof(publ_fanout_queue_t));
+	if(publ_fanout_queue == NULL) {
+		LM_ERR("no more shared memory\n");
+		return -1;
+	}
+	memset(publ_fanout_queue, 0, sizeof(publ_fanout_queue_t));
+	if(lock_init(&publ_fanout_queue->lock) == 0) {
+		LM_ERR("initializing fan-out queue lock\n");
+		shm_free(publ_fanout_queue);
+		publ_fanout_queue = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+void pres_fanout_destroy(void)
+{
+	publ_fanout_job_t *job;
+
+	if(publ_fanout_queue == NULL)
+		return;
+	while(publ_fanout_queue->first != NULL) {
+		job = publ_fanout_queue->first;
+		publ_fanout_queue->first = job->next;
+		shm_free(job);
+	}
+	lock_destroy(&publ_fanout_queue->lock);
+	shm_free(publ_fanout_queue);
+	publ_fanout_queue = NULL;
+}
+
+static int publ_fanout_add(str pres_uri, pres_ev_t *event, str *sender,
+		str *body, str *offline_etag, str *rules_doc)
+{
+	publ_fanout_job_t *job;
+	int size;
+	char *p;
+
+	size = sizeof(publ_fanout_job_t) + pres_uri.len + event->name.len
+		   + (sender ? sender->len : 0) + (body ? body->len : 0)
+		   + (offline_etag ? offline_etag->len : 0)
+		   + (rules_doc ? rules_doc->len : 0);
+
+	job = (publ_fanout_job_t *)shm_malloc(size);
+	if(job == NULL) {
+		LM_ERR("no more shared memory\n");
+		return -1;
+	}
+	memset(job, 0, sizeof(publ_fanout_job_t));
+
+	p = (char *)job + sizeof(publ_fanout_job_t);
+	job->pres_uri.s = p;
+	memcpy(job->pres_uri.s, pres_uri.s, pres_uri.len);
+	job->pres_uri.len = pres_uri.len;
+	p += pres_uri.len;
+	job->ev_name.s = p;
+	memcpy(job->ev_name.s, event->name.s, event->name.len);
+	job->ev_name.len = event->name.len;
+	p += event->name.len;
+	if(sender && sender->len > 0) {
+		job->sender.s = p;
+		memcpy(job->sender.s, sender->s, sender->len);
+		job->sender.len = sender->len;
+		p += sender->len;
+	}
+	if(body && body->len > 0) {
+		job->body.s = p;
+		memcpy(job->body.s, body->s, body->len);
+		job->body.len = body->len;
+		p += body->len;
+	}
+	if(offline_etag && offline_etag->len > 0) {
+		job->etag.s = p;
+		memcpy(job->etag.s, offline_etag->s, offline_etag->len);
+		job->etag.len = offline_etag->len;
+		p += offline_etag->len;
+	}
+	if(rules_doc && rules_doc->len > 0) {
+		job->rules_doc.s = p;
+		memcpy(job->rules_doc.s, rules_doc->s, rules_doc->len);
+		job->rules_doc.len = rules_doc->len;
+	}
+
+	lock_get(&publ_fanout_queue->lock);
+	if(publ_fanout_queue->last != NULL)
+		publ_fanout_queue->last->next = job;
+	else
+		publ_fanout_queue->first = job;
+	publ_fanout_queue->last = job;
+	lock_release(&publ_fanout_queue->lock);
+
+	LM_DBG("queued notify fan-out for %.*s\n", pres_uri.len, pres_uri.s);
+	return 0;
+}
+
+static int publ_notify_exec(str pres_uri, pres_ev_t *event, str *sender,
+		str *body, str *offline_etag, str *rules_doc)
 {
 	str *notify_body = NULL;
 	subs_t *subs_array = NULL, *s = NULL;
 	int ret_code = -1;
 
-	subs_array = get_subs_dialog(&pres_uri, p->event, p->sender);
+	subs_array = get_subs_dialog(&pres_uri, event, sender);
 	if(subs_array == NULL) {
 		LM_DBG("Could not find subs_dialog\n");
 		ret_code = 0;
@@ -1450,8 +1572,8 @@ int publ_notify(presentity_t *p, str pres_uri, str *body, str *offline_etag,
 	}
 
 	/* if the event does not require aggregation - we have the final body */
-	if(p->event->agg_nbody) {
-		notify_body = get_p_notify_body(pres_uri, p->event, offline_etag, NULL);
+	if(event->agg_nbody) {
+		notify_body = get_p_notify_body(pres_uri, event, offline_etag, NULL);
 		if(notify_body == NULL) {
 			LM_DBG("Could not get the notify_body\n");
 			/* goto error; */
@@ -1463,10 +1585,10 @@ int publ_notify(presentity_t *p, str pres_uri, str *body, str *offline_etag,
 		s->auth_rules_doc = rules_doc;
 
 		if(notify(s, NULL, notify_body ? notify_body : body, 0,
-				   p->event->aux_body_processing)
+				   event->aux_body_processing)
 				< 0) {
-			LM_ERR("Could not send notify for %.*s\n", p->event->name.len,
-					p->event->name.s);
+			LM_ERR("Could not send notify for %.*s\n", event->name.len,
+					event->name.s);
 		}
 
 		s = s->next;
@@ -1475,10 +1597,64 @@ int publ_notify(presentity_t *p, str pres_uri, str *body, str *offline_etag,
 
 done:
 	free_subs_list(subs_array, PKG_MEM_TYPE, 0);
-	free_notify_body(notify_body, p->event);
+	free_notify_body(notify_body, event);
 	return ret_code;
 }
 
+void pres_fanout_timer_exec(unsigned int ticks, void *param)
+{
+	publ_fanout_job_t *job;
+	pres_ev_t *event;
+
+	if(publ_fanout_queue == NULL)
+		return;
+
+	while(1) {
+		lock_get(&publ_fanout_queue->lock);
+		job = publ_fanout_queue->first;
+		if(job != NULL) {
+			publ_fanout_queue->first = job->next;
+			if(publ_fanout_queue->first == NULL)
+				publ_fanout_queue->last = NULL;
+		}
+		lock_release(&publ_fanout_queue->lock);
+		if(job == NULL)
+			return;
+
+		event = contains_event(&job->ev_name, NULL);
+		if(event == NULL) {
+			LM_ERR("event %.*s not found\n", job->ev_name.len, job->ev_name.s);
+		} else {
+			if(publ_notify_exec(job->pres_uri, event,
+					   (job->sender.s) ? &job->sender : NULL,
+					   (job->body.s) ? &job->body : NULL,
+					   (job->etag.s) ? &job->etag : NULL,
+					   (job->rules_doc.s) ? &job->rules_doc : NULL)
+					< 0) {
+				LM_ERR("sending queued notify for %.*s\n", job->pres_uri.len,
+						job->pres_uri.s);
+			}
+		}
+		shm_free(job);
+	}
+}
+
+int publ_notify(presentity_t *p, str pres_uri, str *body, str *offline_etag,
+		str *rules_doc)
+{
+	if(pres_fanout_processes > 0) {
+		/* hand the fan-out to the worker processes - the notify bodies are
+		 * built from the current presentity state at dispatch time */
+		if(publ_fanout_add(
+				   pres_uri, p->event, p->sender, body, offline_etag, rules_doc)
+				== 0)
+			return 0;
+		LM_WARN("could not queue notify fan-out - sending inline\n");
+	}
+	return publ_notify_exec(
+			pres_uri, p->event, p->sender, body, offline_etag, rules_doc);
+}
+
 int publ_notify_notifier(str pres_uri, pres_ev_t *event)
 {
 	db_key_t query_cols[2], result_cols[3];
@@ -2718,7 +2894,64 @@ error:
 	return ret;
 }
 
-static int notifier_notify(subs_t *sub, int *updated, int *end_transaction)
+/*! notify body prefetched for one presentity within a notifier round */
+typedef struct notifier_pbody
+{
+	str pres_uri;
+	pres_ev_t *event;
+	str *body;
+	struct notifier_pbody *next;
+} notifier_pbody_t;
+
+/* get the notify body for a presentity, fetching it from the database only
+ * on the first call per round - the watchers of one presentity marked in the
+ * same round share the body built before the per watcher processing */
+static str *notifier_pbody_get(
+		notifier_pbody_t **list, str *pres_uri, pres_ev_t *event, int *found)
+{
+	notifier_pbody_t *np;
+
+	for(np = *list; np != NULL; np = np->next) {
+		if(np->event == event && np->pres_uri.len == pres_uri->len
+				&& strncmp(np->pres_uri.s, pres_uri->s, pres_uri->len) == 0) {
+			*found = 1;
+			return np->body;
+		}
+	}
+
+	np = (notifier_pbody_t *)pkg_malloc(
+			sizeof(notifier_pbody_t) + pres_uri->len);
+	if(np == NULL) {
+		LM_ERR("no more pkg memory\n");
+		*found = 0;
+		return NULL;
+	}
+	memset(np, 0, sizeof(notifier_pbody_t));
+	np->pres_uri.s = (char *)np + sizeof(notifier_pbody_t);
+	memcpy(np->pres_uri.s, pres_uri->s, pres_uri->len);
+	np->pres_uri.len = pres_uri->len;
+	np->event = event;
+	np->body = get_p_notify_body(*pres_uri, event, NULL, NULL);
+	np->next = *list;
+	*list = np;
+	*found = 1;
+	return np->body;
+}
+
+static void notifier_pbody_free(notifier_pbody_t *list)
+{
+	notifier_pbody_t *np;
+
+	while(list != NULL) {
+		np = list;
+		list = list->next;
+		free_notify_body(np->body, np->event);
+		pkg_free(np);
+	}
+}
+
+static int notifier_notify(subs_t *sub, int *updated, int *end_transaction,
+		str *pbody, int pbody_found)
 {
 	str *nbody = NULL;
 	watcher_t *watchers = NULL;
@@ -2833,7 +3066,17 @@ static int notifier_notify(subs_t *sub, int *updated, int *end_transaction)
 			goto done;
 	}
 
-	if(notify(sub, NULL, nbody, 0, 0) < 0) {
+	if(nbody == NULL && pbody_found) {
+		/* use the body prefetched for this presentity by the caller - a
+		 * prefetched NULL means that there is no presence state, so do not
+		 * query the database again for every watcher */
+		if(notify(sub, NULL, pbody, (pbody == NULL) ? 1 : 0,
+				   (pbody != NULL) ? sub->event->aux_body_processing : 0)
+				< 0) {
+			LM_ERR("could not send notify\n");
+			goto error;
+		}
+	} else if(notify(sub, NULL, nbody, 0, 0) < 0) {
 		LM_ERR("could not send notify\n");
 		goto error;
 	}
@@ -2882,6 +3125,9 @@ int process_dialogs(int round, int presence_winfo)
 	int flags_col, user_agent_col;
 	int i, notify_sent = 0, cached_updated_winfo, ret = -1;
 	int end_transaction = 0;
+	notifier_pbody_t *pbody_list = NULL;
+	str *pbody = NULL;
+	int pbody_found = 0;
 	subs_t sub;
 	str ev_sname, winfo = str_init("presence.winfo");
 	int now = ksr_time_sint(NULL, NULL);
@@ -3095,7 +3341,19 @@ int process_dialogs(int round, int presence_winfo)
 
 		sub.updated = round;
 
-		if((notify_sent = notifier_notify(&sub, &updated, &end_transaction))
+		/* prefetch the notify body once per presentity - the watchers
+		 * marked in the same round share it; BLA bodies depend on the
+		 * watcher contact and are still built per watcher */
+		pbody = NULL;
+		pbody_found = 0;
+		if((sub.event->type & PUBL_TYPE) && !EVENT_DIALOG_SLA(sub.event->evp)
+				&& sub.status == ACTIVE_STATUS && sub.expires > 0) {
+			pbody = notifier_pbody_get(
+					&pbody_list, &sub.pres_uri, sub.event, &pbody_found);
+		}
+
+		if((notify_sent = notifier_notify(
+					&sub, &updated, &end_transaction, pbody, pbody_found))
 				< 0) {
 			LM_ERR("sending NOTIFY request\n");
 
@@ -3181,6 +3439,7 @@ int process_dialogs(int round, int presence_winfo)
 done:
 	ret = 0;
 error:
+	notifier_pbody_free(pbody_list);
 	if(dialog_list)
 		pa_dbf.free_result(pa_db, dialog_list);
 	if(dialog)
@@ -117,6 +117,11 @@ int query_db_notify(str *pres_uri, pres_ev_t *event, subs_t *watcher_subs);
 int publ_notify(presentity_t *p, str pres_uri, str *body, str *offline_etag,
 		str *rules_doc);
 int publ_notify_notifier(str pres_uri, pres_ev_t *event);
+
+extern int pres_fanout_processes;
+int pres_fanout_init(void);
+void pres_fanout_destroy(void);
+void pres_fanout_timer_exec(unsigned int ticks, void *param);
 int set_updated(subs_t *sub);
 int set_wipeer_subs_updated(str *pres_uri, pres_ev_t *event, int full);
 
@@ -162,6 +162,7 @@ int pres_sphere_enable = 0;
 int pres_timeout_rm_subs = 1;
 int pres_send_fast_notify = 1;
 int publ_cache_mode = PS_PCACHE_HYBRID;
+int pres_publ_absorb_period = 0;
 int pres_waitn_time = 5;
 int pres_notifier_poll_rate = 10;
 int pres_notifier_processes = 1;
@@ -222,6 +223,7 @@ static param_export_t params[]={
 	{ "waitn_time",             PARAM_INT, &pres_waitn_time },
 	{ "notifier_poll_rate",     PARAM_INT, &pres_notifier_poll_rate },
 	{ "notifier_processes",     PARAM_INT, &pres_notifier_processes },
+	{ "fanout_processes",       PARAM_INT, &pres_fanout_processes },
 	{ "force_delete",           PARAM_INT, &pres_force_delete },
 	{ "startup_mode",           PARAM_INT, &pres_startup_mode },
 	{ "expires_offset",         PARAM_INT, &pres_expires_offset },
@@ -233,6 +235,7 @@ static param_export_t params[]={
 	{ "pres_htable_size",       PARAM_INT, &phtable_size},
 	{ "subs_db_mode",           PARAM_INT, &pres_subs_dbmode},
 	{ "publ_cache",             PARAM_INT, &publ_cache_mode},
+	{ "publ_absorb_period",     PARAM_INT, &pres_publ_absorb_period},
 	{ "enable_sphere_check",    PARAM_INT, &pres_sphere_enable},
 	{ "timeout_rm_subs",        PARAM_INT, &pres_timeout_rm_subs},
 	{ "send_fast_notify",       PARAM_INT, &pres_send_fast_notify},
@@ -483,6 +486,24 @@ static int mod_init(void)
 		}
 	}
 
+	if(pres_publ_absorb_period > 0
+			&& (publ_cache_mode == PS_PCACHE_RECORD || pres_enable_dmq > 0)) {
+		LM_WARN("publ_absorb_period does not work with records publish cache"
+				" or dmq replication - disabling it\n");
+		pres_publ_absorb_period = 0;
+	}
+	if(pres_publ_absorb_period > 0) {
+		if(ps_absorb_init() < 0) {
+			LM_ERR("initializing publication absorb cache\n");
+			goto dberror;
+		}
+		if(pres_timer_mode == 0) {
+			register_timer(ps_absorb_timer, 0, pres_publ_absorb_period);
+		} else {
+			sr_wtimer_add(ps_absorb_timer, 0, pres_publ_absorb_period);
+		}
+	}
+
 	if(pres_waitn_time <= 0) {
 		pres_waitn_time = 5;
 	}
@@ -506,6 +527,20 @@ static int mod_init(void)
 		register_basic_timers(pres_notifier_processes);
 	}
 
+	if(pres_fanout_processes < 0 || pres_subs_dbmode == DB_ONLY) {
+		/* in DB_ONLY mode the notifier processes do the fan-out */
+		pres_fanout_processes = 0;
+	}
+
+	if(pres_fanout_processes > 0) {
+		if(pres_fanout_init() < 0) {
+			LM_ERR("initializing notify fan-out queue\n");
+			goto dberror;
+		}
+
+		register_basic_timers(pres_fanout_processes);
+	}
+
 	if(pres_force_delete > 0)
 		pres_force_delete = 1;
 
@@ -589,6 +624,18 @@ static int child_init(int rank)
 			}
 		}
 
+		for(i = 0; i < pres_fanout_processes; i++) {
+			char tmp[30];
+			snprintf(tmp, 30, "PRESENCE FANOUT %d", i);
+
+			if(fork_basic_utimer(PROC_TIMER, tmp, 1, pres_fanout_timer_exec,
+					   NULL, 1000000 / pres_notifier_poll_rate)
+					< 0) {
+				LM_ERR("Failed to start PRESENCE FANOUT %d\n", i);
+				return -1;
+			}
+		}
+
 		return 0;
 	}
 
@@ -641,6 +688,20 @@ static void destroy(void)
 		} else
 			timer_db_update(0, 0);
 	}
+
+	if(pres_publ_absorb_period > 0) {
+		/* flush the absorbed refreshes still waiting for a write */
+		if(pa_db == NULL)
+			pa_db = pa_dbf.init(&pres_db_url);
+		if(pa_db == NULL) {
+			LM_ERR("mod_destroy: unsuccessful connecting to database\n");
+		} else {
+			ps_absorb_timer(0, NULL);
+		}
+		ps_absorb_destroy();
+	}
+
+	pres_fanout_destroy();
 }
 
 static int fixup_presence(void **param, int param_no)
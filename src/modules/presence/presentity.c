@@ -37,6 +37,7 @@
 #include "../../core/hashes.h"
 #include "../../core/dprint.h"
 #include "../../core/mem/shm_mem.h"
+#include "../../core/locking.h"
 #include "../../core/xavp.h"
 #include "../../core/str.h"
 #include "../../core/data_lump_rpl.h"
@@ -92,6 +93,318 @@ error:
 	return NULL;
 }
 
+#define PS_ABSORB_TABLE_SIZE 1024
+
+/* publication refresh absorbing - when publ_absorb_period is set,
+ * re-publications with unchanged body only refresh the expires value
+ * in this shared memory table and the values are written back to the
+ * database in batches by ps_absorb_timer() */
+typedef struct ps_absorb_entry
+{
+	str user;
+	str domain;
+	str event;
+	str etag;
+	unsigned int bhash;
+	int blen;
+	time_t expires;
+	time_t received_time;
+	int dirty;
+	struct ps_absorb_entry *next;
+} ps_absorb_entry_t;
+
+typedef struct ps_absorb_slot
+{
+	gen_lock_t lock;
+	ps_absorb_entry_t *first;
+} ps_absorb_slot_t;
+
+static ps_absorb_slot_t *ps_absorb_table = NULL;
+
+int ps_absorb_init(void)
+{
+	int i;
+
+	ps_absorb_table = (ps_absorb_slot_t *)shm_malloc(
+			PS_ABSORB_TABLE_SIZE * sizeof(ps_absorb_slot_t));
+	if(ps_absorb_table == NULL) {
+		LM_ERR("no more shm memory\n");
+		return -1;
+	}
+	memset(ps_absorb_table, 0,
+			PS_ABSORB_TABLE_SIZE * sizeof(ps_absorb_slot_t));
+	for(i = 0; i < PS_ABSORB_TABLE_SIZE; i++) {
+		if(lock_init(&ps_absorb_table[i].lock) == 0) {
+			LM_ERR("initializing lock [%d]\n", i);
+			for(i--; i >= 0; i--)
+				lock_destroy(&ps_absorb_table[i].lock);
+			shm_free(ps_absorb_table);
+			ps_absorb_table = NULL;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void ps_absorb_destroy(void)
+{
+	int i;
+	ps_absorb_entry_t *pa;
+
+	if(ps_absorb_table == NULL)
+		return;
+	for(i = 0; i < PS_ABSORB_TABLE_SIZE; i++) {
+		while(ps_absorb_table[i].first) {
+			pa = ps_absorb_table[i].first;
+			ps_absorb_table[i].first = pa->next;
+			shm_free(pa);
+		}
+		lock_destroy(&ps_absorb_table[i].lock);
+	}
+	shm_free(ps_absorb_table);
+	ps_absorb_table = NULL;
+}
+
+static unsigned int ps_absorb_bhash(str *body, str *sender)
+{
+	unsigned int h = 0;
+
+	if(body != NULL && body->s != NULL && body->len > 0)
+		h = get_hash1_raw(body->s, body->len);
+	if(sender != NULL && sender->s != NULL && sender->len > 0)
+		h ^= get_hash1_raw(sender->s, sender->len);
+	return h;
+}
+
+static ps_absorb_entry_t **ps_absorb_search(
+		unsigned int idx, presentity_t *presentity, str *etag)
+{
+	ps_absorb_entry_t **pa;
+
+	for(pa = &ps_absorb_table[idx].first; *pa != NULL; pa = &(*pa)->next) {
+		if((*pa)->etag.len == etag->len
+				&& (*pa)->user.len == presentity->user.len
+				&& (*pa)->domain.len == presentity->domain.len
+				&& (*pa)->event.len == presentity->event->name.len
+				&& memcmp((*pa)->etag.s, etag->s, etag->len) == 0
+				&& memcmp((*pa)->user.s, presentity->user.s,
+						   presentity->user.len)
+						   == 0
+				&& memcmp((*pa)->domain.s, presentity->domain.s,
+						   presentity->domain.len)
+						   == 0
+				&& memcmp((*pa)->event.s, presentity->event->name.s,
+						   presentity->event->name.len)
+						   == 0)
+			return pa;
+	}
+	return NULL;
+}
+
+/* return 1 if the publication is an unchanged refresh that has been
+ * absorbed in memory, 0 if the caller has to take the database path */
+static int ps_absorb_refresh(presentity_t *presentity, str *body)
+{
+	unsigned int idx;
+	ps_absorb_entry_t **pa;
+	ps_absorb_entry_t *tmp;
+	int ret = 0;
+
+	if(ps_absorb_table == NULL)
+		return 0;
+	idx = core_case_hash(
+			&presentity->user, &presentity->etag, PS_ABSORB_TABLE_SIZE);
+	lock_get(&ps_absorb_table[idx].lock);
+	pa = ps_absorb_search(idx, presentity, &presentity->etag);
+	if(pa != NULL) {
+		if((*pa)->bhash == ps_absorb_bhash(body, presentity->sender)
+				&& (*pa)->blen == ((body != NULL) ? body->len : 0)) {
+			(*pa)->expires = presentity->expires + time(NULL);
+			(*pa)->received_time = presentity->received_time;
+			(*pa)->dirty = 1;
+			ret = 1;
+		} else {
+			/* state changed - drop the entry, it is stored again
+			 * after the database update */
+			tmp = *pa;
+			*pa = tmp->next;
+			shm_free(tmp);
+		}
+	}
+	lock_release(&ps_absorb_table[idx].lock);
+	return ret;
+}
+
+static void ps_absorb_rm(presentity_t *presentity, str *etag)
+{
+	unsigned int idx;
+	ps_absorb_entry_t **pa;
+	ps_absorb_entry_t *tmp;
+
+	if(ps_absorb_table == NULL)
+		return;
+	idx = core_case_hash(&presentity->user, etag, PS_ABSORB_TABLE_SIZE);
+	lock_get(&ps_absorb_table[idx].lock);
+	pa = ps_absorb_search(idx, presentity, etag);
+	if(pa != NULL) {
+		tmp = *pa;
+		*pa = tmp->next;
+		shm_free(tmp);
+	}
+	lock_release(&ps_absorb_table[idx].lock);
+}
+
+static void ps_absorb_store(presentity_t *presentity, str *cur_etag, str *body)
+{
+	unsigned int idx;
+	ps_absorb_entry_t *pa;
+	char *p;
+	int size;
+
+	if(ps_absorb_table == NULL)
+		return;
+
+	/* the etag may have been regenerated - drop any entry left under
+	 * the one the publisher used */
+	ps_absorb_rm(presentity, &presentity->etag);
+
+	size = sizeof(ps_absorb_entry_t) + presentity->user.len
+		   + presentity->domain.len + presentity->event->name.len
+		   + cur_etag->len;
+	pa = (ps_absorb_entry_t *)shm_malloc(size);
+	if(pa == NULL) {
+		LM_ERR("no more shm memory\n");
+		return;
+	}
+	memset(pa, 0, size);
+	p = (char *)pa + sizeof(ps_absorb_entry_t);
+	pa->user.s = p;
+	memcpy(pa->user.s, presentity->user.s, presentity->user.len);
+	pa->user.len = presentity->user.len;
+	p += presentity->user.len;
+	pa->domain.s = p;
+	memcpy(pa->domain.s, presentity->domain.s, presentity->domain.len);
+	pa->domain.len = presentity->domain.len;
+	p += presentity->domain.len;
+	pa->event.s = p;
+	memcpy(pa->event.s, presentity->event->name.s,
+			presentity->event->name.len);
+	pa->event.len = presentity->event->name.len;
+	p += presentity->event->name.len;
+	pa->etag.s = p;
+	memcpy(pa->etag.s, cur_etag->s, cur_etag->len);
+	pa->etag.len = cur_etag->len;
+
+	pa->bhash = ps_absorb_bhash(body, presentity->sender);
+	pa->blen = (body != NULL) ? body->len : 0;
+	pa->expires = presentity->expires + time(NULL);
+	pa->received_time = presentity->received_time;
+	pa->dirty = 0;
+
+	idx = core_case_hash(&presentity->user, cur_etag, PS_ABSORB_TABLE_SIZE);
+	lock_get(&ps_absorb_table[idx].lock);
+	pa->next = ps_absorb_table[idx].first;
+	ps_absorb_table[idx].first = pa;
+	lock_release(&ps_absorb_table[idx].lock);
+}
+
+void ps_absorb_timer(unsigned int ticks, void *param)
+{
+	db_key_t query_cols[4], update_keys[2];
+	db_val_t query_vals[4], update_vals[2];
+	ps_absorb_entry_t **pp;
+	ps_absorb_entry_t *flist, *keep, *pa;
+	time_t tnow;
+	int i;
+
+	if(ps_absorb_table == NULL || pa_db == NULL)
+		return;
+
+	if(pa_dbf.use_table(pa_db, &presentity_table) < 0) {
+		LM_ERR("unsuccessful use table\n");
+		return;
+	}
+
+	query_cols[0] = &str_username_col;
+	query_vals[0].type = DB1_STR;
+	query_vals[0].nul = 0;
+	query_cols[1] = &str_domain_col;
+	query_vals[1].type = DB1_STR;
+	query_vals[1].nul = 0;
+	query_cols[2] = &str_event_col;
+	query_vals[2].type = DB1_STR;
+	query_vals[2].nul = 0;
+	query_cols[3] = &str_etag_col;
+	query_vals[3].type = DB1_STR;
+	query_vals[3].nul = 0;
+
+	update_keys[0] = &str_expires_col;
+	update_vals[0].type = DB1_INT;
+	update_vals[0].nul = 0;
+	update_keys[1] = &str_received_time_col;
+	update_vals[1].type = DB1_INT;
+	update_vals[1].nul = 0;
+
+	tnow = time(NULL);
+
+	for(i = 0; i < PS_ABSORB_TABLE_SIZE; i++) {
+		/* take out the entries needing a write or eviction, then do
+		 * the database work without holding the slot lock */
+		flist = NULL;
+		lock_get(&ps_absorb_table[i].lock);
+		pp = &ps_absorb_table[i].first;
+		while(*pp != NULL) {
+			if((*pp)->dirty || (*pp)->expires <= tnow) {
+				pa = *pp;
+				*pp = pa->next;
+				pa->next = flist;
+				flist = pa;
+			} else {
+				pp = &(*pp)->next;
+			}
+		}
+		lock_release(&ps_absorb_table[i].lock);
+
+		keep = NULL;
+		while(flist != NULL) {
+			pa = flist;
+			flist = pa->next;
+			if(pa->expires <= tnow) {
+				/* expired - the cleanup timer removes the row */
+				shm_free(pa);
+				continue;
+			}
+			query_vals[0].val.str_val = pa->user;
+			query_vals[1].val.str_val = pa->domain;
+			query_vals[2].val.str_val = pa->event;
+			query_vals[3].val.str_val = pa->etag;
+			update_vals[0].val.int_val = (int)pa->expires;
+			update_vals[1].val.int_val = (int)pa->received_time;
+			if(pa_dbf.update(pa_db, query_cols, 0, query_vals, update_keys,
+					   update_vals, 4, 2)
+					< 0) {
+				LM_ERR("flushing absorbed refresh for etag %.*s\n",
+						pa->etag.len, pa->etag.s);
+				/* keep it dirty - retried on the next run */
+			} else {
+				pa->dirty = 0;
+			}
+			pa->next = keep;
+			keep = pa;
+		}
+		if(keep != NULL) {
+			lock_get(&ps_absorb_table[i].lock);
+			while(keep != NULL) {
+				pa = keep;
+				keep = pa->next;
+				pa->next = ps_absorb_table[i].first;
+				ps_absorb_table[i].first = pa;
+			}
+			lock_release(&ps_absorb_table[i].lock);
+		}
+	}
+}
+
 int publ_send200ok(struct sip_msg *msg, int lexpire, str etag)
 {
 	char buf[128];
@@ -890,12 +1203,42 @@ static int ps_db_update_presentity(sip_msg_t *msg, presentity_t *presentity,
 		}
 		if(sent_reply)
 			*sent_reply = 1;
+
+		if(pres_publ_absorb_period > 0 && replace == 0 && ruid == NULL
+				&& presentity->expires > 0
+				&& !EVENT_DIALOG_SLA(presentity->event->evp))
+			ps_absorb_store(presentity, &presentity->etag, body);
+
 		goto send_notify;
 	} else {
 		/* new_t==0 */
 		LM_DBG("updating existing presentity with etag %.*s\n",
 				presentity->etag.len, presentity->etag.s);
 
+		if(pres_publ_absorb_period > 0 && ruid == NULL
+				&& etag_override == NULL && replace == 0
+				&& presentity->expires > 0
+				&& !EVENT_DIALOG_SLA(presentity->event->evp)
+				&& ps_absorb_refresh(presentity, body) > 0) {
+			/* unchanged refresh absorbed in memory - the expires
+			 * update is flushed to the database by ps_absorb_timer()
+			 * and the watchers are not notified */
+			if(publ_send200ok(msg, presentity->expires, presentity->etag)
+					< 0) {
+				LM_ERR("sending 200OK reply\n");
+				goto error;
+			}
+			if(sent_reply)
+				*sent_reply = 1;
+			if(rules_doc) {
+				if(rules_doc->s)
+					pkg_free(rules_doc->s);
+				pkg_free(rules_doc);
+			}
+			pkg_free(pres_uri.s);
+			return 0;
+		}
+
 		if(ruid) {
 			p_ruid = *ruid;
 
@@ -1017,6 +1360,9 @@ static int ps_db_update_presentity(sip_msg_t *msg, presentity_t *presentity,
 
 		if(presentity->expires <= 0) {
 
+			if(pres_publ_absorb_period > 0)
+				ps_absorb_rm(presentity, &presentity->etag);
+
 			if(!db_record_exists) {
 				if(pa_dbf.query(pa_db, ruid ? rquery_cols : query_cols,
 						   ruid ? rquery_ops : query_ops,
@@ -1315,6 +1661,11 @@ static int ps_db_update_presentity(sip_msg_t *msg, presentity_t *presentity,
 		if(sent_reply)
 			*sent_reply = 1;
 
+		if(pres_publ_absorb_period > 0 && ruid == NULL && replace == 0
+				&& presentity->expires > 0
+				&& !EVENT_DIALOG_SLA(presentity->event->evp))
+			ps_absorb_store(presentity, &cur_etag, body);
+
 		if(!body)
 			goto done;
 	}
@@ -50,6 +50,13 @@ typedef struct presentity
 	unsigned int priority;
 } presentity_t;
 
+extern int pres_publ_absorb_period;
+
+/* publication refresh absorbing cache */
+int ps_absorb_init(void);
+void ps_absorb_destroy(void);
+void ps_absorb_timer(unsigned int ticks, void *param);
+
 /* create new presentity */
 presentity_t *new_presentity(str *domain, str *user, int expires,
 		pres_ev_t *event, str *etag, str *sender);
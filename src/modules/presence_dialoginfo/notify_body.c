@@ -42,6 +42,9 @@
 #include <libxml/parser.h>
 
 #include "../../core/mem/mem.h"
+#include "../../core/mem/shm_mem.h"
+#include "../../core/hashes.h"
+#include "../../core/locking.h"
 #include "../presence/utils_func.h"
 #include "../presence/hash.h"
 #include "../presence/event_list.h"
@@ -66,6 +69,166 @@ void free_xml_body(char *body)
 	body = NULL;
 }
 
+/*! cached aggregated dialog-info document for one entity - the strings are
+ * packed after the structure */
+typedef struct dlginfo_agg_entry
+{
+	str user;
+	str domain;
+	unsigned int vhash; /*!< hash over the source bodies */
+	int nbodies;		/*!< number of source bodies */
+	str body;
+} dlginfo_agg_entry_t;
+
+/*! direct mapped cache of aggregated documents - an entry is valid as long
+ * as the set of stored dialog-info bodies of the entity is unchanged and is
+ * overwritten as soon as one of them differs */
+static dlginfo_agg_entry_t **dlginfo_agg_table = NULL;
+static gen_lock_t *dlginfo_agg_lock = NULL;
+int dlginfo_agg_cache_size = 0;
+
+int dlginfo_agg_cache_init(void)
+{
+	dlginfo_agg_table = (dlginfo_agg_entry_t **)shm_malloc(
+			dlginfo_agg_cache_size * sizeof(dlginfo_agg_entry_t *));
+	if(dlginfo_agg_table == NULL) {
+		LM_ERR("no more shm memory\n");
+		return -1;
+	}
+	memset(dlginfo_agg_table, 0,
+			dlginfo_agg_cache_size * sizeof(dlginfo_agg_entry_t *));
+	dlginfo_agg_lock = lock_alloc();
+	if(dlginfo_agg_lock == NULL) {
+		LM_ERR("allocating cache lock\n");
+		shm_free(dlginfo_agg_table);
+		dlginfo_agg_table = NULL;
+		return -1;
+	}
+	if(lock_init(dlginfo_agg_lock) == NULL) {
+		LM_ERR("initializing cache lock\n");
+		lock_dealloc(dlginfo_agg_lock);
+		dlginfo_agg_lock = NULL;
+		shm_free(dlginfo_agg_table);
+		dlginfo_agg_table = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+void dlginfo_agg_cache_destroy(void)
+{
+	int i;
+
+	if(dlginfo_agg_table != NULL) {
+		for(i = 0; i < dlginfo_agg_cache_size; i++) {
+			if(dlginfo_agg_table[i] != NULL)
+				shm_free(dlginfo_agg_table[i]);
+		}
+		shm_free(dlginfo_agg_table);
+		dlginfo_agg_table = NULL;
+	}
+	if(dlginfo_agg_lock != NULL) {
+		lock_destroy(dlginfo_agg_lock);
+		lock_dealloc(dlginfo_agg_lock);
+		dlginfo_agg_lock = NULL;
+	}
+}
+
+/* hash over the stored bodies - changes whenever one dialog state changes */
+static unsigned int dlginfo_agg_vhash(str **body_array, int n)
+{
+	unsigned int vhash;
+	int i;
+
+	vhash = (unsigned int)n;
+	for(i = 0; i < n; i++) {
+		if(body_array[i] == NULL)
+			continue;
+		vhash = (vhash << 5) + vhash
+				+ get_hash1_raw(body_array[i]->s, body_array[i]->len);
+	}
+	vhash = (vhash << 5) + vhash + (unsigned int)force_single_dialog;
+	return vhash;
+}
+
+static str *dlginfo_agg_cache_get(
+		str *pres_user, str *pres_domain, unsigned int vhash, int n)
+{
+	dlginfo_agg_entry_t *ae;
+	str *body = NULL;
+	unsigned int idx;
+
+	idx = core_case_hash(pres_user, pres_domain, dlginfo_agg_cache_size);
+	lock_get(dlginfo_agg_lock);
+	ae = dlginfo_agg_table[idx];
+	if(ae == NULL || ae->vhash != vhash || ae->nbodies != n
+			|| ae->user.len != pres_user->len
+			|| ae->domain.len != pres_domain->len
+			|| memcmp(ae->user.s, pres_user->s, pres_user->len) != 0
+			|| memcmp(ae->domain.s, pres_domain->s, pres_domain->len) != 0) {
+		lock_release(dlginfo_agg_lock);
+		return NULL;
+	}
+	body = (str *)pkg_malloc(sizeof(str));
+	if(body == NULL) {
+		lock_release(dlginfo_agg_lock);
+		LM_ERR("no more pkg memory\n");
+		return NULL;
+	}
+	/* the callers free the content with xmlFree() - and the version
+	 * placeholder replacement expects a zero terminated document */
+	body->s = (char *)xmlMalloc(ae->body.len + 1);
+	if(body->s == NULL) {
+		lock_release(dlginfo_agg_lock);
+		pkg_free(body);
+		LM_ERR("no more xml memory\n");
+		return NULL;
+	}
+	memcpy(body->s, ae->body.s, ae->body.len);
+	body->s[ae->body.len] = '\0';
+	body->len = ae->body.len;
+	lock_release(dlginfo_agg_lock);
+	return body;
+}
+
+static void dlginfo_agg_cache_set(
+		str *pres_user, str *pres_domain, unsigned int vhash, int n, str *body)
+{
+	dlginfo_agg_entry_t *ae;
+	unsigned int idx;
+	char *p;
+
+	ae = (dlginfo_agg_entry_t *)shm_malloc(sizeof(dlginfo_agg_entry_t)
+										   + pres_user->len + pres_domain->len
+										   + body->len);
+	if(ae == NULL) {
+		LM_ERR("no more shm memory\n");
+		return;
+	}
+	memset(ae, 0, sizeof(dlginfo_agg_entry_t));
+	p = (char *)ae + sizeof(dlginfo_agg_entry_t);
+	ae->user.s = p;
+	memcpy(ae->user.s, pres_user->s, pres_user->len);
+	ae->user.len = pres_user->len;
+	p += pres_user->len;
+	ae->domain.s = p;
+	memcpy(ae->domain.s, pres_domain->s, pres_domain->len);
+	ae->domain.len = pres_domain->len;
+	p += pres_domain->len;
+	ae->body.s = p;
+	memcpy(ae->body.s, body->s, body->len);
+	ae->body.len = body->len;
+	ae->vhash = vhash;
+	ae->nbodies = n;
+
+	idx = core_case_hash(pres_user, pres_domain, dlginfo_agg_cache_size);
+	lock_get(dlginfo_agg_lock);
+	if(dlginfo_agg_table[idx] != NULL)
+		shm_free(dlginfo_agg_table[idx]);
+	dlginfo_agg_table[idx] = ae;
+	lock_release(dlginfo_agg_lock);
+}
+
 #define DIALOGINFO_EMPTY_BODY \
 	"<dialog-info>\
 	<dialog id=\"615293b33c62dec073e05d9421e9f48b\" direction=\"recipient\">\
@@ -124,6 +287,7 @@ str *dlginfo_agg_nbody(str *pres_user, str *pres_domain, str **body_array,
 		int n, int off_index)
 {
 	str *n_body = NULL;
+	unsigned int vhash = 0;
 
 	LM_DBG("[pres_user]=%.*s [pres_domain]= %.*s, [n]=%d\n", pres_user->len,
 			pres_user->s, pres_domain->len, pres_domain->s, n);
@@ -134,10 +298,23 @@ str *dlginfo_agg_nbody(str *pres_user, str *pres_domain, str **body_array,
 	if(body_array == NULL)
 		return dlginfo_agg_nbody_empty(pres_user, pres_domain);
 
+	if(dlginfo_agg_table != NULL) {
+		vhash = dlginfo_agg_vhash(body_array, n);
+		n_body = dlginfo_agg_cache_get(pres_user, pres_domain, vhash, n);
+		if(n_body != NULL) {
+			LM_DBG("aggregated body for %.*s@%.*s served from cache\n",
+					pres_user->len, pres_user->s, pres_domain->len,
+					pres_domain->s);
+			return n_body;
+		}
+	}
+
 	n_body = aggregate_xmls(pres_user, pres_domain, body_array, n);
 	LM_DBG("[n_body]=%p\n", n_body);
 	if(n_body) {
 		LM_DBG("[*n_body]=%.*s\n", n_body->len, n_body->s);
+		if(dlginfo_agg_table != NULL)
+			dlginfo_agg_cache_set(pres_user, pres_domain, vhash, n, n_body);
 	}
 	if(n_body == NULL && n != 0) {
 		LM_ERR("while aggregating body\n");
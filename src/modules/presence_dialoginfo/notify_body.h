@@ -40,4 +40,8 @@ str *dlginfo_body_setversion(subs_t *subs, str *body);
 void free_xml_body(char *body);
 int get_dialog_state_priority(char *state);
 
+extern int dlginfo_agg_cache_size;
+int dlginfo_agg_cache_init(void);
+void dlginfo_agg_cache_destroy(void);
+
 #endif
@@ -38,12 +38,14 @@
 #include "../../core/mem/mem.h"
 #include "../presence/bind_presence.h"
 #include "add_events.h"
+#include "notify_body.h"
 #include "presence_dialoginfo.h"
 
 MODULE_VERSION
 
 /* module functions */
 static int mod_init(void);
+static void mod_destroy(void);
 
 /* module variables */
 add_event_t pres_add_event;
@@ -64,6 +66,7 @@ static param_export_t params[] = {
 	{"force_single_dialog", PARAM_INT, &force_single_dialog},
 	{"force_dummy_dialog", PARAM_INT, &force_dummy_dialog},
 	{"default_expires", PARAM_INT, &pres_dlginfo_default_expires},
+	{"agg_body_cache_size", PARAM_INT, &dlginfo_agg_cache_size},
 	{0, 0, 0}
 };
 
@@ -78,7 +81,7 @@ struct module_exports exports = {
 	0,                  /* response handling function */
 	mod_init,           /* module initialization function */
 	0,                  /* per-child init function */
-	0                   /* module destroy function */
+	mod_destroy         /* module destroy function */
 };
 /* clang-format on */
 
@@ -110,5 +113,18 @@ static int mod_init(void)
 		return -1;
 	}
 
+	if(dlginfo_agg_cache_size < 0) {
+		dlginfo_agg_cache_size = 0;
+	}
+	if(dlginfo_agg_cache_size > 0 && dlginfo_agg_cache_init() < 0) {
+		LM_ERR("failed to initialize aggregated body cache\n");
+		return -1;
+	}
+
 	return 0;
 }
+
+static void mod_destroy(void)
+{
+	dlginfo_agg_cache_destroy();
+}
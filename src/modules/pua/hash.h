@@ -80,6 +80,7 @@ typedef struct ua_pres
 	int event;
 	unsigned int expires;
 	unsigned int desired_expires;
+	unsigned int refresh_ts; /* time of the last refresh sent by the timer */
 	int flag;
 	int db_flag;
 	void *cb_param;
@@ -38,6 +38,7 @@
 #include "../../core/str.h"
 #include "../../core/mem/mem.h"
 #include "../../core/pt.h"
+#include "../../core/hashes.h"
 #include "../../core/kemi.h"
 #include "../../core/rpc.h"
 #include "../../core/rpc_lookup.h"
@@ -64,6 +65,7 @@ int pua_default_expires = 3600;
 static str db_url = str_init(DEFAULT_DB_URL);
 str db_table = str_init("pua");
 int update_period = 100;
+int pua_update_spread = 0;
 str outbound_proxy = {0, 0};
 int check_remote_contact = 1;
 int startup_time = 0;
@@ -129,6 +131,7 @@ static param_export_t params[] = {
 	{"min_expires", PARAM_INT, &min_expires},
 	{"default_expires", PARAM_INT, &pua_default_expires},
 	{"update_period", PARAM_INT, &update_period},
+	{"update_spread", PARAM_INT, &pua_update_spread},
 	{"outbound_proxy", PARAM_STR, &outbound_proxy},
 	{"dlginfo_increase_version", PARAM_INT, &dlginfo_increase_version},
 	{"reginfo_increase_version", PARAM_INT, &reginfo_increase_version},
@@ -251,9 +254,18 @@ static int mod_init(void)
 
 	startup_time = (int)time(NULL);
 
-	if(update_period > 5)
-		register_timer(hashT_clean, 0, update_period - 5);
-	else if(update_period != 0) {
+	if(pua_update_spread < 0)
+		pua_update_spread = 0;
+
+	if(update_period > 5) {
+		if(pua_update_spread > 0) {
+			/* check often - each record refreshes at its own offset
+			 * within the spread window instead of all in one run */
+			register_timer(hashT_clean, 0, 5);
+		} else {
+			register_timer(hashT_clean, 0, update_period - 5);
+		}
+	} else if(update_period != 0) {
 		LM_ERR("update_period must be 0 or > 5\n");
 		return -1;
 	}
@@ -614,6 +626,7 @@ static void hashT_clean(unsigned int ticks, void *param)
 {
 	int i;
 	time_t now;
+	unsigned int lead;
 	ua_pres_t *p = NULL, *q = NULL;
 
 	if(dbmode == PUA_DB_ONLY) {
@@ -627,9 +640,24 @@ static void hashT_clean(unsigned int ticks, void *param)
 		p = HashT->p_records[i].entity->next;
 		while(p) {
 			print_ua_pres(p);
-			if(p->expires - update_period < now) {
+			lead = update_period;
+			if(pua_update_spread > 0) {
+				/* deterministic per record offset, so records expiring
+				 * together refresh spread over the window instead of in
+				 * one burst on the timer boundary */
+				lead += core_case_hash(p->pres_uri, &p->id, 0)
+						% pua_update_spread;
+			}
+			if(p->expires - lead < now) {
 				if((p->desired_expires > p->expires + min_expires)
 						|| (p->desired_expires == 0)) {
+					if(pua_update_spread > 0 && p->refresh_ts != 0
+							&& now < (time_t)(p->refresh_ts + update_period)) {
+						/* refresh sent recently - wait for its reply */
+						p = p->next;
+						continue;
+					}
+					p->refresh_ts = (unsigned int)now;
 					if(update_pua(p) < 0) {
 						LM_ERR("while updating record\n");
 						lock_release(&HashT->p_records[i].lock);
@@ -65,6 +65,7 @@ int pvh_collect_headers(struct sip_msg *msg)
 	int idx = 0, d_size = 0;
 	str val_part = STR_NULL;
 	char *marker = NULL;
+	sr_xavp_t *tail = NULL;
 
 	if(pvh_hdrs_collected(msg)) {
 		LM_ERR("headers are already collected\n");
@@ -111,15 +112,14 @@ int pvh_collect_headers(struct sip_msg *msg)
 			for(idx = 0; idx < d_size; idx++) {
 				val_part.s = hvals[idx];
 				val_part.len = strlen(hvals[idx]);
-				if(pvh_set_xavi(msg, &_pvh_params.xavi_name, &name, &val_part,
-						   SR_XTYPE_STR, 0, 1)
+				if(pvh_set_xavi_tail(msg, &_pvh_params.xavi_name, &name,
+						   &val_part, &tail)
 						== NULL)
 					return -1;
 			}
 			continue;
 		}
-		if(pvh_set_xavi(
-				   msg, &_pvh_params.xavi_name, &name, &val, SR_XTYPE_STR, 0, 1)
+		if(pvh_set_xavi_tail(msg, &_pvh_params.xavi_name, &name, &val, &tail)
 				== NULL)
 			return -1;
 	}
@@ -138,6 +138,9 @@ int pvh_apply_headers(struct sip_msg *msg)
 {
 	sr_xavp_t *xavi = NULL;
 	sr_xavp_t *sub = NULL;
+	sr_xavp_t *grp = NULL;
+	str block = STR_NULL;
+	int blen = 0;
 	struct str_hash_table rm_hdrs;
 	int from_cnt = 0, to_cnt = 0;
 	char t[pvh_hdr_name_size];
@@ -282,16 +285,43 @@ int pvh_apply_headers(struct sip_msg *msg)
 			continue;
 		}
 
-		if(!str_hash_case_get(&rm_hdrs, sub->name.s, sub->name.len)) {
-			LM_DBG("remove header[%s]: %s\n", sub->name.s, sub->val.v.s.s);
-			pvh_real_hdr_del_by_name(msg, &sub->name);
-			pvh_str_hash_add_key(&rm_hdrs, &sub->name);
-		}
+		if(str_hash_case_get(&rm_hdrs, sub->name.s, sub->name.len))
+			continue;
 
-		if(!pvh_avp_is_null(sub) && !pvh_single_header(&sub->name)) {
-			pvh_real_hdr_append(msg, &sub->name, &sub->val.v.s);
-			LM_DBG("append header[%s]: %s\n", sub->name.s, sub->val.v.s.s);
+		/* gather all the values of this header and apply them with one
+		 * consolidated lump, removing the existing ones in the same pass */
+		blen = 0;
+		if(!pvh_single_header(&sub->name)) {
+			for(grp = sub; grp != NULL; grp = grp->next) {
+				if(cmpi_str(&grp->name, &sub->name) != 0
+						|| pvh_avp_is_null(grp))
+					continue;
+				blen += sub->name.len + 2 + grp->val.v.s.len + CRLF_LEN;
+			}
+		}
+		block.len = 0;
+		if(blen > 0) {
+			if(pvh_str_new(&block, blen + 1) < 0)
+				goto err;
+			for(grp = sub; grp != NULL; grp = grp->next) {
+				if(cmpi_str(&grp->name, &sub->name) != 0
+						|| pvh_avp_is_null(grp))
+					continue;
+				LM_DBG("append header[%s]: %s\n", grp->name.s, grp->val.v.s.s);
+				memcpy(block.s + block.len, sub->name.s, sub->name.len);
+				block.len += sub->name.len;
+				memcpy(block.s + block.len, ": ", 2);
+				block.len += 2;
+				memcpy(block.s + block.len, grp->val.v.s.s, grp->val.v.s.len);
+				block.len += grp->val.v.s.len;
+				memcpy(block.s + block.len, CRLF, CRLF_LEN);
+				block.len += CRLF_LEN;
+			}
 		}
+		pvh_real_hdr_replace_block(msg, &sub->name, &block);
+		if(block.s != NULL)
+			pvh_str_free(&block);
+		pvh_str_hash_add_key(&rm_hdrs, &sub->name);
 	} while((sub = sub->next) != NULL);
 
 	pvh_hdrs_set_applied(msg);
@@ -133,6 +133,54 @@ int pvh_real_hdr_append(struct sip_msg *msg, str *hname, str *hvalue)
 	return 1;
 }
 
+int pvh_real_hdr_replace_block(struct sip_msg *msg, str *hname, str *block)
+{
+	struct lump *anchor = NULL;
+	hdr_field_t *hf = NULL;
+	hdr_field_t *m_hf = NULL;
+	char *buf = NULL;
+
+	for(hf = msg->headers; hf; hf = hf->next) {
+		if(hf->name.len == hname->len
+				&& strncasecmp(hf->name.s, hname->s, hname->len) == 0) {
+			LM_DBG("remove header[%.*s]: %.*s\n", hf->name.len, hf->name.s,
+					hf->body.len, hf->body.s);
+			del_lump(msg, hf->name.s - msg->buf, hf->len, 0);
+			m_hf = hf;
+		}
+	}
+
+	if(block == NULL || block->len == 0 || block->s == NULL)
+		return 1;
+
+	if(m_hf == NULL)
+		anchor = anchor_lump(msg, msg->unparsed - msg->buf, 0, 0);
+	else
+		anchor = anchor_lump(msg, m_hf->name.s + m_hf->len - msg->buf, 0, 0);
+
+	if(anchor == 0) {
+		LM_ERR("unable to find header lump\n");
+		return -1;
+	}
+
+	buf = (char *)pkg_malloc(block->len);
+	if(buf == NULL) {
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	memcpy(buf, block->s, block->len);
+
+	if(insert_new_lump_after(anchor, buf, block->len, 0) == 0) {
+		LM_ERR("cannot insert header lump\n");
+		pkg_free(buf);
+		return -1;
+	}
+
+	LM_DBG("replace headers: %.*s\n", block->len, block->s);
+
+	return 1;
+}
+
 int pvh_real_hdr_del_by_name(struct sip_msg *msg, str *hname)
 {
 	hdr_field_t *hf = NULL;
@@ -434,6 +434,37 @@ sr_xavp_t *pvh_set_xavi(struct sip_msg *msg, str *xname, str *name, void *data,
 }
 
 
+/**
+ * append a header value reusing the tail of the xavi list - the collect
+ * phase appends one value per header and the regular path walks the full
+ * list for every one of them
+ */
+sr_xavp_t *pvh_set_xavi_tail(
+		struct sip_msg *msg, str *xname, str *name, str *val, sr_xavp_t **tail)
+{
+	sr_xavp_t *xavi = NULL;
+	sr_xval_t xval;
+
+	if(*tail == NULL || (*tail)->next != NULL) {
+		/* first value or the tail moved - take the regular path */
+		xavi = pvh_set_xavi(msg, xname, name, val, SR_XTYPE_STR, 0, 1);
+	} else {
+		memset(&xval, 0, sizeof(sr_xval_t));
+		xval.type = SR_XTYPE_STR;
+		xval.v.s = *val;
+		if((xavi = pvh_xavi_new_value(name, &xval)) == NULL) {
+			LM_ERR("error append xavi=>name %.*s=>%.*s\n", xname->len, xname->s,
+					name->len, name->s);
+			return NULL;
+		}
+		(*tail)->next = xavi;
+	}
+	if(xavi != NULL)
+		*tail = xavi;
+
+	return xavi;
+}
+
 /**
  *
  */
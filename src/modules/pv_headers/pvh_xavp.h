@@ -37,6 +37,8 @@ int pvh_reply_append(sr_xavp_t **start);
 
 sr_xavp_t *pvh_set_xavi(struct sip_msg *msg, str *xname, str *name, void *data,
 		sr_xtype_t type, int idx, int append);
+sr_xavp_t *pvh_set_xavi_tail(
+		struct sip_msg *msg, str *xname, str *name, str *val, sr_xavp_t **tail);
 int pvh_xavi_keys_count(sr_xavp_t **start);
 sr_xavp_t *pvh_xavi_get_child(struct sip_msg *msg, str *xname, str *name);
 int pvh_avp_is_null(sr_xavp_t *avp);
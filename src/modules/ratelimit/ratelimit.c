@@ -43,6 +43,8 @@
 #include "../../core/data_lump.h"
 #include "../../core/data_lump_rpl.h"
 #include "../../core/counters.h"
+#include "../../core/hashes.h"
+#include "../../core/atomic_ops.h"
 #include "../../core/rpc_lookup.h"
 #include "../../core/kemi.h"
 #include "rl_statistics.h"
@@ -50,9 +52,12 @@
 
 MODULE_VERSION
 
-#define MAX_PIPES 32
+#define MAX_PIPES 256
 #define MAX_QUEUES 32
 
+/* maximum number of one second slots of the sliding window */
+#define RL_SW_SLOTS 32
+
 /*
  * timer interval length in seconds, tunable via modparam
  */
@@ -82,7 +87,8 @@ enum
 	PIPE_ALGO_RED,
 	PIPE_ALGO_TAILDROP,
 	PIPE_ALGO_FEEDBACK,
-	PIPE_ALGO_NETWORK
+	PIPE_ALGO_NETWORK,
+	PIPE_ALGO_SLIDINGWINDOW
 };
 
 str_map_t algo_names[] = {
@@ -91,6 +97,7 @@ str_map_t algo_names[] = {
 		{str_init("TAILDROP"), PIPE_ALGO_TAILDROP},
 		{str_init("FEEDBACK"), PIPE_ALGO_FEEDBACK},
 		{str_init("NETWORK"), PIPE_ALGO_NETWORK},
+		{str_init("SWINDOW"), PIPE_ALGO_SLIDINGWINDOW},
 		{{0, 0}, 0},
 };
 
@@ -126,6 +133,11 @@ typedef struct pipe
 	int *counter;
 	int *last_counter;
 	int *load;
+
+	/* one second slots of the sliding window, counted with atomic
+	 * operations only - sw_stamp holds the second each slot belongs to */
+	atomic_t *sw_count;
+	atomic_t *sw_stamp;
 } pipe_t;
 
 typedef struct rl_queue
@@ -175,6 +187,12 @@ static str *rl_dbg_str = NULL;
 /* these only change in the mod_init() process -- no locking needed */
 static int timer_interval = RL_TIMER_INTERVAL;
 static int cfg_setpoint; /* desired load, used when reading modparams */
+/* number of active sliding window slots - min(timer_interval, RL_SW_SLOTS) */
+static int rl_sw_nslots = 1;
+/* destination pipe group - count pipes starting at base, instantiated
+ * from the definition of the base pipe */
+static int dst_pipe_base = -1;
+static int dst_pipe_count = 0;
 /* === */
 
 #ifndef RL_DEBUG_LOCKS
@@ -206,6 +224,7 @@ static ticks_t rl_timer_handle(ticks_t, struct timer_ln *, void *);
 static int w_rl_check_default(struct sip_msg *, char *, char *);
 static int w_rl_check_forced(struct sip_msg *, char *, char *);
 static int w_rl_check_forced_pipe(struct sip_msg *, char *, char *);
+static int w_rl_check_dest(struct sip_msg *, char *, char *);
 static int add_queue_params(modparam_t, void *);
 static int add_pipe_params(modparam_t, void *);
 static int ki_rl_check(struct sip_msg *msg);
@@ -221,6 +240,8 @@ static cmd_export_t cmds[] = {
 		fixup_igp_null,	fixup_free_pvar_null, REQUEST_ROUTE | LOCAL_ROUTE},
 	{"rl_check_pipe", (cmd_function)w_rl_check_forced_pipe, 1,
 		fixup_igp_null, fixup_free_igp_null, ANY_ROUTE},
+	{"rl_check_dest", (cmd_function)w_rl_check_dest, 1,
+		fixup_spve_null, fixup_free_spve_null, ANY_ROUTE},
 	{0, 0, 0, 0, 0, 0}
 };
 
@@ -228,6 +249,8 @@ static param_export_t params[] = {
 	{"timer_interval", PARAM_INT, &timer_interval},
 	{"queue", PARAM_STRING | PARAM_USE_FUNC, (void *)add_queue_params},
 	{"pipe", PARAM_STRING | PARAM_USE_FUNC, (void *)add_pipe_params},
+	{"dst_pipe_base", PARAM_INT, &dst_pipe_base},
+	{"dst_pipe_count", PARAM_INT, &dst_pipe_count},
 	/* RESERVED for future use
 	{"load_source",    PARAM_STRING|PARAM_USE_FUNC, (void *)set_load_source},
 	*/
@@ -537,6 +560,29 @@ static int mod_init(void)
 	rl_dbg_str->s = NULL;
 	rl_dbg_str->len = 0;
 
+	rl_sw_nslots =
+			(timer_interval < RL_SW_SLOTS) ? timer_interval : RL_SW_SLOTS;
+	if(rl_sw_nslots <= 0)
+		rl_sw_nslots = 1;
+
+	if(dst_pipe_base >= 0) {
+		if(dst_pipe_base >= MAX_PIPES || dst_pipe_count <= 0
+				|| dst_pipe_base + dst_pipe_count > MAX_PIPES) {
+			LM_ERR("invalid destination pipe group %d:%d (MAX_PIPES=%d)\n",
+					dst_pipe_base, dst_pipe_count, MAX_PIPES);
+			return -1;
+		}
+		if(pipes[dst_pipe_base].algo_mp == PIPE_ALGO_NOP) {
+			LM_ERR("destination template pipe %d not defined\n", dst_pipe_base);
+			return -1;
+		}
+		/* instantiate the rest of the group from the template pipe */
+		for(i = dst_pipe_base + 1; i < dst_pipe_base + dst_pipe_count; i++) {
+			pipes[i].algo_mp = pipes[dst_pipe_base].algo_mp;
+			pipes[i].limit_mp = pipes[dst_pipe_base].limit_mp;
+		}
+	}
+
 	for(i = 0; i < MAX_PIPES; i++) {
 		pipes[i].algo = shm_malloc(sizeof(int));
 		if(pipes[i].algo == NULL) {
@@ -563,6 +609,14 @@ static int mod_init(void)
 			LM_ERR("oom for pipes[%d].last_counter\n", i);
 			return -1;
 		}
+		pipes[i].sw_count =
+				(atomic_t *)shm_malloc(2 * RL_SW_SLOTS * sizeof(atomic_t));
+		if(pipes[i].sw_count == NULL) {
+			LM_ERR("oom for pipes[%d].sw_count\n", i);
+			return -1;
+		}
+		memset(pipes[i].sw_count, 0, 2 * RL_SW_SLOTS * sizeof(atomic_t));
+		pipes[i].sw_stamp = pipes[i].sw_count + RL_SW_SLOTS;
 		*pipes[i].algo = pipes[i].algo_mp;
 		*pipes[i].limit = pipes[i].limit_mp;
 		*pipes[i].load = 0;
@@ -628,6 +682,11 @@ static void destroy(void)
 			shm_free(pipes[i].limit);
 			pipes[i].limit = NULL;
 		}
+		if(pipes[i].sw_count) {
+			shm_free(pipes[i].sw_count);
+			pipes[i].sw_count = NULL;
+			pipes[i].sw_stamp = NULL;
+		}
 	}
 
 	if(nqueues) {
@@ -744,6 +803,48 @@ int hash[100] = {18, 50, 51, 39, 49, 68, 8, 78, 61, 75, 53, 32, 45, 77, 31, 12,
 		71, 23, 2, 67, 36, 65, 27, 1, 19, 59, 89, 48};
 
 
+/**
+ * sum of the sliding window slots that are still inside the window
+ */
+static int rl_sw_sum(int id, unsigned int now)
+{
+	int i;
+	int sum;
+
+	sum = 0;
+	for(i = 0; i < rl_sw_nslots; i++) {
+		if(now - (unsigned int)atomic_get(&pipes[id].sw_stamp[i])
+				< (unsigned int)rl_sw_nslots)
+			sum += atomic_get(&pipes[id].sw_count[i]);
+	}
+	return sum;
+}
+
+/**
+ * counts the hit in the current one second slot and checks the load of
+ * the sliding window - uses only atomic operations, so it can run
+ * without taking rl_lock
+ * \return	-1 if drop needed, 1 if allowed
+ */
+static int rl_sw_push(int id)
+{
+	unsigned int now;
+	int idx;
+
+	now = get_ticks();
+	idx = now % rl_sw_nslots;
+	/* the slot comes back around after a full rotation - reset it on the
+	 * first hit of its new second; concurrent resets can lose a few
+	 * hits, which is acceptable for the approximate window */
+	if((unsigned int)atomic_get(&pipes[id].sw_stamp[idx]) != now) {
+		atomic_set(&pipes[id].sw_stamp[idx], (int)now);
+		atomic_set(&pipes[id].sw_count[idx], 0);
+	}
+	atomic_inc(&pipes[id].sw_count[idx]);
+
+	return (rl_sw_sum(id, now) <= *pipes[id].limit * rl_sw_nslots) ? 1 : -1;
+}
+
 /**
  * runs the pipe's algorithm
  * (expects rl_lock to be taken), TODO revert to "return" instead of "ret ="
@@ -777,6 +878,9 @@ static int pipe_push(struct sip_msg *msg, int id)
 		case PIPE_ALGO_NETWORK:
 			ret = -1 * *pipes[id].load;
 			break;
+		case PIPE_ALGO_SLIDINGWINDOW:
+			ret = rl_sw_push(id);
+			break;
 		default:
 			LM_ERR("unknown ratelimit algorithm: %d\n", *pipes[id].algo);
 			ret = 1;
@@ -814,6 +918,16 @@ static int rl_check(struct sip_msg *msg, int forced_pipe)
 		return -1;
 	}
 
+	if(forced_pipe >= 0
+			&& *pipes[forced_pipe].algo == PIPE_ALGO_SLIDINGWINDOW) {
+		/* the sliding window counts with atomic operations only - no
+		 * need to serialize the workers on the global lock */
+		que_id = 0;
+		pipe_id = forced_pipe;
+		ret = rl_sw_push(pipe_id);
+		goto out_dbg;
+	}
+
 	LOCK_GET(rl_lock);
 	if(forced_pipe < 0) {
 		if(find_queue(msg, &method, &que_id)) {
@@ -831,6 +945,7 @@ static int rl_check(struct sip_msg *msg, int forced_pipe)
 out_release:
 	LOCK_RELEASE(rl_lock);
 
+out_dbg:
 	/* no locks here because it's only read and pipes[pipe_id] is always alloc'ed */
 	LM_DBG("meth=%.*s queue=%d pipe=%d algo=%d limit=%d pkg_load=%d counter=%d "
 		   "load=%2.1lf network_load=%d => %s\n",
@@ -872,6 +987,43 @@ static int w_rl_check_default(struct sip_msg *msg, char *p1, char *p2)
 	return rl_check(msg, -1);
 }
 
+/**
+ * maps the destination onto one pipe of the destination group and runs
+ * its algorithm - the group shares one template definition, so the
+ * per-destination pipes do not have to be provisioned one by one
+ */
+static int ki_rl_check_dest(struct sip_msg *msg, str *dest)
+{
+	int pipe;
+
+	if(dst_pipe_base < 0 || dst_pipe_count <= 0) {
+		LM_ERR("destination pipe group not configured\n");
+		return -1;
+	}
+	if(dest == NULL || dest->s == NULL || dest->len <= 0) {
+		LM_ERR("invalid destination parameter\n");
+		return -1;
+	}
+
+	pipe = dst_pipe_base
+		   + (int)(core_case_hash(dest, 0, 0) % (unsigned int)dst_pipe_count);
+	LM_DBG("destination [%.*s] mapped to pipe %d\n", dest->len, dest->s, pipe);
+
+	return rl_check(msg, pipe);
+}
+
+static int w_rl_check_dest(struct sip_msg *msg, char *p1, char *p2)
+{
+	str dest = STR_NULL;
+
+	if(fixup_get_svalue(msg, (gparam_t *)p1, &dest) != 0) {
+		LM_ERR("failed to get destination parameter\n");
+		return -1;
+	}
+
+	return ki_rl_check_dest(msg, &dest);
+}
+
 /* RESERVED for future use
 static int set_load_source(modparam_t type, void * val)
 {
@@ -1085,6 +1237,13 @@ static ticks_t rl_timer_handle(ticks_t ticks, struct timer_ln *tl, void *data)
 	}
 
 	for(i = 0; i < MAX_PIPES; i++) {
+		if(*pipes[i].algo == PIPE_ALGO_SLIDINGWINDOW) {
+			/* report the current window load - the slots are reset by
+			 * rotation, not by the timer */
+			*pipes[i].last_counter = rl_sw_sum(i, get_ticks());
+			*pipes[i].counter = 0;
+			continue;
+		}
 		if(*pipes[i].algo == PIPE_ALGO_NETWORK) {
 			*pipes[i].load = (*network_load_value > *pipes[i].limit) ? 1 : -1;
 		} else if(*pipes[i].limit && timer_interval) {
@@ -1364,6 +1523,11 @@ static sr_kemi_t sr_kemi_ratelimit_exports[] = {
 			{ SR_KEMIP_INT, SR_KEMIP_NONE, SR_KEMIP_NONE,
 				SR_KEMIP_NONE, SR_KEMIP_NONE, SR_KEMIP_NONE }
 	},
+	{ str_init("ratelimit"), str_init("rl_check_dest"),
+		SR_KEMIP_INT, ki_rl_check_dest,
+			{ SR_KEMIP_STR, SR_KEMIP_NONE, SR_KEMIP_NONE,
+				SR_KEMIP_NONE, SR_KEMIP_NONE, SR_KEMIP_NONE }
+	},
 
 	{ {0, 0}, {0, 0}, 0, NULL, {0, 0, 0, 0, 0, 0} }
 };
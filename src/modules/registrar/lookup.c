@@ -271,6 +271,7 @@ int lookup_helper(struct sip_msg *_m, udomain_t *_d, str *_uri, int _mode)
 	sip_uri_t path_uri;
 	str path_str;
 	branch_t *nbranch;
+	int use_expired;
 
 	ret = -1;
 
@@ -320,6 +321,9 @@ int lookup_helper(struct sip_msg *_m, udomain_t *_d, str *_uri, int _mode)
 
 	get_act_time();
 	reg_lookup_filter_init();
+	/* cfg value is stable for the duration of the call - read it once
+	 * instead of per contact while the slot lock is held */
+	use_expired = cfg_get(registrar, registrar_cfg, use_expired_contacts);
 
 	if(puri.gr.s == NULL || puri.gr_val.len > 0) {
 		/* aor or pub-gruu lookup */
@@ -335,9 +339,7 @@ int lookup_helper(struct sip_msg *_m, udomain_t *_d, str *_uri, int _mode)
 		ret = -1;
 		/* look first for an un-expired and supported contact */
 		while(ptr) {
-			if(VALID_CONTACT(ptr, act_time)
-					|| cfg_get(
-							registrar, registrar_cfg, use_expired_contacts)) {
+			if(VALID_CONTACT(ptr, act_time) || use_expired) {
 				if(allowed_method(_m, ptr)) {
 					/* match on instance, if pub-gruu */
 					if(inst.len > 0) {
@@ -381,9 +383,7 @@ int lookup_helper(struct sip_msg *_m, udomain_t *_d, str *_uri, int _mode)
 		aor = *ptr->aor;
 		/* test if not expired and contact with supported method */
 		if(ptr) {
-			if(!(VALID_CONTACT(ptr, act_time)
-					   || cfg_get(registrar, registrar_cfg,
-							   use_expired_contacts))) {
+			if(!(VALID_CONTACT(ptr, act_time) || use_expired)) {
 				goto done;
 			} else if(!allowed_method(_m, ptr)) {
 				ret = -2;
@@ -524,8 +524,7 @@ int lookup_helper(struct sip_msg *_m, udomain_t *_d, str *_uri, int _mode)
 		goto done;
 
 	for(; ptr; ptr = ptr->next) {
-		if((VALID_CONTACT(ptr, act_time)
-				   || cfg_get(registrar, registrar_cfg, use_expired_contacts))
+		if((VALID_CONTACT(ptr, act_time) || use_expired)
 				&& allowed_method(_m, ptr) && reg_lookup_filter_match(ptr)) {
 			path_dst.len = 0;
 			if(ptr->path.s && ptr->path.len) {
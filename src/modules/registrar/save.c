@@ -626,6 +626,16 @@ static int test_max_contacts(struct sip_msg *_m, urecord_t *_r, contact_t *_c,
 	int e;
 	ucontact_t *ptr, *cont;
 	int ret;
+	contact_t *c0;
+
+	/* fast path - even if every message contact were new and every stored
+	 * contact still valid, the limit cannot be exceeded; the precise walk
+	 * below is only needed when the sum gets close to it */
+	num = _r->cn;
+	for(c0 = _c; c0; c0 = get_next_contact(c0))
+		num++;
+	if(num <= mc)
+		return 0;
 
 	num = 0;
 	ptr = _r->contacts;
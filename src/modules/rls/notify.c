@@ -53,6 +53,13 @@
 static str *multipart_body = NULL;
 static int multipart_body_size = 0;
 
+/* index of the member state rows sorted by resource uri - lets
+ * add_resource_instance() locate the rows of one member via binary
+ * search instead of scanning the whole result for every resource
+ * in the list */
+static int *rlpres_row_index = NULL;
+static db1_res_t *rlpres_row_index_res = NULL;
+
 typedef struct res_param
 {
 	struct uri_link **next;
@@ -82,6 +89,8 @@ int rls_get_resource_list(str *rl_uri, str *username, str *domain,
 int add_resource_to_list(char *uri, void *param);
 int add_resource(char *uri, xmlNodePtr list_node, char *boundary_string,
 		db1_res_t *result, int *len_est);
+static void rlpres_row_index_build(db1_res_t *result);
+static void rlpres_row_index_free(void);
 
 char *instance_id = "Scf8UhwQ";
 
@@ -168,6 +177,8 @@ int send_full_notify(
 		}
 	}
 
+	rlpres_row_index_build(result);
+
 	/* Allocate an initial buffer for the multipart body.
 	 * This buffer will be reallocated if necessary */
 	multipart_body = (str *)pkg_malloc(sizeof(str));
@@ -276,6 +287,7 @@ int send_full_notify(
 	}
 	multipart_body_size = 0;
 	pkg_free(rlsubs_did.s);
+	rlpres_row_index_free();
 	rlpres_dbf.free_result(rlpres_db, result);
 
 	return 0;
@@ -292,6 +304,7 @@ error:
 	}
 	multipart_body_size = 0;
 
+	rlpres_row_index_free();
 	if(result)
 		rlpres_dbf.free_result(rlpres_db, result);
 	if(rlsubs_did.s)
@@ -379,6 +392,44 @@ error:
 }
 
 
+static int rlpres_row_index_cmp(const void *pa, const void *pb)
+{
+	db_row_t *rows = rlpres_row_index_res->rows;
+
+	return strcmp(
+			ROW_VALUES(&rows[*(const int *)pa])[resource_uri_col].val.string_val,
+			ROW_VALUES(&rows[*(const int *)pb])[resource_uri_col]
+					.val.string_val);
+}
+
+static void rlpres_row_index_build(db1_res_t *result)
+{
+	int i;
+
+	rlpres_row_index = NULL;
+	if(result->n <= 0)
+		return;
+
+	rlpres_row_index = (int *)pkg_malloc(result->n * sizeof(int));
+	if(rlpres_row_index == NULL) {
+		/* not fatal - add_resource_instance() falls back to a full scan */
+		LM_WARN("no more pkg memory for the row index\n");
+		return;
+	}
+	for(i = 0; i < result->n; i++)
+		rlpres_row_index[i] = i;
+	rlpres_row_index_res = result;
+	qsort(rlpres_row_index, result->n, sizeof(int), rlpres_row_index_cmp);
+}
+
+static void rlpres_row_index_free(void)
+{
+	if(rlpres_row_index != NULL)
+		pkg_free(rlpres_row_index);
+	rlpres_row_index = NULL;
+	rlpres_row_index_res = NULL;
+}
+
 int add_resource_instance(char *uri, xmlNodePtr resource_node,
 		db1_res_t *result, char *boundary_string, int *len_est)
 {
@@ -386,6 +437,8 @@ int add_resource_instance(char *uri, xmlNodePtr resource_node,
 	db_row_t *row;
 	db_val_t *row_vals;
 	int i, cmp_code;
+	int istart = 0;
+	int uri_len = strlen(uri);
 	char *auth_state = NULL;
 	int auth_state_flag;
 	int boundary_len = strlen(boundary_string);
@@ -393,12 +446,28 @@ int add_resource_instance(char *uri, xmlNodePtr resource_node,
 	str content_type = {0, 0};
 	str body = {0, 0};
 
-	for(i = 0; i < result->n; i++) {
-		row = &result->rows[i];
+	if(rlpres_row_index != NULL) {
+		/* binary search for the first row of this resource */
+		int lo = 0, hi = result->n, mid;
+		while(lo < hi) {
+			mid = lo + (hi - lo) / 2;
+			row_vals = ROW_VALUES(&result->rows[rlpres_row_index[mid]]);
+			if(strncmp(row_vals[resource_uri_col].val.string_val, uri, uri_len)
+					< 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		istart = lo;
+	}
+
+	for(i = istart; i < result->n; i++) {
+		row = &result->rows[(rlpres_row_index != NULL) ? rlpres_row_index[i]
+													   : i];
 		row_vals = ROW_VALUES(row);
 
 		cmp_code = strncmp(
-				row_vals[resource_uri_col].val.string_val, uri, strlen(uri));
+				row_vals[resource_uri_col].val.string_val, uri, uri_len);
 		if(cmp_code > 0)
 			break;
 
@@ -42,6 +42,9 @@
 #include "../../core/parser/parse_param.h"
 #include "../../core/fmsg.h"
 #include "../../core/kemi.h"
+#include "../../core/counters.h"
+
+#include <sys/time.h>
 
 
 MODULE_VERSION
@@ -64,10 +67,21 @@ typedef struct _stm_timer
 	unsigned int flags;
 	unsigned int interval;
 	stm_route_t *rt;
+	counter_handle_t cnt_executed; /**< number of finished iterations */
+	counter_handle_t cnt_exec_time; /**< total execution time (usecs) */
+	counter_handle_t cnt_overruns; /**< iterations longer than the interval */
 	struct _stm_timer *next;
 } stm_timer_t;
 
+/** per-worker parameter for the sync timer callbacks */
+typedef struct _stm_worker
+{
+	stm_timer_t *timer;
+	int worker;
+} stm_worker_t;
+
 #define RTIMER_INTERVAL_USEC (1 << 0)
+#define RTIMER_SYNC_MODE (1 << 1)
 
 stm_timer_t *_stm_list = NULL;
 
@@ -79,6 +93,7 @@ int stm_t_param(modparam_t type, void *val);
 int stm_e_param(modparam_t type, void *val);
 void stm_timer_exec(unsigned int ticks, int worker, void *param);
 void stm_main_timer_exec(unsigned int ticks, void *param);
+void stm_sync_timer_exec(unsigned int ticks, void *param);
 int stm_get_worker(struct sip_msg *msg, pv_param_t *param, pv_value_t *res);
 
 static int default_interval = 120;
@@ -117,6 +132,8 @@ struct module_exports exports = {
 static int mod_init(void)
 {
 	stm_timer_t *it;
+	char cname[RTIMER_ROUTE_NAME_SIZE + 16];
+
 	if(_stm_list == NULL)
 		return 0;
 
@@ -126,6 +143,36 @@ static int mod_init(void)
 		return -1;
 	}
 
+	/* register the execution counters */
+	it = _stm_list;
+	while(it) {
+		snprintf(cname, sizeof(cname), "%.*s_executed", it->name.len,
+				it->name.s);
+		if(counter_register(&it->cnt_executed, "rtimer", cname, 0, 0, 0,
+				   "number of executed timer iterations", 0)
+				< 0) {
+			LM_ERR("failed to register counter rtimer.%s\n", cname);
+			return -1;
+		}
+		snprintf(cname, sizeof(cname), "%.*s_exec_time", it->name.len,
+				it->name.s);
+		if(counter_register(&it->cnt_exec_time, "rtimer", cname, 0, 0, 0,
+				   "total execution time of the timer routes (usecs)", 0)
+				< 0) {
+			LM_ERR("failed to register counter rtimer.%s\n", cname);
+			return -1;
+		}
+		snprintf(cname, sizeof(cname), "%.*s_overruns", it->name.len,
+				it->name.s);
+		if(counter_register(&it->cnt_overruns, "rtimer", cname, 0, 0, 0,
+				   "iterations that took longer than the timer interval", 0)
+				< 0) {
+			LM_ERR("failed to register counter rtimer.%s\n", cname);
+			return -1;
+		}
+		it = it->next;
+	}
+
 	/* register timers */
 	it = _stm_list;
 	while(it) {
@@ -147,7 +194,9 @@ static int mod_init(void)
 static int child_init(int rank)
 {
 	stm_timer_t *it;
+	stm_worker_t *sw;
 	int i;
+	int ret;
 	char si_desc[MAX_PT_DESC];
 
 	if(_stm_list == NULL)
@@ -161,7 +210,30 @@ static int child_init(int rank)
 		for(i = 0; i < it->mode; i++) {
 			snprintf(si_desc, MAX_PT_DESC, "RTIMER EXEC child=%d timer=%.*s", i,
 					it->name.len, it->name.s);
-			if(it->flags & RTIMER_INTERVAL_USEC) {
+			if(it->flags & RTIMER_SYNC_MODE) {
+				/* the sync timer callbacks have no worker parameter - pass
+				 * the worker index along with the timer in a small wrapper */
+				sw = (stm_worker_t *)pkg_malloc(sizeof(stm_worker_t));
+				if(sw == NULL) {
+					PKG_MEM_ERROR;
+					return -1;
+				}
+				sw->timer = it;
+				sw->worker = i;
+				if(it->flags & RTIMER_INTERVAL_USEC) {
+					ret = fork_sync_utimer(PROC_TIMER, si_desc,
+							1 /*socks flag*/, stm_sync_timer_exec, (void *)sw,
+							it->interval /*usec*/);
+				} else {
+					ret = fork_sync_timer(PROC_TIMER, si_desc,
+							1 /*socks flag*/, stm_sync_timer_exec, (void *)sw,
+							it->interval /*sec*/);
+				}
+				if(ret < 0) {
+					LM_ERR("failed to start sync timer routine as process\n");
+					return -1; /* error */
+				}
+			} else if(it->flags & RTIMER_INTERVAL_USEC) {
 				if(fork_basic_utimer_w(PROC_TIMER, si_desc, 1 /*socks flag*/,
 						   stm_timer_exec, i, (void *)it, it->interval
 						   /*usec*/)
@@ -192,6 +264,16 @@ void stm_main_timer_exec(unsigned int ticks, void *param)
 	stm_timer_exec(ticks, 0, param);
 }
 
+void stm_sync_timer_exec(unsigned int ticks, void *param)
+{
+	stm_worker_t *sw;
+
+	if(param == NULL)
+		return;
+	sw = (stm_worker_t *)param;
+	stm_timer_exec(ticks, sw->worker, (void *)sw->timer);
+}
+
 void stm_timer_exec(unsigned int ticks, int worker, void *param)
 {
 	stm_timer_t *it;
@@ -199,6 +281,8 @@ void stm_timer_exec(unsigned int ticks, int worker, void *param)
 	sip_msg_t *fmsg;
 	sr_kemi_eng_t *keng = NULL;
 	str evname = str_init("rtimer");
+	struct timeval tvb, tve;
+	unsigned long long texec;
 	rt_worker = worker;
 
 	if(param == NULL)
@@ -207,6 +291,8 @@ void stm_timer_exec(unsigned int ticks, int worker, void *param)
 	if(it->rt == NULL)
 		return;
 
+	gettimeofday(&tvb, NULL);
+
 	for(rt = it->rt; rt; rt = rt->next) {
 		fmsg = faked_msg_next();
 		if(exec_pre_script_cb(fmsg, REQUEST_CB_TYPE) == 0)
@@ -225,6 +311,17 @@ void stm_timer_exec(unsigned int ticks, int worker, void *param)
 		exec_post_script_cb(fmsg, REQUEST_CB_TYPE);
 		ksr_msg_env_reset();
 	}
+
+	gettimeofday(&tve, NULL);
+	texec = (unsigned long long)(tve.tv_sec - tvb.tv_sec) * 1000000
+			+ (tve.tv_usec - tvb.tv_usec);
+	counter_inc(it->cnt_executed);
+	counter_add(it->cnt_exec_time, (int)texec);
+	if(texec > ((it->flags & RTIMER_INTERVAL_USEC)
+					   ? (unsigned long long)it->interval
+					   : (unsigned long long)it->interval * 1000000)) {
+		counter_inc(it->cnt_overruns);
+	}
 }
 
 int stm_t_param(modparam_t type, void *val)
@@ -234,6 +331,7 @@ int stm_t_param(modparam_t type, void *val)
 	param_t *pit = NULL;
 	stm_timer_t tmp;
 	stm_timer_t *nt;
+	unsigned int usync;
 	str s;
 
 	if(val == NULL)
@@ -256,6 +354,20 @@ int stm_t_param(modparam_t type, void *val)
 					return -1;
 				}
 			}
+		} else if(pit->name.len == 4
+				  && strncasecmp(pit->name.s, "sync", 4) == 0) {
+			usync = 0;
+			if(str2int(&pit->body, &usync) < 0) {
+				LM_ERR("invalid sync: %.*s\n", pit->body.len, pit->body.s);
+				return -1;
+			}
+			if(usync != 0) {
+				tmp.flags |= RTIMER_SYNC_MODE;
+				if(tmp.mode == 0) {
+					/* drift correction needs a dedicated timer process */
+					tmp.mode = 1;
+				}
+			}
 		} else if(pit->name.len == 8
 				  && strncasecmp(pit->name.s, "interval", 8) == 0) {
 			if(pit->body.s[pit->body.len - 1] == 'u'
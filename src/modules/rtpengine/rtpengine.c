@@ -1292,6 +1292,12 @@ int add_rtpengine_socks(struct rtpp_set *rtpp_list, char *rtpengine,
 		}
 		memset(pnode, 0, sizeof(*pnode));
 
+		if(lock_init(&pnode->rn_rtt.lock) == 0) {
+			LM_ERR("failed to init rtt stats lock\n");
+			shm_free(pnode);
+			return -1;
+		}
+
 		lock_get(rtpp_no_lock);
 		pnode->idx = *rtpp_no;
 
@@ -2177,6 +2183,10 @@ static int add_rtpp_node_info(
 	rpc_t *rpc;
 	void *ctx;
 	int rtpp_ticks;
+	struct rtpp_rtt_stats rtt;
+	char hbuf[RTPENGINE_RTT_BUCKETS * 24];
+	int hlen;
+	int b;
 
 	rpc = ptrs[0];
 	ctx = ptrs[1];
@@ -2206,6 +2216,24 @@ static int add_rtpp_node_info(
 		rpc->struct_add(vh, "d", "recheck_ticks", rtpp_ticks);
 	}
 
+	lock_get(&crt_rtpp->rn_rtt.lock);
+	rtt = crt_rtpp->rn_rtt;
+	lock_release(&crt_rtpp->rn_rtt.lock);
+
+	rpc->struct_add(vh, "dddd", "rtt_count", (int)rtt.count, "rtt_avg_us",
+			(int)(rtt.count > 0 ? rtt.sum_us / rtt.count : 0), "rtt_max_us",
+			(int)rtt.max_us, "rtt_timeouts", (int)rtt.timeouts);
+
+	/* log2 histogram over the command rtt - <1ms, <2ms, ... as counts */
+	hlen = 0;
+	for(b = 0; b < RTPENGINE_RTT_BUCKETS; b++) {
+		hlen += snprintf(hbuf + hlen, sizeof(hbuf) - hlen, "%s%llu",
+				(b > 0) ? "," : "", rtt.buckets[b]);
+		if(hlen >= sizeof(hbuf))
+			break;
+	}
+	rpc->struct_add(vh, "s", "rtt_histogram", hbuf);
+
 	return 0;
 }
 
@@ -4233,6 +4261,34 @@ error:
 	return 1;
 }
 
+/**
+ * update the per-node command round-trip stats - rtt_us is ignored when
+ * the command timed out
+ */
+static void rtpp_rtt_record(
+		struct rtpp_node *node, int timedout, unsigned long long rtt_us)
+{
+	int b;
+	unsigned long long ms;
+
+	lock_get(&node->rn_rtt.lock);
+	if(timedout) {
+		node->rn_rtt.timeouts++;
+	} else {
+		node->rn_rtt.count++;
+		node->rn_rtt.sum_us += rtt_us;
+		if(rtt_us > node->rn_rtt.max_us)
+			node->rn_rtt.max_us = rtt_us;
+		ms = rtt_us / 1000;
+		for(b = 0; b < RTPENGINE_RTT_BUCKETS - 1; b++) {
+			if(ms < (1ULL << b))
+				break;
+		}
+		node->rn_rtt.buckets[b]++;
+	}
+	lock_release(&node->rn_rtt.lock);
+}
+
 static char *send_rtpp_command(
 		struct rtpp_node *node, bencode_item_t *dict, int *outlen)
 {
@@ -4246,6 +4302,8 @@ static char *send_rtpp_command(
 	str cmd = STR_NULL;
 	const static str rtpe_proto = {"ng.rtpengine.com", 16};
 	str request, response;
+	struct timeval tstart;
+	struct timeval tend;
 
 	v = bencode_iovec(dict, &vcnt, 1, 0);
 	if(!v) {
@@ -4256,6 +4314,7 @@ static char *send_rtpp_command(
 	len = 0;
 	cp = buf;
 	rtpengine_tout_ms = cfg_get(rtpengine, rtpengine_cfg, rtpengine_tout_ms);
+	gettimeofday(&tstart, NULL);
 
 	if(node->rn_umode == RNU_LOCAL) {
 		memset(&addr, 0, sizeof(addr));
@@ -4399,11 +4458,16 @@ static char *send_rtpp_command(
 			LM_ERR("timeout waiting reply for command \"%.*s\" from RTPEngine "
 				   "<%s>\n",
 					cmd.len, cmd.s, node->rn_url.s);
+			rtpp_rtt_record(node, 1, 0);
 			goto badproxy;
 		}
 	}
 
 out:
+	gettimeofday(&tend, NULL);
+	rtpp_rtt_record(node, 0,
+			(unsigned long long)(tend.tv_sec - tstart.tv_sec) * 1000000
+					+ (tend.tv_usec - tstart.tv_usec));
 	cp[len] = '\0';
 	*outlen = len;
 	return cp;
@@ -72,6 +72,20 @@ enum rtpe_operation
 	OP_ANY,
 };
 
+/* log2 buckets over the command round-trip time, in ms: bucket 0 counts
+ * replies under 1ms, bucket 1 under 2ms, ... the last bucket the rest */
+#define RTPENGINE_RTT_BUCKETS 12
+
+struct rtpp_rtt_stats
+{
+	gen_lock_t lock;
+	unsigned long long count;
+	unsigned long long sum_us;
+	unsigned long long max_us;
+	unsigned long long timeouts;
+	unsigned long long buckets[RTPENGINE_RTT_BUCKETS];
+};
+
 struct rtpp_node
 {
 	unsigned int idx; /* overall index */
@@ -90,6 +104,7 @@ struct rtpp_node
 	unsigned int rn_weight;	   /* for load balancing */
 	unsigned int rn_displayed; /* for delete at db reload */
 	unsigned int rn_recheck_ticks;
+	struct rtpp_rtt_stats rn_rtt; /* ng command round-trip stats */
 	struct rtpp_node *rn_next;
 };
 
@@ -139,11 +139,52 @@ static int mod_init(void)
 int sanity_check(struct sip_msg *_msg, int msg_checks, int uri_checks)
 {
 	int ret;
+	hdr_flags_t hdrf = 0;
 
 	if(ksr_sanity_noreply != 0) {
 		ksr_sanity_info_init();
 	}
 
+	/* index the headers needed by all the enabled checks in one scan -
+	 * the parse_headers() calls inside the checks then find everything
+	 * already parsed and keep doing the error handling. A failure here
+	 * is left for the responsible check so its reply is preserved */
+	if((SANITY_REQUIRED_HEADERS | SANITY_CHECK_DIGEST
+			   | SANITY_CHECK_AUTHORIZATION | SANITY_CHECK_DUPTAGS)
+			& msg_checks) {
+		hdrf |= HDR_EOH_F;
+	}
+	if((SANITY_VIA1_HEADER | SANITY_VIA_SIP_VERSION | SANITY_VIA_PROTOCOL)
+			& msg_checks) {
+		hdrf |= HDR_VIA1_F;
+	}
+	if((SANITY_CSEQ_METHOD | SANITY_CSEQ_VALUE) & msg_checks) {
+		hdrf |= HDR_CSEQ_F;
+	}
+	if(SANITY_CL & msg_checks) {
+		hdrf |= HDR_CONTENTLENGTH_F;
+	}
+	if(SANITY_EXPIRES_VALUE & msg_checks) {
+		hdrf |= HDR_EXPIRES_F;
+	}
+	if(SANITY_PROXY_REQUIRE & msg_checks) {
+		hdrf |= HDR_PROXYREQUIRE_F;
+	}
+	if(SANITY_PARSE_URIS & msg_checks) {
+		if(SANITY_URI_CHECK_FROM & uri_checks) {
+			hdrf |= HDR_FROM_F;
+		}
+		if(SANITY_URI_CHECK_TO & uri_checks) {
+			hdrf |= HDR_TO_F;
+		}
+		if(SANITY_URI_CHECK_CONTACT & uri_checks) {
+			hdrf |= HDR_CONTACT_F;
+		}
+	}
+	if(hdrf != 0 && parse_headers(_msg, hdrf, 0) != 0) {
+		LM_DBG("failed to parse headers for the enabled checks\n");
+	}
+
 	ret = SANITY_CHECK_PASSED;
 	if(SANITY_RURI_SIP_VERSION & msg_checks
 			&& (ret = check_ruri_sip_version(_msg)) != SANITY_CHECK_PASSED) {
@@ -222,16 +222,23 @@ int sdp_locate_line(sip_msg_t *msg, char *pos, str *aline)
 	return 0;
 }
 
+int sdp_codec_in_str(str *allcodecs, str *codec, char delim);
+
 /**
- *
+ * remove the codec attribute lines (rtpmap, fmtp, rtcp-fb) of a media stream
+ * in one pass over its lines, matching the payload id of each line against
+ * the delim-separated ids list - if keep is not 0, the lines whose id is not
+ * in the list are the ones removed
  */
-int sdp_remove_str_codec_id_attrs(
-		sip_msg_t *msg, sdp_stream_cell_t *sdp_stream, str *rm_codec)
+int sdp_remove_str_codec_list_attrs(sip_msg_t *msg,
+		sdp_stream_cell_t *sdp_stream, str *codecs, char delim, int keep)
 {
 	str sdp_attrs_list[] = {str_init("a=rtpmap:"), str_init("a=fmtp:"),
 			str_init("a=rtcp-fb:"), {0, 0}};
 	int i;
+	int rm;
 	str aline = {0, 0};
+	str cid = {0, 0};
 	str raw_stream = {0, 0};
 	struct lump *anchor;
 
@@ -242,26 +249,34 @@ int sdp_remove_str_codec_id_attrs(
 		if((aline.len > 5) && ((aline.s[0] | 0x20) == 'a')) {
 			LM_DBG("processing sdp line [%.*s]\n", aline.len, aline.s);
 			for(i = 0; sdp_attrs_list[i].s != NULL; i++) {
-				if(aline.len > sdp_attrs_list[i].len + rm_codec->len) {
-					if(strncasecmp(aline.s, sdp_attrs_list[i].s,
-							   sdp_attrs_list[i].len)
-									== 0
-							&& strncmp(aline.s + sdp_attrs_list[i].len,
-									   rm_codec->s, rm_codec->len)
-									   == 0
-							&& aline.s[sdp_attrs_list[i].len + rm_codec->len]
-									   == ' ') {
-						LM_DBG("removing line: [%.*s]\n", aline.len, aline.s);
-						anchor =
-								del_lump(msg, aline.s - msg->buf, aline.len, 0);
-						if(anchor == NULL) {
-							LM_ERR("failed to remove - id [%.*s] line [%.*s]\n",
-									rm_codec->len, rm_codec->s, aline.len,
-									aline.s);
-							return -1;
-						}
+				if(aline.len <= sdp_attrs_list[i].len
+						|| strncasecmp(aline.s, sdp_attrs_list[i].s,
+								   sdp_attrs_list[i].len)
+								   != 0)
+					continue;
+				/* get the payload id - the space-ended token after prefix */
+				cid.s = aline.s + sdp_attrs_list[i].len;
+				cid.len = 0;
+				while(sdp_attrs_list[i].len + cid.len < aline.len
+						&& cid.s[cid.len] != ' ' && cid.s[cid.len] != '\r'
+						&& cid.s[cid.len] != '\n')
+					cid.len++;
+				if(cid.len == 0 || sdp_attrs_list[i].len + cid.len >= aline.len
+						|| cid.s[cid.len] != ' ')
+					break;
+				rm = sdp_codec_in_str(codecs, &cid, delim);
+				if(keep)
+					rm = !rm;
+				if(rm) {
+					LM_DBG("removing line: [%.*s]\n", aline.len, aline.s);
+					anchor = del_lump(msg, aline.s - msg->buf, aline.len, 0);
+					if(anchor == NULL) {
+						LM_ERR("failed to remove - id [%.*s] line [%.*s]\n",
+								cid.len, cid.s, aline.len, aline.s);
+						return -1;
 					}
 				}
+				break;
 			}
 		}
 		raw_stream.s = aline.s + aline.len;
@@ -271,6 +286,15 @@ int sdp_remove_str_codec_id_attrs(
 	return 0;
 }
 
+/**
+ *
+ */
+int sdp_remove_str_codec_id_attrs(
+		sip_msg_t *msg, sdp_stream_cell_t *sdp_stream, str *rm_codec)
+{
+	return sdp_remove_str_codec_list_attrs(msg, sdp_stream, rm_codec, ',', 0);
+}
+
 /**
  *
  */
@@ -414,8 +438,10 @@ int sdp_remove_codecs_by_id(sip_msg_t *msg, str *codecs, str *media)
 					LM_DBG("codecs [%.*s] - remove [%.*s]\n", sdp_codecs.len,
 							sdp_codecs.s, rm_codec.len, rm_codec.s);
 					sdp_remove_str_codec_id(msg, &sdp_codecs, &rm_codec);
-					sdp_remove_str_codec_id_attrs(msg, sdp_stream, &rm_codec);
 				}
+				/* drop the attribute lines of all removed codecs in one
+				 * walk over the stream instead of one walk per codec */
+				sdp_remove_str_codec_list_attrs(msg, sdp_stream, codecs, ',', 0);
 			}
 			sdp_stream_num++;
 		}
@@ -751,10 +777,11 @@ int sdp_keep_codecs_by_id(sip_msg_t *msg, str *codecs, str *media)
 								sdp_codecs.len, sdp_codecs.s, rm_codec.len,
 								rm_codec.s);
 						sdp_remove_str_codec_id(msg, &sdp_codecs, &rm_codec);
-						sdp_remove_str_codec_id_attrs(
-								msg, sdp_stream, &rm_codec);
 					}
 				}
+				/* drop the attribute lines of all codecs outside the keep
+				 * list in one walk over the stream */
+				sdp_remove_str_codec_list_attrs(msg, sdp_stream, codecs, ',', 1);
 			}
 			sdp_stream_num++;
 		}
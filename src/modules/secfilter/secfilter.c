@@ -338,36 +338,16 @@ BLACKLIST AND WHITELIST
 static int ki_check_dst(struct sip_msg *msg, str *val)
 {
 	str dst;
-	struct str_list *list;
 
 	dst.s = val->s;
 	dst.len = val->len;
 
-	list = (*secf_data)->bl.dst;
-	while(list) {
-		if(secf_dst_exact_match == 1) {
-			/* Exact match */
-			if(list->s.len == dst.len) {
-				if(cmpi_str(&list->s, &dst) == 0) {
-					lock_get(secf_lock);
-					secf_stats[BL_DST]++;
-					lock_release(secf_lock);
-					return -2;
-				}
-			}
-		} else {
-			/* Any match */
-			dst.len = val->len;
-			if(dst.len > list->s.len)
-				dst.len = list->s.len;
-			if(cmpi_str(&list->s, &dst) == 0) {
-				lock_get(secf_lock);
-				secf_stats[BL_DST]++;
-				lock_release(secf_lock);
-				return -2;
-			}
-		}
-		list = list->next;
+	if(secf_trie_match((*secf_data)->bl.dst_trie, &dst,
+			   (secf_dst_exact_match == 1) ? 1 : 0)) {
+		lock_get(secf_lock);
+		secf_stats[BL_DST]++;
+		lock_release(secf_lock);
+		return -2;
 	}
 
 	return 1;
@@ -390,46 +370,27 @@ Return codes:
 */
 static int ki_check_ua(struct sip_msg *msg)
 {
-	int res, len;
+	int res;
 	str ua;
-	struct str_list *list;
 
 	res = secf_get_ua(msg, &ua);
 	if(res != 0)
 		return res;
 
-	len = ua.len;
-
 	/* User-agent whitelisted */
-	list = (*secf_data)->wl.ua;
-	while(list) {
-		if(ua.len > list->s.len)
-			ua.len = list->s.len;
-		res = cmpi_str(&list->s, &ua);
-		if(res == 0) {
-			lock_get(secf_lock);
-			secf_stats[WL_UA]++;
-			lock_release(secf_lock);
-			return 2;
-		}
-		list = list->next;
-		ua.len = len;
+	if(secf_trie_match((*secf_data)->wl.ua_trie, &ua, 0)) {
+		lock_get(secf_lock);
+		secf_stats[WL_UA]++;
+		lock_release(secf_lock);
+		return 2;
 	}
 
 	/* User-agent blacklisted */
-	list = (*secf_data)->bl.ua;
-	while(list) {
-		if(ua.len > list->s.len)
-			ua.len = list->s.len;
-		res = cmpi_str(&list->s, &ua);
-		if(res == 0) {
-			lock_get(secf_lock);
-			secf_stats[BL_UA]++;
-			lock_release(secf_lock);
-			return -2;
-		}
-		list = list->next;
-		ua.len = len;
+	if(secf_trie_match((*secf_data)->bl.ua_trie, &ua, 0)) {
+		lock_get(secf_lock);
+		secf_stats[BL_UA]++;
+		lock_release(secf_lock);
+		return -2;
 	}
 
 	return 1;
@@ -493,8 +454,6 @@ static int check_user(struct sip_msg *msg, int type)
 	str user = STR_NULL;
 	str domain = STR_NULL;
 	int res = 0;
-	int nlen, ulen, dlen;
-	struct str_list *list = NULL;
 
 	switch(type) {
 		case 1:
@@ -517,154 +476,110 @@ static int check_user(struct sip_msg *msg, int type)
 		return -1;
 	}
 
-	nlen = name.len;
-	ulen = user.len;
-	dlen = domain.len;
-
+	/* Name whitelisted */
+	if(name.s != NULL
+			&& secf_trie_match((*secf_data)->wl.user_trie, &name, 0)) {
+		lock_get(secf_lock);
+		switch(type) {
+			case 1:
+				secf_stats[WL_FNAME]++;
+				break;
+			case 2:
+				secf_stats[WL_TNAME]++;
+				break;
+			case 3:
+				secf_stats[WL_CNAME]++;
+				break;
+		}
+		lock_release(secf_lock);
+		return 4;
+	}
 	/* User whitelisted */
-	list = (*secf_data)->wl.user;
-	while(list) {
-		if(name.len > list->s.len)
-			name.len = list->s.len;
-		if(name.s != NULL) {
-			res = cmpi_str(&list->s, &name);
-			if(res == 0) {
-				lock_get(secf_lock);
-				switch(type) {
-					case 1:
-						secf_stats[WL_FNAME]++;
-						break;
-					case 2:
-						secf_stats[WL_TNAME]++;
-						break;
-					case 3:
-						secf_stats[WL_CNAME]++;
-						break;
-				}
-				lock_release(secf_lock);
-				return 4;
-			}
+	if(secf_trie_match((*secf_data)->wl.user_trie, &user, 0)) {
+		lock_get(secf_lock);
+		switch(type) {
+			case 1:
+				secf_stats[WL_FUSER]++;
+				break;
+			case 2:
+				secf_stats[WL_TUSER]++;
+				break;
+			case 3:
+				secf_stats[WL_CUSER]++;
+				break;
 		}
-		if(user.len > list->s.len)
-			user.len = list->s.len;
-		res = cmpi_str(&list->s, &user);
-		if(res == 0) {
-			lock_get(secf_lock);
-			switch(type) {
-				case 1:
-					secf_stats[WL_FUSER]++;
-					break;
-				case 2:
-					secf_stats[WL_TUSER]++;
-					break;
-				case 3:
-					secf_stats[WL_CUSER]++;
-					break;
-			}
-			lock_release(secf_lock);
-			return 2;
+		lock_release(secf_lock);
+		return 2;
+	}
+	/* Name blacklisted */
+	if(name.s != NULL
+			&& secf_trie_match((*secf_data)->bl.user_trie, &name, 0)) {
+		lock_get(secf_lock);
+		switch(type) {
+			case 1:
+				secf_stats[BL_FNAME]++;
+				break;
+			case 2:
+				secf_stats[BL_TNAME]++;
+				break;
+			case 3:
+				secf_stats[BL_CNAME]++;
+				break;
 		}
-		list = list->next;
-		name.len = nlen;
-		user.len = ulen;
+		lock_release(secf_lock);
+		return -4;
 	}
 	/* User blacklisted */
-	list = (*secf_data)->bl.user;
-	while(list) {
-		if(name.len > list->s.len)
-			name.len = list->s.len;
-		if(name.s != NULL) {
-			res = cmpi_str(&list->s, &name);
-			if(res == 0) {
-				lock_get(secf_lock);
-				switch(type) {
-					case 1:
-						secf_stats[BL_FNAME]++;
-						break;
-					case 2:
-						secf_stats[BL_TNAME]++;
-						break;
-					case 3:
-						secf_stats[BL_CNAME]++;
-						break;
-				}
-				lock_release(secf_lock);
-				return -4;
-			}
-		}
-		if(user.len > list->s.len)
-			user.len = list->s.len;
-		res = cmpi_str(&list->s, &user);
-		if(res == 0) {
-			lock_get(secf_lock);
-			switch(type) {
-				case 1:
-					secf_stats[BL_FUSER]++;
-					break;
-				case 2:
-					secf_stats[BL_TUSER]++;
-					break;
-				case 3:
-					secf_stats[BL_CUSER]++;
-					break;
-			}
-			lock_release(secf_lock);
-			return -2;
+	if(secf_trie_match((*secf_data)->bl.user_trie, &user, 0)) {
+		lock_get(secf_lock);
+		switch(type) {
+			case 1:
+				secf_stats[BL_FUSER]++;
+				break;
+			case 2:
+				secf_stats[BL_TUSER]++;
+				break;
+			case 3:
+				secf_stats[BL_CUSER]++;
+				break;
 		}
-		list = list->next;
-		name.len = nlen;
-		user.len = ulen;
+		lock_release(secf_lock);
+		return -2;
 	}
 
 	/* Domain whitelisted */
-	list = (*secf_data)->wl.domain;
-	while(list) {
-		if(domain.len > list->s.len)
-			domain.len = list->s.len;
-		res = cmpi_str(&list->s, &domain);
-		if(res == 0) {
-			lock_get(secf_lock);
-			switch(type) {
-				case 1:
-					secf_stats[WL_FDOMAIN]++;
-					break;
-				case 2:
-					secf_stats[WL_TDOMAIN]++;
-					break;
-				case 3:
-					secf_stats[WL_CDOMAIN]++;
-					break;
-			}
-			lock_release(secf_lock);
-			return 3;
+	if(secf_trie_match((*secf_data)->wl.domain_trie, &domain, 0)) {
+		lock_get(secf_lock);
+		switch(type) {
+			case 1:
+				secf_stats[WL_FDOMAIN]++;
+				break;
+			case 2:
+				secf_stats[WL_TDOMAIN]++;
+				break;
+			case 3:
+				secf_stats[WL_CDOMAIN]++;
+				break;
 		}
-		list = list->next;
-		domain.len = dlen;
+		lock_release(secf_lock);
+		return 3;
 	}
 	/* Domain blacklisted */
-	list = (*secf_data)->bl.domain;
-	while(list) {
-		if(domain.len > list->s.len)
-			domain.len = list->s.len;
-		res = cmpi_str(&list->s, &domain);
-		if(res == 0) {
-			lock_get(secf_lock);
-			switch(type) {
-				case 1:
-					secf_stats[BL_FDOMAIN]++;
-					break;
-				case 2:
-					secf_stats[BL_TDOMAIN]++;
-					break;
-				case 3:
-					secf_stats[BL_CDOMAIN]++;
-					break;
-			}
-			lock_release(secf_lock);
-			return -3;
+	if(secf_trie_match((*secf_data)->bl.domain_trie, &domain, 0)) {
+		lock_get(secf_lock);
+		switch(type) {
+			case 1:
+				secf_stats[BL_FDOMAIN]++;
+				break;
+			case 2:
+				secf_stats[BL_TDOMAIN]++;
+				break;
+			case 3:
+				secf_stats[BL_CDOMAIN]++;
+				break;
 		}
-		list = list->next;
-		domain.len = dlen;
+		lock_release(secf_lock);
+		return -3;
 	}
 
 	return 1;
@@ -681,9 +596,7 @@ Return codes:
 */
 static int ki_check_ip(struct sip_msg *msg)
 {
-	int res, len;
 	str ip;
-	struct str_list *list;
 
 	if(msg == NULL)
 		return -1;
@@ -691,37 +604,19 @@ static int ki_check_ip(struct sip_msg *msg)
 	ip.s = ip_addr2a(&msg->rcv.src_ip);
 	ip.len = strlen(ip.s);
 
-	len = ip.len;
-
 	/* IP address whitelisted */
-	list = (*secf_data)->wl.ip;
-	while(list) {
-		if(ip.len > list->s.len)
-			ip.len = list->s.len;
-		res = cmpi_str(&list->s, &ip);
-		if(res == 0) {
-			lock_get(secf_lock);
-			secf_stats[WL_IP]++;
-			lock_release(secf_lock);
-			return 2;
-		}
-		list = list->next;
-		ip.len = len;
+	if(secf_trie_match((*secf_data)->wl.ip_trie, &ip, 0)) {
+		lock_get(secf_lock);
+		secf_stats[WL_IP]++;
+		lock_release(secf_lock);
+		return 2;
 	}
 	/* IP address blacklisted */
-	list = (*secf_data)->bl.ip;
-	while(list) {
-		if(ip.len > list->s.len)
-			ip.len = list->s.len;
-		res = cmpi_str(&list->s, &ip);
-		if(res == 0) {
-			lock_get(secf_lock);
-			secf_stats[BL_IP]++;
-			lock_release(secf_lock);
-			return -2;
-		}
-		list = list->next;
-		ip.len = len;
+	if(secf_trie_match((*secf_data)->bl.ip_trie, &ip, 0)) {
+		lock_get(secf_lock);
+		secf_stats[BL_IP]++;
+		lock_release(secf_lock);
+		return -2;
 	}
 
 	return 1;
@@ -741,44 +636,24 @@ Return codes:
 */
 static int ki_check_country(struct sip_msg *msg, str *val)
 {
-	int res, len;
 	str country;
-	struct str_list *list;
 
 	country.s = val->s;
 	country.len = val->len;
 
-	len = country.len;
-
 	/* Country whitelisted */
-	list = (*secf_data)->wl.country;
-	while(list) {
-		if(country.len > list->s.len)
-			country.len = list->s.len;
-		res = cmpi_str(&list->s, &country);
-		if(res == 0) {
-			lock_get(secf_lock);
-			secf_stats[WL_COUNTRY]++;
-			lock_release(secf_lock);
-			return 2;
-		}
-		list = list->next;
-		country.len = len;
+	if(secf_trie_match((*secf_data)->wl.country_trie, &country, 0)) {
+		lock_get(secf_lock);
+		secf_stats[WL_COUNTRY]++;
+		lock_release(secf_lock);
+		return 2;
 	}
 	/* Country blacklisted */
-	list = (*secf_data)->bl.country;
-	while(list) {
-		if(country.len > list->s.len)
-			country.len = list->s.len;
-		res = cmpi_str(&list->s, &country);
-		if(res == 0) {
-			lock_get(secf_lock);
-			secf_stats[BL_COUNTRY]++;
-			lock_release(secf_lock);
-			return -2;
-		}
-		list = list->next;
-		country.len = len;
+	if(secf_trie_match((*secf_data)->bl.country_trie, &country, 0)) {
+		lock_get(secf_lock);
+		secf_stats[BL_COUNTRY]++;
+		lock_release(secf_lock);
+		return -2;
 	}
 
 	return 1;
@@ -984,6 +859,13 @@ static void free_sec_info(secf_info_p info)
 	free_str_list(info->ip);
 	LM_DBG("freeing dst[%p]\n", info->dst);
 	free_str_list(info->dst);
+	LM_DBG("freeing tries\n");
+	secf_trie_free(info->ua_trie);
+	secf_trie_free(info->country_trie);
+	secf_trie_free(info->domain_trie);
+	secf_trie_free(info->user_trie);
+	secf_trie_free(info->ip_trie);
+	secf_trie_free(info->dst_trie);
 	LM_DBG("zeroed info[%p]\n", info);
 	memset(info, 0, sizeof(secf_info_t));
 }
@@ -31,6 +31,16 @@
 #define BL_DST 24
 #define BL_SQL 25
 
+/* node of the compiled rule tries - first-child/next-sibling layout with
+ * case-folded bytes, so a lookup costs O(length of the checked value) */
+typedef struct _secf_trie_node
+{
+	unsigned char c; /* case-folded byte */
+	int match;		 /* number of rules ending at this node */
+	struct _secf_trie_node *child;
+	struct _secf_trie_node *sibling;
+} secf_trie_node_t;
+
 typedef struct _secf_info
 {
 	struct str_list *ua;
@@ -39,6 +49,13 @@ typedef struct _secf_info
 	struct str_list *user;
 	struct str_list *ip;
 	struct str_list *dst;
+	/* the rules compiled into tries - kept in sync with the lists */
+	secf_trie_node_t *ua_trie;
+	secf_trie_node_t *country_trie;
+	secf_trie_node_t *domain_trie;
+	secf_trie_node_t *user_trie;
+	secf_trie_node_t *ip_trie;
+	secf_trie_node_t *dst_trie;
 } secf_info_t, *secf_info_p;
 
 typedef struct _secf_data
@@ -60,6 +77,12 @@ void secf_reset_stats(void);
 int secf_append_rule(int action, int type, str *value);
 int secf_remove_rule(int action, int type, str *value);
 
+/* Compiled rule tries */
+int secf_trie_insert(secf_trie_node_t **root, str *value);
+int secf_trie_remove(secf_trie_node_t **root, str *value);
+int secf_trie_match(secf_trie_node_t *root, str *value, int exact);
+void secf_trie_free(secf_trie_node_t *node);
+
 /* Get header values from message */
 int secf_get_ua(struct sip_msg *msg, str *ua);
 int secf_get_from(struct sip_msg *msg, str *name, str *user, str *domain);
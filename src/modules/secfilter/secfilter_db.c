@@ -108,6 +108,7 @@ int secf_append_rule(int action, int type, str *value)
 	struct str_list **ini_node = NULL;
 	struct str_list **last_node = NULL;
 	struct str_list *new = NULL;
+	secf_trie_node_t **trie = NULL;
 	int total = 0;
 	char *v = NULL;
 
@@ -129,26 +130,32 @@ int secf_append_rule(int action, int type, str *value)
 			if(action == 2) {
 				ini_node = &ini->dst;
 				last_node = &last->dst;
+				trie = &ini->dst_trie;
 			} else {
 				ini_node = &ini->ua;
 				last_node = &last->ua;
+				trie = &ini->ua_trie;
 			}
 			break;
 		case 1:
 			ini_node = &ini->country;
 			last_node = &last->country;
+			trie = &ini->country_trie;
 			break;
 		case 2:
 			ini_node = &ini->domain;
 			last_node = &last->domain;
+			trie = &ini->domain_trie;
 			break;
 		case 3:
 			ini_node = &ini->ip;
 			last_node = &last->ip;
+			trie = &ini->ip_trie;
 			break;
 		case 4:
 			ini_node = &ini->user;
 			last_node = &last->user;
+			trie = &ini->user_trie;
 			break;
 		default:
 			LM_ERR("Unknown type value %d", type);
@@ -179,6 +186,12 @@ int secf_append_rule(int action, int type, str *value)
 	}
 	LM_DBG("ini_node:%p last_node:%p\n", *ini_node, *last_node);
 
+	/* compile the rule into the trie used by the checks */
+	if(secf_trie_insert(trie, value) < 0) {
+		LM_ERR("can't add rule to the trie\n");
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -202,6 +215,7 @@ int secf_remove_rule(int action, int type, str *value)
 	struct str_list **last_node = NULL;
 	struct str_list *current = NULL;
 	struct str_list *previous = NULL;
+	secf_trie_node_t **trie = NULL;
 	int total = 0;
 
 	if(action < 0 || action > 2) {
@@ -222,32 +236,41 @@ int secf_remove_rule(int action, int type, str *value)
 			if(action == 2) {
 				ini_node = &ini->dst;
 				last_node = &last->dst;
+				trie = &ini->dst_trie;
 			} else {
 				ini_node = &ini->ua;
 				last_node = &last->ua;
+				trie = &ini->ua_trie;
 			}
 			break;
 		case 1:
 			ini_node = &ini->country;
 			last_node = &last->country;
+			trie = &ini->country_trie;
 			break;
 		case 2:
 			ini_node = &ini->domain;
 			last_node = &last->domain;
+			trie = &ini->domain_trie;
 			break;
 		case 3:
 			ini_node = &ini->ip;
 			last_node = &last->ip;
+			trie = &ini->ip_trie;
 			break;
 		case 4:
 			ini_node = &ini->user;
 			last_node = &last->user;
+			trie = &ini->user_trie;
 			break;
 		default:
 			LM_ERR("Unknown type value %d", type);
 			return -1;
 	}
 
+	/* clear the matching rules from the trie used by the checks */
+	secf_trie_remove(trie, value);
+
 	current = *ini_node;
 	previous = NULL;
 	// Iterate through the list and remove matching nodes
@@ -0,0 +1,205 @@
+/**
+ * Copyright (C) 2018 Jose Luis Verdeguer
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kamailio is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version
+ *
+ * Kamailio is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#include "../../core/mem/shm_mem.h"
+#include "secfilter.h"
+
+/* case folding used for the case-insensitive matching */
+static inline unsigned char secf_trie_fold(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+
+static secf_trie_node_t *secf_trie_node_new(unsigned char c)
+{
+	secf_trie_node_t *node;
+
+	node = (secf_trie_node_t *)shm_malloc(sizeof(secf_trie_node_t));
+	if(node == NULL) {
+		SHM_MEM_ERROR;
+		return NULL;
+	}
+	memset(node, 0, sizeof(secf_trie_node_t));
+	node->c = c;
+
+	return node;
+}
+
+
+/**
+ * @brief Add a rule value to a trie
+ *
+ * New nodes are fully initialized before being linked with a single pointer
+ * store, so concurrent readers see either the old or the new state of the
+ * trie and matching needs no lock.
+ * @param root pointer to the trie root
+ * @param value rule value to add
+ * @return 0 on success, -1 on error
+**/
+int secf_trie_insert(secf_trie_node_t **root, str *value)
+{
+	secf_trie_node_t **link;
+	secf_trie_node_t *node = NULL;
+	secf_trie_node_t *it;
+	unsigned char c;
+	int i;
+
+	if(value == NULL || value->s == NULL || value->len <= 0)
+		return -1;
+
+	link = root;
+	for(i = 0; i < value->len; i++) {
+		c = secf_trie_fold((unsigned char)value->s[i]);
+		for(it = *link; it != NULL; it = it->sibling) {
+			if(it->c == c)
+				break;
+		}
+		if(it == NULL) {
+			it = secf_trie_node_new(c);
+			if(it == NULL)
+				return -1;
+			/* publish the new node */
+			it->sibling = *link;
+			*link = it;
+		}
+		node = it;
+		link = &it->child;
+	}
+	node->match++;
+
+	return 0;
+}
+
+
+/* clear the match marks of a whole subtree */
+static int secf_trie_clear(secf_trie_node_t *node)
+{
+	int total = 0;
+
+	for(; node != NULL; node = node->sibling) {
+		total += node->match;
+		node->match = 0;
+		total += secf_trie_clear(node->child);
+	}
+
+	return total;
+}
+
+
+/**
+ * @brief Remove from the trie all the rules starting with the given value
+ *
+ * Mirrors the removal from the list, which drops every entry matching the
+ * given prefix. The nodes are kept so concurrent readers can keep walking
+ * the trie, only the match marks are cleared; the memory is reclaimed when
+ * the data is freed on reload.
+ * @param root pointer to the trie root
+ * @param value prefix of the rules to remove
+ * @return number of removed rules
+**/
+int secf_trie_remove(secf_trie_node_t **root, str *value)
+{
+	secf_trie_node_t *node = NULL;
+	secf_trie_node_t *it;
+	unsigned char c;
+	int total;
+	int i;
+
+	if(value == NULL || value->s == NULL || value->len <= 0)
+		return 0;
+
+	it = *root;
+	for(i = 0; i < value->len; i++) {
+		c = secf_trie_fold((unsigned char)value->s[i]);
+		for(; it != NULL; it = it->sibling) {
+			if(it->c == c)
+				break;
+		}
+		if(it == NULL)
+			return 0;
+		node = it;
+		it = it->child;
+	}
+
+	total = node->match;
+	node->match = 0;
+	total += secf_trie_clear(node->child);
+
+	return total;
+}
+
+
+/**
+ * @brief Check if a rule in the trie matches the given value
+ *
+ * A rule matches when it is a case-insensitive prefix of the value - the
+ * same result the linear scan of the list gave. With exact set, the rule
+ * has to match the whole value.
+ * @param root trie root
+ * @param value value to look up
+ * @param exact 1 for whole-value match, 0 for prefix match
+ * @return 1 when a rule matches, 0 otherwise
+**/
+int secf_trie_match(secf_trie_node_t *root, str *value, int exact)
+{
+	secf_trie_node_t *node = NULL;
+	secf_trie_node_t *it;
+	unsigned char c;
+	int i;
+
+	if(value == NULL || value->s == NULL || value->len <= 0)
+		return 0;
+
+	it = root;
+	for(i = 0; i < value->len; i++) {
+		c = secf_trie_fold((unsigned char)value->s[i]);
+		for(; it != NULL; it = it->sibling) {
+			if(it->c == c)
+				break;
+		}
+		if(it == NULL)
+			return 0;
+		if(!exact && it->match > 0)
+			return 1;
+		node = it;
+		it = it->child;
+	}
+
+	return (exact && node != NULL && node->match > 0) ? 1 : 0;
+}
+
+
+/* Free all the nodes of a trie */
+void secf_trie_free(secf_trie_node_t *node)
+{
+	secf_trie_node_t *next;
+
+	while(node != NULL) {
+		next = node->sibling;
+		secf_trie_free(node->child);
+		shm_free(node);
+		node = next;
+	}
+}
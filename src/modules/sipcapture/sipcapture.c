@@ -78,6 +78,7 @@
 #include "../../core/receive.h"
 #include "../../core/mod_fix.h"
 #include "../../core/rand/kam_rand.h"
+#include "../../core/locking.h"
 #include "../../core/kemi.h"
 #include "sipcapture.h"
 #include "hash_mode.h"
@@ -104,6 +105,9 @@ MODULE_VERSION
 #define NR_KEYS 44
 #define RTCP_NR_KEYS 12
 
+/* upper limit for the db_bulk_rows parameter */
+#define SC_BULK_MAX_ROWS 1024
+
 #define MAX_HEADERS 16
 
 /*multiple table mode*/
@@ -139,6 +143,9 @@ _capture_mode_data_t *capture_def = NULL;
 /* module function prototypes */
 static int mod_init(void);
 static int sipcapture_init_rpc(void);
+static int sc_bulk_init(void);
+static void sc_bulk_destroy(void);
+static int sc_bulk_flush(void);
 static int child_init(int rank);
 static void destroy(void);
 static int sipcapture_fixup(void **param, int param_no);
@@ -245,6 +252,8 @@ int moni_port_start = 0;
 int moni_port_end = 0;
 int *capture_on_flag = NULL;
 int db_insert_mode = 0;
+int db_bulk_rows = 0;
+int db_bulk_flush_time = 1;
 int promisc_on = 0;
 int bpf_on = 0;
 int hep_capture_on = 0;
@@ -400,6 +409,8 @@ static param_export_t mod_params[] = {
 	{"raw_ipip_capture_on", PARAM_INT, &ipip_capture_on},
 	{"raw_moni_capture_on", PARAM_INT, &moni_capture_on},
 	{"db_insert_mode", PARAM_INT, &db_insert_mode},
+	{"db_bulk_rows", PARAM_INT, &db_bulk_rows},
+	{"db_bulk_flush_time", PARAM_INT, &db_bulk_flush_time},
 	{"raw_interface", PARAM_STR, &raw_interface},
 	{"promiscuous_on", PARAM_INT, &promisc_on},
 	{"raw_moni_bpf_on", PARAM_INT, &bpf_on},
@@ -818,6 +829,20 @@ static int mod_init(void)
 		return -1;
 	}
 
+	if(db_bulk_rows > 0) {
+		if(db_bulk_rows > SC_BULK_MAX_ROWS) {
+			LM_WARN("db_bulk_rows too large - using %d\n", SC_BULK_MAX_ROWS);
+			db_bulk_rows = SC_BULK_MAX_ROWS;
+		}
+		if(db_bulk_flush_time <= 0) {
+			db_bulk_flush_time = 1;
+		}
+		if(sc_bulk_init() < 0) {
+			LM_ERR("failed to initialize bulk insert buffer\n");
+			return -1;
+		}
+	}
+
 	if(sc_topoh_unmask == 1) {
 		/* bind the topoh API */
 		if(topoh_load_api(&thb) != 0) {
@@ -1458,6 +1483,8 @@ static void destroy(void)
 	_capture_mode_data_t *c;
 	_capture_mode_data_t *c0;
 
+	sc_bulk_destroy();
+
 	c = capture_modes_root;
 
 	while(c) {
@@ -1523,6 +1550,222 @@ static int sip_capture_prepare(sip_msg_t *msg)
 	return 0;
 }
 
+typedef struct _sc_bulk_row
+{
+	str table;
+	_capture_mode_data_t *cm;
+	db_val_t vals[NR_KEYS];
+	char *data;
+} sc_bulk_row_t;
+
+/* per-process buffer with captured rows waiting for a batched insert */
+static sc_bulk_row_t *_sc_bulk_rows = NULL;
+static int _sc_bulk_count = 0;
+static time_t _sc_bulk_first = 0;
+static db_key_t _sc_bulk_keys[NR_KEYS];
+static int _sc_bulk_keys_ready = 0;
+
+typedef struct _sc_bulk_stats
+{
+	gen_lock_t lock;
+	unsigned int queued;
+	unsigned int flushed;
+	unsigned int flushes;
+	unsigned int errors;
+	unsigned long long flush_time_us;
+	int depth;
+} sc_bulk_stats_t;
+
+static sc_bulk_stats_t *_sc_bulk_stats = NULL;
+
+/**
+ *
+ */
+static int sc_bulk_init(void)
+{
+	_sc_bulk_stats = (sc_bulk_stats_t *)shm_malloc(sizeof(sc_bulk_stats_t));
+	if(_sc_bulk_stats == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_sc_bulk_stats, 0, sizeof(sc_bulk_stats_t));
+	if(lock_init(&_sc_bulk_stats->lock) == NULL) {
+		LM_ERR("cannot initialize bulk stats lock\n");
+		shm_free(_sc_bulk_stats);
+		_sc_bulk_stats = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ *
+ */
+static void sc_bulk_destroy(void)
+{
+	if(_sc_bulk_stats == NULL) {
+		return;
+	}
+	lock_destroy(&_sc_bulk_stats->lock);
+	shm_free(_sc_bulk_stats);
+	_sc_bulk_stats = NULL;
+}
+
+/**
+ * insert the buffered rows, grouping consecutive rows by connection and
+ * flushing each group through the db batch api when the driver has it
+ */
+static int sc_bulk_flush(void)
+{
+	struct timeval tvs;
+	struct timeval tve;
+	_capture_mode_data_t *c;
+	unsigned int errors = 0;
+	unsigned long long dus;
+	int batched;
+	int ret = 0;
+	int i;
+	int j;
+
+	if(_sc_bulk_count == 0) {
+		return 0;
+	}
+	gettimeofday(&tvs, NULL);
+
+	i = 0;
+	while(i < _sc_bulk_count) {
+		c = _sc_bulk_rows[i].cm;
+		batched = 0;
+		if(c->db_funcs.batch_start != NULL
+				&& c->db_funcs.batch_start(c->db_con) == 0) {
+			batched = 1;
+		}
+		for(j = i; j < _sc_bulk_count && _sc_bulk_rows[j].cm == c; j++) {
+			c->db_funcs.use_table(c->db_con, &_sc_bulk_rows[j].table);
+			if(c->db_funcs.insert(
+					   c->db_con, _sc_bulk_keys, _sc_bulk_rows[j].vals, NR_KEYS)
+					< 0) {
+				errors++;
+				ret = -1;
+			}
+		}
+		if(batched && c->db_funcs.batch_end(c->db_con) < 0) {
+			LM_ERR("failed to flush insert batch\n");
+			errors++;
+			ret = -1;
+		}
+		i = j;
+	}
+
+	gettimeofday(&tve, NULL);
+	dus = (unsigned long long)(tve.tv_sec - tvs.tv_sec) * 1000000
+		  + (tve.tv_usec - tvs.tv_usec);
+
+	for(i = 0; i < _sc_bulk_count; i++) {
+		pkg_free(_sc_bulk_rows[i].data);
+		_sc_bulk_rows[i].data = NULL;
+	}
+
+	lock_get(&_sc_bulk_stats->lock);
+	_sc_bulk_stats->flushed += _sc_bulk_count;
+	_sc_bulk_stats->flushes++;
+	_sc_bulk_stats->errors += errors;
+	_sc_bulk_stats->flush_time_us += dus;
+	_sc_bulk_stats->depth -= _sc_bulk_count;
+	lock_release(&_sc_bulk_stats->lock);
+
+	_sc_bulk_count = 0;
+	_sc_bulk_first = 0;
+
+	if(ret < 0) {
+		LM_ERR("failed to insert %u of the batched rows\n", errors);
+	}
+	return ret;
+}
+
+/**
+ * copy the row into the per-process buffer and flush when the buffer is
+ * full or the oldest row waited longer than db_bulk_flush_time
+ */
+static int sc_bulk_store(_capture_mode_data_t *c, str *table, db_key_t *keys,
+		db_val_t *vals, time_t tnow)
+{
+	sc_bulk_row_t *row;
+	char *dp;
+	int dlen;
+	int i;
+
+	if(_sc_bulk_rows == NULL) {
+		_sc_bulk_rows = (sc_bulk_row_t *)pkg_malloc(
+				db_bulk_rows * sizeof(sc_bulk_row_t));
+		if(_sc_bulk_rows == NULL) {
+			PKG_MEM_ERROR;
+			return -1;
+		}
+		memset(_sc_bulk_rows, 0, db_bulk_rows * sizeof(sc_bulk_row_t));
+	}
+	if(!_sc_bulk_keys_ready) {
+		memcpy(_sc_bulk_keys, keys, NR_KEYS * sizeof(db_key_t));
+		_sc_bulk_keys_ready = 1;
+	}
+
+	dlen = table->len + 1;
+	for(i = 0; i < NR_KEYS; i++) {
+		if(vals[i].type == DB1_STR) {
+			dlen += vals[i].val.str_val.len;
+		} else if(vals[i].type == DB1_BLOB) {
+			dlen += vals[i].val.blob_val.len;
+		}
+	}
+
+	row = &_sc_bulk_rows[_sc_bulk_count];
+	row->data = (char *)pkg_malloc(dlen);
+	if(row->data == NULL) {
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	row->cm = c;
+	memcpy(row->vals, vals, NR_KEYS * sizeof(db_val_t));
+
+	dp = row->data;
+	memcpy(dp, table->s, table->len);
+	dp[table->len] = '\0';
+	row->table.s = dp;
+	row->table.len = table->len;
+	dp += table->len + 1;
+	for(i = 0; i < NR_KEYS; i++) {
+		if(vals[i].type == DB1_STR) {
+			if(vals[i].val.str_val.len > 0) {
+				memcpy(dp, vals[i].val.str_val.s, vals[i].val.str_val.len);
+			}
+			row->vals[i].val.str_val.s = dp;
+			dp += vals[i].val.str_val.len;
+		} else if(vals[i].type == DB1_BLOB) {
+			if(vals[i].val.blob_val.len > 0) {
+				memcpy(dp, vals[i].val.blob_val.s, vals[i].val.blob_val.len);
+			}
+			row->vals[i].val.blob_val.s = dp;
+			dp += vals[i].val.blob_val.len;
+		}
+	}
+
+	if(_sc_bulk_count == 0) {
+		_sc_bulk_first = tnow;
+	}
+	_sc_bulk_count++;
+
+	lock_get(&_sc_bulk_stats->lock);
+	_sc_bulk_stats->queued++;
+	_sc_bulk_stats->depth++;
+	lock_release(&_sc_bulk_stats->lock);
+
+	if(_sc_bulk_count >= db_bulk_rows
+			|| tnow - _sc_bulk_first >= db_bulk_flush_time) {
+		return sc_bulk_flush();
+	}
+	return 0;
+}
+
 static int sip_capture_store(struct _sipcapture_object *sco, str *dtable,
 		_capture_mode_data_t *cm_data)
 {
@@ -1826,6 +2069,16 @@ static int sip_capture_store(struct _sipcapture_object *sco, str *dtable,
 
 	table = &ntab;
 
+	if(db_bulk_rows > 0) {
+		if(sc_bulk_store(c, table, db_keys, db_vals, time(NULL)) < 0) {
+			goto error;
+		}
+#ifdef STATISTICS
+		update_stat(sco->stat, 1);
+#endif
+		return 1;
+	}
+
 	/* check dynamic table */
 	LM_DBG("insert into homer table [1]: [%.*s]\n", table->len, table->s);
 	c->db_funcs.use_table(c->db_con, table);
@@ -2613,8 +2866,54 @@ static void sipcapture_rpc_status(rpc_t *rpc, void *c)
 static const char *sipcapture_status_doc[2] = {
 		"Get status or turn on/off sipcapture.", 0};
 
+/**
+ *
+ */
+static void sipcapture_rpc_bulk_stats(rpc_t *rpc, void *c)
+{
+	void *th;
+	unsigned int queued;
+	unsigned int flushed;
+	unsigned int flushes;
+	unsigned int errors;
+	unsigned long long flush_time_us;
+	int depth;
+
+	if(_sc_bulk_stats == NULL) {
+		rpc->fault(c, 500, "Bulk insert mode not enabled (db_bulk_rows)");
+		return;
+	}
+
+	lock_get(&_sc_bulk_stats->lock);
+	queued = _sc_bulk_stats->queued;
+	flushed = _sc_bulk_stats->flushed;
+	flushes = _sc_bulk_stats->flushes;
+	errors = _sc_bulk_stats->errors;
+	flush_time_us = _sc_bulk_stats->flush_time_us;
+	depth = _sc_bulk_stats->depth;
+	lock_release(&_sc_bulk_stats->lock);
+
+	if(rpc->add(c, "{", &th) < 0) {
+		rpc->fault(c, 500, "Internal error creating rpc");
+		return;
+	}
+	if(rpc->struct_add(th, "dddddd", "queued", (int)queued, "flushed",
+			   (int)flushed, "flushes", (int)flushes, "errors", (int)errors,
+			   "depth", depth, "avg_flush_time_us",
+			   (flushes > 0) ? (int)(flush_time_us / flushes) : 0)
+			< 0) {
+		rpc->fault(c, 500, "Internal error creating rpc data");
+		return;
+	}
+}
+
+static const char *sipcapture_bulk_stats_doc[2] = {
+		"Get the counters of the bulk insert buffers.", 0};
+
 rpc_export_t sipcapture_rpc[] = {
 		{"sipcapture.status", sipcapture_rpc_status, sipcapture_status_doc, 0},
+		{"sipcapture.bulk_stats", sipcapture_rpc_bulk_stats,
+				sipcapture_bulk_stats_doc, 0},
 		{0, 0, 0, 0}};
 
 static int sipcapture_init_rpc(void)
@@ -262,5 +262,5 @@ void sipdump_write_pcap(FILE *fs, sipdump_data_t *spd)
 	if(fwrite(data.s, data.len, 1, fs) != 1) {
 		LM_ERR("writing UDP payload to pcap failed: %s\n", strerror(errno));
 	}
-	fflush(fs);
+	/* no fflush() here - the writer flushes when its queue is drained */
 }
@@ -49,6 +49,13 @@ static str _sipdump_fpath_prefix = {0, 0};
 static FILE *_sipdump_text_file = NULL;
 static FILE *_sipdump_pcap_file = NULL;
 
+/* stdio buffers for the dump files - only the writer process touches
+ * them; data is flushed when the queue is drained or on rotation,
+ * instead of after every message */
+#define SIPDUMP_IOBUF_SIZE 262144
+static char _sipdump_text_iobuf[SIPDUMP_IOBUF_SIZE];
+static char _sipdump_pcap_iobuf[SIPDUMP_IOBUF_SIZE];
+
 /**
  *
  */
@@ -251,6 +258,8 @@ static int sipdump_rotate_file(void)
 			LM_ERR("failed to open file %s\n", _sipdump_fpath);
 			return -1;
 		}
+		setvbuf(_sipdump_text_file, _sipdump_text_iobuf, _IOFBF,
+				SIPDUMP_IOBUF_SIZE);
 	}
 	if(sipdump_mode & SIPDUMP_MODE_WPCAP) {
 		n = snprintf(_sipdump_fpath + _sipdump_fpath_prefix.len,
@@ -263,6 +272,8 @@ static int sipdump_rotate_file(void)
 			LM_ERR("failed to open file %s\n", _sipdump_fpath);
 			return -1;
 		}
+		setvbuf(_sipdump_pcap_file, _sipdump_pcap_iobuf, _IOFBF,
+				SIPDUMP_IOBUF_SIZE);
 		sipdump_init_pcap(_sipdump_pcap_file);
 	}
 
@@ -357,6 +368,8 @@ void sipdump_timer_exec(unsigned int ticks, void *param)
 			lock_release(&_sipdump_list->lock);
 			if(_sipdump_text_file)
 				fflush(_sipdump_text_file);
+			if(_sipdump_pcap_file)
+				fflush(_sipdump_pcap_file);
 			return;
 		}
 		sdd = _sipdump_list->first;
@@ -383,7 +396,6 @@ void sipdump_timer_exec(unsigned int ticks, void *param)
 			/* LM_NOTICE("writing: [[%.*s]] (%d)\n", odata.len,
 					odata.s, odata.len); */
 			fwrite(odata.s, odata.len, 1, _sipdump_text_file);
-			fflush(_sipdump_text_file);
 		}
 		if(sipdump_mode & SIPDUMP_MODE_WPCAP) {
 			if(_sipdump_pcap_file == NULL) {
@@ -54,6 +54,9 @@
 #include "../../modules/dialog/dlg_load.h"
 #include "../../core/str.h"
 #include "../../core/onsend.h"
+#include "../../core/hashes.h"
+#include "../../core/pt.h"
+#include "../../core/cfg/cfg_struct.h"
 #include "../../core/events.h"
 #include "../../core/srapi.h"
 #include "../../core/kemi.h"
@@ -168,6 +171,8 @@ int trace_flag = 0;
 int trace_on = 0;
 int *trace_on_flag = NULL;
 
+int trace_sample_rate = 1;
+
 int trace_sl_acks = 1;
 
 int trace_to_database = 1;
@@ -179,6 +184,8 @@ int hep_version = 1;
 int hep_capture_id = 1;
 int hep_vendor_id = 0;
 str hep_auth_key_str = {0, 0};
+int hep_async_workers = 0;
+int hep_async_queue_size = 1024;
 
 int trace_xheaders_write = 0;
 int trace_xheaders_read = 0;
@@ -261,6 +268,7 @@ static param_export_t params[] = {
 	{"direction_column", PARAM_STR, &direction_column},
 	{"trace_flag", PARAM_INT, &trace_flag_param},
 	{"trace_on", PARAM_INT, &trace_on},
+	{"trace_sample_rate", PARAM_INT, &trace_sample_rate},
 	{"traced_user_avp", PARAM_STR, &traced_user_avp_str},
 	{"trace_table_avp", PARAM_STR, &trace_table_avp_str},
 	{"duplicate_uri", PARAM_STR, &trace_dup_uri_str},
@@ -275,6 +283,8 @@ static param_export_t params[] = {
 	{"send_sock_name", PARAM_STR, &trace_send_sock_name_str},
 	{"hep_version", PARAM_INT, &hep_version},
 	{"hep_capture_id", PARAM_INT, &hep_capture_id},
+	{"hep_async_workers", PARAM_INT, &hep_async_workers},
+	{"hep_async_queue_size", PARAM_INT, &hep_async_queue_size},
 	{"trace_delayed", PARAM_INT, &trace_db_delayed},
 	{"trace_db_mode", PARAM_INT, &trace_db_mode},
 	{"trace_init_mode", PARAM_INT, &_siptrace_init_mode},
@@ -354,6 +364,23 @@ static int mod_init(void)
 		return -1;
 	}
 
+	if(hep_async_workers > 0) {
+		if(siptrace_hep_queue_init() < 0) {
+			LM_ERR("failed to initialize hep send queue\n");
+			return -1;
+		}
+		register_procs(hep_async_workers);
+		/* add children to update local config framework structures */
+		cfg_register_child(hep_async_workers);
+	}
+
+	if(trace_sample_rate < 1) {
+		LM_WARN("invalid trace_sample_rate %d - resetting to 1 (no"
+				" sampling)\n",
+				trace_sample_rate);
+		trace_sample_rate = 1;
+	}
+
 	trace_on_flag = (int *)shm_malloc(sizeof(int));
 	if(trace_on_flag == NULL) {
 		LM_ERR("no more shm memory left\n");
@@ -528,6 +555,24 @@ static int mod_init(void)
 
 static int child_init(int rank)
 {
+	int pid;
+	int i;
+
+	if(rank == PROC_MAIN && hep_async_workers > 0) {
+		for(i = 0; i < hep_async_workers; i++) {
+			pid = fork_process(PROC_NOCHLDINIT, "SIPTRACE HEP Sender", 1);
+			if(pid < 0)
+				return -1; /* error */
+			if(pid == 0) {
+				/* child - initialize the config framework */
+				if(cfg_child_init())
+					return -1;
+				siptrace_hep_queue_worker_loop(i);
+				return 0;
+			}
+		}
+	}
+
 	if(rank == PROC_INIT || rank == PROC_MAIN || rank == PROC_TCP_MAIN)
 		return 0; /* do nothing for the main process */
 
@@ -556,6 +601,7 @@ static int child_init(int rank)
 
 static void destroy(void)
 {
+	siptrace_hep_queue_destroy();
 	if(trace_on_flag) {
 		shm_free(trace_on_flag);
 	}
@@ -580,6 +626,24 @@ static inline str *siptrace_get_table(void)
 	return &avp_value.s;
 }
 
+/**
+ * decide if a message is selected by 1:N sampling - the decision is
+ * taken on the hash of the call-id, so all messages of a call share it
+ */
+static int siptrace_sample_filter(str *callid)
+{
+	unsigned int hashv;
+
+	if(trace_sample_rate <= 1) {
+		return 1;
+	}
+	if(callid == NULL || callid->s == NULL || callid->len <= 0) {
+		return 1;
+	}
+	hashv = core_case_hash(callid, 0, 0);
+	return ((hashv % (unsigned int)trace_sample_rate) == 0) ? 1 : 0;
+}
+
 static int sip_trace_store(
 		siptrace_data_t *sto, dest_info_t *dst, str *correlation_id_str)
 {
@@ -590,6 +654,12 @@ static int sip_trace_store(
 		return -1;
 	}
 
+	/* calls flagged via the traced user avp bypass the sampling */
+	if(sto->avp == NULL && siptrace_sample_filter(&sto->callid) == 0) {
+		LM_DBG("message not selected by sampling\n");
+		return 1;
+	}
+
 	gettimeofday(&sto->tv, NULL);
 
 	if(sip_trace_xheaders_read(sto) != 0)
@@ -2392,6 +2462,12 @@ int siptrace_net_data_recv(sr_event_param_t *evp)
 			goto afterdb;
 		}
 
+		if(siptrace_sample_filter(&sto.callid) == 0) {
+			LM_DBG("message not selected by sampling\n");
+			free_sip_msg(&tmsg);
+			goto afterdb;
+		}
+
 		if(tmsg.first_line.type == SIP_REPLY) {
 			sto.status = tmsg.first_line.u.reply.status;
 		} else {
@@ -2539,6 +2615,12 @@ int siptrace_net_data_sent(sr_event_param_t *evp)
 			goto afterdb;
 		}
 
+		if(siptrace_sample_filter(&sto.callid) == 0) {
+			LM_DBG("message not selected by sampling\n");
+			free_sip_msg(&tmsg);
+			goto afterdb;
+		}
+
 		if(tmsg.first_line.type == SIP_REPLY) {
 			sto.status = tmsg.first_line.u.reply.status;
 		} else {
@@ -2647,8 +2729,43 @@ static void siptrace_rpc_status(rpc_t *rpc, void *c)
 static const char *siptrace_status_doc[2] = {
 		"Get status or turn on/off siptrace. Parameters: on, off or check.", 0};
 
+/**
+ *
+ */
+static void siptrace_rpc_hep_stats(rpc_t *rpc, void *c)
+{
+	void *th;
+	unsigned int queued;
+	unsigned int sent;
+	unsigned int dropped;
+	unsigned int errors;
+
+	if(hep_async_workers <= 0) {
+		rpc->fault(c, 500, "Async hep sending not enabled (hep_async_workers)");
+		return;
+	}
+
+	siptrace_hep_queue_stats(&queued, &sent, &dropped, &errors);
+
+	if(rpc->add(c, "{", &th) < 0) {
+		rpc->fault(c, 500, "Internal error creating rpc");
+		return;
+	}
+	if(rpc->struct_add(th, "dddd", "queued", (int)queued, "sent", (int)sent,
+			   "dropped", (int)dropped, "errors", (int)errors)
+			< 0) {
+		rpc->fault(c, 500, "Internal error creating rpc data");
+		return;
+	}
+}
+
+static const char *siptrace_hep_stats_doc[2] = {
+		"Get the counters of the async hep send queue.", 0};
+
 rpc_export_t siptrace_rpc[] = {
 		{"siptrace.status", siptrace_rpc_status, siptrace_status_doc, 0},
+		{"siptrace.hep_stats", siptrace_rpc_hep_stats, siptrace_hep_stats_doc,
+				0},
 		{0, 0, 0, 0}};
 
 static int siptrace_init_rpc(void)
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "../../core/dprint.h"
 #include "../../core/pvar.h"
@@ -33,6 +34,8 @@
 #include "../../core/forward.h"
 #include "../../core/resolve.h"
 #include "../../core/socket_info.h"
+#include "../../core/locking.h"
+#include "../../core/mem/shm_mem.h"
 #include "../../core/parser/parse_uri.h"
 
 #include "../../modules/sipcapture/hep.h"
@@ -49,6 +52,212 @@ extern str trace_send_sock_name_str;
 extern socket_info_t *trace_send_sock_info;
 extern str trace_dup_uri_str;
 extern sip_uri_t *trace_dup_uri;
+extern int hep_async_workers;
+extern int hep_async_queue_size;
+
+/* number of packets sent by a queue worker in one drain round */
+#define SIPTRACE_HEP_QUEUE_BATCH 32
+/* sleep time for a queue worker with nothing to send (microseconds) */
+#define SIPTRACE_HEP_QUEUE_IDLE_USLEEP 2000
+
+typedef struct siptrace_hep_qitem
+{
+	struct dest_info dst;
+	char *buf;
+	int len;
+} siptrace_hep_qitem_t;
+
+typedef struct siptrace_hep_queue
+{
+	gen_lock_t lock;
+	int size;
+	int head;
+	int count;
+	unsigned int queued;
+	unsigned int sent;
+	unsigned int dropped;
+	unsigned int errors;
+	siptrace_hep_qitem_t *items;
+} siptrace_hep_queue_t;
+
+static siptrace_hep_queue_t *_siptrace_hep_queue = NULL;
+
+/**
+ * initialize the shm queue drained by the hep sender processes
+ */
+int siptrace_hep_queue_init(void)
+{
+	if(hep_async_workers <= 0) {
+		return 0;
+	}
+	if(hep_async_queue_size <= 0) {
+		LM_ERR("invalid hep async queue size: %d\n", hep_async_queue_size);
+		return -1;
+	}
+	_siptrace_hep_queue = (siptrace_hep_queue_t *)shm_malloc(
+			sizeof(siptrace_hep_queue_t)
+			+ hep_async_queue_size * sizeof(siptrace_hep_qitem_t));
+	if(_siptrace_hep_queue == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_siptrace_hep_queue, 0,
+			sizeof(siptrace_hep_queue_t)
+					+ hep_async_queue_size * sizeof(siptrace_hep_qitem_t));
+	if(lock_init(&_siptrace_hep_queue->lock) == NULL) {
+		LM_ERR("cannot initialize the hep queue lock\n");
+		shm_free(_siptrace_hep_queue);
+		_siptrace_hep_queue = NULL;
+		return -1;
+	}
+	_siptrace_hep_queue->size = hep_async_queue_size;
+	_siptrace_hep_queue->items =
+			(siptrace_hep_qitem_t *)(_siptrace_hep_queue + 1);
+	return 0;
+}
+
+/**
+ *
+ */
+void siptrace_hep_queue_destroy(void)
+{
+	int i;
+	siptrace_hep_qitem_t *qi;
+
+	if(_siptrace_hep_queue == NULL) {
+		return;
+	}
+	for(i = 0; i < _siptrace_hep_queue->count; i++) {
+		qi = &_siptrace_hep_queue->items[(_siptrace_hep_queue->head + i)
+										 % _siptrace_hep_queue->size];
+		if(qi->buf != NULL) {
+			shm_free(qi->buf);
+		}
+	}
+	lock_destroy(&_siptrace_hep_queue->lock);
+	shm_free(_siptrace_hep_queue);
+	_siptrace_hep_queue = NULL;
+}
+
+/**
+ *
+ */
+void siptrace_hep_queue_stats(unsigned int *queued, unsigned int *sent,
+		unsigned int *dropped, unsigned int *errors)
+{
+	*queued = 0;
+	*sent = 0;
+	*dropped = 0;
+	*errors = 0;
+	if(_siptrace_hep_queue == NULL) {
+		return;
+	}
+	lock_get(&_siptrace_hep_queue->lock);
+	*queued = _siptrace_hep_queue->queued;
+	*sent = _siptrace_hep_queue->sent;
+	*dropped = _siptrace_hep_queue->dropped;
+	*errors = _siptrace_hep_queue->errors;
+	lock_release(&_siptrace_hep_queue->lock);
+}
+
+/**
+ * hand the packed hep message over to the sender processes; when the
+ * queue is not enabled, send it from here as before; when the queue is
+ * full, drop the packet and count it - tracing must not block the
+ * sip worker
+ */
+int siptrace_hep_queue_send(struct dest_info *dst, void *buf, int len)
+{
+	char *qbuf;
+	siptrace_hep_qitem_t *qi;
+	unsigned int dropped;
+
+	if(_siptrace_hep_queue == NULL) {
+		return msg_send_buffer(dst, (char *)buf, len, 1);
+	}
+
+	qbuf = (char *)shm_malloc(len);
+	if(qbuf == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memcpy(qbuf, buf, len);
+
+	lock_get(&_siptrace_hep_queue->lock);
+	if(_siptrace_hep_queue->count >= _siptrace_hep_queue->size) {
+		dropped = ++_siptrace_hep_queue->dropped;
+		lock_release(&_siptrace_hep_queue->lock);
+		shm_free(qbuf);
+		if(dropped == 1 || (dropped % 1000) == 0) {
+			LM_WARN("hep send queue full - %u packets dropped so far\n",
+					dropped);
+		}
+		return 0;
+	}
+	qi = &_siptrace_hep_queue
+				  ->items[(_siptrace_hep_queue->head
+								  + _siptrace_hep_queue->count)
+						  % _siptrace_hep_queue->size];
+	qi->dst = *dst;
+	qi->buf = qbuf;
+	qi->len = len;
+	_siptrace_hep_queue->count++;
+	_siptrace_hep_queue->queued++;
+	lock_release(&_siptrace_hep_queue->lock);
+
+	return 0;
+}
+
+/**
+ * main loop of a hep sender process - drain the queue in batches,
+ * sleep shortly when there is nothing to send
+ */
+void siptrace_hep_queue_worker_loop(int widx)
+{
+	siptrace_hep_qitem_t batch[SIPTRACE_HEP_QUEUE_BATCH];
+	int n;
+	int i;
+	unsigned int sent;
+	unsigned int errors;
+
+	LM_DBG("hep sender process %d started\n", widx);
+	for(;;) {
+		lock_get(&_siptrace_hep_queue->lock);
+		n = (_siptrace_hep_queue->count < SIPTRACE_HEP_QUEUE_BATCH)
+					? _siptrace_hep_queue->count
+					: SIPTRACE_HEP_QUEUE_BATCH;
+		for(i = 0; i < n; i++) {
+			batch[i] = _siptrace_hep_queue->items[(_siptrace_hep_queue->head + i)
+												  % _siptrace_hep_queue->size];
+		}
+		_siptrace_hep_queue->head =
+				(_siptrace_hep_queue->head + n) % _siptrace_hep_queue->size;
+		_siptrace_hep_queue->count -= n;
+		lock_release(&_siptrace_hep_queue->lock);
+
+		if(n == 0) {
+			usleep(SIPTRACE_HEP_QUEUE_IDLE_USLEEP);
+			continue;
+		}
+
+		sent = 0;
+		errors = 0;
+		for(i = 0; i < n; i++) {
+			if(msg_send_buffer(&batch[i].dst, batch[i].buf, batch[i].len, 1)
+					< 0) {
+				LM_ERR("failed to send hep packet from queue\n");
+				errors++;
+			} else {
+				sent++;
+			}
+			shm_free(batch[i].buf);
+		}
+		lock_get(&_siptrace_hep_queue->lock);
+		_siptrace_hep_queue->sent += sent;
+		_siptrace_hep_queue->errors += errors;
+		lock_release(&_siptrace_hep_queue->lock);
+	}
+}
 
 /**
  *
@@ -227,7 +436,7 @@ int trace_send_hep3_duplicate(str *body, str *from, str *to,
 		}
 	}
 
-	if(msg_send_buffer(dst_fin, buffer, len, 1) < 0) {
+	if(siptrace_hep_queue_send(dst_fin, buffer, len) < 0) {
 		LM_ERR("cannot send hep duplicate message\n");
 		goto error;
 	}
@@ -435,7 +644,7 @@ int trace_send_hep2_duplicate(
 	memcpy((void *)(buffer + buflen), (void *)body->s, body->len);
 	buflen += body->len;
 
-	if(msg_send_buffer(dst_fin, buffer, buflen, 1) < 0) {
+	if(siptrace_hep_queue_send(dst_fin, buffer, buflen) < 0) {
 		LM_ERR("cannot send hep duplicate message\n");
 		goto error;
 	}
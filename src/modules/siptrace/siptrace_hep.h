@@ -28,6 +28,13 @@
 
 #include "../../core/ip_addr.h"
 
+int siptrace_hep_queue_init(void);
+void siptrace_hep_queue_destroy(void);
+int siptrace_hep_queue_send(struct dest_info *dst, void *buf, int len);
+void siptrace_hep_queue_worker_loop(int widx);
+void siptrace_hep_queue_stats(unsigned int *queued, unsigned int *sent,
+		unsigned int *dropped, unsigned int *errors);
+
 int trace_send_hep_duplicate(
 		str *body, str *from, str *to, struct dest_info *, str *correlation_id);
 int trace_send_hep2_duplicate(
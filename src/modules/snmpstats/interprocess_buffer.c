@@ -69,6 +69,15 @@ interprocessBuffer_t *endRegUserTableBuffer = NULL;
  * the buffer while it is being consumed */
 gen_lock_t *interprocessCBLock = NULL;
 
+/*! Minimum number of seconds between two consumptions of the buffer (the
+ * snmp_cache_refresh_interval modparam).  With 0 the buffer is consumed on
+ * every request, as before. */
+int snmpCacheRefreshInterval = 0;
+
+/*! Time of the last buffer consumption - only read/written by the AgentX
+ * sub-agent process. */
+static time_t lastConsumptionTime = 0;
+
 /*!
  * This function takes an element of the interprocess buffer passed to it, and
  * handles populating the respective user and contact tables with its contained
@@ -215,12 +224,28 @@ void consumeInterprocessBuffer(void)
 {
 	interprocessBuffer_t *previousBuffer;
 	interprocessBuffer_t *currentBuffer;
+	time_t timeNow;
 
 	/* There is nothing to consume, so just exit. */
 	if(frontRegUserTableBuffer->next == NULL) {
 		return;
 	}
 
+	/* On busy registrars the buffer is practically never empty, so a table
+	 * walk would otherwise refresh the tables for every OID it retrieves:
+	 * each request takes the interprocess lock (contending with the usrloc
+	 * callbacks of the SIP workers) and the rows change while the walk is
+	 * in progress.  With a refresh interval configured, the tables act as a
+	 * read-only cache between refreshes. */
+	if(snmpCacheRefreshInterval > 0) {
+		timeNow = time(NULL);
+		if(lastConsumptionTime != 0
+				&& lastConsumptionTime + snmpCacheRefreshInterval > timeNow) {
+			return;
+		}
+		lastConsumptionTime = timeNow;
+	}
+
 	/* We are going to consume the entire buffer, but we don't want the
 	 * buffer to change midway through.  So assign the front of the buffer
 	 * to NULL so that any other callbacks from the usrloc module will be
@@ -81,6 +81,11 @@ extern interprocessBuffer_t *endRegUserTableBuffer;
 extern gen_lock_t *interprocessCBLock;
 extern hashSlot_t *hashTable;
 
+/* Minimum number of seconds between two consumptions of the buffer, set
+ * with the snmp_cache_refresh_interval modparam (0 - consume on every
+ * request). */
+extern int snmpCacheRefreshInterval;
+
 /*
  * Initialize shared memory used to buffer communication between the usrloc
  * module and the SNMPStats module.  (Specifically, the user and contact tables)
@@ -144,6 +144,7 @@ static param_export_t mod_params[] = {
 	{"snmpCommunity", PARAM_STRING | PARAM_USE_FUNC, (void *)set_snmp_community},
 	{"snmpVersion", PARAM_STRING | PARAM_USE_FUNC, (void *)set_snmp_version},
 	{"export_registrar", PARAM_INT, &snmp_export_registrar},
+	{"snmp_cache_refresh_interval", PARAM_INT, &snmpCacheRefreshInterval},
 	{0, 0, 0}
 };
 
@@ -26,9 +26,13 @@
  */
 
 
+#include <time.h>
+
 #include "../../core/mem/mem.h"
+#include "../../core/mem/shm_mem.h"
 #include "../../core/dprint.h"
 #include "../../core/hashes.h"
+#include "../../core/locking.h"
 #include "../../core/ut.h"
 #include "../../lib/srdb1/db_ut.h"
 #include "../../core/xavp.h"
@@ -37,10 +41,39 @@
 
 extern int sqlops_results_maxsize;
 extern int sqlops_log_buf_size;
+extern int sqlops_cache_size;
 
 sql_con_t *_sql_con_root = NULL;
 sql_result_t *_sql_result_root = NULL;
 
+/**
+ * cached result of a query - the query text, the column names and the
+ * values are cloned in shm so any worker can serve a hit
+ */
+typedef struct _sql_cache_entry
+{
+	unsigned int hashid;
+	str query;
+	time_t expires;
+	int nrows;
+	int ncols;
+	str *cols;
+	sql_val_t *vals; /* nrows * ncols array */
+	struct _sql_cache_entry *next;
+} sql_cache_entry_t;
+
+typedef struct _sql_cache
+{
+	gen_lock_t lock;
+	int size; /* number of hash slots */
+	int nrent;
+	unsigned int hits;
+	unsigned int misses;
+	sql_cache_entry_t **slots;
+} sql_cache_t;
+
+static sql_cache_t *_sql_cache = NULL;
+
 static char _sql_empty_buf[1];
 
 sql_con_t *sql_get_connection(str *name)
@@ -421,6 +454,372 @@ error:
 	return -1;
 }
 
+/**
+ * initialize the shm result cache - size is the cache_size modparam
+ */
+int sql_cache_init(void)
+{
+	if(_sql_cache != NULL)
+		return 0;
+	if(sqlops_cache_size <= 0)
+		return 0;
+
+	_sql_cache = (sql_cache_t *)shm_malloc(
+			sizeof(sql_cache_t) + sqlops_cache_size * sizeof(sql_cache_entry_t *));
+	if(_sql_cache == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_sql_cache, 0,
+			sizeof(sql_cache_t) + sqlops_cache_size * sizeof(sql_cache_entry_t *));
+	if(lock_init(&_sql_cache->lock) == NULL) {
+		LM_ERR("failed to initialize cache lock\n");
+		shm_free(_sql_cache);
+		_sql_cache = NULL;
+		return -1;
+	}
+	_sql_cache->size = sqlops_cache_size;
+	_sql_cache->slots = (sql_cache_entry_t **)(_sql_cache + 1);
+
+	return 0;
+}
+
+/**
+ *
+ */
+static void sql_cache_entry_free(sql_cache_entry_t *ep)
+{
+	int i, n;
+
+	if(ep->cols) {
+		for(i = 0; i < ep->ncols; i++) {
+			if(ep->cols[i].s != NULL)
+				shm_free(ep->cols[i].s);
+		}
+		shm_free(ep->cols);
+	}
+	if(ep->vals) {
+		n = ep->nrows * ep->ncols;
+		for(i = 0; i < n; i++) {
+			if((ep->vals[i].flags & PV_VAL_STR) && ep->vals[i].value.s.s != NULL)
+				shm_free(ep->vals[i].value.s.s);
+		}
+		shm_free(ep->vals);
+	}
+	shm_free(ep);
+}
+
+/**
+ * clone a pkg result container into a shm cache entry
+ */
+static sql_cache_entry_t *sql_cache_entry_new(
+		str *query, unsigned int hashid, sql_result_t *res, int ttl)
+{
+	sql_cache_entry_t *ep;
+	sql_val_t *cv;
+	int i, j;
+
+	ep = (sql_cache_entry_t *)shm_malloc(
+			sizeof(sql_cache_entry_t) + query->len);
+	if(ep == NULL) {
+		SHM_MEM_ERROR;
+		return NULL;
+	}
+	memset(ep, 0, sizeof(sql_cache_entry_t));
+	ep->query.s = (char *)(ep + 1);
+	memcpy(ep->query.s, query->s, query->len);
+	ep->query.len = query->len;
+	ep->hashid = hashid;
+	ep->expires = time(NULL) + ttl;
+
+	if(res == NULL || res->nrows <= 0 || res->ncols <= 0)
+		return ep;
+
+	ep->ncols = res->ncols;
+	ep->nrows = res->nrows;
+	ep->cols = (str *)shm_malloc(ep->ncols * sizeof(str));
+	if(ep->cols == NULL) {
+		SHM_MEM_ERROR;
+		goto error;
+	}
+	memset(ep->cols, 0, ep->ncols * sizeof(str));
+	for(i = 0; i < ep->ncols; i++) {
+		ep->cols[i].s =
+				(char *)shm_malloc((res->cols[i].name.len + 1) * sizeof(char));
+		if(ep->cols[i].s == NULL) {
+			SHM_MEM_ERROR;
+			goto error;
+		}
+		memcpy(ep->cols[i].s, res->cols[i].name.s, res->cols[i].name.len);
+		ep->cols[i].s[res->cols[i].name.len] = '\0';
+		ep->cols[i].len = res->cols[i].name.len;
+	}
+	ep->vals = (sql_val_t *)shm_malloc(
+			ep->nrows * ep->ncols * sizeof(sql_val_t));
+	if(ep->vals == NULL) {
+		SHM_MEM_ERROR;
+		goto error;
+	}
+	memset(ep->vals, 0, ep->nrows * ep->ncols * sizeof(sql_val_t));
+	for(i = 0; i < ep->nrows; i++) {
+		for(j = 0; j < ep->ncols; j++) {
+			cv = &ep->vals[i * ep->ncols + j];
+			cv->flags = res->vals[i][j].flags;
+			if(cv->flags & PV_VAL_NULL)
+				continue;
+			if(cv->flags & PV_VAL_STR) {
+				if(res->vals[i][j].value.s.len <= 0)
+					continue;
+				cv->value.s.s = (char *)shm_malloc(
+						(res->vals[i][j].value.s.len + 1) * sizeof(char));
+				if(cv->value.s.s == NULL) {
+					SHM_MEM_ERROR;
+					goto error;
+				}
+				memcpy(cv->value.s.s, res->vals[i][j].value.s.s,
+						res->vals[i][j].value.s.len);
+				cv->value.s.s[res->vals[i][j].value.s.len] = '\0';
+				cv->value.s.len = res->vals[i][j].value.s.len;
+			} else {
+				cv->value.n = res->vals[i][j].value.n;
+			}
+		}
+	}
+
+	return ep;
+
+error:
+	sql_cache_entry_free(ep);
+	return NULL;
+}
+
+/**
+ * fill a pkg result container from a shm cache entry
+ */
+static int sql_cache_entry_restore(sql_cache_entry_t *ep, sql_result_t *res)
+{
+	sql_val_t *cv;
+	int i, j;
+
+	sql_reset_result(res);
+
+	if(ep->nrows <= 0 || ep->ncols <= 0)
+		return 0;
+
+	res->ncols = ep->ncols;
+	res->nrows = ep->nrows;
+	res->cols = (sql_col_t *)pkg_malloc(res->ncols * sizeof(sql_col_t));
+	if(res->cols == NULL) {
+		PKG_MEM_ERROR;
+		goto error;
+	}
+	memset(res->cols, 0, res->ncols * sizeof(sql_col_t));
+	for(i = 0; i < res->ncols; i++) {
+		res->cols[i].name.len = ep->cols[i].len;
+		res->cols[i].name.s =
+				(char *)pkg_malloc((ep->cols[i].len + 1) * sizeof(char));
+		if(res->cols[i].name.s == NULL) {
+			PKG_MEM_ERROR;
+			goto error;
+		}
+		memcpy(res->cols[i].name.s, ep->cols[i].s, ep->cols[i].len);
+		res->cols[i].name.s[ep->cols[i].len] = '\0';
+		res->cols[i].colid = core_case_hash(&res->cols[i].name, 0, 0);
+	}
+	res->vals = (sql_val_t **)pkg_malloc(res->nrows * sizeof(sql_val_t *));
+	if(res->vals == NULL) {
+		PKG_MEM_ERROR;
+		goto error;
+	}
+	memset(res->vals, 0, res->nrows * sizeof(sql_val_t *));
+	for(i = 0; i < res->nrows; i++) {
+		res->vals[i] = (sql_val_t *)pkg_malloc(res->ncols * sizeof(sql_val_t));
+		if(res->vals[i] == NULL) {
+			PKG_MEM_ERROR;
+			goto error;
+		}
+		memset(res->vals[i], 0, res->ncols * sizeof(sql_val_t));
+		for(j = 0; j < res->ncols; j++) {
+			cv = &ep->vals[i * ep->ncols + j];
+			res->vals[i][j].flags = cv->flags;
+			if(cv->flags & PV_VAL_NULL)
+				continue;
+			if(cv->flags & PV_VAL_STR) {
+				if(cv->value.s.len <= 0) {
+					res->vals[i][j].value.s.s = _sql_empty_buf;
+					res->vals[i][j].value.s.len = 0;
+					continue;
+				}
+				res->vals[i][j].value.s.s =
+						(char *)pkg_malloc((cv->value.s.len + 1) * sizeof(char));
+				if(res->vals[i][j].value.s.s == NULL) {
+					PKG_MEM_ERROR;
+					goto error;
+				}
+				memcpy(res->vals[i][j].value.s.s, cv->value.s.s,
+						cv->value.s.len);
+				res->vals[i][j].value.s.s[cv->value.s.len] = '\0';
+				res->vals[i][j].value.s.len = cv->value.s.len;
+			} else {
+				res->vals[i][j].value.n = cv->value.n;
+			}
+		}
+	}
+
+	return 0;
+
+error:
+	sql_reset_result(res);
+	return -1;
+}
+
+/**
+ * remove cached results - all of them when query is NULL, otherwise only
+ * the entry for the given query text; returns the number of removed entries
+ */
+int sql_cache_flush(str *query)
+{
+	sql_cache_entry_t *ep, *ep0, **prev;
+	int i;
+	int n = 0;
+
+	if(_sql_cache == NULL)
+		return -1;
+
+	lock_get(&_sql_cache->lock);
+	for(i = 0; i < _sql_cache->size; i++) {
+		prev = &_sql_cache->slots[i];
+		ep = *prev;
+		while(ep) {
+			ep0 = ep->next;
+			if(query == NULL
+					|| (ep->query.len == query->len
+							&& memcmp(ep->query.s, query->s, query->len)
+									   == 0)) {
+				*prev = ep0;
+				sql_cache_entry_free(ep);
+				_sql_cache->nrent--;
+				n++;
+			} else {
+				prev = &ep->next;
+			}
+			ep = ep0;
+		}
+	}
+	lock_release(&_sql_cache->lock);
+
+	return n;
+}
+
+/**
+ *
+ */
+int sql_cache_stats(unsigned int *hits, unsigned int *misses, int *entries)
+{
+	if(_sql_cache == NULL)
+		return -1;
+
+	lock_get(&_sql_cache->lock);
+	*hits = _sql_cache->hits;
+	*misses = _sql_cache->misses;
+	*entries = _sql_cache->nrent;
+	lock_release(&_sql_cache->lock);
+
+	return 0;
+}
+
+/**
+ *
+ */
+void sql_cache_destroy(void)
+{
+	if(_sql_cache == NULL)
+		return;
+	sql_cache_flush(NULL);
+	lock_destroy(&_sql_cache->lock);
+	shm_free(_sql_cache);
+	_sql_cache = NULL;
+}
+
+/**
+ * execute the query via the shm result cache - on a hit the result
+ * container is filled from the cached copy without a DB round-trip,
+ * on a miss the query is executed and its result cached for ttl seconds
+ */
+int sql_do_query_cached(sql_con_t *con, str *query, sql_result_t *res, int ttl)
+{
+	sql_cache_entry_t *ep, **prev;
+	unsigned int hashid;
+	int slot;
+	time_t now;
+	int ret;
+
+	if(_sql_cache == NULL || res == NULL || ttl <= 0)
+		return sql_do_query(con, query, res);
+
+	if(query == NULL) {
+		LM_ERR("bad parameters\n");
+		return -1;
+	}
+
+	hashid = core_hash(query, 0, 0);
+	slot = hashid % _sql_cache->size;
+	now = time(NULL);
+
+	lock_get(&_sql_cache->lock);
+	prev = &_sql_cache->slots[slot];
+	for(ep = *prev; ep; prev = &ep->next, ep = ep->next) {
+		if(ep->hashid != hashid || ep->query.len != query->len
+				|| memcmp(ep->query.s, query->s, query->len) != 0)
+			continue;
+		if(ep->expires > now) {
+			ret = sql_cache_entry_restore(ep, res);
+			_sql_cache->hits++;
+			lock_release(&_sql_cache->lock);
+			if(ret < 0)
+				return -1;
+			return (res->nrows > 0) ? 1 : 2;
+		}
+		/* expired - drop it and query the database */
+		*prev = ep->next;
+		sql_cache_entry_free(ep);
+		_sql_cache->nrent--;
+		break;
+	}
+	_sql_cache->misses++;
+	lock_release(&_sql_cache->lock);
+
+	ret = sql_do_query(con, query, res);
+	if(ret < 0)
+		return ret;
+
+	/* cache rows (ret==1) as well as empty results (ret==2) */
+	ep = sql_cache_entry_new(query, hashid, (ret == 1) ? res : NULL, ttl);
+	if(ep == NULL)
+		return ret;
+
+	lock_get(&_sql_cache->lock);
+	/* another process may have cached it meanwhile - keep the newest */
+	prev = &_sql_cache->slots[slot];
+	while(*prev) {
+		if((*prev)->hashid == hashid && (*prev)->query.len == query->len
+				&& memcmp((*prev)->query.s, query->s, query->len) == 0) {
+			ep->next = (*prev)->next;
+			sql_cache_entry_free(*prev);
+			*prev = ep;
+			lock_release(&_sql_cache->lock);
+			return ret;
+		}
+		prev = &(*prev)->next;
+	}
+	ep->next = _sql_cache->slots[slot];
+	_sql_cache->slots[slot] = ep;
+	_sql_cache->nrent++;
+	lock_release(&_sql_cache->lock);
+
+	return ret;
+}
+
 int sql_do_query_async(sql_con_t *con, str *query)
 {
 	if(query == NULL) {
@@ -669,6 +1068,7 @@ void sql_destroy(void)
 	sql_result_t *r0;
 
 	sql_disconnect();
+	sql_cache_destroy();
 
 	r = _sql_result_root;
 	while(r) {
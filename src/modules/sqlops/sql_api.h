@@ -71,7 +71,13 @@ int sql_connect(int mode);
 int sql_reconnect(sql_con_t *sc);
 
 int sql_do_query(sql_con_t *con, str *query, sql_result_t *res);
+int sql_do_query_cached(sql_con_t *con, str *query, sql_result_t *res, int ttl);
 int sql_do_query_async(sql_con_t *con, str *query);
+
+int sql_cache_init(void);
+void sql_cache_destroy(void);
+int sql_cache_flush(str *query);
+int sql_cache_stats(unsigned int *hits, unsigned int *misses, int *entries);
 int sql_do_xquery(
 		sip_msg_t *msg, sql_con_t *con, pv_elem_t *query, pv_elem_t *res);
 int sql_do_pvquery(
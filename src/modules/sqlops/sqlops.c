@@ -60,6 +60,8 @@ static int bind_sqlops(sqlops_api_t *api);
 static int sql_check_connection(sql_con_t *);
 static int sql_query(struct sip_msg *, char *, char *, char *);
 static int sql_query2(struct sip_msg *, char *, char *);
+static int sql_query_cached(
+		struct sip_msg *, char *, char *, char *, char *);
 static int sql_query_async(struct sip_msg *, char *, char *);
 static int sql_xquery(struct sip_msg *msg, char *dbl, char *query, char *res);
 static int sql_pvquery(struct sip_msg *msg, char *dbl, char *query, char *res);
@@ -69,6 +71,7 @@ static int child_init(int rank);
 static void destroy(void);
 
 static int fixup_sql_query(void **param, int param_no);
+static int fixup_sql_query_cached(void **param, int param_no);
 static int fixup_sql_xquery(void **param, int param_no);
 static int fixup_sql_pvquery(void **param, int param_no);
 static int fixup_sql_rfree(void **param, int param_no);
@@ -80,6 +83,7 @@ extern int sqlops_tr_buf_size;
 
 int sqlops_results_maxsize = 32;
 int sqlops_log_buf_size = 128;
+int sqlops_cache_size = 0;
 
 static int sqlops_connect_mode = 0;
 
@@ -93,6 +97,7 @@ static pv_export_t mod_pvs[] = {
 static cmd_export_t cmds[] = {
 	{"sql_query", (cmd_function)sql_query, 3, fixup_sql_query, 0, ANY_ROUTE},
 	{"sql_query", (cmd_function)sql_query2, 2, fixup_sql_query, 0, ANY_ROUTE},
+	{"sql_query_cached", (cmd_function)sql_query_cached, 4, fixup_sql_query_cached, 0, ANY_ROUTE},
 	{"sql_query_async", (cmd_function)sql_query_async, 2, fixup_sql_query, 0, ANY_ROUTE},
 	{"sql_xquery", (cmd_function)sql_xquery, 3, fixup_sql_xquery, 0, ANY_ROUTE},
 	{"sql_pvquery", (cmd_function)sql_pvquery, 3, fixup_sql_pvquery, 0,	ANY_ROUTE},
@@ -108,6 +113,7 @@ static param_export_t params[] = {
 	{"log_buf_size", PARAM_INT, &sqlops_log_buf_size},
 	{"connect_mode", PARAM_INT, &sqlops_connect_mode},
 	{"results_maxsize", PARAM_INT, &sqlops_results_maxsize},
+	{"cache_size", PARAM_INT, &sqlops_cache_size},
 	{0, 0, 0}
 };
 
@@ -116,13 +122,15 @@ static tr_export_t mod_trans[] = {
 	{{0, 0}, 0}
 };
 
+static rpc_export_t sqlops_rpc_methods[];
+
 /** module exports */
 struct module_exports exports = {
 	"sqlops",        /* module name */
 	DEFAULT_DLFLAGS, /* dlopen flags */
 	cmds,            /* exported functions */
 	params,          /* exported parameters */
-	0,               /* exported rpc functions */
+	sqlops_rpc_methods, /* exported rpc functions */
 	mod_pvs,         /* exported pseudo-variables */
 	0,               /* response handling function */
 	mod_init,        /* module init function */
@@ -136,6 +144,9 @@ static int mod_init(void)
 	if(sqlops_tr_buffer_init() < 0) {
 		return -1;
 	}
+	if(sqlops_cache_size > 0 && sql_cache_init() < 0) {
+		return -1;
+	}
 	return 0;
 }
 
@@ -252,6 +263,25 @@ static int sql_query2(struct sip_msg *msg, char *dbl, char *query)
 	return sql_query(msg, dbl, query, NULL);
 }
 
+/**
+ *
+ */
+static int sql_query_cached(
+		struct sip_msg *msg, char *dbl, char *query, char *res, char *ttl)
+{
+	str sq;
+	if(sql_check_connection((sql_con_t *)dbl) < 0) {
+		LM_ERR("invalid connection to database\n");
+		return -2;
+	}
+	if(pv_printf_s(msg, (pv_elem_t *)query, &sq) != 0) {
+		LM_ERR("cannot print the sql query\n");
+		return -1;
+	}
+	return sql_do_query_cached(
+			(sql_con_t *)dbl, &sq, (sql_result_t *)res, (int)(long)ttl);
+}
+
 static int sql_query_async(struct sip_msg *msg, char *dbl, char *query)
 {
 	str sq;
@@ -339,6 +369,27 @@ static int fixup_sql_query(void **param, int param_no)
 	return 0;
 }
 
+/**
+ *
+ */
+static int fixup_sql_query_cached(void **param, int param_no)
+{
+	int ttl = 0;
+	str s;
+
+	if(param_no <= 3)
+		return fixup_sql_query(param, param_no);
+
+	s.s = (char *)(*param);
+	s.len = strlen(s.s);
+	if(str2sint(&s, &ttl) < 0 || ttl <= 0) {
+		LM_ERR("invalid ttl value [%s]\n", s.s);
+		return E_UNSPEC;
+	}
+	*param = (void *)(long)ttl;
+	return 0;
+}
+
 /**
  *
  */
@@ -530,6 +581,39 @@ static int ki_sqlops_pvquery(sip_msg_t *msg, str *scon, str *squery, str *sres)
 	return res;
 }
 
+static int ki_sqlops_query_cached(
+		sip_msg_t *msg, str *scon, str *squery, str *sres, int ttl)
+{
+	sql_con_t *con = NULL;
+	sql_result_t *res = NULL;
+
+	if(scon == NULL || scon->s == NULL) {
+		LM_ERR("invalid connection name\n");
+		return -1;
+	}
+
+	con = sql_get_connection(scon);
+	if(con == NULL) {
+		LM_ERR("invalid connection [%.*s]\n", scon->len, scon->s);
+		return -1;
+	}
+	if(sres == NULL || sres->s == NULL) {
+		LM_ERR("invalid result container name\n");
+		return -1;
+	}
+	res = sql_get_result(sres);
+	if(res == NULL) {
+		LM_ERR("invalid result container [%.*s]\n", sres->len, sres->s);
+		return -1;
+	}
+	if(sql_check_connection(con) < 0) {
+		LM_ERR("invalid connection to database\n");
+		return -2;
+	}
+
+	return sql_do_query_cached(con, squery, res, ttl);
+}
+
 static int ki_sqlops_query_async(sip_msg_t *msg, str *scon, str *squery)
 {
 	sql_con_t *con = NULL;
@@ -660,6 +744,11 @@ static sr_kemi_t sr_kemi_sqlops_exports[] = {
 		{ SR_KEMIP_STR, SR_KEMIP_STR, SR_KEMIP_STR,
 			SR_KEMIP_NONE, SR_KEMIP_NONE, SR_KEMIP_NONE }
 	},
+	{ str_init("sqlops"), str_init("sql_query_cached"),
+		SR_KEMIP_INT, ki_sqlops_query_cached,
+		{ SR_KEMIP_STR, SR_KEMIP_STR, SR_KEMIP_STR,
+			SR_KEMIP_INT, SR_KEMIP_NONE, SR_KEMIP_NONE }
+	},
 	{ str_init("sqlops"), str_init("sql_result_free"),
 		SR_KEMIP_INT, ki_sqlops_reset_result,
 		{ SR_KEMIP_STR, SR_KEMIP_NONE, SR_KEMIP_NONE,
@@ -715,6 +804,54 @@ static sr_kemi_t sr_kemi_sqlops_exports[] = {
 };
 /* clang-format on */
 
+/* rpc function documentation */
+static const char *rpc_cache_flush_doc[2] = {
+		"Remove cached query results - all, or only for the given query", 0};
+static const char *rpc_cache_stats_doc[2] = {
+		"Print query cache hit/miss counters and number of entries", 0};
+
+/* rpc function implementations */
+static void rpc_cache_flush(rpc_t *rpc, void *ctx)
+{
+	str sq = STR_NULL;
+	int n;
+
+	if(rpc->scan(ctx, "*S", &sq) < 1) {
+		sq.s = NULL;
+		sq.len = 0;
+	}
+	n = sql_cache_flush((sq.len > 0) ? &sq : NULL);
+	if(n < 0) {
+		rpc->fault(ctx, 500, "Query cache not enabled");
+		return;
+	}
+	rpc->rpl_printf(ctx, "Flushed %d entries", n);
+}
+
+static void rpc_cache_stats(rpc_t *rpc, void *ctx)
+{
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	int entries = 0;
+	void *th;
+
+	if(sql_cache_stats(&hits, &misses, &entries) < 0) {
+		rpc->fault(ctx, 500, "Query cache not enabled");
+		return;
+	}
+	if(rpc->add(ctx, "{", &th) < 0) {
+		rpc->fault(ctx, 500, "Internal error creating rpc struct");
+		return;
+	}
+	rpc->struct_add(th, "ddd", "hits", (int)hits, "misses", (int)misses,
+			"entries", entries);
+}
+
+static rpc_export_t sqlops_rpc_methods[] = {
+		{"sqlops.cache_flush", rpc_cache_flush, rpc_cache_flush_doc, 0},
+		{"sqlops.cache_stats", rpc_cache_stats, rpc_cache_stats_doc, 0},
+		{0, 0, 0, 0}};
+
 /**
  *
  */
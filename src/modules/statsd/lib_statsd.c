@@ -7,6 +7,7 @@
 #include <netdb.h>
 #include <math.h>
 #include <errno.h>
+#include <sys/time.h>
 
 #include "../../core/sr_module.h"
 #include "lib_statsd.h"
@@ -15,6 +16,14 @@ bool isNumber(char *str);
 
 static StatsConnection statsd_connection = {"127.0.0.1", "8125", -1};
 
+/* client side batching - metrics are newline separated, so buffered
+ * commands concatenate into one multi-metric datagram */
+static int statsd_batch_size = 0; /* max payload per datagram, 0 - disabled */
+static int statsd_batch_interval = 0; /* max age of buffered metrics, in ms */
+static char statsd_batch_buf[BUFFER_SIZE];
+static int statsd_batch_len = 0;
+static struct timeval statsd_batch_first;
+
 enum actions
 {
 	GAUGE = 0,
@@ -69,7 +78,7 @@ bool statsd_connect(void)
 	return true;
 }
 
-bool send_command(char *command)
+static bool send_direct(char *command, int command_len)
 {
 	int send_result;
 
@@ -77,13 +86,66 @@ bool send_command(char *command)
 		return false;
 	}
 
-	send_result = send(statsd_connection.sock, command, strlen(command), 0);
+	send_result = send(statsd_connection.sock, command, command_len, 0);
 	if(send_result < 0) {
 		LM_ERR("could not send the correct info to statsd (%i| %s)\n",
 				send_result, strerror(errno));
 		return true;
 	}
-	LM_DBG("Sent to statsd (%s)", command);
+	LM_DBG("Sent to statsd (%.*s)", command_len, command);
+	return true;
+}
+
+bool statsd_batch_flush(void)
+{
+	bool rc;
+
+	if(statsd_batch_len == 0) {
+		return true;
+	}
+	rc = send_direct(statsd_batch_buf, statsd_batch_len);
+	statsd_batch_len = 0;
+	return rc;
+}
+
+/**
+ * age of the oldest buffered metric, in milliseconds
+ */
+static int statsd_batch_age(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (int)((now.tv_sec - statsd_batch_first.tv_sec) * 1000
+				 + (now.tv_usec - statsd_batch_first.tv_usec) / 1000);
+}
+
+bool send_command(char *command)
+{
+	int command_len = strlen(command);
+
+	if(statsd_batch_size <= 0) {
+		return send_direct(command, command_len);
+	}
+
+	if(command_len >= statsd_batch_size) {
+		/* does not fit into a batch - send it on its own */
+		statsd_batch_flush();
+		return send_direct(command, command_len);
+	}
+	if(statsd_batch_len + command_len > statsd_batch_size) {
+		statsd_batch_flush();
+	}
+	if(statsd_batch_len == 0) {
+		gettimeofday(&statsd_batch_first, NULL);
+	}
+	memcpy(statsd_batch_buf + statsd_batch_len, command, command_len);
+	statsd_batch_len += command_len;
+
+	if(statsd_batch_interval <= 0
+			|| statsd_batch_age() >= statsd_batch_interval) {
+		return statsd_batch_flush();
+	}
 	return true;
 }
 
@@ -161,8 +223,20 @@ bool statsd_init(char *ip, char *port)
 	return statsd_connect();
 }
 
+void statsd_init_batch(int size, int interval)
+{
+	if(size > BUFFER_SIZE) {
+		LM_WARN("batch size %d larger than the buffer - capping to %d\n", size,
+				BUFFER_SIZE);
+		size = BUFFER_SIZE;
+	}
+	statsd_batch_size = size;
+	statsd_batch_interval = interval;
+}
+
 bool statsd_destroy(void)
 {
+	statsd_batch_flush();
 	statsd_connection.sock = 0;
 	return true;
 }
@@ -11,6 +11,8 @@ typedef struct StatsConnection
 
 bool statsd_connect(void);
 bool send_command(char *command);
+bool statsd_batch_flush(void);
+void statsd_init_batch(int size, int interval);
 bool statsd_set(char *key, char *value, char *labels);
 bool statsd_gauge(char *key, char *value, char *labels);
 bool statsd_histogram(char *key, char *value, char *labels);
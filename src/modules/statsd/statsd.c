@@ -57,6 +57,8 @@ typedef struct StatsdParams
 {
 	char *ip;
 	char *port;
+	int batch_size;
+	int batch_interval;
 } StatsdParams;
 
 static StatsdParams statsd_params = {};
@@ -81,6 +83,8 @@ static cmd_export_t commands[] = {
 static param_export_t parameters[] = {
     {"ip", PARAM_STRING, &(statsd_params.ip)},
     {"port", PARAM_STRING, &(statsd_params.port)},
+    {"batch_size", PARAM_INT, &(statsd_params.batch_size)},
+    {"batch_interval", PARAM_INT, &(statsd_params.batch_interval)},
     {0, 0, 0}
 };
 
@@ -113,6 +117,12 @@ static int mod_init(void)
 		LM_INFO("Statsd init port value %s\n", statsd_params.port);
 	}
 
+	if(statsd_params.batch_size > 0) {
+		LM_INFO("Statsd: batching metrics up to %d bytes / %d ms\n",
+				statsd_params.batch_size, statsd_params.batch_interval);
+	}
+	statsd_init_batch(statsd_params.batch_size, statsd_params.batch_interval);
+
 	rc = statsd_init(statsd_params.ip, statsd_params.port);
 	if(rc == false) {
 		LM_ERR("Statsd connection failed (ERROR_CODE: %i)\n", rc);
@@ -32,10 +32,14 @@
 #include "../../core/receive.h"
 #include "../../core/mod_fix.h"
 #include "../../core/async_task.h"
+#include "../../core/hashes.h"
+#include "../../core/counters.h"
 #include "../../core/kemi.h"
 
 MODULE_VERSION
 
+#define SWORKER_GNAME_SIZE 128
+
 static int mod_init(void);
 static int child_init(int);
 static void mod_destroy(void);
@@ -46,6 +50,8 @@ static int w_sworker_active(sip_msg_t *msg, char *p1, char *p2);
 static int _sworker_active = 0;
 static str _sworker_xdata = STR_NULL;
 static pv_spec_t *_sworker_xdata_spec = NULL;
+static int _sworker_affinity_size = 0;
+static int _sworker_load_limit = 0;
 
 /* clang-format off */
 typedef struct sworker_task_param {
@@ -65,8 +71,23 @@ static cmd_export_t cmds[]={
 
 static param_export_t params[]={
 	{"xdata",    PARAM_STR,   &_sworker_xdata},
+	{"affinity_size", PARAM_INT, &_sworker_affinity_size},
+	{"load_limit",    PARAM_INT, &_sworker_load_limit},
+	{0, 0, 0}
+};
+
+#ifdef STATISTICS
+stat_var *sworker_dispatched;
+stat_var *sworker_spilled;
+stat_var *sworker_rejected;
+
+stat_export_t mod_stats[] = {
+	{"tasks_dispatched", 0, &sworker_dispatched},
+	{"tasks_spilled",    0, &sworker_spilled},
+	{"tasks_rejected",   0, &sworker_rejected},
 	{0, 0, 0}
 };
+#endif
 
 struct module_exports exports = {
 	"sworker",       /* module name */
@@ -88,6 +109,12 @@ struct module_exports exports = {
  */
 static int mod_init(void)
 {
+#ifdef STATISTICS
+	if(register_module_stats(exports.name, mod_stats) != 0) {
+		LM_ERR("failed to register module statistics\n");
+		return -1;
+	}
+#endif
 	if(_sworker_xdata.s != NULL && _sworker_xdata.len > 0) {
 		_sworker_xdata_spec = pv_cache_get(&_sworker_xdata);
 		if(_sworker_xdata_spec == NULL) {
@@ -165,10 +192,99 @@ void sworker_exec_task(void *param)
 	_sworker_active = 0;
 }
 
+/**
+ * pick the worker group for the task - with affinity enabled, the group is
+ * chosen among <gname>0 .. <gname>N-1 by call-id hash, spilling to the
+ * least loaded one of the set when the chosen group is over load_limit;
+ * sets *overload to 1 when every candidate is over the limit
+ */
+static async_wgroup_t *sworker_group_select(
+		sip_msg_t *msg, str *gname, int *overload)
+{
+	async_wgroup_t *awg = NULL;
+	async_wgroup_t *lwg = NULL;
+	char gbuf[SWORKER_GNAME_SIZE];
+	str sg;
+	unsigned int hashid;
+	int idx;
+	int i;
+	int depth;
+	int ldepth;
+
+	*overload = 0;
+
+	if(_sworker_affinity_size <= 1) {
+		awg = async_task_group_find(gname);
+		if(awg == NULL) {
+			LM_WARN("group [%.*s] not found - ignoring\n", gname->len,
+					gname->s);
+			return NULL;
+		}
+		if(_sworker_load_limit > 0
+				&& async_task_group_depth(awg) >= _sworker_load_limit) {
+			*overload = 1;
+			return NULL;
+		}
+		return awg;
+	}
+
+	if(parse_headers(msg, HDR_CALLID_F, 0) < 0 || msg->callid == NULL) {
+		LM_ERR("cannot get the call-id header\n");
+		return NULL;
+	}
+	hashid = get_hash1_raw(msg->callid->body.s, msg->callid->body.len);
+	idx = hashid % _sworker_affinity_size;
+	sg.s = gbuf;
+	sg.len = snprintf(gbuf, SWORKER_GNAME_SIZE, "%.*s%d", gname->len, gname->s,
+			idx);
+	if(sg.len <= 0 || sg.len >= SWORKER_GNAME_SIZE) {
+		LM_ERR("group name too long [%.*s]\n", gname->len, gname->s);
+		return NULL;
+	}
+	awg = async_task_group_find(&sg);
+	if(awg == NULL) {
+		LM_WARN("group [%.*s] not found - ignoring\n", sg.len, sg.s);
+		return NULL;
+	}
+	if(_sworker_load_limit <= 0
+			|| async_task_group_depth(awg) < _sworker_load_limit) {
+		return awg;
+	}
+
+	/* the affine group is overloaded - spill to the least loaded one */
+	ldepth = -1;
+	for(i = 0; i < _sworker_affinity_size; i++) {
+		if(i == idx) {
+			continue;
+		}
+		sg.s = gbuf;
+		sg.len = snprintf(
+				gbuf, SWORKER_GNAME_SIZE, "%.*s%d", gname->len, gname->s, i);
+		awg = async_task_group_find(&sg);
+		if(awg == NULL) {
+			continue;
+		}
+		depth = async_task_group_depth(awg);
+		if(depth < 0) {
+			continue;
+		}
+		if(ldepth < 0 || depth < ldepth) {
+			ldepth = depth;
+			lwg = awg;
+		}
+	}
+	if(lwg == NULL || ldepth >= _sworker_load_limit) {
+		*overload = 1;
+		return NULL;
+	}
+	update_stat(sworker_spilled, 1);
+	return lwg;
+}
+
 /**
  *
  */
-int sworker_send_task(sip_msg_t *msg, str *gname)
+int sworker_send_task(sip_msg_t *msg, async_wgroup_t *awg)
 {
 	async_task_t *at = NULL;
 	sworker_task_param_t *stp = NULL;
@@ -211,7 +327,7 @@ int sworker_send_task(sip_msg_t *msg, str *gname)
 		pv_value_destroy(&val);
 	}
 
-	return async_task_group_push(gname, at);
+	return async_task_group_send(awg, at);
 }
 
 /**
@@ -219,6 +335,9 @@ int sworker_send_task(sip_msg_t *msg, str *gname)
  */
 int ki_sworker_task(sip_msg_t *msg, str *gname)
 {
+	async_wgroup_t *awg = NULL;
+	int overload = 0;
+
 	if(msg == NULL || faked_msg_match(msg)) {
 		LM_ERR("invalid usage for null or faked message\n");
 		return -1;
@@ -228,9 +347,21 @@ int ki_sworker_task(sip_msg_t *msg, str *gname)
 		LM_WARN("not used in pre-routing phase\n");
 		return -1;
 	}
-	if(sworker_send_task(msg, gname) < 0) {
+
+	awg = sworker_group_select(msg, gname, &overload);
+	if(awg == NULL) {
+		if(overload) {
+			/* all candidate groups over load_limit - let the caller
+			 * process the message inline */
+			update_stat(sworker_rejected, 1);
+			return -2;
+		}
+		return -1;
+	}
+	if(sworker_send_task(msg, awg) < 0) {
 		return -1;
 	}
+	update_stat(sworker_dispatched, 1);
 
 	return 1;
 }
@@ -58,6 +58,8 @@
 #include "../../core/ut.h"
 #include "../../core/dset.h"
 #include "../../core/strutils.h"
+#include "../../core/hashes.h"
+#include "../../core/counters.h"
 #include "../../core/kemi.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -342,12 +344,29 @@ static cmd_export_t cmds[] = {
 	{0, 0, 0, 0, 0, 0}
 };
 
+static int subst_cache_size = 64;
+
+static param_export_t params[] = {
+	{"subst_cache_size", PARAM_INT, &subst_cache_size},
+	{0, 0, 0}
+};
+
+#ifdef STATISTICS
+stat_var *tops_subst_cache_hits;
+stat_var *tops_subst_cache_misses;
+
+stat_export_t mod_stats[] = {
+	{"subst_cache_hits", 0, &tops_subst_cache_hits},
+	{"subst_cache_misses", 0, &tops_subst_cache_misses},
+	{0, 0, 0}
+};
+#endif
 
 struct module_exports exports = {
 	"textops",       /* module name*/
 	DEFAULT_DLFLAGS, /* dlopen flags */
 	cmds,            /* exported functions */
-	0,               /* exported parameters */
+	params,          /* exported parameters */
 	0,               /* exported rpc functions */
 	0,               /* exported pseudo-variables */
 	0,               /* response handling function */
@@ -359,6 +378,12 @@ struct module_exports exports = {
 
 static int mod_init(void)
 {
+#ifdef STATISTICS
+	if(register_module_stats(exports.name, mod_stats) != 0) {
+		LM_ERR("failed to register module statistics\n");
+		return -1;
+	}
+#endif
 	return 0;
 }
 
@@ -369,6 +394,98 @@ static char *get_header(struct sip_msg *msg)
 }
 
 
+/* per-process lru cache with the compiled subst expressions built at
+ * runtime (kemi functions and expressions with variables) - the native
+ * functions with static expressions keep compiling at fixup time */
+typedef struct subst_cache_item
+{
+	str sexp;
+	unsigned int hashid;
+	struct subst_expr *se;
+	struct subst_cache_item *next;
+} subst_cache_item_t;
+
+static subst_cache_item_t *_subst_cache_list = NULL;
+static int _subst_cache_count = 0;
+
+/**
+ * get the compiled expression for subst, from the cache or by compiling
+ * and caching it - the cache keeps ownership, release with
+ * subst_cache_expr_release()
+ */
+static struct subst_expr *subst_cache_expr_get(str *subst)
+{
+	subst_cache_item_t *it;
+	subst_cache_item_t *prev;
+	unsigned int hashid;
+
+	if(subst_cache_size <= 0)
+		return subst_parser(subst);
+
+	hashid = get_hash1_raw(subst->s, subst->len);
+	prev = NULL;
+	for(it = _subst_cache_list; it != NULL; it = it->next) {
+		if(it->hashid == hashid && it->sexp.len == subst->len
+				&& memcmp(it->sexp.s, subst->s, subst->len) == 0) {
+			/* hit - move in front to keep the list in lru order */
+			if(prev != NULL) {
+				prev->next = it->next;
+				it->next = _subst_cache_list;
+				_subst_cache_list = it;
+			}
+			update_stat(tops_subst_cache_hits, 1);
+			return it->se;
+		}
+		prev = it;
+	}
+
+	it = (subst_cache_item_t *)pkg_malloc(
+			sizeof(subst_cache_item_t) + subst->len + 1);
+	if(it == NULL) {
+		PKG_MEM_ERROR;
+		return NULL;
+	}
+	memset(it, 0, sizeof(subst_cache_item_t));
+	it->sexp.s = (char *)it + sizeof(subst_cache_item_t);
+	memcpy(it->sexp.s, subst->s, subst->len);
+	it->sexp.s[subst->len] = '\0';
+	it->sexp.len = subst->len;
+	it->hashid = hashid;
+	it->se = subst_parser(subst);
+	if(it->se == NULL) {
+		pkg_free(it);
+		return NULL;
+	}
+	it->next = _subst_cache_list;
+	_subst_cache_list = it;
+	_subst_cache_count++;
+	update_stat(tops_subst_cache_misses, 1);
+
+	if(_subst_cache_count > subst_cache_size) {
+		/* drop the least recently used item - the last one */
+		prev = _subst_cache_list;
+		while(prev->next != NULL && prev->next->next != NULL)
+			prev = prev->next;
+		it = prev->next;
+		prev->next = NULL;
+		subst_expr_free(it->se);
+		pkg_free(it);
+		_subst_cache_count--;
+	}
+
+	return _subst_cache_list->se;
+}
+
+/**
+ * release an expression returned by subst_cache_expr_get()
+ */
+static void subst_cache_expr_release(struct subst_expr *se)
+{
+	if(subst_cache_size <= 0)
+		subst_expr_free(se);
+}
+
+
 static inline int search_helper_f(struct sip_msg *msg, regex_t *re)
 {
 	/*we registered only 1 param, so we ignore str2*/
@@ -1551,7 +1668,7 @@ static int subst_v_helper_f(
 		LM_ERR("the variable is read only\n");
 		return -1;
 	}
-	se = subst_parser(subex);
+	se = subst_cache_expr_get(subex);
 	if(se == 0) {
 		LM_ERR("bad subst re: %.*s\n", subex->len, subex->s);
 		return -1;
@@ -1562,7 +1679,7 @@ static int subst_v_helper_f(
 		if(nmatches < 0) {
 			LM_ERR("substitution failed\n");
 		}
-		subst_expr_free(se);
+		subst_cache_expr_release(se);
 		return -1;
 	}
 	memset(&val, 0, sizeof(pv_value_t));
@@ -1573,7 +1690,7 @@ static int subst_v_helper_f(
 
 	pkg_free(result->s);
 	pkg_free(result);
-	subst_expr_free(se);
+	subst_cache_expr_release(se);
 	return 1;
 }
 
@@ -1888,7 +2005,7 @@ again:
 			if(hfi->name.len != hname->len) {
 				continue;
 			}
-			if(strncasecmp(hfi->name.s, hname->s, hname->len) != 0) {
+			if(ksr_strncaseeq(hfi->name.s, hname->s, hname->len) != 0) {
 				continue;
 			}
 		}
@@ -2309,7 +2426,7 @@ static int ki_remove_hf_match(sip_msg_t *msg, str *hname, str *op, str *expr)
 			if(hfi->name.len != hname->len) {
 				continue;
 			}
-			if(strncasecmp(hfi->name.s, hname->s, hname->len) != 0) {
+			if(ksr_strncaseeq(hfi->name.s, hname->s, hname->len) != 0) {
 				continue;
 			}
 		}
@@ -5238,13 +5355,13 @@ static int ki_subst(sip_msg_t *msg, str *subst)
 	if(subst == NULL || subst->len <= 0)
 		return -1;
 
-	se = subst_parser(subst);
+	se = subst_cache_expr_get(subst);
 	if(se == 0) {
 		LM_ERR("cannot compile subst expression\n");
 		return -1;
 	}
 	ret = subst_helper_f(msg, se);
-	subst_expr_free(se);
+	subst_cache_expr_release(se);
 
 	return ret;
 }
@@ -5257,13 +5374,13 @@ static int ki_subst_uri(sip_msg_t *msg, str *subst)
 	if(subst == NULL || subst->len <= 0)
 		return -1;
 
-	se = subst_parser(subst);
+	se = subst_cache_expr_get(subst);
 	if(se == 0) {
 		LM_ERR("cannot compile subst expression\n");
 		return -1;
 	}
 	ret = subst_uri_helper_f(msg, se);
-	subst_expr_free(se);
+	subst_cache_expr_release(se);
 
 	return ret;
 }
@@ -5276,13 +5393,13 @@ static int ki_subst_user(sip_msg_t *msg, str *subst)
 	if(subst == NULL || subst->len <= 0)
 		return -1;
 
-	se = subst_parser(subst);
+	se = subst_cache_expr_get(subst);
 	if(se == 0) {
 		LM_ERR("cannot compile subst expression\n");
 		return -1;
 	}
 	ret = subst_user_helper_f(msg, se);
-	subst_expr_free(se);
+	subst_cache_expr_release(se);
 
 	return ret;
 }
@@ -5295,13 +5412,13 @@ static int ki_subst_body(sip_msg_t *msg, str *subst)
 	if(subst == NULL || subst->len <= 0)
 		return -1;
 
-	se = subst_parser(subst);
+	se = subst_cache_expr_get(subst);
 	if(se == 0) {
 		LM_ERR("cannot compile subst expression\n");
 		return -1;
 	}
 	ret = subst_body_helper_f(msg, se);
-	subst_expr_free(se);
+	subst_cache_expr_release(se);
 
 	return ret;
 }
@@ -5324,14 +5441,14 @@ static int ki_subst_hf(sip_msg_t *msg, str *hname, str *subst, str *flags)
 	if(ki_hname_gparam(hname, &ghp) < 0)
 		return -1;
 
-	se = subst_parser(subst);
+	se = subst_cache_expr_get(subst);
 	if(se == 0) {
 		LM_ERR("cannot compile subst expression\n");
 		return -1;
 	}
 
 	ret = subst_hf_helper_f(msg, &ghp, se, (flags) ? flags->s : NULL);
-	subst_expr_free(se);
+	subst_cache_expr_release(se);
 
 	return ret;
 }
@@ -74,7 +74,9 @@ struct cfg_group_tls default_tls_cfg = {
 		10 * 1024 * 1024, /* ct_wq_max: 10 Mb by default */
 		64 * 1024,		  /* con_ct_wq_max: 64Kb by default */
 		4096,			  /* ct_wq_blk_size */
-		0				  /* send_close_notify (off by default)*/
+		0,				  /* send_close_notify (off by default)*/
+		4096,			  /* session_cache_size */
+		0				  /* ticket_key_lifetime (no shared ticket keys) */
 };
 
 volatile void *tls_cfg = &default_tls_cfg;
@@ -179,8 +181,9 @@ cfg_def_t tls_cfg_def[] = {{"force_run", CFG_VAR_INT | CFG_READONLY, 0, 1, 0, 0,
 				"name of the file containing the certificate (pem format)"},
 		{"cipher_list", CFG_VAR_STR | CFG_READONLY, 0, 0, 0, 0,
 				"list of the accepted ciphers (strings separated by colons)"},
-		{"session_cache", CFG_VAR_INT | CFG_READONLY, 0, 1, 0, 0,
-				"enables or disables the session cache"},
+		{"session_cache", CFG_VAR_INT | CFG_READONLY, 0, 2, 0, 0,
+				"session cache mode: 0 - off, 1 - per process,"
+				" 2 - shared memory (cross-process resumption)"},
 		{"session_id", CFG_VAR_STR | CFG_READONLY, 0, 0, 0, 0,
 				"string used for the session id"},
 		{"config", CFG_VAR_STR, 0, 0, fix_rel_pathname, 0,
@@ -239,6 +242,12 @@ cfg_def_t tls_cfg_def[] = {{"force_run", CFG_VAR_INT | CFG_READONLY, 0, 1, 0, 0,
 				"enable/disable sending a close notify TLS shutdown alert"
 				" before closing the corresponding TCP connection."
 				"Note that having it enabled has a performance impact."},
+		{"session_cache_size", CFG_VAR_INT | CFG_READONLY, 1, 1 << 20, 0, 0,
+				"maximum number of sessions kept in the shared memory"
+				" session cache (used only with session_cache = 2)"},
+		{"ticket_key_lifetime", CFG_VAR_INT | CFG_READONLY, 0, 0, 0, 0,
+				"rotation period in s of the shared session ticket keys"
+				" (used only with session_cache = 2), 0 - disabled"},
 		{0, 0, 0, 0, 0, 0}};
 
 
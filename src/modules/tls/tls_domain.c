@@ -64,6 +64,7 @@ extern EVP_PKEY *tls_engine_private_key(const char *key_id);
 #include "tls_domain.h"
 #include "tls_cfg.h"
 #include "tls_verify.h"
+#include "tls_sescache.h"
 
 extern int ksr_tls_key_password_mode;
 
@@ -909,18 +910,25 @@ static int set_session_cache(tls_domain_t *d)
 {
 	int i;
 	int procs_no;
+	int mode;
 	str tls_session_id;
 
 	procs_no = get_max_procs();
+	mode = cfg_get(tls, tls_cfg, session_cache);
 	tls_session_id = cfg_get(tls, tls_cfg, session_id);
 	for(i = 0; i < procs_no; i++) {
-		/* janakj: I am not sure if session cache makes sense in ser, session
-		 * cache is stored in SSL_CTX and we have one SSL_CTX per process,
-		 * thus sessions among processes will not be reused
-		 */
-		SSL_CTX_set_session_cache_mode(d->ctx[i],
-				cfg_get(tls, tls_cfg, session_cache) ? SSL_SESS_CACHE_SERVER
-													 : SSL_SESS_CACHE_OFF);
+		if(mode == 2 && tls_scache_active()) {
+			/* external shm cache: resumption works no matter which
+			 * process accepts the reconnect */
+			tls_scache_attach_ctx(d->ctx[i]);
+		} else {
+			/* janakj: I am not sure if session cache makes sense in ser,
+			 * session cache is stored in SSL_CTX and we have one SSL_CTX per
+			 * process, thus sessions among processes will not be reused
+			 */
+			SSL_CTX_set_session_cache_mode(d->ctx[i],
+					mode ? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_OFF);
+		}
 		/* not really needed is SSL_SESS_CACHE_OFF */
 		SSL_CTX_set_session_id_context(d->ctx[i],
 				(unsigned char *)tls_session_id.s, tls_session_id.len);
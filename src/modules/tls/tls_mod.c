@@ -56,6 +56,7 @@
 #include "tls_cfg.h"
 #include "tls_rand.h"
 #include "tls_ct_wrq.h"
+#include "tls_sescache.h"
 
 #ifndef TLS_HOOKS
 #error "TLS_HOOKS must be defined, or the tls module won't work"
@@ -293,7 +294,10 @@ static param_export_t params[] = {
 	{"tls_log", PARAM_INT, &default_tls_cfg.log},
 	{"tls_debug", PARAM_INT, &default_tls_cfg.debug},
 	{"session_cache", PARAM_INT, &default_tls_cfg.session_cache},
+	{"session_cache_size", PARAM_INT, &default_tls_cfg.session_cache_size},
 	{"session_id", PARAM_STR, &default_tls_cfg.session_id},
+	{"ticket_key_lifetime", PARAM_INT,
+			&default_tls_cfg.ticket_key_lifetime},
 	{"config", PARAM_STR, &default_tls_cfg.config_file},
 	{"tls_disable_compression", PARAM_INT,
 			&default_tls_cfg.disable_compression},
@@ -490,6 +494,20 @@ static int mod_init(void)
 		LM_ERR("Unable to initialize TLS buffering\n");
 		goto error;
 	}
+	if(tls_rd_buf_pool_init() < 0) {
+		LM_ERR("Unable to initialize the TLS read buffer pool\n");
+		goto error;
+	}
+	if(cfg_get(tls, tls_cfg, session_cache) == 2) {
+		/* must be created before the SSL_CTXs (and before forking), so
+		 * that every process attaches to the same shm cache */
+		if(tls_scache_init(cfg_get(tls, tls_cfg, session_cache_size),
+				   cfg_get(tls, tls_cfg, ticket_key_lifetime))
+				< 0) {
+			LM_ERR("Unable to initialize the shared TLS session cache\n");
+			goto error;
+		}
+	}
 	if(cfg_get(tls, tls_cfg, config_file).s) {
 		*tls_domains_cfg = tls_load_config(&cfg_get(tls, tls_cfg, config_file));
 		if(!(*tls_domains_cfg))
@@ -644,7 +662,9 @@ static int mod_child(int rank)
 static void mod_destroy(void)
 {
 	/* tls is destroyed via the registered destroy_tls_h callback
-	 *   => nothing to do here */
+	 *   => only the shared session cache and buffer pool are released here */
+	tls_scache_destroy();
+	tls_rd_buf_pool_destroy();
 }
 
 /*
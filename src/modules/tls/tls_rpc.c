@@ -40,6 +40,7 @@
 #include "tls_ct_wrq.h"
 #include "tls_rpc.h"
 #include "tls_cfg.h"
+#include "tls_sescache.h"
 
 static const char *tls_reload_doc[2] = {"Reload TLS configuration file", 0};
 
@@ -97,7 +98,6 @@ error:
 
 static const char *tls_list_doc[2] = {"List currently open TLS connections", 0};
 
-extern gen_lock_t *tcpconn_lock;
 extern struct tcp_connection **tcpconn_id_hash;
 
 static void tls_list(rpc_t *rpc, void *c)
@@ -295,9 +295,36 @@ static void tls_kill(rpc_t *rpc, void *c)
 }
 
 
+static const char *tls_sescache_doc[2] = {
+		"Returns the shared memory session cache resumption counters.", 0};
+
+static void tls_sescache(rpc_t *rpc, void *c)
+{
+	tls_scache_stats_t st;
+	void *handle;
+
+	if(tls_scache_get_stats(&st) < 0) {
+		rpc->fault(c, 500,
+				"Shared memory session cache not enabled"
+				" (session_cache = 2)");
+		return;
+	}
+	if(rpc->add(c, "{", &handle) < 0)
+		return;
+	rpc->struct_add(handle, "ddddddddd", "entries", st.entries, "stored",
+			(int)st.stored, "hits", (int)st.hits, "misses", (int)st.misses,
+			"removed", (int)st.removed, "evicted", (int)st.evicted,
+			"tickets_issued", (int)st.tickets_issued, "tickets_resumed",
+			(int)st.tickets_resumed, "tickets_renewed",
+			(int)st.tickets_renewed);
+}
+
+
 rpc_export_t tls_rpc[] = {
 		{"tls.reload", tls_reload, tls_reload_doc, RPC_EXEC_DELTA},
 		{"tls.list", tls_list, tls_list_doc, RET_ARRAY},
 		{"tls.info", tls_info, tls_info_doc, 0},
 		{"tls.options", tls_options, tls_options_doc, 0},
-		{"tls.kill", tls_kill, tls_kill_doc, 0}, {0, 0, 0, 0}};
+		{"tls.kill", tls_kill, tls_kill_doc, 0},
+		{"tls.session_cache", tls_sescache, tls_sescache_doc, 0},
+		{0, 0, 0, 0}};
@@ -32,6 +32,7 @@
 #include "../../core/dprint.h"
 #include "../../core/ip_addr.h"
 #include "../../core/mem/shm_mem.h"
+#include "../../core/locking.h"
 #include "../../core/pt.h"
 #include "../../core/timer.h"
 #include "../../core/globals.h"
@@ -70,6 +71,104 @@ int tls_run_event_routes(struct tcp_connection *c);
 #define TLS_RD_MBUF_SZ 65536
 #define TLS_WR_MBUF_SZ 65536
 
+/* shm pool of queued encrypted-read buffers (enc_rd_buf).
+ * Most connections idle with zero buffered bytes and need a buffer only
+ * for the short moments when openssl cannot consume a whole read (e.g.
+ * during reconnect storms or when the clear-text destination is full), so
+ * a small stack of reusable fixed-size chunks covers the bursts without
+ * per-read shm_malloc()/shm_free() churn. Leftovers larger than the chunk
+ * payload (rare, up to TLS_RD_MBUF_SZ) fall back to exact allocations. */
+#define TLS_RD_BUF_POOL_CHUNK 16384 /* payload size of a pooled chunk */
+#define TLS_RD_BUF_POOL_MAX 32		/* maximum cached free chunks */
+
+typedef struct tls_rd_buf_pool
+{
+	gen_lock_t lock;
+	int count; /* used entries in free[] */
+	tls_rd_buf_t *free[TLS_RD_BUF_POOL_MAX];
+} tls_rd_buf_pool_t;
+
+static tls_rd_buf_pool_t *tls_rd_buf_pool = NULL;
+
+
+/** initialize the enc_rd_buf chunk pool (before forking).
+ * @return 0 on success, -1 on error
+ */
+int tls_rd_buf_pool_init(void)
+{
+	if(tls_rd_buf_pool)
+		return 0;
+	tls_rd_buf_pool = shm_malloc(sizeof(tls_rd_buf_pool_t));
+	if(tls_rd_buf_pool == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(tls_rd_buf_pool, 0, sizeof(tls_rd_buf_pool_t));
+	if(lock_init(&tls_rd_buf_pool->lock) == 0) {
+		shm_free(tls_rd_buf_pool);
+		tls_rd_buf_pool = NULL;
+		ERR("failed to initialize the read buffer pool lock\n");
+		return -1;
+	}
+	return 0;
+}
+
+
+void tls_rd_buf_pool_destroy(void)
+{
+	int i;
+
+	if(tls_rd_buf_pool == NULL)
+		return;
+	for(i = 0; i < tls_rd_buf_pool->count; i++)
+		shm_free(tls_rd_buf_pool->free[i]);
+	lock_destroy(&tls_rd_buf_pool->lock);
+	shm_free(tls_rd_buf_pool);
+	tls_rd_buf_pool = NULL;
+}
+
+
+/** get a buffer able to hold size bytes, from the pool if possible. */
+static tls_rd_buf_t *tls_rd_buf_new(unsigned int size)
+{
+	tls_rd_buf_t *b;
+	unsigned int cap;
+
+	b = NULL;
+	cap = (size > TLS_RD_BUF_POOL_CHUNK) ? size : TLS_RD_BUF_POOL_CHUNK;
+	if(likely(tls_rd_buf_pool && size <= TLS_RD_BUF_POOL_CHUNK)) {
+		lock_get(&tls_rd_buf_pool->lock);
+		if(likely(tls_rd_buf_pool->count > 0))
+			b = tls_rd_buf_pool->free[--tls_rd_buf_pool->count];
+		lock_release(&tls_rd_buf_pool->lock);
+	}
+	if(b == NULL) {
+		b = shm_malloc(sizeof(tls_rd_buf_t) - sizeof(b->buf) + cap);
+		if(b == NULL)
+			return NULL;
+		b->cap = cap;
+	}
+	b->pos = 0;
+	b->size = size;
+	return b;
+}
+
+
+/** return a buffer to the pool, or free it if the pool is full. */
+static void tls_rd_buf_release(tls_rd_buf_t *b)
+{
+	if(likely(tls_rd_buf_pool && b->cap == TLS_RD_BUF_POOL_CHUNK)) {
+		lock_get(&tls_rd_buf_pool->lock);
+		if(likely(tls_rd_buf_pool->count < TLS_RD_BUF_POOL_MAX)) {
+			tls_rd_buf_pool->free[tls_rd_buf_pool->count++] = b;
+			b = NULL;
+		}
+		lock_release(&tls_rd_buf_pool->lock);
+	}
+	if(b)
+		shm_free(b);
+}
+
 
 /* debugging */
 #ifdef NO_TLS_RD_DEBUG
@@ -698,7 +797,7 @@ void tls_h_tcpconn_clean_f(struct tcp_connection *c)
 		if(extra->ct_wq)
 			tls_ct_wq_free(&extra->ct_wq);
 		if(extra->enc_rd_buf) {
-			shm_free(extra->enc_rd_buf);
+			tls_rd_buf_release(extra->enc_rd_buf);
 			extra->enc_rd_buf = 0;
 		}
 		shm_free(c->extra_data);
@@ -1175,7 +1274,7 @@ redo_read:
 		if(unlikely(enc_rd_buf)) {
 			TLS_RD_TRACE("(%p, %p) reset prev. used enc_rd_buf (%p)\n", c,
 					flags, enc_rd_buf);
-			shm_free(enc_rd_buf);
+			tls_rd_buf_release(enc_rd_buf);
 			enc_rd_buf = 0;
 		}
 		/* real read() */
@@ -1483,17 +1582,13 @@ continue_ssl_read:
 			if(likely(!enc_rd_buf)) {
 				TLS_RD_TRACE("(%p, %p) creating enc_rd_buf (for %d bytes)\n", c,
 						flags, rd.used - rd.pos);
-				enc_rd_buf =
-						shm_malloc(sizeof(*enc_rd_buf) - sizeof(enc_rd_buf->buf)
-								   + rd.used - rd.pos);
+				enc_rd_buf = tls_rd_buf_new(rd.used - rd.pos);
 				if(unlikely(enc_rd_buf == 0)) {
 					ERR("memory allocation error (%d bytes requested)\n",
 							(int)(sizeof(*enc_rd_buf) + sizeof(enc_rd_buf->buf)
 									+ rd.used - rd.pos));
 					goto error;
 				}
-				enc_rd_buf->pos = 0;
-				enc_rd_buf->size = rd.used - rd.pos;
 				memcpy(enc_rd_buf->buf, rd.buf + rd.pos, enc_rd_buf->size);
 			} else if((enc_rd_buf->buf + enc_rd_buf->pos) == rd.buf) {
 				TLS_RD_TRACE("(%p, %p) enc_rd_buf already in use,"
@@ -1550,14 +1645,14 @@ continue_ssl_read:
 
 end:
 	if(enc_rd_buf)
-		shm_free(enc_rd_buf);
+		tls_rd_buf_release(enc_rd_buf);
 	TLS_RD_TRACE(
 			"(%p, %p) end => %d (*flags=%d)\n", c, flags, ssl_read, *flags);
 	return ssl_read;
 ssl_eof:
 	/* behave as an EOF would have been received at the tcp level */
 	if(enc_rd_buf)
-		shm_free(enc_rd_buf);
+		tls_rd_buf_release(enc_rd_buf);
 	c->state = S_CONN_EOF;
 	*flags |= RD_CONN_EOF;
 	TLS_RD_TRACE(
@@ -1567,7 +1662,7 @@ error_send:
 error:
 bug:
 	if(enc_rd_buf)
-		shm_free(enc_rd_buf);
+		tls_rd_buf_release(enc_rd_buf);
 	r->error = TCP_READ_ERROR;
 	TLS_RD_TRACE("(%p, %p) end error => %d (*flags=%d)\n", c, flags, ssl_read,
 			*flags);
@@ -46,9 +46,16 @@ typedef struct tls_rd_buf
 {
 	unsigned int pos;  /* current position */
 	unsigned int size; /* total size (buf) */
+	unsigned int cap;  /* allocated size of buf */
 	unsigned char buf[1];
 } tls_rd_buf_t;
 
+/*
+ * shm pool of reusable tls_rd_buf chunks
+ */
+int tls_rd_buf_pool_init(void);
+void tls_rd_buf_pool_destroy(void);
+
 /* tls conn flags */
 #define F_TLS_CON_WR_WANTS_RD 1	  /* write wants read */
 #define F_TLS_CON_HANDSHAKED 2	  /* connection is handshaked */
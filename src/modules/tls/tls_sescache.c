@@ -0,0 +1,445 @@
+/*
+ * TLS module
+ *
+ * Copyright (C) 2026 kamailio.org
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** shared memory TLS session resumption cache.
+ * The per-process SSL_CTX internal caches cannot resume a session when the
+ * client reconnects to a different worker. This cache keeps the sessions
+ * DER-encoded in shm, attached via the external session callbacks, and
+ * shares a pair of rotating session ticket keys between all workers.
+ * @file tls_sescache.c
+ * @ingroup tls
+ * Module: @ref tls
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include <openssl/ssl.h>
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#if OPENSSL_VERSION_NUMBER >= 0x030000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+#include "../../core/dprint.h"
+#include "../../core/locking.h"
+#include "../../core/hashes.h"
+#include "../../core/mem/shm_mem.h"
+#include "tls_sescache.h"
+
+/* refuse to cache absurdly large sessions (DER encoded) */
+#define TLS_SCACHE_MAX_SESSION 16384
+
+#define TLS_TICKET_NAME_LEN 16
+#define TLS_TICKET_HMAC_KEY_LEN 32
+#define TLS_TICKET_AES_KEY_LEN 32
+
+typedef struct tls_scache_entry
+{
+	unsigned int hashv;
+	int id_len;
+	unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+	time_t expires;
+	int data_len; /* DER encoded session follows the struct */
+	struct tls_scache_entry *next;
+} tls_scache_entry_t;
+
+#define TLS_SCACHE_DATA(e) ((unsigned char *)((e) + 1))
+
+typedef struct tls_ticket_key
+{
+	unsigned char name[TLS_TICKET_NAME_LEN];
+	unsigned char hmac_key[TLS_TICKET_HMAC_KEY_LEN];
+	unsigned char aes_key[TLS_TICKET_AES_KEY_LEN];
+	time_t created;
+} tls_ticket_key_t;
+
+typedef struct tls_scache
+{
+	gen_lock_t lock;
+	int size; /* number of hash slots == maximum number of entries */
+	int ticket_key_lifetime; /* seconds, 0 - no shared ticket keys */
+	tls_ticket_key_t tkeys[2]; /* [0] - current, [1] - previous */
+	tls_scache_stats_t stats;
+	tls_scache_entry_t **slots;
+} tls_scache_t;
+
+static tls_scache_t *tls_scache = NULL;
+
+
+static int tls_ticket_key_gen(tls_ticket_key_t *key)
+{
+	if(RAND_bytes(key->name, TLS_TICKET_NAME_LEN) <= 0
+			|| RAND_bytes(key->hmac_key, TLS_TICKET_HMAC_KEY_LEN) <= 0
+			|| RAND_bytes(key->aes_key, TLS_TICKET_AES_KEY_LEN) <= 0)
+		return -1;
+	key->created = time(0);
+	return 0;
+}
+
+
+/** rotate the shared ticket keys if the current one is too old.
+ * Must be called with the cache lock held. The previous key is kept so
+ * that tickets issued just before the rotation can still be decrypted
+ * (and transparently renewed with the current key).
+ */
+static void tls_ticket_keys_rotate(time_t now)
+{
+	if(tls_scache->ticket_key_lifetime <= 0)
+		return;
+	if(now - tls_scache->tkeys[0].created
+			< tls_scache->ticket_key_lifetime)
+		return;
+	tls_scache->tkeys[1] = tls_scache->tkeys[0];
+	if(tls_ticket_key_gen(&tls_scache->tkeys[0]) < 0) {
+		/* out of randomness: keep the old key and retry on next use */
+		tls_scache->tkeys[0] = tls_scache->tkeys[1];
+		ERR("failed to generate a new session ticket key\n");
+	}
+}
+
+
+/** unlink and free an entry; the cache lock must be held. */
+static void tls_scache_entry_del(tls_scache_entry_t **prev_next)
+{
+	tls_scache_entry_t *e;
+
+	e = *prev_next;
+	*prev_next = e->next;
+	shm_free(e);
+	tls_scache->stats.entries--;
+}
+
+
+/** remove the session with the given id, if cached; lock must be held. */
+static void tls_scache_del_id(const unsigned char *id, int id_len)
+{
+	unsigned int hashv;
+	tls_scache_entry_t **pn;
+
+	hashv = get_hash1_raw((char *)id, id_len);
+	pn = &tls_scache->slots[hashv % tls_scache->size];
+	while(*pn) {
+		if((*pn)->hashv == hashv && (*pn)->id_len == id_len
+				&& memcmp((*pn)->id, id, id_len) == 0) {
+			tls_scache_entry_del(pn);
+			return;
+		}
+		pn = &(*pn)->next;
+	}
+}
+
+
+/** openssl new-session callback: serialize the session into shm. */
+static int tls_scache_new_cb(SSL *ssl, SSL_SESSION *sess)
+{
+	const unsigned char *id;
+	unsigned int id_len;
+	unsigned char *p;
+	int data_len;
+	time_t now;
+	tls_scache_entry_t *e;
+	tls_scache_entry_t **pn;
+
+	id = SSL_SESSION_get_id(sess, &id_len);
+	if(id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+		return 0;
+	data_len = i2d_SSL_SESSION(sess, NULL);
+	if(data_len <= 0 || data_len > TLS_SCACHE_MAX_SESSION)
+		return 0;
+	e = shm_malloc(sizeof(tls_scache_entry_t) + data_len);
+	if(e == NULL) {
+		SHM_MEM_ERROR;
+		return 0;
+	}
+	e->hashv = get_hash1_raw((char *)id, id_len);
+	e->id_len = id_len;
+	memcpy(e->id, id, id_len);
+	e->data_len = data_len;
+	e->expires = SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+	p = TLS_SCACHE_DATA(e);
+	i2d_SSL_SESSION(sess, &p);
+
+	now = time(0);
+	lock_get(&tls_scache->lock);
+	/* re-add replaces a cached session with the same id */
+	tls_scache_del_id(id, id_len);
+	pn = &tls_scache->slots[e->hashv % tls_scache->size];
+	if(tls_scache->stats.entries >= tls_scache->size) {
+		/* full: drop an expired or the oldest entry from this slot,
+		 * or refuse if the slot is empty */
+		if(*pn == NULL) {
+			lock_release(&tls_scache->lock);
+			shm_free(e);
+			return 0;
+		}
+		while((*pn)->next && (*pn)->expires > now)
+			pn = &(*pn)->next;
+		tls_scache_entry_del(pn);
+		tls_scache->stats.evicted++;
+		pn = &tls_scache->slots[e->hashv % tls_scache->size];
+	}
+	e->next = *pn;
+	*pn = e;
+	tls_scache->stats.entries++;
+	tls_scache->stats.stored++;
+	lock_release(&tls_scache->lock);
+	/* return 0 - we keep no reference on the SSL_SESSION */
+	return 0;
+}
+
+
+/** openssl get-session callback: look up and decode a cached session. */
+static SSL_SESSION *tls_scache_get_cb(
+		SSL *ssl, const unsigned char *id, int id_len, int *copy)
+{
+	unsigned int hashv;
+	const unsigned char *p;
+	time_t now;
+	SSL_SESSION *sess;
+	tls_scache_entry_t **pn;
+
+	*copy = 0;
+	sess = NULL;
+	now = time(0);
+	hashv = get_hash1_raw((char *)id, id_len);
+	lock_get(&tls_scache->lock);
+	pn = &tls_scache->slots[hashv % tls_scache->size];
+	while(*pn) {
+		if((*pn)->hashv == hashv && (*pn)->id_len == id_len
+				&& memcmp((*pn)->id, id, id_len) == 0) {
+			if((*pn)->expires <= now) {
+				tls_scache_entry_del(pn);
+				tls_scache->stats.evicted++;
+				break;
+			}
+			/* decode while holding the lock - the entry may be freed by
+			 * another process as soon as it is released */
+			p = TLS_SCACHE_DATA(*pn);
+			sess = d2i_SSL_SESSION(NULL, &p, (*pn)->data_len);
+			break;
+		}
+		pn = &(*pn)->next;
+	}
+	if(sess)
+		tls_scache->stats.hits++;
+	else
+		tls_scache->stats.misses++;
+	lock_release(&tls_scache->lock);
+	return sess;
+}
+
+
+/** openssl remove-session callback: drop an invalidated session. */
+static void tls_scache_remove_cb(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+	const unsigned char *id;
+	unsigned int id_len;
+	int entries;
+
+	id = SSL_SESSION_get_id(sess, &id_len);
+	if(id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+		return;
+	lock_get(&tls_scache->lock);
+	entries = tls_scache->stats.entries;
+	tls_scache_del_id(id, id_len);
+	if(tls_scache->stats.entries < entries)
+		tls_scache->stats.removed++;
+	lock_release(&tls_scache->lock);
+}
+
+
+/** session ticket key callback using the shared rotating keys.
+ * Returns for decryption 1 when the ticket was protected with the current
+ * key and 2 when it was protected with the previous key, making openssl
+ * send the client a ticket re-encrypted with the current key.
+ */
+#if OPENSSL_VERSION_NUMBER >= 0x030000000L
+static int tls_scache_ticket_cb(SSL *ssl, unsigned char key_name[16],
+		unsigned char iv[EVP_MAX_IV_LENGTH], EVP_CIPHER_CTX *ectx,
+		EVP_MAC_CTX *hctx, int enc)
+#else
+static int tls_scache_ticket_cb(SSL *ssl, unsigned char key_name[16],
+		unsigned char iv[EVP_MAX_IV_LENGTH], EVP_CIPHER_CTX *ectx,
+		HMAC_CTX *hctx, int enc)
+#endif
+{
+	int ki;
+	tls_ticket_key_t key;
+#if OPENSSL_VERSION_NUMBER >= 0x030000000L
+	OSSL_PARAM params[3];
+#endif
+
+	/* copy the key material out under the lock; the openssl calls below
+	 * must not be made while holding it */
+	lock_get(&tls_scache->lock);
+	tls_ticket_keys_rotate(time(0));
+	if(enc) {
+		ki = 0;
+		tls_scache->stats.tickets_issued++;
+	} else {
+		for(ki = 0; ki < 2; ki++) {
+			if(tls_scache->tkeys[ki].created != 0
+					&& memcmp(key_name, tls_scache->tkeys[ki].name,
+							   TLS_TICKET_NAME_LEN)
+							   == 0)
+				break;
+		}
+		if(ki >= 2) {
+			/* unknown key (rotated out) - full handshake */
+			lock_release(&tls_scache->lock);
+			return 0;
+		}
+		if(ki == 0)
+			tls_scache->stats.tickets_resumed++;
+		else
+			tls_scache->stats.tickets_renewed++;
+	}
+	key = tls_scache->tkeys[ki];
+	lock_release(&tls_scache->lock);
+
+#if OPENSSL_VERSION_NUMBER >= 0x030000000L
+	params[0] = OSSL_PARAM_construct_octet_string(
+			OSSL_MAC_PARAM_KEY, key.hmac_key, TLS_TICKET_HMAC_KEY_LEN);
+	params[1] = OSSL_PARAM_construct_utf8_string(
+			OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+	params[2] = OSSL_PARAM_construct_end();
+	if(EVP_MAC_CTX_set_params(hctx, params) <= 0)
+		return -1;
+#else
+	if(HMAC_Init_ex(hctx, key.hmac_key, TLS_TICKET_HMAC_KEY_LEN,
+			   EVP_sha256(), NULL)
+			<= 0)
+		return -1;
+#endif
+	if(enc) {
+		if(RAND_bytes(iv, EVP_MAX_IV_LENGTH) <= 0)
+			return -1;
+		if(EVP_EncryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, key.aes_key, iv)
+				<= 0)
+			return -1;
+		memcpy(key_name, key.name, TLS_TICKET_NAME_LEN);
+		return 1;
+	}
+	if(EVP_DecryptInit_ex(ectx, EVP_aes_256_cbc(), NULL, key.aes_key, iv)
+			<= 0)
+		return -1;
+	return (ki == 0) ? 1 : 2;
+}
+
+
+/** initialize the shared session cache (before forking).
+ * @param size maximum number of cached sessions (and hash size)
+ * @param ticket_key_lifetime rotation period in s, 0 disables shared
+ *        ticket keys
+ * @return 0 on success, -1 on error
+ */
+int tls_scache_init(int size, int ticket_key_lifetime)
+{
+	if(tls_scache)
+		return 0;
+	if(size <= 0) {
+		ERR("invalid session cache size %d\n", size);
+		return -1;
+	}
+	tls_scache = shm_malloc(
+			sizeof(tls_scache_t) + size * sizeof(tls_scache_entry_t *));
+	if(tls_scache == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(tls_scache, 0,
+			sizeof(tls_scache_t) + size * sizeof(tls_scache_entry_t *));
+	if(lock_init(&tls_scache->lock) == 0) {
+		shm_free(tls_scache);
+		tls_scache = NULL;
+		ERR("failed to initialize the session cache lock\n");
+		return -1;
+	}
+	tls_scache->size = size;
+	tls_scache->ticket_key_lifetime = ticket_key_lifetime;
+	tls_scache->slots = (tls_scache_entry_t **)(tls_scache + 1);
+	if(ticket_key_lifetime > 0
+			&& tls_ticket_key_gen(&tls_scache->tkeys[0]) < 0) {
+		lock_destroy(&tls_scache->lock);
+		shm_free(tls_scache);
+		tls_scache = NULL;
+		ERR("failed to generate the initial session ticket key\n");
+		return -1;
+	}
+	return 0;
+}
+
+
+void tls_scache_destroy(void)
+{
+	int i;
+	tls_scache_entry_t *e;
+	tls_scache_entry_t *next;
+
+	if(tls_scache == NULL)
+		return;
+	for(i = 0; i < tls_scache->size; i++) {
+		for(e = tls_scache->slots[i]; e; e = next) {
+			next = e->next;
+			shm_free(e);
+		}
+	}
+	lock_destroy(&tls_scache->lock);
+	shm_free(tls_scache);
+	tls_scache = NULL;
+}
+
+
+int tls_scache_active(void)
+{
+	return tls_scache != NULL;
+}
+
+
+/** switch a SSL_CTX from the internal cache to the shared one. */
+void tls_scache_attach_ctx(SSL_CTX *ctx)
+{
+	SSL_CTX_set_session_cache_mode(
+			ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+	SSL_CTX_sess_set_new_cb(ctx, tls_scache_new_cb);
+	SSL_CTX_sess_set_get_cb(ctx, tls_scache_get_cb);
+	SSL_CTX_sess_set_remove_cb(ctx, tls_scache_remove_cb);
+	if(tls_scache->ticket_key_lifetime > 0) {
+#if OPENSSL_VERSION_NUMBER >= 0x030000000L
+		SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, tls_scache_ticket_cb);
+#else
+		SSL_CTX_set_tlsext_ticket_key_cb(ctx, tls_scache_ticket_cb);
+#endif
+	}
+}
+
+
+int tls_scache_get_stats(tls_scache_stats_t *stats)
+{
+	if(tls_scache == NULL)
+		return -1;
+	lock_get(&tls_scache->lock);
+	*stats = tls_scache->stats;
+	lock_release(&tls_scache->lock);
+	return 0;
+}
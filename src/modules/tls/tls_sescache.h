@@ -0,0 +1,54 @@
+/*
+ * TLS module
+ *
+ * Copyright (C) 2026 kamailio.org
+ *
+ * This file is part of Kamailio, a free SIP server.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/** shared memory TLS session resumption cache.
+ * Sessions and ticket keys are kept in shm so that a client reconnecting
+ * to a different worker process can still resume its previous session.
+ * @file tls_sescache.h
+ * @ingroup tls
+ * Module: @ref tls
+ */
+
+#ifndef __tls_sescache_h
+#define __tls_sescache_h
+
+#include <openssl/ssl.h>
+
+/* resumption counters, all updated under the cache lock */
+typedef struct tls_scache_stats
+{
+	unsigned int stored;  /* sessions added to the cache */
+	unsigned int hits;	  /* session id lookups that found an entry */
+	unsigned int misses;  /* session id lookups that found nothing */
+	unsigned int removed; /* sessions removed (invalidated by openssl) */
+	unsigned int evicted; /* sessions dropped (expired or cache full) */
+	unsigned int tickets_issued;  /* tickets encrypted with the current key */
+	unsigned int tickets_resumed; /* tickets decrypted with the current key */
+	unsigned int tickets_renewed; /* tickets decrypted with the previous key
+								     (the client gets a fresh ticket) */
+	int entries;				  /* current number of cached sessions */
+} tls_scache_stats_t;
+
+int tls_scache_init(int size, int ticket_key_lifetime);
+void tls_scache_destroy(void);
+int tls_scache_active(void);
+void tls_scache_attach_ctx(SSL_CTX *ctx);
+int tls_scache_get_stats(tls_scache_stats_t *stats);
+
+#endif /*__tls_sescache_h*/
@@ -97,7 +97,6 @@ error:
 
 static const char *tls_list_doc[2] = {"List currently open TLS connections", 0};
 
-extern gen_lock_t *tcpconn_lock;
 extern struct tcp_connection **tcpconn_id_hash;
 
 static void tls_list(rpc_t *rpc, void *c)
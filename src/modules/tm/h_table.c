@@ -31,6 +31,7 @@
 
 
 #include "../../core/mem/shm_mem.h"
+#include "../../core/mem/zeroaudit.h"
 #include "../../core/hash_func.h"
 #include "../../core/dprint.h"
 #include "../../core/crypto/md5utils.h"
@@ -88,7 +89,16 @@ void lock_hash(int i)
 
 	mypid = my_pid();
 	if(likely(atomic_get(&_tm_table->entries[i].locker_pid) != mypid)) {
+#ifdef GEN_LOCK_T_PREFERED
+		if(unlikely(lock_try(&_tm_table->entries[i].mutex) != 0)) {
+			/* contended - account for it (approximate, unsynced counter)
+			 * and wait for the lock */
+			_tm_table->entries[i].lock_waits++;
+			lock(&_tm_table->entries[i].mutex);
+		}
+#else
 		lock(&_tm_table->entries[i].mutex);
+#endif
 		atomic_set(&_tm_table->entries[i].locker_pid, mypid);
 	} else {
 		/* locked within the same process that called us*/
@@ -116,7 +126,7 @@ unsigned int transaction_count(void)
 	unsigned int count;
 
 	count = 0;
-	for(i = 0; i < TABLE_ENTRIES; i++)
+	for(i = 0; i < _tm_table->size; i++)
 		count += _tm_table->entries[i].cur_entries;
 	return count;
 }
@@ -155,6 +165,16 @@ void free_cell_helper(
 	}
 	release_cell_lock(dead_cell); /* does nothing */
 
+	if(unlikely(dead_cell->flags & T_ASYNC_SUSPENDED)) {
+		/* suspended transaction dying without a t_continue()
+		 * (blind uac timeout or cancel) - close the suspend depth
+		 * accounting */
+		t_stats_suspend_ended();
+	}
+	if(likely(dead_cell->create_ticks != 0))
+		t_stats_lifetime(TICKS_TO_S(
+				(ticks_t)(get_ticks_raw() - dead_cell->create_ticks)));
+
 	dead_cell->fcount++;
 	if(dead_cell->fcount != 1) {
 		LM_WARN("unexpected fcount value: %d\n", dead_cell->fcount);
@@ -236,6 +256,9 @@ void free_cell_helper(
 		if(unlikely(dead_cell->uac[i].location_ua.s)) {
 			shm_free_unsafe(dead_cell->uac[i].location_ua.s);
 		}
+		if(dead_cell->uac[i].lw_prog) {
+			shm_free_unsafe(dead_cell->uac[i].lw_prog);
+		}
 	}
 
 	if(dead_cell->uac[0].local_ack)
@@ -266,6 +289,10 @@ void free_cell_helper(
 	if(dead_cell->xavis_list)
 		xavi_destroy_list_unsafe(&dead_cell->xavis_list);
 
+	ksr_zero_audit_check(dead_cell,
+			sizeof(tm_cell_t) + MD5_LEN - sizeof(((tm_cell_t *)0)->md5)
+					+ (sr_dst_max_branches * sizeof(struct ua_client)),
+			"tm_cell");
 	memset(dead_cell, 0, sizeof(tm_cell_t));
 	/* the cell's body */
 	shm_free_unsafe(dead_cell);
@@ -312,6 +339,10 @@ static void inline init_branches(struct cell *t)
 		uac->request.my_T = t;
 		uac->request.branch = i;
 		init_rb_timers(&uac->request);
+		/* pin to the creating worker's wheel (copied into local_cancel
+		 * below) - see the comment in build_cell() */
+		timer_set_pinned_wheel(
+				&uac->request.timer, process_no > 0 ? process_no : 0);
 		uac->local_cancel = uac->request;
 #ifdef USE_DNS_FAILOVER
 		dns_srv_handle_init(&uac->dns_h);
@@ -352,6 +383,15 @@ struct cell *build_cell(struct sip_msg *p_msg)
 	new_cell->uac = T_UAC_PTR(new_cell);
 	/* timers */
 	init_cell_timers(new_cell);
+	/* pin all the transaction timers to the wheel of the worker creating
+	 * the transaction - re-arms from other processes (reply workers, the
+	 * timer process) then stay on this wheel instead of migrating to
+	 * other, contended ones and the expiries of one transaction are
+	 * handled together */
+	timer_set_pinned_wheel(
+			&new_cell->uas.response.timer, process_no > 0 ? process_no : 0);
+	timer_set_pinned_wheel(
+			&new_cell->wait_timer, process_no > 0 ? process_no : 0);
 
 	old = set_avp_list(
 			AVP_TRACK_FROM | AVP_CLASS_URI, &new_cell->uri_avps_from);
@@ -403,6 +443,7 @@ struct cell *build_cell(struct sip_msg *p_msg)
 			goto error;
 		new_cell->uas.end_request =
 				((char *)new_cell->uas.request) + sip_msg_len;
+		tm_cell_set_match_hashes(new_cell, p_msg);
 	}
 
 	/* UAC */
@@ -411,6 +452,8 @@ struct cell *build_cell(struct sip_msg *p_msg)
 	new_cell->relayed_reply_branch = -1;
 	/* new_cell->T_canceled = T_UNDEFINED; */
 
+	new_cell->create_ticks = get_ticks_raw();
+
 	init_synonym_id(p_msg, new_cell->md5);
 	init_cell_lock(new_cell);
 	t_stats_created();
@@ -464,7 +507,7 @@ void free_hash_table()
 
 	if(_tm_table) {
 		/* remove the data contained by each entry */
-		for(i = 0; i < TABLE_ENTRIES; i++) {
+		for(i = 0; i < _tm_table->size; i++) {
 			release_entry_lock((_tm_table->entries) + i);
 			/* delete all synonyms at hash-collision-slot i */
 			clist_foreach_safe(&_tm_table->entries[i], p_cell, tmp_cell, next_c)
@@ -484,21 +527,25 @@ struct s_table *init_hash_table()
 {
 	int i;
 
-	/*allocs the table*/
-	_tm_table = (struct s_table *)shm_malloc(sizeof(struct s_table));
+	/*allocs the table - entries[] is sized at runtime (tm "hash_size")*/
+	_tm_table = (struct s_table *)shm_malloc(sizeof(struct s_table)
+			+ ksr_tm_table_entries * sizeof(struct entry));
 	if(!_tm_table) {
 		SHM_MEM_ERROR;
 		goto error0;
 	}
 
-	memset(_tm_table, 0, sizeof(struct s_table));
+	memset(_tm_table, 0,
+			sizeof(struct s_table)
+					+ ksr_tm_table_entries * sizeof(struct entry));
+	_tm_table->size = ksr_tm_table_entries;
 
 	/* try first allocating all the structures needed for syncing */
 	if(lock_initialize() == -1)
 		goto error1;
 
 	/* inits the entriess */
-	for(i = 0; i < TABLE_ENTRIES; i++) {
+	for(i = 0; i < _tm_table->size; i++) {
 		init_entry_lock(_tm_table, (_tm_table->entries) + i);
 		_tm_table->entries[i].next_label = kam_rand();
 		/* init cell list */
@@ -629,7 +676,7 @@ void tm_clean_lifetime(void)
 
 	texp = get_ticks_raw() - S_TO_TICKS(TM_LIFETIME_LIMIT);
 
-	for(r = 0; r < TABLE_ENTRIES; r++) {
+	for(r = 0; r < _tm_table->size; r++) {
 		/* faster first try without lock */
 		if(clist_empty(&_tm_table->entries[r], next_c)) {
 			continue;
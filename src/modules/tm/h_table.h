@@ -62,6 +62,7 @@ struct timer;
 struct retr_buf;
 struct ua_client;
 struct async_state;
+struct tm_lw_prog;
 
 #include "../../core/mem/shm_mem.h"
 #include "lock.h"
@@ -208,6 +209,9 @@ typedef struct ua_client
 	str instance;
 	str ruid;
 	str location_ua;
+	/* cached gather program for building local ACK/CANCEL from
+	 * request.buffer, lazily filled by build_local_reparse() (in shm) */
+	struct tm_lw_prog *lw_prog;
 	/* if we don't store, we at least want to know the status */
 	int last_received;
 
@@ -250,6 +254,7 @@ typedef struct async_state
 	unsigned int backup_branch;
 	unsigned int blind_uac;
 	unsigned int ruri_new;
+	ticks_t suspend_ticks; /* when t_suspend() parked the transaction */
 } tm_async_state_t;
 
 /* transaction's flags */
@@ -383,12 +388,22 @@ typedef struct cell
 	 * original message; needed for reply matching */
 	str method;
 
+	/* prefilter hashes for the hash chain walks in t_lookup: hash of the
+	 * Call-ID body and the topmost Via mhash (branch value + host, as
+	 * precomputed by parse_via()); together they give a 64-bit integer
+	 * reject test that skips the string comparisons (and the uas.request
+	 * dereference) for non-matching cells on long chains;
+	 * 0 = not available, never a prefilter mismatch */
+	unsigned int callid_hash;
+	unsigned int vbranch_hash;
+
 	/* head of callback list */
 	struct tmcb_head_list tmcb_hl;
 
 	/* bindings to wait and delete timer */
 	struct timer_ln wait_timer; /* used also for delete */
 	ticks_t wait_start;			/* ticks when put on wait first time */
+	ticks_t create_ticks;		/* ticks when the cell was built */
 
 	/* UA Server */
 	struct ua_server uas;
@@ -471,6 +486,8 @@ typedef struct entry
 	ser_lock_t mutex;
 	atomic_t locker_pid; /* pid of the process that holds the lock */
 	int rec_lock_level;	 /* recursive lock count */
+	unsigned long lock_waits; /* contended lock_hash() calls (approx.,
+							   * updated without sync) */
 	/* currently highest sequence number in a synonym list */
 	unsigned int next_label;
 #ifdef TM_HASH_STATS
@@ -484,8 +501,9 @@ typedef struct entry
 /* transaction table */
 typedef struct s_table
 {
+	unsigned int size; /* number of hash entries (ksr_tm_table_entries) */
 	/* table of hash entries; each of them is a list of synonyms  */
-	struct entry entries[TABLE_ENTRIES];
+	struct entry entries[];
 } s_table_t;
 
 /* pointer to the big table where all the transaction data lives */
@@ -536,6 +554,21 @@ void free_cell_helper(tm_cell_t *dead_cell, int silent, const char *fname,
 
 struct cell *build_cell(struct sip_msg *p_msg);
 
+/* fill in the matching prefilter hashes of a cell from its (parsed)
+ * uas request; 0 stays reserved for "hash not available" */
+inline static void tm_cell_set_match_hashes(
+		struct cell *p_cell, struct sip_msg *req)
+{
+	if(likely(req->callid)) {
+		p_cell->callid_hash =
+				get_hash1_raw(req->callid->body.s, req->callid->body.len);
+		if(unlikely(p_cell->callid_hash == 0))
+			p_cell->callid_hash = 1;
+	}
+	if(likely(req->via1))
+		p_cell->vbranch_hash = req->via1->mhash;
+}
+
 #ifdef TM_HASH_STATS
 unsigned int transaction_count(void);
 #endif
@@ -51,7 +51,249 @@
 #include "../../core/data_lump_rpl.h"
 #include "../../core/ut.h"
 #include "../../core/sip_msg_clone.h"
+#include "../../core/msg_translator.h"
 #include "../../core/fix_lumps.h"
+#include "../../core/parser/parse_hname2.h"
+#include "../../core/parser/parse_from.h"
+
+
+/* retention whitelist for header-pruned cloning (clone_retain_hdrs modparam):
+ * when set, requests are re-assembled from the request line, the whitelisted
+ * headers and the body before shm cloning, so the transaction does not keep
+ * the full received buffer and all parsed headers alive in shm */
+static hdr_flags_t tm_clone_retain_mask = 0;
+#define TM_CLONE_OTHER_MAX 8
+static str tm_clone_other_hdrs[TM_CLONE_OTHER_MAX];
+static int tm_clone_other_no = 0;
+
+/* headers tm itself needs for matching, local reply building and
+ * failure route forwarding - always retained when pruning */
+#define TM_CLONE_NEEDED_HDRS                                              \
+	(HDR_VIA_F | HDR_VIA2_F | HDR_FROM_F | HDR_TO_F | HDR_CALLID_F        \
+			| HDR_CSEQ_F | HDR_ROUTE_F | HDR_RECORDROUTE_F                \
+			| HDR_MAXFORWARDS_F | HDR_CONTENTLENGTH_F | HDR_CONTENTTYPE_F \
+			| HDR_CONTACT_F)
+
+/* map of the retained regions of the last pruned buffer, needed for
+ * translating the lump offsets when they are shm-ized later
+ * (save_msg_lumps() runs in the same process, on the same pkg msg) */
+#define TM_PRUNE_REGIONS_MAX 64
+typedef struct tm_prune_region
+{
+	int org_off;
+	int new_off;
+	int len;
+} tm_prune_region_t;
+
+static struct
+{
+	unsigned int msg_id;
+	int valid;
+	int n;
+	tm_prune_region_t regs[TM_PRUNE_REGIONS_MAX];
+} tm_prune_map = {0};
+
+
+/**
+ * @brief Parse and store the clone header retention whitelist
+ * @param hdrs comma/space separated header names (clone_retain_hdrs modparam)
+ * @return 0 on success, -1 on bad header name or too many custom headers
+ */
+int tm_clone_prune_init(char *hdrs)
+{
+	str name;
+	hdr_field_t hf;
+	char *p;
+
+	if(hdrs == NULL || *hdrs == '\0')
+		return 0;
+	p = hdrs;
+	while(*p) {
+		while(*p == ' ' || *p == '\t' || *p == ',' || *p == ';')
+			p++;
+		if(*p == '\0')
+			break;
+		name.s = p;
+		while(*p && *p != ' ' && *p != '\t' && *p != ',' && *p != ';')
+			p++;
+		name.len = p - name.s;
+		parse_hname2_str(&name, &hf);
+		if(hf.type == HDR_ERROR_T) {
+			LM_ERR("bad header name in clone_retain_hdrs: %.*s\n", name.len,
+					name.s);
+			return -1;
+		}
+		if(hf.type == HDR_OTHER_T) {
+			if(tm_clone_other_no >= TM_CLONE_OTHER_MAX) {
+				LM_ERR("too many custom headers in clone_retain_hdrs"
+					   " (max %d)\n",
+						TM_CLONE_OTHER_MAX);
+				return -1;
+			}
+			/* name points into the modparam string - persistent */
+			tm_clone_other_hdrs[tm_clone_other_no++] = name;
+		} else {
+			tm_clone_retain_mask |= HDR_T2F(hf.type);
+		}
+	}
+	tm_clone_retain_mask |= TM_CLONE_NEEDED_HDRS;
+	return 0;
+}
+
+
+/* is a HDR_OTHER_T header on the retention whitelist? */
+static inline int tm_clone_other_retained(str *name)
+{
+	int i;
+
+	for(i = 0; i < tm_clone_other_no; i++) {
+		if(name->len == tm_clone_other_hdrs[i].len
+				&& strncasecmp(name->s, tm_clone_other_hdrs[i].s, name->len)
+						   == 0)
+			return 1;
+	}
+	return 0;
+}
+
+
+/** Creates a header-pruned shm clone of a request.
+ * The received buffer is re-assembled from the request line, the retained
+ * headers and the body, the result is re-parsed and cloned with
+ * sip_msg_shm_clone(); non-retained headers simply do not exist on the
+ * cloned message (they can not be read in failure routes). The retained
+ * region map is recorded so save_msg_lumps() can translate the lump
+ * offsets onto the pruned buffer.
+ * @return the clone, or NULL if pruning does not apply (the caller falls
+ * back to the full clone) or on error
+ */
+static struct sip_msg *sip_msg_shm_clone_pruned(
+		struct sip_msg *org_msg, int *sip_msg_len)
+{
+	struct sip_msg tmp;
+	struct sip_msg *res;
+	struct hdr_field *hdr;
+	tm_prune_region_t *reg;
+	char *nbuf;
+	int nlen;
+	int hoff, hend, hend_max;
+	int dropped;
+	int i;
+
+	tm_prune_map.valid = 0;
+	if(unlikely(parse_headers(org_msg, HDR_EOH_F, 0) < 0))
+		return 0;
+	if(unlikely(org_msg->headers == NULL
+				|| org_msg->headers->name.s <= org_msg->buf))
+		return 0;
+
+	/* collect the retained regions of the received buffer, in order:
+	 * the request line, the whitelisted headers, the body */
+	tm_prune_map.n = 1;
+	tm_prune_map.regs[0].org_off = 0;
+	tm_prune_map.regs[0].len = org_msg->headers->name.s - org_msg->buf;
+	dropped = 0;
+	hend_max = tm_prune_map.regs[0].len;
+	for(hdr = org_msg->headers; hdr; hdr = hdr->next) {
+		hoff = hdr->name.s - org_msg->buf;
+		hend = hoff + hdr->len;
+		if(unlikely(hoff < 0 || hend > org_msg->len || hoff < hend_max))
+			return 0; /* not a plain in-order header - be safe */
+		hend_max = hend;
+		if(hdr->type == HDR_EOH_T)
+			break;
+		if((HDR_T2F(hdr->type) & tm_clone_retain_mask) == 0
+				&& !(hdr->type == HDR_OTHER_T
+						&& tm_clone_other_retained(&hdr->name))) {
+			dropped = 1;
+			continue;
+		}
+		reg = &tm_prune_map.regs[tm_prune_map.n - 1];
+		if(reg->org_off + reg->len == hoff) {
+			reg->len += hdr->len; /* adjacent - extend */
+		} else {
+			if(unlikely(tm_prune_map.n >= TM_PRUNE_REGIONS_MAX))
+				return 0;
+			reg = &tm_prune_map.regs[tm_prune_map.n++];
+			reg->org_off = hoff;
+			reg->len = hdr->len;
+		}
+	}
+	if(!dropped)
+		return 0; /* nothing to prune - use the plain clone */
+	/* the end-of-headers line and the body */
+	if(hend_max < org_msg->len) {
+		reg = &tm_prune_map.regs[tm_prune_map.n - 1];
+		if(reg->org_off + reg->len == hend_max) {
+			reg->len += org_msg->len - hend_max;
+		} else {
+			if(unlikely(tm_prune_map.n >= TM_PRUNE_REGIONS_MAX))
+				return 0;
+			reg = &tm_prune_map.regs[tm_prune_map.n++];
+			reg->org_off = hend_max;
+			reg->len = org_msg->len - hend_max;
+		}
+	}
+
+	nlen = 0;
+	for(i = 0; i < tm_prune_map.n; i++) {
+		tm_prune_map.regs[i].new_off = nlen;
+		nlen += tm_prune_map.regs[i].len;
+	}
+	nbuf = pkg_malloc(nlen + 1);
+	if(nbuf == NULL) {
+		PKG_MEM_ERROR;
+		return 0;
+	}
+	for(i = 0; i < tm_prune_map.n; i++)
+		memcpy(nbuf + tm_prune_map.regs[i].new_off,
+				org_msg->buf + tm_prune_map.regs[i].org_off,
+				tm_prune_map.regs[i].len);
+	nbuf[nlen] = 0;
+
+	if(unlikely(build_sip_msg_from_buf(&tmp, nbuf, nlen, org_msg->id) != 0)) {
+		pkg_free(nbuf);
+		return 0;
+	}
+	if(unlikely(parse_headers(&tmp, HDR_EOH_F, 0) < 0
+				|| parse_from_header(&tmp) < 0)) {
+		/* the retained subset must stay parsable (From is needed
+		 * parsed for e2e ACK matching on the stored request) */
+		free_sip_msg(&tmp);
+		pkg_free(nbuf);
+		return 0;
+	}
+	/* carry over the state the transaction needs from the original */
+	tmp.rcv = org_msg->rcv;
+	tmp.flags = org_msg->flags;
+	tmp.msg_flags = org_msg->msg_flags | FL_HDR_PRUNED;
+	tmp.hash_index = org_msg->hash_index;
+	tmp.new_uri = org_msg->new_uri;
+	tmp.dst_uri = org_msg->dst_uri;
+	tmp.path_vec = org_msg->path_vec;
+	tmp.force_send_socket = org_msg->force_send_socket;
+	tmp.fwd_send_flags = org_msg->fwd_send_flags;
+	tmp.rpl_send_flags = org_msg->rpl_send_flags;
+	tmp.otcpid = org_msg->otcpid;
+
+	res = sip_msg_shm_clone(&tmp, sip_msg_len, 0);
+
+	/* the uri strs above are still owned by org_msg - detach before free */
+	tmp.new_uri.s = 0;
+	tmp.new_uri.len = 0;
+	tmp.dst_uri.s = 0;
+	tmp.dst_uri.len = 0;
+	tmp.path_vec.s = 0;
+	tmp.path_vec.len = 0;
+	free_sip_msg(&tmp);
+	pkg_free(nbuf);
+
+	if(likely(res != NULL)) {
+		tm_prune_map.msg_id = org_msg->id;
+		tm_prune_map.valid = 1;
+		LM_DBG("pruned clone: %d -> %d bytes\n", org_msg->len, nlen);
+	}
+	return res;
+}
 
 
 /**
@@ -64,11 +306,19 @@
  */
 struct sip_msg *sip_msg_cloner(struct sip_msg *org_msg, int *sip_msg_len)
 {
+	struct sip_msg *res;
+
 	/* take care of the lumps only for replies if the msg cloning is
 	   postponed */
 	if(org_msg->first_line.type == SIP_REPLY)
 		/*cloning all the lumps*/
 		return sip_msg_shm_clone(org_msg, sip_msg_len, 1);
+	if(unlikely(tm_clone_retain_mask != 0)) {
+		res = sip_msg_shm_clone_pruned(org_msg, sip_msg_len);
+		if(res != NULL)
+			return res;
+		/* pruning not applicable - fall through to the full clone */
+	}
 	/* don't clone the lumps */
 	return sip_msg_shm_clone(org_msg, sip_msg_len, 0);
 }
@@ -79,6 +329,44 @@ struct sip_msg *sip_msg_cloner(struct sip_msg *org_msg, int *sip_msg_len)
 unsigned char lumps_are_cloned = 0;
 
 
+/* translate an offset in the original received buffer to the pruned one;
+ * offsets inside dropped headers collapse to the start of the next
+ * retained region (monotonic, since the regions keep their order) */
+static inline int tm_prune_translate_offset(int off)
+{
+	int i;
+
+	for(i = 0; i < tm_prune_map.n; i++) {
+		if(off < tm_prune_map.regs[i].org_off)
+			return tm_prune_map.regs[i].new_off;
+		if(off < tm_prune_map.regs[i].org_off + tm_prune_map.regs[i].len)
+			return tm_prune_map.regs[i].new_off
+				   + (off - tm_prune_map.regs[i].org_off);
+	}
+	i = tm_prune_map.n - 1;
+	return tm_prune_map.regs[i].new_off + tm_prune_map.regs[i].len;
+}
+
+
+/* rewrite the anchor/del offsets of a (freshly shm-cloned) lump list so
+ * they refer to the pruned buffer; dels over dropped headers shrink to
+ * the surviving intersection (usually nothing - the bytes are gone) */
+static void tm_prune_translate_lumps(struct lump *l)
+{
+	int noff;
+
+	for(; l; l = l->next) {
+		if(l->op == LUMP_ADD || l->op == LUMP_ADD_SUBST
+				|| l->op == LUMP_ADD_OPT)
+			continue; /* no buffer offset */
+		noff = tm_prune_translate_offset(l->u.offset);
+		if(l->op == LUMP_DEL)
+			l->len = tm_prune_translate_offset(l->u.offset + l->len) - noff;
+		l->u.offset = noff;
+	}
+}
+
+
 /**
  * @brief Wrapper function for msg_lump_cloner() with some additional sanity checks
  * @param shm_msg SIP message in shared memory
@@ -126,6 +414,26 @@ int save_msg_lumps(struct sip_msg *shm_msg, struct sip_msg *pkg_msg)
 	lumps_are_cloned = 1;
 	ret = msg_lump_cloner(pkg_msg, &add_rm, &body_lumps, &reply_lump);
 	if(likely(ret == 0)) {
+		if(unlikely(shm_msg->msg_flags & FL_HDR_PRUNED)) {
+			/* the clone buffer is header-pruned; the lump offsets refer
+			 * to the original received buffer and must be remapped */
+			if(likely(tm_prune_map.valid
+						&& tm_prune_map.msg_id == pkg_msg->id)) {
+				tm_prune_translate_lumps(add_rm);
+				tm_prune_translate_lumps(body_lumps);
+			} else {
+				/* no region map for this message (should not happen in
+				 * the normal t_newtran()+t_relay() flow) - better lose
+				 * the lumps than corrupt the pruned buffer */
+				LM_WARN("no prune map for msg %u - dropping the lumps\n",
+						pkg_msg->id);
+				/* single block, linked to the first non-empty list */
+				shm_free(add_rm != NULL ? (void *)add_rm
+						: body_lumps != NULL ? (void *)body_lumps
+											 : (void *)reply_lump);
+				return 0;
+			}
+		}
 		/* make sure the lumps are fully written before adding them to
 		 * shm_msg (in case someone accesses it in the same time) */
 		membar_write();
@@ -98,6 +98,13 @@
  */
 struct sip_msg *sip_msg_cloner(struct sip_msg *org_msg, int *sip_msg_len);
 
+/**
+ * @brief Parse the clone header retention whitelist (clone_retain_hdrs)
+ * @param hdrs comma/space separated header names, NULL/empty disables pruning
+ * @return 0 on success, -1 on error
+ */
+int tm_clone_prune_init(char *hdrs);
+
 /**
  * @brief Indicates whether we have already cloned the msg lumps or not
  */
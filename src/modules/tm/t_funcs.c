@@ -89,6 +89,7 @@ int send_pr_buffer(struct retr_buf *rb, void *buf, int len
 
 void tm_shutdown()
 {
+	tm_retr_cache_destroy();
 	LM_DBG("done\n");
 }
 
@@ -320,6 +320,12 @@ static inline int ack_matching(struct cell *p_cell, struct sip_msg *p_msg)
 static inline int via_matching(
 		struct via_body *inv_via, struct via_body *ack_via)
 {
+	/* prefilter on the hash precomputed by parse_via() over branch value
+	 * and host - one int compare rejects non-matching vias without
+	 * touching the strings; full comparison below stays authoritative */
+	if(inv_via->mhash != 0 && ack_via->mhash != 0
+			&& inv_via->mhash != ack_via->mhash)
+		return 0;
 	if(inv_via->tid.len != ack_via->tid.len)
 		return 0;
 	if(memcmp(inv_via->tid.s, ack_via->tid.s, ack_via->tid.len) != 0)
@@ -397,6 +403,13 @@ static int matching_3261(struct sip_msg *p_msg, struct cell **trans,
 	clist_foreach(hash_bucket, p_cell, next_c)
 	{
 		prefetch_loc_r(p_cell->next_c, 1);
+		/* prefilter: for non-ACKs the tid must match, so a different Via
+		 * branch+host hash rejects the cell on one int compare, without
+		 * even loading uas.request (ACKs may legitimately carry another
+		 * branch - e2e ACK/2xx - and are matched the slow way below) */
+		if(likely(!is_ack) && p_cell->vbranch_hash != 0 && via1->mhash != 0
+				&& p_cell->vbranch_hash != via1->mhash)
+			continue;
 		t_msg = p_cell->uas.request;
 		if(unlikely(!t_msg))
 			continue; /*don't try matching UAC transactions */
@@ -525,6 +538,7 @@ int t_request_search(struct sip_msg *p_msg, struct cell **r_cell)
 {
 	struct cell *p_cell;
 	unsigned int isACK;
+	unsigned int cid_hash;
 	struct sip_msg *t_msg;
 	struct via_param *branch;
 	int match_status;
@@ -584,6 +598,11 @@ int t_request_search(struct sip_msg *p_msg, struct cell **r_cell)
 	 * a bit simplified to be fast -- we don't do all the comparisons
 	 * of parsed uri, which was simply too bloated */
 	LM_DBG("proceeding to pre-RFC3261 transaction matching\n");
+	/* the pre-3261 rules always compare the Call-ID => a hash mismatch
+	 * rejects a cell on one int compare */
+	cid_hash = get_hash1_raw(p_msg->callid->body.s, p_msg->callid->body.len);
+	if(unlikely(cid_hash == 0))
+		cid_hash = 1;
 	/* lock the whole entry*/
 	LOCK_HASH(p_msg->hash_index);
 
@@ -594,6 +613,8 @@ int t_request_search(struct sip_msg *p_msg, struct cell **r_cell)
 		clist_foreach(hash_bucket, p_cell, next_c)
 		{
 			prefetch_loc_r(p_cell->next_c, 1);
+			if(p_cell->callid_hash != 0 && p_cell->callid_hash != cid_hash)
+				continue; /* Call-ID differs for sure */
 			t_msg = p_cell->uas.request;
 			if(!t_msg)
 				continue; /* skip UAC transactions */
@@ -648,6 +669,8 @@ int t_request_search(struct sip_msg *p_msg, struct cell **r_cell)
 		clist_foreach(hash_bucket, p_cell, next_c)
 		{
 			prefetch_loc_r(p_cell->next_c, 1);
+			if(p_cell->callid_hash != 0 && p_cell->callid_hash != cid_hash)
+				continue; /* Call-ID differs for sure */
 			t_msg = p_cell->uas.request;
 			if(!t_msg)
 				continue; /* skip UAC transactions */
@@ -772,6 +795,7 @@ int t_lookup_request(struct sip_msg *p_msg, int leave_new_locked, int *cancel)
 {
 	struct cell *p_cell;
 	unsigned int isACK;
+	unsigned int cid_hash;
 	struct sip_msg *t_msg;
 	struct via_param *branch;
 	int match_status;
@@ -831,6 +855,11 @@ int t_lookup_request(struct sip_msg *p_msg, int leave_new_locked, int *cancel)
 	 * of parsed uri, which was simply too bloated */
 	LM_DBG("proceeding to pre-RFC3261 transaction matching\n");
 	*cancel = 0;
+	/* the pre-3261 rules always compare the Call-ID => a hash mismatch
+	 * rejects a cell on one int compare */
+	cid_hash = get_hash1_raw(p_msg->callid->body.s, p_msg->callid->body.len);
+	if(unlikely(cid_hash == 0))
+		cid_hash = 1;
 	/* lock the whole entry*/
 	LOCK_HASH(p_msg->hash_index);
 
@@ -841,6 +870,8 @@ int t_lookup_request(struct sip_msg *p_msg, int leave_new_locked, int *cancel)
 		clist_foreach(hash_bucket, p_cell, next_c)
 		{
 			prefetch_loc_r(p_cell->next_c, 1);
+			if(p_cell->callid_hash != 0 && p_cell->callid_hash != cid_hash)
+				continue; /* Call-ID differs for sure */
 			t_msg = p_cell->uas.request;
 			if(!t_msg)
 				continue; /* skip UAC transactions */
@@ -896,6 +927,8 @@ int t_lookup_request(struct sip_msg *p_msg, int leave_new_locked, int *cancel)
 		clist_foreach(hash_bucket, p_cell, next_c)
 		{
 			prefetch_loc_r(p_cell->next_c, 1);
+			if(p_cell->callid_hash != 0 && p_cell->callid_hash != cid_hash)
+				continue; /* Call-ID differs for sure */
 			t_msg = p_cell->uas.request;
 			if(!t_msg)
 				continue; /* skip UAC transactions */
@@ -1023,6 +1056,7 @@ struct cell *t_lookupOriginalT(struct sip_msg *p_msg)
 {
 	struct cell *p_cell;
 	unsigned int hash_index;
+	unsigned int cid_hash;
 	struct sip_msg *t_msg;
 	struct via_param *branch;
 	struct entry *hash_bucket;
@@ -1071,6 +1105,12 @@ struct cell *t_lookupOriginalT(struct sip_msg *p_msg)
 
 	/* no cookies --proceed to old-fashioned pre-3261 t-matching */
 
+	/* the pre-3261 rules always compare the Call-ID => a hash mismatch
+	 * rejects a cell on one int compare */
+	cid_hash = get_hash1_raw(p_msg->callid->body.s, p_msg->callid->body.len);
+	if(unlikely(cid_hash == 0))
+		cid_hash = 1;
+
 	LOCK_HASH(hash_index);
 
 	hash_bucket = &(get_tm_table()->entries[hash_index]);
@@ -1078,6 +1118,8 @@ struct cell *t_lookupOriginalT(struct sip_msg *p_msg)
 	clist_foreach(hash_bucket, p_cell, next_c)
 	{
 		prefetch_loc_r(p_cell->next_c, 1);
+		if(p_cell->callid_hash != 0 && p_cell->callid_hash != cid_hash)
+			continue; /* Call-ID differs for sure */
 		t_msg = p_cell->uas.request;
 
 		if(!t_msg)
@@ -1227,7 +1269,7 @@ int t_reply_search(struct sip_msg *p_msg, struct cell **r_cell, int *r_branch)
 
 	/* sanity check */
 	if(unlikely(reverse_hex2int(hashi, hashl, &hash_index) < 0
-				|| hash_index >= TABLE_ENTRIES
+				|| hash_index >= ksr_tm_table_entries
 				|| reverse_hex2int(branchi, branchl, &branch_id) < 0
 				|| branch_id >= sr_dst_max_branches || loopl != MD5_LEN)) {
 		LM_DBG("poor reply ids - index %d label %d branch %d loopl %d/%d\n",
@@ -1412,7 +1454,7 @@ int t_reply_matching(struct sip_msg *p_msg, int *p_branch)
 
 	/* sanity check */
 	if(unlikely(reverse_hex2int(hashi, hashl, &hash_index) < 0
-				|| hash_index >= TABLE_ENTRIES
+				|| hash_index >= ksr_tm_table_entries
 				|| reverse_hex2int(branchi, branchl, &branch_id) < 0
 				|| branch_id >= sr_dst_max_branches || loopl != MD5_LEN)) {
 		LM_DBG("poor reply ids - index %d label %d branch %d loopl %d/%d\n",
@@ -1872,10 +1914,241 @@ static inline int new_t(struct sip_msg *p_msg)
  * introduced and the calling function shall reply/relay/whatever_appropriate.
  * Side-effects: sets T and T_branch (T_branch always to T_BR_UNDEFINED).
  */
+/* per-worker cache absorbing request retransmissions before the shared
+ * hash: under loss, retransmissions of in-flight requests re-run the
+ * full matching in t_lookup_request() including the entry lock, exactly
+ * when the system is most loaded; a retransmission detected once is
+ * remembered here (with a reference pinning the cell), and further
+ * copies are verified against the pinned cell - the stored uas.request
+ * is immutable and REF/UNREF are atomic - then absorbed without
+ * touching the hash; anything that does not verify falls through to the
+ * regular lookup; enabled with the retr_cache modparam.
+ * Each worker owns one row, guarded by a private lock shared only with
+ * the sweep timer; the rows live in shm so the timer process can drop
+ * the expired pins of workers that stopped receiving requests, and the
+ * ttl is absolute from the insert done on the locked lookup path, so a
+ * retransmission stream cannot keep an unhashed transaction absorbed */
+int tm_retr_cache = 0;
+
+#define TM_RETR_CACHE_SIZE 64
+#define TM_RETR_CACHE_TTL S_TO_TICKS(4)
+
+typedef struct tm_retr_centry
+{
+	unsigned int khash;
+	struct cell *tcell; /* referenced; pinned until expiry or eviction */
+	ticks_t expire;		/* absolute - set only when inserting */
+} tm_retr_centry_t;
+
+typedef struct tm_retr_crow
+{
+	gen_lock_t lock;
+	tm_retr_centry_t slots[TM_RETR_CACHE_SIZE];
+} tm_retr_crow_t;
+
+static tm_retr_crow_t *tm_retr_ctab = NULL; /* one row per process */
+static int tm_retr_crows = 0;
+
+
+static inline void tm_retr_centry_clear(tm_retr_centry_t *e)
+{
+	if(e->tcell) {
+		UNREF_NOSTATS(e->tcell);
+		e->tcell = NULL;
+	}
+	e->khash = 0;
+}
+
+
+/* allocate the cache rows - called at PROC_INIT rank, when the final
+ * process count is known */
+int tm_retr_cache_init(void)
+{
+	int r;
+
+	if(!tm_retr_cache)
+		return 0;
+	tm_retr_crows = get_max_procs();
+	tm_retr_ctab = shm_malloc(tm_retr_crows * sizeof(tm_retr_crow_t));
+	if(tm_retr_ctab == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(tm_retr_ctab, 0, tm_retr_crows * sizeof(tm_retr_crow_t));
+	for(r = 0; r < tm_retr_crows; r++) {
+		if(lock_init(&tm_retr_ctab[r].lock) == 0) {
+			LM_ERR("failed to init retr cache lock\n");
+			shm_free(tm_retr_ctab);
+			tm_retr_ctab = NULL;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+void tm_retr_cache_destroy(void)
+{
+	int r;
+
+	if(tm_retr_ctab == NULL)
+		return;
+	/* no UNREF at shutdown - the cells go away with the shm pool */
+	for(r = 0; r < tm_retr_crows; r++)
+		lock_destroy(&tm_retr_ctab[r].lock);
+	shm_free(tm_retr_ctab);
+	tm_retr_ctab = NULL;
+}
+
+
+/* drop expired pins in all rows - runs in the timer process, so the
+ * referenced transactions of idle workers are released too */
+void tm_retr_cache_sweep(unsigned int ticks, void *param)
+{
+	tm_retr_crow_t *row;
+	tm_retr_centry_t *e;
+	ticks_t now;
+	int r, i;
+
+	if(tm_retr_ctab == NULL)
+		return;
+	now = get_ticks_raw();
+	for(r = 0; r < tm_retr_crows; r++) {
+		row = &tm_retr_ctab[r];
+		lock_get(&row->lock);
+		for(i = 0; i < TM_RETR_CACHE_SIZE; i++) {
+			e = &row->slots[i];
+			if(e->tcell != NULL && (s_ticks_t)(e->expire - now) < 0)
+				tm_retr_centry_clear(e);
+		}
+		lock_release(&row->lock);
+	}
+}
+
+
+/* requests the cache can handle: non-ACK, parsed Call-ID/CSeq and a Via
+ * branch carrying the RFC3261 magic cookie */
+static inline int tm_retr_cache_usable(struct sip_msg *p_msg)
+{
+	struct via_param *branch;
+
+	if(p_msg->REQ_METHOD == METHOD_ACK || p_msg->callid == NULL
+			|| p_msg->cseq == NULL || p_msg->cseq->parsed == NULL
+			|| p_msg->via1 == NULL)
+		return 0;
+	branch = p_msg->via1->branch;
+	return branch && branch->value.s && branch->value.len > MCOOKIE_LEN
+		   && memcmp(branch->value.s, MCOOKIE, MCOOKIE_LEN) == 0;
+}
+
+
+static inline unsigned int tm_retr_cache_khash(struct sip_msg *p_msg)
+{
+	unsigned int h;
+
+	h = get_hash1_raw(p_msg->callid->body.s, p_msg->callid->body.len);
+	h ^= get_hash1_raw(
+			get_cseq(p_msg)->number.s, get_cseq(p_msg)->number.len);
+	h ^= p_msg->via1->mhash;
+	return h;
+}
+
+
+/* look for a pinned transaction matching the retransmission; on success
+ * returns the cell with an extra reference taken for the caller */
+static struct cell *tm_retr_cache_probe(struct sip_msg *p_msg)
+{
+	tm_retr_crow_t *row;
+	tm_retr_centry_t *e;
+	struct cell *tcell;
+	struct sip_msg *t_msg;
+	struct via_body *via1;
+	ticks_t now;
+	unsigned int kh;
+
+	if(unlikely(tm_retr_ctab == NULL || process_no >= tm_retr_crows))
+		return NULL;
+	row = &tm_retr_ctab[process_no];
+	now = get_ticks_raw();
+	kh = tm_retr_cache_khash(p_msg);
+	e = &row->slots[kh & (TM_RETR_CACHE_SIZE - 1)];
+	lock_get(&row->lock);
+	if(e->tcell == NULL || e->khash != kh)
+		goto nohit;
+	if((s_ticks_t)(e->expire - now) < 0) {
+		/* the ttl is not refreshed on hits, so the cached shortcut goes
+		 * away and the stream is re-validated against the hash */
+		tm_retr_centry_clear(e);
+		goto nohit;
+	}
+	tcell = e->tcell;
+	/* drop the pin once the transaction left the hash - from here on a
+	 * copy must be handled by the regular path (e.g. as a new request) */
+	if(unlikely(tcell->next_c == NULL || tcell->prev_c == NULL
+				|| (tcell->flags & T_IN_AGONY))) {
+		tm_retr_centry_clear(e);
+		goto nohit;
+	}
+	t_msg = tcell->uas.request;
+	if(unlikely(t_msg == NULL || t_msg->via1 == NULL
+				|| t_msg->via1->tid.s == NULL))
+		goto nohit;
+	/* the full comparisons - at least as strict as the locked matching,
+	 * so a false hit is impossible; anything failing here just takes the
+	 * regular path */
+	if(t_msg->REQ_METHOD != p_msg->REQ_METHOD)
+		goto nohit;
+	via1 = p_msg->via1;
+	via1->tid.s = via1->branch->value.s + MCOOKIE_LEN;
+	via1->tid.len = via1->branch->value.len - MCOOKIE_LEN;
+	if(!via_matching(t_msg->via1, via1))
+		goto nohit;
+	if(!EQ_LEN(callid) || !EQ_STR(callid))
+		goto nohit;
+	if(get_cseq(t_msg)->number.len != get_cseq(p_msg)->number.len
+			|| memcmp(get_cseq(t_msg)->number.s, get_cseq(p_msg)->number.s,
+					   get_cseq(p_msg)->number.len)
+					   != 0)
+		goto nohit;
+	REF(tcell);
+	lock_release(&row->lock);
+	return tcell;
+nohit:
+	lock_release(&row->lock);
+	return NULL;
+}
+
+
+/* remember a detected retransmission target; called from the locked
+ * lookup path, i.e. the cell was just matched while linked in the hash */
+static void tm_retr_cache_insert(struct sip_msg *p_msg, struct cell *tcell)
+{
+	tm_retr_crow_t *row;
+	tm_retr_centry_t *e;
+	unsigned int kh;
+
+	if(unlikely(tm_retr_ctab == NULL || process_no >= tm_retr_crows))
+		return;
+	row = &tm_retr_ctab[process_no];
+	kh = tm_retr_cache_khash(p_msg);
+	e = &row->slots[kh & (TM_RETR_CACHE_SIZE - 1)];
+	lock_get(&row->lock);
+	if(e->tcell != tcell) {
+		tm_retr_centry_clear(e);
+		REF(tcell);
+		e->tcell = tcell;
+	}
+	e->khash = kh;
+	e->expire = get_ticks_raw() + TM_RETR_CACHE_TTL;
+	lock_release(&row->lock);
+}
+
+
 int t_newtran(struct sip_msg *p_msg)
 {
 	int lret, my_err;
 	int canceled;
+	struct cell *rc_cell;
 
 
 	/* is T still up-to-date ? */
@@ -1919,6 +2192,22 @@ int t_newtran(struct sip_msg *p_msg)
 		LM_ERR("EoH not parsed\n");
 		return E_UNEXPECTED_STATE;
 	}
+
+	if(unlikely(tm_retr_cache) && tm_retr_cache_usable(p_msg)) {
+		rc_cell = tm_retr_cache_probe(p_msg);
+		if(rc_cell != NULL) {
+			/* verified retransmission - absorb it without touching the
+			 * shared hash (same handling as the lret>0 branch below) */
+			set_t(rc_cell, T_BR_UNDEFINED);
+			if(unlikely(has_tran_tmcbs(T, TMCB_REQ_RETR_IN)))
+				run_trans_callbacks(
+						TMCB_REQ_RETR_IN, T, p_msg, 0, p_msg->REQ_METHOD);
+			t_stats_retr_received();
+			t_retransmit_reply(T);
+			return 0;
+		}
+	}
+
 	/* t_lookup_requests attempts to find the transaction;
 	 * it also calls check_transaction_quadruple -> it is
 	 * safe to assume we have from/callid/cseq/to
@@ -1946,6 +2235,11 @@ int t_newtran(struct sip_msg *p_msg)
 			if(unlikely(has_tran_tmcbs(T, TMCB_REQ_RETR_IN)))
 				run_trans_callbacks(
 						TMCB_REQ_RETR_IN, T, p_msg, 0, p_msg->REQ_METHOD);
+			t_stats_retr_received();
+			if(unlikely(tm_retr_cache) && tm_retr_cache_usable(p_msg)) {
+				/* proven hot - pin it so further copies skip the hash */
+				tm_retr_cache_insert(p_msg, T);
+			}
 			t_retransmit_reply(T);
 		}
 		/* things are done -- return from script */
@@ -2136,7 +2430,7 @@ int t_lookup_ident_filter(struct cell **trans, unsigned int hash_index,
 	struct cell *p_cell;
 	struct entry *hash_bucket;
 
-	if(unlikely(hash_index >= TABLE_ENTRIES)) {
+	if(unlikely(hash_index >= ksr_tm_table_entries)) {
 		LM_ERR("invalid hash_index=%u\n", hash_index);
 		return -1;
 	}
@@ -2214,7 +2508,7 @@ tm_cell_t *t_find_ident_filter(
 	tm_cell_t *p_cell;
 	tm_entry_t *hash_bucket;
 
-	if(unlikely(hash_index >= TABLE_ENTRIES)) {
+	if(unlikely(hash_index >= ksr_tm_table_entries)) {
 		LM_ERR("invalid hash_index=%u\n", hash_index);
 		return NULL;
 	}
@@ -2290,7 +2584,7 @@ int t_lookup_callid(struct cell **trans, str callid, str cseq)
 	/* lookup the hash index where the transaction is stored */
 	hash_index = hash(callid, cseq);
 
-	if(unlikely(hash_index >= TABLE_ENTRIES)) {
+	if(unlikely(hash_index >= ksr_tm_table_entries)) {
 		LM_ERR("invalid hash_index=%u\n", hash_index);
 		return -1;
 	}
@@ -35,6 +35,14 @@
 
 extern msg_ctx_id_t tm_global_ctx_id;
 
+/* enable the per-process retransmission absorption cache
+ * (modparam retr_cache) */
+extern int tm_retr_cache;
+
+int tm_retr_cache_init(void);
+void tm_retr_cache_destroy(void);
+void tm_retr_cache_sweep(unsigned int ticks, void *param);
+
 
 void init_t(void);
 int init_rb(struct retr_buf *rb, struct sip_msg *msg);
@@ -42,6 +42,7 @@
 #include "../../core/parser/contact/parse_contact.h"
 #include "lw_parser.h"
 #include "t_msgbuilder.h"
+#include "../../core/atomic_ops.h"
 #include "uac.h"
 #ifdef USE_DNS_FAILOVER
 #include "../../core/dns_cache.h"
@@ -315,6 +316,32 @@ error:
 	return NULL;
 }
 
+/* append an op to the gather program being recorded; adjacent buffer
+ * slices are merged; on overflow the program is marked unusable */
+static inline void tm_lw_rec(
+		tm_lw_prog_t *p, int op, char *base, char *s, int slen)
+{
+	unsigned int off;
+
+	if(p->buffer == 0)
+		return;
+	if(p->n >= TM_LW_PROG_MAX) {
+		p->buffer = 0; /* overflowed - do not cache this one */
+		return;
+	}
+	off = (unsigned int)(s - base);
+	if(op == TM_LW_SLICE && p->n > 0 && p->ops[p->n - 1].op == TM_LW_SLICE
+			&& p->ops[p->n - 1].off + p->ops[p->n - 1].len == off) {
+		p->ops[p->n - 1].len += slen;
+		return;
+	}
+	p->ops[p->n].op = op;
+	p->ops[p->n].off = (unsigned short)off;
+	p->ops[p->n].len = (unsigned short)slen;
+	p->n++;
+}
+
+
 /* Re-parsing version of build_local() function:
  * it builds a local CANCEL or ACK (for non-200 response) request based on
  * the previous INVITE which was sent out.
@@ -338,6 +365,9 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 	sr_cfgenv_t *cenv = NULL;
 	hdr_flags_t hdr_flags = 0;
 	hdr_field_t *hf = NULL;
+	tm_lw_prog_t lrec;
+	tm_lw_prog_t *lp;
+	int i;
 
 	invite_buf = Trans->uac[branch].request.buffer;
 	invite_len = Trans->uac[branch].request.buffer_len;
@@ -405,15 +435,60 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 	}
 	d = cancel_buf;
 
-	/* method name + space */
-	append_str(d, method, method_len);
-	*d = ' ';
-	d++;
-	/* skip "INVITE " and copy the rest of the line including CRLF */
-	s += 7;
-	s1 = s;
-	s = eat_line(s, invite_buf_end - s);
-	append_str(d, s1, s - s1);
+	lrec.buffer = invite_buf;
+	lrec.eoh_off = 0;
+	lrec.n = 0;
+
+	lp = Trans->uac[branch].lw_prog;
+	if(lp != NULL && lp->buffer == invite_buf) {
+		/* a previous build for this branch already recorded which slices
+		 * of the INVITE buffer are needed - replay them instead of
+		 * re-scanning the whole buffer */
+		for(i = 0; i < lp->n; i++) {
+			switch(lp->ops[i].op) {
+				case TM_LW_SLICE:
+					append_str(d, invite_buf + lp->ops[i].off, lp->ops[i].len);
+					break;
+				case TM_LW_METHOD_SP:
+					append_str(d, method, method_len);
+					*d = ' ';
+					d++;
+					break;
+				case TM_LW_METHOD_CRLF:
+					append_str(d, method, method_len);
+					append_str(d, CRLF, CRLF_LEN);
+					break;
+				case TM_LW_TO:
+					if(to_len) {
+						append_str(d, to->s, to_len);
+					} else {
+						append_str(d, invite_buf + lp->ops[i].off,
+								lp->ops[i].len);
+					}
+					break;
+				case TM_LW_CL0:
+					append_str(d, ": 0" CRLF, 3 + CRLF_LEN);
+					break;
+			}
+		}
+		/* jump to the end-of-headers line - the loop below then goes
+		 * straight to the HDR_EOH_T tail (reason, copied headers,
+		 * final CRLF) */
+		s = invite_buf + lp->eoh_off;
+		lrec.buffer = 0; /* already cached - no re-recording */
+	} else {
+		/* method name + space */
+		tm_lw_rec(&lrec, TM_LW_METHOD_SP, invite_buf, invite_buf, 0);
+		append_str(d, method, method_len);
+		*d = ' ';
+		d++;
+		/* skip "INVITE " and copy the rest of the line including CRLF */
+		s += 7;
+		s1 = s;
+		s = eat_line(s, invite_buf_end - s);
+		append_str(d, s1, s - s1);
+		tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
+	}
 
 	cenv = sr_cfgenv_get();
 
@@ -445,6 +520,8 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 				append_str(d, s1, s - s1);
 				append_str(d, method, method_len);
 				append_str(d, CRLF, CRLF_LEN);
+				tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
+				tm_lw_rec(&lrec, TM_LW_METHOD_CRLF, invite_buf, invite_buf, 0);
 				s = lw_next_line(s, invite_buf_end);
 				break;
 
@@ -453,6 +530,7 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 				if(first_via) {
 					/* copy hf */
 					append_str(d, s1, s - s1);
+					tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
 					first_via = 0;
 				} /* else skip this line, we need only the first via */
 				break;
@@ -475,6 +553,9 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 					/* move the pointer to the next line */
 					s = lw_next_line(s, invite_buf_end);
 				}
+				/* record the original header - the replay emits the to
+				 * param of its own call instead when one is given */
+				tm_lw_rec(&lrec, TM_LW_TO, invite_buf, s1, s - s1);
 				break;
 
 			case HDR_FROM_T:
@@ -486,6 +567,7 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 				hdr_flags |= HDR_FROM_F;
 				s = lw_next_line(s, invite_buf_end);
 				append_str(d, s1, s - s1);
+				tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
 				break;
 			case HDR_CALLID_T:
 				/* copy hf */
@@ -496,12 +578,14 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 				hdr_flags |= HDR_CALLID_F;
 				s = lw_next_line(s, invite_buf_end);
 				append_str(d, s1, s - s1);
+				tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
 				break;
 			case HDR_ROUTE_T:
 			case HDR_MAXFORWARDS_T:
 				/* copy hf */
 				s = lw_next_line(s, invite_buf_end);
 				append_str(d, s1, s - s1);
+				tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
 				break;
 
 			case HDR_REQUIRE_T:
@@ -514,12 +598,29 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 				/* copy hf name with 0 value */
 				append_str(d, s1, s - s1);
 				append_str(d, ": 0" CRLF, 3 + CRLF_LEN);
+				tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
+				tm_lw_rec(&lrec, TM_LW_CL0, invite_buf, invite_buf, 0);
 				/* move the pointer to the next line */
 				s = lw_next_line(s, invite_buf_end);
 				break;
 
 			case HDR_EOH_T:
 				/* end of SIP message found */
+				/* cache the recorded gather program for the next local
+				 * build on this branch (e.g. the ACK after the CANCEL) */
+				if(lrec.buffer != 0 && Trans->uac[branch].lw_prog == NULL) {
+					lp = shm_malloc(sizeof(tm_lw_prog_t));
+					if(lp != NULL) {
+						lrec.eoh_off = (unsigned short)(s1 - invite_buf);
+						*lp = lrec;
+						if(atomic_cmpxchg_long(
+								   (void *)&Trans->uac[branch].lw_prog, 0,
+								   (long)lp)
+								!= 0)
+							shm_free(lp); /* lost the publish race */
+					}
+					/* no cache on alloc failure - this build goes on */
+				}
 				/* add reason if needed */
 				if(reason_len) {
 					/* if reason_len !=0, no need for any reason enabled
@@ -596,12 +697,16 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 										   == 0) {
 							hadded = 1;
 							append_str(d, s1, s - s1);
+							tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1,
+									s - s1);
 						} else if(s1[cenv->uac_cseq_refresh.len] == ':'
 								  && strncmp(s1, cenv->uac_cseq_refresh.s,
 											 cenv->uac_cseq_refresh.len)
 											 == 0) {
 							hadded = 1;
 							append_str(d, s1, s - s1);
+							tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1,
+									s - s1);
 						}
 					}
 				}
@@ -615,6 +720,7 @@ char *build_local_reparse(tm_cell_t *Trans, unsigned int branch,
 										cfg_get(tm, tm_cfg, ac_extra_hdrs).len)
 									== 0)) {
 						append_str(d, s1, s - s1);
+						tm_lw_rec(&lrec, TM_LW_SLICE, invite_buf, s1, s - s1);
 					}
 				}
 				break;
@@ -1476,10 +1582,11 @@ static inline int print_cseq_num(str *_s, dlg_t *_d)
 
 
 /*
- * Create Via header
+ * Create Via header; *branch_len is set to the length of the branch
+ * parameter value embedded in the result
  */
-static inline int assemble_via(
-		str *dest, struct cell *t, struct dest_info *dst, int branch)
+static inline int assemble_via(str *dest, struct cell *t, struct dest_info *dst,
+		int branch, int *branch_len)
 {
 	static char branch_buf[MAX_BRANCH_PARAM_LEN];
 	char *via;
@@ -1496,6 +1603,7 @@ static inline int assemble_via(
 
 	branch_str.s = branch_buf;
 	branch_str.len = len;
+	*branch_len = len;
 
 #ifdef XL_DEBUG
 	printf("!!!proto: %d\n", sock->proto);
@@ -1655,6 +1763,307 @@ static inline char *print_callid(char *w, dlg_t *dialog, struct cell *t)
 }
 
 
+/* per-process cache of assembled local UAC requests: high rate local
+ * generators (dmq, presence notifies, dialog keepalives) build the very
+ * same request over and over, with only the Via branch, the CSeq number,
+ * the Call-ID, the Content-Length and the body changing between calls;
+ * instead of re-running the whole builder, the invariant byte runs of a
+ * previously built request are kept (in pkg mem) together with the exact
+ * input values they were derived from, and a new request is assembled
+ * with five memcpys plus the per-call slot values; a cache entry is used
+ * only after all the inputs that shaped the invariant bytes compared
+ * equal, so a hit can never produce different output than the builder;
+ * enabled with the uac_tpl_cache modparam */
+int tm_uac_tpl_cache = 0;
+
+#define TM_UAC_TPL_SLOTS 4
+#define TM_UAC_TPL_KEYS_MAX 24
+
+typedef struct tm_uac_tpl {
+	struct socket_info *send_sock; /* via identity */
+	int proto;					   /* effective via transport */
+	int key_no;
+	str key[TM_UAC_TPL_KEYS_MAX]; /* input copies, point into blob */
+	str seg[5];					  /* invariant byte runs, point into blob */
+	int to_off;					  /* To header offset inside seg[1] */
+	int to_hdr_len;
+	int from_off; /* From header offset inside seg[1] */
+	int from_hdr_len;
+	int ruri_len;
+	int inv_len; /* sum of the segment lengths */
+	char *blob;
+} tm_uac_tpl_t;
+
+static tm_uac_tpl_t tm_uac_tpl_tab[TM_UAC_TPL_SLOTS];
+static int tm_uac_tpl_crt; /* round-robin replacement index */
+
+
+/* the Via transport as via_builder() will pick it */
+static inline int tm_uac_tpl_via_proto(struct dest_info *dst)
+{
+	if(dst->send_sock != NULL && dst->send_sock->useinfo.proto != PROTO_NONE)
+		return dst->send_sock->useinfo.proto;
+	return dst->proto;
+}
+
+
+/* a request is cacheable only when every byte outside the four patch
+ * slots is a pure function of the cache key: no per-request From tag
+ * generation, no compression parameter and no Via line depending on a
+ * tcp connection lookup (PROTO_WS) */
+static inline int tm_uac_tpl_usable(dlg_t *dialog, struct dest_info *dst)
+{
+	if(!tm_uac_tpl_cache)
+		return 0;
+	if(dialog->id.loc_tag.len <= 0)
+		return 0;
+#ifdef USE_COMP
+	if(dst->comp != COMP_NONE)
+		return 0;
+#endif
+	if(tm_uac_tpl_via_proto(dst) == PROTO_WS)
+		return 0;
+	return 1;
+}
+
+
+/* collect the inputs the invariant part of the request is built from;
+ * returns their number or -1 if the route set does not fit */
+static inline int tm_uac_tpl_key_parts(
+		str *parts, str *method, str *headers, dlg_t *dialog)
+{
+	int n;
+	rr_t *ptr;
+
+	parts[0] = *method;
+	parts[1] = *dialog->hooks.request_uri;
+	parts[2] = dialog->rem_uri;
+	parts[3] = dialog->id.rem_tag;
+	parts[4] = dialog->loc_uri;
+	parts[5] = dialog->id.loc_tag;
+	if(headers) {
+		parts[6] = *headers;
+	} else {
+		parts[6].s = 0;
+		parts[6].len = 0;
+	}
+	n = 7;
+	for(ptr = dialog->hooks.first_route; ptr; ptr = ptr->next) {
+		if(n == TM_UAC_TPL_KEYS_MAX)
+			return -1;
+		parts[n].s = ptr->nameaddr.name.s;
+		parts[n].len = ptr->len;
+		n++;
+	}
+	if(dialog->hooks.last_route) {
+		if(n == TM_UAC_TPL_KEYS_MAX)
+			return -1;
+		parts[n] = *dialog->hooks.last_route;
+		n++;
+	}
+	return n;
+}
+
+
+static tm_uac_tpl_t *tm_uac_tpl_lookup(
+		str *parts, int part_no, struct dest_info *dst, int proto)
+{
+	tm_uac_tpl_t *tpl;
+	int i, k;
+
+	for(i = 0; i < TM_UAC_TPL_SLOTS; i++) {
+		tpl = &tm_uac_tpl_tab[i];
+		if(tpl->blob == NULL || tpl->key_no != part_no
+				|| tpl->send_sock != dst->send_sock || tpl->proto != proto)
+			continue;
+		for(k = 0; k < part_no; k++) {
+			if(tpl->key[k].len != parts[k].len
+					|| (parts[k].len != 0
+							&& memcmp(tpl->key[k].s, parts[k].s, parts[k].len)
+									   != 0))
+				break;
+		}
+		if(k == part_no)
+			return tpl;
+	}
+	return NULL;
+}
+
+
+/* remember the invariant byte runs of a freshly built request; the slot
+ * boundaries are taken from the positions the builder recorded in the
+ * cell shortcuts, so no layout knowledge is duplicated here */
+static void tm_uac_tpl_store(str *parts, int part_no, struct dest_info *dst,
+		int proto, str *headers, dlg_t *dialog, struct cell *t, char *buf,
+		int buf_len, int via_off, str *via, int branch_len,
+		str *content_length, int body_len)
+{
+	tm_uac_tpl_t *tpl;
+	str seg[5];
+	char *p;
+	int vsuffix_len;
+	int i;
+	int blob_len;
+
+	vsuffix_len = CRLF_LEN + (ksr_local_rport ? ((int)sizeof(";rport") - 1) : 0);
+	if(via->len <= branch_len + vsuffix_len)
+		return;
+
+	/* cut the request into invariant runs around the four slots */
+	seg[0].s = buf;
+	seg[0].len = via_off + via->len - branch_len - vsuffix_len;
+	seg[1].s = seg[0].s + seg[0].len + branch_len;
+	seg[1].len = (t->cseq_hdr_n.s + CSEQ_LEN) - seg[1].s;
+	seg[2].s = t->cseq_hdr_n.s + t->cseq_hdr_n.len;
+	seg[2].len = (t->callid_hdr.s + CALLID_LEN) - seg[2].s;
+	seg[4].len = CRLF_LEN
+				 + ((server_signature && user_agent_hdr.len > 0)
+								 ? (user_agent_hdr.len + CRLF_LEN)
+								 : 0)
+				 + ((headers && headers->len > 2)
+								 ? (headers->len
+										   + ((headers->s[headers->len - 1]
+													  != '\n')
+														   ? CRLF_LEN
+														   : 0))
+								 : 0)
+				 + CRLF_LEN;
+	seg[4].s = buf + buf_len - body_len - seg[4].len;
+	seg[3].s = t->callid_hdr.s + CALLID_LEN + dialog->id.call_id.len;
+	seg[3].len = (seg[4].s - content_length->len) - seg[3].s;
+
+	/* layout sanity: the Via split must land right on the branch value
+	 * and the Content-Length value must sit right before the tail run */
+	if(seg[1].len < vsuffix_len + (int)TO_LEN || seg[2].len <= 0
+			|| seg[3].len < (int)(CRLF_LEN + CONTENT_LENGTH_LEN)
+			|| memcmp(seg[0].s + seg[0].len - (sizeof(";branch=") - 1),
+					   ";branch=", sizeof(";branch=") - 1)
+					   != 0
+			|| (t->to_hdr.s - seg[1].s) != vsuffix_len
+			|| memcmp(seg[4].s - content_length->len, content_length->s,
+					   content_length->len)
+					   != 0) {
+		LM_WARN("unexpected local request layout - not caching\n");
+		return;
+	}
+
+	blob_len = 0;
+	for(i = 0; i < part_no; i++)
+		blob_len += parts[i].len;
+	for(i = 0; i < 5; i++)
+		blob_len += seg[i].len;
+
+	tpl = &tm_uac_tpl_tab[tm_uac_tpl_crt];
+	tm_uac_tpl_crt = (tm_uac_tpl_crt + 1) % TM_UAC_TPL_SLOTS;
+	if(tpl->blob) {
+		pkg_free(tpl->blob);
+		tpl->blob = NULL;
+	}
+	tpl->blob = pkg_malloc(blob_len);
+	if(tpl->blob == NULL) {
+		PKG_MEM_ERROR;
+		return;
+	}
+
+	p = tpl->blob;
+	for(i = 0; i < part_no; i++) {
+		tpl->key[i].s = p;
+		tpl->key[i].len = parts[i].len;
+		memapp(p, parts[i].s, parts[i].len);
+	}
+	tpl->key_no = part_no;
+	tpl->inv_len = 0;
+	for(i = 0; i < 5; i++) {
+		tpl->seg[i].s = p;
+		tpl->seg[i].len = seg[i].len;
+		tpl->inv_len += seg[i].len;
+		memapp(p, seg[i].s, seg[i].len);
+	}
+	tpl->send_sock = dst->send_sock;
+	tpl->proto = proto;
+	tpl->to_off = vsuffix_len;
+	tpl->to_hdr_len = t->to_hdr.len;
+	tpl->from_off = t->from_hdr.s - seg[1].s;
+	tpl->from_hdr_len = t->from_hdr.len;
+	tpl->ruri_len = dialog->hooks.request_uri->len;
+}
+
+
+/* assemble a request from a cached template, filling in the per-call
+ * values and setting the same cell shortcuts as the full builder */
+static char *tm_uac_tpl_assemble(tm_uac_tpl_t *tpl, str *method, str *body,
+		dlg_t *dialog, int branch, struct cell *t, int *len)
+{
+	static char branch_buf[MAX_BRANCH_PARAM_LEN];
+	char *buf, *w;
+	str content_length, cseq;
+	int branch_len;
+
+	if(!t_calc_branch(t, branch, branch_buf, &branch_len)) {
+		LM_ERR("branch calculation failed\n");
+		return 0;
+	}
+	if(print_content_length(&content_length, body) < 0) {
+		LM_ERR("error while printing content-length\n");
+		return 0;
+	}
+	if(print_cseq_num(&cseq, dialog) < 0) {
+		LM_ERR("error while printing CSeq number\n");
+		return 0;
+	}
+
+	*len = tpl->inv_len + branch_len + cseq.len + dialog->id.call_id.len
+		   + content_length.len + (body ? body->len : 0);
+	buf = shm_malloc(*len + 1);
+	if(!buf) {
+		SHM_MEM_ERROR_FMT("required (%d)\n", *len);
+		return 0;
+	}
+	w = buf;
+
+	memapp(w, tpl->seg[0].s, tpl->seg[0].len); /* req. line + Via start */
+	t->uac[branch].uri.s = buf + method->len + 1;
+	t->uac[branch].uri.len = tpl->ruri_len;
+	memapp(w, branch_buf, branch_len); /* Via branch */
+
+	t->to_hdr.s = w + tpl->to_off;
+	t->to_hdr.len = tpl->to_hdr_len;
+	t->from_hdr.s = w + tpl->from_off;
+	t->from_hdr.len = tpl->from_hdr_len;
+	memapp(w, tpl->seg[1].s, tpl->seg[1].len); /* Via end + To + From + CSeq */
+
+	t->cseq_hdr_n.s = w - CSEQ_LEN;
+	t->cseq_hdr_n.len = CSEQ_LEN + cseq.len;
+	t->cseq_num.s = w;
+	t->cseq_num.len = cseq.len;
+	memapp(w, cseq.s, cseq.len); /* CSeq number */
+	trim(&t->cseq_num);
+	t->cseq_met.s = w + 1;
+	t->cseq_met.len = method->len;
+
+	memapp(w, tpl->seg[2].s, tpl->seg[2].len); /* method + Call-ID name */
+	t->callid_hdr.s = w - CALLID_LEN;
+	t->callid_hdr.len = CALLID_LEN + dialog->id.call_id.len + CRLF_LEN;
+	t->callid_val.s = w;
+	t->callid_val.len = dialog->id.call_id.len;
+	memapp(w, dialog->id.call_id.s, dialog->id.call_id.len); /* Call-ID */
+	trim(&t->callid_val);
+
+	memapp(w, tpl->seg[3].s, tpl->seg[3].len); /* routes + C-Length name */
+	memapp(w, content_length.s, content_length.len); /* Content-Length */
+	memapp(w, tpl->seg[4].s, tpl->seg[4].len); /* signature + extra hdrs */
+	if(body && body->s && body->len > 0)
+		memapp(w, body->s, body->len);
+
+#ifdef EXTRA_DEBUG
+	assert(w - buf == *len);
+#endif
+
+	memapp(w, "\0", 1);
+	return buf;
+}
+
+
 /*
  * Create a request
  */
@@ -1667,12 +2076,28 @@ char *build_uac_req(str *method, str *headers, str *body, dlg_t *dialog,
 	int tbracket, fbracket;
 	str fromtag = STR_NULL;
 	str loc_tag = STR_NULL;
+	str kparts[TM_UAC_TPL_KEYS_MAX];
+	int kpart_no = -1;
+	int tpl_proto = 0;
+	int branch_len = 0;
+	int via_off = 0;
+	tm_uac_tpl_t *tpl;
 
 	if(!method || !dialog) {
 		LM_ERR("invalid parameter value\n");
 		return 0;
 	}
 
+	if(tm_uac_tpl_usable(dialog, dst)) {
+		tpl_proto = tm_uac_tpl_via_proto(dst);
+		kpart_no = tm_uac_tpl_key_parts(kparts, method, headers, dialog);
+		if(kpart_no > 0
+				&& (tpl = tm_uac_tpl_lookup(kparts, kpart_no, dst, tpl_proto))
+						   != NULL)
+			return tm_uac_tpl_assemble(
+					tpl, method, body, dialog, branch, t, len);
+	}
+
 	if(dialog->id.loc_tag.len <= 0) {
 		/* From Tag is mandatory in RFC3261 - generate one if not provided */
 		generate_fromtag(&fromtag, &dialog->id.call_id, &(dialog->rem_uri));
@@ -1697,8 +2122,9 @@ char *build_uac_req(str *method, str *headers, str *body, dlg_t *dialog,
 
 	*len = method->len + 1 + dialog->hooks.request_uri->len + 1
 		   + SIP_VERSION_LEN + CRLF_LEN;
+	via_off = *len;
 
-	if(assemble_via(&via, t, dst, branch) < 0) {
+	if(assemble_via(&via, t, dst, branch, &branch_len) < 0) {
 		LM_ERR("error while assembling Via\n");
 		return 0;
 	}
@@ -1803,6 +2229,11 @@ char *build_uac_req(str *method, str *headers, str *body, dlg_t *dialog,
 
 	memapp(w, "\0", 1);
 
+	if(kpart_no > 0 && fromtag.len == 0)
+		tm_uac_tpl_store(kparts, kpart_no, dst, tpl_proto, headers, dialog, t,
+				buf, *len, via_off, &via, branch_len, &content_length,
+				body ? body->len : 0);
+
 	pkg_free(via.s);
 	return buf;
 
@@ -1829,6 +2260,7 @@ char *build_uac_cancel(str *headers, str *body, struct cell *cancelledT,
 	struct hostport hp;
 	str content_length;
 	str via = STR_NULL;
+	int via_branch_len;
 
 	LM_DBG("sing FROM=<%.*s>, TO=<%.*s>, CSEQ_N=<%.*s>\n",
 			cancelledT->from_hdr.len, cancelledT->from_hdr.s,
@@ -1842,7 +2274,7 @@ char *build_uac_cancel(str *headers, str *body, struct cell *cancelledT,
 	}
 	set_hostport(&hp, 0);
 
-	if(assemble_via(&via, cancelledT, dst, branch) < 0) {
+	if(assemble_via(&via, cancelledT, dst, branch, &via_branch_len) < 0) {
 		LM_ERR("Error while assembling Via\n");
 		return 0;
 	}
@@ -33,6 +33,35 @@
 #define TM_CANCEL_HEADERS_COPY (1)
 #define TM_CANCEL_FORWARD_UAC (1 << 1)
 
+/* cached gather program for hop-by-hop ACK/CANCEL building: the first
+ * build_local_reparse() for a branch records which slices of the sent-out
+ * INVITE buffer make it into the local request (plus where the method name
+ * and the To header go); later builds for the same branch replay the slice
+ * list instead of re-scanning the whole buffer */
+#define TM_LW_SLICE 0		/* copy buffer[off, off+len) */
+#define TM_LW_METHOD_SP 1	/* method name + ' ' (request line) */
+#define TM_LW_METHOD_CRLF 2 /* method name + CRLF (CSeq) */
+#define TM_LW_TO 3			/* the to param, or buffer[off, off+len) */
+#define TM_LW_CL0 4			/* ": 0" CRLF (Content-Length value) */
+
+#define TM_LW_PROG_MAX 32 /* give up caching on more ops (odd requests) */
+
+typedef struct tm_lw_op
+{
+	unsigned char op;
+	unsigned short off;
+	unsigned short len;
+} tm_lw_op_t;
+
+typedef struct tm_lw_prog
+{
+	char *buffer; /* the request.buffer the offsets refer to (the buffer
+				   * may be replaced on dns failover => revalidate) */
+	unsigned short eoh_off; /* offset of the end-of-headers line */
+	unsigned short n;
+	tm_lw_op_t ops[TM_LW_PROG_MAX];
+} tm_lw_prog_t;
+
 char *build_local(struct cell *Trans, unsigned int branch, unsigned int *len,
 		char *method, int method_len, str *to, sip_msg_t *imsg,
 		struct cancel_reason *reason);
@@ -68,6 +97,10 @@ char *build_dlg_ack(struct sip_msg *rpl, struct cell *Trans,
 char *build_uac_req(str *method, str *headers, str *body, dlg_t *dialog,
 		int branch, struct cell *t, int *len, struct dest_info *dst);
 
+/* enable the per-process template cache for locally generated requests
+ * (modparam uac_tpl_cache) */
+extern int tm_uac_tpl_cache;
+
 
 int t_calc_branch(struct cell *t, int b, char *branch, int *branch_len);
 
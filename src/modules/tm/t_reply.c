@@ -904,8 +904,10 @@ struct sip_msg *fake_req(struct sip_msg *shmem_msg, int extra_flags,
 	struct sip_msg *faked_req;
 	/* make a clone so eventual new parsed headers in pkg are not visible
 	 * to other processes -- other attributes should be already parsed,
-	 * available in the req structure and propagated by cloning */
-	faked_req = sip_msg_shm_clone(shmem_msg, len, 1);
+	 * available in the req structure and propagated by cloning; the clone
+	 * never leaves this process, so it goes to pkg memory, skipping the
+	 * global shm lock and shm fragmentation */
+	faked_req = sip_msg_pkg_clone(shmem_msg, len, 1);
 	if(faked_req == NULL) {
 		LM_ERR("failed to clone the request\n");
 		return NULL;
@@ -959,7 +961,7 @@ error01:
 		faked_req->path_vec.len = 0;
 	}
 error00:
-	shm_free(faked_req);
+	pkg_free(faked_req);
 	return NULL;
 }
 
@@ -1002,8 +1004,8 @@ void free_faked_req(struct sip_msg *faked_req, int len)
 	reset_ua(faked_req);
 	msg_ldata_reset(faked_req);
 
-	/* free shared block */
-	shm_free(faked_req);
+	/* free the single-block pkg clone */
+	pkg_free(faked_req);
 }
 
 /* return 1 if failure_route was processed
@@ -1900,6 +1902,15 @@ skip:
 }
 
 
+/* outbound reply buffer pre-built outside the REPLY_LOCK by
+ * reply_received() for the common relay-this-branch case; consumed by
+ * relay_reply() under the lock when the decision selects the same
+ * message, released by reply_received() otherwise */
+static char *tm_rpl_prebuilt_buf = NULL;
+static unsigned int tm_rpl_prebuilt_len = 0;
+static struct sip_msg *tm_rpl_prebuilt_msg = NULL;
+
+
 /* this is the code which decides what and when shall be relayed
  * upstream; note well -- it assumes it is entered locked with
  * REPLY_LOCK and it returns unlocked!
@@ -2061,7 +2072,15 @@ enum rps relay_reply(struct cell *t, struct sip_msg *p_msg, int branch,
 				relayed_msg =
 						FAKED_REPLY; /* mark the relayed_msg as a "FAKE" */
 			} else {
-				buf = build_res_buf_from_sip_res(relayed_msg, &res_len);
+				if(tm_rpl_prebuilt_buf != NULL
+						&& tm_rpl_prebuilt_msg == relayed_msg) {
+					/* winning reply already built outside the lock */
+					buf = tm_rpl_prebuilt_buf;
+					res_len = tm_rpl_prebuilt_len;
+					tm_rpl_prebuilt_buf = NULL;
+				} else {
+					buf = build_res_buf_from_sip_res(relayed_msg, &res_len);
+				}
 				/* if we build a message from shmem, we need to remove
 				 * via delete lumps which are now stirred in the shmem-ed
 				 * structure
@@ -2402,11 +2421,13 @@ int reply_received(struct sip_msg *p_msg)
 
 	LM_DBG("transaction found - T:%p branch:%d\n", t, branch);
 
-	/* lock -- onreply_route, safe avp usage, ... */
-	/* - it is a recurrent mutex, so it is safe if a function executed
-	 * down here does another lock/unlock */
-	LOCK_REPLIES(t);
-	replies_locked = 1;
+	/* the reply lock is taken as late as possible: only the on_reply
+	 * route / avp access and the forwarding decision need it; the timer
+	 * and (re)send operations until there rely on their own atomic ops.
+	 * Parse everything the stored/relayed reply will need already now,
+	 * while nothing is locked */
+	if(unlikely(parse_headers(p_msg, HDR_EOH_F, 0) == -1))
+		LM_ERR("parsing reply headers failed\n");
 
 	tm_ctx_set_branch_index(branch);
 	init_cancel_info(&cancel_data);
@@ -2532,6 +2553,16 @@ int reply_received(struct sip_msg *p_msg)
 			uac->request.dst.send_flags.blst_imask & BLST_503;
 	/* processing of on_reply block */
 	if(onreply_route || sr_event_enabled(SREV_SIP_REPLY_OUT)) {
+		/* lock -- onreply_route, safe avp usage, ... */
+		/* - it is a recurrent mutex, so it is safe if a function executed
+		 * down here does another lock/unlock */
+		LOCK_REPLIES(t);
+		replies_locked = 1;
+		/* re-read the branch status now that the lock is held - the early
+		 * unlocked snapshot may be stale if another process updated the
+		 * branch in between, and a stale value must not decide the
+		 * last_received update (nor be restored) below */
+		last_uac_status = uac->last_received;
 		set_route_type(TM_ONREPLY_ROUTE);
 		/* transfer transaction flag to message context */
 		if(t->uas.request) {
@@ -2709,6 +2740,22 @@ int reply_received(struct sip_msg *p_msg)
 		/* suspended the reply (async) - no error */
 		goto done;
 	}
+	if(likely(!replies_locked) && !is_local(t) && msg_status >= 180
+			&& msg_status < 300) {
+		/* fast path for the overwhelmingly common outcome - relaying
+		 * this very 180/183/2xx upstream: build the outbound buffer
+		 * before taking the reply lock; relay_reply() picks it up if
+		 * the locked decision indeed selects this message (skipped when
+		 * an on_reply route already holds the lock anyway) */
+		tm_rpl_prebuilt_msg = p_msg;
+		tm_rpl_prebuilt_buf =
+				build_res_buf_from_sip_res(p_msg, &tm_rpl_prebuilt_len);
+	}
+	if(!replies_locked) {
+		/* local_reply()/relay_reply() must be entered locked */
+		LOCK_REPLIES(t);
+		replies_locked = 1;
+	}
 	if(is_local(t)) {
 		/* local_reply() does UNLOCK_REPLIES( t ) */
 		reply_status = local_reply(t, p_msg, branch, msg_status, &cancel_data);
@@ -2733,6 +2780,11 @@ int reply_received(struct sip_msg *p_msg)
 		reply_status =
 				relay_reply(t, p_msg, branch, msg_status, &cancel_data, 1);
 		if(reply_status == RPS_TGONE) {
+			if(unlikely(tm_rpl_prebuilt_buf != NULL)) {
+				pkg_free(tm_rpl_prebuilt_buf);
+				tm_rpl_prebuilt_buf = NULL;
+			}
+			tm_rpl_prebuilt_msg = NULL;
 			/* let the reply be sent out stateless */
 			return 1;
 		}
@@ -2781,6 +2833,12 @@ done:
 		UNLOCK_REPLIES(t);
 		replies_locked = 0;
 	}
+	if(unlikely(tm_rpl_prebuilt_buf != NULL)) {
+		/* the pre-built reply buffer was not consumed */
+		pkg_free(tm_rpl_prebuilt_buf);
+		tm_rpl_prebuilt_buf = NULL;
+	}
+	tm_rpl_prebuilt_msg = NULL;
 
 	tm_ctx_set_branch_index(T_BR_UNDEFINED);
 	/* done processing the transaction, so unref it
@@ -23,7 +23,11 @@
 
 
 #include <stdio.h>
+#include <string.h>
 #include "t_stats.h"
+
+/* slot ranges for the aggregated hash lock contention counters */
+#define TM_HASH_STATS_RANGES 16
 #include "../../core/mem/shm_mem.h"
 #include "../../core/dprint.h"
 #include "../../core/config.h"
@@ -93,6 +97,22 @@ void free_tm_stats()
 		(res)->rpl_generated = (s1)->rpl_generated + (s2)->rpl_generated; \
 		(res)->rpl_sent = (s1)->rpl_sent + (s2)->rpl_sent;                \
 		(res)->deleted = (s1)->deleted + (s2)->deleted;                   \
+		(res)->suspends = (s1)->suspends + (s2)->suspends;                \
+		(res)->suspends_ended =                                           \
+				(s1)->suspends_ended + (s2)->suspends_ended;              \
+		(res)->resumes = (s1)->resumes + (s2)->resumes;                   \
+		(res)->susp_le10ms = (s1)->susp_le10ms + (s2)->susp_le10ms;       \
+		(res)->susp_le100ms = (s1)->susp_le100ms + (s2)->susp_le100ms;    \
+		(res)->susp_le1s = (s1)->susp_le1s + (s2)->susp_le1s;             \
+		(res)->susp_gt1s = (s1)->susp_gt1s + (s2)->susp_gt1s;             \
+		(res)->retr_req_sent = (s1)->retr_req_sent + (s2)->retr_req_sent; \
+		(res)->retr_rpl_sent = (s1)->retr_rpl_sent + (s2)->retr_rpl_sent; \
+		(res)->retr_received = (s1)->retr_received + (s2)->retr_received; \
+		(res)->life_le1s = (s1)->life_le1s + (s2)->life_le1s;             \
+		(res)->life_le10s = (s1)->life_le10s + (s2)->life_le10s;          \
+		(res)->life_le60s = (s1)->life_le60s + (s2)->life_le60s;          \
+		(res)->life_le300s = (s1)->life_le300s + (s2)->life_le300s;       \
+		(res)->life_gt300s = (s1)->life_gt300s + (s2)->life_gt300s;       \
 	} while(0)
 
 
@@ -118,6 +138,9 @@ void tm_rpc_stats(rpc_t *rpc, void *c)
 	unsigned long current, waiting;
 	struct t_proc_stats all;
 	int i, pno;
+#ifdef TM_HASH_STATS
+	unsigned long hash_used;
+#endif
 
 	pno = get_max_procs();
 	memset(&all, 0, sizeof(all));
@@ -146,6 +169,31 @@ void tm_rpc_stats(rpc_t *rpc, void *c)
 	rpc->struct_add(st, "dd", "created", (unsigned int)all.t_created, "freed",
 			(unsigned int)all.t_freed);
 	rpc->struct_add(st, "d", "delayed_free", (unsigned int)all.delayed_free);
+#endif
+	rpc->struct_add(st, "ddd", "suspends", (unsigned int)all.suspends,
+			"resumes", (unsigned int)all.resumes, "suspended",
+			(unsigned int)(all.suspends - all.suspends_ended));
+	rpc->struct_add(st, "dddd", "susp_le10ms", (unsigned int)all.susp_le10ms,
+			"susp_le100ms", (unsigned int)all.susp_le100ms, "susp_le1s",
+			(unsigned int)all.susp_le1s, "susp_gt1s",
+			(unsigned int)all.susp_gt1s);
+	rpc->struct_add(st, "ddd", "retr_req_sent", (unsigned int)all.retr_req_sent,
+			"retr_rpl_sent", (unsigned int)all.retr_rpl_sent, "retr_received",
+			(unsigned int)all.retr_received);
+	rpc->struct_add(st, "ddddd", "life_le1s", (unsigned int)all.life_le1s,
+			"life_le10s", (unsigned int)all.life_le10s, "life_le60s",
+			(unsigned int)all.life_le60s, "life_le300s",
+			(unsigned int)all.life_le300s, "life_gt300s",
+			(unsigned int)all.life_gt300s);
+#ifdef TM_HASH_STATS
+	if(_tm_table) {
+		hash_used = 0;
+		for(i = 0; i < _tm_table->size; i++)
+			if(_tm_table->entries[i].cur_entries != 0)
+				hash_used++;
+		rpc->struct_add(st, "dd", "hash_size", (unsigned int)_tm_table->size,
+				"hash_used", (unsigned int)hash_used);
+	}
 #endif
 	/* rpc->fault(c, 100, "Trying"); */
 }
@@ -176,7 +224,14 @@ void tm_rpc_hash_stats(rpc_t *rpc, void *c)
 	double acc_average, acc_dev, acc_d;
 	double crt_average, crt_dev, crt_d;
 	unsigned long acc, crt;
+	unsigned long lw_count, lw_range[TM_HASH_STATS_RANGES];
+	/* chain length histogram buckets: 0, 1, 2, <=4, <=8, <=16, <=32, >32 */
+	static const unsigned long cl_limit[] = {0, 1, 2, 4, 8, 16, 32};
+	unsigned long cl_hist[sizeof(cl_limit) / sizeof(cl_limit[0]) + 1];
+	unsigned int s;
+	char lw_name[24];
 	int r;
+	int b;
 
 	acc_count = 0;
 	acc_min = (unsigned long)(-1);
@@ -190,10 +245,19 @@ void tm_rpc_hash_stats(rpc_t *rpc, void *c)
 	crt_zeroes = 0;
 	crt_dev_no = 0;
 	crt_dev = 0;
-	for(r = 0; r < TABLE_ENTRIES; r++) {
+	memset(cl_hist, 0, sizeof(cl_hist));
+	for(r = 0; r < _tm_table->size; r++) {
 		acc = _tm_table->entries[r].acc_entries;
 		crt = _tm_table->entries[r].cur_entries;
 
+		/* current chain length histogram - slots degenerating into long
+		 * chains pile up in the top buckets */
+		for(b = 0; b < sizeof(cl_limit) / sizeof(cl_limit[0])
+				   && crt > cl_limit[b];
+				b++)
+			;
+		cl_hist[b]++;
+
 		acc_count += acc;
 		if(acc < acc_min)
 			acc_min = acc;
@@ -210,10 +274,10 @@ void tm_rpc_hash_stats(rpc_t *rpc, void *c)
 		if(crt == 0)
 			crt_zeroes++;
 	}
-	acc_average = acc_count / (double)TABLE_ENTRIES;
-	crt_average = crt_count / (double)TABLE_ENTRIES;
+	acc_average = acc_count / (double)_tm_table->size;
+	crt_average = crt_count / (double)_tm_table->size;
 
-	for(r = 0; r < TABLE_ENTRIES; r++) {
+	for(r = 0; r < _tm_table->size; r++) {
 		acc = _tm_table->entries[r].acc_entries;
 		crt = _tm_table->entries[r].cur_entries;
 
@@ -233,9 +297,18 @@ void tm_rpc_hash_stats(rpc_t *rpc, void *c)
 		crt_dev += crt_d * crt_d;
 	}
 
+	/* hash lock contention, aggregated over equally sized slot ranges */
+	memset(lw_range, 0, sizeof(lw_range));
+	lw_count = 0;
+	s = _tm_table->size / TM_HASH_STATS_RANGES;
+	for(r = 0; r < _tm_table->size; r++) {
+		lw_count += _tm_table->entries[r].lock_waits;
+		lw_range[r / s] += _tm_table->entries[r].lock_waits;
+	}
+
 	if(rpc->add(c, "{", &st) < 0)
 		return;
-	rpc->struct_add(st, "d", "hash_size", (unsigned)TABLE_ENTRIES);
+	rpc->struct_add(st, "d", "hash_size", (unsigned)_tm_table->size);
 	rpc->struct_add(st, "d", "crt_transactions", (unsigned)crt_count);
 	rpc->struct_add(st, "f", "crt_target_per_cell", crt_average);
 	rpc->struct_add(st, "dd", "crt_min", (unsigned)crt_min, "crt_max",
@@ -254,6 +327,18 @@ void tm_rpc_hash_stats(rpc_t *rpc, void *c)
 	rpc->struct_add(st, "d", "acc_no_zero_cells", (unsigned)acc_zeroes);
 	rpc->struct_add(st, "d", "acc_no_deviating_cells", acc_dev_no);
 	rpc->struct_add(st, "f", "acc_deviation_sq_sum", acc_dev);
+	rpc->struct_add(st, "d", "lock_waits", (unsigned)lw_count);
+	for(r = 0; r < TM_HASH_STATS_RANGES; r++) {
+		snprintf(lw_name, sizeof(lw_name), "lock_waits_r%02d", r);
+		rpc->struct_add(st, "d", lw_name, (unsigned)lw_range[r]);
+	}
+	rpc->struct_add(st, "ddd", "chains_len0", (unsigned)cl_hist[0],
+			"chains_len1", (unsigned)cl_hist[1], "chains_len2",
+			(unsigned)cl_hist[2]);
+	rpc->struct_add(st, "dddd", "chains_le4", (unsigned)cl_hist[3],
+			"chains_le8", (unsigned)cl_hist[4], "chains_le16",
+			(unsigned)cl_hist[5], "chains_le32", (unsigned)cl_hist[6]);
+	rpc->struct_add(st, "d", "chains_gt32", (unsigned)cl_hist[7]);
 #else  /* TM_HASH_STATS */
 	rpc->fault(c, 500,
 			"Hash statistics not supported (try"
@@ -269,7 +354,7 @@ void tm_rpc_list(rpc_t *rpc, void *c)
 	tm_cell_t *tcell;
 	char pbuf[32];
 
-	for(r = 0; r < TABLE_ENTRIES; r++) {
+	for(r = 0; r < _tm_table->size; r++) {
 		lock_hash(r);
 		if(clist_empty(&_tm_table->entries[r], next_c)) {
 			unlock_hash(r);
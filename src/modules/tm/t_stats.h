@@ -48,6 +48,22 @@ struct t_proc_stats
 	stat_counter rpl_generated;
 	stat_counter rpl_sent;
 	stat_counter deleted;
+	/* t_suspend()/t_continue() activity: suspends counts transactions
+	 * entering the suspended state, suspends_ended counts every way out
+	 * of it (resume, cancel or death by timer), so the difference is the
+	 * momentary suspend depth */
+	stat_counter suspends;
+	stat_counter suspends_ended;
+	stat_counter resumes;
+	/* time spent suspended until t_continue() picked it up */
+	stat_counter susp_le10ms, susp_le100ms, susp_le1s, susp_gt1s;
+	/* retransmissions: requests/replies we resent from the retr timer
+	 * and incoming request retransmissions absorbed by matching */
+	stat_counter retr_req_sent;
+	stat_counter retr_rpl_sent;
+	stat_counter retr_received;
+	/* transaction lifetime, creation to free */
+	stat_counter life_le1s, life_le10s, life_le60s, life_le300s, life_gt300s;
 #ifdef TM_MORE_STATS
 	/* number of created transactions */
 	stat_counter t_created;
@@ -147,6 +163,59 @@ inline void static t_stats_rpl_sent(void)
 	tm_stats[process_no].s.rpl_sent++;
 }
 
+inline void static t_stats_suspended(void)
+{
+	tm_stats[process_no].s.suspends++;
+}
+
+inline void static t_stats_suspend_ended(void)
+{
+	tm_stats[process_no].s.suspends_ended++;
+}
+
+inline void static t_stats_retr_req_sent(void)
+{
+	tm_stats[process_no].s.retr_req_sent++;
+}
+
+inline void static t_stats_retr_rpl_sent(void)
+{
+	tm_stats[process_no].s.retr_rpl_sent++;
+}
+
+inline void static t_stats_retr_received(void)
+{
+	tm_stats[process_no].s.retr_received++;
+}
+
+inline void static t_stats_lifetime(unsigned int life_s)
+{
+	if(life_s <= 1)
+		tm_stats[process_no].s.life_le1s++;
+	else if(life_s <= 10)
+		tm_stats[process_no].s.life_le10s++;
+	else if(life_s <= 60)
+		tm_stats[process_no].s.life_le60s++;
+	else if(life_s <= 300)
+		tm_stats[process_no].s.life_le300s++;
+	else
+		tm_stats[process_no].s.life_gt300s++;
+}
+
+inline void static t_stats_resumed(unsigned int lat_ms)
+{
+	tm_stats[process_no].s.resumes++;
+	tm_stats[process_no].s.suspends_ended++;
+	if(lat_ms <= 10)
+		tm_stats[process_no].s.susp_le10ms++;
+	else if(lat_ms <= 100)
+		tm_stats[process_no].s.susp_le100ms++;
+	else if(lat_ms <= 1000)
+		tm_stats[process_no].s.susp_le1s++;
+	else
+		tm_stats[process_no].s.susp_gt1s++;
+}
+
 
 int init_tm_stats(void);
 int init_tm_stats_child(void);
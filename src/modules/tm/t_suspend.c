@@ -107,6 +107,8 @@ int t_suspend(
 		 * - failure route to be executed if the branch is not continued
 		 *   before timeout */
 		t->uac[t->async_backup.blind_uac].on_failure = t->on_failure;
+		if(!(t->flags & T_ASYNC_SUSPENDED))
+			t_stats_suspended();
 		t->flags |= T_ASYNC_SUSPENDED;
 	} else {
 		LM_DBG("this is a suspend on reply - setting msg flag to SUSPEND\n");
@@ -139,6 +141,8 @@ int t_suspend(
 		}
 		LM_DBG("saving transaction data\n");
 		t->uac[branch].reply->flags = msg->flags;
+		if(!(t->flags & T_ASYNC_SUSPENDED))
+			t_stats_suspended();
 		t->flags |= T_ASYNC_SUSPENDED;
 	}
 
@@ -152,6 +156,7 @@ int t_suspend(
 	t->async_backup.backup_route = get_route_type();
 	t->async_backup.backup_branch = get_t_branch();
 	t->async_backup.ruri_new = ruri_get_forking_state();
+	t->async_backup.suspend_ticks = get_ticks_raw();
 
 
 	return 0;
@@ -208,6 +213,7 @@ static int t_continue_helper(unsigned int hash_index, unsigned int label,
 
 	if(t->flags & T_CANCELED) {
 		t->flags &= ~T_ASYNC_SUSPENDED;
+		t_stats_suspend_ended();
 		/* The transaction has already been canceled,
 		 * needless to continue */
 		UNREF(t); /* t_unref would kill the transaction */
@@ -225,6 +231,8 @@ static int t_continue_helper(unsigned int hash_index, unsigned int label,
 
 	/* transaction is no longer suspended, resetting the SUSPEND flag */
 	t->flags &= ~T_ASYNC_SUSPENDED;
+	t_stats_resumed(TICKS_TO_MS((unsigned int)(get_ticks_raw()
+			- t->async_backup.suspend_ticks)));
 
 	/* which route block type were we in when we were suspended */
 	cb_type = FAILURE_CB_TYPE;
@@ -647,7 +655,10 @@ int t_cancel_suspend(unsigned int hash_index, unsigned int label)
 		/* The transaction does not need to be locked because this
 		* function is either executed from the original route block
 		* or from failure route which already locks */
-		t->flags &= ~T_ASYNC_SUSPENDED;
+		if(t->flags & T_ASYNC_SUSPENDED) {
+			t->flags &= ~T_ASYNC_SUSPENDED;
+			t_stats_suspend_ended();
+		}
 
 		reset_kr(); /* the blind UAC of t_suspend has set kr */
 
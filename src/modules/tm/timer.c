@@ -335,12 +335,14 @@ inline static ticks_t retransmission_handler(struct retr_buf *r_buf)
 		if(unlikely(has_tran_tmcbs(r_buf->my_T, TMCB_REQUEST_SENT)))
 			run_trans_callbacks_with_buf(
 					TMCB_REQUEST_SENT, r_buf, 0, 0, TMCB_RETR_F);
+		t_stats_retr_req_sent();
 	} else {
 #ifdef EXTRA_DEBUG
 		LM_DBG("reply resending (t=%p, %.9s ... )\n", r_buf->my_T,
 				r_buf->buffer);
 #endif
 		t_retransmit_reply(r_buf->my_T);
+		t_stats_retr_rpl_sent();
 	}
 
 	return 0;
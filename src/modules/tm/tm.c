@@ -61,6 +61,7 @@
 #include "../../core/mem/mem.h"
 #include "../../core/route_struct.h"
 #include "../../core/route.h"
+#include "../../core/hash_func.h"
 #include "../../core/cfg/cfg.h"
 #include "../../core/globals.h"
 #include "../../core/timer_ticks.h"
@@ -244,6 +245,12 @@ int tm_reply_relay_mode = 1;
 unsigned long tm_exec_time_check = 0; /* microseconds */
 int tm_exec_time_check_param = 5000;  /* milliseconds */
 
+/* transaction hash table size (power of 2); 0 = core default */
+int tm_hash_size_param = 0;
+
+/* header retention whitelist for compact shm clones; empty = full clone */
+char *tm_clone_retain_hdrs_param = 0;
+
 int tm_failure_exec_mode = 0;
 
 int tm_dns_reuse_rcv_socket = 0;
@@ -522,6 +529,10 @@ static param_export_t params[] = {
 	{"rich_redirect", PARAM_INT, &tm_rich_redirect},
 	{"event_callback_lres_sent", PARAM_STR, &_tm_event_callback_lres_sent},
 	{"exec_time_check", PARAM_INT, &tm_exec_time_check_param},
+	{"hash_size", PARAM_INT, &tm_hash_size_param},
+	{"clone_retain_hdrs", PARAM_STRING, &tm_clone_retain_hdrs_param},
+	{"uac_tpl_cache", PARAM_INT, &tm_uac_tpl_cache},
+	{"retr_cache", PARAM_INT, &tm_retr_cache},
 	{"reply_relay_mode", PARAM_INT, &tm_reply_relay_mode},
 	{"enable_uac_fr", PARAM_INT, &default_tm_cfg.enable_uac_fr},
 #ifdef USE_DNS_FAILOVER
@@ -798,12 +809,26 @@ static int mod_init(void)
 		return -1;
 	}
 
+	/* apply the configured hash table size before the table is built
+	 * and before anything computes a hash_index */
+	if(tm_hash_size_param > 0
+			&& ksr_tm_table_entries_set((unsigned int)tm_hash_size_param)
+					   < 0) {
+		LM_ERR("invalid hash_size parameter: %d\n", tm_hash_size_param);
+		return -1;
+	}
+
 	/* building the hash table*/
 	if(!init_hash_table()) {
 		LM_ERR("initializing hash_table failed\n");
 		return -1;
 	}
 
+	if(tm_clone_prune_init(tm_clone_retain_hdrs_param) < 0) {
+		LM_ERR("invalid clone_retain_hdrs parameter\n");
+		return -1;
+	}
+
 	/* init static hidden values */
 	init_t();
 
@@ -910,6 +935,15 @@ static int mod_init(void)
 	if(goto_on_sl_reply && onreply_rt.rlist[goto_on_sl_reply] == 0)
 		LM_WARN("empty/non existing on_sl_reply route\n");
 
+	if(tm_retr_cache) {
+		/* expired retransmission cache pins must be dropped even for
+		 * workers that no longer receive requests */
+		if(register_timer(tm_retr_cache_sweep, 0, 2) < 0) {
+			LM_ERR("failed to register the retr cache sweep timer\n");
+			return -1;
+		}
+	}
+
 #ifdef WITH_TM_CTX
 	tm_ctx_init();
 #endif
@@ -928,6 +962,10 @@ static int child_init(int rank)
 			LM_ERR("Error while initializing tm statistics structures\n");
 			return -1;
 		}
+		if(tm_retr_cache_init() < 0) {
+			LM_ERR("Error while initializing the retr cache\n");
+			return -1;
+		}
 	} else if(child_init_callid(rank) < 0) {
 		/* don't init callid for PROC_INIT*/
 		LM_ERR("Error while initializing Call-ID generator\n");
@@ -33,6 +33,7 @@
 #include "../../core/globals.h"
 #include "../../core/crypto/md5utils.h"
 #include "../../core/crc.h"
+#include "../../core/hash_func.h"
 #include "../../core/ip_addr.h"
 #include "../../core/dset.h"
 #include "../../core/trim.h"
@@ -81,7 +82,7 @@ int uac_init(void)
 	str src[3];
 	struct socket_info *si;
 
-	if(KAM_RAND_MAX < TABLE_ENTRIES) {
+	if(KAM_RAND_MAX < ksr_tm_table_entries) {
 		LM_WARN("uac does not spread across the whole hash table\n");
 	}
 	/* on tcp/tls bind_address is 0 so try to get the first address we listen
@@ -636,6 +637,7 @@ static inline int t_uac_prepare(
 				}
 				new_cell->uas.end_request =
 						((char *)new_cell->uas.request) + sip_msg_len;
+				tm_cell_set_match_hashes(new_cell, new_cell->uas.request);
 			}
 		} else {
 			LM_WARN("failed to build uas for failover\n");
@@ -36,6 +36,8 @@
 
 char _th_EB64[65];
 int _th_DB64[256];
+/* precomputed output pairs for 12-bit input groups */
+static unsigned char _th_EB64P[4096][2];
 char *_th_PD64 = "*";
 
 extern str _th_key;
@@ -80,6 +82,10 @@ void th_mask_init(void)
 		_th_DB64[i] = -1;
 	for(i = 0; i < 64; i++)
 		_th_DB64[(int)_th_EB64[i]] = i;
+	for(i = 0; i < 4096; i++) {
+		_th_EB64P[i][0] = (unsigned char)_th_EB64[(i >> 6) & 0x3f];
+		_th_EB64P[i][1] = (unsigned char)_th_EB64[i & 0x3f];
+	}
 
 	return;
 }
@@ -103,8 +109,6 @@ char *th_mask_encode(char *in, int ilen, str *prefix, int *olen)
 		return NULL;
 	}
 
-	/* set 0 at the end of the value */
-	memset(out, 0, (*olen + 1) * sizeof(char));
 	if(prefix != NULL && prefix->len > 0) {
 		memcpy(out, prefix->s, prefix->len);
 	}
@@ -118,11 +122,14 @@ char *th_mask_encode(char *in, int ilen, str *prefix, int *olen)
 		for(i = 0, r = 16; i <= left; i++, r -= 8)
 			block += ((unsigned char)in[idx + i]) << r;
 
-		*(p++) = _th_EB64[(block >> 18) & 0x3f];
-		*(p++) = _th_EB64[(block >> 12) & 0x3f];
-		*(p++) = (left > 0) ? _th_EB64[(block >> 6) & 0x3f] : _th_PD64[0];
-		*(p++) = (left > 1) ? _th_EB64[block & 0x3f] : _th_PD64[0];
+		p[0] = (char)_th_EB64P[(block >> 12) & 0xfff][0];
+		p[1] = (char)_th_EB64P[(block >> 12) & 0xfff][1];
+		p[2] = (left > 0) ? (char)_th_EB64P[block & 0xfff][0] : _th_PD64[0];
+		p[3] = (left > 1) ? (char)_th_EB64P[block & 0xfff][1] : _th_PD64[0];
+		p += 4;
 	}
+	/* set 0 at the end of the value */
+	*p = '\0';
 
 	return out;
 }
@@ -136,7 +143,7 @@ char *th_mask_decode(char *in, int ilen, str *prefix, int extra, int *olen)
 	int i;
 	int j;
 	int end;
-	char c;
+	int c;
 
 	for(n = 0, i = ilen - 1; in[i] == _th_PD64[0]; i--)
 		n++;
@@ -158,15 +165,15 @@ char *th_mask_decode(char *in, int ilen, str *prefix, int extra, int *olen)
 		*olen = 0;
 		return NULL;
 	}
-	/* set 0 at the end of the value */
-	memset(out, 0, (*olen + 1 + extra) * sizeof(char));
+	/* the decode loop fills the value - set 0 only on the trailing bytes */
+	memset(out + *olen, 0, (1 + extra) * sizeof(char));
 
 	end = ilen - n;
 	i = (prefix != NULL && prefix->len > 0) ? prefix->len : 0;
 	for(idx = 0; i < end; idx += 3) {
 		block = 0;
 		for(j = 0; j < 4 && i < end; j++) {
-			c = _th_DB64[(int)in[i++]];
+			c = _th_DB64[(unsigned char)in[i++]];
 			if(c < 0) {
 				LM_ERR("invalid input string\"%.*s\"\n", ilen, in);
 				pkg_free(out);
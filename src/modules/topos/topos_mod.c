@@ -92,6 +92,8 @@ str _tps_storage = str_init("db");
 
 extern int _tps_branch_expire;
 extern int _tps_dialog_expire;
+extern int _tps_setup_cache_size;
+extern int _tps_setup_cache_expire;
 extern unsigned int _tps_methods_nocontact;
 str _tps_methods_nocontact_list = str_init("");
 extern unsigned int _tps_methods_noinitial;
@@ -172,6 +174,8 @@ static param_export_t params[] = {
 	{"header_mode", PARAM_INT, &_tps_header_mode},
 	{"branch_expire", PARAM_INT, &_tps_branch_expire},
 	{"dialog_expire", PARAM_INT, &_tps_dialog_expire},
+	{"setup_cache_size", PARAM_INT, &_tps_setup_cache_size},
+	{"setup_cache_expire", PARAM_INT, &_tps_setup_cache_expire},
 	{"clean_interval", PARAM_INT, &_tps_clean_interval},
 	{"event_callback", PARAM_STR, &_tps_eventrt_callback},
 	{"event_mode", PARAM_INT, &_tps_eventrt_mode},
@@ -310,6 +314,11 @@ static int mod_init(void)
 		return -1;
 	}
 
+	if(tps_storage_cache_init() < 0) {
+		LM_ERR("failed to initialize setup phase dialog cache\n");
+		return -1;
+	}
+
 	if(sruid_init(&_tps_sruid, '-', "tpsh", SRUID_INC) < 0)
 		return -1;
 
@@ -382,6 +391,7 @@ static void destroy(void)
 			_tps_db_handle = 0;
 		}
 	}
+	tps_storage_cache_destroy();
 	tps_storage_lock_set_destroy();
 }
 
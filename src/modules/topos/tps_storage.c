@@ -36,6 +36,7 @@
 #include "../../core/dprint.h"
 #include "../../core/hashes.h"
 #include "../../core/locking.h"
+#include "../../core/mem/shm_mem.h"
 #include "../../core/trim.h"
 #include "../../core/xavp.h"
 #include "../../core/parser/parse_uri.h"
@@ -72,6 +73,30 @@ static gen_lock_set_t *_tps_storage_lock_set = NULL;
 int _tps_branch_expire = 180;
 int _tps_dialog_expire = 10800;
 
+int _tps_setup_cache_size = 0;
+int _tps_setup_cache_expire = 180;
+
+/**
+ * shared memory cache with dialog records in setup phase - in-dialog
+ * requests handled on the same node are served from here without a
+ * backend lookup until the dialog is confirmed or the entry expires
+ */
+typedef struct tps_cache_entry
+{
+	unsigned int hashv;
+	time_t itime;
+	tps_data_t td;
+	struct tps_cache_entry *next;
+} tps_cache_entry_t;
+
+typedef struct tps_cache_slot
+{
+	gen_lock_t lock;
+	tps_cache_entry_t *first;
+} tps_cache_slot_t;
+
+static tps_cache_slot_t *_tps_cache_slots = NULL;
+
 int tps_db_insert_dialog(tps_data_t *td);
 int tps_db_clean_dialogs(void);
 int tps_db_insert_branch(tps_data_t *td);
@@ -163,6 +188,332 @@ int tps_storage_lock_set_destroy(void)
 	return 0;
 }
 
+/**
+ *
+ */
+int tps_storage_cache_init(void)
+{
+	int i;
+
+	if(_tps_setup_cache_size <= 0) {
+		return 0;
+	}
+	_tps_cache_slots = (tps_cache_slot_t *)shm_malloc(
+			_tps_setup_cache_size * sizeof(tps_cache_slot_t));
+	if(_tps_cache_slots == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(_tps_cache_slots, 0,
+			_tps_setup_cache_size * sizeof(tps_cache_slot_t));
+	for(i = 0; i < _tps_setup_cache_size; i++) {
+		if(lock_init(&_tps_cache_slots[i].lock) == NULL) {
+			LM_ERR("cannot initialize cache slot lock %d\n", i);
+			for(i--; i >= 0; i--) {
+				lock_destroy(&_tps_cache_slots[i].lock);
+			}
+			shm_free(_tps_cache_slots);
+			_tps_cache_slots = NULL;
+			return -1;
+		}
+	}
+	LM_DBG("setup phase dialog cache initialized with %d slots\n",
+			_tps_setup_cache_size);
+	return 0;
+}
+
+/**
+ *
+ */
+void tps_storage_cache_destroy(void)
+{
+	int i;
+	tps_cache_entry_t *ce;
+	tps_cache_entry_t *cn;
+
+	if(_tps_cache_slots == NULL) {
+		return;
+	}
+	for(i = 0; i < _tps_setup_cache_size; i++) {
+		ce = _tps_cache_slots[i].first;
+		while(ce != NULL) {
+			cn = ce->next;
+			shm_free(ce);
+			ce = cn;
+		}
+		lock_destroy(&_tps_cache_slots[i].lock);
+	}
+	shm_free(_tps_cache_slots);
+	_tps_cache_slots = NULL;
+}
+
+/**
+ * get the dialog key (uuid without the a/b role prefix) for caching
+ */
+static int tps_cache_get_key(tps_data_t *td, str *skey)
+{
+	if(td->a_uuid.len > 1) {
+		skey->s = td->a_uuid.s + 1;
+		skey->len = td->a_uuid.len - 1;
+		return 0;
+	}
+	if(td->b_uuid.len > 1) {
+		skey->s = td->b_uuid.s + 1;
+		skey->len = td->b_uuid.len - 1;
+		return 0;
+	}
+	return -1;
+}
+
+#define TPS_CACHE_APPEND(_dst, _src, _fld)                          \
+	do {                                                            \
+		if((_src)->_fld.len > 0) {                                  \
+			if((_dst)->cp + (_src)->_fld.len + 1                    \
+					>= (_dst)->cbuf + TPS_DATA_SIZE) {              \
+				LM_ERR("no space left to copy dialog data\n");      \
+				return -1;                                          \
+			}                                                       \
+			(_dst)->_fld.s = (_dst)->cp;                            \
+			(_dst)->_fld.len = (_src)->_fld.len;                    \
+			memcpy((_dst)->cp, (_src)->_fld.s, (_src)->_fld.len);   \
+			(_dst)->cp += (_src)->_fld.len;                         \
+			(_dst)->cp[0] = '\0';                                   \
+			(_dst)->cp++;                                           \
+		}                                                           \
+	} while(0)
+
+/**
+ * copy the dialog fields from src to dst, cloning the strings into
+ * dst's own buffer - same set of fields as the backend load_dialog
+ */
+static int tps_cache_data_copy(tps_data_t *src, tps_data_t *dst)
+{
+	if(dst->cp == NULL) {
+		dst->cp = dst->cbuf;
+	}
+	TPS_CACHE_APPEND(dst, src, a_callid);
+	TPS_CACHE_APPEND(dst, src, a_uuid);
+	TPS_CACHE_APPEND(dst, src, b_uuid);
+	TPS_CACHE_APPEND(dst, src, a_contact);
+	TPS_CACHE_APPEND(dst, src, b_contact);
+	TPS_CACHE_APPEND(dst, src, as_contact);
+	TPS_CACHE_APPEND(dst, src, bs_contact);
+	TPS_CACHE_APPEND(dst, src, a_tag);
+	TPS_CACHE_APPEND(dst, src, b_tag);
+	TPS_CACHE_APPEND(dst, src, a_rr);
+	TPS_CACHE_APPEND(dst, src, b_rr);
+	TPS_CACHE_APPEND(dst, src, s_rr);
+	TPS_CACHE_APPEND(dst, src, a_uri);
+	TPS_CACHE_APPEND(dst, src, b_uri);
+	TPS_CACHE_APPEND(dst, src, r_uri);
+	TPS_CACHE_APPEND(dst, src, a_srcaddr);
+	TPS_CACHE_APPEND(dst, src, b_srcaddr);
+	TPS_CACHE_APPEND(dst, src, s_method);
+	TPS_CACHE_APPEND(dst, src, s_cseq);
+	TPS_CACHE_APPEND(dst, src, x_context);
+	dst->iflags = src->iflags;
+	dst->expires = src->expires;
+	return 0;
+}
+
+/**
+ * store a clone of the dialog record in the setup phase cache
+ */
+static int tps_cache_insert(tps_data_t *td)
+{
+	str skey = STR_NULL;
+	str ckey = STR_NULL;
+	unsigned int hashv;
+	unsigned int slotid;
+	tps_cache_entry_t *ce;
+	tps_cache_entry_t *cp;
+	tps_cache_entry_t *cprev;
+
+	if(_tps_cache_slots == NULL) {
+		return 0;
+	}
+	if(tps_cache_get_key(td, &skey) < 0) {
+		return -1;
+	}
+
+	ce = (tps_cache_entry_t *)shm_malloc(sizeof(tps_cache_entry_t));
+	if(ce == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	memset(ce, 0, sizeof(tps_cache_entry_t));
+	if(tps_cache_data_copy(td, &ce->td) < 0) {
+		shm_free(ce);
+		return -1;
+	}
+	hashv = core_case_hash(&skey, 0, 0);
+	ce->hashv = hashv;
+	ce->itime = time(NULL);
+
+	slotid = hashv % _tps_setup_cache_size;
+	lock_get(&_tps_cache_slots[slotid].lock);
+	/* drop older entry for the same dialog, if any */
+	cprev = NULL;
+	cp = _tps_cache_slots[slotid].first;
+	while(cp != NULL) {
+		if(cp->hashv == hashv && tps_cache_get_key(&cp->td, &ckey) == 0
+				&& ckey.len == skey.len
+				&& memcmp(ckey.s, skey.s, skey.len) == 0) {
+			if(cprev != NULL) {
+				cprev->next = cp->next;
+			} else {
+				_tps_cache_slots[slotid].first = cp->next;
+			}
+			shm_free(cp);
+			break;
+		}
+		cprev = cp;
+		cp = cp->next;
+	}
+	ce->next = _tps_cache_slots[slotid].first;
+	_tps_cache_slots[slotid].first = ce;
+	lock_release(&_tps_cache_slots[slotid].lock);
+
+	LM_DBG("cached setup phase dialog record for [%.*s]\n", skey.len, skey.s);
+	return 0;
+}
+
+/**
+ * fetch the dialog record from the setup phase cache
+ * return: 0 - found and copied to sd; -1 - not in cache
+ */
+static int tps_cache_fetch(tps_data_t *md, tps_data_t *sd)
+{
+	str skey = STR_NULL;
+	str ckey = STR_NULL;
+	unsigned int hashv;
+	unsigned int slotid;
+	tps_cache_entry_t *cp;
+	tps_cache_entry_t *cprev;
+	time_t tnow;
+	int ret = -1;
+
+	if(_tps_cache_slots == NULL) {
+		return -1;
+	}
+	if(tps_cache_get_key(md, &skey) < 0) {
+		return -1;
+	}
+	hashv = core_case_hash(&skey, 0, 0);
+	slotid = hashv % _tps_setup_cache_size;
+	tnow = time(NULL);
+
+	lock_get(&_tps_cache_slots[slotid].lock);
+	cprev = NULL;
+	cp = _tps_cache_slots[slotid].first;
+	while(cp != NULL) {
+		if(cp->hashv == hashv && tps_cache_get_key(&cp->td, &ckey) == 0
+				&& ckey.len == skey.len
+				&& memcmp(ckey.s, skey.s, skey.len) == 0) {
+			if(cp->itime + _tps_setup_cache_expire < tnow) {
+				/* expired - drop it and fall back to the backend */
+				if(cprev != NULL) {
+					cprev->next = cp->next;
+				} else {
+					_tps_cache_slots[slotid].first = cp->next;
+				}
+				shm_free(cp);
+				break;
+			}
+			ret = tps_cache_data_copy(&cp->td, sd);
+			break;
+		}
+		cprev = cp;
+		cp = cp->next;
+	}
+	lock_release(&_tps_cache_slots[slotid].lock);
+
+	if(ret == 0) {
+		LM_DBG("serving dialog record for [%.*s] from setup phase cache\n",
+				skey.len, skey.s);
+	}
+	return ret;
+}
+
+/**
+ * remove the dialog record from the setup phase cache, if present
+ */
+static void tps_cache_remove(tps_data_t *td)
+{
+	str skey = STR_NULL;
+	str ckey = STR_NULL;
+	unsigned int hashv;
+	unsigned int slotid;
+	tps_cache_entry_t *cp;
+	tps_cache_entry_t *cprev;
+
+	if(_tps_cache_slots == NULL) {
+		return;
+	}
+	if(tps_cache_get_key(td, &skey) < 0) {
+		return;
+	}
+	hashv = core_case_hash(&skey, 0, 0);
+	slotid = hashv % _tps_setup_cache_size;
+
+	lock_get(&_tps_cache_slots[slotid].lock);
+	cprev = NULL;
+	cp = _tps_cache_slots[slotid].first;
+	while(cp != NULL) {
+		if(cp->hashv == hashv && tps_cache_get_key(&cp->td, &ckey) == 0
+				&& ckey.len == skey.len
+				&& memcmp(ckey.s, skey.s, skey.len) == 0) {
+			if(cprev != NULL) {
+				cprev->next = cp->next;
+			} else {
+				_tps_cache_slots[slotid].first = cp->next;
+			}
+			shm_free(cp);
+			break;
+		}
+		cprev = cp;
+		cp = cp->next;
+	}
+	lock_release(&_tps_cache_slots[slotid].lock);
+}
+
+/**
+ * drop the expired entries from the setup phase cache
+ */
+static void tps_cache_clean(void)
+{
+	int i;
+	time_t tnow;
+	tps_cache_entry_t *cp;
+	tps_cache_entry_t *cprev;
+	tps_cache_entry_t *cn;
+
+	if(_tps_cache_slots == NULL) {
+		return;
+	}
+	tnow = time(NULL);
+	for(i = 0; i < _tps_setup_cache_size; i++) {
+		lock_get(&_tps_cache_slots[i].lock);
+		cprev = NULL;
+		cp = _tps_cache_slots[i].first;
+		while(cp != NULL) {
+			cn = cp->next;
+			if(cp->itime + _tps_setup_cache_expire < tnow) {
+				if(cprev != NULL) {
+					cprev->next = cn;
+				} else {
+					_tps_cache_slots[i].first = cn;
+				}
+				shm_free(cp);
+			} else {
+				cprev = cp;
+			}
+			cp = cn;
+		}
+		lock_release(&_tps_cache_slots[i].lock);
+	}
+}
+
 /**
  *
  */
@@ -655,6 +1006,9 @@ int tps_storage_record(sip_msg_t *msg, tps_data_t *td, int dialog, int dir)
 		ret = _tps_storage_api.insert_dialog(td);
 		if(ret < 0)
 			goto error;
+		if(_tps_cache_slots != NULL) {
+			tps_cache_insert(td);
+		}
 	}
 
 	return 0;
@@ -1548,6 +1902,9 @@ error:
  */
 int tps_storage_load_dialog(sip_msg_t *msg, tps_data_t *md, tps_data_t *sd)
 {
+	if(_tps_cache_slots != NULL && tps_cache_fetch(md, sd) == 0) {
+		return 0;
+	}
 	return _tps_storage_api.load_dialog(msg, md, sd);
 }
 
@@ -1833,6 +2190,12 @@ int tps_storage_update_dialog(
 	if(ret < 0)
 		return -1;
 
+	if(_tps_cache_slots != NULL) {
+		/* setup phase is over - drop the cached record so the next
+		 * in-dialog message loads the updated one from the backend */
+		tps_cache_remove(sd);
+	}
+
 	return _tps_storage_api.update_dialog(msg, md, sd, mode);
 }
 
@@ -1917,6 +2280,9 @@ int tps_db_end_dialog(sip_msg_t *msg, tps_data_t *md, tps_data_t *sd)
  */
 int tps_storage_end_dialog(sip_msg_t *msg, tps_data_t *md, tps_data_t *sd)
 {
+	if(_tps_cache_slots != NULL) {
+		tps_cache_remove(sd);
+	}
 	return _tps_storage_api.end_dialog(msg, md, sd);
 }
 
@@ -1925,6 +2291,7 @@ int tps_storage_end_dialog(sip_msg_t *msg, tps_data_t *md, tps_data_t *sd)
  */
 void tps_storage_clean(unsigned int ticks, void *param)
 {
+	tps_cache_clean();
 	_tps_storage_api.clean_branches();
 	_tps_storage_api.clean_dialogs();
 }
@@ -107,6 +107,9 @@ int tps_storage_update_dialog(
 		sip_msg_t *msg, tps_data_t *md, tps_data_t *sd, uint32_t mode);
 int tps_storage_end_dialog(sip_msg_t *msg, tps_data_t *md, tps_data_t *sd);
 
+int tps_storage_cache_init(void);
+void tps_storage_cache_destroy(void);
+
 int tps_storage_lock_set_init(void);
 int tps_storage_lock_get(str *lkey);
 int tps_storage_lock_release(str *lkey);
@@ -158,6 +158,13 @@ int tps_redis_insert_dialog(tps_data_t *td)
 	char *argv[TPS_REDIS_NR_KEYS];
 	size_t argvlen[TPS_REDIS_NR_KEYS];
 	int argc = 0;
+	char *eargv[4];
+	size_t eargvlen[4];
+	int eargc = 0;
+	int argcv[2];
+	const char **argvv[2];
+	const size_t *argvlenv[2];
+	redisReply *rplv[2];
 	str rcmd = str_init("HMSET");
 	str rkey = STR_NULL;
 	char *rp;
@@ -165,6 +172,7 @@ int tps_redis_insert_dialog(tps_data_t *td)
 	redisc_server_t *rsrv = NULL;
 	redisReply *rrpl = NULL;
 	unsigned long lval = 0;
+	unsigned long eval = 0;
 
 	if(td->a_uuid.len <= 0 && td->b_uuid.len <= 0) {
 		LM_INFO("no uuid for this message\n");
@@ -250,6 +258,47 @@ int tps_redis_insert_dialog(tps_data_t *td)
 
 	TPS_REDIS_SET_ARGS(&td->x_context, argc, &td_key_x_context, argv, argvlen);
 
+	if(td->s_method.len == 9 && strncmp(td->s_method.s, "SUBSCRIBE", 9) == 0) {
+		eval = (unsigned long)td->expires;
+	} else {
+		eval = (unsigned long)_tps_api.get_dialog_expire();
+	}
+
+	if(eval != 0 && _tps_redis_api.exec_argv_many != NULL) {
+		/* pipeline HMSET and EXPIRE in one round trip */
+		eargv[eargc] = "EXPIRE";
+		eargvlen[eargc] = 6;
+		eargc++;
+
+		eargv[eargc] = rkey.s;
+		eargvlen[eargc] = rkey.len;
+		eargc++;
+
+		TPS_REDIS_SET_ARGNV(eval, rp, &rval, eargc, eargv, eargvlen);
+
+		argcv[0] = argc;
+		argvv[0] = (const char **)argv;
+		argvlenv[0] = argvlen;
+		argcv[1] = eargc;
+		argvv[1] = (const char **)eargv;
+		argvlenv[1] = eargvlen;
+
+		if(_tps_redis_api.exec_argv_many(rsrv, 2, argcv, argvv, argvlenv, rplv)
+				< 0) {
+			LM_ERR("failed to execute pipelined redis commands\n");
+			if(rsrv->ctxRedis->err) {
+				LM_ERR("redis error: %s\n", rsrv->ctxRedis->errstr);
+			}
+			return -1;
+		}
+		LM_DBG("inserted dialog record for [%.*s] with argc %d and expire"
+			   " %lu\n",
+				rkey.len, rkey.s, argc, eval);
+		freeReplyObject(rplv[0]);
+		freeReplyObject(rplv[1]);
+		return 0;
+	}
+
 	rrpl = _tps_redis_api.exec_argv(rsrv, argc, (const char **)argv, argvlen);
 	if(rrpl == NULL) {
 		LM_ERR("failed to execute redis command\n");
@@ -262,6 +311,11 @@ int tps_redis_insert_dialog(tps_data_t *td)
 			argc);
 	freeReplyObject(rrpl);
 
+	lval = eval;
+	if(lval == 0) {
+		return 0;
+	}
+
 	/* set expire for the key */
 	argc = 0;
 
@@ -273,15 +327,6 @@ int tps_redis_insert_dialog(tps_data_t *td)
 	argvlen[argc] = rkey.len;
 	argc++;
 
-	if(td->s_method.len == 9 && strncmp(td->s_method.s, "SUBSCRIBE", 9) == 0) {
-		lval = (unsigned long)td->expires;
-	} else {
-		lval = (unsigned long)_tps_api.get_dialog_expire();
-	}
-
-	if(lval == 0) {
-		return 0;
-	}
 	TPS_REDIS_SET_ARGNV(lval, rp, &rval, argc, argv, argvlen);
 
 	rrpl = _tps_redis_api.exec_argv(rsrv, argc, (const char **)argv, argvlen);
@@ -433,6 +478,13 @@ int tps_redis_insert_branch(tps_data_t *td)
 	char *argv[TPS_REDIS_NR_KEYS];
 	size_t argvlen[TPS_REDIS_NR_KEYS];
 	int argc = 0;
+	char *eargv[4];
+	size_t eargvlen[4];
+	int eargc = 0;
+	int argcv[2];
+	const char **argvv[2];
+	const size_t *argvlenv[2];
+	redisReply *rplv[2];
 	str rcmd = str_init("HMSET");
 	str rkey = STR_NULL;
 	char *rp;
@@ -440,6 +492,7 @@ int tps_redis_insert_branch(tps_data_t *td)
 	redisc_server_t *rsrv = NULL;
 	redisReply *rrpl = NULL;
 	unsigned long lval = 0;
+	unsigned long eval = 0;
 
 	if(td->x_vbranch1.len <= 0) {
 		LM_INFO("no via branch for this message\n");
@@ -509,6 +562,43 @@ int tps_redis_insert_branch(tps_data_t *td)
 
 	TPS_REDIS_SET_ARGS(&td->x_context, argc, &tt_key_x_context, argv, argvlen);
 
+	eval = (unsigned long)_tps_api.get_branch_expire();
+
+	if(eval != 0 && _tps_redis_api.exec_argv_many != NULL) {
+		/* pipeline HMSET and EXPIRE in one round trip */
+		eargv[eargc] = "EXPIRE";
+		eargvlen[eargc] = 6;
+		eargc++;
+
+		eargv[eargc] = rkey.s;
+		eargvlen[eargc] = rkey.len;
+		eargc++;
+
+		TPS_REDIS_SET_ARGNV(eval, rp, &rval, eargc, eargv, eargvlen);
+
+		argcv[0] = argc;
+		argvv[0] = (const char **)argv;
+		argvlenv[0] = argvlen;
+		argcv[1] = eargc;
+		argvv[1] = (const char **)eargv;
+		argvlenv[1] = eargvlen;
+
+		if(_tps_redis_api.exec_argv_many(rsrv, 2, argcv, argvv, argvlenv, rplv)
+				< 0) {
+			LM_ERR("failed to execute pipelined redis commands\n");
+			if(rsrv->ctxRedis->err) {
+				LM_ERR("redis error: %s\n", rsrv->ctxRedis->errstr);
+			}
+			return -1;
+		}
+		LM_DBG("inserted branch record for [%.*s] with argc %d and expire"
+			   " %lu\n",
+				rkey.len, rkey.s, argc, eval);
+		freeReplyObject(rplv[0]);
+		freeReplyObject(rplv[1]);
+		return 0;
+	}
+
 	rrpl = _tps_redis_api.exec_argv(rsrv, argc, (const char **)argv, argvlen);
 	if(rrpl == NULL) {
 		LM_ERR("failed to execute redis command\n");
@@ -522,6 +612,11 @@ int tps_redis_insert_branch(tps_data_t *td)
 
 	freeReplyObject(rrpl);
 
+	lval = eval;
+	if(lval == 0) {
+		return 0;
+	}
+
 	/* set expire for the key */
 	argc = 0;
 
@@ -533,10 +628,6 @@ int tps_redis_insert_branch(tps_data_t *td)
 	argvlen[argc] = rkey.len;
 	argc++;
 
-	lval = (unsigned long)_tps_api.get_branch_expire();
-	if(lval == 0) {
-		return 0;
-	}
 	TPS_REDIS_SET_ARGNV(lval, rp, &rval, argc, argv, argvlen);
 
 	rrpl = _tps_redis_api.exec_argv(rsrv, argc, (const char **)argv, argvlen);
@@ -47,6 +47,8 @@ int ts_append(struct sip_msg *msg, str *ruri, str *contact, char *table)
 	struct sip_uri c_uri;
 	str *t_uri;
 
+	unsigned int *tpairs = NULL;
+	int n, i;
 	int res;
 	int appended;
 
@@ -80,21 +82,39 @@ int ts_append(struct sip_msg *msg, str *ruri, str *contact, char *table)
 		return -2;
 	}
 
-	/* cycle through existing transactions */
-	ptr = _r->transactions;
+	/* snapshot the transaction identifiers and run the appends with the
+	 * entry unlocked - t_lookup_ident() revalidates each one, so any
+	 * transaction completed meanwhile is simply skipped */
+	n = 0;
+	for(ptr = _r->transactions; ptr != NULL; ptr = ptr->next)
+		n++;
+	if(n == 0) {
+		unlock_entry_by_ruri(t_uri);
+		return 1;
+	}
+	tpairs = (unsigned int *)pkg_malloc(2 * n * sizeof(unsigned int));
+	if(tpairs == NULL) {
+		unlock_entry_by_ruri(t_uri);
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	for(i = 0, ptr = _r->transactions; ptr != NULL; ptr = ptr->next, i++) {
+		tpairs[2 * i] = ptr->tindex;
+		tpairs[2 * i + 1] = ptr->tlabel;
+	}
 
-	while(ptr) {
+	unlock_entry_by_ruri(t_uri);
+
+	for(i = 0; i < n; i++) {
 		LM_DBG("transaction %u:%u found for %.*s, going to append branches\n",
-				ptr->tindex, ptr->tlabel, t_uri->len, t_uri->s);
+				tpairs[2 * i], tpairs[2 * i + 1], t_uri->len, t_uri->s);
 
 		appended = ts_append_to(
-				msg, ptr->tindex, ptr->tlabel, table, ruri, contact);
+				msg, tpairs[2 * i], tpairs[2 * i + 1], table, ruri, contact);
 		if(appended > 0)
 			update_stat(added_branches, appended);
-		ptr = ptr->next;
 	}
-
-	unlock_entry_by_ruri(t_uri);
+	pkg_free(tpairs);
 
 	return 1;
 }
@@ -183,6 +203,8 @@ int ts_append_branches(sip_msg_t *msg, str *ruri)
 	sip_uri_t p_uri;
 	str *t_uri = NULL;
 	str contact = STR_NULL;
+	unsigned int *tpairs = NULL;
+	int n, i;
 	int orig_branch;
 	int res;
 
@@ -208,30 +230,54 @@ int ts_append_branches(sip_msg_t *msg, str *ruri)
 		return -2;
 	}
 
-	/* cycle through existing transactions */
-	for(ptr = _r->transactions; ptr != NULL; ptr = ptr->next) {
+	/* snapshot the transaction identifiers and run the appends with the
+	 * entry unlocked - t_lookup_ident() revalidates each one, so any
+	 * transaction completed meanwhile is simply skipped */
+	n = 0;
+	for(ptr = _r->transactions; ptr != NULL; ptr = ptr->next)
+		n++;
+	if(n == 0) {
+		unlock_entry_by_ruri(t_uri);
+		return 1;
+	}
+	tpairs = (unsigned int *)pkg_malloc(2 * n * sizeof(unsigned int));
+	if(tpairs == NULL) {
+		unlock_entry_by_ruri(t_uri);
+		PKG_MEM_ERROR;
+		return -1;
+	}
+	for(i = 0, ptr = _r->transactions; ptr != NULL; ptr = ptr->next, i++) {
+		tpairs[2 * i] = ptr->tindex;
+		tpairs[2 * i + 1] = ptr->tlabel;
+	}
+
+	unlock_entry_by_ruri(t_uri);
+
+	for(i = 0; i < n; i++) {
 		LM_DBG("transaction %u:%u found for %.*s, going to append branches\n",
-				ptr->tindex, ptr->tlabel, t_uri->len, t_uri->s);
+				tpairs[2 * i], tpairs[2 * i + 1], t_uri->len, t_uri->s);
 
 		_tmb.get_tb(&orig_t, &orig_branch);
 
 		/* lookup a transaction based on its identifier (hash_index:label) */
-		if(_tmb.t_lookup_ident(&t, ptr->tindex, ptr->tlabel) < 0 || t == NULL) {
-			LM_ERR("transaction [%u:%u] not found\n", ptr->tindex, ptr->tlabel);
+		if(_tmb.t_lookup_ident(&t, tpairs[2 * i], tpairs[2 * i + 1]) < 0
+				|| t == NULL) {
+			LM_ERR("transaction [%u:%u] not found\n", tpairs[2 * i],
+					tpairs[2 * i + 1]);
 			continue;
 		}
 
 		/* check if the dialog is still in the early stage */
 		if(t->flags & T_CANCELED) {
-			LM_DBG("transaction [%u:%u] was cancelled\n", ptr->tindex,
-					ptr->tlabel);
+			LM_DBG("transaction [%u:%u] was cancelled\n", tpairs[2 * i],
+					tpairs[2 * i + 1]);
 			goto done;
 		}
 
 		if(t->uas.status >= 200) {
 			LM_DBG("transaction [%u:%u] sent out a final response already - "
 				   "%d\n",
-					ptr->tindex, ptr->tlabel, t->uas.status);
+					tpairs[2 * i], tpairs[2 * i + 1], t->uas.status);
 			goto done;
 		}
 
@@ -249,8 +295,7 @@ int ts_append_branches(sip_msg_t *msg, str *ruri)
 		_tmb.unref_cell(t);
 		_tmb.set_tb(orig_t, orig_branch);
 	}
-
-	unlock_entry_by_ruri(t_uri);
+	pkg_free(tpairs);
 
 	return 1;
 }
@@ -72,7 +72,6 @@ void free_ts_urecord(struct ts_urecord *urecord)
  */
 int init_ts_table(unsigned int size)
 {
-	unsigned int n;
 	unsigned int i;
 
 	t_table = (struct ts_table *)shm_malloc(sizeof(struct ts_table));
@@ -85,26 +84,6 @@ int init_ts_table(unsigned int size)
 
 	t_table->size = size;
 
-	n = (size < MAX_TS_LOCKS) ? size : MAX_TS_LOCKS;
-	for(; n >= MIN_TS_LOCKS; n--) {
-		t_table->locks = lock_set_alloc(n);
-		if(t_table->locks == 0)
-			continue;
-		if(lock_set_init(t_table->locks) == 0) {
-			lock_set_dealloc(t_table->locks);
-			t_table->locks = 0;
-			continue;
-		}
-		t_table->locks_no = n;
-		break;
-	}
-
-	if(t_table->locks == 0) {
-		LM_ERR("unable to allocted at least %d locks for the hash table\n",
-				MIN_TS_LOCKS);
-		goto error;
-	}
-
 	t_table->entries = (ts_entry_t *)shm_malloc(sizeof(ts_entry_t) * size);
 	if(!t_table->entries) {
 		SHM_MEM_ERROR;
@@ -114,7 +93,13 @@ int init_ts_table(unsigned int size)
 	for(i = 0; i < size; i++) {
 		memset(&(t_table->entries[i]), 0, sizeof(struct ts_entry));
 		t_table->entries[i].next_id = kam_rand() % (3 * size);
-		t_table->entries[i].lock_idx = i % t_table->locks_no;
+		if(lock_init(&t_table->entries[i].lock) == NULL) {
+			LM_ERR("unable to initialize the lock of slot %u\n", i);
+			while(i > 0)
+				lock_destroy(&t_table->entries[--i].lock);
+			shm_free(t_table->entries);
+			goto error;
+		}
 	}
 
 	return 0;
@@ -135,12 +120,8 @@ void destroy_ts_table(void)
 	if(t_table == 0)
 		return;
 
-	if(t_table->locks) {
-		lock_set_destroy(t_table->locks);
-		lock_set_dealloc(t_table->locks);
-	}
-
 	for(i = 0; i < t_table->size; i++) {
+		lock_destroy(&t_table->entries[i].lock);
 		ts_u = t_table->entries[i].first;
 		while(ts_u) {
 			l_ts_u = ts_u;
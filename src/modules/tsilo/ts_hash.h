@@ -34,9 +34,6 @@
 #include "../../core/locking.h"
 #include "../../modules/tm/tm_load.h"
 
-#define MAX_TS_LOCKS 2048
-#define MIN_TS_LOCKS 2
-
 extern stat_var *stored_ruris;
 extern stat_var *stored_transactions;
 extern stat_var *total_ruris;
@@ -76,7 +73,7 @@ typedef struct ts_entry
 	struct ts_urecord *first; /*!< urecord list */
 	struct ts_urecord *last;  /*!< optimisation, end of the urecord list */
 	unsigned int next_id;	  /*!< next id */
-	unsigned int lock_idx;	  /*!< lock index */
+	gen_lock_t lock;		  /*!< lock of the slot */
 } ts_entry_t;
 
 
@@ -85,8 +82,6 @@ typedef struct ts_table
 {
 	unsigned int size;		  /*!< size of the tsilo table */
 	struct ts_entry *entries; /*!< urecord hash table */
-	unsigned int locks_no;	  /*!< number of locks */
-	gen_lock_set_t *locks;	  /*!< lock table */
 } ts_table_t;
 
 /*! global transactions table */
@@ -97,16 +92,14 @@ extern ts_table_t *t_table;
  * \param _table transaction table
  * \param _entry locked entry
  */
-#define ts_lock(_table, _entry) \
-	lock_set_get((_table)->locks, (_entry)->lock_idx);
+#define ts_lock(_table, _entry) lock_get(&(_entry)->lock);
 
 /*!
  * \brief Release a transaction lock
  * \param _table transaction table
  * \param _entry locked entry
  */
-#define ts_unlock(_table, _entry) \
-	lock_set_release((_table)->locks, (_entry)->lock_idx);
+#define ts_unlock(_table, _entry) lock_release(&(_entry)->lock);
 
 void lock_entry(ts_entry_t *entry);
 void unlock_entry(ts_entry_t *entry);
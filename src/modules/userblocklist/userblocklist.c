@@ -77,15 +77,19 @@ typedef struct _avp_check
 } avp_check_t;
 
 
+struct source_t;
+
 struct check_blocklist_fs_t
 {
-	struct dtrie_node_t *dtrie_root;
+	/* the source is stored instead of its d-tree root so the checks always
+	 * pick up the tree published by the last reload */
+	struct source_t *src;
 };
 
 str userblocklist_db_url = str_init(DEFAULT_RODB_URL);
 int use_domain = 0;
 int match_mode = 10; /* numeric */
-static struct dtrie_node_t *gnode = NULL;
+static struct source_t *gsrc = NULL;
 
 /* ---- fixup functions: */
 static int check_blocklist_fixup(void **param, int param_no);
@@ -183,6 +187,9 @@ struct source_t
 	char *table;
 	/** d-tree structure: will be built from data in database */
 	struct dtrie_node_t *dtrie_root;
+	/** d-tree retired by the last reload: kept one reload cycle so
+	 * lookups started on it can run to completion */
+	struct dtrie_node_t *dtrie_old;
 };
 
 
@@ -395,15 +402,15 @@ static int ki_check_user_blocklist_number(
 }
 
 /**
- * Finds d-tree root for given table.
- * \return pointer to d-tree root on success, NULL otherwise
+ * Finds the source for given table.
+ * \return pointer to the source on success, NULL otherwise
  */
-static struct dtrie_node_t *table2dt(const char *table)
+static struct source_t *table2src(const char *table)
 {
 	struct source_t *src = sources->head;
 	while(src) {
 		if(strcmp(table, src->table) == 0)
-			return src->dtrie_root;
+			return src;
 		src = src->next;
 	}
 
@@ -419,6 +426,7 @@ static struct dtrie_node_t *table2dt(const char *table)
 static int load_source(struct source_t *src)
 {
 	str tmp;
+	struct dtrie_node_t *new_root;
 	int result;
 
 	if(!src || !src->table) {
@@ -429,12 +437,27 @@ static int load_source(struct source_t *src)
 	tmp.s = src->table;
 	tmp.len = strlen(src->table);
 
-	result = db_reload_source(&tmp, src->dtrie_root);
+	/* build the new d-tree aside, lookups keep using the published one */
+	new_root = dtrie_init(match_mode);
+	if(new_root == NULL) {
+		LM_ERR("could not initialize data\n");
+		return -1;
+	}
+
+	result = db_reload_source(&tmp, new_root);
 	if(result < 0) {
 		LM_ERR("cannot load source from '%.*s'\n", tmp.len, tmp.s);
+		dtrie_destroy(&new_root, NULL, match_mode);
 		return 0;
 	}
 
+	/* publish the new d-tree; the tree retired by the previous reload has
+	 * been unreferenced for a whole reload cycle and can be freed now */
+	if(src->dtrie_old)
+		dtrie_destroy(&src->dtrie_old, NULL, match_mode);
+	src->dtrie_old = src->dtrie_root;
+	src->dtrie_root = new_root;
+
 	LM_INFO("got %d entries from '%.*s'\n", result, tmp.len, tmp.s);
 	return result;
 }
@@ -480,14 +503,6 @@ static int add_source(const char *table)
 	strcpy(src->table, table);
 	LM_DBG("add table %s", table);
 
-	src->dtrie_root = dtrie_init(match_mode);
-
-	if(src->dtrie_root == NULL) {
-		LM_ERR("could not initialize data");
-		lock_release(lock);
-		return -1;
-	}
-
 	if(load_source(src) < 0) {
 		LM_ERR("could not load table data");
 		lock_release(lock);
@@ -517,8 +532,8 @@ static int check_globalblocklist_fixup(void **param, int param_no)
 		return -1;
 	}
 
-	gnode = table2dt(table);
-	if(!gnode) {
+	gsrc = table2src(table);
+	if(!gsrc) {
 		LM_ERR("invalid table '%s'\n", table);
 		return -1;
 	}
@@ -542,8 +557,8 @@ static int ki_check_globalblocklist(sip_msg_t *msg)
 		return -1;
 	}
 
-	gnode = table2dt(table);
-	if(!gnode) {
+	gsrc = table2src(table);
+	if(!gsrc) {
 		LM_ERR("invalid table '%s'\n", table);
 		return -1;
 	}
@@ -554,7 +569,7 @@ static int ki_check_globalblocklist(sip_msg_t *msg)
 		return -1;
 	}
 	memset(arg, 0, sizeof(struct check_blocklist_fs_t));
-	arg->dtrie_root = gnode;
+	arg->src = gsrc;
 
 	result = check_blocklist(msg, arg);
 	pkg_free(arg);
@@ -572,7 +587,7 @@ static int check_globalblocklist(sip_msg_t *msg)
 			return -1;
 		}
 		memset(arg, 0, sizeof(struct check_blocklist_fs_t));
-		arg->dtrie_root = gnode;
+		arg->src = gsrc;
 	}
 	return check_blocklist(msg, arg);
 }
@@ -580,7 +595,7 @@ static int check_globalblocklist(sip_msg_t *msg)
 static int check_blocklist_fixup(void **arg, int arg_no)
 {
 	char *table = (char *)(*arg);
-	struct dtrie_node_t *node = NULL;
+	struct source_t *src = NULL;
 	struct check_blocklist_fs_t *new_arg;
 
 	if(arg_no != 1) {
@@ -598,9 +613,9 @@ static int check_blocklist_fixup(void **arg, int arg_no)
 		return -1;
 	}
 
-	/* get the node that belongs to the table */
-	node = table2dt(table);
-	if(!node) {
+	/* get the source that belongs to the table */
+	src = table2src(table);
+	if(!src) {
 		LM_ERR("invalid table '%s'\n", table);
 		return -1;
 	}
@@ -611,7 +626,7 @@ static int check_blocklist_fixup(void **arg, int arg_no)
 		return -1;
 	}
 	memset(new_arg, 0, sizeof(struct check_blocklist_fs_t));
-	new_arg->dtrie_root = node;
+	new_arg->src = src;
 	*arg = (void *)new_arg;
 
 	return 0;
@@ -625,7 +640,7 @@ static int check_blocklist_fixup_free(void **arg, int arg_no)
 
 static int ki_check_blocklist(sip_msg_t *msg, str *stable)
 {
-	struct dtrie_node_t *node = NULL;
+	struct source_t *src = NULL;
 	struct check_blocklist_fs_t *arg = NULL;
 	int result;
 
@@ -640,9 +655,9 @@ static int ki_check_blocklist(sip_msg_t *msg, str *stable)
 		return -1;
 	}
 
-	/* get the node that belongs to the table */
-	node = table2dt(stable->s);
-	if(!node) {
+	/* get the source that belongs to the table */
+	src = table2src(stable->s);
+	if(!src) {
 		LM_ERR("invalid table '%s'\n", stable->s);
 		return -1;
 	}
@@ -653,7 +668,7 @@ static int ki_check_blocklist(sip_msg_t *msg, str *stable)
 		return -1;
 	}
 	memset(arg, 0, sizeof(struct check_blocklist_fs_t));
-	arg->dtrie_root = node;
+	arg->src = src;
 
 	result = check_blocklist(msg, arg);
 	pkg_free(arg);
@@ -664,6 +679,7 @@ static int ki_check_blocklist(sip_msg_t *msg, str *stable)
 static int check_blocklist(sip_msg_t *msg, struct check_blocklist_fs_t *arg1)
 {
 	void **nodeflags;
+	struct dtrie_node_t *droot;
 	char *ptr;
 	char req_number[MAXNUMBERLEN + 1];
 	int ret = -1;
@@ -689,10 +705,15 @@ static int check_blocklist(sip_msg_t *msg, struct check_blocklist_fs_t *arg1)
 
 	LM_DBG("check entry %s\n", req_number);
 
-	/* avoids dirty reads when updating d-tree */
-	lock_get(lock);
-	nodeflags = dtrie_longest_match(
-			arg1->dtrie_root, ptr, strlen(ptr), NULL, match_mode);
+	/* grab the published d-tree - the reload builds the new tree aside and
+	 * keeps the retired one around for a full reload cycle, so the lookup
+	 * runs without taking the lock */
+	droot = arg1->src->dtrie_root;
+	if(!droot) {
+		LM_ERR("no d-tree loaded for table '%s'\n", arg1->src->table);
+		return -1;
+	}
+	nodeflags = dtrie_longest_match(droot, ptr, strlen(ptr), NULL, match_mode);
 	if(nodeflags) {
 		if(*nodeflags == (void *)MARK_ALLOWLIST) {
 			/* LM_DBG("allowlisted"); */
@@ -704,14 +725,13 @@ static int check_blocklist(sip_msg_t *msg, struct check_blocklist_fs_t *arg1)
 		/* LM_ERR("not found"); */
 		ret = 1; /* not found is ok */
 	}
-	lock_release(lock);
 
 	return ret;
 }
 
 static int ki_check_allowlist(sip_msg_t *msg, str *stable)
 {
-	struct dtrie_node_t *node = NULL;
+	struct source_t *src = NULL;
 	struct check_blocklist_fs_t *arg = NULL;
 	int result;
 
@@ -726,9 +746,9 @@ static int ki_check_allowlist(sip_msg_t *msg, str *stable)
 		return -1;
 	}
 
-	/* get the node that belongs to the table */
-	node = table2dt(stable->s);
-	if(!node) {
+	/* get the source that belongs to the table */
+	src = table2src(stable->s);
+	if(!src) {
 		LM_ERR("invalid table '%s'\n", stable->s);
 		return -1;
 	}
@@ -739,7 +759,7 @@ static int ki_check_allowlist(sip_msg_t *msg, str *stable)
 		return -1;
 	}
 	memset(arg, 0, sizeof(struct check_blocklist_fs_t));
-	arg->dtrie_root = node;
+	arg->src = src;
 
 	result = check_allowlist(msg, arg);
 	pkg_free(arg);
@@ -750,6 +770,7 @@ static int ki_check_allowlist(sip_msg_t *msg, str *stable)
 static int check_allowlist(sip_msg_t *msg, struct check_blocklist_fs_t *arg1)
 {
 	void **nodeflags;
+	struct dtrie_node_t *droot;
 	char *ptr;
 	char req_number[MAXNUMBERLEN + 1];
 	int ret = -1;
@@ -775,10 +796,13 @@ static int check_allowlist(sip_msg_t *msg, struct check_blocklist_fs_t *arg1)
 
 	LM_DBG("check entry %s\n", req_number);
 
-	/* avoids dirty reads when updating d-tree */
-	lock_get(lock);
-	nodeflags = dtrie_longest_match(
-			arg1->dtrie_root, ptr, strlen(ptr), NULL, match_mode);
+	/* grab the published d-tree - no lock needed, see check_blocklist() */
+	droot = arg1->src->dtrie_root;
+	if(!droot) {
+		LM_ERR("no d-tree loaded for table '%s'\n", arg1->src->table);
+		return -1;
+	}
+	nodeflags = dtrie_longest_match(droot, ptr, strlen(ptr), NULL, match_mode);
 	if(nodeflags) {
 		if(*nodeflags == (void *)MARK_ALLOWLIST) {
 			/* LM_DBG("allowlisted"); */
@@ -790,7 +814,6 @@ static int check_allowlist(sip_msg_t *msg, struct check_blocklist_fs_t *arg1)
 		/* LM_ERR("not found"); */
 		ret = -1; /* not found is ok */
 	}
-	lock_release(lock);
 
 	return ret;
 }
@@ -804,7 +827,9 @@ static int reload_sources(void)
 	int result = 0;
 	struct source_t *src;
 
-	/* critical section start: avoids dirty reads when updating d-tree */
+	/* the lock only serializes concurrent reloads; lookups run on the
+	 * published d-trees without taking it, so routing is not paused while
+	 * the new trees are built */
 	lock_get(lock);
 
 	src = sources->head;
@@ -847,6 +872,8 @@ static void destroy_source_list(void)
 			if(src->table)
 				shm_free(src->table);
 			dtrie_destroy(&(src->dtrie_root), NULL, match_mode);
+			if(src->dtrie_old)
+				dtrie_destroy(&(src->dtrie_old), NULL, match_mode);
 			shm_free(src);
 		}
 
@@ -980,7 +1007,7 @@ static struct mi_root *check_list_mi(struct mi_root *cmd, int list_type)
 		return init_mi_tree(400, MI_MISSING_PARM_S, MI_MISSING_PARM_LEN);
 
 	/* Check that global blocklist exists */
-	if(!gnode) {
+	if(!gsrc || !gsrc->dtrie_root) {
 		LM_ERR("the global blocklist is NULL\n");
 		return init_mi_tree(500, MI_INTERNAL_ERR_S, MI_INTERNAL_ERR_LEN);
 	}
@@ -998,9 +1025,9 @@ static struct mi_root *check_list_mi(struct mi_root *cmd, int list_type)
 		ptr = ptr + 1;
 	}
 
-	/* Avoids dirty reads when updating d-tree */
-	lock_get(lock);
-	nodeflags = dtrie_longest_match(gnode, ptr, strlen(ptr), NULL, match_mode);
+	/* lookup on the published d-tree, no lock needed */
+	nodeflags = dtrie_longest_match(
+			gsrc->dtrie_root, ptr, strlen(ptr), NULL, match_mode);
 	if(nodeflags) {
 		if(*nodeflags == (void *)MARK_ALLOWLIST) {
 			LM_DBG("prefix %.*s is allowlisted in table %.*s\n", prefix.len,
@@ -1017,7 +1044,6 @@ static struct mi_root *check_list_mi(struct mi_root *cmd, int list_type)
 		LM_DBG("prefix %.*s not found in table %.*s\n", prefix.len, prefix.s,
 				globalblocklist_table.len, globalblocklist_table.s);
 	}
-	lock_release(lock);
 
 	/* Create new node and add it to the reply roots' kids */
 	if(!(crt_node = add_mi_node_child(
@@ -1233,7 +1259,7 @@ struct mi_root *mi_dump_blocklist(struct mi_root *cmd, void *param)
 	struct mi_root *tmp = NULL;
 
 	/* Check that global blocklist exists */
-	if(!gnode) {
+	if(!gsrc || !gsrc->dtrie_root) {
 		LM_ERR("the global blocklist is NULL\n");
 		return init_mi_tree(500, MI_INTERNAL_ERR_S, MI_INTERNAL_ERR_LEN);
 	}
@@ -1244,7 +1270,7 @@ struct mi_root *mi_dump_blocklist(struct mi_root *cmd, void *param)
 		return init_mi_tree(500, MI_INTERNAL_ERR_S, MI_INTERNAL_ERR_LEN);
 	}
 
-	dump_dtrie_mi(gnode, match_mode, prefix_buff, &length, tmp);
+	dump_dtrie_mi(gsrc->dtrie_root, match_mode, prefix_buff, &length, tmp);
 
 	return tmp;
 }
@@ -1345,12 +1371,13 @@ static void dump_blocklist_rpc(rpc_t *rpc, void *ctx)
 	int length = 0;
 
 	/* Check that global blocklist exists */
-	if(!gnode) {
+	if(!gsrc || !gsrc->dtrie_root) {
 		LM_ERR("the global blocklist is NULL\n");
 		goto error;
 	}
 
-	dump_dtrie_rpc(rpc, ctx, gnode, match_mode, prefix_buff, &length);
+	dump_dtrie_rpc(
+			rpc, ctx, gsrc->dtrie_root, match_mode, prefix_buff, &length);
 
 	return;
 
@@ -1378,8 +1405,8 @@ static void check_list_rpc(rpc_t *rpc, void *ctx, int list_type)
 	req_prefix[prefix.len] = '\0';
 
 	/* Check that global blocklist exists */
-	if(!gnode) {
-		LM_ERR("global gnode not found\n");
+	if(!gsrc || !gsrc->dtrie_root) {
+		LM_ERR("global blocklist not found\n");
 		goto error;
 	}
 
@@ -1389,9 +1416,9 @@ static void check_list_rpc(rpc_t *rpc, void *ctx, int list_type)
 		ptr = ptr + 1;
 	}
 
-	/* Avoids dirty reads when updating d-tree */
-	lock_get(lock);
-	nodeflags = dtrie_longest_match(gnode, ptr, strlen(ptr), NULL, match_mode);
+	/* lookup on the published d-tree, no lock needed */
+	nodeflags = dtrie_longest_match(
+			gsrc->dtrie_root, ptr, strlen(ptr), NULL, match_mode);
 	if(nodeflags) {
 		if(*nodeflags == (void *)MARK_ALLOWLIST) {
 			LM_DBG("prefix %.*s is allowlisted in table %.*s\n", prefix.len,
@@ -1408,7 +1435,6 @@ static void check_list_rpc(rpc_t *rpc, void *ctx, int list_type)
 		LM_DBG("prefix %.*s not found in table %.*s\n", prefix.len, prefix.s,
 				globalblocklist_table.len, globalblocklist_table.s);
 	}
-	lock_release(lock);
 
 	/* Resolve the value of the attribute to be returned */
 	val.s = FALSE_S;
@@ -1474,8 +1500,8 @@ static void check_userlist_rpc(rpc_t *rpc, void *ctx, int list_type)
 	req_prefix[prefix.len] = '\0';
 
 	/* Check that global blocklist exists */
-	if(!gnode) {
-		LM_ERR("global gnode not found\n");
+	if(!gsrc || !gsrc->dtrie_root) {
+		LM_ERR("global blocklist not found\n");
 		goto error;
 	}
 
@@ -524,6 +524,8 @@ static inline int get_all_mem_ucontacts(void *buf, int len, unsigned int flags,
 	dlist_t *p;
 	urecord_t *r;
 	ucontact_t *c;
+	hslot_t *ht;
+	int hsize;
 	void *cp;
 	int shortage;
 	int needed;
@@ -541,17 +543,23 @@ static inline int get_all_mem_ucontacts(void *buf, int len, unsigned int flags,
 
 	for(p = _ksr_ul_root; p != NULL; p = p->next) {
 
-		for(i = 0; i < p->d->size; i++) {
+		/* work on a snapshot of the table - an online rehash may swap
+		 * the domain fields meanwhile; contacts migrated during this
+		 * run are picked up by the next one */
+		ht = p->d->table;
+		hsize = p->d->size;
+
+		for(i = 0; i < hsize; i++) {
 
 			if((i % part_max) != part_idx)
 				continue;
 
-			lock_ulslot(p->d, i);
-			if(p->d->table[i].n <= 0) {
-				unlock_ulslot(p->d, i);
+			lock_ulslot_at(ht, i);
+			if(ht[i].n <= 0) {
+				unlock_ulslot_at(ht, i);
 				continue;
 			}
-			for(r = p->d->table[i].first; r != NULL; r = r->next) {
+			for(r = ht[i].first; r != NULL; r = r->next) {
 				for(c = r->contacts; c != NULL; c = c->next) {
 					if(c->c.len <= 0)
 						continue;
@@ -612,7 +620,7 @@ static inline int get_all_mem_ucontacts(void *buf, int len, unsigned int flags,
 					}
 				}
 			}
-			unlock_ulslot(p->d, i);
+			unlock_ulslot_at(ht, i);
 		}
 	}
 	/* len < 0 is possible, if size of the buffer < sizeof(c->c.len) */
@@ -684,18 +692,17 @@ int ul_update_keepalive(
 	dlist_t *p;
 	urecord_t *r;
 	ucontact_t *c;
-	int i;
+	hslot_t *s;
 
 	/* todo: get location domain via param */
 
 	for(p = _ksr_ul_root; p != NULL; p = p->next) {
-		i = _aorhash & (p->d->size - 1);
-		lock_ulslot(p->d, i);
-		if(p->d->table[i].n <= 0) {
-			unlock_ulslot(p->d, i);
+		s = lock_ulaorhash(p->d, _aorhash);
+		if(s->n <= 0) {
+			unlock_ulaorhash(p->d, _aorhash);
 			continue;
 		}
-		for(r = p->d->table[i].first; r != NULL; r = r->next) {
+		for(r = s->first; r != NULL; r = r->next) {
 			if(r->aorhash == _aorhash) {
 				for(c = r->contacts; c != NULL; c = c->next) {
 					if(c->c.len <= 0 || c->ruid.len <= 0)
@@ -710,13 +717,13 @@ int ul_update_keepalive(
 								_ruid->len, _ruid->s, _aorhash,
 								(unsigned int)c->last_keepalive,
 								c->ka_roundtrip);
-						unlock_ulslot(p->d, i);
+						unlock_ulaorhash(p->d, _aorhash);
 						return 0;
 					}
 				}
 			}
 		}
-		unlock_ulslot(p->d, i);
+		unlock_ulaorhash(p->d, _aorhash);
 	}
 
 	return 0;
@@ -764,7 +771,8 @@ static inline int new_dlist(str *_n, dlist_t **_d)
 	ptr->name.len = _n->len;
 	ptr->name.s[ptr->name.len] = 0;
 
-	if(new_udomain(&(ptr->name), ul_hash_size, &(ptr->d)) < 0) {
+	if(new_udomain(&(ptr->name), ul_domain_hash_size(&(ptr->name)), &(ptr->d))
+			< 0) {
 		LM_ERR("creating domain structure failed\n");
 		shm_free(ptr->name.s);
 		shm_free(ptr);
@@ -42,6 +42,7 @@ int init_slot(struct udomain *_d, hslot_t *_s, int n)
 	_s->first = 0;
 	_s->last = 0;
 	_s->d = _d;
+	_s->nextdue = 0;
 	if(rec_lock_init(&_s->rlock) == NULL) {
 		LM_ERR("failed to initialize the slock (%d)\n", n);
 		return -1;
@@ -79,6 +80,8 @@ void deinit_slot(hslot_t *_s)
  */
 void slot_add(hslot_t *_s, struct urecord *_r)
 {
+	struct ucontact *c;
+
 	if(_s->n == 0) {
 		_s->first = _s->last = _r;
 	} else {
@@ -88,6 +91,10 @@ void slot_add(hslot_t *_s, struct urecord *_r)
 	}
 	_s->n++;
 	_r->slot = _s;
+	/* keep the expiry mark valid when a record with contacts moves
+	 * between slots (online rehash) */
+	for(c = _r->contacts; c != NULL; c = c->next)
+		slot_due_update(_s, c->expires);
 }
 
 
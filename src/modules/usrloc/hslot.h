@@ -45,9 +45,25 @@ typedef struct hslot
 	struct urecord *first; /*!< First element in the list */
 	struct urecord *last;  /*!< Last element in the list */
 	struct udomain *d;	   /*!< Domain we belong to */
+	time_t nextdue; /*!< Earliest contact expiry in the slot - 0 if unknown */
 	rec_lock_t rlock;	   /*!< Recursive lock for hash entry */
 } hslot_t;
 
+/*! \brief
+ * Lower the earliest-expiry mark of the slot after a contact change
+ *
+ * To be called with the slot lock held. The mark only moves backwards
+ * here - the memory timer recomputes it when it scans the slot. A zero
+ * contact expiry means a permanent contact, which never becomes due.
+ */
+static inline void slot_due_update(hslot_t *_s, time_t _e)
+{
+	if(_e == 0)
+		return;
+	if(_s->nextdue == 0 || _e < _s->nextdue)
+		_s->nextdue = _e;
+}
+
 /*! \brief
  * Initialize slot structure
  */
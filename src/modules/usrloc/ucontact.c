@@ -744,6 +744,8 @@ int db_insert_ucontact(ucontact_t *_c)
 		}
 	}
 
+	_c->db_expires = _c->expires;
+
 	if(ul_xavp_contact_name.s) {
 		uldb_insert_attrs(_c->domain, &vals[0].val.str_val,
 				&vals[nr_cols - 1].val.str_val, &_c->ruid, _c->xavp);
@@ -1472,14 +1474,20 @@ int db_update_ucontact_instance(ucontact_t *_c)
  */
 int db_update_ucontact(ucontact_t *_c)
 {
-	if(ul_db_ops_ruid == 0)
+	int ret;
+
+	if(ul_db_ops_ruid == 0) {
 		if(_c->instance.len <= 0) {
-			return db_update_ucontact_addr(_c);
+			ret = db_update_ucontact_addr(_c);
 		} else {
-			return db_update_ucontact_instance(_c);
+			ret = db_update_ucontact_instance(_c);
 		}
-	else
-		return db_update_ucontact_ruid(_c);
+	} else {
+		ret = db_update_ucontact_ruid(_c);
+	}
+	if(ret == 0)
+		_c->db_expires = _c->expires;
+	return ret;
 }
 
 /*!
@@ -1720,6 +1728,64 @@ static inline int update_contact_db(ucontact_t *_c)
 	return 0;
 }
 
+/*!
+ * \brief Compare a str value, treating unset and empty as equal
+ * \param _a first value (can be NULL)
+ * \param _b second value (can be NULL)
+ * \return 1 if equal, 0 otherwise
+ */
+static inline int uc_str_eq(str *_a, str *_b)
+{
+	int alen;
+	int blen;
+
+	alen = (_a != NULL && _a->s != NULL) ? _a->len : 0;
+	blen = (_b != NULL && _b->s != NULL) ? _b->len : 0;
+	if(alen != blen)
+		return 0;
+	if(alen == 0)
+		return 1;
+	return (memcmp(_a->s, _b->s, alen) == 0) ? 1 : 0;
+}
+
+/*!
+ * \brief Check whether an update changes anything besides expires and cseq
+ *
+ * Compare the new contact info against the stored contact, covering the
+ * fields that mem_update_ucontact() copies and that end up in the database.
+ * Must be called before the memory update overwrites the stored values.
+ * \param _c stored contact
+ * \param _ci new contact informations
+ * \return 1 if only expires and cseq move, 0 otherwise
+ */
+static inline int ucontact_refresh_only(ucontact_t *_c, ucontact_info_t *_ci)
+{
+	if(_ci->xavp != NULL)
+		return 0;
+	if(_ci->q != _c->q || _ci->flags != _c->flags || _ci->cflags != _c->cflags
+			|| _ci->methods != _c->methods || _ci->server_id != _c->server_id
+			|| _ci->tcpconn_id != _c->tcpconn_id || _ci->sock != _c->sock)
+		return 0;
+	/* contact address is only rewritten when the instance is set */
+	if(_ci->instance.s != NULL && _ci->instance.len > 0
+			&& _ci->c != NULL && _ci->c->s != NULL && _ci->c->len > 0
+			&& !uc_str_eq(_ci->c, &_c->c))
+		return 0;
+	/* call-id must match too - with matching_mode 1 it is part of the
+	 * where clause of the database update, a stale value in the row
+	 * would make a later update miss it */
+	if(_ci->callid != NULL && _ci->callid->s != NULL && _ci->callid->len > 0
+			&& !uc_str_eq(_ci->callid, &_c->callid))
+		return 0;
+	if(!uc_str_eq(_ci->user_agent, &_c->user_agent))
+		return 0;
+	if(!uc_str_eq(&_ci->received, &_c->received))
+		return 0;
+	if(!uc_str_eq(_ci->path, &_c->path))
+		return 0;
+	return 1;
+}
+
 /*!
  * \brief Update ucontact with new values
  * \param _r record the contact belongs to
@@ -1730,6 +1796,19 @@ static inline int update_contact_db(ucontact_t *_c)
 int update_ucontact(struct urecord *_r, ucontact_t *_c, ucontact_info_t *_ci)
 {
 	struct urecord _ur;
+	int refresh;
+
+	/* check if this is a pure expiry refresh that can skip the database
+	 * write - has to be done before the memory update */
+	refresh = 0;
+	if(ul_db_refresh_lazy > 0
+			&& (ul_db_mode == WRITE_THROUGH || ul_db_mode == WRITE_BACK)
+			&& _c->state == CS_SYNC && _c->db_expires != 0
+			&& _ci->expires >= _c->db_expires
+			&& _ci->expires <= _c->db_expires + ul_db_refresh_lazy) {
+		refresh = ucontact_refresh_only(_c, _ci);
+	}
+
 	/* we have to update memory in any case, but database directly
 	 * only in db_mode 1 */
 	if(mem_update_ucontact(_c, _ci) < 0) {
@@ -1754,12 +1833,22 @@ int update_ucontact(struct urecord *_r, ucontact_t *_c, ucontact_info_t *_ci)
 	if(_r) {
 		if(ul_db_mode != DB_ONLY) {
 			update_contact_pos(_r, _c);
+			if(_r->slot)
+				slot_due_update(_r->slot, _c->expires);
 		} else {
 			/* urecord was static restore copy */
 			memcpy(_r, &_ur, sizeof(struct urecord));
 		}
 	}
 
+	if(refresh) {
+		/* the expiry stored in the database is at most db_refresh_lazy
+		 * seconds behind and nothing else changed - keep the contact in
+		 * CS_SYNC so neither the flush timer nor the write-through branch
+		 * below touches the database */
+		return 0;
+	}
+
 	st_update_ucontact(_c);
 
 	if(ul_db_mode == WRITE_THROUGH) {
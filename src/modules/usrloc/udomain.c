@@ -31,6 +31,7 @@
 #include "udomain.h"
 #include <string.h>
 #include "../../core/parser/parse_methods.h"
+#include "../../core/atomic_ops.h"
 #include "../../core/mem/shm_mem.h"
 #include "../../core/dprint.h"
 #include "../../lib/srdb1/db.h"
@@ -47,6 +48,12 @@
 
 extern int ul_rm_expired_delay;
 extern int ul_db_clean_tcp;
+extern int ul_db_flush_batch;
+extern int ul_ka_mode;
+
+/*! \brief mem timer runs to keep a retired hash table before freeing it,
+ * covering late readers that resolved a slot just before the rehash ended */
+#define UL_REHASH_GRACE 2
 
 enum col_index
 {
@@ -213,6 +220,20 @@ void free_udomain(udomain_t *_d)
 		}
 		shm_free(_d->table);
 	}
+	/* shutdown in the middle of a rehash - records not yet migrated
+	 * are still in the old table, the rest is in the target table */
+	if(_d->rehashing && _d->ntable) {
+		for(i = 0; i < _d->nsize; i++) {
+			deinit_slot(_d->ntable + i);
+		}
+		shm_free(_d->ntable);
+	}
+	if(_d->otable) {
+		for(i = 0; i < _d->osize; i++) {
+			deinit_slot(_d->otable + i);
+		}
+		shm_free(_d->otable);
+	}
 	shm_free(_d);
 }
 
@@ -1222,6 +1243,31 @@ int testdb_udomain(db1_con_t *con, udomain_t *d)
 }
 
 
+/*!
+ * \brief Resolve the slot currently holding records with given aor hash
+ *
+ * During an online rehash the records of the already migrated slots of
+ * the old table live in the target table. The result is stable as long
+ * as the caller holds the lock of the returned slot, because the rehash
+ * runner migrates a slot only while holding its lock.
+ * \param _d domain
+ * \param _h aor hash value
+ * \return hash slot for the aor hash
+ */
+static inline hslot_t *udomain_aorhash_slot(udomain_t *_d, unsigned int _h)
+{
+	int sl;
+
+	if(unlikely(_d->rehashing)) {
+		sl = _h & (_d->size - 1);
+		if(sl < _d->mslot)
+			return &_d->ntable[_h & (_d->nsize - 1)];
+		return &_d->table[sl];
+	}
+	return &_d->table[_h & (_d->size - 1)];
+}
+
+
 /*!
  * \brief Insert a new record into domain in memory
  * \param _d domain the record belongs to
@@ -1231,15 +1277,12 @@ int testdb_udomain(db1_con_t *con, udomain_t *d)
  */
 int mem_insert_urecord(udomain_t *_d, str *_aor, struct urecord **_r)
 {
-	int sl;
-
 	if(new_urecord(_d->name, _aor, _r) < 0) {
 		LM_ERR("creating urecord failed\n");
 		return -1;
 	}
 
-	sl = ((*_r)->aorhash) & (_d->size - 1);
-	slot_add(&_d->table[sl], *_r);
+	slot_add(udomain_aorhash_slot(_d, (*_r)->aorhash), *_r);
 	update_stat(_d->users, 1);
 	return 0;
 }
@@ -1258,6 +1301,121 @@ void mem_delete_urecord(udomain_t *_d, struct urecord *_r)
 }
 
 
+static int ul_db_batch_open = 0; /*!< Flush transaction in progress */
+static int ul_db_batch_ops = 0;	 /*!< Write operations in the open batch */
+
+/*!
+ * \brief Start a write-back flush batch
+ *
+ * Group the database writes of a timer pass, so one server round-trip
+ * covers up to db_flush_batch dirty contacts instead of one per
+ * statement. A driver statement batch (pipelining) is preferred when
+ * the driver offers one, otherwise the writes are wrapped in a
+ * transaction. No-op unless db_flush_batch is set, db_mode is
+ * WRITE_BACK and the driver supports either.
+ */
+void ul_db_batch_start(void)
+{
+	if(ul_db_flush_batch <= 0 || ul_db_mode != WRITE_BACK)
+		return;
+	if(DB_CAPABILITY(ul_dbf, DB_CAP_BATCH)) {
+		if(ul_dbf.batch_start(ul_dbh) < 0) {
+			LM_ERR("failed to start the flush batch\n");
+			return;
+		}
+	} else if(ul_dbf.start_transaction != NULL) {
+		if(ul_dbf.start_transaction(ul_dbh, DB_LOCKING_NONE) < 0) {
+			LM_ERR("failed to start the flush transaction\n");
+			return;
+		}
+	} else {
+		return;
+	}
+	ul_db_batch_open = 1;
+	ul_db_batch_ops = 0;
+}
+
+
+/*!
+ * \brief Account a write operation done within the flush batch
+ *
+ * Commits and reopens the transaction once db_flush_batch operations
+ * were collected, keeping the transaction size bounded.
+ */
+void ul_db_batch_step(void)
+{
+	if(!ul_db_batch_open)
+		return;
+	ul_db_batch_ops++;
+	if(ul_db_batch_ops < ul_db_flush_batch)
+		return;
+	ul_db_batch_end();
+	ul_db_batch_start();
+}
+
+
+/*!
+ * \brief Commit the write-back flush batch
+ */
+void ul_db_batch_end(void)
+{
+	if(!ul_db_batch_open)
+		return;
+	ul_db_batch_open = 0;
+	if(DB_CAPABILITY(ul_dbf, DB_CAP_BATCH)) {
+		if(ul_dbf.batch_end(ul_dbh) < 0) {
+			LM_ERR("failed to flush the statement batch - the database may"
+				   " miss some of %d contact updates until the contacts are"
+				   " modified again or expire\n",
+					ul_db_batch_ops);
+		}
+	} else if(ul_dbf.end_transaction != NULL) {
+		if(ul_dbf.end_transaction(ul_dbh) < 0) {
+			LM_ERR("failed to commit the flush transaction - the database may"
+				   " miss %d contact updates until the contacts are modified"
+				   " again or expire\n",
+					ul_db_batch_ops);
+			if(ul_dbf.abort_transaction)
+				ul_dbf.abort_transaction(ul_dbh);
+		}
+	}
+	ul_db_batch_ops = 0;
+}
+
+
+/*!
+ * \brief Free a retired hash table once its grace period is over
+ *
+ * The rehash runner cannot free the old table right away - a reader
+ * may still be blocked on one of its slot locks. The table is kept
+ * for UL_REHASH_GRACE timer runs instead; by then all such readers
+ * have retried against the live table and the retired slots are empty.
+ * \param _d domain
+ */
+static void udomain_rehash_gc(udomain_t *_d)
+{
+	hslot_t *ot;
+	int i;
+
+	if(likely(_d->otable == NULL) || _d->rehashing)
+		return;
+	if(_d->ograce > 0) {
+		_d->ograce--;
+		return;
+	}
+	ot = _d->otable;
+	_d->otable = NULL;
+	membar_write();
+	for(i = 0; i < _d->osize; i++) {
+		deinit_slot(ot + i);
+	}
+	shm_free(ot);
+	_d->osize = 0;
+	LM_DBG("retired hash table of domain '%.*s' freed\n", _d->name->len,
+			ZSW(_d->name->s));
+}
+
+
 /*!
  * \brief Run timer handler for given domain, delete urecords
  * \param _d domain
@@ -1267,13 +1425,40 @@ void mem_delete_urecord(udomain_t *_d, struct urecord *_r)
 void mem_timer_udomain(udomain_t *_d, int istart, int istep)
 {
 	struct urecord *ptr, *t;
+	struct ucontact *c;
+	hslot_t *ht;
+	int hsize;
 	int i;
-
-	for(i = istart; i < _d->size; i += istep) {
+	int scan_all;
+
+	/* work on a snapshot of the table - an online rehash may swap the
+	 * domain fields meanwhile; records migrated during this run are
+	 * simply picked up by the next one */
+	ht = _d->table;
+	hsize = _d->size;
+
+	/* the timer has per-contact work beyond expiration when the db has
+	 * to be flushed, keepalives are sent or tcp connections checked -
+	 * only a pure memory expiry run can skip slots with nothing due */
+	scan_all = (ul_db_mode == WRITE_THROUGH) || (ul_db_mode == WRITE_BACK)
+			   || (ul_ka_mode != ULKA_NONE) || ul_handle_lost_tcp;
+
+	ul_db_batch_start();
+
+	for(i = istart; i < hsize; i += istep) {
+		if(!scan_all
+				&& (ht[i].n == 0
+						|| (ht[i].nextdue != 0 && ht[i].nextdue > ul_act_time))) {
+			/* unlocked read - a concurrent change can only make the mark
+			 * stale towards the future, delaying the expiry of the new
+			 * contact by at most one timer run */
+			continue;
+		}
 		if(likely(destroy_modules_phase() == 0))
-			lock_ulslot(_d, i);
+			lock_ulslot_at(ht, i);
 
-		ptr = _d->table[i].first;
+		ht[i].nextdue = 0;
+		ptr = ht[i].first;
 
 		while(ptr) {
 			timer_urecord(ptr);
@@ -1284,12 +1469,21 @@ void mem_timer_udomain(udomain_t *_d, int istart, int istep)
 				mem_delete_urecord(_d, t);
 			} else {
 				ul_ka_urecord(ptr);
+				for(c = ptr->contacts; c != NULL; c = c->next)
+					slot_due_update(&ht[i], c->expires);
 				ptr = ptr->next;
 			}
 		}
 		if(likely(destroy_modules_phase() == 0))
-			unlock_ulslot(_d, i);
+			unlock_ulslot_at(ht, i);
+
+		/* spread the keepalives of this run - sleeps only when the
+		 * keepalive rate limit is configured and was reached */
+		ul_ka_pace();
 	}
+	ul_db_batch_end();
+	if(istart == 0)
+		udomain_rehash_gc(_d);
 }
 
 
@@ -1300,11 +1494,8 @@ void mem_timer_udomain(udomain_t *_d, int istart, int istep)
  */
 void lock_udomain(udomain_t *_d, str *_aor)
 {
-	unsigned int sl;
 	if(ul_db_mode != DB_ONLY) {
-		sl = ul_get_aorhash(_aor) & (_d->size - 1);
-
-		rec_lock_get(&_d->table[sl].rlock);
+		lock_ulaorhash(_d, ul_get_aorhash(_aor));
 	}
 }
 
@@ -1316,10 +1507,50 @@ void lock_udomain(udomain_t *_d, str *_aor)
  */
 void unlock_udomain(udomain_t *_d, str *_aor)
 {
-	unsigned int sl;
 	if(ul_db_mode != DB_ONLY) {
-		sl = ul_get_aorhash(_aor) & (_d->size - 1);
-		rec_lock_release(&_d->table[sl].rlock);
+		unlock_ulaorhash(_d, ul_get_aorhash(_aor));
+	}
+}
+
+
+/*!
+ * \brief Lock the slot currently holding records with given aor hash
+ *
+ * The slot resolved for the hash can change while waiting for its lock
+ * (the rehash runner migrated it meanwhile), so the resolution is
+ * re-checked after the lock is acquired and retried on mismatch. Once
+ * the lock is held the resolution stays stable until it is released.
+ * \param _d domain
+ * \param _h aor hash value
+ * \return locked slot (NULL in db only mode)
+ */
+hslot_t *lock_ulaorhash(udomain_t *_d, unsigned int _h)
+{
+	hslot_t *s;
+
+	if(ul_db_mode == DB_ONLY)
+		return udomain_aorhash_slot(_d, _h);
+	for(;;) {
+		s = udomain_aorhash_slot(_d, _h);
+		rec_lock_get(&s->rlock);
+		if(likely(udomain_aorhash_slot(_d, _h) == s))
+			return s;
+		rec_lock_release(&s->rlock);
+	}
+}
+
+
+/*!
+ * \brief Release the lock taken with lock_ulaorhash()
+ * \param _d domain
+ * \param _h aor hash value
+ */
+void unlock_ulaorhash(udomain_t *_d, unsigned int _h)
+{
+	if(ul_db_mode != DB_ONLY) {
+		/* resolution is stable while the lock is held - this releases
+		 * the same slot that lock_ulaorhash() locked */
+		rec_lock_release(&udomain_aorhash_slot(_d, _h)->rlock);
 	}
 }
 
@@ -1347,6 +1578,126 @@ void unlock_ulslot(udomain_t *_d, int i)
 }
 
 
+/*!
+ * \brief Lock a slot of an explicit hash table snapshot
+ * \param _ht hash table (snapshot of table pointer taken by the caller)
+ * \param _i slot number within _ht
+ */
+void lock_ulslot_at(hslot_t *_ht, int _i)
+{
+	if(ul_db_mode != DB_ONLY)
+		rec_lock_get(&_ht[_i].rlock);
+}
+
+
+/*!
+ * \brief Release lock for a slot of an explicit hash table snapshot
+ * \param _ht hash table
+ * \param _i slot number within _ht
+ */
+void unlock_ulslot_at(hslot_t *_ht, int _i)
+{
+	if(ul_db_mode != DB_ONLY)
+		rec_lock_release(&_ht[_i].rlock);
+}
+
+
+/*!
+ * \brief Migrate a domain online to a hash table with a new size
+ *
+ * The records are moved slot by slot into a freshly allocated table,
+ * holding only the lock of the migrated slot and of the target slot,
+ * so lookups, inserts and the timer keep running during the migration
+ * (they resolve the proper table via udomain_aorhash_slot()). The old
+ * table is retired and freed after a grace period by the mem timer.
+ * \param _d domain
+ * \param _s new hash table size (power of two)
+ * \return 0 on success, -1 on failure, -2 if another rehash is pending
+ */
+int rehash_udomain(udomain_t *_d, int _s)
+{
+	hslot_t *nt;
+	hslot_t *ns;
+	urecord_t *r, *next;
+	int i;
+
+	if(ul_db_mode == DB_ONLY) {
+		LM_ERR("no in-memory hash table in db only mode\n");
+		return -1;
+	}
+	if(_s < 2 || (_s & (_s - 1)) != 0) {
+		LM_ERR("invalid hash table size %d\n", _s);
+		return -1;
+	}
+	if(_d->rehashing || _d->otable != NULL) {
+		LM_ERR("rehash of domain '%.*s' still in progress or retiring\n",
+				_d->name->len, ZSW(_d->name->s));
+		return -2;
+	}
+	if(_s == _d->size) {
+		LM_DBG("domain '%.*s' already sized %d\n", _d->name->len,
+				ZSW(_d->name->s), _s);
+		return 0;
+	}
+
+	nt = (hslot_t *)shm_malloc(sizeof(hslot_t) * _s);
+	if(nt == NULL) {
+		SHM_MEM_ERROR;
+		return -1;
+	}
+	for(i = 0; i < _s; i++) {
+		if(init_slot(_d, &nt[i], i) < 0) {
+			LM_ERR("failed to init hash table slot %d\n", i);
+			while(i > 0)
+				deinit_slot(&nt[--i]);
+			shm_free(nt);
+			return -1;
+		}
+	}
+
+	_d->ntable = nt;
+	_d->nsize = _s;
+	_d->mslot = 0;
+	membar_write();
+	_d->rehashing = 1;
+
+	LM_INFO("rehashing domain '%.*s' from %d to %d slots\n", _d->name->len,
+			ZSW(_d->name->s), _d->size, _s);
+
+	for(i = 0; i < _d->size; i++) {
+		rec_lock_get(&_d->table[i].rlock);
+		for(r = _d->table[i].first; r != NULL; r = next) {
+			next = r->next;
+			ns = &nt[r->aorhash & (_s - 1)];
+			rec_lock_get(&ns->rlock);
+			slot_rem(&_d->table[i], r);
+			slot_add(ns, r);
+			rec_lock_release(&ns->rlock);
+		}
+		/* publish the migrated records before advancing the migration
+		 * mark that routes their aor hashes to the new table */
+		membar_write();
+		_d->mslot = i + 1;
+		rec_lock_release(&_d->table[i].rlock);
+	}
+
+	/* all slots migrated - retire the old table and make the new one
+	 * the live one; late readers still seeing rehashing==1 resolve via
+	 * ntable, which covers every aor hash at this point */
+	_d->otable = _d->table;
+	_d->osize = _d->size;
+	_d->table = nt;
+	_d->size = _s;
+	membar_write();
+	_d->rehashing = 0;
+	_d->ograce = UL_REHASH_GRACE;
+
+	LM_INFO("domain '%.*s' rehashed to %d slots\n", _d->name->len,
+			ZSW(_d->name->s), _s);
+	return 0;
+}
+
+
 /*!
  * \brief Create and insert a new record
  * \param _d domain to insert the new record
@@ -1377,17 +1728,19 @@ int insert_urecord(udomain_t *_d, str *_aor, struct urecord **_r)
  */
 int get_urecord(udomain_t *_d, str *_aor, struct urecord **_r)
 {
-	unsigned int sl, i, aorhash;
+	unsigned int i, aorhash;
+	hslot_t *s;
 	urecord_t *r;
 	ucontact_t *ptr = NULL;
 
 	if(ul_db_mode != DB_ONLY) {
-		/* search in cache */
+		/* search in cache - the caller holds the slot lock, so the
+		 * resolved slot matches the one locked via lock_udomain() */
 		aorhash = ul_get_aorhash(_aor);
-		sl = aorhash & (_d->size - 1);
-		r = _d->table[sl].first;
+		s = udomain_aorhash_slot(_d, aorhash);
+		r = s->first;
 
-		for(i = 0; r != NULL && i < _d->table[sl].n; i++) {
+		for(i = 0; r != NULL && i < s->n; i++) {
 			if((r->aorhash == aorhash) && (r->aor.len == _aor->len)
 					&& !memcmp(r->aor.s, _aor->s, _aor->len)) {
 				if(ul_handle_lost_tcp) {
@@ -1428,18 +1781,18 @@ int get_urecord(udomain_t *_d, str *_aor, struct urecord **_r)
 int get_urecord_by_ruid(udomain_t *_d, unsigned int _aorhash, str *_ruid,
 		struct urecord **_r, struct ucontact **_c)
 {
-	unsigned int sl, i;
+	unsigned int i;
+	hslot_t *s;
 	urecord_t *r;
 	ucontact_t *c;
 
-	sl = _aorhash & (_d->size - 1);
-	lock_ulslot(_d, sl);
+	s = lock_ulaorhash(_d, _aorhash);
 
 	if(ul_db_mode != DB_ONLY) {
 		/* search in cache */
-		r = _d->table[sl].first;
+		r = s->first;
 
-		for(i = 0; i < _d->table[sl].n; i++) {
+		for(i = 0; i < s->n; i++) {
 			if(r->aorhash == _aorhash) {
 				c = r->contacts;
 				while(c) {
@@ -1473,7 +1826,7 @@ int get_urecord_by_ruid(udomain_t *_d, unsigned int _aorhash, str *_ruid,
 		}
 	}
 
-	unlock_ulslot(_d, (_aorhash & (_d->size - 1)));
+	unlock_ulaorhash(_d, _aorhash);
 	return -1; /* Nothing found */
 }
 
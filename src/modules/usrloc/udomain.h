@@ -51,6 +51,15 @@ struct udomain
 	str *name;			 /*!< Domain name (NULL terminated) */
 	int size;			 /*!< Hash table size */
 	struct hslot *table; /*!< Hash table - array of collision slots */
+	/* online rehash state - the fields are updated only by the rehash
+	 * runner, while holding the lock of the slot being migrated */
+	struct hslot *ntable; /*!< Rehash target hash table */
+	int nsize;			  /*!< Size of the rehash target hash table */
+	volatile int mslot;	  /*!< First slot not yet migrated to ntable */
+	volatile int rehashing; /*!< Set to 1 while a rehash is running */
+	struct hslot *otable; /*!< Retired hash table kept for a grace period */
+	int osize;			  /*!< Size of the retired hash table */
+	int ograce;			  /*!< Timer runs left before otable is freed */
 	/* statistics */
 	stat_var *users;	/*!< no of registered users */
 	stat_var *contacts; /*!< no of registered contacts */
@@ -165,6 +174,58 @@ void lock_ulslot(udomain_t *_d, int i);
  */
 void unlock_ulslot(udomain_t *_d, int i);
 
+/*!
+ * \brief Lock the slot currently holding records with given aor hash
+ * \param _d domain
+ * \param _h aor hash value
+ * \return slot for the aor hash (locked, except in db only mode)
+ */
+struct hslot *lock_ulaorhash(udomain_t *_d, unsigned int _h);
+
+/*!
+ * \brief Release the lock taken with lock_ulaorhash()
+ * \param _d domain
+ * \param _h aor hash value
+ */
+void unlock_ulaorhash(udomain_t *_d, unsigned int _h);
+
+/*!
+ * \brief Lock a slot of an explicit hash table snapshot
+ * \param _ht hash table (snapshot of table pointer taken by the caller)
+ * \param _i slot number within _ht
+ */
+void lock_ulslot_at(struct hslot *_ht, int _i);
+
+/*!
+ * \brief Release lock for a slot of an explicit hash table snapshot
+ * \param _ht hash table
+ * \param _i slot number within _ht
+ */
+void unlock_ulslot_at(struct hslot *_ht, int _i);
+
+/*!
+ * \brief Migrate a domain online to a hash table with a new size
+ * \param _d domain
+ * \param _s new hash table size (power of two)
+ * \return 0 on success, -1 on failure, -2 if another rehash is pending
+ */
+int rehash_udomain(udomain_t *_d, int _s);
+
+/*!
+ * \brief Start a write-back flush batch (transaction), if configured
+ */
+void ul_db_batch_start(void);
+
+/*!
+ * \brief Account a write operation done within the flush batch
+ */
+void ul_db_batch_step(void);
+
+/*!
+ * \brief Commit the write-back flush batch
+ */
+void ul_db_batch_end(void);
+
 /* ===== module interface ======= */
 
 
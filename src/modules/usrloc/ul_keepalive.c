@@ -47,9 +47,15 @@
 extern int ul_keepalive_timeout;
 extern int ul_ka_interval;
 extern int ul_ka_randomize;
+extern int ul_ka_pps;
 
 static int ul_ka_send(str *kamsg, dest_info_t *kadst);
 
+/*! sends since the pacing window started (per process) */
+static unsigned int _ul_ka_pace_sent = 0;
+/*! start of the pacing window */
+static struct timeval _ul_ka_pace_start = {0, 0};
+
 /**
  *
 _KAMETHOD_ _URI_ SIP/2.0\r\n
@@ -263,6 +269,7 @@ int ul_ka_urecord(urecord_t *ur)
 			kamsg.len = kabuf_len;
 			if(ul_ka_send(&kamsg, &idst) >= 0) {
 				uc->flags |= FL_KASENT;
+				_ul_ka_pace_sent++;
 			}
 		}
 	}
@@ -305,6 +312,49 @@ static int ul_ka_send(str *kamsg, dest_info_t *kadst)
 	}
 }
 
+/**
+ * pace the keepalive sends to at most ka_pps per second and process
+ *
+ * To be called between hash table slots by the timer, with no slot lock
+ * held - it sleeps as long as needed to keep the configured rate, so the
+ * keepalives of a timer pass are spread over the interval instead of
+ * being sent in one burst.
+ */
+void ul_ka_pace(void)
+{
+	struct timeval tvnow;
+	long have_us;
+	long need_us;
+	long nap_us;
+
+	if(ul_ka_pps <= 0 || _ul_ka_pace_sent == 0) {
+		return;
+	}
+	gettimeofday(&tvnow, NULL);
+	if(_ul_ka_pace_start.tv_sec == 0) {
+		_ul_ka_pace_start = tvnow;
+	}
+	have_us = (tvnow.tv_sec - _ul_ka_pace_start.tv_sec) * 1000000L
+			  + (tvnow.tv_usec - _ul_ka_pace_start.tv_usec);
+	need_us = (long)_ul_ka_pace_sent * (1000000L / ul_ka_pps);
+	while(need_us > have_us && likely(destroy_modules_phase() == 0)) {
+		/* sleep in small naps to react to shut down */
+		nap_us = need_us - have_us;
+		if(nap_us > 50000L) {
+			nap_us = 50000L;
+		}
+		sleep_us((unsigned int)nap_us);
+		gettimeofday(&tvnow, NULL);
+		have_us = (tvnow.tv_sec - _ul_ka_pace_start.tv_sec) * 1000000L
+				  + (tvnow.tv_usec - _ul_ka_pace_start.tv_usec);
+	}
+	/* restart the window once in a while to track the current rate */
+	if(have_us >= 1000000L) {
+		_ul_ka_pace_start = tvnow;
+		_ul_ka_pace_sent = 0;
+	}
+}
+
 /**
  *
  */
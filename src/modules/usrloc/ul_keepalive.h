@@ -36,6 +36,7 @@
 #define ULKA_UDP (1 << 2)
 
 int ul_ka_urecord(urecord_t *ur);
+void ul_ka_pace(void);
 int ul_ka_reply_received(sip_msg_t *msg);
 int ul_ka_parse_reply_codes(char *vcodes);
 
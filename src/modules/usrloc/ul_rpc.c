@@ -203,6 +203,8 @@ static void ul_rpc_dump(rpc_t *rpc, void *ctx)
 	void *bh;
 	void *ih;
 	void *sh;
+	hslot_t *ht;
+	int hsize;
 	int max, n, i;
 
 	rpc->scan(ctx, "*S", &brief);
@@ -227,28 +229,33 @@ static void ul_rpc_dump(rpc_t *rpc, void *ctx)
 			return;
 		}
 
-		if(rpc->struct_add(dh, "Sd[", "Domain", &dl->name, "Size",
-				   (int)dom->size, "AoRs", &ah)
+		/* work on a snapshot of the table - an online rehash may swap
+		 * the domain fields meanwhile */
+		ht = dom->table;
+		hsize = dom->size;
+
+		if(rpc->struct_add(dh, "Sd[", "Domain", &dl->name, "Size", hsize,
+				   "AoRs", &ah)
 				< 0) {
 			rpc->fault(ctx, 500, "Internal error creating inner struct");
 			return;
 		}
-		for(i = 0, n = 0, max = 0; i < dom->size; i++) {
-			lock_ulslot(dom, i);
-			n += dom->table[i].n;
-			if(max < dom->table[i].n)
-				max = dom->table[i].n;
-			for(r = dom->table[i].first; r; r = r->next) {
+		for(i = 0, n = 0, max = 0; i < hsize; i++) {
+			lock_ulslot_at(ht, i);
+			n += ht[i].n;
+			if(max < ht[i].n)
+				max = ht[i].n;
+			for(r = ht[i].first; r; r = r->next) {
 				if(summary == 1) {
 					if(rpc->struct_add(ah, "S", "AoR", &r->aor) < 0) {
-						unlock_ulslot(dom, i);
+						unlock_ulslot_at(ht, i);
 						rpc->fault(
 								ctx, 500, "Internal error creating aor struct");
 						return;
 					}
 				} else {
 					if(rpc->struct_add(ah, "{", "Info", &bh) < 0) {
-						unlock_ulslot(dom, i);
+						unlock_ulslot_at(ht, i);
 						rpc->fault(
 								ctx, 500, "Internal error creating aor struct");
 						return;
@@ -256,21 +263,21 @@ static void ul_rpc_dump(rpc_t *rpc, void *ctx)
 					if(rpc->struct_add(bh, "Su[", "AoR", &r->aor, "HashID",
 							   r->aorhash, "Contacts", &ih)
 							< 0) {
-						unlock_ulslot(dom, i);
+						unlock_ulslot_at(ht, i);
 						rpc->fault(
 								ctx, 500, "Internal error creating aor struct");
 						return;
 					}
 					for(c = r->contacts; c; c = c->next) {
 						if(rpc_dump_contact(rpc, ctx, ih, c) == -1) {
-							unlock_ulslot(dom, i);
+							unlock_ulslot_at(ht, i);
 							return;
 						}
 					}
 				}
 			}
 
-			unlock_ulslot(dom, i);
+			unlock_ulslot_at(ht, i);
 		}
 
 		/* extra attributes node */
@@ -850,6 +857,46 @@ static const char *ul_rpc_db_expired_contacts_doc[2] = {
 		"Tell number of expired contacts in database table (db_mode=3 only)",
 		0};
 
+static void ul_rpc_rehash(rpc_t *rpc, void *ctx)
+{
+	udomain_t *dom;
+	str table = {0, 0};
+	int bits = 0;
+	int ret;
+
+	if(rpc->scan(ctx, "Sd", &table, &bits) != 2) {
+		rpc->fault(ctx, 500, "Not enough parameters (table and hash size)");
+		return;
+	}
+
+	/* look for table */
+	dom = rpc_find_domain(&table);
+	if(dom == NULL) {
+		rpc->fault(ctx, 500, "Domain table not found");
+		return;
+	}
+
+	if(bits < 1 || bits > 21) {
+		rpc->fault(ctx, 500, "Hash size out of range (1..21)");
+		return;
+	}
+
+	ret = rehash_udomain(dom, 1 << bits);
+	if(ret == -2) {
+		rpc->fault(ctx, 500, "Previous rehash still in progress");
+		return;
+	} else if(ret < 0) {
+		rpc->fault(ctx, 500, "Failed to rehash the domain table");
+		return;
+	}
+	return;
+}
+
+static const char *ul_rpc_rehash_doc[2] = {
+		"Resize the in-memory hash table of a location domain online, "
+		"parameters: table name and hash size as power of two exponent",
+		0};
+
 /* clang-format off */
 rpc_export_t ul_rpc[] = {
 	{"ul.dump", ul_rpc_dump, ul_rpc_dump_doc, 0},
@@ -862,6 +909,7 @@ rpc_export_t ul_rpc[] = {
 	{"ul.db_contacts", ul_rpc_db_contacts, ul_rpc_db_contacts_doc, 0},
 	{"ul.db_expired_contacts", ul_rpc_db_expired_contacts,
 			ul_rpc_db_expired_contacts_doc, 0},
+	{"ul.rehash", ul_rpc_rehash, ul_rpc_rehash_doc, 0},
 	{0, 0, 0, 0}
 };
 /* clang-format on */
@@ -182,6 +182,10 @@ ucontact_t *mem_insert_ucontact(urecord_t *_r, str *_c, ucontact_info_t *_ci)
 		_r->contacts = c;
 	}
 
+	if(_r->slot)
+		slot_due_update(_r->slot, c->expires);
+	_r->cn++;
+
 	return c;
 }
 
@@ -204,6 +208,7 @@ void mem_remove_ucontact(urecord_t *_r, ucontact_t *_c)
 			_c->next->prev = 0;
 		}
 	}
+	_r->cn--;
 }
 
 
@@ -407,6 +412,8 @@ static inline void wb_timer(urecord_t *_r)
 					LM_ERR("failed to delete contact from the database"
 						   " (aor: %.*s)\n",
 							t->aor->len, ZSW(t->aor->s));
+				} else {
+					ul_db_batch_step();
 				}
 			}
 
@@ -426,6 +433,8 @@ static inline void wb_timer(urecord_t *_r)
 							   " (aor: %.*s)\n",
 								ptr->aor->len, ZSW(ptr->aor->s));
 						ptr->state = old_state;
+					} else {
+						ul_db_batch_step();
 					}
 					break;
 
@@ -438,6 +447,8 @@ static inline void wb_timer(urecord_t *_r)
 						LM_ERR("updating contact in db failed (aor: %.*s)\n",
 								ptr->aor->len, ZSW(ptr->aor->s));
 						ptr->state = old_state;
+					} else {
+						ul_db_batch_step();
 					}
 					break;
 			}
@@ -88,6 +88,7 @@ typedef struct ucontact
 	str callid;			 /*!< Call-ID header field of registration */
 	int cseq;			 /*!< CSeq value */
 	cstate_t state;		 /*!< State of the contact (\ref cstate) */
+	time_t db_expires;	 /*!< Expires value written to the database */
 	unsigned int flags;	 /*!< Various internal flags (sync, etc) */
 	unsigned int cflags; /*!< Custom contact flags (from script - bflags) */
 	str user_agent;		 /*!< User-Agent header field */
@@ -148,6 +149,8 @@ typedef struct urecord
 	str aor;			  /*!< Address of record */
 	unsigned int aorhash; /*!< Hash over address of record */
 	ucontact_t *contacts; /*!< One or more contact fields */
+	int cn;				  /*!< Number of contacts in the list, including
+                                    * expired ones not reaped yet by the timer */
 
 	struct hslot *slot;	  /*!< Collision slot in the hash table
                                     * array we belong to */
@@ -109,6 +109,12 @@ static char *ul_preload_list[UL_PRELOAD_SIZE];
 static int ul_preload_index = 0;
 static int ul_preload_param(modparam_t type, void *val);
 
+#define UL_HSIZE_DOMAIN_SIZE 8
+static str ul_hsize_domain_list[UL_HSIZE_DOMAIN_SIZE];
+static int ul_hsize_domain_bits[UL_HSIZE_DOMAIN_SIZE];
+static int ul_hsize_domain_index = 0;
+static int ul_hash_size_domain_param(modparam_t type, void *val);
+
 extern int bind_usrloc(usrloc_api_t *api);
 int ul_db_update_as_insert = 0;
 int ul_timer_procs = 0;
@@ -131,6 +137,7 @@ int ul_ka_mode = 0;
 int ul_ka_filter = 0;
 int ul_ka_interval = 40;
 int ul_ka_randomize = 20;
+int ul_ka_pps = 0;
 int ul_ka_loglevel = 255;
 str ul_ka_logmsg = str_init(" to-uri: [$tu] remote-addr: [$sas]");
 pv_elem_t *ul_ka_logfmt = NULL;
@@ -221,8 +228,12 @@ int ul_db_clean_tcp =
 
 int ul_fetch_rows = 2000; /*!< number of rows to fetch from result */
 int ul_hash_size = 10;
+int ul_db_flush_batch =
+		0; /*!< number of write-back flush ops grouped in one transaction */
 int ul_db_insert_null = 0;
 int ul_db_timer_clean = 0;
+int ul_db_refresh_lazy =
+		0; /*!< seconds the db expiry may lag behind on pure refreshes */
 
 char *ul_ka_reply_codes_str = "0";
 
@@ -282,6 +293,8 @@ static param_export_t params[] = {
 	{"cseq_delay", PARAM_INT, &ul_cseq_delay},
 	{"fetch_rows", PARAM_INT, &ul_fetch_rows},
 	{"hash_size", PARAM_INT, &ul_hash_size},
+	{"hash_size_domain", PARAM_STRING | PARAM_USE_FUNC,
+			(void *)ul_hash_size_domain_param},
 	{"nat_bflag", PARAM_INT, &ul_nat_bflag},
 	{"handle_lost_tcp", PARAM_INT, &ul_handle_lost_tcp},
 	{"close_expired_tcp", PARAM_INT, &ul_close_expired_tcp},
@@ -297,6 +310,8 @@ static param_export_t params[] = {
 	{"db_insert_null", PARAM_INT, &ul_db_insert_null},
 	{"server_id_filter", PARAM_INT, &ul_db_srvid},
 	{"db_timer_clean", PARAM_INT, &ul_db_timer_clean},
+	{"db_flush_batch", PARAM_INT, &ul_db_flush_batch},
+	{"db_refresh_lazy", PARAM_INT, &ul_db_refresh_lazy},
 	{"rm_expired_delay", PARAM_INT, &ul_rm_expired_delay},
 	{"version_table", PARAM_INT, &ul_version_table},
 	{"ka_mode", PARAM_INT, &ul_ka_mode},
@@ -306,6 +321,7 @@ static param_export_t params[] = {
 	{"ka_filter", PARAM_INT, &ul_ka_filter},
 	{"ka_interval", PARAM_INT, &ul_ka_interval},
 	{"ka_randomize", PARAM_INT, &ul_ka_randomize},
+	{"ka_pps", PARAM_INT, &ul_ka_pps},
 	{"ka_timeout", PARAM_INT, &ul_keepalive_timeout},
 	{"ka_loglevel", PARAM_INT, &ul_ka_loglevel},
 	{"ka_logmsg", PARAM_STR, &ul_ka_logmsg},
@@ -625,3 +641,65 @@ static int ul_preload_param(modparam_t type, void *val)
 error:
 	return -1;
 }
+
+/**
+ * hash_size_domain module parameter handler - "table=bits" format
+ */
+static int ul_hash_size_domain_param(modparam_t type, void *val)
+{
+	char *c;
+	str v;
+	str b;
+	int bits;
+
+	if(val == NULL) {
+		LM_ERR("invalid parameter\n");
+		goto error;
+	}
+	if(ul_hsize_domain_index >= UL_HSIZE_DOMAIN_SIZE) {
+		LM_ERR("too many per-table hash sizes\n");
+		goto error;
+	}
+	v.s = (char *)val;
+	v.len = strlen(v.s);
+	c = memchr(v.s, '=', v.len);
+	if(c == NULL || c == v.s) {
+		LM_ERR("invalid format for parameter: %s (expected table=bits)\n", v.s);
+		goto error;
+	}
+	b.s = c + 1;
+	b.len = v.s + v.len - b.s;
+	if(b.len <= 0 || str2sint(&b, &bits) < 0) {
+		LM_ERR("invalid hash size in parameter: %s\n", v.s);
+		goto error;
+	}
+	if(bits < 1 || bits > 21) {
+		LM_ERR("hash size %d out of range (1..21) in parameter: %s\n", bits,
+				v.s);
+		goto error;
+	}
+	ul_hsize_domain_list[ul_hsize_domain_index].s = v.s;
+	ul_hsize_domain_list[ul_hsize_domain_index].len = c - v.s;
+	ul_hsize_domain_bits[ul_hsize_domain_index] = bits;
+	ul_hsize_domain_index++;
+	return 0;
+error:
+	return -1;
+}
+
+/**
+ * get the hash table size (number of slots) configured for a table,
+ * falling back to the global hash_size parameter
+ */
+int ul_domain_hash_size(str *_n)
+{
+	int i;
+
+	for(i = 0; i < ul_hsize_domain_index; i++) {
+		if(ul_hsize_domain_list[i].len == _n->len
+				&& memcmp(ul_hsize_domain_list[i].s, _n->s, _n->len) == 0)
+			return 1 << ul_hsize_domain_bits[i];
+	}
+	/* ul_hash_size holds the number of slots after mod_init() */
+	return ul_hash_size;
+}
@@ -84,8 +84,10 @@ extern int ul_desc_time_order;
 extern int ul_cseq_delay;
 extern int ul_fetch_rows;
 extern int ul_hash_size;
+int ul_domain_hash_size(str *_n);
 extern int ul_db_update_as_insert;
 extern int ul_db_check_update;
+extern int ul_db_refresh_lazy;
 extern int ul_keepalive_timeout;
 extern int ul_handle_lost_tcp;
 extern int ul_close_expired_tcp;
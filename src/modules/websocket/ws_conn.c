@@ -50,17 +50,29 @@ ws_connection_t **wsconn_id_hash = NULL;
 #define wsconn_listadd tcpconn_listadd
 #define wsconn_listrm tcpconn_listrm
 
-gen_lock_t *wsconn_lock = NULL;
-#define WSCONN_LOCK lock_get(wsconn_lock)
-#define WSCONN_UNLOCK lock_release(wsconn_lock)
+/* the connection table is striped into WSCONN_SHARDS independent shards -
+ * hash bucket h belongs to shard h % WSCONN_SHARDS and each shard has its
+ * own lock, used list and connection counter, so workers touching
+ * different connections do not serialize on one global lock */
+typedef struct ws_conn_shard
+{
+	gen_lock_t lock;
+	ws_connection_list_t used; /* ordered by last_used, oldest at head */
+	int count;				   /* connections in this shard */
+} ws_conn_shard_t;
+
+static ws_conn_shard_t *wsconn_shards = NULL;
+
+#define wsconn_shard(id_hash) \
+	(&wsconn_shards[(unsigned)(id_hash) % WSCONN_SHARDS])
+#define WSCONN_SHARD_LOCK(s) lock_get(&(s)->lock)
+#define WSCONN_SHARD_UNLOCK(s) lock_release(&(s)->lock)
 
 #define wsconn_ref(c) atomic_inc(&((c)->refcnt))
 #define wsconn_unref(c) atomic_dec_and_test(&((c)->refcnt))
 
 gen_lock_t *wsstat_lock = NULL;
 
-ws_connection_list_t *wsconn_used_list = NULL;
-
 stat_var *ws_current_connections;
 stat_var *ws_max_concurrent_connections;
 stat_var *ws_sip_current_connections;
@@ -80,14 +92,22 @@ static str str_status_bad_param = str_init("Bad display order parameter");
 
 int wsconn_init(void)
 {
-	wsconn_lock = lock_alloc();
-	if(wsconn_lock == NULL) {
-		LM_ERR("allocating lock\n");
+	int s;
+
+	wsconn_shards = (ws_conn_shard_t *)shm_malloc(
+			WSCONN_SHARDS * sizeof(ws_conn_shard_t));
+	if(wsconn_shards == NULL) {
+		SHM_MEM_ERROR_FMT("for WebSocket connection shards\n");
 		goto error;
 	}
-	if(lock_init(wsconn_lock) == 0) {
-		LM_ERR("initialising lock\n");
-		goto error;
+	memset((void *)wsconn_shards, 0, WSCONN_SHARDS * sizeof(ws_conn_shard_t));
+	for(s = 0; s < WSCONN_SHARDS; s++) {
+		if(lock_init(&wsconn_shards[s].lock) == 0) {
+			LM_ERR("initialising shard lock\n");
+			while(--s >= 0)
+				lock_destroy(&wsconn_shards[s].lock);
+			goto error;
+		}
 	}
 
 	wsstat_lock = lock_alloc();
@@ -109,29 +129,19 @@ int wsconn_init(void)
 	memset((void *)wsconn_id_hash, 0,
 			TCP_ID_HASH_SIZE * sizeof(ws_connection_t *));
 
-	wsconn_used_list =
-			(ws_connection_list_t *)shm_malloc(sizeof(ws_connection_list_t));
-	if(wsconn_used_list == NULL) {
-		SHM_MEM_ERROR_FMT("for WebSocket used list\n");
-		goto error;
-	}
-	memset((void *)wsconn_used_list, 0, sizeof(ws_connection_list_t));
-
 	return 0;
 
 error:
-	if(wsconn_lock)
-		lock_dealloc((void *)wsconn_lock);
 	if(wsstat_lock)
 		lock_dealloc((void *)wsstat_lock);
-	wsconn_lock = wsstat_lock = NULL;
+	wsstat_lock = NULL;
 
 	if(wsconn_id_hash)
 		shm_free(wsconn_id_hash);
-	if(wsconn_used_list)
-		shm_free(wsconn_used_list);
+	if(wsconn_shards)
+		shm_free((void *)wsconn_shards);
 	wsconn_id_hash = NULL;
-	wsconn_used_list = NULL;
+	wsconn_shards = NULL;
 
 	return -1;
 }
@@ -139,6 +149,7 @@ error:
 static inline void _wsconn_rm(ws_connection_t *wsc)
 {
 	wsconn_listrm(wsconn_id_hash[wsc->id_hash], wsc, id_next, id_prev);
+	wsconn_shard(wsc->id_hash)->count--;
 
 	update_stat(ws_current_connections, -1);
 	if(wsc->sub_protocol == SUB_PROTOCOL_SIP)
@@ -152,33 +163,32 @@ static inline void _wsconn_rm(ws_connection_t *wsc)
 void wsconn_destroy(void)
 {
 	int h;
-
-	if(wsconn_used_list) {
-		shm_free(wsconn_used_list);
-		wsconn_used_list = NULL;
-	}
-
-	if(wsconn_id_hash) {
-		WSCONN_UNLOCK;
-		WSCONN_LOCK;
-		for(h = 0; h < TCP_ID_HASH_SIZE; h++) {
-			ws_connection_t *wsc = wsconn_id_hash[h];
-			while(wsc) {
-				ws_connection_t *next = wsc->id_next;
-				_wsconn_rm(wsc);
-				wsc = next;
+	int s;
+
+	if(wsconn_id_hash && wsconn_shards) {
+		for(s = 0; s < WSCONN_SHARDS; s++) {
+			ws_conn_shard_t *shard = &wsconn_shards[s];
+			WSCONN_SHARD_LOCK(shard);
+			for(h = s; h < TCP_ID_HASH_SIZE; h += WSCONN_SHARDS) {
+				ws_connection_t *wsc = wsconn_id_hash[h];
+				while(wsc) {
+					ws_connection_t *next = wsc->id_next;
+					_wsconn_rm(wsc);
+					wsc = next;
+				}
 			}
+			WSCONN_SHARD_UNLOCK(shard);
 		}
-		WSCONN_UNLOCK;
 
 		shm_free(wsconn_id_hash);
 		wsconn_id_hash = NULL;
 	}
 
-	if(wsconn_lock) {
-		lock_destroy(wsconn_lock);
-		lock_dealloc((void *)wsconn_lock);
-		wsconn_lock = NULL;
+	if(wsconn_shards) {
+		for(s = 0; s < WSCONN_SHARDS; s++)
+			lock_destroy(&wsconn_shards[s].lock);
+		shm_free((void *)wsconn_shards);
+		wsconn_shards = NULL;
 	}
 
 	if(wsstat_lock) {
@@ -194,6 +204,7 @@ int wsconn_add(struct receive_info *rcv, unsigned int sub_protocol)
 	int id = rcv->proto_reserved1;
 	int id_hash = tcp_id_hash(id);
 	ws_connection_t *wsc;
+	ws_conn_shard_t *shard;
 
 	LM_DBG("connection id [%d]\n", id);
 
@@ -215,22 +226,24 @@ int wsconn_add(struct receive_info *rcv, unsigned int sub_protocol)
 
 	LM_DBG("new wsc => [%p], ref => [%d]\n", wsc, atomic_get(&wsc->refcnt));
 
-	WSCONN_LOCK;
+	shard = wsconn_shard(wsc->id_hash);
+	WSCONN_SHARD_LOCK(shard);
 	/* Add to WebSocket connection table */
 	wsconn_listadd(wsconn_id_hash[wsc->id_hash], wsc, id_next, id_prev);
+	shard->count++;
 
-	/* Add to the end of the WebSocket used list */
+	/* Add to the end of the shard used list */
 	wsc->last_used = ksr_time_sint(NULL, NULL);
-	if(wsconn_used_list->head == NULL)
-		wsconn_used_list->head = wsconn_used_list->tail = wsc;
+	if(shard->used.head == NULL)
+		shard->used.head = shard->used.tail = wsc;
 	else {
-		wsc->used_prev = wsconn_used_list->tail;
-		wsconn_used_list->tail->used_next = wsc;
-		wsconn_used_list->tail = wsc;
+		wsc->used_prev = shard->used.tail;
+		shard->used.tail->used_next = wsc;
+		shard->used.tail = wsc;
 	}
 	wsconn_ref(wsc);
 
-	WSCONN_UNLOCK;
+	WSCONN_SHARD_UNLOCK(shard);
 
 	LM_DBG("added to conn_table wsc => [%p], ref => [%d]\n", wsc,
 			atomic_get(&wsc->refcnt));
@@ -353,29 +366,32 @@ int wsconn_rm(ws_connection_t *wsc, ws_conn_eventroute_t run_event_route)
 
 int wsconn_update(ws_connection_t *wsc)
 {
+	ws_conn_shard_t *shard;
+
 	if(!wsc) {
 		LM_ERR("wsconn_update: null pointer\n");
 		return -1;
 	}
 
-	WSCONN_LOCK;
+	shard = wsconn_shard(wsc->id_hash);
+	WSCONN_SHARD_LOCK(shard);
 	wsc->last_used = ksr_time_sint(NULL, NULL);
-	if(wsconn_used_list->tail == wsc)
+	if(shard->used.tail == wsc)
 		/* Already at the end of the list */
 		goto end;
-	if(wsconn_used_list->head == wsc)
-		wsconn_used_list->head = wsc->used_next;
+	if(shard->used.head == wsc)
+		shard->used.head = wsc->used_next;
 	if(wsc->used_prev)
 		wsc->used_prev->used_next = wsc->used_next;
 	if(wsc->used_next)
 		wsc->used_next->used_prev = wsc->used_prev;
-	wsc->used_prev = wsconn_used_list->tail;
+	wsc->used_prev = shard->used.tail;
 	wsc->used_next = NULL;
-	wsconn_used_list->tail->used_next = wsc;
-	wsconn_used_list->tail = wsc;
+	shard->used.tail->used_next = wsc;
+	shard->used.tail = wsc;
 
 end:
-	WSCONN_UNLOCK;
+	WSCONN_SHARD_UNLOCK(shard);
 	return 0;
 }
 
@@ -397,13 +413,16 @@ void wsconn_close_now(ws_connection_t *wsc)
 	con->timeout = get_ticks_raw();
 }
 
+/* must be called with the connection's shard lock held */
 void wsconn_detach_connection(ws_connection_t *wsc)
 {
-	/* Remove from the WebSocket used list */
-	if(wsconn_used_list->head == wsc)
-		wsconn_used_list->head = wsc->used_next;
-	if(wsconn_used_list->tail == wsc)
-		wsconn_used_list->tail = wsc->used_prev;
+	ws_conn_shard_t *shard = wsconn_shard(wsc->id_hash);
+
+	/* Remove from the shard used list */
+	if(shard->used.head == wsc)
+		shard->used.head = wsc->used_next;
+	if(shard->used.tail == wsc)
+		shard->used.tail = wsc->used_prev;
 	if(wsc->used_prev)
 		wsc->used_prev->used_next = wsc->used_next;
 	if(wsc->used_next)
@@ -411,6 +430,7 @@ void wsconn_detach_connection(ws_connection_t *wsc)
 
 	/* remove from wsconn_id_hash */
 	wsconn_listrm(wsconn_id_hash[wsc->id_hash], wsc, id_next, id_prev);
+	shard->count--;
 
 	/* stat */
 	update_stat(ws_current_connections, -1);
@@ -420,17 +440,20 @@ void wsconn_detach_connection(ws_connection_t *wsc)
 		update_stat(ws_msrp_current_connections, -1);
 }
 
-/* mode controls if lock needs to be aquired */
+/* mode controls if the shard lock needs to be aquired */
 int wsconn_put_mode(ws_connection_t *wsc, int mode)
 {
+	ws_conn_shard_t *shard;
+
 	if(!wsc)
 		return -1;
 
 	LM_DBG("wsconn_put start for [%p] refcnt [%d]\n", wsc,
 			atomic_get(&wsc->refcnt));
 
+	shard = wsconn_shard(wsc->id_hash);
 	if(mode) {
-		WSCONN_LOCK;
+		WSCONN_SHARD_LOCK(shard);
 	}
 	if(wsc->state == WS_S_REMOVING) {
 		goto done;
@@ -445,13 +468,13 @@ int wsconn_put_mode(ws_connection_t *wsc, int mode)
 
 done:
 	if(mode) {
-		WSCONN_UNLOCK;
+		WSCONN_SHARD_UNLOCK(shard);
 	}
 
 	return 0;
 }
 
-/* must be called with unlocked WSCONN_LOCK */
+/* must be called with the shard lock not held */
 int wsconn_put(ws_connection_t *wsc)
 {
 	return wsconn_put_mode(wsc, 1);
@@ -460,23 +483,24 @@ int wsconn_put(ws_connection_t *wsc)
 ws_connection_t *wsconn_get(int id)
 {
 	int id_hash = tcp_id_hash(id);
+	ws_conn_shard_t *shard = wsconn_shard(id_hash);
 	ws_connection_t *wsc;
 
 	LM_DBG("wsconn_get for id [%d]\n", id);
 
-	WSCONN_LOCK;
+	WSCONN_SHARD_LOCK(shard);
 	for(wsc = wsconn_id_hash[id_hash]; wsc; wsc = wsc->id_next) {
 		if(wsc->id == id) {
 			wsconn_ref(wsc);
 			LM_DBG("wsconn_get id [%d] returns wsc [%p] refcnt [%d]\n", id, wsc,
 					atomic_get(&wsc->refcnt));
 
-			WSCONN_UNLOCK;
+			WSCONN_SHARD_UNLOCK(shard);
 
 			return wsc;
 		}
 	}
-	WSCONN_UNLOCK;
+	WSCONN_SHARD_UNLOCK(shard);
 
 	return NULL;
 }
@@ -484,22 +508,23 @@ ws_connection_t *wsconn_get(int id)
 int wsconn_put_id(int id)
 {
 	int id_hash = tcp_id_hash(id);
+	ws_conn_shard_t *shard = wsconn_shard(id_hash);
 	ws_connection_t *wsc;
 
 	LM_DBG("wsconn put id [%d]\n", id);
 
-	WSCONN_LOCK;
+	WSCONN_SHARD_LOCK(shard);
 	for(wsc = wsconn_id_hash[id_hash]; wsc; wsc = wsc->id_next) {
 		if(wsc->id == id) {
 			LM_DBG("wsc [%p] refcnt [%d]\n", wsc, atomic_get(&wsc->refcnt));
 			wsconn_put_mode(wsc, 0);
 
-			WSCONN_UNLOCK;
+			WSCONN_SHARD_UNLOCK(shard);
 
 			return 1;
 		}
 	}
-	WSCONN_UNLOCK;
+	WSCONN_SHARD_UNLOCK(shard);
 
 	return 0;
 }
@@ -508,24 +533,18 @@ ws_connection_t **wsconn_get_list(void)
 {
 	ws_connection_t **list = NULL;
 	ws_connection_t *wsc = NULL;
+	ws_conn_shard_t *shard;
 	size_t list_size = 0;
 	size_t list_len = 0;
 	size_t i = 0;
+	int s;
 
 	if(ws_verbose_list)
 		LM_DBG("wsconn get list - starting\n");
 
-	WSCONN_LOCK;
-
 	/* get the number of used connections */
-	wsc = wsconn_used_list->head;
-	while(wsc) {
-		if(ws_verbose_list)
-			LM_DBG("counter wsc [%p] prev => [%p] next => [%p]\n", wsc,
-					wsc->used_prev, wsc->used_next);
-		list_len++;
-		wsc = wsc->used_next;
-	}
+	for(s = 0; s < WSCONN_SHARDS; s++)
+		list_len += wsconn_shards[s].count;
 
 	if(!list_len)
 		goto end;
@@ -539,26 +558,23 @@ ws_connection_t **wsconn_get_list(void)
 	}
 	memset(list, 0, list_size);
 
-	/* copy */
-	wsc = wsconn_used_list->head;
-	for(i = 0; i < list_len; i++) {
-		if(!wsc) {
-			LM_ERR("Wrong list length\n");
-			break;
+	/* copy, shard by shard (connections added after the count was taken
+	 * are left for the next call) */
+	for(s = 0; s < WSCONN_SHARDS && i < list_len; s++) {
+		shard = &wsconn_shards[s];
+		WSCONN_SHARD_LOCK(shard);
+		for(wsc = shard->used.head; wsc && i < list_len;
+				wsc = wsc->used_next) {
+			list[i++] = wsc;
+			wsconn_ref(wsc);
+			if(ws_verbose_list)
+				LM_DBG("wsc [%p] id [%d] ref++\n", wsc, wsc->id);
 		}
-
-		list[i] = wsc;
-		wsconn_ref(wsc);
-		if(ws_verbose_list)
-			LM_DBG("wsc [%p] id [%d] ref++\n", wsc, wsc->id);
-
-		wsc = wsc->used_next;
+		WSCONN_SHARD_UNLOCK(shard);
 	}
 	list[i] = NULL; /* explicit NULL termination */
 
 end:
-	WSCONN_UNLOCK;
-
 	if(ws_verbose_list)
 		LM_DBG("wsconn_get_list returns list [%p]"
 			   " with [%d] members\n",
@@ -590,36 +606,46 @@ int wsconn_put_list(ws_connection_t **list_head)
 }
 
 
-ws_connection_id_t *wsconn_get_list_ids(int idx)
+/* return the ids of the connections handled by keepalive process idx with
+ * last_used older than lutime (0 - no limit). The shard used lists are
+ * ordered by last_used, so each scan stops at the first fresh enough
+ * connection instead of walking all of them. */
+ws_connection_id_t *wsconn_get_list_ids(int idx, int lutime)
 {
 	ws_connection_id_t *list = NULL;
 	ws_connection_t *wsc = NULL;
+	ws_conn_shard_t *shard;
 	size_t list_size = 0;
 	size_t list_len = 0;
 	size_t i = 0;
+	int s;
 
 	if(ws_verbose_list)
 		LM_DBG("wsconn get list ids - starting\n");
 
-	WSCONN_LOCK;
-
-	/* get the number of used connections */
-	wsc = wsconn_used_list->head;
-	while(wsc) {
-		if(wsc->id % ws_keepalive_processes == idx) {
-			if(ws_verbose_list) {
-				LM_DBG("counter wsc [%p] prev => [%p] next => [%p] (%d/%d)\n",
-						wsc, wsc->used_prev, wsc->used_next, wsc->id, idx);
+	/* get the number of matching connections */
+	for(s = 0; s < WSCONN_SHARDS; s++) {
+		shard = &wsconn_shards[s];
+		WSCONN_SHARD_LOCK(shard);
+		for(wsc = shard->used.head; wsc; wsc = wsc->used_next) {
+			if(lutime != 0 && wsc->last_used >= lutime)
+				break;
+			if(wsc->id % ws_keepalive_processes == idx) {
+				if(ws_verbose_list) {
+					LM_DBG("counter wsc [%p] prev => [%p] next => [%p] "
+						   "(%d/%d)\n",
+							wsc, wsc->used_prev, wsc->used_next, wsc->id, idx);
+				}
+				list_len++;
 			}
-			list_len++;
 		}
-		wsc = wsc->used_next;
+		WSCONN_SHARD_UNLOCK(shard);
 	}
 
 	if(!list_len)
 		goto end;
 
-	/* allocate a NULL terminated list of wsconn pointers */
+	/* allocate a -1 terminated list of wsconn ids */
 	list_size = (list_len + 1) * sizeof(ws_connection_id_t);
 	list = pkg_malloc(list_size);
 	if(!list) {
@@ -628,28 +654,29 @@ ws_connection_id_t *wsconn_get_list_ids(int idx)
 	}
 	memset(list, 0, list_size);
 
-	/* copy */
-	wsc = wsconn_used_list->head;
-	for(i = 0; i < list_len; i++) {
-		if(!wsc) {
-			LM_ERR("Wrong list length\n");
-			break;
-		}
-
-		if(wsc->id % ws_keepalive_processes == idx) {
-			list[i].id = wsc->id;
-			wsconn_ref(wsc);
-			if(ws_verbose_list) {
-				LM_DBG("wsc [%p] id [%d] (%d) - ref++\n", wsc, wsc->id, idx);
+	/* copy (connections touched after the count was taken are fresh and
+	 * of no interest - stop when the list is full) */
+	for(s = 0; s < WSCONN_SHARDS && i < list_len; s++) {
+		shard = &wsconn_shards[s];
+		WSCONN_SHARD_LOCK(shard);
+		for(wsc = shard->used.head; wsc && i < list_len;
+				wsc = wsc->used_next) {
+			if(lutime != 0 && wsc->last_used >= lutime)
+				break;
+			if(wsc->id % ws_keepalive_processes == idx) {
+				list[i++].id = wsc->id;
+				wsconn_ref(wsc);
+				if(ws_verbose_list) {
+					LM_DBG("wsc [%p] id [%d] (%d) - ref++\n", wsc, wsc->id,
+							idx);
+				}
 			}
 		}
-		wsc = wsc->used_next;
+		WSCONN_SHARD_UNLOCK(shard);
 	}
 	list[i].id = -1; /* explicit -1 termination */
 
 end:
-	WSCONN_UNLOCK;
-
 	if(ws_verbose_list) {
 		LM_DBG("wsconn get list id returns list [%p]"
 			   " with [%d] members (%d)\n",
@@ -687,34 +714,38 @@ void ws_timer(unsigned int ticks, void *param)
 	struct tcp_connection *con = NULL;
 	ticks_t nticks;
 	int h;
+	int s;
 
 	rmlist.head = NULL;
 	nticks = get_ticks();
 
-	WSCONN_LOCK;
-	for(h = 0; h < TCP_ID_HASH_SIZE; h++) {
-		wsc = wsconn_id_hash[h];
-		while(wsc) {
-			next = wsc->id_next;
-			if(wsc->state == WS_S_REMOVING
-					&& wsc->rmticks <= nticks - ws_rm_delay_interval) {
-				wsconn_detach_connection(wsc);
-				wsc->id_next = rmlist.head;
-				rmlist.head = wsc;
-			} else if(wsc->state != WS_S_REMOVING) {
-				con = tcpconn_get(wsc->id, 0, 0, 0, 0);
-				if(con == NULL) {
-					LM_DBG("ws structure without active tcp connection\n");
-					wsc->state = WS_S_REMOVING;
-					wsc->rmticks = get_ticks();
-				} else {
-					tcpconn_put(con);
+	for(s = 0; s < WSCONN_SHARDS; s++) {
+		ws_conn_shard_t *shard = &wsconn_shards[s];
+		WSCONN_SHARD_LOCK(shard);
+		for(h = s; h < TCP_ID_HASH_SIZE; h += WSCONN_SHARDS) {
+			wsc = wsconn_id_hash[h];
+			while(wsc) {
+				next = wsc->id_next;
+				if(wsc->state == WS_S_REMOVING
+						&& wsc->rmticks <= nticks - ws_rm_delay_interval) {
+					wsconn_detach_connection(wsc);
+					wsc->id_next = rmlist.head;
+					rmlist.head = wsc;
+				} else if(wsc->state != WS_S_REMOVING) {
+					con = tcpconn_get(wsc->id, 0, 0, 0, 0);
+					if(con == NULL) {
+						LM_DBG("ws structure without active tcp connection\n");
+						wsc->state = WS_S_REMOVING;
+						wsc->rmticks = get_ticks();
+					} else {
+						tcpconn_put(con);
+					}
 				}
+				wsc = next;
 			}
-			wsc = next;
 		}
+		WSCONN_SHARD_UNLOCK(shard);
 	}
-	WSCONN_UNLOCK;
 
 	for(wsc = rmlist.head; wsc;) {
 		next = wsc->id_next;
@@ -780,12 +811,14 @@ static int ws_rpc_add_node(
 
 void ws_rpc_dump(rpc_t *rpc, void *ctx)
 {
-	int h, connections = 0, truncated = 0, order = 0, found = 0;
+	int h, s, connections = 0, truncated = 0, order = 0, found = 0;
 	ws_connection_t *wsc;
+	ws_conn_shard_t *shard;
 	str sorder = {0};
 	void *th;
 	void *ih;
 	void *dh;
+	void *sh;
 
 	if(rpc->scan(ctx, "*S", &sorder) == 1) {
 		if(sorder.len == 7 && strncasecmp(sorder.s, "id_hash", 7) == 0) {
@@ -813,63 +846,66 @@ void ws_rpc_dump(rpc_t *rpc, void *ctx)
 		return;
 	}
 
-	WSCONN_LOCK;
-	if(order == 0) {
-		for(h = 0; h < TCP_ID_HASH_SIZE; h++) {
-			wsc = wsconn_id_hash[h];
+	for(s = 0; s < WSCONN_SHARDS && truncated == 0; s++) {
+		shard = &wsconn_shards[s];
+		WSCONN_SHARD_LOCK(shard);
+		if(order == 0) {
+			for(h = s; h < TCP_ID_HASH_SIZE; h += WSCONN_SHARDS) {
+				wsc = wsconn_id_hash[h];
+				while(wsc) {
+					if((found = ws_rpc_add_node(rpc, ctx, ih, wsc)) < 0) {
+						WSCONN_SHARD_UNLOCK(shard);
+						return;
+					}
+
+					connections += found;
+					if(connections >= MAX_WS_CONNS_DUMP) {
+						truncated = 1;
+						break;
+					}
+
+					wsc = wsc->id_next;
+				}
+
+				if(truncated == 1)
+					break;
+			}
+		} else if(order == 1) {
+			/* ordered by last use within each shard */
+			wsc = shard->used.head;
 			while(wsc) {
 				if((found = ws_rpc_add_node(rpc, ctx, ih, wsc)) < 0) {
-					WSCONN_UNLOCK;
+					WSCONN_SHARD_UNLOCK(shard);
 					return;
 				}
 
-
 				connections += found;
 				if(connections >= MAX_WS_CONNS_DUMP) {
 					truncated = 1;
 					break;
 				}
 
-				wsc = wsc->id_next;
-			}
-
-			if(truncated == 1)
-				break;
-		}
-	} else if(order == 1) {
-		wsc = wsconn_used_list->head;
-		while(wsc) {
-			if((found = ws_rpc_add_node(rpc, ctx, ih, wsc)) < 0) {
-				WSCONN_UNLOCK;
-				return;
-			}
-
-			connections += found;
-			if(connections >= MAX_WS_CONNS_DUMP) {
-				truncated = 1;
-				break;
+				wsc = wsc->used_next;
 			}
+		} else {
+			wsc = shard->used.tail;
+			while(wsc) {
+				if((found = ws_rpc_add_node(rpc, ctx, ih, wsc)) < 0) {
+					WSCONN_SHARD_UNLOCK(shard);
+					return;
+				}
 
-			wsc = wsc->used_next;
-		}
-	} else {
-		wsc = wsconn_used_list->tail;
-		while(wsc) {
-			if((found = ws_rpc_add_node(rpc, ctx, ih, wsc)) < 0) {
-				WSCONN_UNLOCK;
-				return;
-			}
+				connections += found;
+				if(connections >= MAX_WS_CONNS_DUMP) {
+					truncated = 1;
+					break;
+				}
 
-			connections += found;
-			if(connections >= MAX_WS_CONNS_DUMP) {
-				truncated = 1;
-				break;
+				wsc = wsc->used_prev;
 			}
-
-			wsc = wsc->used_prev;
 		}
+		WSCONN_SHARD_UNLOCK(shard);
 	}
-	WSCONN_UNLOCK;
 
 	if(rpc->struct_add(th, "{", "info", &dh) < 0) {
 		rpc->fault(ctx, 500, "Internal error info structure");
@@ -881,6 +917,16 @@ void ws_rpc_dump(rpc_t *rpc, void *ctx)
 		rpc->fault(ctx, 500, "Internal error adding info structure");
 		return;
 	}
+	if(rpc->struct_add(dh, "[", "shard_counters", &sh) < 0) {
+		rpc->fault(ctx, 500, "Internal error shard counters structure");
+		return;
+	}
+	for(s = 0; s < WSCONN_SHARDS; s++) {
+		if(rpc->array_add(sh, "d", wsconn_shards[s].count) < 0) {
+			rpc->fault(ctx, 500, "Internal error adding shard counter");
+			return;
+		}
+	}
 
 	return;
 }
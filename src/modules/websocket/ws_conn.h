@@ -80,14 +80,16 @@ typedef struct
 	ws_connection_t *tail;
 } ws_connection_list_t;
 
+/* number of independent stripes (lock + used list + counter) of the
+ * connection table - power of two */
+#define WSCONN_SHARDS 16
+
 typedef enum
 {
 	WSCONN_EVENTROUTE_NO = 0,
 	WSCONN_EVENTROUTE_YES
 } ws_conn_eventroute_t;
 
-extern ws_connection_list_t *wsconn_used_list;
-
 extern char *wsconn_state_str[];
 
 extern stat_var *ws_current_connections;
@@ -107,7 +109,7 @@ ws_connection_t *wsconn_get(int id);
 int wsconn_put(ws_connection_t *wsc);
 ws_connection_t **wsconn_get_list(void);
 int wsconn_put_list(ws_connection_t **list);
-ws_connection_id_t *wsconn_get_list_ids(int idx);
+ws_connection_id_t *wsconn_get_list_ids(int idx, int lutime);
 int wsconn_put_list_ids(ws_connection_id_t *list);
 int wsconn_put_id(int id);
 void ws_rpc_dump(rpc_t *rpc, void *ctx);
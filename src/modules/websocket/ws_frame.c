@@ -136,6 +136,10 @@ static str str_status_error_sending = str_init("Error sending frame");
 
 static int ws_send_crlf(ws_connection_t *wsc, int opcode);
 
+/* per-process frame send buffer, reused across sends (grown on demand) */
+static char *ws_send_buf = NULL;
+static unsigned int ws_send_buf_size = 0;
+
 static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 {
 	int pos = 0, extended_length;
@@ -207,13 +211,22 @@ static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 		return -1;
 	}
 
-	/* Allocate send buffer and build frame */
+	/* Build the frame in the per-process send buffer - the payload copy is
+	   unavoidable as tcp_send() takes one contiguous buffer, but the
+	   per-frame allocation is not (every byte of the frame is written
+	   below, so no memset() is needed either) */
 	frame_length = frame->payload_len + extended_length + 2;
-	if((send_buf = pkg_malloc(sizeof(char) * frame_length)) == NULL) {
-		PKG_MEM_ERROR_FMT("for send buffer\n");
-		return -1;
+	if(ws_send_buf_size < frame_length) {
+		if(ws_send_buf)
+			pkg_free(ws_send_buf);
+		ws_send_buf_size = 0;
+		if((ws_send_buf = pkg_malloc(sizeof(char) * frame_length)) == NULL) {
+			PKG_MEM_ERROR_FMT("for send buffer\n");
+			return -1;
+		}
+		ws_send_buf_size = frame_length;
 	}
-	memset(send_buf, 0, sizeof(char) * frame_length);
+	send_buf = ws_send_buf;
 	send_buf[pos++] = 0x80 | (frame->opcode & 0xff);
 	if(extended_length == 0)
 		send_buf[pos++] = (frame->payload_len & 0xff);
@@ -232,7 +245,6 @@ static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 
 	if((con = tcpconn_get(frame->wsc->id, 0, 0, 0, 0)) == NULL) {
 		LM_WARN("TCP/TLS connection get failed\n");
-		pkg_free(send_buf);
 		if(wsconn_rm(frame->wsc, WSCONN_EVENTROUTE_YES) < 0)
 			LM_ERR("removing WebSocket connection\n");
 		return -1;
@@ -243,7 +255,6 @@ static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 		if(wsconn_rm(frame->wsc, WSCONN_EVENTROUTE_YES) < 0) {
 			LM_ERR("removing WebSocket connection\n");
 			tcpconn_put(con);
-			pkg_free(send_buf);
 			return -1;
 		}
 	}
@@ -251,7 +262,6 @@ static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 	if(dst.proto == PROTO_WS) {
 		if(unlikely(tcp_disable)) {
 			LM_WARN("TCP disabled\n");
-			pkg_free(send_buf);
 			tcpconn_put(con);
 			return -1;
 		}
@@ -260,7 +270,6 @@ static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 	else if(dst.proto == PROTO_WSS) {
 		if(unlikely(tls_disable)) {
 			LM_WARN("TLS disabled\n");
-			pkg_free(send_buf);
 			tcpconn_put(con);
 			return -1;
 		}
@@ -280,7 +289,6 @@ static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 
 	if(tcp_send(&dst, from, send_buf, frame_length) < 0) {
 		LM_ERR("sending WebSocket frame\n");
-		pkg_free(send_buf);
 		update_stat(ws_failed_connections, 1);
 		if(sub_proto == SUB_PROTOCOL_SIP)
 			update_stat(ws_sip_failed_connections, 1);
@@ -302,7 +310,6 @@ static int encode_and_send_ws_frame(ws_frame_t *frame, conn_close_t conn_close)
 				update_stat(ws_msrp_transmitted_frames, 1);
 	}
 
-	pkg_free(send_buf);
 	tcpconn_put(con);
 	return 0;
 }
@@ -375,7 +382,8 @@ static int decode_and_validate_ws_frame(ws_frame_t *frame,
 		tcp_event_info_t *tcpinfo, short *err_code, str *err_text)
 {
 	unsigned int i, len = tcpinfo->len;
-	unsigned int mask_start, j;
+	unsigned int mask_start, j, wlen;
+	unsigned long wmask, w;
 	char *buf = tcpinfo->buf;
 
 	LM_DBG("decoding WebSocket frame (len: %u)\n", len);
@@ -496,11 +504,20 @@ static int decode_and_validate_ws_frame(ws_frame_t *frame,
 
 	frame->payload_data = &buf[mask_start + 4];
 
-	/* Decode and unmask payload */
-	for(i = 0; i < frame->payload_len; i++) {
-		j = i % 4;
-		frame->payload_data[i] = frame->payload_data[i] ^ frame->masking_key[j];
+	/* Decode and unmask payload in place, a word at a time, with the
+	   masking key replicated to the word size (the memcpy()s compile to
+	   plain loads/stores and keep the accesses alignment-safe) */
+	for(j = 0; j < sizeof(wmask); j++)
+		((unsigned char *)&wmask)[j] = frame->masking_key[j % 4];
+	wlen = frame->payload_len & ~((unsigned int)sizeof(wmask) - 1);
+	for(i = 0; i < wlen; i += sizeof(wmask)) {
+		memcpy(&w, &frame->payload_data[i], sizeof(w));
+		w ^= wmask;
+		memcpy(&frame->payload_data[i], &w, sizeof(w));
 	}
+	/* scalar tail - last payload_len % sizeof(wmask) bytes */
+	for(; i < frame->payload_len; i++)
+		frame->payload_data[i] ^= frame->masking_key[i % 4];
 
 	LM_DBG("Rx (decoded) (len %u): %.*s\n", frame->payload_len,
 			(int)frame->payload_len, frame->payload_data);
@@ -805,8 +822,10 @@ void ws_keepalive(unsigned int ticks, void *param)
 	int i = 0;
 	int idx = (int)(long)param;
 
-	/* get an array of pointer to all ws connection */
-	list_head = wsconn_get_list_ids(idx);
+	/* get the ids of the connections due for a keepalive check - the used
+	   lists are ordered by last_used, so connections used more recently
+	   than check_time are not even visited */
+	list_head = wsconn_get_list_ids(idx, check_time);
 	if(!list_head)
 		return;
 
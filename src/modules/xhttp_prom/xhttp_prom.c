@@ -36,6 +36,8 @@
 #include "../../core/kemi.h"
 #include "../../core/rpc.h"
 #include "../../core/rpc_lookup.h"
+#include "../../core/timer.h"
+#include "../../core/locking.h"
 
 #include "xhttp_prom.h"
 #include "prom.h"
@@ -176,6 +178,28 @@ int uptime_stat_enabled = 0; /**< enable or disable uptime statistic. */
 
 int pkgmem_stats_enabled = 0; /**< enable or disable pkgmem statistics. */
 
+int snapshot_interval = 0; /**< seconds between exposition snapshots
+								(0 - render on every scrape). */
+
+/**
+ * @brief Double-buffered pre-rendered exposition snapshot.
+ *
+ * The timer process renders the text exposition into the buffer not being
+ * served and then swaps the active index, so scrapes are answered with a
+ * plain copy of the active buffer and never walk (or lock) the metric
+ * lists themselves.
+ */
+typedef struct prom_snapshot
+{
+	gen_lock_t lock; /**< guards the active index and reads of it. */
+	int active;		 /**< buffer served to scrapes, -1 if none rendered yet. */
+	str data[2];	 /**< the two exposition buffers (in shm). */
+} prom_snapshot_t;
+
+static prom_snapshot_t *prom_snapshot = NULL;
+
+static void prom_snapshot_timer(unsigned int ticks, void *param);
+
 char error_buf[ERROR_REASON_BUF_LEN];
 
 /* clang-format off */
@@ -217,6 +241,7 @@ static param_export_t params[] = {
 	{"xhttp_prom_timeout", PARAM_INT, &timeout_minutes},
 	{"xhttp_prom_uptime_stat", PARAM_INT, &uptime_stat_enabled},
 	{"xhttp_prom_pkg_stats", PARAM_INT, &pkgmem_stats_enabled},
+	{"xhttp_prom_snapshot_interval", PARAM_INT, &snapshot_interval},
 	{0, 0, 0}
 };
 
@@ -298,6 +323,34 @@ static int mod_init(void)
 		return -1;
 	}
 
+	/* Set up the pre-rendered exposition snapshot. */
+	if(snapshot_interval > 0) {
+		prom_snapshot = shm_malloc(
+				sizeof(prom_snapshot_t) + 2 * (size_t)buf_size);
+		if(prom_snapshot == NULL) {
+			SHM_MEM_ERROR;
+			return -1;
+		}
+		memset(prom_snapshot, 0, sizeof(prom_snapshot_t));
+		if(lock_init(&prom_snapshot->lock) == NULL) {
+			LM_ERR("Cannot initialize snapshot lock\n");
+			shm_free(prom_snapshot);
+			prom_snapshot = NULL;
+			return -1;
+		}
+		prom_snapshot->active = -1;
+		prom_snapshot->data[0].s = (char *)prom_snapshot
+								   + sizeof(prom_snapshot_t);
+		prom_snapshot->data[1].s = prom_snapshot->data[0].s + buf_size;
+		if(register_timer(prom_snapshot_timer, NULL, snapshot_interval) < 0) {
+			LM_ERR("Cannot register snapshot timer\n");
+			lock_destroy(&prom_snapshot->lock);
+			shm_free(prom_snapshot);
+			prom_snapshot = NULL;
+			return -1;
+		}
+	}
+
 	/* Write helper variables used to make handling additional metrics easier*/
 	if(xhttp_prom_tags.len > 0) {
 		/* 4 characters more for comma, space and terminating null */
@@ -350,6 +403,12 @@ static void mod_destroy(void)
 	}
 
 	prom_metric_close();
+
+	if(prom_snapshot != NULL) {
+		lock_destroy(&prom_snapshot->lock);
+		shm_free(prom_snapshot);
+		prom_snapshot = NULL;
+	}
 }
 
 /**
@@ -476,6 +535,66 @@ static void xhttp_prom_reply_free(prom_ctx_t *ctx)
 	/* } */
 }
 
+/**
+ * @brief Render the exposition and publish it as the active snapshot.
+ *
+ * Runs in the timer process: the buffer not currently served is filled
+ * and the active index is swapped under the lock, so in-progress scrape
+ * copies always complete on a consistent buffer.
+ */
+static void prom_snapshot_timer(unsigned int ticks, void *param)
+{
+	int idx;
+
+	memset(&_prom_ctx, 0, sizeof(prom_ctx_t));
+	if(init_xhttp_prom_reply(&_prom_ctx) < 0) {
+		return;
+	}
+	if(prom_stats_get(&_prom_ctx, &xhttp_prom_stats)
+			|| _prom_ctx.reply.code != 200) {
+		LM_ERR("Failed to render the exposition snapshot\n");
+		xhttp_prom_reply_free(&_prom_ctx);
+		return;
+	}
+
+	idx = (prom_snapshot->active == 0) ? 1 : 0;
+	memcpy(prom_snapshot->data[idx].s, _prom_ctx.reply.body.s,
+			_prom_ctx.reply.body.len);
+	prom_snapshot->data[idx].len = _prom_ctx.reply.body.len;
+	lock_get(&prom_snapshot->lock);
+	prom_snapshot->active = idx;
+	lock_release(&prom_snapshot->lock);
+
+	xhttp_prom_reply_free(&_prom_ctx);
+}
+
+/**
+ * @brief Fill the reply body from the pre-rendered snapshot.
+ *
+ * @return 1 if the body was copied, 0 if no snapshot is available.
+ */
+static int prom_snapshot_serve(prom_ctx_t *ctx)
+{
+	int idx;
+
+	if(prom_snapshot == NULL || ctx->reply.buf.s == NULL)
+		return 0;
+
+	lock_get(&prom_snapshot->lock);
+	idx = prom_snapshot->active;
+	if(idx < 0) {
+		/* the timer did not produce a snapshot yet */
+		lock_release(&prom_snapshot->lock);
+		return 0;
+	}
+	memcpy(ctx->reply.buf.s, prom_snapshot->data[idx].s,
+			prom_snapshot->data[idx].len);
+	ctx->reply.body.len = prom_snapshot->data[idx].len;
+	lock_release(&prom_snapshot->lock);
+
+	return 1;
+}
+
 static int prom_send(prom_ctx_t *ctx)
 {
 	struct xhttp_prom_reply *reply;
@@ -485,7 +604,8 @@ static int prom_send(prom_ctx_t *ctx)
 
 	reply = &ctx->reply;
 
-	if(prom_stats_get(ctx, &xhttp_prom_stats)) {
+	if(prom_snapshot_serve(ctx) == 0
+			&& prom_stats_get(ctx, &xhttp_prom_stats)) {
 		LM_DBG("prom_fault(500,\"Internal Server Error\"\n");
 		prom_fault(ctx, 500, "Internal Server Error");
 	}
@@ -50,6 +50,7 @@
 #include "../../core/kemi.h"
 #include "../../core/cfg/cfg.h"
 #include "../../core/mem/mem.h"
+#include "../../core/hashes.h"
 #include "../../core/parser/parse_param.h"
 
 #include "xl_lib.h"
@@ -72,6 +73,7 @@ static int force_color = 0;
 static int long_format = 0;
 static int xlog_facility = DEFAULT_FACILITY;
 static char *xlog_facility_name = NULL;
+static int fmt_cache_size = 128;
 
 /** cfg dynamic parameters */
 struct cfg_group_xlog
@@ -176,6 +178,7 @@ static param_export_t params[] = {
 	{"log_colors", PARAM_STRING | PARAM_USE_FUNC, (void *)xlog_log_colors_param},
 	{"methods_filter", PARAM_INT, &xlog_default_cfg.methods_filter},
 	{"prefix_mode", PARAM_INT, &_xlog_prefix_mode},
+	{"fmt_cache_size", PARAM_INT, &fmt_cache_size},
 	{0, 0, 0}
 };
 
@@ -880,6 +883,97 @@ error:
 	return -1;
 }
 
+/* per-process lru cache with the parsed log message formats of the kemi
+ * functions - the parsed model keeps references inside the format text,
+ * so each item stores its own copy of it */
+typedef struct xlog_fmt_cache_item
+{
+	str fmt;
+	unsigned int hashid;
+	pv_elem_t *model;
+	struct xlog_fmt_cache_item *next;
+} xlog_fmt_cache_item_t;
+
+static xlog_fmt_cache_item_t *_xlog_fmt_cache_list = NULL;
+static int _xlog_fmt_cache_count = 0;
+
+/**
+ * get the parsed model of lmsg, from the cache or parsing and caching it
+ * - the cache keeps the ownership, release with xlog_fmt_cache_release()
+ */
+static pv_elem_t *xlog_fmt_cache_get(str *lmsg)
+{
+	xlog_fmt_cache_item_t *it;
+	xlog_fmt_cache_item_t *prev;
+	pv_elem_t *xmodel = NULL;
+	unsigned int hashid;
+
+	if(fmt_cache_size <= 0) {
+		if(pv_parse_format(lmsg, &xmodel) < 0)
+			return NULL;
+		return xmodel;
+	}
+
+	hashid = get_hash1_raw(lmsg->s, lmsg->len);
+	prev = NULL;
+	for(it = _xlog_fmt_cache_list; it != NULL; it = it->next) {
+		if(it->hashid == hashid && it->fmt.len == lmsg->len
+				&& memcmp(it->fmt.s, lmsg->s, lmsg->len) == 0) {
+			/* hit - move in front to keep the list in lru order */
+			if(prev != NULL) {
+				prev->next = it->next;
+				it->next = _xlog_fmt_cache_list;
+				_xlog_fmt_cache_list = it;
+			}
+			return it->model;
+		}
+		prev = it;
+	}
+
+	it = (xlog_fmt_cache_item_t *)pkg_malloc(
+			sizeof(xlog_fmt_cache_item_t) + lmsg->len + 1);
+	if(it == NULL) {
+		PKG_MEM_ERROR;
+		return NULL;
+	}
+	memset(it, 0, sizeof(xlog_fmt_cache_item_t));
+	it->fmt.s = (char *)it + sizeof(xlog_fmt_cache_item_t);
+	memcpy(it->fmt.s, lmsg->s, lmsg->len);
+	it->fmt.s[lmsg->len] = '\0';
+	it->fmt.len = lmsg->len;
+	it->hashid = hashid;
+	if(pv_parse_format(&it->fmt, &it->model) < 0) {
+		pkg_free(it);
+		return NULL;
+	}
+	it->next = _xlog_fmt_cache_list;
+	_xlog_fmt_cache_list = it;
+	_xlog_fmt_cache_count++;
+
+	if(_xlog_fmt_cache_count > fmt_cache_size) {
+		/* drop the least recently used item - the last one */
+		prev = _xlog_fmt_cache_list;
+		while(prev->next != NULL && prev->next->next != NULL)
+			prev = prev->next;
+		it = prev->next;
+		prev->next = NULL;
+		pv_elem_free_all(it->model);
+		pkg_free(it);
+		_xlog_fmt_cache_count--;
+	}
+
+	return _xlog_fmt_cache_list->model;
+}
+
+/**
+ * release a model returned by xlog_fmt_cache_get()
+ */
+static void xlog_fmt_cache_release(pv_elem_t *xmodel)
+{
+	if(fmt_cache_size <= 0)
+		pv_elem_free_all(xmodel);
+}
+
 /**
  * write message after evaluation of lmsg for pseudo-variables
  */
@@ -893,14 +987,15 @@ int ki_xlog_ex(sip_msg_t *msg, str *lfacility, int llevel, str *lmsg)
 	if(!is_printable(llevel))
 		return 1;
 
-	if(pv_parse_format(lmsg, &xmodel) < 0) {
+	xmodel = xlog_fmt_cache_get(lmsg);
+	if(xmodel == NULL) {
 		LM_ERR("error in parsing evaluated second parameter\n");
 		return -1;
 	}
 
 	if(pv_printf_s(msg, xmodel, &txt) != 0) {
 		LM_ERR("cannot eval reparsed value of second parameter\n");
-		pv_elem_free_all(xmodel);
+		xlog_fmt_cache_release(xmodel);
 		return -1;
 	}
 
@@ -926,7 +1021,7 @@ int ki_xlog_ex(sip_msg_t *msg, str *lfacility, int llevel, str *lmsg)
 		}
 	}
 	LOG_FN(lf, llevel, _xlog_prefix_val, "%.*s", txt.len, txt.s);
-	pv_elem_free_all(xmodel);
+	xlog_fmt_cache_release(xmodel);
 	return 1;
 }
 